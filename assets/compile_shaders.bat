@@ -70,7 +70,9 @@ REM %VULKAN_SDK%/Bin/glslc.exe --target-spv=spv1.4 %1/standard_instanced_shadow.
 
 %VULKAN_SDK%/Bin/glslc.exe --target-spv=spv1.4 %1/light_shadow_sum.comp -o %2/light_shadow_sum_comp.spv
 
-%VULKAN_SDK%/Bin/glslc.exe --target-spv=spv1.4 %1/particle_update.comp -o %2/particle_update_comp.spv
+%VULKAN_SDK%/Bin/glslc.exe --target-spv=spv1.4 %1/particle_emit.comp -o %2/particle_emit_comp.spv
+%VULKAN_SDK%/Bin/glslc.exe --target-spv=spv1.4 %1/particle_kickoff.comp -o %2/particle_kickoff_comp.spv
+%VULKAN_SDK%/Bin/glslc.exe --target-spv=spv1.4 %1/particle_simulate.comp -o %2/particle_simulate_comp.spv
 
 %VULKAN_SDK%/Bin/glslc.exe --target-spv=spv1.4 %1/tlas_update.comp -o %2/tlas_update_comp.spv
 
@@ -0,0 +1,51 @@
+// Same layouts as GPUParticle, GPUParticleEmitter and GPUParticlePushConstants in GpuBuffers.h.
+// The math here and in the particle shaders is mirrored by render::ParticleSimulation on the CPU.
+
+#define PARTICLE_EMITTER_RESET_FLAG 1
+
+struct Particle
+{
+  vec4 position; // w is age
+  vec4 velocity; // w is lifetime
+  float scale;
+  uint emitter;
+  uint pad0;
+  uint pad1;
+};
+
+struct ParticleEmitter
+{
+  vec4 position; // w is spawn radius
+  vec4 minVelocity; // w is lifetime
+  vec4 maxVelocity; // w is restitution, negative if particles don't bounce
+  vec4 gravity; // w is height of the ground plane
+  vec4 scale; // x is min, y is max
+  uint rangeStart;
+  uint rangeSize; // 0 if the slot isn't used
+  uint spawnCount;
+  uint seed;
+  uint flags;
+  uint pad0;
+  uint pad1;
+  uint pad2;
+};
+
+layout(push_constant) uniform constants {
+  uint current; // Alive list that is simulated this frame
+  uint maxParticles; // Size of each alive list
+  uint numEmitters;
+} pc;
+
+uint pcgHash(uint v)
+{
+  uint state = v * 747796405u + 2891336453u;
+  uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+  return (word >> 22u) ^ word;
+}
+
+// [0, 1), advances state
+float randomFloat(inout uint state)
+{
+  state = pcgHash(state);
+  return float(state >> 8u) * (1.0 / 16777216.0);
+}
@@ -66,6 +66,10 @@ if (WIN32)
   endif()
   
   add_definitions(-DJPH_DEBUG_RENDERER)
+
+  # Jolt's profile zones are forwarded to util::Profiler (see PhysicsJoltImpl.cpp) instead of its own profiler
+  set(PROFILER_IN_DEBUG_AND_RELEASE OFF CACHE BOOL "Enable the Jolt profiler" FORCE)
+  add_definitions(-DJPH_EXTERNAL_PROFILE)
   add_subdirectory(${CMAKE_CURRENT_LIST_DIR}/JoltPhysics/Build)
 
 else()  
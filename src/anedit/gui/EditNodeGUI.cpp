@@ -14,8 +14,10 @@
 #include "component/EditBoxColliderGUI.h"
 #include "component/EditCharacterControllerGUI.h"
 #include "component/EditCapsuleColliderGUI.h"
+#include "component/EditHeightfieldColliderGUI.h"
 #include "component/EditCameraGUI.h"
 #include "component/EditBehaviourGUI.h"
+#include "component/EditParticleEmitterGUI.h"
 
 #include <imgui.h>
 
@@ -48,8 +50,10 @@ EditNodeGUI::EditNodeGUI()
   _componentGUIs[typeid(component::BoxCollider)] = new EditBoxColliderGUI();
   _componentGUIs[typeid(component::CharacterController)] = new EditCharacterControllerGUI();
   _componentGUIs[typeid(component::CapsuleCollider)] = new EditCapsuleColliderGUI();
+  _componentGUIs[typeid(component::HeightfieldCollider)] = new EditHeightfieldColliderGUI();
   _componentGUIs[typeid(component::Camera)] = new EditCameraGUI();
   _componentGUIs[typeid(component::Behaviour)] = new EditBehaviourGUI();
+  _componentGUIs[typeid(component::ParticleEmitter)] = new EditParticleEmitterGUI();
 }
 
 EditNodeGUI::~EditNodeGUI()
@@ -96,8 +100,10 @@ void EditNodeGUI::immediateDraw(logic::AneditContext* c)
   bool hasBoxCollider = false;
   bool hasCharacterController = false;
   bool hasCapsuleCollider = false;
+  bool hasHeightfieldCollider = false;
   bool hasCamera = false;
   bool hasBehaviour = false;
+  bool hasParticleEmitter = false;
 
   DRAW_COMP(Transform);
   DRAW_COMP(Renderable);
@@ -110,8 +116,10 @@ void EditNodeGUI::immediateDraw(logic::AneditContext* c)
   DRAW_COMP(BoxCollider);
   DRAW_COMP(CharacterController);
   DRAW_COMP(CapsuleCollider);
+  DRAW_COMP(HeightfieldCollider);
   DRAW_COMP(Camera);
   DRAW_COMP(Behaviour);
+  DRAW_COMP(ParticleEmitter);
 
   // Add new components
   if (ImGui::BeginPopupContextWindow()) {
@@ -165,6 +173,12 @@ void EditNodeGUI::immediateDraw(logic::AneditContext* c)
         c->scene().registry().patchComponent<component::CapsuleCollider>(id);
       }
     }
+    if (!hasHeightfieldCollider && hasTerrain) {
+      if (ImGui::MenuItem("Add heightfield collider...")) {
+        c->scene().registry().addComponent<component::HeightfieldCollider>(id);
+        c->scene().registry().patchComponent<component::HeightfieldCollider>(id);
+      }
+    }
     if (!hasCharacterController) {
       if (ImGui::MenuItem("Add character controller...")) {
         c->scene().registry().addComponent<component::CharacterController>(id);
@@ -183,6 +197,12 @@ void EditNodeGUI::immediateDraw(logic::AneditContext* c)
         c->scene().registry().patchComponent<component::Behaviour>(id);
       }
     }
+    if (!hasParticleEmitter) {
+      if (ImGui::MenuItem("Add particle emitter...")) {
+        c->scene().registry().addComponent<component::ParticleEmitter>(id);
+        c->scene().registry().patchComponent<component::ParticleEmitter>(id);
+      }
+    }
 
     ImGui::EndPopup();
   }
@@ -0,0 +1,245 @@
+#include "ProfilerGUI.h"
+
+#include "../logic/AneditContext.h"
+
+#include <imgui.h>
+#include <nfd.hpp>
+
+#include <algorithm>
+#include <map>
+#include <string>
+
+namespace gui {
+
+namespace {
+
+const float g_BarHeight = 18.0f;
+const float g_LabelWidth = 110.0f;
+
+ImU32 zoneColor(const char* name)
+{
+  // Stable color per zone name
+  std::uint32_t hash = 2166136261u;
+  for (const char* c = name; *c; ++c) {
+    hash = (hash ^ (std::uint8_t)*c) * 16777619u;
+  }
+
+  float hue = (hash % 360) / 360.0f;
+  float r, g, b;
+  ImGui::ColorConvertHSVtoRGB(hue, 0.5f, 0.8f, r, g, b);
+  return ImGui::GetColorU32(ImVec4(r, g, b, 1.0f));
+}
+
+}
+
+ProfilerGUI::ProfilerGUI()
+  : IGUI()
+{}
+
+ProfilerGUI::~ProfilerGUI()
+{}
+
+void ProfilerGUI::immediateDraw(logic::AneditContext* c)
+{
+  ImGui::Begin("Profiler");
+
+  bool recording = util::Profiler::enabled();
+  if (ImGui::Checkbox("Record", &recording)) {
+    util::Profiler::setEnabled(recording);
+  }
+  ImGui::SameLine();
+  if (ImGui::Button("Clear")) {
+    util::Profiler::clear();
+    _frameEvents.clear();
+    _frameStartNs = _frameEndNs = 0;
+  }
+  ImGui::SameLine();
+  if (ImGui::Button("Export trace...")) {
+    exportClicked();
+  }
+
+  // Keep showing the last captured frame while paused
+  if (recording) {
+    captureLastFrame();
+  }
+
+  if (_frameEndNs > _frameStartNs) {
+    ImGui::Text("Frame %.3f ms", (_frameEndNs - _frameStartNs) / 1000000.0);
+    drawTimeline();
+    drawZoneTable();
+  }
+  else {
+    ImGui::Text("No complete frame recorded yet");
+  }
+
+  ImGui::End();
+}
+
+void ProfilerGUI::captureLastFrame()
+{
+  // Events starting before the frame may still overlap it, so look back a bit further
+  auto events = util::Profiler::snapshot(util::Profiler::nowNs() - 1000000000ll);
+
+  std::int64_t lastFrame = -1;
+  std::int64_t prevFrame = -1;
+  for (auto& event : events) {
+    if (event._type == util::ProfileEventType::Frame) {
+      prevFrame = lastFrame;
+      lastFrame = event._startNs;
+    }
+  }
+
+  if (prevFrame < 0) {
+    return;
+  }
+
+  _frameStartNs = prevFrame;
+  _frameEndNs = lastFrame;
+  _frameEvents.clear();
+  for (auto& event : events) {
+    if (event._type == util::ProfileEventType::Zone) {
+      if (event._startNs < _frameEndNs && event._startNs + event._durationNs > _frameStartNs) {
+        _frameEvents.emplace_back(event);
+      }
+    }
+    else if (event._type == util::ProfileEventType::Counter && event._startNs < _frameEndNs) {
+      _frameEvents.emplace_back(event);
+    }
+  }
+
+  _threads = util::Profiler::threads();
+}
+
+void ProfilerGUI::drawTimeline()
+{
+  // Rows for the threads that have zones this frame, GPU first
+  std::map<std::uint32_t, std::vector<const util::ProfileEvent*>> rows;
+  for (auto& event : _frameEvents) {
+    if (event._type == util::ProfileEventType::Zone) {
+      rows[event._threadId].emplace_back(&event);
+    }
+  }
+
+  auto* drawList = ImGui::GetWindowDrawList();
+  float width = std::max(ImGui::GetContentRegionAvail().x - g_LabelWidth, 100.0f);
+  double nsToPx = width / (double)(_frameEndNs - _frameStartNs);
+
+  for (auto& [threadId, zones] : rows) {
+    std::string name = "Thread " + std::to_string(threadId);
+    for (auto& t : _threads) {
+      if (t._id == threadId) {
+        name = t._name;
+      }
+    }
+
+    // Nesting depth from the zones still open when each one starts. Parents start first, or at the same time but last longer.
+    std::stable_sort(zones.begin(), zones.end(), [](const util::ProfileEvent* a, const util::ProfileEvent* b) {
+      return a->_startNs < b->_startNs || (a->_startNs == b->_startNs && a->_durationNs > b->_durationNs);
+    });
+
+    std::vector<int> depths;
+    std::vector<std::int64_t> openEnds;
+    int maxDepth = 0;
+    for (auto* zone : zones) {
+      while (!openEnds.empty() && openEnds.back() <= zone->_startNs) {
+        openEnds.pop_back();
+      }
+      depths.emplace_back((int)openEnds.size());
+      maxDepth = std::max(maxDepth, (int)openEnds.size());
+      openEnds.emplace_back(zone->_startNs + zone->_durationNs);
+    }
+
+    ImVec2 origin = ImGui::GetCursorScreenPos();
+    float rowHeight = (maxDepth + 1) * g_BarHeight;
+    drawList->AddText(origin, ImGui::GetColorU32(ImGuiCol_Text), name.c_str());
+
+    for (std::size_t i = 0; i < zones.size(); ++i) {
+      auto* zone = zones[i];
+      auto start = std::max(zone->_startNs, _frameStartNs) - _frameStartNs;
+      auto end = std::min(zone->_startNs + zone->_durationNs, _frameEndNs) - _frameStartNs;
+
+      ImVec2 min(origin.x + g_LabelWidth + (float)(start * nsToPx), origin.y + depths[i] * g_BarHeight);
+      ImVec2 max(std::max(origin.x + g_LabelWidth + (float)(end * nsToPx), min.x + 1.0f), min.y + g_BarHeight - 1.0f);
+      drawList->AddRectFilled(min, max, zoneColor(zone->_name));
+
+      if (max.x - min.x > 30.0f) {
+        drawList->PushClipRect(min, max, true);
+        drawList->AddText(ImVec2(min.x + 2.0f, min.y + 1.0f), IM_COL32(0, 0, 0, 255), zone->_name);
+        drawList->PopClipRect();
+      }
+
+      if (ImGui::IsMouseHoveringRect(min, max)) {
+        ImGui::SetTooltip("%s\n%.3f ms", zone->_name, zone->_durationNs / 1000000.0);
+      }
+    }
+
+    ImGui::Dummy(ImVec2(g_LabelWidth + width, rowHeight + 4.0f));
+  }
+}
+
+void ProfilerGUI::drawZoneTable()
+{
+  struct Total
+  {
+    double _ms = 0.0;
+    int _count = 0;
+    bool _gpu = false;
+  };
+
+  std::map<std::string, Total> totals;
+  std::map<std::string, double> counters;
+  for (auto& event : _frameEvents) {
+    if (event._type == util::ProfileEventType::Zone) {
+      auto& total = totals[event._name];
+      total._ms += event._durationNs / 1000000.0;
+      total._count++;
+      total._gpu = event._threadId == util::Profiler::GPU_THREAD_ID;
+    }
+    else if (event._type == util::ProfileEventType::Counter) {
+      counters[event._name] = event._value;
+    }
+  }
+
+  std::vector<std::pair<std::string, Total>> sorted(totals.begin(), totals.end());
+  std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) { return a.second._ms > b.second._ms; });
+
+  if (ImGui::BeginTable("Zones", 4, ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY, ImVec2(0.0f, 300.0f))) {
+    ImGui::TableSetupColumn("Zone");
+    ImGui::TableSetupColumn("Total ms");
+    ImGui::TableSetupColumn("Count");
+    ImGui::TableSetupColumn("Where");
+    ImGui::TableHeadersRow();
+
+    for (auto& [name, total] : sorted) {
+      ImGui::TableNextColumn();
+      ImGui::Text("%s", name.c_str());
+      ImGui::TableNextColumn();
+      ImGui::Text("%.3f", total._ms);
+      ImGui::TableNextColumn();
+      ImGui::Text("%d", total._count);
+      ImGui::TableNextColumn();
+      ImGui::Text("%s", total._gpu ? "GPU" : "CPU");
+    }
+    ImGui::EndTable();
+  }
+
+  for (auto& [name, value] : counters) {
+    ImGui::Text("%s: %.3f", name.c_str(), value);
+  }
+}
+
+void ProfilerGUI::exportClicked()
+{
+  NFD::UniquePath outPath;
+
+  nfdfilteritem_t filterItem[1] = { {"Chrome trace", "json"} };
+
+  auto result = NFD::SaveDialog(outPath, filterItem, 1, nullptr, "trace.json");
+  if (result == NFD_OKAY) {
+    if (util::Profiler::writeChromeTrace(outPath.get())) {
+      printf("Wrote profiler trace to %s\n", outPath.get());
+    }
+  }
+}
+
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "IGUI.h"
+
+#include <util/Profiler.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace gui {
+
+/*
+* Timeline of the last complete frame from util::Profiler, one row per thread with the GPU passes on top.
+* Pausing the recording keeps the captured frame around for inspection, and the full history can be exported as a Chrome trace.
+*/
+class ProfilerGUI : public IGUI
+{
+public:
+  ProfilerGUI();
+  ~ProfilerGUI();
+
+  void immediateDraw(logic::AneditContext* c) override final;
+
+private:
+  void captureLastFrame();
+  void drawTimeline();
+  void drawZoneTable();
+
+  void exportClicked();
+
+  std::vector<util::ProfileEvent> _frameEvents;
+  std::vector<util::ProfileThread> _threads;
+  std::int64_t _frameStartNs = 0;
+  std::int64_t _frameEndNs = 0;
+};
+
+}
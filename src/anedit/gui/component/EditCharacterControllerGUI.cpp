@@ -31,6 +31,16 @@ void EditCharacterControllerGUI::immediateDraw(logic::AneditContext* c)
     changed = true;
   }
 
+  if (ImGui::InputFloat("Max step height", &comp._maxStepHeight)) {
+    comp._maxStepHeight = glm::clamp(comp._maxStepHeight, 0.0f, 2.0f);
+    changed = true;
+  }
+
+  if (ImGui::InputFloat("Ground snap distance", &comp._groundSnapDistance)) {
+    comp._groundSnapDistance = glm::clamp(comp._groundSnapDistance, 0.0f, 2.0f);
+    changed = true;
+  }
+
   if (changed) {
     c->scene().registry().patchComponent<component::CharacterController>(id);
   }
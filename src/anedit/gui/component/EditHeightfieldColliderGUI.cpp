@@ -0,0 +1,49 @@
+#include "EditHeightfieldColliderGUI.h"
+
+#include "../../logic/AneditContext.h"
+#include <render/scene/Scene.h>
+
+#include <imgui.h>
+
+namespace gui {
+
+EditHeightfieldColliderGUI::EditHeightfieldColliderGUI()
+  : IGUI()
+{}
+
+EditHeightfieldColliderGUI::~EditHeightfieldColliderGUI()
+{}
+
+void EditHeightfieldColliderGUI::immediateDraw(logic::AneditContext* c)
+{
+  auto id = c->getFirstSelection();
+
+  if (!id) {
+    return;
+  }
+
+  bool changed = false;
+  auto& heightfieldComp = c->scene().registry().getComponent<component::HeightfieldCollider>(id);
+
+  // Uses the heightmap of the terrain comp
+  if (!c->scene().registry().hasComponent<component::Terrain>(id)) {
+    ImGui::Text("Needs a terrain component!");
+  }
+
+  int blockSize = heightfieldComp._blockSize;
+  if (ImGui::SliderInt("Block size", &blockSize, 2, 8)) {
+    heightfieldComp._blockSize = (std::uint8_t)blockSize;
+    changed = true;
+  }
+  int bitsPerSample = heightfieldComp._bitsPerSample;
+  if (ImGui::SliderInt("Bits per sample", &bitsPerSample, 1, 8)) {
+    heightfieldComp._bitsPerSample = (std::uint8_t)bitsPerSample;
+    changed = true;
+  }
+
+  if (changed) {
+    c->scene().registry().patchComponent<component::HeightfieldCollider>(id);
+  }
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "../IGUI.h"
+
+namespace gui {
+
+class EditHeightfieldColliderGUI : public IGUI
+{
+public:
+  EditHeightfieldColliderGUI();
+  ~EditHeightfieldColliderGUI();
+
+  void immediateDraw(logic::AneditContext* c) override final;
+};
+
+}
\ No newline at end of file
@@ -3,6 +3,8 @@
 #include "../../logic/AneditContext.h"
 
 #include <render/scene/Scene.h>
+#include <render/asset/AssetCollection.h>
+#include <physics/PhysicsSystem.h>
 
 #include <imgui.h>
 
@@ -23,7 +25,67 @@ void EditMeshColliderGUI::immediateDraw(logic::AneditContext* c)
     return;
   }
 
-  ImGui::Text("No params");  
+  auto& registry = c->scene().registry();
+  if (!registry.hasComponent<component::Renderable>(id)) {
+    ImGui::Text("Needs a renderable to build the shape from");
+    return;
+  }
+
+  auto modelId = registry.getComponent<component::Renderable>(id)._model;
+  bool modelUpdated = false;
+  for (auto& event : c->assetCollection().getEventLog()._events) {
+    if (event._type == render::asset::AssetEventType::ModelUpdated && event._id == modelId) {
+      modelUpdated = true;
+      break;
+    }
+  }
+
+  if (modelUpdated || _info._modelId != modelId) {
+    refreshInfo(c, modelId);
+  }
+
+  if (!_info._hasMeshes) {
+    ImGui::Text("Model has no meshes");
+    return;
+  }
+
+  bool baked = _info._bakedBytes > 0;
+  if (baked) {
+    ImGui::Text("Baked collision shape (%.1f kB)", _info._bakedBytes / 1024.0f);
+  }
+  else {
+    ImGui::Text("Collision shape is built at load");
+  }
+
+  // The shape is built from the last mesh of the model, same as physics::PhysicsSystem does.
+  // The model is only loaded when it is about to change.
+  if (ImGui::Button(baked ? "Rebake collision shape" : "Bake collision shape")) {
+    auto model = c->assetCollection().getModelBlocking(modelId);
+    if (!model._meshes.empty() && physics::PhysicsSystem::bakeCollisionShape(model._meshes.back())) {
+      _info._bakedBytes = model._meshes.back()._bakedCollisionShape.size();
+      c->assetCollection().updateModel(std::move(model));
+    }
+  }
+  if (baked) {
+    ImGui::SameLine();
+    if (ImGui::Button("Clear baked shape")) {
+      auto model = c->assetCollection().getModelBlocking(modelId);
+      if (!model._meshes.empty()) {
+        model._meshes.back()._bakedCollisionShape.clear();
+        _info._bakedBytes = 0;
+        c->assetCollection().updateModel(std::move(model));
+      }
+    }
+  }
+}
+
+void EditMeshColliderGUI::refreshInfo(logic::AneditContext* c, const util::Uuid& modelId)
+{
+  auto model = c->assetCollection().getModelBlocking(modelId);
+
+  _info._modelId = modelId;
+  _info._hasMeshes = !model._meshes.empty();
+  _info._bakedBytes = _info._hasMeshes ? model._meshes.back()._bakedCollisionShape.size() : 0;
 }
 
 }
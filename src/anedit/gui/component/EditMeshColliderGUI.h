@@ -2,6 +2,10 @@
 
 #include "../IGUI.h"
 
+#include <util/Uuid.h>
+
+#include <cstddef>
+
 namespace gui {
 
 class EditMeshColliderGUI : public IGUI
@@ -11,6 +15,18 @@ public:
   ~EditMeshColliderGUI();
 
   void immediateDraw(logic::AneditContext* c) override final;
+
+private:
+  // What is shown about the model of the selection, so that it isn't loaded every frame.
+  // Refreshed when another model is selected or the model is updated.
+  struct ModelInfo
+  {
+    util::Uuid _modelId;
+    bool _hasMeshes = false;
+    std::size_t _bakedBytes = 0;
+  } _info;
+
+  void refreshInfo(logic::AneditContext* c, const util::Uuid& modelId);
 };
 
 }
@@ -0,0 +1,97 @@
+#include "EditParticleEmitterGUI.h"
+
+#include "../../logic/AneditContext.h"
+
+#include <render/scene/Scene.h>
+#include <render/ParticleEmitterPool.h>
+
+#include <imgui.h>
+
+namespace gui {
+
+EditParticleEmitterGUI::EditParticleEmitterGUI()
+  : IGUI()
+{}
+
+EditParticleEmitterGUI::~EditParticleEmitterGUI()
+{}
+
+void EditParticleEmitterGUI::immediateDraw(logic::AneditContext* c)
+{
+  auto id = c->getFirstSelection();
+
+  if (!id) {
+    return;
+  }
+
+  bool changed = false;
+  auto& comp = c->scene().registry().getComponent<component::ParticleEmitter>(id);
+
+  if (ImGui::Checkbox("Enabled", &comp._enabled)) {
+    changed = true;
+  }
+
+  int maxParticles = (int)comp._maxParticles;
+  if (ImGui::InputInt("Max particles", &maxParticles, 100, 1000, ImGuiInputTextFlags_EnterReturnsTrue)) {
+    comp._maxParticles = (std::uint32_t)glm::clamp(maxParticles, 1, (int)render::ParticleEmitterPool::MAX_PARTICLES);
+    changed = true;
+  }
+
+  if (ImGui::InputFloat("Spawn rate", &comp._spawnRate)) {
+    comp._spawnRate = glm::clamp(comp._spawnRate, 0.0f, 100000.0f);
+    changed = true;
+  }
+
+  if (ImGui::InputFloat("Lifetime", &comp._lifetime)) {
+    comp._lifetime = glm::clamp(comp._lifetime, 0.01f, 600.0f);
+    changed = true;
+  }
+
+  if (ImGui::InputFloat("Spawn radius", &comp._spawnRadius)) {
+    comp._spawnRadius = glm::clamp(comp._spawnRadius, 0.0f, 100.0f);
+    changed = true;
+  }
+
+  if (ImGui::InputFloat3("Min velocity", &comp._minVelocity[0])) {
+    changed = true;
+  }
+
+  if (ImGui::InputFloat3("Max velocity", &comp._maxVelocity[0])) {
+    changed = true;
+  }
+
+  if (ImGui::InputFloat("Min scale", &comp._minScale)) {
+    comp._minScale = glm::clamp(comp._minScale, 0.001f, comp._maxScale);
+    changed = true;
+  }
+
+  if (ImGui::InputFloat("Max scale", &comp._maxScale)) {
+    comp._maxScale = glm::clamp(comp._maxScale, comp._minScale, 100.0f);
+    changed = true;
+  }
+
+  if (ImGui::InputFloat3("Gravity", &comp._gravity[0])) {
+    changed = true;
+  }
+
+  if (ImGui::Checkbox("Bounce", &comp._bounce)) {
+    changed = true;
+  }
+
+  if (comp._bounce) {
+    if (ImGui::InputFloat("Ground offset", &comp._groundOffset)) {
+      changed = true;
+    }
+
+    if (ImGui::InputFloat("Restitution", &comp._restitution)) {
+      comp._restitution = glm::clamp(comp._restitution, 0.0f, 1.0f);
+      changed = true;
+    }
+  }
+
+  if (changed) {
+    c->scene().registry().patchComponent<component::ParticleEmitter>(id);
+  }
+}
+
+}
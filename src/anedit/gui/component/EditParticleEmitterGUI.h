@@ -0,0 +1,16 @@
+#pragma once
+
+#include "../IGUI.h"
+
+namespace gui {
+
+  class EditParticleEmitterGUI : public IGUI
+  {
+  public:
+    EditParticleEmitterGUI();
+    ~EditParticleEmitterGUI();
+
+    void immediateDraw(logic::AneditContext* c) override final;
+  };
+
+}
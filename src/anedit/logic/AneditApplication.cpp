@@ -4,6 +4,7 @@
 #include "../../common/input/MousePosInput.h"
 #include <util/GLTFLoader.h>
 #include <util/TextureHelpers.h>
+#include <util/Profiler.h>
 #include <render/ImageHelpers.h>
 #include <render/cinematic/CinematicPlayer.h>
 
@@ -12,6 +13,7 @@
 #include "../gui/SceneAssetGUI.h"
 #include "../gui/SceneListGUI.h"
 #include "../gui/EditSelectionGUI.h"
+#include "../gui/ProfilerGUI.h"
 
 #include <imgui.h>
 #include <nfd.hpp>
@@ -49,6 +51,10 @@ AneditApplication::AneditApplication(std::string title)
   _assColl.readIndices();
   _behaviourSystem.setScene(&_scene);
   _behaviourSystem.setRegistry(&_scene.registry());
+  _behaviourSystem.setPhysicsSystem(&_physicsSystem);
+  _significance.setScene(&_scene);
+  _animUpdater.setSignificanceManager(&_significance);
+  _behaviourSystem.setSignificanceManager(&_significance);
 }
 
 AneditApplication::~AneditApplication()
@@ -104,6 +110,7 @@ bool AneditApplication::init()
   _lastCamPos = _camera.getPosition();
 
   registerBehaviours();
+  setupTelemetry();
 
   return true;
 }
@@ -128,6 +135,7 @@ void AneditApplication::update(double delta)
       // Update pointers to all the systems that need it.
       _scenePager.setScene(&_scene);
       _scenePager.setAssetCollection(&_assColl);
+      _significance.setScene(&_scene);
       _animUpdater.setScene(&_scene);
       _animUpdater.setAssetCollection(&_assColl);
       _terrainSystem.setScene(&_scene);
@@ -157,49 +165,61 @@ void AneditApplication::update(double delta)
   updateCamera(delta);
 
   if (_state == State::Playing) {
-    auto now = std::chrono::system_clock::now();
-    _animUpdater.update(delta);
-    auto after = std::chrono::system_clock::now();
+    ANEREND_PROFILE_SCOPE("Significance");
+    _significance.update(_camera, delta);
+  }
 
-    //printf("Anim took %lld us\n", std::chrono::duration_cast<std::chrono::microseconds>(after - now).count());
+  if (_state == State::Playing) {
+    ANEREND_PROFILE_SCOPE("Animation");
+    _animUpdater.update(delta);
   }
 
   // Behaviours
   if (_state == State::Playing) {
+    ANEREND_PROFILE_SCOPE("Behaviours");
     _behaviourSystem.update(delta);
   }
 
   // Terrain
-  _terrainSystem.update();
+  {
+    ANEREND_PROFILE_SCOPE("Terrain");
+    _terrainSystem.update();
+  }
 
   // Physics
-  _physicsSystem.simulationRunning() = _state == State::Playing;
-  _physicsSystem.downstreamTransformSync();
-  _physicsSystem.update(delta, _drawPhysicsDebug);
-  _physicsSystem.upstreamTransformSync();
+  {
+    ANEREND_PROFILE_SCOPE("Physics");
+    _physicsSystem.simulationRunning() = _state == State::Playing;
+    _physicsSystem.downstreamTransformSync();
+    _physicsSystem.update(delta, _drawPhysicsDebug);
+    _physicsSystem.upstreamTransformSync();
+  }
 
   {
-    auto now = std::chrono::system_clock::now();
+    ANEREND_PROFILE_SCOPE("Scene update");
     _scene.update();
-    auto after = std::chrono::system_clock::now();
-
-    //printf("Scene update took %lld us\n", std::chrono::duration_cast<std::chrono::microseconds>(after - now).count());
   }
 
   // Update cinematics. Check event log of asset collection if any cinematic has been touched.
-  const auto& assLog = _assColl.getEventLog();
-  for (auto it = _cinePlayers.begin(); it != _cinePlayers.end(); ++it) {
-    for (auto& event : assLog._events) {
-      if (event._type == render::asset::AssetEventType::CinematicUpdated &&
-        event._id == it->second.cinematicId()) {
-        it->second.updateCinematic(_assColl.getCinematicBlocking(event._id));
-        break;
+  {
+    ANEREND_PROFILE_SCOPE("Cinematics");
+    const auto& assLog = _assColl.getEventLog();
+    for (auto it = _cinePlayers.begin(); it != _cinePlayers.end(); ++it) {
+      for (auto& event : assLog._events) {
+        if (event._type == render::asset::AssetEventType::CinematicUpdated &&
+          event._id == it->second.cinematicId()) {
+          it->second.updateCinematic(_assColl.getCinematicBlocking(event._id));
+          break;
+        }
       }
+      it->second.update(delta);
     }
-    it->second.update(delta);
   }
 
-  _scenePager.update(_camera.getPosition());
+  {
+    ANEREND_PROFILE_SCOPE("Scene pager");
+    _scenePager.update(_camera.getPosition());
+  }
   _scene.resetEvents();
   _assColl.clearEventLog();
 
@@ -221,6 +241,8 @@ void AneditApplication::update(double delta)
     _renderOptions,
     _renderDebugOptions);
     //_windSystem.getCurrentWindMap());
+
+  updateTelemetry(delta);
 }
 
 void AneditApplication::render()
@@ -239,6 +261,7 @@ void AneditApplication::render()
     if (ImGui::Button("Teleport to origin")) {
       _camera.setPosition({ 0.0f, 0.0f, 0.0f });
     }
+    telemetryUI();
     ImGui::End();
   }
 
@@ -248,18 +271,9 @@ void AneditApplication::render()
 
   oldUI();
 
-  {
-    auto now = std::chrono::system_clock::now();
-    _vkRenderer.drawFrame();
-    auto after = std::chrono::system_clock::now();
-
-    /*static int counter = 0;
-    if (counter++ % 50) {
-      printf("Recording frame took %lld us\n", std::chrono::duration_cast<std::chrono::microseconds>(after - now).count());
-    }*/
-
-  }
+  _vkRenderer.drawFrame();
 
+  _telemetry.endFrame();
 }
 
 void AneditApplication::setupGuis()
@@ -267,6 +281,101 @@ void AneditApplication::setupGuis()
   _guis.emplace_back(new gui::SceneAssetGUI());
   _guis.emplace_back(new gui::SceneListGUI());
   _guis.emplace_back(new gui::EditSelectionGUI());
+  _guis.emplace_back(new gui::ProfilerGUI());
+}
+
+void AneditApplication::setupTelemetry()
+{
+  // Occupancy gauges get their budgets from the renderer's capacities in updateTelemetry().
+  // Anything below 30 fps counts as a spike.
+  _telemetry.setBudget("Frame time (ms)", 1000.0 / 30.0);
+}
+
+void AneditApplication::updateTelemetry(double delta)
+{
+  // Warn well before the hard limits (and asserts) are hit
+  const double budgetFraction = 0.9;
+  const double mb = 1024.0 * 1024.0;
+
+  auto usage = _vkRenderer.getUsageStats();
+
+  _telemetry.record("Frame time (ms)", delta * 1000.0);
+  _telemetry.record("Giga vertex buffer (MB)", usage._gigaVtxUsedBytes / mb, usage._gigaBufferBytes / mb, budgetFraction);
+  _telemetry.record("Giga index buffer (MB)", usage._gigaIdxUsedBytes / mb, usage._gigaBufferBytes / mb, budgetFraction);
+  _telemetry.record("Staging buffer (MB)", usage._stagingUsedBytes / mb, usage._stagingBytes / mb, budgetFraction);
+  _telemetry.record("Bindless textures", (double)usage._bindlessUsed, (double)usage._maxBindless, budgetFraction);
+  _telemetry.record("Renderables", (double)usage._renderables, (double)usage._maxRenderables, budgetFraction);
+  _telemetry.record("Meshes", (double)usage._meshes, (double)usage._maxMeshes, budgetFraction);
+  _telemetry.record("Materials", (double)usage._materials, (double)usage._maxMaterials, budgetFraction);
+  _telemetry.record("Lights", (double)usage._lights, (double)usage._maxLights, budgetFraction);
+  _telemetry.record("Cached assets", (double)_assColl.numCachedAssets());
+  _telemetry.record("Asset cache (MB)", _assColl.cachedBytes() / mb);
+
+  // The significance budget can change at runtime, 0 removes it
+  _telemetry.setBudget("Behaviours and animation (ms)", _significance.settings()._budgetMs);
+  _telemetry.record("Behaviours and animation (ms)", _significance.stats()._costMs);
+  _telemetry.record("Throttled updates skipped", (double)_significance.stats()._numSkipped);
+}
+
+void AneditApplication::telemetryUI()
+{
+  if (!ImGui::CollapsingHeader("Telemetry")) {
+    return;
+  }
+
+  ImGui::Text("Over the last %zu frames", _telemetry.windowSize());
+
+  if (ImGui::BeginTable("Telemetry", 6, ImGuiTableFlags_RowBg)) {
+    ImGui::TableSetupColumn("Gauge");
+    ImGui::TableSetupColumn("Current");
+    ImGui::TableSetupColumn("p50");
+    ImGui::TableSetupColumn("p95");
+    ImGui::TableSetupColumn("p99");
+    ImGui::TableSetupColumn("Budget");
+    ImGui::TableHeadersRow();
+
+    for (auto& stats : _telemetry.allStats()) {
+      bool over = stats._budget > 0.0 && stats._current > stats._budget;
+      ImVec4 color = over ? ImVec4(1.0f, 0.3f, 0.3f, 1.0f) : ImGui::GetStyleColorVec4(ImGuiCol_Text);
+
+      ImGui::TableNextColumn();
+      ImGui::TextColored(color, "%s", stats._name.c_str());
+      ImGui::TableNextColumn();
+      ImGui::TextColored(color, "%.2f", stats._current);
+      ImGui::TableNextColumn();
+      ImGui::Text("%.2f", stats._p50);
+      ImGui::TableNextColumn();
+      ImGui::Text("%.2f", stats._p95);
+      ImGui::TableNextColumn();
+      ImGui::Text("%.2f", stats._p99);
+      ImGui::TableNextColumn();
+      if (stats._budget > 0.0) {
+        ImGui::Text("%.2f (%zu over)", stats._budget, stats._numExceeded);
+      }
+      else {
+        ImGui::Text("-");
+      }
+    }
+    ImGui::EndTable();
+  }
+
+  if (ImGui::Button("Dump telemetry CSV...")) {
+    NFD::UniquePath outPath;
+
+    nfdfilteritem_t filterItem[1] = { {"CSV", "csv"} };
+
+    auto result = NFD::SaveDialog(outPath, filterItem, 1, nullptr, "telemetry.csv");
+    if (result == NFD_OKAY) {
+      // History at the chosen path, statistics next to it
+      std::filesystem::path historyPath(outPath.get());
+      auto summaryPath = historyPath;
+      summaryPath.replace_filename(historyPath.stem().string() + "_summary.csv");
+
+      if (_telemetry.writeHistoryCsv(historyPath) && _telemetry.writeSummaryCsv(summaryPath)) {
+        printf("Wrote telemetry to %s and %s\n", historyPath.string().c_str(), summaryPath.string().c_str());
+      }
+    }
+  }
 }
 
 void AneditApplication::updateConfig()
@@ -383,6 +492,31 @@ void AneditApplication::oldUI()
     //ImGui::Checkbox("Run physics sim", &_physicsSystem.simulationRunning());
     ImGui::Checkbox("Draw physics debug", &_drawPhysicsDebug);
 
+    int tickRate = (int)(_physicsSystem.tickRate() + 0.5);
+    if (ImGui::SliderInt("Physics tick rate", &tickRate, 10, 240)) {
+      _physicsSystem.setTickRate((double)tickRate);
+    }
+    int maxTicks = (int)_physicsSystem.maxTicksPerUpdate();
+    if (ImGui::SliderInt("Max physics ticks per frame", &maxTicks, 1, 16)) {
+      _physicsSystem.setMaxTicksPerUpdate((unsigned)maxTicks);
+    }
+
+    if (_physicsSystem.isRecording()) {
+      if (ImGui::Button("Stop physics recording")) {
+        _physicsSystem.stopRecording();
+      }
+    }
+    else if (ImGui::Button("Record physics...")) {
+      NFD::UniquePath outPath;
+
+      nfdfilteritem_t filterItem[1] = { {"Physics recording", "physrec"} };
+
+      auto result = NFD::SaveDialog(outPath, filterItem, 1, nullptr, "capture.physrec");
+      if (result == NFD_OKAY) {
+        _physicsSystem.startRecording(outPath.get());
+      }
+    }
+
     // Test physics sphere
     if (ImGui::Button("Debug sphere")) {
       _physicsSystem.debugSphere();
@@ -403,6 +537,10 @@ void AneditApplication::oldUI()
     ImGui::Checkbox("Visualize bounding spheres", &_renderOptions.visualizeBoundingSpheres);
     ImGui::Checkbox("Debug probes", &_renderOptions.probesDebug);
     ImGui::Checkbox("Hack", &_renderOptions.hack);
+    ImGui::Checkbox("Transfer queue uploads", &_renderOptions.transferQueueUploads);
+    ImGui::SliderFloat("Upload bandwidth (MB/s)", &_renderOptions.uploadBandwidthMBps, 16.0f, 4096.0f);
+    ImGui::Checkbox("Texture streaming", &_renderOptions.textureStreaming);
+    ImGui::SliderFloat("Texture streaming budget (MB)", &_renderOptions.textureStreamingBudgetMB, 64.0f, 4096.0f);
     ImGui::SliderFloat("Sun intensity", &_renderOptions.sunIntensity, 0.0f, 200.0f);
     ImGui::SliderFloat("Sky intensity", &_renderOptions.skyIntensity, 0.0f, 20.0f);
     ImGui::SliderFloat("Exposure", &_renderOptions.exposure, 0.0f, 5.0f);
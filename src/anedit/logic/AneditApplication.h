@@ -20,9 +20,11 @@
 #include <render/scene/ScenePager.h>
 #include <render/cinematic/CinematicPlayer.h>
 #include <render/animation/AnimationUpdater.h>
+#include <render/scene/SignificanceManager.h>
 #include <physics/PhysicsSystem.h>
 #include <terrain/TerrainSystem.h>
 #include <behaviour/BehaviourSystem.h>
+#include <util/Telemetry.h>
 #include "WindSystem.h"
 
 #include <filesystem>
@@ -93,6 +95,9 @@ private:
   void updateCamera(double delta);
   void findCameraNode();
   void registerBehaviours();
+  void setupTelemetry();
+  void updateTelemetry(double delta);
+  void telemetryUI();
 
   // Keep track of which state we're in. This controls what systems get updated each frame.
   enum class State
@@ -131,6 +136,7 @@ private:
   std::future<render::scene::DeserialisedSceneData> _sceneFut;
   render::scene::ScenePager _scenePager;
 
+  render::scene::SignificanceManager _significance;
   render::anim::AnimationUpdater _animUpdater;
   terrain::TerrainSystem _terrainSystem;
   physics::PhysicsSystem _physicsSystem;
@@ -138,6 +144,9 @@ private:
 
   glm::vec3 _latestWorldPosition = glm::vec3(0.0f);
 
+  // Frame time and capacity gauges, see updateTelemetry()
+  util::Telemetry _telemetry;
+
   bool _drawPhysicsDebug = true;
 
   // Test bake
@@ -6,6 +6,8 @@
 #include "../../common/input/MousePosInput.h"
 #include "../../common/input/MouseButtonInput.h"
 
+#include <util/Profiler.h>
+
 #include <iostream>
 #include <string>
 
@@ -40,20 +42,35 @@ void Application::run()
 
   _running = true;
 
+  ANEREND_PROFILE_THREAD("Main");
+
   // Main loop
   double lastUpdate = glfwGetTime();
   double lastFrameUpdate = glfwGetTime();
   while (_running  && !glfwWindowShouldClose(_window)) {
+    ANEREND_PROFILE_FRAME();
+
     // Logic update
-    glfwPollEvents();
+    {
+      ANEREND_PROFILE_SCOPE("Poll events");
+      glfwPollEvents();
+    }
 
     double now = glfwGetTime();
     double delta = (now - lastUpdate);
     lastUpdate = now;
-    update(delta);
+    ANEREND_PROFILE_COUNTER("Frame time (ms)", delta * 1000.0);
+
+    {
+      ANEREND_PROFILE_SCOPE("Update");
+      update(delta);
+    }
 
     // Render
-    render();
+    {
+      ANEREND_PROFILE_SCOPE("Render");
+      render();
+    }
 
     // Render stop
 
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <entt/entt.hpp>
+
+#include <algorithm>
+#include <vector>
+
+namespace behaviour {
+
+/*
+* The components a behaviour touches, declared in IBehaviour::declareAccess.
+* write<T>: T is modified, but only on the behaviour's own node.
+* read<T>: T is read on other nodes. Components on the own node can always be read.
+* Behaviours whose access doesn't conflict are updated in parallel. Anything that isn't a plain read or write
+* of a declared component (observers, adding/removing components or nodes) goes through BehaviourCommands.
+*/
+class BehaviourAccess
+{
+public:
+  template <typename T>
+  BehaviourAccess& read()
+  {
+    add<T>(_reads);
+    return *this;
+  }
+
+  template <typename T>
+  BehaviourAccess& write()
+  {
+    add<T>(_writes);
+    return *this;
+  }
+
+  // One writes what the other reads
+  bool conflictsWith(const BehaviourAccess& other) const
+  {
+    return intersects(_reads, other._writes) || intersects(_writes, other._reads);
+  }
+
+  // Instances of a behaviour that reads what it writes can't run in parallel with each other
+  bool conflictsWithItself() const
+  {
+    return conflictsWith(*this);
+  }
+
+  // Creates the storage of every declared component, so that parallel lookups never have to
+  void prepare(entt::registry& registry) const
+  {
+    for (auto prepareFcn : _prepareFcns) {
+      prepareFcn(registry);
+    }
+  }
+
+private:
+  typedef void (*PrepareFcn)(entt::registry&);
+
+  template <typename T>
+  void add(std::vector<entt::id_type>& ids)
+  {
+    ids.emplace_back(entt::type_hash<T>::value());
+    _prepareFcns.emplace_back([](entt::registry& registry) { registry.storage<T>(); });
+  }
+
+  static bool intersects(const std::vector<entt::id_type>& a, const std::vector<entt::id_type>& b)
+  {
+    return std::any_of(a.begin(), a.end(), [&b](entt::id_type id) {
+      return std::find(b.begin(), b.end(), id) != b.end();
+    });
+  }
+
+  std::vector<entt::id_type> _reads;
+  std::vector<entt::id_type> _writes;
+  std::vector<PrepareFcn> _prepareFcns;
+};
+
+}
@@ -0,0 +1,21 @@
+#include "BehaviourCommands.h"
+
+#include "../render/scene/Scene.h"
+
+namespace behaviour {
+
+void BehaviourCommands::apply(render::scene::Scene& scene)
+{
+  for (auto& command : _commands) {
+    if (command._patchFcn) {
+      command._patchFcn(scene.registry(), command._node);
+    }
+    else {
+      command._fcn(scene);
+    }
+  }
+
+  _commands.clear();
+}
+
+}
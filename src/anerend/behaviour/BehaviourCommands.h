@@ -0,0 +1,65 @@
+#pragma once
+
+#include "../util/Uuid.h"
+#include "../component/Registry.h"
+
+#include <functional>
+#include <vector>
+
+namespace render::scene { class Scene; }
+
+namespace behaviour {
+
+/*
+* Changes that can't be made while behaviours update in parallel, recorded to be applied at the next sync point.
+* Applied in the order they were added. Main thread behaviours get one aswell, applied right after they updated.
+*/
+class BehaviourCommands
+{
+public:
+  typedef std::function<void(render::scene::Scene&)> CommandFcn;
+
+  // Lets observers know that T changed on node, the change itself is made directly
+  template <typename T>
+  void patch(const util::Uuid& node)
+  {
+    Command command{};
+    command._node = node;
+    command._patchFcn = &patchFcn<T>;
+    _commands.emplace_back(std::move(command));
+  }
+
+  // Anything else, like adding or removing components and nodes
+  void defer(CommandFcn fcn)
+  {
+    Command command{};
+    command._fcn = std::move(fcn);
+    _commands.emplace_back(std::move(command));
+  }
+
+  void apply(render::scene::Scene& scene);
+
+  bool empty() const { return _commands.empty(); }
+  std::size_t size() const { return _commands.size(); }
+
+private:
+  typedef void (*PatchFcn)(component::Registry&, const util::Uuid&);
+
+  // Patches are by far the most common, so they don't go through a std::function
+  struct Command
+  {
+    util::Uuid _node;
+    PatchFcn _patchFcn = nullptr;
+    CommandFcn _fcn;
+  };
+
+  template <typename T>
+  static void patchFcn(component::Registry& registry, const util::Uuid& node)
+  {
+    registry.patchComponent<T>(node);
+  }
+
+  std::vector<Command> _commands;
+};
+
+}
@@ -15,4 +15,19 @@ void BehaviourHelper::setMe(IBehaviour* behaviour, const util::Uuid& me)
   behaviour->_me = me;
 }
 
+void BehaviourHelper::setPhysics(IBehaviour* behaviour, physics::PhysicsSystem* physics)
+{
+  behaviour->_physics = physics;
+}
+
+void BehaviourHelper::setEntity(IBehaviour* behaviour, entt::entity entity)
+{
+  behaviour->_entity = entity;
+}
+
+void BehaviourHelper::setCommands(IBehaviour* behaviour, BehaviourCommands* commands)
+{
+  behaviour->_commands = commands;
+}
+
 }
\ No newline at end of file
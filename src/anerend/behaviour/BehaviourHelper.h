@@ -2,17 +2,24 @@
 
 #include "../util/Uuid.h"
 
+#include <entt/entt.hpp>
+
 namespace render::scene { class Scene; }
+namespace physics { class PhysicsSystem; }
 
 namespace behaviour {
 
 class IBehaviour;
+class BehaviourCommands;
 
 class BehaviourHelper
 {
 public:
   static void setScene(IBehaviour* behaviour, render::scene::Scene* scene);
   static void setMe(IBehaviour* behaviour, const util::Uuid& me);
+  static void setPhysics(IBehaviour* behaviour, physics::PhysicsSystem* physics);
+  static void setEntity(IBehaviour* behaviour, entt::entity entity);
+  static void setCommands(IBehaviour* behaviour, BehaviourCommands* commands);
 };
 
 }
\ No newline at end of file
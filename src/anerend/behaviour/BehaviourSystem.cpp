@@ -5,17 +5,14 @@
 
 #include "../component/Components.h"
 #include "../component/Registry.h"
+#include "../util/Profiler.h"
 
-namespace behaviour {
-
-BehaviourSystem::~BehaviourSystem()
-{
-  for (auto behaviour : _behaviours) {
-    delete behaviour;
-  }
+#include <algorithm>
+#include <chrono>
+#include <execution>
+#include <numeric>
 
-  _behaviours.clear();
-}
+namespace behaviour {
 
 void BehaviourSystem::registerBehaviour(const std::string& name, BehaviourCreateFcn createFcn)
 {
@@ -24,6 +21,8 @@ void BehaviourSystem::registerBehaviour(const std::string& name, BehaviourCreate
 
 void BehaviourSystem::update(double delta)
 {
+  ANEREND_PROFILE_SCOPE("BehaviourSystem::update");
+
   // Check observer and see if we need to create a new behaviour.
   if (_goThroughAll) {
     auto view = _registry->getEnttRegistry().view<component::Behaviour>();
@@ -45,9 +44,33 @@ void BehaviourSystem::update(double delta)
     }
   }
 
-  // Go through and update the active behaviours.
-  for (auto behaviour : _behaviours) {
-    behaviour->update(delta);
+  if (_batchesDirty) {
+    rebuildBatches();
+  }
+
+  auto start = std::chrono::steady_clock::now();
+
+  // Main thread behaviours first, one at a time. Indexing since they may create or destroy behaviours directly.
+  for (auto typeIdx : _mainThreadTypes) {
+    for (std::size_t i = 0; i < _types[typeIdx]._instances.size(); ++i) {
+      double behaviourDelta = delta;
+      if (!due(_types[typeIdx]._slots[i], delta, behaviourDelta)) {
+        continue;
+      }
+
+      auto* behaviour = _types[typeIdx]._instances[i];
+      BehaviourHelper::setCommands(behaviour, &_mainThreadCommands);
+      behaviour->update(behaviourDelta);
+    }
+  }
+  _mainThreadCommands.apply(*_scene);
+
+  for (auto& batch : _batches) {
+    updateBatch(batch, delta);
+  }
+
+  if (_significance) {
+    _significance->addCost(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
   }
 
   _observer.clear();
@@ -66,58 +89,251 @@ void BehaviourSystem::setRegistry(component::Registry* registry)
   _registry->getEnttRegistry().on_construct<component::Behaviour>().connect<&BehaviourSystem::onBehaviourCreated>(this);
 
   _goThroughAll = true;
+  _batchesDirty = true; // Component storages have to be prepared in the new registry
 }
 
 void BehaviourSystem::setScene(render::scene::Scene* scene)
 {
   _scene = scene;
 
-  for (auto behaviour : _behaviours) {
-    BehaviourHelper::setScene(behaviour, scene);
+  for (auto& slot : _slots) {
+    if (slot._behaviour) {
+      BehaviourHelper::setScene(slot._behaviour.get(), scene);
+    }
   }
 }
 
-bool BehaviourSystem::isKnown(const util::Uuid& id) const
+void BehaviourSystem::setPhysicsSystem(physics::PhysicsSystem* physics)
+{
+  _physics = physics;
+
+  for (auto& slot : _slots) {
+    if (slot._behaviour) {
+      BehaviourHelper::setPhysics(slot._behaviour.get(), physics);
+    }
+  }
+}
+
+BehaviourHandle BehaviourSystem::handle(const util::Uuid& node) const
+{
+  auto it = _handles.find(node);
+  if (it == _handles.end()) {
+    return BehaviourHandle{};
+  }
+
+  return it->second;
+}
+
+IBehaviour* BehaviourSystem::get(BehaviourHandle handle) const
 {
-  auto it = std::find_if(_behaviours.begin(), _behaviours.end(), [&id](IBehaviour* behaviour) {
-    return behaviour->me() == id;
-  });
+  if (!handle || handle._index >= _slots.size() || _slots[handle._index]._generation != handle._generation) {
+    return nullptr;
+  }
+
+  return _slots[handle._index]._behaviour.get();
+}
 
-  return it != _behaviours.end();
+void BehaviourSystem::setChunkSize(std::size_t chunkSize)
+{
+  _chunkSize = std::max(chunkSize, (std::size_t)1);
+}
+
+bool BehaviourSystem::isKnown(const util::Uuid& id) const
+{
+  return _handles.find(id) != _handles.end();
 }
 
 void BehaviourSystem::onBehaviourDestroyed(entt::registry& reg, entt::entity ent)
 {
   auto id = _registry->reverseLookup(ent);
-  auto it = std::find_if(_behaviours.begin(), _behaviours.end(), [&id](IBehaviour* behaviour) {
-    return behaviour->me() == id;
-  });
-
-  if (it != _behaviours.end()) {
-    delete *it;
-    _behaviours.erase(it);
+  auto it = _handles.find(id);
+  if (it == _handles.end()) {
+    return;
   }
+
+  auto index = it->second._index;
+  _handles.erase(it);
+
+  auto& slot = _slots[index];
+  auto& type = _types[slot._type];
+
+  // Swap-remove from the type
+  auto dense = slot._denseIndex;
+  type._instances[dense] = type._instances.back();
+  type._slots[dense] = type._slots.back();
+  _slots[type._slots[dense]]._denseIndex = dense;
+  type._instances.pop_back();
+  type._slots.pop_back();
+
+  // Deleted last, in case the destructor does something to the system
+  auto behaviour = std::move(slot._behaviour);
+  slot._generation++;
+  _freeSlots.emplace_back(index);
 }
 
 void BehaviourSystem::onBehaviourCreated(entt::registry& reg, entt::entity ent)
 {
   auto id = _registry->reverseLookup(ent);
-  if (!isKnown(id)) {
-    // Create a new behaviour and start it.
-    auto& behComp = _registry->getComponent<component::Behaviour>(id);
+  if (isKnown(id)) {
+    return;
+  }
 
-    if (!_behaviourFactory.contains(behComp._name)) {
-      printf("Could not find behaviour with name %s!\n", behComp._name.c_str());
-      return;
+  // Create a new behaviour and start it.
+  auto& behComp = _registry->getComponent<component::Behaviour>(id);
+
+  auto factoryIt = _behaviourFactory.find(behComp._name);
+  if (factoryIt == _behaviourFactory.end()) {
+    printf("Could not find behaviour with name %s!\n", behComp._name.c_str());
+    return;
+  }
+
+  auto behaviour = factoryIt->second();
+  BehaviourHelper::setMe(behaviour, id);
+  BehaviourHelper::setEntity(behaviour, ent);
+  BehaviourHelper::setScene(behaviour, _scene);
+  BehaviourHelper::setPhysics(behaviour, _physics);
+
+  auto typeIdx = typeIndex(behComp._name);
+  auto& type = _types[typeIdx];
+  if (!type._accessKnown) {
+    type._accessKnown = true;
+    type._parallel = behaviour->declareAccess(type._access);
+
+    if (type._parallel && type._access.conflictsWithItself()) {
+      printf("Behaviour %s reads a component it writes, it will update on the main thread\n", type._name.c_str());
+      type._parallel = false;
     }
+    _batchesDirty = true;
+  }
+
+  std::uint32_t slotIdx = 0;
+  if (!_freeSlots.empty()) {
+    slotIdx = _freeSlots.back();
+    _freeSlots.pop_back();
+  }
+  else {
+    slotIdx = (std::uint32_t)_slots.size();
+    _slots.emplace_back();
+  }
+
+  auto& slot = _slots[slotIdx];
+  slot._behaviour.reset(behaviour);
+  slot._type = typeIdx;
+  slot._denseIndex = (std::uint32_t)type._instances.size();
+  slot._entity = ent;
+  slot._throttle = render::scene::ThrottleState{};
+  type._instances.emplace_back(behaviour);
+  type._slots.emplace_back(slotIdx);
+  _handles[id] = BehaviourHandle{ slotIdx, slot._generation };
 
-    auto behaviour = _behaviourFactory[behComp._name]();
-    BehaviourHelper::setMe(behaviour, id);
-    BehaviourHelper::setScene(behaviour, _scene);
+  // Last, it may create more behaviours
+  behaviour->start();
+}
 
-    behaviour->start();
+std::uint32_t BehaviourSystem::typeIndex(const std::string& name)
+{
+  auto it = _typeIndices.find(name);
+  if (it != _typeIndices.end()) {
+    return it->second;
+  }
+
+  auto index = (std::uint32_t)_types.size();
+  _types.emplace_back();
+  _types.back()._name = name;
+  _typeIndices[name] = index;
+  return index;
+}
+
+void BehaviourSystem::rebuildBatches()
+{
+  _mainThreadTypes.clear();
+  _batches.clear();
+
+  for (std::uint32_t typeIdx = 0; typeIdx < (std::uint32_t)_types.size(); ++typeIdx) {
+    auto& type = _types[typeIdx];
+    if (!type._parallel) {
+      _mainThreadTypes.emplace_back(typeIdx);
+      continue;
+    }
+
+    type._access.prepare(_registry->getEnttRegistry());
+
+    // Into the first batch without anything it conflicts with
+    auto batchIt = std::find_if(_batches.begin(), _batches.end(), [this, &type](const std::vector<std::uint32_t>& batch) {
+      return std::none_of(batch.begin(), batch.end(), [this, &type](std::uint32_t other) {
+        return type._access.conflictsWith(_types[other]._access);
+      });
+    });
+
+    if (batchIt != _batches.end()) {
+      batchIt->emplace_back(typeIdx);
+    }
+    else {
+      _batches.emplace_back(1, typeIdx);
+    }
+  }
+
+  _batchesDirty = false;
+}
+
+bool BehaviourSystem::due(std::uint32_t slot, double delta, double& behaviourDelta)
+{
+  if (!_significance) {
+    behaviourDelta = delta;
+    return true;
+  }
+
+  auto& s = _slots[slot];
+  return _significance->due(s._entity, s._throttle, behaviourDelta);
+}
+
+void BehaviourSystem::updateBatch(const std::vector<std::uint32_t>& batch, double delta)
+{
+  // Only the ones that are due, so that the chunks are even
+  _batchInstances.clear();
+  _batchDeltas.clear();
+  for (auto typeIdx : batch) {
+    auto& type = _types[typeIdx];
+    for (std::size_t i = 0; i < type._instances.size(); ++i) {
+      double behaviourDelta = delta;
+      if (due(type._slots[i], delta, behaviourDelta)) {
+        _batchInstances.emplace_back(type._instances[i]);
+        _batchDeltas.emplace_back(behaviourDelta);
+      }
+    }
+  }
+
+  if (_batchInstances.empty()) {
+    return;
+  }
+
+  ANEREND_PROFILE_SCOPE("BehaviourSystem::updateBatch");
+
+  // Each chunk records into its own commands, so that they are applied in the same order every time
+  auto numChunks = (_batchInstances.size() + _chunkSize - 1) / _chunkSize;
+  if (_chunkCommands.size() < numChunks) {
+    _chunkCommands.resize(numChunks);
+  }
+  _chunks.resize(numChunks);
+  std::iota(_chunks.begin(), _chunks.end(), (std::size_t)0);
+
+  std::for_each(
+    std::execution::par,
+    _chunks.begin(),
+    _chunks.end(),
+    [this](std::size_t chunk) {
+      auto begin = chunk * _chunkSize;
+      auto end = std::min(begin + _chunkSize, _batchInstances.size());
+      for (auto i = begin; i < end; ++i) {
+        BehaviourHelper::setCommands(_batchInstances[i], &_chunkCommands[chunk]);
+        _batchInstances[i]->update(_batchDeltas[i]);
+      }
+    }
+  );
 
-    _behaviours.emplace_back(behaviour);
+  // Sync point
+  for (std::size_t chunk = 0; chunk < numChunks; ++chunk) {
+    _chunkCommands[chunk].apply(*_scene);
   }
 }
 
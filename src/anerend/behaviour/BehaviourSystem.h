@@ -1,27 +1,49 @@
 #pragma once
 
+#include "IBehaviour.h"
+#include "BehaviourAccess.h"
+#include "BehaviourCommands.h"
+#include "../render/scene/SignificanceManager.h"
+
 #include <entt/entt.hpp>
 
+#include <cstdint>
 #include <string>
 #include <unordered_map>
 #include <functional>
+#include <memory>
 #include <vector>
 
 namespace render::scene { class Scene; }
 namespace component { class Registry; }
+namespace physics { class PhysicsSystem; }
 namespace util { class Uuid; }
 
 namespace behaviour {
 
-class IBehaviour;
-
 typedef std::function<IBehaviour* ()> BehaviourCreateFcn;
 
+// Refers to a behaviour in the BehaviourSystem. Handles of destroyed behaviours resolve to nothing, even if the slot is reused.
+struct BehaviourHandle
+{
+  std::uint32_t _index = UINT32_MAX;
+  std::uint32_t _generation = 0;
+
+  explicit operator bool() const { return _index != UINT32_MAX; }
+};
+
+/*
+* Creates a behaviour for every node with a Behaviour component, and updates them.
+* Behaviours are grouped by name. Those that don't declare their access (see IBehaviour::declareAccess) update
+* one at a time on the main thread first. The rest go in batches of names whose access doesn't conflict,
+* where every behaviour of a batch updates in parallel. The commands they record are applied after each batch.
+* With a SignificanceManager, behaviours that aren't due skip the frame and get the accumulated delta later.
+*/
 class BehaviourSystem
 {
 public:
   BehaviourSystem() = default;
-  ~BehaviourSystem();
+  ~BehaviourSystem() = default;
 
   BehaviourSystem(const BehaviourSystem&) = delete;
   BehaviourSystem(BehaviourSystem&&) = delete;
@@ -35,23 +57,83 @@ public:
 
   void setRegistry(component::Registry* registry);
   void setScene(render::scene::Scene* scene);
+  void setPhysicsSystem(physics::PhysicsSystem* physics);
+  // Without one every behaviour updates every frame
+  void setSignificanceManager(render::scene::SignificanceManager* significance) { _significance = significance; }
+
+  // Invalid handle if the node has no behaviour
+  BehaviourHandle handle(const util::Uuid& node) const;
+  // nullptr for stale handles
+  IBehaviour* get(BehaviourHandle handle) const;
+  std::size_t numBehaviours() const { return _handles.size(); }
+
+  // Parallel behaviours are updated in chunks of this many, each with its own commands
+  void setChunkSize(std::size_t chunkSize);
 
 private:
+  struct Slot
+  {
+    std::unique_ptr<IBehaviour> _behaviour; // Null if free
+    std::uint32_t _generation = 0;
+    std::uint32_t _type = 0;
+    std::uint32_t _denseIndex = 0; // In the type's _instances
+    entt::entity _entity = entt::null;
+    render::scene::ThrottleState _throttle;
+  };
+
+  // All behaviours with the same name, they share access
+  struct BehaviourType
+  {
+    std::string _name;
+    BehaviourAccess _access;
+    bool _accessKnown = false; // Asked from the first instance
+    bool _parallel = false;
+
+    // Dense, swap-removed
+    std::vector<IBehaviour*> _instances;
+    std::vector<std::uint32_t> _slots;
+  };
+
   component::Registry* _registry = nullptr;
   render::scene::Scene* _scene = nullptr;
+  physics::PhysicsSystem* _physics = nullptr;
+  render::scene::SignificanceManager* _significance = nullptr;
 
   // All currently registered behaviours. The string corresponds to the name set in the behaviour component.
   std::unordered_map<std::string, BehaviourCreateFcn> _behaviourFactory;
 
+  std::vector<BehaviourType> _types;
+  std::unordered_map<std::string, std::uint32_t> _typeIndices;
+
   // Current active behaviours.
-  std::vector<IBehaviour*> _behaviours;
+  std::vector<Slot> _slots;
+  std::vector<std::uint32_t> _freeSlots;
+  std::unordered_map<util::Uuid, BehaviourHandle> _handles;
+
+  // Rebuilt when a new type shows up
+  std::vector<std::uint32_t> _mainThreadTypes;
+  std::vector<std::vector<std::uint32_t>> _batches;
+  bool _batchesDirty = false;
+
+  // Reused every update
+  std::vector<IBehaviour*> _batchInstances;
+  std::vector<double> _batchDeltas;
+  std::vector<std::size_t> _chunks;
+  std::vector<BehaviourCommands> _chunkCommands;
+  BehaviourCommands _mainThreadCommands;
+  std::size_t _chunkSize = 256;
 
   bool isKnown(const util::Uuid& id) const;
   void onBehaviourDestroyed(entt::registry& reg, entt::entity ent);
   void onBehaviourCreated(entt::registry& reg, entt::entity ent);
 
+  std::uint32_t typeIndex(const std::string& name);
+  void rebuildBatches();
+  void updateBatch(const std::vector<std::uint32_t>& batch, double delta);
+  bool due(std::uint32_t slot, double delta, double& behaviourDelta);
+
   entt::observer _observer;
   bool _goThroughAll = true;
 };
 
-}
\ No newline at end of file
+}
@@ -2,11 +2,16 @@
 
 #include "../util/Uuid.h"
 
+#include <entt/entt.hpp>
+
 namespace render::scene { class Scene; }
+namespace physics { class PhysicsSystem; }
 
 namespace behaviour {
 
 class BehaviourHelper;
+class BehaviourAccess;
+class BehaviourCommands;
 
 class IBehaviour
 {
@@ -16,16 +21,24 @@ public:
   // Called exactly once when the behaviour starts up.
   virtual void start() = 0;
 
-  // Called every frame from the main thread.
+  // Called every frame, or less often for insignificant nodes with delta the time since the last update.
+  // From the main thread, unless declareAccess says otherwise.
   virtual void update(double delta) = 0;
 
+  // Declaring the components touched in update lets behaviours that don't conflict update in parallel, see BehaviourAccess.
+  // Asked once per behaviour name. Returning false keeps the behaviour on the main thread, where anything goes.
+  virtual bool declareAccess(BehaviourAccess& access) const { return false; }
+
   virtual const util::Uuid& me() { return _me; }
 
 protected:
   friend class BehaviourHelper;
 
   util::Uuid _me;
+  entt::entity _entity = entt::null; // Of _me, lookups through it don't touch the registry's node maps
   render::scene::Scene* _scene;
+  physics::PhysicsSystem* _physics = nullptr; // For scene queries, main thread only
+  BehaviourCommands* _commands = nullptr; // Valid during update
 };
 
 }
\ No newline at end of file
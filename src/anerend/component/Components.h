@@ -187,12 +187,21 @@ struct CapsuleCollider
   float _radius = 0.3f;
 };
 
+// Collision for a terrain tile, built from the heightmap of the Terrain comp on the same node
+struct HeightfieldCollider
+{
+  std::uint8_t _blockSize = 4; // Samples per side of the blocks that the heightfield is divided into, 2-8
+  std::uint8_t _bitsPerSample = 8; // Precision of the compressed heights within a block, 1-8
+};
+
 struct CharacterController
 {
   glm::vec3 _desiredLinearVelocity = glm::vec3(0.0f);
   float _speed = 1.0f;
   float _jumpSpeed = 2.0f;
   float _mass = 80.0f;
+  float _maxStepHeight = 0.4f; // Highest step that is walked up
+  float _groundSnapDistance = 0.5f; // How far down the character sticks to the floor, when walking down slopes and steps
 };
 
 struct Camera
@@ -206,6 +215,24 @@ struct Behaviour
   std::string _name;
 };
 
+// Spawns particles at the node, simulated on the GPU. Velocities and gravity are in world space.
+struct ParticleEmitter
+{
+  std::uint32_t _maxParticles = 1000; // Reserved for the emitter, it never has more alive
+  float _spawnRate = 100.0f; // Per second
+  float _lifetime = 3.0f; // Seconds
+  float _spawnRadius = 0.0f;
+  glm::vec3 _minVelocity = glm::vec3(-1.0f, 4.0f, -1.0f);
+  glm::vec3 _maxVelocity = glm::vec3(1.0f, 8.0f, 1.0f);
+  float _minScale = 0.05f;
+  float _maxScale = 0.2f;
+  glm::vec3 _gravity = glm::vec3(0.0f, -9.82f, 0.0f);
+  bool _bounce = true; // Off the horizontal plane _groundOffset from the node
+  float _groundOffset = 0.0f;
+  float _restitution = 0.5f;
+  bool _enabled = true; // Disabled emitters stop spawning, alive particles live out their lifetime
+};
+
 // Struct that holds potential components used by e.g. prefabs
 struct PotentialComponents
 {
@@ -223,6 +250,8 @@ struct PotentialComponents
   std::optional<CharacterController> _charCon;
   std::optional<Camera> _cam;
   std::optional<Behaviour> _behaviour;
+  std::optional<HeightfieldCollider> _heightfieldColl;
+  std::optional<ParticleEmitter> _particleEmitter;
 };
 
 /* Helper function for executing something for every potential component optional
@@ -253,6 +282,8 @@ void forEachPotCompOpt(F func, PotentialComponents& potComps)
   func(potComps._charCon);
   func(potComps._cam);
   func(potComps._behaviour);
+  func(potComps._heightfieldColl);
+  func(potComps._particleEmitter);
 }
 
 /* Helper function for executing something for every potential component that has a value
@@ -125,6 +125,16 @@ public:
     return util::Uuid();
   }
 
+  entt::entity lookup(const util::Uuid& node) const
+  {
+    auto it = _nodeMap.find(node);
+    if (it != _nodeMap.end()) {
+      return it->second;
+    }
+
+    return entt::null;
+  }
+
   entt::registry& getEnttRegistry() { return _registry; }
 
 private:
@@ -1,6 +1,7 @@
 #include "PhysicsJoltImpl.h"
 
 #include "../util/TransformHelpers.h"
+#include "../util/Profiler.h"
 
 #include <Jolt/RegisterTypes.h>
 #include <Jolt/Core/Factory.h>
@@ -10,18 +11,118 @@
 #include <Jolt/Physics/Collision/Shape/SphereShape.h>
 #include <Jolt/Physics/Collision/Shape/BoxShape.h>
 #include <Jolt/Physics/Collision/Shape/CapsuleShape.h>
+#include <Jolt/Physics/Collision/Shape/ScaledShape.h>
+#include <Jolt/Core/StreamWrapper.h>
 #include <Jolt/Physics/Body/BodyCreationSettings.h>
+#include <Jolt/Physics/Body/BodyLock.h>
+#include <Jolt/Physics/Body/BodyLockMulti.h>
+#include <Jolt/Physics/Collision/RayCast.h>
+#include <Jolt/Physics/Collision/CastResult.h>
+#include <Jolt/Physics/Collision/ShapeCast.h>
+#include <Jolt/Physics/Collision/CollideShape.h>
+#include <Jolt/Physics/Collision/CollisionCollectorImpl.h>
 
 #include <glm/gtx/matrix_decompose.hpp>
 #include <glm/gtc/quaternion.hpp>
 #include <glm/gtx/quaternion.hpp>
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <mutex>
+#include <sstream>
 #include <thread>
 
+#ifdef JPH_EXTERNAL_PROFILE
+// Jolt's JPH_PROFILE zones, including those on the job system threads, go to the engine profiler
+namespace JPH {
+
+struct ProfileMeasurementData
+{
+	const char* _name;
+	std::int64_t _startNs;
+};
+static_assert(sizeof(ProfileMeasurementData) <= 64, "Doesn't fit ExternalProfileMeasurement::mUserData");
+
+ExternalProfileMeasurement::ExternalProfileMeasurement(const char* inName, uint32 inColor)
+{
+	auto* data = reinterpret_cast<ProfileMeasurementData*>(mUserData);
+	data->_name = inName;
+	data->_startNs = util::Profiler::enabled() ? util::Profiler::nowNs() : -1;
+}
+
+ExternalProfileMeasurement::~ExternalProfileMeasurement()
+{
+	auto* data = reinterpret_cast<ProfileMeasurementData*>(mUserData);
+	if (data->_startNs >= 0) {
+		util::Profiler::zone(data->_name, data->_startNs, util::Profiler::nowNs());
+	}
+}
+
+}
+#endif
+
 namespace physics {
 
 namespace {
 
+// Queries per parallelFor chunk
+constexpr std::size_t g_QueryChunkSize = 256;
+
+static_assert(QueryLayerStatic == 1 << Layers::NON_MOVING && QueryLayerMoving == 1 << Layers::MOVING, "Query layers must match object layers");
+
+// Object and broadphase layers map 1-to-1, so a QueryLayer mask works for both
+class QueryBroadPhaseLayerFilter : public JPH::BroadPhaseLayerFilter
+{
+public:
+	explicit QueryBroadPhaseLayerFilter(std::uint8_t layerMask) : _layerMask(layerMask) {}
+
+	virtual bool ShouldCollide(JPH::BroadPhaseLayer inLayer) const override
+	{
+		return (_layerMask & (1 << (JPH::BroadPhaseLayer::Type)inLayer)) != 0;
+	}
+
+private:
+	std::uint8_t _layerMask;
+};
+
+class QueryObjectLayerFilter : public JPH::ObjectLayerFilter
+{
+public:
+	explicit QueryObjectLayerFilter(std::uint8_t layerMask) : _layerMask(layerMask) {}
+
+	virtual bool ShouldCollide(JPH::ObjectLayer inLayer) const override
+	{
+		return (_layerMask & (1 << inLayer)) != 0;
+	}
+
+private:
+	std::uint8_t _layerMask;
+};
+
+// Calls func with the shape, which lives on the stack so that queries don't allocate
+template <typename F>
+void withQueryShape(const QueryShape& queryShape, F func)
+{
+	if (queryShape._type == QueryShape::Box) {
+		auto& he = queryShape._halfExtent;
+		float convexRadius = std::min(JPH::cDefaultConvexRadius, std::min(he.x, std::min(he.y, he.z)));
+		JPH::BoxShape box(JPH::Vec3(he.x, he.y, he.z), convexRadius);
+		box.SetEmbedded();
+		func(box);
+	}
+	else {
+		JPH::SphereShape sphere(queryShape._radius);
+		sphere.SetEmbedded();
+		func(sphere);
+	}
+}
+
+glm::vec3 jphVecToGlm(JPH::RVec3Arg v)
+{
+	return glm::vec3((float)v.GetX(), (float)v.GetY(), (float)v.GetZ());
+}
+
 glm::mat4 jphMatToGlm(JPH::RMat44Arg jph)
 {
 	glm::mat4 glmMat(1.0f);
@@ -33,6 +134,19 @@ glm::mat4 jphMatToGlm(JPH::RMat44Arg jph)
 	return glmMat;
 }
 
+glm::quat jphQuatToGlm(JPH::QuatArg q)
+{
+	return glm::quat(q.GetW(), q.GetX(), q.GetY(), q.GetZ());
+}
+
+RecordedOp recordedOp(RecordedOp::Type type, const util::Uuid& node = util::Uuid())
+{
+	RecordedOp op{};
+	op._type = type;
+	op._node = node;
+	return op;
+}
+
 // Return [quat, trans]
 std::tuple<JPH::Quat, JPH::RVec3> glmToJPHRotTrans(const glm::mat4& transform)
 {
@@ -72,32 +186,47 @@ void fillInBodySettings(
 
 }
 
+bool CharacterContactListenerImpl::OnContactValidate(const JPH::CharacterVirtual* inCharacter, const JPH::BodyID& inBodyID2, const JPH::SubShapeID& inSubShapeID2)
+{
+	// Never collide with our own inner body
+	return inCharacter->GetInnerBodyID() != inBodyID2;
+}
+
+void CharacterContactListenerImpl::OnContactAdded(const JPH::CharacterVirtual* inCharacter, const JPH::BodyID& inBodyID2, const JPH::SubShapeID& inSubShapeID2, JPH::RVec3Arg inContactPosition, JPH::Vec3Arg inContactNormal, JPH::CharacterContactSettings& ioSettings)
+{
+	// Other characters are solid, but their inner bodies are kinematic and can't be pushed around
+	if (_impl->isCharacterBody(inBodyID2)) {
+		ioSettings.mCanPushCharacter = true;
+		ioSettings.mCanReceiveImpulses = false;
+	}
+}
+
 PhysicsJoltImpl::PhysicsJoltImpl()
-	: _tempAllocator(nullptr)
+	: _charContactListener(this)
+	, _tempAllocator(nullptr)
 	, _jobSystem(nullptr)
 {
 }
 
 PhysicsJoltImpl::~PhysicsJoltImpl()
 {
-	for (auto& [_, character] : _charMap) {
-		character->RemoveFromPhysicsSystem();
-	}
-
-	_charMap.clear();
+	// Characters remove their inner bodies, so they have to go before the physics system
+	_characters.clear();
+	_charIndices.clear();
 
 	delete _tempAllocator;
 	delete _jobSystem;
-	JPH::UnregisterTypes();
-	delete JPH::Factory::sInstance;
-	JPH::Factory::sInstance = nullptr;
 }
 
 void PhysicsJoltImpl::staticInit()
 {
-	JPH::RegisterDefaultAllocator();
-	JPH::Factory::sInstance = new JPH::Factory();
-	JPH::RegisterTypes();
+	// Jolt's statics are global, several worlds (f.ex. a replay next to a PhysicsSystem) share them
+	static std::once_flag flag;
+	std::call_once(flag, []() {
+		JPH::RegisterDefaultAllocator();
+		JPH::Factory::sInstance = new JPH::Factory();
+		JPH::RegisterTypes();
+	});
 }
 
 void physics::PhysicsJoltImpl::init()
@@ -106,6 +235,10 @@ void physics::PhysicsJoltImpl::init()
 	_tempAllocator = new JPH::TempAllocatorImpl(10 * 1024 * 1024);
 	_jobSystem = new JPH::JobSystemThreadPool(JPH::cMaxPhysicsJobs, JPH::cMaxPhysicsBarriers, std::thread::hardware_concurrency() - 1);
 
+	for (unsigned i = 0; i < std::max(std::thread::hardware_concurrency(), 1u); ++i) {
+		_charTempAllocators.emplace_back(std::make_unique<JPH::TempAllocatorImpl>(1024 * 1024));
+	}
+
 	_physicsSystem.Init(_maxBodies, _numBodyMutexes, _maxBodyPairs, _maxContactConstraints, _broadPhaseLayerIF, _objectVsBroadPhaseLayerFilter, _objectVsObjectLayerFilter);
 
 	_physicsSystem.SetBodyActivationListener(&_activationListener);
@@ -114,24 +247,32 @@ void physics::PhysicsJoltImpl::init()
 
 void PhysicsJoltImpl::preUpdate(double delta)
 {
-	
+	if (_recording) {
+		auto op = recordedOp(RecordedOp::Tick);
+		op._delta = delta;
+		_recording->_ops.emplace_back(std::move(op));
+		_recording->_numTicks++;
+	}
+
+	updateCharacters((float)delta);
 }
 
 void PhysicsJoltImpl::update(double delta)
 {
+	ANEREND_PROFILE_SCOPE("Jolt PhysicsSystem::Update");
 	_physicsSystem.Update((float)delta, 1, _tempAllocator, _jobSystem);
 }
 
 void PhysicsJoltImpl::postUpdate(double delta)
 {
-	// TODO: Make cache efficient
-	for (auto& [_, character] : _charMap) {
-		character->PostSimulation(0.05f);
-	}
 }
 
 void PhysicsJoltImpl::resetVelocities()
 {
+	if (_recording) {
+		_recording->_ops.emplace_back(recordedOp(RecordedOp::ResetVelocities));
+	}
+
 	auto& bi = _physicsSystem.GetBodyInterface(); // locks
 	JPH::Vec3 zeroVec(0.0f, 0.0f, 0.0f);
 
@@ -139,48 +280,343 @@ void PhysicsJoltImpl::resetVelocities()
 		bi.SetLinearAndAngularVelocity(bodyId, zeroVec, zeroVec);
 	}
 
-	for (auto& [id, character] : _charMap) {
-		character->SetLinearAndAngularVelocity(zeroVec, zeroVec);
+	for (auto& c : _characters) {
+		c._character->SetLinearVelocity(zeroVec);
+		c._horizontalVelocity = zeroVec;
 	}
 }
 
-std::vector<TransformSyncInfo> PhysicsJoltImpl::retrieveCurrentTransforms()
+void PhysicsJoltImpl::captureTickPoses()
 {
-	std::vector<TransformSyncInfo> out;
+	ANEREND_PROFILE_SCOPE("PhysicsJoltImpl::captureTickPoses");
+
+	_numTicks++;
+
+	_activeBodies.clear();
+
+	// Characters move every tick, their poses go into the entries of their inner bodies
+	for (auto& c : _characters) {
+		auto bodyId = c._character->GetInnerBodyID();
+		auto& entry = _bodyTable[bodyId.GetIndex()];
+		entry._prevPos = entry._tickPos;
+		entry._prevRot = entry._tickRot;
+		entry._tickPos = c._character->GetPosition();
+		entry._tickRot = c._character->GetRotation();
+		entry._tick = _numTicks;
+		_activeBodies.emplace_back(bodyId);
+	}
 
-	// For now do a simple loop over all current bodies and retrieve their transforms.
-	// TODO: 
-	// - Cache-friendly structure, like a vector
-	// - parallell for loop
-	// - take a lambda that is executed for each transform instead of returning the sync struct
-	auto& bi = _physicsSystem.GetBodyInterface(); // locks
-	for (auto& [node, bodyId] : _bodyMap) {
+	// Sleeping bodies can't have moved, so only look at the active ones
+	auto numCharBodies = _activeBodies.size();
+	_physicsSystem.GetActiveBodies(JPH::EBodyType::RigidBody, _activeBodies);
+	if (_activeBodies.empty()) {
+		return;
+	}
+
+	if (_activeBodies.size() > numCharBodies) {
+		// One lock for the whole batch instead of one per body
+		JPH::BodyLockMultiRead lock(_physicsSystem.GetBodyLockInterface(), _activeBodies.data() + numCharBodies, (int)(_activeBodies.size() - numCharBodies));
+
+		parallelFor(_activeBodies.size() - numCharBodies, 512, [this, &lock, numCharBodies](std::size_t begin, std::size_t end) {
+			for (std::size_t i = begin; i < end; ++i) {
+				const JPH::Body* body = lock.GetBody((int)i);
+				if (!body) continue;
+
+				auto& bodyId = _activeBodies[numCharBodies + i];
+				auto index = bodyId.GetIndex();
+				if (index >= _bodyTable.size() || _bodyTable[index]._bodyId != bodyId) continue;
+
+				// Inner bodies of characters are already done
+				auto& entry = _bodyTable[index];
+				if (entry._character) continue;
+
+				// Different chunks never touch the same entry
+				entry._prevPos = entry._tickPos;
+				entry._prevRot = entry._tickRot;
+				entry._tickPos = body->GetCenterOfMassPosition();
+				entry._tickRot = body->GetRotation();
+				entry._tick = _numTicks;
+			}
+		});
+	}
+
+	for (auto& bodyId : _activeBodies) {
+		auto index = bodyId.GetIndex();
+		if (index < _bodyTable.size() && _bodyTable[index]._bodyId == bodyId && !_bodyTable[index]._pending) {
+			_bodyTable[index]._pending = true;
+			_pendingSync.emplace_back(index);
+		}
+	}
+
+	if (_recording && _recording->_poseInterval > 0 && _recording->_numTicks % _recording->_poseInterval == 0) {
+		RecordedPoseSample sample{};
+		sample._tick = _recording->_numTicks;
+		for (auto& bodyId : _activeBodies) {
+			auto index = bodyId.GetIndex();
+			if (index >= _bodyTable.size() || _bodyTable[index]._bodyId != bodyId) continue;
+
+			auto& entry = _bodyTable[index];
+			sample._poses.emplace_back(RecordedPose{ entry._node, jphVecToGlm(entry._tickPos), jphQuatToGlm(entry._tickRot) });
+		}
+		_recording->_poseSamples.emplace_back(std::move(sample));
+	}
+}
+
+void PhysicsJoltImpl::retrieveMovedTransforms(std::vector<TransformSyncInfo>& out, float alpha)
+{
+	ANEREND_PROFILE_SCOPE("PhysicsJoltImpl::retrieveMovedTransforms");
+
+	out.clear();
+	if (_pendingSync.empty()) {
+		return;
+	}
+
+	// Each chunk writes its moved bodies to the start of its own range of out, and they are compacted afterwards
+	const std::size_t chunkSize = 512;
+	const std::size_t numChunks = (_pendingSync.size() + chunkSize - 1) / chunkSize;
+	out.resize(_pendingSync.size());
+	_chunkMoved.assign(numChunks, 0);
+
+	parallelFor(_pendingSync.size(), chunkSize, [this, &out, alpha](std::size_t begin, std::size_t end) {
+		std::size_t numMoved = 0;
+
+		for (std::size_t i = begin; i < end; ++i) {
+			// Indices in _pendingSync are unique, so different chunks never touch the same entry
+			auto& entry = _bodyTable[_pendingSync[i]];
+			if (entry._bodyId.IsInvalid()) continue;
+
+			// Bodies that didn't tick last time have come to rest (or were removed from the simulation) at their tick pose
+			float t = entry._tick == _numTicks ? alpha : 1.0f;
+			JPH::RVec3 pos = entry._prevPos + (entry._tickPos - entry._prevPos) * t;
+			JPH::Quat rot = entry._prevRot.SLERP(entry._tickRot, t);
+
+			if (pos.IsClose(entry._lastPos, 1.0e-10f) && rot.IsClose(entry._lastRot, 1.0e-10f)) continue;
+
+			entry._lastPos = pos;
+			entry._lastRot = rot;
+
+			auto& syncInfo = out[begin + numMoved++];
+			syncInfo._node = entry._node;
+			syncInfo._userData = entry._userData;
+			syncInfo._global = jphMatToGlm(JPH::RMat44::sRotationTranslation(rot, pos));
+		}
+
+		_chunkMoved[begin / chunkSize] = numMoved;
+	});
+
+	std::size_t numOut = 0;
+	for (std::size_t chunk = 0; chunk < numChunks; ++chunk) {
+		auto begin = chunk * chunkSize;
+		if (numOut != begin) {
+			std::move(out.begin() + begin, out.begin() + begin + _chunkMoved[chunk], out.begin() + numOut);
+		}
+		numOut += _chunkMoved[chunk];
+	}
+	out.resize(numOut);
+
+	// Bodies that ticked last time need syncing next time as well, alpha will have changed
+	std::size_t numPending = 0;
+	for (auto index : _pendingSync) {
+		auto& entry = _bodyTable[index];
+		if (!entry._bodyId.IsInvalid() && entry._tick == _numTicks) {
+			_pendingSync[numPending++] = index;
+		}
+		else {
+			entry._pending = false;
+		}
+	}
+	_pendingSync.resize(numPending);
+}
+
+void PhysicsJoltImpl::parallelFor(std::size_t count, std::size_t chunkSize, const std::function<void(std::size_t, std::size_t)>& func)
+{
+	if (count <= chunkSize) {
+		func(0, count);
+		return;
+	}
+
+	JPH::JobSystem::Barrier* barrier = _jobSystem->CreateBarrier();
+
+	// Keep the last chunk for this thread, it would only be waiting otherwise
+	std::size_t begin = 0;
+	for (; begin + chunkSize < count; begin += chunkSize) {
+		auto handle = _jobSystem->CreateJob("PhysicsJoltImpl::parallelFor", JPH::Color::sGreen, [&func, begin, chunkSize]() {
+			func(begin, begin + chunkSize);
+		});
+		barrier->AddJob(handle);
+	}
+	func(begin, count);
+
+	_jobSystem->WaitForJobs(barrier);
+	_jobSystem->DestroyBarrier(barrier);
+}
+
+void PhysicsJoltImpl::castRays(const std::vector<RayQuery>& queries, std::vector<QueryHit>& results)
+{
+	ANEREND_PROFILE_SCOPE("PhysicsJoltImpl::castRays");
 
-		if (!bi.IsActive(bodyId)) continue;
+	if (queries.empty()) {
+		results.clear();
+		return;
+	}
 
-		TransformSyncInfo syncInfo{};
-		syncInfo._node = node;
+	results.resize(queries.size());
+	auto& narrowPhase = _physicsSystem.GetNarrowPhaseQuery();
+
+	parallelFor(queries.size(), g_QueryChunkSize, [&](std::size_t begin, std::size_t end) {
+		for (std::size_t i = begin; i < end; ++i) {
+			auto& q = queries[i];
+			auto& result = results[i];
+			result = QueryHit{};
+
+			JPH::RRayCast ray(JPH::RVec3(q._origin.x, q._origin.y, q._origin.z), JPH::Vec3(q._direction.x, q._direction.y, q._direction.z));
+			JPH::RayCastResult hit;
+			QueryBroadPhaseLayerFilter bpFilter(q._layerMask);
+			QueryObjectLayerFilter objFilter(q._layerMask);
+
+			if (!narrowPhase.CastRay(ray, hit, bpFilter, objFilter)) {
+				continue;
+			}
+
+			auto pos = ray.GetPointOnRay(hit.mFraction);
+			fillInHit(hit.mBodyID, result);
+			result._fraction = hit.mFraction;
+			result._position = jphVecToGlm(pos);
+
+			JPH::BodyLockRead lock(_physicsSystem.GetBodyLockInterface(), hit.mBodyID);
+			if (lock.Succeeded()) {
+				auto normal = lock.GetBody().GetWorldSpaceSurfaceNormal(hit.mSubShapeID2, pos);
+				result._normal = glm::vec3(normal.GetX(), normal.GetY(), normal.GetZ());
+			}
+		}
+	});
+}
 
-		auto transform = bi.GetCenterOfMassTransform(bodyId);
-		glm::mat4 glmMat = jphMatToGlm(transform);
+void PhysicsJoltImpl::castShapes(const std::vector<ShapeCastQuery>& queries, std::vector<QueryHit>& results)
+{
+	ANEREND_PROFILE_SCOPE("PhysicsJoltImpl::castShapes");
 
-		syncInfo._global = std::move(glmMat);
-		out.emplace_back(std::move(syncInfo));
+	if (queries.empty()) {
+		results.clear();
+		return;
 	}
 
-	// Characters
-	for (auto& [node, character] : _charMap) {
-		TransformSyncInfo syncInfo{};
-		syncInfo._node = node;
+	results.resize(queries.size());
+	auto& narrowPhase = _physicsSystem.GetNarrowPhaseQuery();
+
+	parallelFor(queries.size(), g_QueryChunkSize, [&](std::size_t begin, std::size_t end) {
+		JPH::ShapeCastSettings settings;
+
+		for (std::size_t i = begin; i < end; ++i) {
+			auto& q = queries[i];
+			auto& result = results[i];
+			result = QueryHit{};
+
+			withQueryShape(q._shape, [&](const JPH::Shape& shape) {
+				auto& rot = q._shape._rotation;
+				JPH::RShapeCast cast(
+					&shape,
+					JPH::Vec3::sReplicate(1.0f),
+					JPH::RMat44::sRotationTranslation(JPH::Quat(rot.x, rot.y, rot.z, rot.w), JPH::RVec3(q._start.x, q._start.y, q._start.z)),
+					JPH::Vec3(q._direction.x, q._direction.y, q._direction.z));
+
+				JPH::ClosestHitCollisionCollector<JPH::CastShapeCollector> collector;
+				QueryBroadPhaseLayerFilter bpFilter(q._layerMask);
+				QueryObjectLayerFilter objFilter(q._layerMask);
+				narrowPhase.CastShape(cast, settings, JPH::RVec3::sZero(), collector, bpFilter, objFilter);
+
+				if (!collector.HadHit()) {
+					return;
+				}
+
+				auto& hit = collector.mHit;
+				fillInHit(hit.mBodyID2, result);
+				result._fraction = hit.mFraction;
+				result._position = jphVecToGlm(JPH::RVec3(hit.mContactPointOn2));
+				auto normal = -hit.mPenetrationAxis.NormalizedOr(JPH::Vec3::sZero());
+				result._normal = glm::vec3(normal.GetX(), normal.GetY(), normal.GetZ());
+			});
+		}
+	});
+}
 
-		auto transform = character->GetWorldTransform();
-		glm::mat4 glmMat = jphMatToGlm(transform);
+void PhysicsJoltImpl::overlap(const std::vector<OverlapQuery>& queries, std::vector<OverlapResult>& results, std::vector<QueryHit>& hits)
+{
+	ANEREND_PROFILE_SCOPE("PhysicsJoltImpl::overlap");
 
-		syncInfo._global = std::move(glmMat);
-		out.emplace_back(std::move(syncInfo));
+	if (queries.empty()) {
+		results.clear();
+		hits.clear();
+		return;
 	}
 
-	return out;
+	results.resize(queries.size());
+	hits.clear();
+	_chunkHits.resize((queries.size() + g_QueryChunkSize - 1) / g_QueryChunkSize);
+	auto& narrowPhase = _physicsSystem.GetNarrowPhaseQuery();
+
+	parallelFor(queries.size(), g_QueryChunkSize, [&](std::size_t begin, std::size_t end) {
+		auto& chunkHits = _chunkHits[begin / g_QueryChunkSize];
+		chunkHits.clear();
+
+		JPH::CollideShapeSettings settings;
+		JPH::AllHitCollisionCollector<JPH::CollideShapeCollector> collector;
+
+		for (std::size_t i = begin; i < end; ++i) {
+			auto& q = queries[i];
+			auto& result = results[i];
+			result._firstHit = (std::uint32_t)chunkHits.size();
+
+			withQueryShape(q._shape, [&](const JPH::Shape& shape) {
+				auto& rot = q._shape._rotation;
+				collector.Reset();
+				QueryBroadPhaseLayerFilter bpFilter(q._layerMask);
+				QueryObjectLayerFilter objFilter(q._layerMask);
+				narrowPhase.CollideShape(
+					&shape,
+					JPH::Vec3::sReplicate(1.0f),
+					JPH::RMat44::sRotationTranslation(JPH::Quat(rot.x, rot.y, rot.z, rot.w), JPH::RVec3(q._position.x, q._position.y, q._position.z)),
+					settings,
+					JPH::RVec3::sZero(),
+					collector,
+					bpFilter,
+					objFilter);
+
+				// Sub shapes of the same body hit separately, only report the body once
+				std::sort(collector.mHits.begin(), collector.mHits.end(), [](const JPH::CollideShapeResult& a, const JPH::CollideShapeResult& b) {
+					return a.mBodyID2 < b.mBodyID2;
+				});
+
+				for (std::size_t h = 0; h < collector.mHits.size(); ++h) {
+					auto& hit = collector.mHits[h];
+					if (h > 0 && collector.mHits[h - 1].mBodyID2 == hit.mBodyID2) {
+						continue;
+					}
+
+					QueryHit out{};
+					fillInHit(hit.mBodyID2, out);
+					out._fraction = 0.0f;
+					out._position = jphVecToGlm(JPH::RVec3(hit.mContactPointOn2));
+					auto normal = -hit.mPenetrationAxis.NormalizedOr(JPH::Vec3::sZero());
+					out._normal = glm::vec3(normal.GetX(), normal.GetY(), normal.GetZ());
+					chunkHits.emplace_back(std::move(out));
+				}
+			});
+
+			result._numHits = (std::uint32_t)chunkHits.size() - result._firstHit;
+		}
+	});
+
+	// Concatenate the chunks and make the ranges point into the full list
+	for (std::size_t chunk = 0; chunk < _chunkHits.size(); ++chunk) {
+		auto offset = (std::uint32_t)hits.size();
+		hits.insert(hits.end(), _chunkHits[chunk].begin(), _chunkHits[chunk].end());
+
+		auto end = std::min((chunk + 1) * g_QueryChunkSize, queries.size());
+		for (std::size_t i = chunk * g_QueryChunkSize; i < end; ++i) {
+			results[i]._firstHit += offset;
+		}
+	}
 }
 
 void PhysicsJoltImpl::debugDraw(JPH::DebugRenderer* renderer)
@@ -207,40 +643,94 @@ bool PhysicsJoltImpl::isShapeKnown(util::Uuid node) const
 
 bool PhysicsJoltImpl::isCharKnown(util::Uuid node) const
 {
-	return _charMap.find(node) != _charMap.end();
+	return _charIndices.find(node) != _charIndices.end();
+}
+
+bool PhysicsJoltImpl::isShapePending(util::Uuid node) const
+{
+	return _pendingHeightFields.find(node) != _pendingHeightFields.end();
 }
 
 void PhysicsJoltImpl::remove(util::Uuid node)
 {
+	abandonHeightField(node);
+
 	bool isBody = _bodyMap.find(node) != _bodyMap.end();
-	bool isChar = _charMap.find(node) != _charMap.end();
-	auto& bi = _physicsSystem.GetBodyInterface();
+	bool isChar = isCharKnown(node);
 
 	if (!isBody && !isChar) {
 		printf("Physics cannot remove node %s, doesn't exist!\n", node.str().c_str());
 		return;
 	}
 
+	if (_recording) {
+		_recording->_ops.emplace_back(recordedOp(RecordedOp::Remove, node));
+	}
+
 	if (isBody) {
-		auto& bodyId = _bodyMap[node];
-		bi.RemoveBody(bodyId);
+		_bodiesToRemove.clear();
+		_bodiesToRemove.emplace_back(_bodyMap[node]);
+		destroyBodies(_bodiesToRemove);
 		_bodyMap.erase(node);
 	}
 	else if (isChar) {
 		removeChar(node);
 	}
 	_shapeMap.erase(node);
+	_shapeCacheDirty = true;
+}
+
+void PhysicsJoltImpl::remove(const std::vector<util::Uuid>& nodes)
+{
+	ANEREND_PROFILE_SCOPE("PhysicsJoltImpl::remove (bulk)");
+
+	if (_recording && !nodes.empty()) {
+		auto op = recordedOp(RecordedOp::RemoveBulk);
+		op._nodes = nodes;
+		_recording->_ops.emplace_back(std::move(op));
+	}
+
+	_bodiesToRemove.clear();
+	for (auto& node : nodes) {
+		abandonHeightField(node);
+
+		auto it = _bodyMap.find(node);
+		if (it != _bodyMap.end()) {
+			_bodiesToRemove.emplace_back(it->second);
+			_bodyMap.erase(it);
+		}
+		else if (isCharKnown(node)) {
+			removeChar(node);
+		}
+		else {
+			continue;
+		}
+
+		_shapeMap.erase(node);
+		_shapeCacheDirty = true;
+	}
+
+	destroyBodies(_bodiesToRemove);
 }
 
 void PhysicsJoltImpl::removeChar(util::Uuid node)
 {
-	if (_charMap.find(node) == _charMap.end()) {
+	auto it = _charIndices.find(node);
+	if (it == _charIndices.end()) {
 		printf("Physics cannot remove char %s, doesn't exist\n", node.str().c_str());
 		return;
 	}
 
-	_charMap[node]->RemoveFromPhysicsSystem();
-	_charMap.erase(node);
+	auto index = it->second;
+	_charIndices.erase(it);
+	removeFromBodyTable(_characters[index]._character->GetInnerBodyID());
+
+	// Destroying the character also removes its inner body
+	if (index != _characters.size() - 1) {
+		_characters[index] = std::move(_characters.back());
+		_charIndices[_characters[index]._node] = index;
+	}
+	_characters.pop_back();
 }
 
 void PhysicsJoltImpl::addSphere(float radius, util::Uuid node)
@@ -264,8 +754,179 @@ void PhysicsJoltImpl::addCapsule(float halfHeight, float radius, util::Uuid node
 	setShapeBodyOrChar(node);
 }
 
-void PhysicsJoltImpl::addMesh(const render::asset::Mesh& mesh, util::Uuid node)
+void PhysicsJoltImpl::addMesh(const render::asset::Mesh& mesh, const glm::vec3& scale, util::Uuid node)
+{
+	if (addCachedMesh(mesh._id, scale, node)) {
+		return;
+	}
+
+	auto shape = createMeshShape(mesh);
+	if (!shape) {
+		return;
+	}
+
+	_meshShapeCache[mesh._id] = shape;
+	_shapeMap[node] = scaledMeshShape(mesh._id, shape, scale);
+
+	setShapeBodyOrChar(node);
+}
+
+bool PhysicsJoltImpl::addCachedMesh(const util::Uuid& meshId, const glm::vec3& scale, util::Uuid node)
+{
+	auto it = _meshShapeCache.find(meshId);
+	if (it == _meshShapeCache.end()) {
+		return false;
+	}
+
+	_shapeMap[node] = scaledMeshShape(meshId, it->second, scale);
+
+	setShapeBodyOrChar(node);
+	return true;
+}
+
+void PhysicsJoltImpl::evictMeshShape(const util::Uuid& meshId)
+{
+	for (auto it = _scaledShapeCache.begin(); it != _scaledShapeCache.end();) {
+		if (it->first._meshId == meshId) {
+			it = _scaledShapeCache.erase(it);
+		}
+		else {
+			++it;
+		}
+	}
+
+	_meshShapeCache.erase(meshId);
+}
+
+void PhysicsJoltImpl::addHeightFieldAsync(std::function<bool(HeightFieldSamples&)> fetchSamples, util::Uuid node)
+{
+	abandonHeightField(node);
+
+	_pendingHeightFields[node] = std::async(std::launch::async, [fetchSamples = std::move(fetchSamples)]() -> JPH::ShapeRefC {
+		ANEREND_PROFILE_SCOPE("PhysicsJoltImpl::buildHeightField");
+
+		HeightFieldSamples samples{};
+		if (!fetchSamples(samples)) {
+			return nullptr;
+		}
+
+		return createHeightFieldShape(samples);
+	});
+}
+
+void PhysicsJoltImpl::pollHeightFields(std::vector<util::Uuid>& readyNodes)
+{
+	readyNodes.clear();
+
+	for (auto it = _pendingHeightFields.begin(); it != _pendingHeightFields.end();) {
+		if (it->second.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+			++it;
+			continue;
+		}
+
+		auto node = it->first;
+		auto shape = it->second.get();
+		it = _pendingHeightFields.erase(it);
+
+		if (!shape) {
+			continue;
+		}
+
+		_shapeMap[node] = shape;
+		setShapeBodyOrChar(node);
+		readyNodes.emplace_back(node);
+	}
+
+	_abandonedHeightFields.erase(std::remove_if(_abandonedHeightFields.begin(), _abandonedHeightFields.end(), [](const std::future<JPH::ShapeRefC>& f) {
+		return f.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+	}), _abandonedHeightFields.end());
+}
+
+void PhysicsJoltImpl::abandonHeightField(util::Uuid node)
 {
+	// Destroying the future would block until the build is done, so park it instead
+	auto it = _pendingHeightFields.find(node);
+	if (it != _pendingHeightFields.end()) {
+		_abandonedHeightFields.emplace_back(std::move(it->second));
+		_pendingHeightFields.erase(it);
+	}
+}
+
+void PhysicsJoltImpl::pruneShapeCache()
+{
+	if (!_shapeCacheDirty) {
+		return;
+	}
+	_shapeCacheDirty = false;
+
+	// Scaled shapes first, they hold references to the mesh shapes
+	for (auto it = _scaledShapeCache.begin(); it != _scaledShapeCache.end();) {
+		if (it->second->GetRefCount() == 1) {
+			it = _scaledShapeCache.erase(it);
+		}
+		else {
+			++it;
+		}
+	}
+
+	for (auto it = _meshShapeCache.begin(); it != _meshShapeCache.end();) {
+		if (it->second->GetRefCount() == 1) {
+			it = _meshShapeCache.erase(it);
+		}
+		else {
+			++it;
+		}
+	}
+}
+
+bool PhysicsJoltImpl::bakeMeshShape(const render::asset::Mesh& mesh, std::vector<std::uint8_t>& out)
+{
+	// Don't pick up an old baked shape, always build from the triangles
+	render::asset::Mesh unbaked;
+	unbaked._vertices = mesh._vertices;
+	unbaked._indices = mesh._indices;
+
+	auto shape = createMeshShape(unbaked);
+	if (!shape) {
+		return false;
+	}
+
+	// With children (a MeshShape has none) so that materials are included, this ends up in Shape::SaveBinaryState
+	std::stringstream stream;
+	JPH::StreamOutWrapper streamOut(stream);
+	JPH::Shape::ShapeToIDMap shapeMap;
+	JPH::Shape::MaterialToIDMap materialMap;
+	shape->SaveWithChildren(streamOut, shapeMap, materialMap);
+
+	if (streamOut.IsFailed()) {
+		printf("Could not save Jolt mesh shape!\n");
+		return false;
+	}
+
+	auto str = stream.str();
+	out.assign(str.begin(), str.end());
+	return true;
+}
+
+JPH::ShapeRefC PhysicsJoltImpl::createMeshShape(const render::asset::Mesh& mesh)
+{
+	ANEREND_PROFILE_SCOPE("PhysicsJoltImpl::createMeshShape");
+
+	if (!mesh._bakedCollisionShape.empty()) {
+		std::stringstream stream(std::string(mesh._bakedCollisionShape.begin(), mesh._bakedCollisionShape.end()));
+		JPH::StreamInWrapper streamIn(stream);
+		JPH::Shape::IDToShapeMap shapeMap;
+		JPH::Shape::IDToMaterialMap materialMap;
+		auto res = JPH::Shape::sRestoreWithChildren(streamIn, shapeMap, materialMap);
+
+		if (!res.HasError()) {
+			return res.Get();
+		}
+
+		// Probably baked with an incompatible Jolt version
+		printf("Could not restore baked Jolt mesh shape (%s), rebuilding it\n", res.GetError().c_str());
+	}
+
 	// Prepare data so that JPH can eat it
 	JPH::IndexedTriangleList indices;
 	indices.resize(mesh._indices.size() / 3);
@@ -286,15 +947,92 @@ void PhysicsJoltImpl::addMesh(const render::asset::Mesh& mesh, util::Uuid node)
 
 	if (res.HasError()) {
 		printf("Error creating Jolt mesh: %s\n", res.GetError().c_str());
+		return nullptr;
+	}
+
+	return res.Get();
+}
+
+JPH::ShapeRefC PhysicsJoltImpl::createHeightFieldShape(const HeightFieldSamples& samples)
+{
+	ANEREND_PROFILE_SCOPE("PhysicsJoltImpl::createHeightFieldShape");
+
+	if (samples._sampleCount < 2 || samples._heights.size() < samples._sampleCount * samples._sampleCount) {
+		printf("Not enough heightfield samples!\n");
+		return nullptr;
+	}
+
+	unsigned blockSize = std::clamp(samples._blockSize, 2u, 8u);
+	unsigned bitsPerSample = std::clamp(samples._bitsPerSample, 1u, 8u);
+
+	// Jolt wants the sample count to be a multiple of the block size, pad with holes
+	unsigned count = (samples._sampleCount + blockSize - 1) / blockSize * blockSize;
+
+	std::vector<float> heights(count * count, JPH::HeightFieldShapeConstants::cNoCollisionValue);
+	for (unsigned z = 0; z < samples._sampleCount; ++z) {
+		auto* row = &samples._heights[z * samples._sampleCount];
+		std::copy(row, row + samples._sampleCount, &heights[z * count]);
+	}
+
+	JPH::HeightFieldShapeSettings settings(
+		heights.data(),
+		JPH::Vec3::sZero(),
+		JPH::Vec3(samples._sampleSpacing, 1.0f, samples._sampleSpacing),
+		count);
+	settings.mBlockSize = blockSize;
+	settings.mBitsPerSample = bitsPerSample;
+
+	auto res = settings.Create();
+
+	if (res.HasError()) {
+		printf("Error creating Jolt heightfield: %s\n", res.GetError().c_str());
+		return nullptr;
+	}
+
+	return res.Get();
+}
+
+JPH::ShapeRefC PhysicsJoltImpl::scaledMeshShape(const util::Uuid& meshId, const JPH::ShapeRefC& meshShape, const glm::vec3& scale)
+{
+	ScaledShapeKey key{};
+	key._meshId = meshId;
+	for (int i = 0; i < 3; ++i) {
+		key._scale[i] = (std::int32_t)std::round(scale[i] * 10000.0f);
+	}
+
+	// Unit scale is the mesh shape itself
+	if (key._scale[0] == 10000 && key._scale[1] == 10000 && key._scale[2] == 10000) {
+		return meshShape;
+	}
+
+	auto it = _scaledShapeCache.find(key);
+	if (it != _scaledShapeCache.end()) {
+		return it->second;
+	}
+
+	JPH::ShapeRefC scaled = new JPH::ScaledShape(meshShape, JPH::Vec3(scale.x, scale.y, scale.z));
+	_scaledShapeCache[key] = scaled;
+	return scaled;
+}
+
+void PhysicsJoltImpl::addRigidBody(const component::RigidBody& rigidComp, const glm::mat4& transform, util::Uuid node, std::uint64_t userData)
+{
+	if (!isShapeKnown(node)) {
 		return;
 	}
 
-	_shapeMap[node] = res.Get();
+	if (_recording) {
+		auto op = recordedOp(RecordedOp::AddBody, node);
+		op._userData = userData;
+		op._transform = transform;
+		op._rigid = rigidComp;
+		_recording->_ops.emplace_back(std::move(op));
+	}
 
-	setShapeBodyOrChar(node);
+	createRigidBody(rigidComp, transform, node, userData);
 }
 
-void PhysicsJoltImpl::addRigidBody(const component::RigidBody& rigidComp, const glm::mat4& transform, util::Uuid node)
+void PhysicsJoltImpl::createRigidBody(const component::RigidBody& rigidComp, const glm::mat4& transform, util::Uuid node, std::uint64_t userData)
 {
 	if (!isShapeKnown(node)) {
 		return;
@@ -302,31 +1040,157 @@ void PhysicsJoltImpl::addRigidBody(const component::RigidBody& rigidComp, const
 
 	JPH::BodyCreationSettings settings;
 	fillInBodySettings(settings, transform, _shapeMap[node], rigidComp);
+	settings.mUserData = userData;
+
+	// Not added to the simulation until flushBodyAdds
+	auto& bi = _physicsSystem.GetBodyInterface();
+	JPH::Body* body = bi.CreateBody(settings);
+	if (!body) {
+		printf("Physics could not create a body for %s, too many bodies?\n", node.str().c_str());
+		return;
+	}
+
+	auto bodyId = body->GetID();
+
+	_bodyMap[node] = bodyId;
+	addToBodyTable(bodyId, node, userData, false);
+	_bodyTable[bodyId.GetIndex()]._queued = true;
+	_bodiesToAdd.emplace_back(bodyId);
+}
+
+void PhysicsJoltImpl::flushBodyAdds()
+{
+	if (_bodiesToAdd.empty()) {
+		return;
+	}
+
+	ANEREND_PROFILE_SCOPE("PhysicsJoltImpl::flushBodyAdds");
+
+	if (_recording) {
+		_recording->_ops.emplace_back(recordedOp(RecordedOp::FlushAdds));
+	}
+
+	for (auto& bodyId : _bodiesToAdd) {
+		_bodyTable[bodyId.GetIndex()]._queued = false;
+	}
+
+	// The broadphase trees for each batch are built on the job system, only linking them in is left for this thread.
+	// Prepare reorders the ids in its batch, that's fine.
+	auto& bi = _physicsSystem.GetBodyInterface();
+	const std::size_t batchSize = 1024;
+	const std::size_t numBatches = (_bodiesToAdd.size() + batchSize - 1) / batchSize;
+	_addStates.resize(numBatches);
+
+	parallelFor(numBatches, 1, [this, &bi, batchSize](std::size_t begin, std::size_t end) {
+		for (std::size_t batch = begin; batch < end; ++batch) {
+			auto first = batch * batchSize;
+			auto count = std::min(batchSize, _bodiesToAdd.size() - first);
+			_addStates[batch] = bi.AddBodiesPrepare(_bodiesToAdd.data() + first, (int)count);
+		}
+	});
+
+	for (std::size_t batch = 0; batch < numBatches; ++batch) {
+		auto first = batch * batchSize;
+		auto count = std::min(batchSize, _bodiesToAdd.size() - first);
+		bi.AddBodiesFinalize(_bodiesToAdd.data() + first, (int)count, _addStates[batch], JPH::EActivation::Activate);
+	}
+
+	_numBodyChangesSinceOptimize += _bodiesToAdd.size();
+	_bodiesToAdd.clear();
+}
+
+bool PhysicsJoltImpl::optimizeBroadPhaseIfNeeded(double delta, std::size_t minBodyChanges, double minInterval)
+{
+	_timeSinceOptimize += delta;
+
+	if (_numBodyChangesSinceOptimize < minBodyChanges || _timeSinceOptimize < minInterval) {
+		return false;
+	}
+
+	ANEREND_PROFILE_SCOPE("Jolt PhysicsSystem::OptimizeBroadPhase");
+
+	if (_recording) {
+		_recording->_ops.emplace_back(recordedOp(RecordedOp::OptimizeBroadPhase));
+	}
+	_physicsSystem.OptimizeBroadPhase();
+
+	_numBodyChangesSinceOptimize = 0;
+	_timeSinceOptimize = 0.0;
+	return true;
+}
+
+void PhysicsJoltImpl::destroyBodies(std::vector<JPH::BodyID>& bodyIds)
+{
+	if (bodyIds.empty()) {
+		return;
+	}
 
 	auto& bi = _physicsSystem.GetBodyInterface();
-	_bodyMap[node] = bi.CreateAndAddBody(settings, JPH::EActivation::Activate);
+
+	// Queued bodies were never added, so they only need to leave the queue
+	auto addedEnd = std::partition(bodyIds.begin(), bodyIds.end(), [this](const JPH::BodyID& bodyId) {
+		return !_bodyTable[bodyId.GetIndex()]._queued;
+	});
+	auto numAdded = (std::size_t)(addedEnd - bodyIds.begin());
+
+	for (auto it = addedEnd; it != bodyIds.end(); ++it) {
+		_bodiesToAdd.erase(std::find(_bodiesToAdd.begin(), _bodiesToAdd.end(), *it));
+	}
+
+	for (auto& bodyId : bodyIds) {
+		removeFromBodyTable(bodyId);
+	}
+
+	if (numAdded > 0) {
+		bi.RemoveBodies(bodyIds.data(), (int)numAdded);
+		_numBodyChangesSinceOptimize += numAdded;
+	}
+	bi.DestroyBodies(bodyIds.data(), (int)bodyIds.size());
 }
 
-void PhysicsJoltImpl::addCharacterController(const component::CharacterController& comp, const glm::mat4& transform, util::Uuid node)
+void PhysicsJoltImpl::addCharacterController(const component::CharacterController& comp, const glm::mat4& transform, util::Uuid node, std::uint64_t userData)
 {
 	if (!isShapeKnown(node)) {
 		printf("Physics cannot add a character without a shape!\n");
 		return;
 	}
 
+	if (_recording) {
+		auto op = recordedOp(RecordedOp::AddCharacter, node);
+		op._userData = userData;
+		op._transform = transform;
+		op._char = comp;
+		_recording->_ops.emplace_back(std::move(op));
+	}
+
 	auto [quat, trans] = glmToJPHRotTrans(transform);
 
-	JPH::Ref<JPH::CharacterSettings> settings = new JPH::CharacterSettings();
+	JPH::Ref<JPH::CharacterVirtualSettings> settings = new JPH::CharacterVirtualSettings();
 	settings->mMaxSlopeAngle = glm::radians(45.0f);
-	settings->mLayer = Layers::MOVING;
 	settings->mShape = _shapeMap[node];
-	settings->mFriction = 0.5f;
 	settings->mSupportingVolume = JPH::Plane(JPH::Vec3::sAxisY(), -0.3f);
 	settings->mMass = comp._mass;
-	auto character = new JPH::Character(settings, trans, quat, 0, &_physicsSystem);
-	character->AddToPhysicsSystem();
+	// The inner body is what rigid bodies, queries and other characters collide with
+	settings->mInnerBodyShape = _shapeMap[node];
+	settings->mInnerBodyLayer = Layers::MOVING;
 
-	_charMap[node] = character;
+	JPH::Ref<JPH::CharacterVirtual> character = new JPH::CharacterVirtual(settings, trans, quat, userData, &_physicsSystem);
+	if (character->GetInnerBodyID().IsInvalid()) {
+		printf("Physics could not create a character for %s, too many bodies?\n", node.str().c_str());
+		return;
+	}
+	character->SetListener(&_charContactListener);
+
+	VirtualCharacter c{};
+	c._character = character;
+	c._node = node;
+	c._userData = userData;
+	c._maxStepHeight = comp._maxStepHeight;
+	c._groundSnapDistance = comp._groundSnapDistance;
+
+	_charIndices[node] = (std::uint32_t)_characters.size();
+	_characters.emplace_back(std::move(c));
+	addToBodyTable(character->GetInnerBodyID(), node, userData, true);
 }
 
 void PhysicsJoltImpl::updateSphere(float radius, util::Uuid node)
@@ -357,84 +1221,411 @@ void PhysicsJoltImpl::updateRigidBody(const component::RigidBody& rigidComp, uti
 {
 	if (!isBodyKnown(node)) return;
 
+	if (_recording) {
+		auto op = recordedOp(RecordedOp::UpdateBody, node);
+		op._rigid = rigidComp;
+		_recording->_ops.emplace_back(std::move(op));
+	}
+
 	// The simplest thing to do here seems to be to recreate the entire body
 	auto& bodyId = _bodyMap[node];
 	auto& bi = _physicsSystem.GetBodyInterface();
 
 	auto trans = bi.GetWorldTransform(bodyId);
 	glm::mat4 glmTrans = jphMatToGlm(trans);
+	auto userData = bi.GetUserData(bodyId);
 
 	// Remove old body
-	bi.RemoveBody(bodyId);
+	_bodiesToRemove.clear();
+	_bodiesToRemove.emplace_back(bodyId);
+	destroyBodies(_bodiesToRemove);
 
-	addRigidBody(rigidComp, glmTrans, node);
+	createRigidBody(rigidComp, glmTrans, node, userData);
 }
 
 void PhysicsJoltImpl::updateCharacterController(const component::CharacterController& charComp, util::Uuid node)
 {
 	if (!isCharKnown(node)) return;
 
-	// Have to recreate it
-	auto trans = _charMap[node]->GetWorldTransform();
-	glm::mat4 glmTrans = jphMatToGlm(trans);
-
-	_charMap[node]->RemoveFromPhysicsSystem();
+	if (_recording) {
+		auto op = recordedOp(RecordedOp::UpdateCharacter, node);
+		op._char = charComp;
+		_recording->_ops.emplace_back(std::move(op));
+	}
 
-	addCharacterController(charComp, glmTrans, node);
+	auto& c = _characters[_charIndices[node]];
+	c._character->SetMass(charComp._mass);
+	c._maxStepHeight = charComp._maxStepHeight;
+	c._groundSnapDistance = charComp._groundSnapDistance;
 }
 
 void PhysicsJoltImpl::setPositionAndOrientation(const util::Uuid& node, glm::quat rot, glm::vec3 trans)
 {
 	if (!isShapeKnown(node)) return;
 
+	if (_recording) {
+		auto op = recordedOp(RecordedOp::Teleport, node);
+		op._rotation = rot;
+		op._position = trans;
+		_recording->_ops.emplace_back(std::move(op));
+	}
+
 	if (isBodyKnown(node)) {
 		auto& bodyId = _bodyMap[node];
 
 		auto& bi = _physicsSystem.GetBodyInterface();
 		bi.SetPositionAndRotationWhenChanged(bodyId, JPH::Vec3(trans.x, trans.y, trans.z), JPH::Quat(rot.x, rot.y, rot.z, rot.w), JPH::EActivation::Activate);
+		resetTickPose(bodyId);
 	}
 	else if (isCharKnown(node)) {
-		_charMap[node]->SetPositionAndRotation(JPH::Vec3(trans.x, trans.y, trans.z), JPH::Quat(rot.x, rot.y, rot.z, rot.w));
+		auto& character = _characters[_charIndices[node]]._character;
+		character->SetPosition(JPH::RVec3(trans.x, trans.y, trans.z));
+		character->SetRotation(JPH::Quat(rot.x, rot.y, rot.z, rot.w));
+		resetTickPose(character->GetInnerBodyID());
 	}
 }
 
-void PhysicsJoltImpl::setDesiredVelocity(const glm::vec3& desiredVel, float jumpSpeed, float speed, const util::Uuid& node)
+void PhysicsJoltImpl::setDesiredVelocity(std::size_t index, const glm::vec3& desiredVel, float jumpSpeed, float speed)
 {
-	if (!isCharKnown(node)) {
-		printf("Physics cannot set desired velocity on %s, doesn't exist!\n", node.str().c_str());
+	auto& c = _characters[index];
+
+	// Only changes are recorded, this is called every tick
+	if (_recording && (c._desiredVelocity != desiredVel || c._jumpSpeed != jumpSpeed || c._speed != speed)) {
+		auto op = recordedOp(RecordedOp::DesiredVelocity, c._node);
+		op._char._desiredLinearVelocity = desiredVel;
+		op._char._jumpSpeed = jumpSpeed;
+		op._char._speed = speed;
+		_recording->_ops.emplace_back(std::move(op));
+	}
+
+	c._desiredVelocity = desiredVel;
+	c._jumpSpeed = jumpSpeed;
+	c._speed = speed;
+}
+
+void PhysicsJoltImpl::updateCharacters(float delta)
+{
+	ANEREND_PROFILE_SCOPE("PhysicsJoltImpl::updateCharacters");
+
+	if (_characters.empty()) {
 		return;
 	}
 
-	auto character = _charMap[node];
+	// At most one chunk per temp allocator
+	std::size_t numAllocators = _charTempAllocators.size();
+	std::size_t chunkSize = std::max((_characters.size() + numAllocators - 1) / numAllocators, (std::size_t)32);
+	auto gravity = _physicsSystem.GetGravity();
+
+	parallelFor(_characters.size(), chunkSize, [this, delta, chunkSize, gravity](std::size_t begin, std::size_t end) {
+		auto& allocator = *_charTempAllocators[begin / chunkSize];
+		auto broadPhaseFilter = _physicsSystem.GetDefaultBroadPhaseLayerFilter(Layers::MOVING);
+		auto layerFilter = _physicsSystem.GetDefaultLayerFilter(Layers::MOVING);
+
+		for (std::size_t i = begin; i < end; ++i) {
+			auto& c = _characters[i];
+			updateCharacterVelocity(c, delta, gravity);
 
-	// Copied from Jolt example:
+			// Steps up stairs and sticks to the floor when walking down slopes and steps
+			JPH::CharacterVirtual::ExtendedUpdateSettings settings;
+			settings.mWalkStairsStepUp = JPH::Vec3(0.0f, c._maxStepHeight, 0.0f);
+			settings.mStickToFloorStepDown = JPH::Vec3(0.0f, -c._groundSnapDistance, 0.0f);
+
+			JPH::IgnoreSingleBodyFilter bodyFilter(c._character->GetInnerBodyID());
+			c._character->ExtendedUpdate(delta, gravity, settings, broadPhaseFilter, layerFilter, bodyFilter, JPH::ShapeFilter(), allocator);
+		}
+	});
+}
+
+void PhysicsJoltImpl::updateCharacterVelocity(VirtualCharacter& c, float delta, JPH::Vec3Arg gravity)
+{
+	// Mostly from the Jolt character samples
+	auto& character = *c._character;
 
 	// Cancel movement in opposite direction of normal when touching something we can't walk up
-	JPH::Vec3 movement_direction(desiredVel.x, desiredVel.y, desiredVel.z);
-	JPH::Character::EGroundState ground_state = character->GetGroundState();
-	if (ground_state == JPH::Character::EGroundState::OnSteepGround
-		|| ground_state == JPH::Character::EGroundState::NotSupported) {
-		JPH::Vec3 normal = character->GetGroundNormal();
+	JPH::Vec3 movementDirection(c._desiredVelocity.x, 0.0f, c._desiredVelocity.z);
+	auto groundState = character.GetGroundState();
+	if (groundState == JPH::CharacterVirtual::EGroundState::OnSteepGround
+		|| groundState == JPH::CharacterVirtual::EGroundState::NotSupported) {
+		JPH::Vec3 normal = character.GetGroundNormal();
 		normal.SetY(0.0f);
-		float dot = normal.Dot(movement_direction);
+		float dot = normal.Dot(movementDirection);
 		if (dot < 0.0f)
-			movement_direction -= (dot * normal) / normal.LengthSq();
+			movementDirection -= (dot * normal) / normal.LengthSq();
+	}
+
+	c._horizontalVelocity = 0.95f * c._horizontalVelocity + 0.05f * c._speed * movementDirection;
+
+	// Virtual characters have no body for gravity to act on, so the vertical velocity is integrated here
+	character.UpdateGroundVelocity();
+	JPH::Vec3 verticalVelocity(0.0f, character.GetLinearVelocity().GetY(), 0.0f);
+	JPH::Vec3 groundVelocity = character.GetGroundVelocity();
+	bool movingTowardsGround = verticalVelocity.GetY() - groundVelocity.GetY() < 0.1f;
+
+	// Jumping isn't hooked up, nothing on the component triggers it yet
+	JPH::Vec3 newVelocity = groundState == JPH::CharacterVirtual::EGroundState::OnGround && movingTowardsGround ? groundVelocity : verticalVelocity;
+	newVelocity += gravity * delta;
+	newVelocity += c._horizontalVelocity;
+
+	character.SetLinearVelocity(newVelocity);
+}
+
+void PhysicsJoltImpl::startRecording(PhysicsRecording* recording)
+{
+	_recording = recording;
+	recordInitialState();
+}
+
+void PhysicsJoltImpl::stopRecording()
+{
+	_recording = nullptr;
+	_recordedShapeIndices.clear();
+	_recordedShapes.clear();
+	_recordedShapeIds.clear();
+	_recordedMaterialIds.clear();
+}
+
+void PhysicsJoltImpl::replay(const RecordedOp& op, const std::vector<JPH::ShapeRefC>& shapes)
+{
+	switch (op._type) {
+	case RecordedOp::SetShape:
+		if (op._shape < shapes.size() && shapes[op._shape]) {
+			_shapeMap[op._node] = shapes[op._shape];
+			setShapeBodyOrChar(op._node);
+		}
+		break;
+	case RecordedOp::AddBody:
+		addRigidBody(op._rigid, op._transform, op._node, op._userData);
+		break;
+	case RecordedOp::UpdateBody:
+		updateRigidBody(op._rigid, op._node);
+		break;
+	case RecordedOp::AddCharacter:
+		addCharacterController(op._char, op._transform, op._node, op._userData);
+		break;
+	case RecordedOp::UpdateCharacter:
+		updateCharacterController(op._char, op._node);
+		break;
+	case RecordedOp::Remove:
+		remove(op._node);
+		break;
+	case RecordedOp::RemoveBulk:
+		remove(op._nodes);
+		break;
+	case RecordedOp::FlushAdds:
+		flushBodyAdds();
+		break;
+	case RecordedOp::OptimizeBroadPhase:
+		// No thresholds, so that it always runs
+		optimizeBroadPhaseIfNeeded(0.0, 0, 0.0);
+		break;
+	case RecordedOp::Teleport:
+		setPositionAndOrientation(op._node, op._rotation, op._position);
+		break;
+	case RecordedOp::SetVelocity:
+	{
+		JPH::Vec3 linear(op._linearVelocity.x, op._linearVelocity.y, op._linearVelocity.z);
+		JPH::Vec3 angular(op._angularVelocity.x, op._angularVelocity.y, op._angularVelocity.z);
+		if (isBodyKnown(op._node)) {
+			_physicsSystem.GetBodyInterface().SetLinearAndAngularVelocity(_bodyMap[op._node], linear, angular);
+		}
+		else if (isCharKnown(op._node)) {
+			_characters[_charIndices[op._node]]._character->SetLinearVelocity(linear);
+		}
+		break;
 	}
+	case RecordedOp::ResetVelocities:
+		resetVelocities();
+		break;
+	case RecordedOp::DesiredVelocity:
+		if (isCharKnown(op._node)) {
+			setDesiredVelocity(_charIndices[op._node], op._char._desiredLinearVelocity, op._char._jumpSpeed, op._char._speed);
+		}
+		break;
+	case RecordedOp::Tick:
+		preUpdate(op._delta);
+		update(op._delta);
+		postUpdate(op._delta);
+		captureTickPoses();
+		break;
+	}
+}
 
-	if (character->IsSupported())	{
-		// Update velocity
-		JPH::Vec3 current_velocity = character->GetLinearVelocity();
-		JPH::Vec3 desired_velocity = speed * movement_direction;
-		desired_velocity.SetY(current_velocity.GetY());
-		JPH::Vec3 new_velocity = 0.95f * current_velocity + 0.05f * desired_velocity;
+JPH::ShapeRefC PhysicsJoltImpl::createRecordedShape(const RecordedShape& shape, JPH::Shape::IDToShapeMap& shapeMap, JPH::Shape::IDToMaterialMap& materialMap)
+{
+	switch (shape._type) {
+	case RecordedShape::Sphere:
+		return new JPH::SphereShape(shape._params.x);
+	case RecordedShape::Box:
+		return new JPH::BoxShape(JPH::Vec3(shape._params.x, shape._params.y, shape._params.z));
+	case RecordedShape::Capsule:
+		return new JPH::CapsuleShape(shape._params.x, shape._params.y);
+	case RecordedShape::Binary:
+		break;
+	}
 
-		// Jump
-		if (false && ground_state == JPH::Character::EGroundState::OnGround)
-			new_velocity += JPH::Vec3(0, jumpSpeed, 0);
+	std::stringstream stream(std::string(shape._binary.begin(), shape._binary.end()));
+	JPH::StreamInWrapper streamIn(stream);
+	auto res = JPH::Shape::sRestoreWithChildren(streamIn, shapeMap, materialMap);
 
-		// Update the velocity
-		character->SetLinearVelocity(new_velocity);
+	if (res.HasError()) {
+		printf("Could not restore recorded shape: %s\n", res.GetError().c_str());
+		return nullptr;
 	}
+
+	return res.Get();
+}
+
+bool PhysicsJoltImpl::tickPose(const util::Uuid& node, glm::vec3& position, glm::quat& rotation) const
+{
+	JPH::BodyID bodyId;
+
+	auto bodyIt = _bodyMap.find(node);
+	auto charIt = _charIndices.find(node);
+	if (bodyIt != _bodyMap.end()) {
+		bodyId = bodyIt->second;
+	}
+	else if (charIt != _charIndices.end()) {
+		bodyId = _characters[charIt->second]._character->GetInnerBodyID();
+	}
+	else {
+		return false;
+	}
+
+	auto index = bodyId.GetIndex();
+	if (index >= _bodyTable.size() || _bodyTable[index]._bodyId != bodyId) {
+		return false;
+	}
+
+	position = jphVecToGlm(_bodyTable[index]._tickPos);
+	rotation = jphQuatToGlm(_bodyTable[index]._tickRot);
+	return true;
+}
+
+std::uint32_t PhysicsJoltImpl::recordShape(const JPH::ShapeRefC& shape)
+{
+	auto it = _recordedShapeIndices.find(shape.GetPtr());
+	if (it != _recordedShapeIndices.end()) {
+		return it->second;
+	}
+
+	RecordedShape recorded{};
+	switch (shape->GetSubType()) {
+	case JPH::EShapeSubType::Sphere:
+		recorded._type = RecordedShape::Sphere;
+		recorded._params.x = static_cast<const JPH::SphereShape*>(shape.GetPtr())->GetRadius();
+		break;
+	case JPH::EShapeSubType::Box:
+	{
+		recorded._type = RecordedShape::Box;
+		auto halfExtent = static_cast<const JPH::BoxShape*>(shape.GetPtr())->GetHalfExtent();
+		recorded._params = glm::vec3(halfExtent.GetX(), halfExtent.GetY(), halfExtent.GetZ());
+		break;
+	}
+	case JPH::EShapeSubType::Capsule:
+	{
+		recorded._type = RecordedShape::Capsule;
+		auto* capsule = static_cast<const JPH::CapsuleShape*>(shape.GetPtr());
+		recorded._params = glm::vec3(capsule->GetHalfHeightOfCylinder(), capsule->GetRadius(), 0.0f);
+		break;
+	}
+	default:
+	{
+		// Meshes and heightfields, these are tied to Jolt's binary format
+		recorded._type = RecordedShape::Binary;
+
+		std::stringstream stream;
+		JPH::StreamOutWrapper streamOut(stream);
+		shape->SaveWithChildren(streamOut, _recordedShapeIds, _recordedMaterialIds);
+
+		auto str = stream.str();
+		recorded._binary.assign(str.begin(), str.end());
+		break;
+	}
+	}
+
+	auto index = (std::uint32_t)_recording->_shapes.size();
+	_recording->_shapes.emplace_back(std::move(recorded));
+	_recordedShapeIndices[shape.GetPtr()] = index;
+	_recordedShapes.emplace_back(shape);
+	return index;
+}
+
+void PhysicsJoltImpl::recordInitialState()
+{
+	// Shapes first, bodies and chars are created from them
+	for (auto& [node, shape] : _shapeMap) {
+		auto op = recordedOp(RecordedOp::SetShape, node);
+		op._shape = recordShape(shape);
+		_recording->_ops.emplace_back(std::move(op));
+	}
+
+	// The rigid body components aren't kept, so they are read back from the bodies
+	auto& lockInterface = _physicsSystem.GetBodyLockInterface();
+	auto recordBody = [this, &lockInterface](const BodyTableEntry& entry, std::vector<RecordedOp>* velocities) {
+		JPH::BodyLockRead lock(lockInterface, entry._bodyId);
+		if (!lock.Succeeded()) return;
+
+		auto& body = lock.GetBody();
+		auto op = recordedOp(RecordedOp::AddBody, entry._node);
+		op._userData = entry._userData;
+		op._transform = jphMatToGlm(body.GetWorldTransform());
+		op._rigid._motionType = body.IsStatic() ? component::RigidBody::Static : (body.IsKinematic() ? component::RigidBody::Kinematic : component::RigidBody::Dynamic);
+		op._rigid._friction = body.GetFriction();
+		op._rigid._restitution = body.GetRestitution();
+
+		if (auto* mp = body.GetMotionProperties()) {
+			op._rigid._linearDamping = mp->GetLinearDamping();
+			op._rigid._angularDamping = mp->GetAngularDamping();
+			op._rigid._gravityFactor = mp->GetGravityFactor();
+			if (mp->GetInverseMass() > 0.0f) {
+				op._rigid._mass = 1.0f / mp->GetInverseMass();
+			}
+
+			if (velocities) {
+				auto velocity = recordedOp(RecordedOp::SetVelocity, entry._node);
+				velocity._linearVelocity = jphVecToGlm(mp->GetLinearVelocity());
+				velocity._angularVelocity = jphVecToGlm(mp->GetAngularVelocity());
+				velocities->emplace_back(std::move(velocity));
+			}
+		}
+
+		_recording->_ops.emplace_back(std::move(op));
+	};
+
+	// Bodies in the simulation are flushed right away. Queued ones haven't moved yet, and are left for the next flushBodyAdds as they are now.
+	std::vector<RecordedOp> velocities;
+	for (auto& entry : _bodyTable) {
+		if (!entry._bodyId.IsInvalid() && !entry._character && !entry._queued) {
+			recordBody(entry, &velocities);
+		}
+	}
+	_recording->_ops.emplace_back(recordedOp(RecordedOp::FlushAdds));
+
+	for (auto& bodyId : _bodiesToAdd) {
+		recordBody(_bodyTable[bodyId.GetIndex()], nullptr);
+	}
+
+	for (auto& c : _characters) {
+		auto op = recordedOp(RecordedOp::AddCharacter, c._node);
+		op._userData = c._userData;
+		op._transform = jphMatToGlm(JPH::RMat44::sRotationTranslation(c._character->GetRotation(), c._character->GetPosition()));
+		op._char._mass = c._character->GetMass();
+		op._char._maxStepHeight = c._maxStepHeight;
+		op._char._groundSnapDistance = c._groundSnapDistance;
+		_recording->_ops.emplace_back(std::move(op));
+
+		auto desired = recordedOp(RecordedOp::DesiredVelocity, c._node);
+		desired._char._desiredLinearVelocity = c._desiredVelocity;
+		desired._char._jumpSpeed = c._jumpSpeed;
+		desired._char._speed = c._speed;
+		_recording->_ops.emplace_back(std::move(desired));
+
+		auto velocity = recordedOp(RecordedOp::SetVelocity, c._node);
+		velocity._linearVelocity = jphVecToGlm(c._character->GetLinearVelocity());
+		velocities.emplace_back(std::move(velocity));
+	}
+
+	_recording->_ops.insert(_recording->_ops.end(), velocities.begin(), velocities.end());
 }
 
 void PhysicsJoltImpl::debugSphere()
@@ -447,8 +1638,22 @@ void PhysicsJoltImpl::debugSphere()
 
 void PhysicsJoltImpl::setShapeBodyOrChar(const util::Uuid& node)
 {
+	// Every way of giving a node a shape ends up here
+	if (_recording) {
+		auto op = recordedOp(RecordedOp::SetShape, node);
+		op._shape = recordShape(_shapeMap[node]);
+		_recording->_ops.emplace_back(std::move(op));
+	}
+
 	if (isBodyKnown(node)) {
 		auto& bi = _physicsSystem.GetBodyInterface();
+
+		// Queued bodies can't be activated, they will be when added
+		if (_bodyTable[_bodyMap[node].GetIndex()]._queued) {
+			bi.SetShape(_bodyMap[node], _shapeMap[node], false, JPH::EActivation::DontActivate);
+			return;
+		}
+
 		bi.SetShape(_bodyMap[node], _shapeMap[node], false, JPH::EActivation::Activate);
 
 		if (!bi.IsAdded(_bodyMap[node])) {
@@ -456,10 +1661,81 @@ void PhysicsJoltImpl::setShapeBodyOrChar(const util::Uuid& node)
 		}
 	}
 	else if (isCharKnown(node)) {
-		_charMap[node]->SetShape(_shapeMap[node], FLT_MAX);
+		auto& character = _characters[_charIndices[node]]._character;
+
+		// FLT_MAX skips the penetration check, so this always succeeds
+		character->SetShape(
+			_shapeMap[node],
+			FLT_MAX,
+			_physicsSystem.GetDefaultBroadPhaseLayerFilter(Layers::MOVING),
+			_physicsSystem.GetDefaultLayerFilter(Layers::MOVING),
+			JPH::BodyFilter(),
+			JPH::ShapeFilter(),
+			*_tempAllocator);
+		character->SetInnerBodyShape(_shapeMap[node]);
+	}
+}
+
+bool PhysicsJoltImpl::isCharacterBody(const JPH::BodyID& bodyId) const
+{
+	auto index = bodyId.GetIndex();
+	return index < _bodyTable.size() && _bodyTable[index]._bodyId == bodyId && _bodyTable[index]._character;
+}
+
+void PhysicsJoltImpl::fillInHit(const JPH::BodyID& bodyId, QueryHit& hit) const
+{
+	hit._hit = true;
+
+	// Bodies not made by us (like the debug sphere) have no node
+	auto index = bodyId.GetIndex();
+	if (index < _bodyTable.size() && _bodyTable[index]._bodyId == bodyId) {
+		hit._node = _bodyTable[index]._node;
+		hit._userData = _bodyTable[index]._userData;
+	}
+}
+
+void PhysicsJoltImpl::addToBodyTable(const JPH::BodyID& bodyId, const util::Uuid& node, std::uint64_t userData, bool character)
+{
+	auto index = bodyId.GetIndex();
+	if (index >= _bodyTable.size()) {
+		_bodyTable.resize(index + 1);
+	}
+
+	auto& entry = _bodyTable[index];
+	bool pending = entry._pending;
+	entry = BodyTableEntry{};
+	entry._bodyId = bodyId;
+	entry._node = node;
+	entry._userData = userData;
+	entry._character = character;
+	entry._pending = pending;
+
+	resetTickPose(bodyId);
+}
+
+void PhysicsJoltImpl::removeFromBodyTable(const JPH::BodyID& bodyId)
+{
+	auto index = bodyId.GetIndex();
+	if (index < _bodyTable.size() && _bodyTable[index]._bodyId == bodyId) {
+		bool pending = _bodyTable[index]._pending;
+		_bodyTable[index] = BodyTableEntry{};
+		_bodyTable[index]._pending = pending;
 	}
 }
 
+void PhysicsJoltImpl::resetTickPose(const JPH::BodyID& bodyId)
+{
+	auto index = bodyId.GetIndex();
+	if (index >= _bodyTable.size() || _bodyTable[index]._bodyId != bodyId) return;
+
+	auto& bi = _physicsSystem.GetBodyInterface();
+	auto& entry = _bodyTable[index];
+	entry._tickPos = entry._character ? bi.GetPosition(bodyId) : bi.GetCenterOfMassPosition(bodyId);
+	entry._tickRot = bi.GetRotation(bodyId);
+	entry._prevPos = entry._lastPos = entry._tickPos;
+	entry._prevRot = entry._lastRot = entry._tickRot;
+}
+
 }
 
 
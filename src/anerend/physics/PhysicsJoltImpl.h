@@ -3,6 +3,9 @@
 #include "../component/Components.h"
 #include "../render/asset/Texture.h" // For heightfields
 #include "../render/asset/Mesh.h"
+#include "TransformSyncInfo.h"
+#include "PhysicsQueries.h"
+#include "PhysicsRecording.h"
 
 #include <Jolt/Jolt.h>
 #include <Jolt/Core/Memory.h>
@@ -14,21 +17,21 @@
 #include <Jolt/Core/JobSystemThreadPool.h>
 #include <Jolt/Renderer/DebugRenderer.h>
 #include <Jolt/Physics/PhysicsSystem.h>
-#include <Jolt/Physics/Character/Character.h>
+#include <Jolt/Physics/Character/CharacterVirtual.h>
+#include <Jolt/Physics/Collision/Shape/Shape.h>
 
 #include <glm/glm.hpp>
 
+#include <cstdint>
+#include <functional>
+#include <future>
 #include <unordered_map>
 #include <iostream>
+#include <memory>
+#include <vector>
 
 namespace physics {
 
-struct TransformSyncInfo
-{
-	util::Uuid _node;
-	glm::mat4 _global;
-};
-
 namespace Layers
 {
 	static constexpr JPH::ObjectLayer NON_MOVING = 0;
@@ -169,6 +172,32 @@ public:
 	}
 };
 
+class PhysicsJoltImpl;
+
+// Shared by all characters. Characters collide with each other through their inner (kinematic) bodies.
+class CharacterContactListenerImpl : public JPH::CharacterContactListener
+{
+public:
+	explicit CharacterContactListenerImpl(const PhysicsJoltImpl* impl) : _impl(impl) {}
+
+	virtual bool OnContactValidate(const JPH::CharacterVirtual* inCharacter, const JPH::BodyID& inBodyID2, const JPH::SubShapeID& inSubShapeID2) override;
+
+	virtual void OnContactAdded(const JPH::CharacterVirtual* inCharacter, const JPH::BodyID& inBodyID2, const JPH::SubShapeID& inSubShapeID2, JPH::RVec3Arg inContactPosition, JPH::Vec3Arg inContactNormal, JPH::CharacterContactSettings& ioSettings) override;
+
+private:
+	const PhysicsJoltImpl* _impl;
+};
+
+// Input for a heightfield shape, see PhysicsJoltImpl::addHeightFieldAsync
+struct HeightFieldSamples
+{
+	std::vector<float> _heights; // _sampleCount * _sampleCount, rows along z
+	unsigned _sampleCount = 0;
+	float _sampleSpacing = 1.0f; // Meters between samples
+	unsigned _blockSize = 4;
+	unsigned _bitsPerSample = 8;
+};
+
 class PhysicsJoltImpl
 {
 public:
@@ -180,9 +209,11 @@ public:
   PhysicsJoltImpl(PhysicsJoltImpl&&) = delete;
   PhysicsJoltImpl& operator=(PhysicsJoltImpl&&) = delete;
 
+	// Sets up Jolt's allocator, factory and types. Only the first call does anything, they stay until the process exits.
 	static void staticInit();
   void init();
 
+	// Moves the characters, in parallel
 	void preUpdate(double delta);
 
 	// Steps the simulation
@@ -193,8 +224,27 @@ public:
 	// Set velocities of all known bodies (and character controllers) to 0.
 	void resetVelocities();
 
-	// Upstream: Syncs the physics world for all known and active bodies
-	std::vector<TransformSyncInfo> retrieveCurrentTransforms();
+	// Records the poses of all active bodies after a tick, to interpolate between in retrieveMovedTransforms.
+	// Call after every update().
+	void captureTickPoses();
+
+	// Upstream: Fills out with the bodies and chars whose pose moved since the last call.
+	// Poses are interpolated between the last two ticks, alpha 0 is the previous tick and 1 the latest.
+	// Only bodies that were active in a tick since the last call are looked at, and they are processed in parallel.
+	void retrieveMovedTransforms(std::vector<TransformSyncInfo>& out, float alpha = 1.0f);
+
+	// Runs func over [0, count) in chunks on the physics job system, and waits for it.
+	// Must not be called while the simulation is stepping.
+	void parallelFor(std::size_t count, std::size_t chunkSize, const std::function<void(std::size_t, std::size_t)>& func);
+
+	// Batched scene queries, run in parallel on the physics job system. Results are in the same order as the queries.
+	// Only bodies in the simulation (see flushBodyAdds) are hit. Must not be called while the simulation is stepping.
+	// Main thread only, overlap() gathers its hits in per-instance scratch (_chunkHits).
+	void castRays(const std::vector<RayQuery>& queries, std::vector<QueryHit>& results);
+	// Closest hit of each sweep
+	void castShapes(const std::vector<ShapeCastQuery>& queries, std::vector<QueryHit>& results);
+	// Every body touching each shape, the hits of query i are hits[results[i]._firstHit, + results[i]._numHits)
+	void overlap(const std::vector<OverlapQuery>& queries, std::vector<OverlapResult>& results, std::vector<QueryHit>& hits);
 
 	// Draws as much debug information as possible about the current state (immediate mode)
 	void debugDraw(JPH::DebugRenderer* renderer);
@@ -208,8 +258,13 @@ public:
 	// Do we have a character controller for this node
 	bool isCharKnown(util::Uuid node) const;
 
+	// Is a shape being built on a worker for this node
+	bool isShapePending(util::Uuid node) const;
+
 	// Will remove shape and body/char for the given node
 	void remove(util::Uuid node);
+	// Same for many nodes, bodies are removed from the simulation in one go
+	void remove(const std::vector<util::Uuid>& nodes);
 
 	// Will remove the character completely
 	void removeChar(util::Uuid node);
@@ -218,13 +273,43 @@ public:
 	void addSphere(float radius, util::Uuid node);
 	void addBox(const glm::vec3& halfExtent, util::Uuid node);
 	void addCapsule(float halfHeight, float radius, util::Uuid node);
-	void addMesh(const render::asset::Mesh& mesh, util::Uuid node);
-
-	// Add body
-	void addRigidBody(const component::RigidBody& rigidComp, const glm::mat4& transform, util::Uuid node);
+	// Mesh shapes are cached on mesh id and scale, so every node using the same mesh shares one BVH.
+	// addCachedMesh returns false (and adds nothing) if the mesh isn't in the cache yet, in which case addMesh is needed.
+	// If the mesh has a baked shape (see bakeMeshShape) that is used instead of building it from the triangles.
+	void addMesh(const render::asset::Mesh& mesh, const glm::vec3& scale, util::Uuid node);
+	bool addCachedMesh(const util::Uuid& meshId, const glm::vec3& scale, util::Uuid node);
+	// The mesh changed, the next addMesh builds its shape again. Nodes keep their old shape until then.
+	void evictMeshShape(const util::Uuid& meshId);
+
+	// Heightfields are built on a worker thread, fetchSamples runs there aswell so it may do blocking loads.
+	// The shape is set on the node (and its body, if there is one already) in pollHeightFields once it is built.
+	// Requesting again while a build is pending replaces it.
+	void addHeightFieldAsync(std::function<bool(HeightFieldSamples&)> fetchSamples, util::Uuid node);
+	// Fills readyNodes with the nodes that got their heightfield shape in this call.
+	void pollHeightFields(std::vector<util::Uuid>& readyNodes);
+
+	// Drops cached shapes that no node uses anymore. Cheap if nothing was removed since last time.
+	void pruneShapeCache();
+	std::size_t numCachedShapes() const { return _meshShapeCache.size() + _scaledShapeCache.size(); }
+
+	// Builds the Jolt MeshShape for mesh and saves it in binary form, to be stored in Mesh::_bakedCollisionShape.
+	// Requires staticInit() to have been called.
+	static bool bakeMeshShape(const render::asset::Mesh& mesh, std::vector<std::uint8_t>& out);
+
+	// Add body. userData is set on the Jolt body and handed back in TransformSyncInfo.
+	// The body is created right away, but only added to the simulation (together with all others) by flushBodyAdds.
+	void addRigidBody(const component::RigidBody& rigidComp, const glm::mat4& transform, util::Uuid node, std::uint64_t userData = 0);
+
+	// Adds all bodies created since last time to the simulation, in batches whose broadphase trees are built in parallel.
+	// Has to be called before stepping.
+	void flushBodyAdds();
+
+	// Rebuilds the broadphase trees if at least minBodyChanges bodies were added or removed since last time,
+	// and at least minInterval seconds (summed deltas) have passed. Returns if it ran.
+	bool optimizeBroadPhaseIfNeeded(double delta, std::size_t minBodyChanges, double minInterval);
 
 	// Add character controllers.
-	void addCharacterController(const component::CharacterController& comp, const glm::mat4& transform, util::Uuid node);
+	void addCharacterController(const component::CharacterController& comp, const glm::mat4& transform, util::Uuid node, std::uint64_t userData = 0);
 
 	// Update colliders
 	void updateSphere(float radius, util::Uuid node);
@@ -238,24 +323,167 @@ public:
 	// Downstream: Syncs a given body with a new orientation and translation.
 	void setPositionAndOrientation(const util::Uuid& node, glm::quat rot, glm::vec3 trans);
 
+	// Characters are kept in a dense array, index order changes when characters are removed.
+	std::size_t numCharacters() const { return _characters.size(); }
+	std::uint64_t characterUserData(std::size_t index) const { return _characters[index]._userData; }
+
 	// Sets desired velocity of a char. Needs to be called before stepping the simulation!
-	void setDesiredVelocity(const glm::vec3& desiredVel, float jumpSpeed, float speed, const util::Uuid& node);
+	void setDesiredVelocity(std::size_t index, const glm::vec3& desiredVel, float jumpSpeed, float speed);
+
+	// Records the bodies in the world now, and every input from here on, into recording until stopRecording.
+	void startRecording(PhysicsRecording* recording);
+	void stopRecording();
+
+	// Makes a recorded input again, see PhysicsReplay. shapes are the recording's shapes made by createRecordedShape.
+	void replay(const RecordedOp& op, const std::vector<JPH::ShapeRefC>& shapes);
+	// Binary shapes share children and materials with the ones saved before them in the recording,
+	// so all shapes have to be created in recording order with the same maps.
+	static JPH::ShapeRefC createRecordedShape(const RecordedShape& shape, JPH::Shape::IDToShapeMap& shapeMap, JPH::Shape::IDToMaterialMap& materialMap);
+
+	// Pose of the node's body or char in the last tick, same as in RecordedPose
+	bool tickPose(const util::Uuid& node, glm::vec3& position, glm::quat& rotation) const;
 
 	void debugSphere();
 
 private:
+	friend class CharacterContactListenerImpl;
+
 	void setShapeBodyOrChar(const util::Uuid& node);
 
+	// addRigidBody without recording, for when a body is recreated
+	void createRigidBody(const component::RigidBody& rigidComp, const glm::mat4& transform, util::Uuid node, std::uint64_t userData);
+
+	// Index of the shape in the recording, added the first time it is seen
+	std::uint32_t recordShape(const JPH::ShapeRefC& shape);
+	// Ops that recreate what is in the world right now
+	void recordInitialState();
+
+	// Is the body the inner body of a character
+	bool isCharacterBody(const JPH::BodyID& bodyId) const;
+
+	// Sets node and user data of the hit from the body table
+	void fillInHit(const JPH::BodyID& bodyId, QueryHit& hit) const;
+
+	void addToBodyTable(const JPH::BodyID& bodyId, const util::Uuid& node, std::uint64_t userData, bool character);
+	void removeFromBodyTable(const JPH::BodyID& bodyId);
+	// After a teleport, so that it doesn't interpolate from the old pose or get synced back upstream
+	void resetTickPose(const JPH::BodyID& bodyId);
+	// Removes (if added) and destroys the bodies. Reorders bodyIds.
+	void destroyBodies(std::vector<JPH::BodyID>& bodyIds);
+
+	static JPH::ShapeRefC createMeshShape(const render::asset::Mesh& mesh);
+	static JPH::ShapeRefC createHeightFieldShape(const HeightFieldSamples& samples);
+	// Forgets a pending heightfield build, it finishes in the background
+	void abandonHeightField(util::Uuid node);
+	JPH::ShapeRefC scaledMeshShape(const util::Uuid& meshId, const JPH::ShapeRefC& meshShape, const glm::vec3& scale);
+
+	struct ScaledShapeKey
+	{
+		util::Uuid _meshId;
+		std::int32_t _scale[3]; // Quantized, so that practically equal scales share a shape
+
+		bool operator==(const ScaledShapeKey& other) const
+		{
+			return _meshId == other._meshId && _scale[0] == other._scale[0] && _scale[1] == other._scale[1] && _scale[2] == other._scale[2];
+		}
+	};
+
+	struct ScaledShapeKeyHash
+	{
+		std::size_t operator()(const ScaledShapeKey& key) const
+		{
+			std::size_t h = std::hash<util::Uuid>()(key._meshId);
+			for (auto s : key._scale) {
+				h ^= std::hash<std::int32_t>()(s) + 0x9e3779b9 + (h << 6) + (h >> 2);
+			}
+			return h;
+		}
+	};
+
+	struct VirtualCharacter
+	{
+		JPH::Ref<JPH::CharacterVirtual> _character;
+		util::Uuid _node;
+		std::uint64_t _userData = 0;
+		glm::vec3 _desiredVelocity = glm::vec3(0.0f);
+		float _speed = 1.0f;
+		float _jumpSpeed = 0.0f;
+		float _maxStepHeight = 0.4f;
+		float _groundSnapDistance = 0.5f;
+		JPH::Vec3 _horizontalVelocity = JPH::Vec3::sZero(); // Eases towards the desired velocity
+	};
+
+	void updateCharacters(float delta);
+	static void updateCharacterVelocity(VirtualCharacter& c, float delta, JPH::Vec3Arg gravity);
+
+	// Tick poses and last synced pose of a body (or the inner body of a char).
+	// Positions are the center of mass for bodies and the origin for chars, as that is what is synced upstream.
+	struct BodyTableEntry
+	{
+		JPH::BodyID _bodyId; // Invalid if the slot is unused
+		util::Uuid _node;
+		std::uint64_t _userData = 0;
+		bool _character = false; // Pose is captured from the character, not the body
+		bool _pending = false; // In _pendingSync, kept separate from the body since slots are reused
+		bool _queued = false; // Created but waiting for flushBodyAdds
+		std::uint64_t _tick = 0; // Last tick the pose was captured in
+		JPH::RVec3 _prevPos;
+		JPH::Quat _prevRot;
+		JPH::RVec3 _tickPos;
+		JPH::Quat _tickRot;
+		JPH::RVec3 _lastPos;
+		JPH::Quat _lastRot;
+	};
+
 	std::unordered_map<util::Uuid, JPH::BodyID> _bodyMap;
-	std::unordered_map<util::Uuid, JPH::Ref<JPH::Shape>> _shapeMap;
-	std::unordered_map<util::Uuid, JPH::Ref<JPH::Character>> _charMap;
+	std::unordered_map<util::Uuid, JPH::ShapeRefC> _shapeMap;
+
+	// Dense, indexed by JPH::BodyID::GetIndex() so that active body ids map straight to it
+	std::vector<BodyTableEntry> _bodyTable;
+	JPH::BodyIDVector _activeBodies;
+	std::vector<std::size_t> _chunkMoved;
+	std::uint64_t _numTicks = 0;
+
+	// Table indices that ticked since the last upstream sync, or are still interpolating
+	std::vector<std::uint32_t> _pendingSync;
+
+	// Overlap hits per parallelFor chunk, before they are concatenated. Shared by all callers, hence main thread only.
+	std::vector<std::vector<QueryHit>> _chunkHits;
+
+	std::vector<JPH::BodyID> _bodiesToAdd;
+	std::vector<JPH::BodyID> _bodiesToRemove;
+	std::vector<JPH::BodyInterface::AddState> _addStates;
+	std::size_t _numBodyChangesSinceOptimize = 0;
+	double _timeSinceOptimize = 0.0;
+
+	// Unscaled mesh shapes per mesh id, and the scaled versions of them actually used by nodes
+	std::unordered_map<util::Uuid, JPH::ShapeRefC> _meshShapeCache;
+	std::unordered_map<ScaledShapeKey, JPH::ShapeRefC, ScaledShapeKeyHash> _scaledShapeCache;
+	bool _shapeCacheDirty = false;
+
+	// Heightfield shapes being built, and builds that were replaced or whose node was removed
+	std::unordered_map<util::Uuid, std::future<JPH::ShapeRefC>> _pendingHeightFields;
+	std::vector<std::future<JPH::ShapeRefC>> _abandonedHeightFields;
+
+	// Dense, swap-removed. Character updates run in parallel over it.
+	std::vector<VirtualCharacter> _characters;
+	std::unordered_map<util::Uuid, std::uint32_t> _charIndices;
+	std::vector<std::unique_ptr<JPH::TempAllocatorImpl>> _charTempAllocators; // One per parallel chunk, they are not thread safe
+	CharacterContactListenerImpl _charContactListener;
+
+	// Null when not recording. Shapes are kept alive while recording, so that their pointers aren't reused.
+	PhysicsRecording* _recording = nullptr;
+	std::unordered_map<const JPH::Shape*, std::uint32_t> _recordedShapeIndices;
+	std::vector<JPH::ShapeRefC> _recordedShapes;
+	// Children and materials already in the recording, so that f.ex. scaled versions of a mesh don't save it again
+	JPH::Shape::ShapeToIDMap _recordedShapeIds;
+	JPH::Shape::MaterialToIDMap _recordedMaterialIds;
 
 	JPH::TempAllocatorImpl* _tempAllocator = nullptr;
 	JPH::JobSystemThreadPool* _jobSystem = nullptr;
 
 	// This is the max amount of rigid bodies that you can add to the physics system. If you try to add more you'll get an error.
-// Note: This value is low because this is a simple test. For a real project use something in the order of 65536.
-	const unsigned _maxBodies = 1024;
+	const unsigned _maxBodies = 65536;
 
 	// This determines how many mutexes to allocate to protect rigid bodies from concurrent access. Set it to 0 for the default settings.
 	const unsigned _numBodyMutexes = 0;
@@ -263,13 +491,11 @@ private:
 	// This is the max amount of body pairs that can be queued at any time (the broad phase will detect overlapping
 	// body pairs based on their bounding boxes and will insert them into a queue for the narrowphase). If you make this buffer
 	// too small the queue will fill up and the broad phase jobs will start to do narrow phase work. This is slightly less efficient.
-	// Note: This value is low because this is a simple test. For a real project use something in the order of 65536.
-	const unsigned _maxBodyPairs = 1024;
+	const unsigned _maxBodyPairs = 65536;
 
 	// This is the maximum size of the contact constraint buffer. If more contacts (collisions between bodies) are detected than this
 	// number then these contacts will be ignored and bodies will start interpenetrating / fall through the world.
-	// Note: This value is low because this is a simple test. For a real project use something in the order of 10240.
-	const unsigned _maxContactConstraints = 1024;
+	const unsigned _maxContactConstraints = 10240;
 
 	// Create mapping table from object layer to broadphase layer
 	physics::BPLayerInterfaceImpl _broadPhaseLayerIF;
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "../util/Uuid.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <cstdint>
+
+namespace physics {
+
+// Which bodies a query can hit
+enum QueryLayer : std::uint8_t
+{
+  QueryLayerStatic = 1 << 0, // Static rigid bodies
+  QueryLayerMoving = 1 << 1, // Dynamic and kinematic rigid bodies, and characters
+  QueryLayerAll = QueryLayerStatic | QueryLayerMoving
+};
+
+struct QueryShape
+{
+  enum Type : std::uint8_t {
+    Sphere,
+    Box
+  } _type = Type::Sphere;
+
+  float _radius = 0.5f;
+  glm::vec3 _halfExtent = glm::vec3(0.5f);
+  glm::quat _rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+};
+
+struct RayQuery
+{
+  glm::vec3 _origin = glm::vec3(0.0f);
+  glm::vec3 _direction = glm::vec3(0.0f, -1.0f, 0.0f); // Length is the max distance
+  std::uint8_t _layerMask = QueryLayerAll;
+};
+
+// Sweeps the shape from _start along _direction
+struct ShapeCastQuery
+{
+  QueryShape _shape;
+  glm::vec3 _start = glm::vec3(0.0f);
+  glm::vec3 _direction = glm::vec3(0.0f, -1.0f, 0.0f); // Length is the max distance
+  std::uint8_t _layerMask = QueryLayerAll;
+};
+
+struct OverlapQuery
+{
+  QueryShape _shape;
+  glm::vec3 _position = glm::vec3(0.0f);
+  std::uint8_t _layerMask = QueryLayerAll;
+};
+
+struct QueryHit
+{
+  bool _hit = false;
+  util::Uuid _node;
+  std::uint64_t _userData = 0; // Whatever was given when adding the body/char
+  float _fraction = 1.0f; // Of the direction, 0 for overlaps
+  glm::vec3 _position = glm::vec3(0.0f);
+  glm::vec3 _normal = glm::vec3(0.0f); // Surface normal for rays, pointing out of the hit body for shapes
+};
+
+// The hits of one overlap query, a range in the hit list
+struct OverlapResult
+{
+  std::uint32_t _firstHit = 0;
+  std::uint32_t _numHits = 0;
+};
+
+}
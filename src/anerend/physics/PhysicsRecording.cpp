@@ -0,0 +1,169 @@
+#include "PhysicsRecording.h"
+
+#include "../render/serialisation/Serialisation.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+
+namespace {
+
+// Generous, these only guard against reading garbage
+const std::size_t g_MaxShapes = 1 << 20;
+const std::size_t g_MaxShapeBytes = 1 << 28;
+const std::size_t g_MaxOps = 1 << 28;
+const std::size_t g_MaxNodes = 1 << 20;
+const std::size_t g_MaxPoseSamples = 1 << 24;
+const std::size_t g_MaxPoses = 1 << 20;
+
+}
+
+namespace bitsery {
+
+template <typename S>
+void serialize(S& s, physics::RecordedShape& p)
+{
+  s.value1b(p._type);
+  if (p._type == physics::RecordedShape::Binary) {
+    s.container1b(p._binary, g_MaxShapeBytes);
+  }
+  else {
+    s.object(p._params);
+  }
+}
+
+// Only what the type of op uses is written
+template <typename S>
+void serialize(S& s, physics::RecordedOp& p)
+{
+  s.value1b(p._type);
+
+  switch (p._type) {
+  case physics::RecordedOp::SetShape:
+    s.object(p._node);
+    s.value4b(p._shape);
+    break;
+  case physics::RecordedOp::AddBody:
+    s.object(p._node);
+    s.value8b(p._userData);
+    s.object(p._transform);
+    s.object(p._rigid);
+    break;
+  case physics::RecordedOp::UpdateBody:
+    s.object(p._node);
+    s.object(p._rigid);
+    break;
+  case physics::RecordedOp::AddCharacter:
+    s.object(p._node);
+    s.value8b(p._userData);
+    s.object(p._transform);
+    s.object(p._char);
+    break;
+  case physics::RecordedOp::UpdateCharacter:
+  case physics::RecordedOp::DesiredVelocity:
+    s.object(p._node);
+    s.object(p._char);
+    break;
+  case physics::RecordedOp::Remove:
+    s.object(p._node);
+    break;
+  case physics::RecordedOp::RemoveBulk:
+    s.container(p._nodes, g_MaxNodes);
+    break;
+  case physics::RecordedOp::Teleport:
+    s.object(p._node);
+    s.object(p._rotation);
+    s.object(p._position);
+    break;
+  case physics::RecordedOp::SetVelocity:
+    s.object(p._node);
+    s.object(p._linearVelocity);
+    s.object(p._angularVelocity);
+    break;
+  case physics::RecordedOp::Tick:
+    s.value8b(p._delta);
+    break;
+  case physics::RecordedOp::FlushAdds:
+  case physics::RecordedOp::OptimizeBroadPhase:
+  case physics::RecordedOp::ResetVelocities:
+    break;
+  }
+}
+
+template <typename S>
+void serialize(S& s, physics::RecordedPose& p)
+{
+  s.object(p._node);
+  s.object(p._position);
+  s.object(p._rotation);
+}
+
+template <typename S>
+void serialize(S& s, physics::RecordedPoseSample& p)
+{
+  s.value8b(p._tick);
+  s.container(p._poses, g_MaxPoses);
+}
+
+template <typename S>
+void serialize(S& s, physics::PhysicsRecording& p)
+{
+  s.value4b(p._poseInterval);
+  s.value8b(p._numTicks);
+  s.container(p._shapes, g_MaxShapes);
+  s.container(p._ops, g_MaxOps);
+  s.container(p._poseSamples, g_MaxPoseSamples);
+}
+
+}
+
+namespace physics {
+
+bool PhysicsRecording::write(const std::filesystem::path& path) const
+{
+  std::ofstream ofs(path, std::ios::binary);
+  if (!ofs) {
+    printf("Could not open %s for writing physics recording!\n", path.string().c_str());
+    return false;
+  }
+
+  // Components are written in the current version, which is kept first in the file
+  serialisation::setDeserialisedVersion(g_CurrVersion);
+  auto data = serialisation::serializeToVector(*this);
+
+  ofs.write(reinterpret_cast<const char*>(&g_CurrVersion), sizeof(g_CurrVersion));
+  ofs.write(reinterpret_cast<const char*>(data.data()), data.size());
+
+  return (bool)ofs;
+}
+
+bool PhysicsRecording::read(const std::filesystem::path& path)
+{
+  std::ifstream ifs(path, std::ios::binary);
+  if (!ifs) {
+    printf("Could not open physics recording %s!\n", path.string().c_str());
+    return false;
+  }
+
+  std::uint16_t version = 0;
+  ifs.read(reinterpret_cast<char*>(&version), sizeof(version));
+  if (!ifs || version > g_CurrVersion) {
+    printf("Physics recording %s has an unknown version!\n", path.string().c_str());
+    return false;
+  }
+
+  std::vector<std::uint8_t> data((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+
+  serialisation::setDeserialisedVersion(version);
+  auto recording = serialisation::deserializeVector<PhysicsRecording>(data);
+  if (!recording) {
+    printf("Could not read physics recording %s!\n", path.string().c_str());
+    return false;
+  }
+
+  *this = std::move(recording.value());
+  return true;
+}
+
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "../util/Uuid.h"
+#include "../component/Components.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+namespace physics {
+
+// Collision shape used by recorded bodies. Primitives are kept as parameters, anything else as Jolt's binary shape state.
+struct RecordedShape
+{
+  enum Type : std::uint8_t {
+    Sphere,
+    Box,
+    Capsule,
+    Binary
+  } _type = Type::Sphere;
+
+  glm::vec3 _params = glm::vec3(0.0f); // Radius, half extent, or half height and radius
+  std::vector<std::uint8_t> _binary;
+};
+
+// One input to the physics world. Replaying them in order re-creates the simulation.
+struct RecordedOp
+{
+  enum Type : std::uint8_t {
+    SetShape,
+    AddBody,
+    UpdateBody,
+    AddCharacter,
+    UpdateCharacter,
+    Remove,
+    RemoveBulk,
+    FlushAdds,
+    OptimizeBroadPhase,
+    Teleport,
+    SetVelocity,
+    ResetVelocities,
+    DesiredVelocity,
+    Tick
+  } _type = Type::Tick;
+
+  util::Uuid _node;
+  std::vector<util::Uuid> _nodes; // RemoveBulk
+  std::uint64_t _userData = 0;
+  std::uint32_t _shape = 0; // Index into PhysicsRecording::_shapes
+  glm::mat4 _transform = glm::mat4(1.0f); // Adds
+  glm::quat _rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f); // Teleport
+  glm::vec3 _position = glm::vec3(0.0f); // Teleport
+  glm::vec3 _linearVelocity = glm::vec3(0.0f); // SetVelocity
+  glm::vec3 _angularVelocity = glm::vec3(0.0f); // SetVelocity
+  component::RigidBody _rigid;
+  component::CharacterController _char; // Also holds the desired velocity, speed and jump speed for DesiredVelocity
+  double _delta = 0.0; // Tick
+};
+
+// Position is the center of mass for bodies and the origin for characters
+struct RecordedPose
+{
+  util::Uuid _node;
+  glm::vec3 _position = glm::vec3(0.0f);
+  glm::quat _rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+};
+
+// Poses of the bodies that were active after a tick
+struct RecordedPoseSample
+{
+  std::uint64_t _tick = 0;
+  std::vector<RecordedPose> _poses;
+};
+
+/*
+* A captured physics scenario, see PhysicsSystem::startRecording and PhysicsReplay.
+* Starts with the bodies that were in the world when recording started, followed by every input in the order it was made.
+* Jolt state like contact caches and sleeping isn't included, so a replay can drift from the recorded poses.
+*/
+struct PhysicsRecording
+{
+  std::uint32_t _poseInterval = 30; // Ticks between pose samples
+  std::uint64_t _numTicks = 0;
+
+  std::vector<RecordedShape> _shapes;
+  std::vector<RecordedOp> _ops;
+  std::vector<RecordedPoseSample> _poseSamples;
+
+  bool write(const std::filesystem::path& path) const;
+  bool read(const std::filesystem::path& path);
+};
+
+}
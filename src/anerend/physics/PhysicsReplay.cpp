@@ -0,0 +1,118 @@
+#include "PhysicsReplay.h"
+
+#include "PhysicsJoltImpl.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+namespace physics {
+
+void ReplayReport::print() const
+{
+  printf("Physics replay: %llu ticks in %.2f ms\n", (unsigned long long)_numTicks, _totalTickMs);
+  printf("  Tick ms: mean %.3f, p50 %.3f, p95 %.3f, p99 %.3f, max %.3f\n", _tickMs._mean, _tickMs._p50, _tickMs._p95, _tickMs._p99, _tickMs._max);
+  printf("  Poses compared: %zu, missing: %zu\n", _numComparedPoses, _numMissingPoses);
+  printf("  Position error: mean %.5f m, max %.5f m. Max rotation error %.5f rad\n", _meanPositionError, _maxPositionError, _maxRotationError);
+
+  if (_firstDivergentTick >= 0) {
+    printf("  Diverged at tick %lld\n", (long long)_firstDivergentTick);
+  }
+  else {
+    printf("  No divergence\n");
+  }
+}
+
+bool PhysicsReplay::load(const std::filesystem::path& path)
+{
+  return _recording.read(path);
+}
+
+ReplayReport PhysicsReplay::run(float tolerance)
+{
+  ReplayReport report{};
+  // One more than the ticks, closing the last frame clears the oldest slot
+  _telemetry = std::make_unique<util::Telemetry>((std::size_t)_recording._numTicks + 1);
+
+  PhysicsJoltImpl::staticInit();
+  auto impl = std::make_unique<PhysicsJoltImpl>();
+  impl->init();
+
+  // Shared children are only saved the first time, so the maps are for the whole recording
+  JPH::Shape::IDToShapeMap shapeMap;
+  JPH::Shape::IDToMaterialMap materialMap;
+  std::vector<JPH::ShapeRefC> shapes;
+  shapes.reserve(_recording._shapes.size());
+  for (auto& shape : _recording._shapes) {
+    shapes.emplace_back(PhysicsJoltImpl::createRecordedShape(shape, shapeMap, materialMap));
+  }
+
+  double errorSum = 0.0;
+  std::size_t nextSample = 0;
+
+  for (auto& op : _recording._ops) {
+    if (op._type != RecordedOp::Tick) {
+      impl->replay(op, shapes);
+      continue;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    impl->replay(op, shapes);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    report._numTicks++;
+    report._totalTickMs += ms;
+    _telemetry->record("tick_ms", ms);
+    _telemetry->endFrame();
+
+    // Samples are in tick order, at most one per tick
+    while (nextSample < _recording._poseSamples.size() && _recording._poseSamples[nextSample]._tick < report._numTicks) {
+      nextSample++;
+    }
+    if (nextSample == _recording._poseSamples.size() || _recording._poseSamples[nextSample]._tick != report._numTicks) {
+      continue;
+    }
+
+    for (auto& pose : _recording._poseSamples[nextSample]._poses) {
+      glm::vec3 position;
+      glm::quat rotation;
+      if (!impl->tickPose(pose._node, position, rotation)) {
+        report._numMissingPoses++;
+        continue;
+      }
+
+      float positionError = glm::length(position - pose._position);
+      float rotationError = 2.0f * std::acos(std::min(std::abs(glm::dot(rotation, pose._rotation)), 1.0f));
+
+      report._numComparedPoses++;
+      errorSum += positionError;
+      report._maxPositionError = std::max(report._maxPositionError, positionError);
+      report._maxRotationError = std::max(report._maxRotationError, rotationError);
+
+      if (positionError > tolerance && report._firstDivergentTick < 0) {
+        report._firstDivergentTick = (std::int64_t)report._numTicks;
+      }
+    }
+  }
+
+  if (report._numComparedPoses > 0) {
+    report._meanPositionError = (float)(errorSum / report._numComparedPoses);
+  }
+  report._tickMs = _telemetry->stats("tick_ms");
+
+
+  return report;
+}
+
+bool PhysicsReplay::writeTimingsCsv(const std::filesystem::path& path) const
+{
+  if (!_telemetry) {
+    printf("Physics replay has no timings, it hasn't been run!\n");
+    return false;
+  }
+
+  return _telemetry->writeHistoryCsv(path);
+}
+
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "PhysicsRecording.h"
+#include "../util/Telemetry.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+
+namespace physics {
+
+struct ReplayReport
+{
+  std::uint64_t _numTicks = 0;
+  double _totalTickMs = 0.0;
+  util::GaugeStats _tickMs; // Per tick timings
+
+  std::size_t _numComparedPoses = 0;
+  std::size_t _numMissingPoses = 0; // Recorded poses of nodes that the replay has no body for
+  float _maxPositionError = 0.0f; // Meters
+  float _meanPositionError = 0.0f;
+  float _maxRotationError = 0.0f; // Radians
+  std::int64_t _firstDivergentTick = -1; // First sampled tick with a position error above the tolerance, -1 if none
+
+  void print() const;
+};
+
+/*
+* Re-simulates a PhysicsRecording headless, without a registry or scene.
+* Every recorded input is made again in the same order on a fresh world, and each tick is timed.
+* Poses are compared against the ones sampled while recording.
+* Makes its own Jolt world, Jolt's statics are set up the first time either this or a PhysicsSystem needs them.
+*/
+class PhysicsReplay
+{
+public:
+  PhysicsReplay() = default;
+  ~PhysicsReplay() = default;
+
+  PhysicsReplay(const PhysicsReplay&) = delete;
+  PhysicsReplay& operator=(const PhysicsReplay&) = delete;
+
+  bool load(const std::filesystem::path& path);
+
+  // Can be called again for another run of the same recording
+  ReplayReport run(float tolerance = 0.01f);
+
+  // Timings of every tick in the last run
+  bool writeTimingsCsv(const std::filesystem::path& path) const;
+
+private:
+  PhysicsRecording _recording;
+  std::unique_ptr<util::Telemetry> _telemetry;
+};
+
+}
@@ -5,13 +5,17 @@
 #include "../render/asset/AssetCollection.h"
 
 #include "../util/TransformHelpers.h"
+#include "../util/Profiler.h"
 
 #include "../component/Components.h"
 #include "../component/Registry.h"
+#include "../terrain/TerrainSystem.h"
 
 #include "PhysicsJoltImpl.h"
 #include "JoltDebugRenderer.h"
 
+#include <algorithm>
+
 namespace physics {
 
 PhysicsSystem::PhysicsSystem(
@@ -30,6 +34,11 @@ PhysicsSystem::PhysicsSystem(
 
 PhysicsSystem::~PhysicsSystem()
 {
+  // Don't lose a capture when closing
+  if (_recording) {
+    stopRecording();
+  }
+
   delete _joltImpl;
   delete _debugRenderer;
 }
@@ -50,6 +59,29 @@ void PhysicsSystem::setScene(render::scene::Scene* scene)
 void PhysicsSystem::setAssetCollection(render::asset::AssetCollection* assColl)
 {
   _assColl = assColl;
+  _collisionMeshIds.clear();
+}
+
+void PhysicsSystem::setTickRate(double ticksPerSecond)
+{
+  if (ticksPerSecond <= 0.0) {
+    printf("Physics tick rate has to be positive, got %f\n", ticksPerSecond);
+    return;
+  }
+
+  _tickDelta = 1.0 / ticksPerSecond;
+  _accumulator = 0.0;
+}
+
+void PhysicsSystem::setMaxTicksPerUpdate(unsigned maxTicks)
+{
+  _maxTicksPerUpdate = std::max(maxTicks, 1u);
+}
+
+void PhysicsSystem::setBroadPhaseOptimization(std::size_t minBodyChanges, double minInterval)
+{
+  _optimizeMinBodyChanges = minBodyChanges;
+  _optimizeMinInterval = minInterval;
 }
 
 void PhysicsSystem::init()
@@ -68,6 +100,8 @@ void PhysicsSystem::resetVelocities()
 
 void PhysicsSystem::downstreamTransformSync()
 {
+  ANEREND_PROFILE_SCOPE("PhysicsSystem::downstreamTransformSync");
+
   // Update only static and kinematic objects, but allow dynamic aswell if simulation is paused
   for (auto ent : _transformObserver) {
     auto node = _registry->reverseLookup(ent);
@@ -93,15 +127,19 @@ void PhysicsSystem::downstreamTransformSync()
 
 void PhysicsSystem::update(double delta, bool debugDraw)
 {
+  ANEREND_PROFILE_SCOPE("PhysicsSystem::update");
+
   // In order to create a body (softbody or rigidbody), we also need a shape.
   // So we have to wait for a node that comes in here (via update, not a per-frame view)
   // that has both.
 
   auto rigidNodeLambda = [this](util::Uuid node) {
+    // A body created just now is already up to date
+    bool known = _joltImpl->isBodyKnown(node);
     checkIfCreate(node);
 
     // Check if we are known, and in that case update the rigid body
-    if (_joltImpl->isBodyKnown(node)) {
+    if (known) {
       auto& rigidComp = _registry->getComponent<component::RigidBody>(node);
       _joltImpl->updateRigidBody(rigidComp, node);
     }
@@ -117,6 +155,23 @@ void PhysicsSystem::update(double delta, bool debugDraw)
     }
   };
 
+  // Edited models, the cached collision shapes are of the old geometry
+  if (_assColl) {
+    for (auto& event : _assColl->getEventLog()._events) {
+      if (event._type == render::asset::AssetEventType::ModelUpdated) {
+        rebuildMeshColliders(event._id);
+      }
+    }
+  }
+
+  // Heightfields that finished building on a worker can get their bodies now
+  _joltImpl->pollHeightFields(_heightFieldsReady);
+  for (auto& node : _heightFieldsReady) {
+    if (_registry->getEnttRegistry().valid(_registry->lookup(node))) {
+      checkIfCreate(node);
+    }
+  }
+
   // Check rigidbodies (softbodies TODO) and check if they have colliders
   // If they are known already, update parameters of the body and/or collider
   if (_goThroughEverything) {
@@ -147,9 +202,11 @@ void PhysicsSystem::update(double delta, bool debugDraw)
 
     for (auto entity : _colliderObserver) {
       auto node = _registry->reverseLookup(entity);
+      // A heightfield still building has to be restarted with the new parameters
+      bool wasPending = _joltImpl->isShapePending(node);
       checkIfCreate(node);
 
-      if (!_joltImpl->isShapeKnown(node)) return;
+      if (!_joltImpl->isShapeKnown(node) && !wasPending) continue;
 
       // Check for all colliders
       if (_registry->hasComponent<component::MeshCollider>(node)) {
@@ -167,10 +224,15 @@ void PhysicsSystem::update(double delta, bool debugDraw)
         auto radius = _registry->getComponent<component::CapsuleCollider>(node)._radius;
         _joltImpl->updateCapsule(halfHeight, radius, node);
       }
+      else if (_registry->hasComponent<component::HeightfieldCollider>(node)) {
+        // Rebuild with the new parameters, the old shape is used until then
+        addHeightField(node);
+      }
     }
   }
 
-  // Go through paging
+  // Go through paging. Whole tiles come and go at once, so removals are done in bulk.
+  _nodesToRemove.clear();
   for (auto entity : _pagingObserver) {
     auto node = _registry->reverseLookup(entity);
     bool paged = _registry->getComponent<component::PageStatus>(node)._paged;
@@ -181,19 +243,39 @@ void PhysicsSystem::update(double delta, bool debugDraw)
     }
     // Not paged, remove from physics world
     else {
-      _joltImpl->remove(node);
+      _nodesToRemove.emplace_back(node);
     }
   }
+  _joltImpl->remove(_nodesToRemove);
 
-  // Step the physics simulation
+  // Everything created above goes into the simulation in bulk
+  _joltImpl->flushBodyAdds();
+  _joltImpl->optimizeBroadPhaseIfNeeded(delta, _optimizeMinBodyChanges, _optimizeMinInterval);
+
+  // Release shapes of meshes that are not used by anything anymore
+  _joltImpl->pruneShapeCache();
+
+  // Step the physics simulation in fixed ticks
+  _ticksLastUpdate = 0;
   if (_simulationRunning) {
     //debugUpdateCharacters(delta);
 
-    syncCharacters();
+    _accumulator = std::min(_accumulator + delta, _tickDelta * _maxTicksPerUpdate);
+
+    while (_accumulator >= _tickDelta) {
+      syncCharacters();
+
+      _joltImpl->preUpdate(_tickDelta);
+      _joltImpl->update(_tickDelta);
+      _joltImpl->postUpdate(_tickDelta);
+      _joltImpl->captureTickPoses();
 
-    _joltImpl->preUpdate(delta);
-    _joltImpl->update(delta);
-    _joltImpl->postUpdate(delta);
+      _accumulator -= _tickDelta;
+      _ticksLastUpdate++;
+    }
+  }
+  else {
+    _accumulator = 0.0;
   }
 
   if (debugDraw) {
@@ -210,36 +292,101 @@ void PhysicsSystem::upstreamTransformSync()
 {
   if (!_simulationRunning) return;
 
-  // Sync transforms back to hierarchy
-  auto syncInfos = _joltImpl->retrieveCurrentTransforms();
-  for (auto& syncInfo : syncInfos) {
-    // Update the local transform using the new global transform, and (if we have a parent),
-    // the parent's local transform since that should be up to date.
-    // If we don't have a parent we can just directly set the local transform.
-    auto* nodeP = _scene->getNode(syncInfo._node);
-    auto& transComp = _registry->getComponent<component::Transform>(syncInfo._node);
+  ANEREND_PROFILE_SCOPE("PhysicsSystem::upstreamTransformSync");
 
-    // Store scale
-    auto scale = util::getScale(transComp._globalTransform);
+  // Only bodies that actually moved come back
+  _joltImpl->retrieveMovedTransforms(_syncInfos, (float)(_accumulator / _tickDelta));
+  if (_syncInfos.empty()) return;
 
-    // Calc new global trans
-    auto newGlobal = syncInfo._global * glm::scale(glm::mat4(1.0f), scale);
+  // Parents are looked up here, the scene and registry lookups can't be shared between threads.
+  // This is also before any local transform is written, in case a parent is itself in the list.
+  _syncInvParents.resize(_syncInfos.size());
+  for (std::size_t i = 0; i < _syncInfos.size(); ++i) {
+    auto* nodeP = _scene->getNode(_syncInfos[i]._node);
+    if (nodeP && nodeP->_parent) {
+      _syncInvParents[i] = glm::inverse(_registry->getComponent<component::Transform>(nodeP->_parent)._localTransform);
+    }
+    else {
+      _syncInvParents[i] = glm::mat4(1.0f);
+    }
+  }
 
-    if (!nodeP->_parent) {
-      transComp._localTransform = std::move(newGlobal);
-      _registry->patchComponent<component::Transform>(syncInfo._node);
-      continue;
+  // The user data of every body is its entity, so the transforms can be written without going through the registry maps
+  auto view = _registry->getEnttRegistry().view<component::Transform>();
+
+  _joltImpl->parallelFor(_syncInfos.size(), 256, [this, &view](std::size_t begin, std::size_t end) {
+    for (std::size_t i = begin; i < end; ++i) {
+      auto& syncInfo = _syncInfos[i];
+      auto& transComp = view.get<component::Transform>((entt::entity)syncInfo._userData);
+
+      // Keep the scale, physics doesn't know about it
+      auto scale = util::getScale(transComp._globalTransform);
+      auto newGlobal = syncInfo._global * glm::scale(glm::mat4(1.0f), scale);
+
+      // If we have a parent, apply its inverted local transform. Without one this is just the new global.
+      transComp._localTransform = _syncInvParents[i] * newGlobal;
     }
+  });
+
+  // Let scene know. Observers aren't thread safe, so this stays on this thread.
+  auto& reg = _registry->getEnttRegistry();
+  for (auto& syncInfo : _syncInfos) {
+    reg.patch<component::Transform>((entt::entity)syncInfo._userData);
+  }
+
+  // Those patches are physics' own (interpolated) poses, they must not come back down as edits.
+  // Nothing else writes transforms between downstreamTransformSync() and here, so no edits are lost.
+  _transformObserver.clear();
+}
+
+void PhysicsSystem::castRays(const std::vector<RayQuery>& queries, std::vector<QueryHit>& results)
+{
+  _joltImpl->castRays(queries, results);
+}
+
+void PhysicsSystem::castShapes(const std::vector<ShapeCastQuery>& queries, std::vector<QueryHit>& results)
+{
+  _joltImpl->castShapes(queries, results);
+}
 
-    // If we have a parent, get its inverted local transform.
-    auto invParentLocal = glm::inverse(_registry->getComponent<component::Transform>(nodeP->_parent)._localTransform);
+void PhysicsSystem::overlap(const std::vector<OverlapQuery>& queries, std::vector<OverlapResult>& results, std::vector<QueryHit>& hits)
+{
+  _joltImpl->overlap(queries, results, hits);
+}
 
-    // Apply the new local transform.
-    transComp._localTransform = invParentLocal * newGlobal;
+QueryHit PhysicsSystem::castRay(const RayQuery& query)
+{
+  _singleRay.assign(1, query);
+  _joltImpl->castRays(_singleRay, _singleHit);
+  return _singleHit[0];
+}
 
-    // Let scene know
-    _registry->patchComponent<component::Transform>(syncInfo._node);
+void PhysicsSystem::startRecording(const std::filesystem::path& path, unsigned poseInterval)
+{
+  if (_recording) {
+    stopRecording();
   }
+
+  _recording = std::make_unique<PhysicsRecording>();
+  _recording->_poseInterval = poseInterval;
+  _recordingPath = path;
+  _joltImpl->startRecording(_recording.get());
+}
+
+bool PhysicsSystem::stopRecording()
+{
+  if (!_recording) {
+    return false;
+  }
+
+  _joltImpl->stopRecording();
+  bool ok = _recording->write(_recordingPath);
+  if (ok) {
+    printf("Wrote physics recording of %llu ticks to %s\n", (unsigned long long)_recording->_numTicks, _recordingPath.string().c_str());
+  }
+
+  _recording.reset();
+  return ok;
 }
 
 void PhysicsSystem::debugSphere()
@@ -247,6 +394,18 @@ void PhysicsSystem::debugSphere()
   _joltImpl->debugSphere();
 }
 
+bool PhysicsSystem::bakeCollisionShape(render::asset::Mesh& mesh)
+{
+  std::vector<std::uint8_t> baked;
+  if (!PhysicsJoltImpl::bakeMeshShape(mesh, baked)) {
+    printf("Could not bake collision shape for mesh %s\n", mesh._id.str().c_str());
+    return false;
+  }
+
+  mesh._bakedCollisionShape = std::move(baked);
+  return true;
+}
+
 void PhysicsSystem::connectObserver()
 {
   // To be able to create aswell as reflect the component changes to the physics impl.
@@ -268,6 +427,7 @@ void PhysicsSystem::connectObserver()
     update<component::Transform>().where<component::RigidBody, component::BoxCollider>().
     update<component::Transform>().where<component::RigidBody, component::SphereCollider>().
     update<component::Transform>().where<component::RigidBody, component::CapsuleCollider>().
+    update<component::Transform>().where<component::RigidBody, component::HeightfieldCollider>().
     update<component::Transform>().where<component::CharacterController, component::BoxCollider>().
     update<component::Transform>().where<component::CharacterController, component::SphereCollider>().
     update<component::Transform>().where<component::CharacterController, component::CapsuleCollider>()
@@ -279,7 +439,8 @@ void PhysicsSystem::connectObserver()
     update<component::MeshCollider>().
     update<component::BoxCollider>().
     update<component::SphereCollider>().
-    update<component::CapsuleCollider>()
+    update<component::CapsuleCollider>().
+    update<component::HeightfieldCollider>()
   );
 
   // To detect if something is paged out or in.
@@ -293,6 +454,36 @@ void PhysicsSystem::connectObserver()
   _registry->getEnttRegistry().on_destroy<component::CharacterController>().connect<&PhysicsSystem::onRemoved>(this);
 }
 
+void PhysicsSystem::rebuildMeshColliders(const util::Uuid& modelId)
+{
+  // Nothing has a collision shape from this model
+  auto meshIt = _collisionMeshIds.find(modelId);
+  if (meshIt == _collisionMeshIds.end()) {
+    return;
+  }
+
+  _joltImpl->evictMeshShape(meshIt->second);
+  _collisionMeshIds.erase(meshIt);
+
+  auto model = _assColl->getModelBlocking(modelId);
+  if (model._meshes.empty()) {
+    return;
+  }
+  _collisionMeshIds[modelId] = model._meshes.back()._id;
+
+  // The first node builds the shape, the others get it from the cache
+  auto view = _registry->getEnttRegistry().view<component::MeshCollider, component::Renderable, component::Transform>();
+  for (auto entity : view) {
+    auto node = _registry->reverseLookup(entity);
+    if (view.get<component::Renderable>(entity)._model != modelId || !_joltImpl->isShapeKnown(node)) {
+      continue;
+    }
+
+    auto scale = util::getScale(view.get<component::Transform>(entity)._globalTransform);
+    _joltImpl->addMesh(model._meshes.back(), scale, node);
+  }
+}
+
 void PhysicsSystem::checkIfCreate(const util::Uuid& node)
 {
   auto& transComp = _registry->getComponent<component::Transform>(node);
@@ -307,10 +498,19 @@ void PhysicsSystem::checkIfCreate(const util::Uuid& node)
         // For now just take the last mesh...? TODO
 
         auto& rendComp = _registry->getComponent<component::Renderable>(node);
-        //auto* model = _scene->getModel(rendComp._model);
-        auto model = _assColl->getModelBlocking(rendComp._model);
-
-        _joltImpl->addMesh(model._meshes.back(), node);
+        auto scale = util::getScale(globalTrans);
+
+        // Many nodes usually share the same model, so try the shape cache before loading anything
+        auto meshIt = _collisionMeshIds.find(rendComp._model);
+        if (meshIt == _collisionMeshIds.end() || !_joltImpl->addCachedMesh(meshIt->second, scale, node)) {
+          //auto* model = _scene->getModel(rendComp._model);
+          auto model = _assColl->getModelBlocking(rendComp._model);
+
+          if (!model._meshes.empty()) {
+            _collisionMeshIds[rendComp._model] = model._meshes.back()._id;
+            _joltImpl->addMesh(model._meshes.back(), scale, node);
+          }
+        }
       }
     }
   }
@@ -333,42 +533,76 @@ void PhysicsSystem::checkIfCreate(const util::Uuid& node)
       _joltImpl->addCapsule(halfHeight, radius, node);
     }
   }
+  else if (_registry->hasComponent<component::HeightfieldCollider>(node)) {
+    if (!_joltImpl->isShapeKnown(node) && !_joltImpl->isShapePending(node)) {
+      addHeightField(node);
+    }
+
+    // Jolt only supports static heightfields
+    if (hasRigidComp && _registry->getComponent<component::RigidBody>(node)._motionType != component::RigidBody::Static) {
+      printf("Heightfield collider on %s needs a static rigid body!\n", node.str().c_str());
+      hasRigidComp = false;
+    }
+  }
 
   // Check if rigidbody is known, do last since it needs a shape
   if (!_joltImpl->isBodyKnown(node) && hasRigidComp) {
     auto& rigidComp = _registry->getComponent<component::RigidBody>(node);
-    _joltImpl->addRigidBody(rigidComp, globalTrans, node);
+    _joltImpl->addRigidBody(rigidComp, globalTrans, node, (std::uint64_t)_registry->lookup(node));
   }
 
   // Same for character
   if (!_joltImpl->isCharKnown(node) && hasCharComp) {
     auto& charComp = _registry->getComponent<component::CharacterController>(node);
-    _joltImpl->addCharacterController(charComp, globalTrans, node);
+    _joltImpl->addCharacterController(charComp, globalTrans, node, (std::uint64_t)_registry->lookup(node));
   }
 }
 
+void PhysicsSystem::addHeightField(const util::Uuid& node)
+{
+  if (!_registry->hasComponent<component::Terrain>(node)) {
+    printf("Heightfield collider on %s needs a terrain component!\n", node.str().c_str());
+    return;
+  }
+
+  auto& terrainComp = _registry->getComponent<component::Terrain>(node);
+  if (!terrainComp._heightMap) {
+    return;
+  }
+
+  auto& collComp = _registry->getComponent<component::HeightfieldCollider>(node);
+
+  // Copies, since this runs on a worker
+  _joltImpl->addHeightFieldAsync([assColl = _assColl, terrainComp, collComp](HeightFieldSamples& samples) {
+    auto heightMap = assColl->getTextureBlocking(terrainComp._heightMap);
+
+    samples._blockSize = collComp._blockSize;
+    samples._bitsPerSample = collComp._bitsPerSample;
+    return terrain::TerrainSystem::generateHeights(terrainComp, heightMap, samples._heights, samples._sampleCount, samples._sampleSpacing);
+  }, node);
+}
+
 void PhysicsSystem::onRemoved(entt::registry& reg, entt::entity entity)
 {
   auto node = _registry->reverseLookup(entity);
   if (!_joltImpl->isBodyKnown(node) && 
     !_joltImpl->isCharKnown(node) && 
-    !_joltImpl->isShapeKnown(node)) return;
+    !_joltImpl->isShapeKnown(node) &&
+    !_joltImpl->isShapePending(node)) return;
 
   _joltImpl->remove(node);
 }
 
 void PhysicsSystem::syncCharacters()
 {
-  auto view = _registry->getEnttRegistry().view<component::CharacterController, component::PageStatus>();
-
-  for (auto ent : view) {
-    auto node = _registry->reverseLookup(ent);
-    auto& charComp = _registry->getComponent<component::CharacterController>(node);
-    auto& pageComp = _registry->getComponent<component::PageStatus>(node);
+  auto& reg = _registry->getEnttRegistry();
 
-    if (!pageComp._paged) continue;
+  // Paged out characters aren't in the physics world, so this only touches live ones
+  for (std::size_t i = 0; i < _joltImpl->numCharacters(); ++i) {
+    auto* charComp = reg.try_get<component::CharacterController>((entt::entity)_joltImpl->characterUserData(i));
+    if (!charComp) continue;
 
-    _joltImpl->setDesiredVelocity(charComp._desiredLinearVelocity, charComp._jumpSpeed, charComp._speed, node);
+    _joltImpl->setDesiredVelocity(i, charComp->_desiredLinearVelocity, charComp->_jumpSpeed, charComp->_speed);
   }
 }
 
@@ -3,6 +3,15 @@
 #include <entt/entt.hpp>
 
 #include "../util/Uuid.h"
+#include "TransformSyncInfo.h"
+#include "PhysicsQueries.h"
+#include "PhysicsRecording.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <unordered_map>
+#include <vector>
 
 namespace component {
   class Registry;
@@ -18,6 +27,7 @@ namespace render::scene {
 
 namespace render::asset {
   class AssetCollection;
+  struct Mesh;
 }
 
 namespace physics {
@@ -53,18 +63,60 @@ public:
   void downstreamTransformSync();
 
   // Creates bodies and colliders, and steps the simulation if it is currently running.
+  // The simulation ticks at a fixed rate, delta is accumulated and as many ticks as fit are run.
   void update(double delta, bool debugDraw = true);
 
+  // Ticks per second of the simulation, 60 by default.
+  void setTickRate(double ticksPerSecond);
+  double tickRate() const { return 1.0 / _tickDelta; }
+
+  // Caps the ticks run by one update. Time that doesn't fit is dropped, so a slow frame can't lead to
+  // more ticks next frame, which would be even slower (spiral of death). The simulation slows down instead.
+  void setMaxTicksPerUpdate(unsigned maxTicks);
+  unsigned maxTicksPerUpdate() const { return _maxTicksPerUpdate; }
+
+  unsigned ticksLastUpdate() const { return _ticksLastUpdate; }
+
+  // Bodies are added and removed in bulk, which leaves the broadphase less optimal over time.
+  // It is rebuilt after at least minBodyChanges bodies came or went, but not more often than every minInterval seconds.
+  void setBroadPhaseOptimization(std::size_t minBodyChanges, double minInterval);
+
   // Sync transforms from physics simulation to hierarchy.
+  // These are interpolated between the last two ticks, according to how far into the next tick the accumulated time is.
+  // Transforms written here are not synced back down by the next downstreamTransformSync, so call it right after update().
   void upstreamTransformSync();
 
   bool& simulationRunning() { return _simulationRunning; }
 
+  // Batched scene queries, results map back to nodes. Batches run in parallel on the physics job system.
+  // Bodies created since the last update() are not hit yet. Main thread only and outside update(),
+  // the batches share scratch memory in the physics implementation.
+  void castRays(const std::vector<RayQuery>& queries, std::vector<QueryHit>& results);
+  void castShapes(const std::vector<ShapeCastQuery>& queries, std::vector<QueryHit>& results);
+  void overlap(const std::vector<OverlapQuery>& queries, std::vector<OverlapResult>& results, std::vector<QueryHit>& hits);
+
+  // Convenience for a single ray
+  QueryHit castRay(const RayQuery& query);
+
+  // Records the bodies in the world now and every physics input from here on, stopRecording writes it to path.
+  // PhysicsReplay re-simulates the file. Start before the simulation runs for a replay that matches closely.
+  void startRecording(const std::filesystem::path& path, unsigned poseInterval = 30);
+  bool stopRecording();
+  bool isRecording() const { return (bool)_recording; }
+
+  // Bakes the Jolt collision shape of the mesh into mesh._bakedCollisionShape, so that it doesn't have to be built at load.
+  // Needs to be redone if Jolt is upgraded (a stale bake is detected and rebuilt at load, but then there is no gain).
+  static bool bakeCollisionShape(render::asset::Mesh& mesh);
+
   void debugSphere();
 
 private:
   void connectObserver();
   void checkIfCreate(const util::Uuid& node);
+  // Gives every mesh collider using the model a shape built from its current geometry
+  void rebuildMeshColliders(const util::Uuid& modelId);
+  // Starts building the heightfield of a node with a Terrain and a HeightfieldCollider
+  void addHeightField(const util::Uuid& node);
 
   void onRemoved(entt::registry& reg, entt::entity entity);
 
@@ -80,6 +132,13 @@ private:
   render::asset::AssetCollection* _assColl = nullptr;
   render::RenderContext* _rc = nullptr;
 
+  // Reused every upstream sync
+  std::vector<TransformSyncInfo> _syncInfos;
+  std::vector<glm::mat4> _syncInvParents; // Identity for nodes without a parent
+
+  // Collision mesh used per model, so that nodes sharing a model can use the cached shape without loading the model
+  std::unordered_map<util::Uuid, util::Uuid> _collisionMeshIds;
+
   entt::observer _rigidObserver;
   entt::observer _charObserver;
   entt::observer _transformObserver;
@@ -87,6 +146,22 @@ private:
   entt::observer _pagingObserver;
   bool _goThroughEverything = false;
   bool _simulationRunning = false;
+
+  double _tickDelta = 1.0 / 60.0;
+  unsigned _maxTicksPerUpdate = 4;
+  unsigned _ticksLastUpdate = 0;
+  double _accumulator = 0.0;
+
+  std::size_t _optimizeMinBodyChanges = 256;
+  double _optimizeMinInterval = 0.5;
+  std::vector<util::Uuid> _nodesToRemove;
+  std::vector<util::Uuid> _heightFieldsReady;
+
+  std::unique_ptr<PhysicsRecording> _recording;
+  std::filesystem::path _recordingPath;
+
+  std::vector<RayQuery> _singleRay;
+  std::vector<QueryHit> _singleHit;
 };
 
 }
\ No newline at end of file
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "../util/Uuid.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+
+namespace physics {
+
+struct TransformSyncInfo
+{
+  util::Uuid _node;
+  std::uint64_t _userData; // Whatever was given when adding the body/char
+  glm::mat4 _global;
+};
+
+}
@@ -8,8 +8,11 @@
 #include "../../common/util/Utils.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cstdio>
+#include <functional>
 #include <iterator>
+#include <thread>
 
 namespace render {
 
@@ -786,6 +789,10 @@ VkShaderStageFlags FrameGraphBuilder::findStages(const std::string& resource)
 
 bool FrameGraphBuilder::createPipelines(RenderContext* renderContext, RenderResourceVault* vault)
 {
+  // The actual pipelines are independent of each other, so they are gathered here and built in parallel afterwards.
+  std::vector<std::function<bool()>> pipelineJobs;
+  auto* cache = renderContext->getPipelineCache();
+
   // Go through each node in the built graph and build all needed
   for (auto& node : _builtGraph) {
     // Only do this if we are a render pass
@@ -1001,26 +1008,61 @@ bool FrameGraphBuilder::createPipelines(RenderContext* renderContext, RenderReso
 
     // Compute, graphics or raytracing pipeline
     if (node._computeParams.has_value()) {
-      if (!buildComputePipeline(node._computeParams.value(), node._pipelineLayout, node._pipeline)) {
-        printf("Could not build compute pipeline!\n");
-        return false;
-      }
+      auto params = node._computeParams.value();
+      params.cache = cache;
+      pipelineJobs.emplace_back([params, &node]() {
+        if (!buildComputePipeline(params, node._pipelineLayout, node._pipeline)) {
+          printf("Could not build compute pipeline for %s!\n", node._debugName.c_str());
+          return false;
+        }
+        return true;
+      });
     }
     else if (node._graphicsParams.has_value()) {
-      if (!buildGraphicsPipeline(node._graphicsParams.value(), node._pipelineLayout, node._pipeline)) {
-        printf("Could not build graphics pipeline!\n");
-        return false;
-      }
+      auto params = node._graphicsParams.value();
+      params.cache = cache;
+      pipelineJobs.emplace_back([params, &node]() {
+        if (!buildGraphicsPipeline(params, node._pipelineLayout, node._pipeline)) {
+          printf("Could not build graphics pipeline for %s!\n", node._debugName.c_str());
+          return false;
+        }
+        return true;
+      });
     }
     else if (renderContext->getRenderOptions().raytracingEnabled && node._rtParams.has_value()) {
-      if (!buildRayTracingPipeline(node._rtParams.value(), node._pipelineLayout, node._pipeline, node._sbt)) {
-        printf("Could not build ray tracing pipeline!\n");
-        return false;
-      }
+      auto params = node._rtParams.value();
+      params.cache = cache;
+      pipelineJobs.emplace_back([params, &node]() {
+        if (!buildRayTracingPipeline(params, node._pipelineLayout, node._pipeline, node._sbt)) {
+          printf("Could not build ray tracing pipeline for %s!\n", node._debugName.c_str());
+          return false;
+        }
+        return true;
+      });
     }
   }
 
-  return true;
+  // Most of the time is spent in the driver compiling shaders, which is thread-safe.
+  std::atomic<std::size_t> nextJob = 0;
+  std::atomic<bool> allOk = true;
+
+  std::size_t numThreads = std::clamp<std::size_t>(std::thread::hardware_concurrency(), 1, std::max<std::size_t>(pipelineJobs.size(), 1));
+  std::vector<std::thread> threads;
+  for (std::size_t i = 0; i < numThreads; ++i) {
+    threads.emplace_back([&pipelineJobs, &nextJob, &allOk]() {
+      for (auto job = nextJob++; job < pipelineJobs.size(); job = nextJob++) {
+        if (!pipelineJobs[job]()) {
+          allOk = false;
+        }
+      }
+    });
+  }
+
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  return allOk;
 }
 
 void FrameGraphBuilder::findDependenciesRecurse(std::vector<GraphNode>& stack, Submission* submission)
@@ -1194,6 +1236,14 @@ void FrameGraphBuilder::internalBuild2(Submission* presentSub)
   }
 }
 
+void FrameGraphBuilder::buildGraphOnly()
+{
+  _builtGraph.clear();
+
+  internalBuild3();
+  insertBarriers(_builtGraph);
+}
+
 void FrameGraphBuilder::internalBuild3()
 {
   // Simply use submission order, but insert resource inits if there are any
@@ -182,6 +182,11 @@ public:
 
   bool build(RenderContext* renderContext, RenderResourceVault* vault);
 
+  // Orders the registered passes and inserts barriers like build() does, but creates no resources or pipelines.
+  // Needs no device, meant for benchmarking and validating graphs offline. The result can't be executed.
+  void buildGraphOnly();
+  std::size_t builtGraphSize() const { return _builtGraph.size(); }
+
   void printBuiltGraphDebug();
 
 private:
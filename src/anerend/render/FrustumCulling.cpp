@@ -0,0 +1,521 @@
+#include "FrustumCulling.h"
+
+#include "Camera.h"
+
+#include <cmath>
+#include <cstdio>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define ANEREND_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+// MSVC lets any function use any intrinsic, gcc/clang need the target spelled out. SSE2 is always there on x64.
+#if defined(ANEREND_X86) && (defined(__GNUC__) || defined(__clang__))
+#define ANEREND_TARGET_AVX __attribute__((target("avx")))
+#else
+#define ANEREND_TARGET_AVX
+#endif
+
+namespace render {
+
+namespace {
+
+bool detectAvx()
+{
+#if defined(ANEREND_X86)
+  unsigned ecx = 0;
+
+#if defined(_MSC_VER)
+  int regs[4];
+  __cpuid(regs, 1);
+  ecx = unsigned(regs[2]);
+#else
+  unsigned eax, ebx, edx;
+  __get_cpuid(1, &eax, &ebx, &ecx, &edx);
+#endif
+
+  bool osxsave = (ecx & (1u << 27)) != 0;
+  bool avx = (ecx & (1u << 28)) != 0;
+  if (!osxsave || !avx) {
+    return false;
+  }
+
+  // The OS also has to save the ymm registers
+#if defined(_MSC_VER)
+  return (_xgetbv(0) & 6) == 6;
+#else
+  unsigned xcr0Lo, xcr0Hi;
+  __asm__("xgetbv" : "=a"(xcr0Lo), "=d"(xcr0Hi) : "c"(0));
+  return (xcr0Lo & 6) == 6;
+#endif
+#else
+  return false;
+#endif
+}
+
+bool avxSupported()
+{
+  static const bool supported = detectAvx();
+  return supported;
+}
+
+CullPath resolvePath(CullPath path)
+{
+  if (path == CullPath::Auto) return FrustumCulling::bestPath();
+#if defined(ANEREND_X86)
+  if (path == CullPath::AVX && !avxSupported()) return CullPath::SSE2;
+  return path;
+#else
+  return CullPath::Scalar;
+#endif
+}
+
+// |a|, |b|, |c| of every plane, for the box test
+struct AbsNormals
+{
+  explicit AbsNormals(const FrustumPlanes& planes)
+  {
+    for (std::size_t i = 0; i < planes._a.size(); ++i) {
+      _a.emplace_back(std::fabs(planes._a[i]));
+      _b.emplace_back(std::fabs(planes._b[i]));
+      _c.emplace_back(std::fabs(planes._c[i]));
+    }
+  }
+
+  std::vector<float> _a;
+  std::vector<float> _b;
+  std::vector<float> _c;
+};
+
+void cullSpheresScalar(const FrustumPlanes& p, const SphereBatch& s, std::uint32_t* out, std::size_t begin)
+{
+  const std::size_t numViews = p.numViews();
+
+  for (std::size_t i = begin; i < s.size(); ++i) {
+    std::uint32_t mask = 0;
+
+    for (std::size_t v = 0; v < numViews; ++v) {
+      bool visible = true;
+
+      for (std::size_t k = v * FrustumPlanes::PLANES_PER_VIEW; k < (v + 1) * FrustumPlanes::PLANES_PER_VIEW && visible; ++k) {
+        float dist = p._a[k] * s._x[i] + p._b[k] * s._y[i] + p._c[k] * s._z[i] + p._d[k];
+        visible = dist > -s._r[i];
+      }
+
+      mask |= visible ? (1u << v) : 0u;
+    }
+
+    out[i] = mask;
+  }
+}
+
+// Box is outside a plane if its corner furthest along the normal is: dot(n, c) + d + dot(|n|, e) <= 0
+void cullAabbsScalar(const FrustumPlanes& p, const AbsNormals& abs, const AabbBatch& b, std::uint32_t* out, std::size_t begin)
+{
+  const std::size_t numViews = p.numViews();
+
+  for (std::size_t i = begin; i < b.size(); ++i) {
+    std::uint32_t mask = 0;
+
+    for (std::size_t v = 0; v < numViews; ++v) {
+      bool visible = true;
+
+      for (std::size_t k = v * FrustumPlanes::PLANES_PER_VIEW; k < (v + 1) * FrustumPlanes::PLANES_PER_VIEW && visible; ++k) {
+        float dist =
+          p._a[k] * b._cx[i] + p._b[k] * b._cy[i] + p._c[k] * b._cz[i] + p._d[k] +
+          abs._a[k] * b._ex[i] + abs._b[k] * b._ey[i] + abs._c[k] * b._ez[i];
+        visible = dist > 0.0f;
+      }
+
+      mask |= visible ? (1u << v) : 0u;
+    }
+
+    out[i] = mask;
+  }
+}
+
+#if defined(ANEREND_X86)
+
+std::size_t cullSpheresSSE2(const FrustumPlanes& p, const SphereBatch& s, std::uint32_t* out)
+{
+  const std::size_t count = s.size() & ~std::size_t(3);
+  const std::size_t numViews = p.numViews();
+  const __m128 zero = _mm_setzero_ps();
+
+  for (std::size_t i = 0; i < count; i += 4) {
+    __m128 x = _mm_loadu_ps(&s._x[i]);
+    __m128 y = _mm_loadu_ps(&s._y[i]);
+    __m128 z = _mm_loadu_ps(&s._z[i]);
+    __m128 negR = _mm_sub_ps(zero, _mm_loadu_ps(&s._r[i]));
+    __m128 acc = zero;
+
+    for (std::size_t v = 0; v < numViews; ++v) {
+      __m128 visible = _mm_cmpeq_ps(zero, zero);
+
+      for (std::size_t k = v * FrustumPlanes::PLANES_PER_VIEW; k < (v + 1) * FrustumPlanes::PLANES_PER_VIEW; ++k) {
+        __m128 dist = _mm_add_ps(
+          _mm_add_ps(_mm_mul_ps(_mm_set1_ps(p._a[k]), x), _mm_mul_ps(_mm_set1_ps(p._b[k]), y)),
+          _mm_add_ps(_mm_mul_ps(_mm_set1_ps(p._c[k]), z), _mm_set1_ps(p._d[k])));
+        visible = _mm_and_ps(visible, _mm_cmpgt_ps(dist, negR));
+
+        if (_mm_movemask_ps(visible) == 0) break;
+      }
+
+      acc = _mm_or_ps(acc, _mm_and_ps(visible, _mm_castsi128_ps(_mm_set1_epi32(int(1u << v)))));
+    }
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_castps_si128(acc));
+  }
+
+  return count;
+}
+
+std::size_t cullAabbsSSE2(const FrustumPlanes& p, const AbsNormals& abs, const AabbBatch& b, std::uint32_t* out)
+{
+  const std::size_t count = b.size() & ~std::size_t(3);
+  const std::size_t numViews = p.numViews();
+  const __m128 zero = _mm_setzero_ps();
+
+  for (std::size_t i = 0; i < count; i += 4) {
+    __m128 cx = _mm_loadu_ps(&b._cx[i]);
+    __m128 cy = _mm_loadu_ps(&b._cy[i]);
+    __m128 cz = _mm_loadu_ps(&b._cz[i]);
+    __m128 ex = _mm_loadu_ps(&b._ex[i]);
+    __m128 ey = _mm_loadu_ps(&b._ey[i]);
+    __m128 ez = _mm_loadu_ps(&b._ez[i]);
+    __m128 acc = zero;
+
+    for (std::size_t v = 0; v < numViews; ++v) {
+      __m128 visible = _mm_cmpeq_ps(zero, zero);
+
+      for (std::size_t k = v * FrustumPlanes::PLANES_PER_VIEW; k < (v + 1) * FrustumPlanes::PLANES_PER_VIEW; ++k) {
+        __m128 center = _mm_add_ps(
+          _mm_add_ps(_mm_mul_ps(_mm_set1_ps(p._a[k]), cx), _mm_mul_ps(_mm_set1_ps(p._b[k]), cy)),
+          _mm_add_ps(_mm_mul_ps(_mm_set1_ps(p._c[k]), cz), _mm_set1_ps(p._d[k])));
+        __m128 extent = _mm_add_ps(
+          _mm_add_ps(_mm_mul_ps(_mm_set1_ps(abs._a[k]), ex), _mm_mul_ps(_mm_set1_ps(abs._b[k]), ey)),
+          _mm_mul_ps(_mm_set1_ps(abs._c[k]), ez));
+        visible = _mm_and_ps(visible, _mm_cmpgt_ps(_mm_add_ps(center, extent), zero));
+
+        if (_mm_movemask_ps(visible) == 0) break;
+      }
+
+      acc = _mm_or_ps(acc, _mm_and_ps(visible, _mm_castsi128_ps(_mm_set1_epi32(int(1u << v)))));
+    }
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_castps_si128(acc));
+  }
+
+  return count;
+}
+
+ANEREND_TARGET_AVX std::size_t cullSpheresAVX(const FrustumPlanes& p, const SphereBatch& s, std::uint32_t* out)
+{
+  const std::size_t count = s.size() & ~std::size_t(7);
+  const std::size_t numViews = p.numViews();
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 allOnes = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+  for (std::size_t i = 0; i < count; i += 8) {
+    __m256 x = _mm256_loadu_ps(&s._x[i]);
+    __m256 y = _mm256_loadu_ps(&s._y[i]);
+    __m256 z = _mm256_loadu_ps(&s._z[i]);
+    __m256 negR = _mm256_sub_ps(zero, _mm256_loadu_ps(&s._r[i]));
+    __m256 acc = zero;
+
+    for (std::size_t v = 0; v < numViews; ++v) {
+      __m256 visible = allOnes;
+
+      for (std::size_t k = v * FrustumPlanes::PLANES_PER_VIEW; k < (v + 1) * FrustumPlanes::PLANES_PER_VIEW; ++k) {
+        __m256 dist = _mm256_add_ps(
+          _mm256_add_ps(_mm256_mul_ps(_mm256_broadcast_ss(&p._a[k]), x), _mm256_mul_ps(_mm256_broadcast_ss(&p._b[k]), y)),
+          _mm256_add_ps(_mm256_mul_ps(_mm256_broadcast_ss(&p._c[k]), z), _mm256_broadcast_ss(&p._d[k])));
+        visible = _mm256_and_ps(visible, _mm256_cmp_ps(dist, negR, _CMP_GT_OQ));
+
+        if (_mm256_movemask_ps(visible) == 0) break;
+      }
+
+      acc = _mm256_or_ps(acc, _mm256_and_ps(visible, _mm256_castsi256_ps(_mm256_set1_epi32(int(1u << v)))));
+    }
+
+    _mm256_storeu_ps(reinterpret_cast<float*>(out + i), acc);
+  }
+
+  return count;
+}
+
+ANEREND_TARGET_AVX std::size_t cullAabbsAVX(const FrustumPlanes& p, const AbsNormals& abs, const AabbBatch& b, std::uint32_t* out)
+{
+  const std::size_t count = b.size() & ~std::size_t(7);
+  const std::size_t numViews = p.numViews();
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 allOnes = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+  for (std::size_t i = 0; i < count; i += 8) {
+    __m256 cx = _mm256_loadu_ps(&b._cx[i]);
+    __m256 cy = _mm256_loadu_ps(&b._cy[i]);
+    __m256 cz = _mm256_loadu_ps(&b._cz[i]);
+    __m256 ex = _mm256_loadu_ps(&b._ex[i]);
+    __m256 ey = _mm256_loadu_ps(&b._ey[i]);
+    __m256 ez = _mm256_loadu_ps(&b._ez[i]);
+    __m256 acc = zero;
+
+    for (std::size_t v = 0; v < numViews; ++v) {
+      __m256 visible = allOnes;
+
+      for (std::size_t k = v * FrustumPlanes::PLANES_PER_VIEW; k < (v + 1) * FrustumPlanes::PLANES_PER_VIEW; ++k) {
+        __m256 center = _mm256_add_ps(
+          _mm256_add_ps(_mm256_mul_ps(_mm256_broadcast_ss(&p._a[k]), cx), _mm256_mul_ps(_mm256_broadcast_ss(&p._b[k]), cy)),
+          _mm256_add_ps(_mm256_mul_ps(_mm256_broadcast_ss(&p._c[k]), cz), _mm256_broadcast_ss(&p._d[k])));
+        __m256 extent = _mm256_add_ps(
+          _mm256_add_ps(_mm256_mul_ps(_mm256_broadcast_ss(&abs._a[k]), ex), _mm256_mul_ps(_mm256_broadcast_ss(&abs._b[k]), ey)),
+          _mm256_mul_ps(_mm256_broadcast_ss(&abs._c[k]), ez));
+        visible = _mm256_and_ps(visible, _mm256_cmp_ps(_mm256_add_ps(center, extent), zero, _CMP_GT_OQ));
+
+        if (_mm256_movemask_ps(visible) == 0) break;
+      }
+
+      acc = _mm256_or_ps(acc, _mm256_and_ps(visible, _mm256_castsi256_ps(_mm256_set1_epi32(int(1u << v)))));
+    }
+
+    _mm256_storeu_ps(reinterpret_cast<float*>(out + i), acc);
+  }
+
+  return count;
+}
+
+#endif
+
+std::vector<std::uint32_t> collectVisible(const std::vector<std::uint32_t>& masks, std::size_t view)
+{
+  std::vector<std::uint32_t> out;
+  for (std::size_t i = 0; i < masks.size(); ++i) {
+    if (masks[i] & (1u << view)) {
+      out.emplace_back((std::uint32_t)i);
+    }
+  }
+  return out;
+}
+
+}
+
+void FrustumPlanes::clear()
+{
+  _a.clear();
+  _b.clear();
+  _c.clear();
+  _d.clear();
+}
+
+int FrustumPlanes::addView(const glm::mat4& viewProj)
+{
+  if (numViews() == MAX_VIEWS) {
+    printf("Cannot add culling view, max %zu views!\n", MAX_VIEWS);
+    return -1;
+  }
+
+  // Gribb/Hartmann, rows of the matrix. Depth is 0..1 (GLM_FORCE_DEPTH_ZERO_TO_ONE) so near is row 2 by itself.
+  auto row = [&viewProj](int r) {
+    return glm::vec4(viewProj[0][r], viewProj[1][r], viewProj[2][r], viewProj[3][r]);
+  };
+
+  const glm::vec4 planes[PLANES_PER_VIEW] = {
+    row(3) - row(0), // Right
+    row(3) + row(0), // Left
+    row(3) + row(1), // Bottom
+    row(3) - row(1), // Top
+    row(3) - row(2), // Far
+    row(2)           // Near
+  };
+
+  int view = (int)numViews();
+
+  for (auto plane : planes) {
+    float len = glm::length(glm::vec3(plane));
+    if (len > 0.0f) {
+      plane /= len;
+    }
+
+    _a.emplace_back(plane.x);
+    _b.emplace_back(plane.y);
+    _c.emplace_back(plane.z);
+    _d.emplace_back(plane.w);
+  }
+
+  return view;
+}
+
+int FrustumPlanes::addView(const Camera& camera)
+{
+  return addView(camera.getProjection() * camera.getCamMatrix());
+}
+
+int FrustumPlanes::addView(const Frustum& frustum)
+{
+  if (numViews() == MAX_VIEWS) {
+    printf("Cannot add culling view, max %zu views!\n", MAX_VIEWS);
+    return -1;
+  }
+
+  int view = (int)numViews();
+
+  for (auto p : { Frustum::Right, Frustum::Left, Frustum::Bottom, Frustum::Top, Frustum::Front }) {
+    auto plane = frustum.getPlane(p);
+    _a.emplace_back(plane.x);
+    _b.emplace_back(plane.y);
+    _c.emplace_back(plane.z);
+    _d.emplace_back(plane.w);
+  }
+
+  // Plane that everything is inside of, in place of the near plane
+  _a.emplace_back(0.0f);
+  _b.emplace_back(0.0f);
+  _c.emplace_back(0.0f);
+  _d.emplace_back(1.0f);
+
+  return view;
+}
+
+int FrustumPlanes::addViews(const glm::mat4& proj, const std::vector<glm::mat4>& views)
+{
+  if (numViews() + views.size() > MAX_VIEWS) {
+    printf("Cannot add %zu culling views, max %zu views!\n", views.size(), MAX_VIEWS);
+    return -1;
+  }
+
+  int first = (int)numViews();
+  for (auto& view : views) {
+    addView(proj * view);
+  }
+  return first;
+}
+
+void SphereBatch::reserve(std::size_t n)
+{
+  _x.reserve(n);
+  _y.reserve(n);
+  _z.reserve(n);
+  _r.reserve(n);
+}
+
+void SphereBatch::clear()
+{
+  _x.clear();
+  _y.clear();
+  _z.clear();
+  _r.clear();
+}
+
+void SphereBatch::add(const glm::vec3& center, float radius)
+{
+  _x.emplace_back(center.x);
+  _y.emplace_back(center.y);
+  _z.emplace_back(center.z);
+  _r.emplace_back(radius);
+}
+
+void AabbBatch::reserve(std::size_t n)
+{
+  _cx.reserve(n);
+  _cy.reserve(n);
+  _cz.reserve(n);
+  _ex.reserve(n);
+  _ey.reserve(n);
+  _ez.reserve(n);
+}
+
+void AabbBatch::clear()
+{
+  _cx.clear();
+  _cy.clear();
+  _cz.clear();
+  _ex.clear();
+  _ey.clear();
+  _ez.clear();
+}
+
+void AabbBatch::add(const glm::vec3& min, const glm::vec3& max)
+{
+  glm::vec3 center = (min + max) * 0.5f;
+  glm::vec3 extent = (max - min) * 0.5f;
+
+  _cx.emplace_back(center.x);
+  _cy.emplace_back(center.y);
+  _cz.emplace_back(center.z);
+  _ex.emplace_back(extent.x);
+  _ey.emplace_back(extent.y);
+  _ez.emplace_back(extent.z);
+}
+
+CullPath FrustumCulling::bestPath()
+{
+#if defined(ANEREND_X86)
+  return avxSupported() ? CullPath::AVX : CullPath::SSE2;
+#else
+  return CullPath::Scalar;
+#endif
+}
+
+const char* FrustumCulling::pathName(CullPath path)
+{
+  switch (path) {
+  case CullPath::Auto: return "auto";
+  case CullPath::Scalar: return "scalar";
+  case CullPath::SSE2: return "sse2";
+  case CullPath::AVX: return "avx";
+  }
+  return "unknown";
+}
+
+void FrustumCulling::cullSpheres(const FrustumPlanes& planes, const SphereBatch& spheres, std::uint32_t* outMasks, CullPath path)
+{
+  std::size_t done = 0;
+
+  switch (resolvePath(path)) {
+#if defined(ANEREND_X86)
+  case CullPath::SSE2: done = cullSpheresSSE2(planes, spheres, outMasks); break;
+  case CullPath::AVX: done = cullSpheresAVX(planes, spheres, outMasks); break;
+#endif
+  default: break;
+  }
+
+  cullSpheresScalar(planes, spheres, outMasks, done);
+}
+
+void FrustumCulling::cullAabbs(const FrustumPlanes& planes, const AabbBatch& boxes, std::uint32_t* outMasks, CullPath path)
+{
+  AbsNormals abs(planes);
+  std::size_t done = 0;
+
+  switch (resolvePath(path)) {
+#if defined(ANEREND_X86)
+  case CullPath::SSE2: done = cullAabbsSSE2(planes, abs, boxes, outMasks); break;
+  case CullPath::AVX: done = cullAabbsAVX(planes, abs, boxes, outMasks); break;
+#endif
+  default: break;
+  }
+
+  cullAabbsScalar(planes, abs, boxes, outMasks, done);
+}
+
+std::vector<std::uint32_t> FrustumCulling::visibleSpheres(const FrustumPlanes& planes, const SphereBatch& spheres, std::size_t view)
+{
+  std::vector<std::uint32_t> masks(spheres.size());
+  cullSpheres(planes, spheres, masks.data());
+  return collectVisible(masks, view);
+}
+
+std::vector<std::uint32_t> FrustumCulling::visibleAabbs(const FrustumPlanes& planes, const AabbBatch& boxes, std::size_t view)
+{
+  std::vector<std::uint32_t> masks(boxes.size());
+  cullAabbs(planes, boxes, masks.data());
+  return collectVisible(masks, view);
+}
+
+}
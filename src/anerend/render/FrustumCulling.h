@@ -0,0 +1,105 @@
+#pragma once
+
+#include "Box3D.h"
+#include "Frustum.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace render {
+
+class Camera;
+
+enum class CullPath
+{
+  Auto,
+  Scalar,
+  SSE2,
+  AVX
+};
+
+/*
+* The planes of up to 32 views in SoA form, six per view in the order of Frustum::Plane
+* (right, left, bottom, top, far, near). Planes point inwards and are normalized.
+* Typically the main camera, the shadow cascades and the six cube faces of each shadow casting point light.
+*/
+struct FrustumPlanes
+{
+  static const std::size_t MAX_VIEWS = 32;
+  static const std::size_t PLANES_PER_VIEW = 6;
+
+  // Plane p of view v is at index v * PLANES_PER_VIEW + p
+  std::vector<float> _a;
+  std::vector<float> _b;
+  std::vector<float> _c;
+  std::vector<float> _d;
+
+  std::size_t numViews() const { return _a.size() / PLANES_PER_VIEW; }
+  void clear();
+
+  // All return the index of the (first) added view, or -1 if MAX_VIEWS would be exceeded.
+  // Extracted from a (0..1 depth) view-projection matrix.
+  int addView(const glm::mat4& viewProj);
+  int addView(const Camera& camera);
+  // Same planes as Frustum::isInside(const Box3D&) uses, i.e. without the near plane.
+  int addView(const Frustum& frustum);
+  // One view per view matrix sharing the projection, such as the faces from component::Light::updateViewMatrices.
+  int addViews(const glm::mat4& proj, const std::vector<glm::mat4>& views);
+};
+
+// Bounding spheres in SoA form
+struct SphereBatch
+{
+  std::vector<float> _x;
+  std::vector<float> _y;
+  std::vector<float> _z;
+  std::vector<float> _r;
+
+  std::size_t size() const { return _x.size(); }
+  void reserve(std::size_t n);
+  void clear();
+  void add(const glm::vec3& center, float radius);
+};
+
+// Axis aligned boxes in SoA form, as center and half extent
+struct AabbBatch
+{
+  std::vector<float> _cx;
+  std::vector<float> _cy;
+  std::vector<float> _cz;
+  std::vector<float> _ex;
+  std::vector<float> _ey;
+  std::vector<float> _ez;
+
+  std::size_t size() const { return _cx.size(); }
+  void reserve(std::size_t n);
+  void clear();
+  void add(const glm::vec3& min, const glm::vec3& max);
+  void add(const Box3D& box) { add(box.getMin(), box.getMax()); }
+};
+
+/*
+* Batch frustum culling of spheres and boxes against all views of a FrustumPlanes in one pass.
+* Objects are tested 4 (SSE2) or 8 (AVX) at a time, the fastest path the running CPU supports is picked unless one is forced.
+* Other architectures use the scalar path.
+* The result per object is a mask with bit v set if the object is at least partially inside view v.
+* Boxes give the same answer as Frustum::isInside(const Box3D&) != Invisible for the same planes.
+*/
+struct FrustumCulling
+{
+  static CullPath bestPath();
+  static const char* pathName(CullPath path);
+
+  // outMasks must hold spheres.size() entries.
+  static void cullSpheres(const FrustumPlanes& planes, const SphereBatch& spheres, std::uint32_t* outMasks, CullPath path = CullPath::Auto);
+  static void cullAabbs(const FrustumPlanes& planes, const AabbBatch& boxes, std::uint32_t* outMasks, CullPath path = CullPath::Auto);
+
+  // Convenience for a single view: indices of the objects visible in view.
+  static std::vector<std::uint32_t> visibleSpheres(const FrustumPlanes& planes, const SphereBatch& spheres, std::size_t view = 0);
+  static std::vector<std::uint32_t> visibleAabbs(const FrustumPlanes& planes, const AabbBatch& boxes, std::size_t view = 0);
+};
+
+}
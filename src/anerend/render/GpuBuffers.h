@@ -172,12 +172,49 @@ struct GPUIrradianceProbe
 
 struct alignas(16) GPUParticle
 {
-  glm::vec4 initialVelocity; // w is scale
-  glm::vec4 initialPosition; // w is lifetime
-  glm::vec4 currentPosition; // w is spawnDelay
-  glm::vec4 currentVelocity; // w is elapsedTime
-  int alive;
-  uint32_t renderableId;
+  glm::vec4 position; // w is age
+  glm::vec4 velocity; // w is lifetime
+  float scale;
+  uint32_t emitter; // Index into the emitter buffer
+  uint32_t pad0;
+  uint32_t pad1;
+};
+
+enum ParticleEmitterFlags : std::uint32_t
+{
+  PARTICLE_EMITTER_RESET_FLAG = 1 // The range is new, its dead list has to be filled before spawning
+};
+
+struct alignas(16) GPUParticleEmitter
+{
+  glm::vec4 position; // w is spawn radius
+  glm::vec4 minVelocity; // w is lifetime
+  glm::vec4 maxVelocity; // w is restitution, negative if particles don't bounce
+  glm::vec4 gravity; // w is height of the ground plane
+  glm::vec4 scale; // x is min, y is max
+  uint32_t rangeStart; // First particle of the emitter's range in the particle and dead list buffers
+  uint32_t rangeSize; // 0 if the slot isn't used, particles of removed emitters die
+  uint32_t spawnCount; // This frame, no more than what is dead
+  uint32_t seed;
+  uint32_t flags; // ParticleEmitterFlags
+  uint32_t pad0;
+  uint32_t pad1;
+  uint32_t pad2;
+};
+
+// Followed by the number of dead particles of every emitter slot
+struct GPUParticleCounters
+{
+  uint32_t aliveCount[2]; // One per alive list, they are swapped every frame
+  uint32_t pad0;
+  uint32_t pad1;
+};
+
+struct GPUParticlePushConstants
+{
+  uint32_t current; // Alive list that is simulated this frame, the other one is filled with the survivors
+  uint32_t maxParticles; // Size of each alive list
+  uint32_t numEmitters;
 };
 
 // Maps the internal ids (such as RenderableId) to an index in the GPU buffers
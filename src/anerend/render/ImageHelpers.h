@@ -50,6 +50,21 @@ static unsigned stride(render::asset::Texture::Format format)
   else if (format == asset::Texture::Format::RG_UNORM_BC5) {
     return 2;
   }
+  else if (format == asset::Texture::Format::RGBA_UNORM_BC1) {
+    return 4;
+  }
+  else if (format == asset::Texture::Format::RGBA_SRGB_BC1) {
+    return 4;
+  }
+  else if (format == asset::Texture::Format::RGBA_UNORM_BC3) {
+    return 4;
+  }
+  else if (format == asset::Texture::Format::RGBA_SRGB_BC3) {
+    return 4;
+  }
+  else if (format == asset::Texture::Format::R_UNORM_BC4) {
+    return 1;
+  }
   else if (format == asset::Texture::Format::R8_UNORM) {
     return 1;
   }
@@ -89,6 +104,21 @@ static VkFormat texFormatToVk(render::asset::Texture::Format format)
   else if (format == asset::Texture::Format::RG_UNORM_BC5) {
     return VK_FORMAT_BC5_UNORM_BLOCK;
   }
+  else if (format == asset::Texture::Format::RGBA_UNORM_BC1) {
+    return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+  }
+  else if (format == asset::Texture::Format::RGBA_SRGB_BC1) {
+    return VK_FORMAT_BC1_RGBA_SRGB_BLOCK;
+  }
+  else if (format == asset::Texture::Format::RGBA_UNORM_BC3) {
+    return VK_FORMAT_BC3_UNORM_BLOCK;
+  }
+  else if (format == asset::Texture::Format::RGBA_SRGB_BC3) {
+    return VK_FORMAT_BC3_SRGB_BLOCK;
+  }
+  else if (format == asset::Texture::Format::R_UNORM_BC4) {
+    return VK_FORMAT_BC4_UNORM_BLOCK;
+  }
   else if (format == asset::Texture::Format::R8_UNORM) {
     return VK_FORMAT_R8_UNORM;
   }
@@ -128,6 +158,21 @@ static unsigned numDimensions(render::asset::Texture::Format format)
   else if (format == asset::Texture::Format::RG_UNORM_BC5) {
     return 2;
   }
+  else if (format == asset::Texture::Format::RGBA_UNORM_BC1) {
+    return 4;
+  }
+  else if (format == asset::Texture::Format::RGBA_SRGB_BC1) {
+    return 4;
+  }
+  else if (format == asset::Texture::Format::RGBA_UNORM_BC3) {
+    return 4;
+  }
+  else if (format == asset::Texture::Format::RGBA_SRGB_BC3) {
+    return 4;
+  }
+  else if (format == asset::Texture::Format::R_UNORM_BC4) {
+    return 1;
+  }
   else if (format == asset::Texture::Format::R8_UNORM) {
     return 1;
   }
@@ -156,13 +201,28 @@ static std::size_t texSize(int w, int h, render::asset::Texture::Format format)
     return w * h * 1 * 3;
   }
   else if (format == asset::Texture::Format::RGBA_SRGB_BC7) {
-    return w * h * 1;
+    return ((w + 3) / 4) * ((h + 3) / 4) * 16;
   }
   else if (format == asset::Texture::Format::RGBA_UNORM_BC7) {
-    return w * h * 1;
+    return ((w + 3) / 4) * ((h + 3) / 4) * 16;
   }
   else if (format == asset::Texture::Format::RG_UNORM_BC5) {
-    return w * h * 1;
+    return ((w + 3) / 4) * ((h + 3) / 4) * 16;
+  }
+  else if (format == asset::Texture::Format::RGBA_UNORM_BC1) {
+    return ((w + 3) / 4) * ((h + 3) / 4) * 8;
+  }
+  else if (format == asset::Texture::Format::RGBA_SRGB_BC1) {
+    return ((w + 3) / 4) * ((h + 3) / 4) * 8;
+  }
+  else if (format == asset::Texture::Format::RGBA_UNORM_BC3) {
+    return ((w + 3) / 4) * ((h + 3) / 4) * 16;
+  }
+  else if (format == asset::Texture::Format::RGBA_SRGB_BC3) {
+    return ((w + 3) / 4) * ((h + 3) / 4) * 16;
+  }
+  else if (format == asset::Texture::Format::R_UNORM_BC4) {
+    return ((w + 3) / 4) * ((h + 3) / 4) * 8;
   }
 
   return w * h * 1 * 4;
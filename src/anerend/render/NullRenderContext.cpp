@@ -0,0 +1,499 @@
+#include "NullRenderContext.h"
+
+#include "../util/TextureHelpers.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace render {
+
+NullRenderContext::NullRenderContext(VkExtent2D extent, std::size_t gigaBufferSizeMB)
+  : _extent(extent)
+  , _gigaBufferSizeMB(gigaBufferSizeMB)
+  , _vtxMemIf(gigaBufferSizeMB * 1024 * 1024)
+  , _idxMemIf(gigaBufferSizeMB * 1024 * 1024)
+  , _bindlessTextureMemIf(MAX_BINDLESS_RESOURCES)
+  , _skeletonMemIf(MAX_NUM_SKINNED_MODELS * MAX_NUM_JOINTS)
+  , _cachedSkeletons(MAX_NUM_SKINNED_MODELS * MAX_NUM_JOINTS, glm::mat4(1.0f))
+{}
+
+NullRenderContext::~NullRenderContext()
+{
+  if (_registry) {
+    _nodeObserver.disconnect();
+  }
+}
+
+void NullRenderContext::setRegistry(component::Registry* registry)
+{
+  if (_registry) {
+    _nodeObserver.disconnect();
+  }
+
+  _registry = registry;
+
+  // Same collector as VulkanRenderer, minus terrain
+  _nodeObserver.connect(_registry->getEnttRegistry(), entt::collector
+    .update<component::PageStatus>()
+    .update<component::Light>()
+    .where<component::PageStatus>()
+    .update<component::Renderable>()
+    .where<component::PageStatus>()
+    .update<component::Transform>()
+    .where<component::PageStatus, component::Renderable>()
+    .update<component::Transform>()
+    .where<component::PageStatus, component::Light>());
+}
+
+void NullRenderContext::update(const Camera& camera, double delta)
+{
+  _latestCamera = camera;
+  _elapsedTime += delta;
+  _stagingBuffer.reset();
+
+  if (_registry) {
+    auto nodes = sceneNodes();
+    auto changes = internal::updateObservedNodes(*_registry, _nodeObserver, nodes);
+    _renderablesChanged |= changes._renderables;
+    _lightsChanged |= changes._lights;
+
+    internal::updateSkeletons(*_registry, nodes, _cachedSkeletons);
+  }
+
+  // Same order and conditions as VulkanRenderer::drawFrame()
+  prefillSkeletonBuffer();
+
+  if (_modelsChanged) {
+    prefillMeshBuffer();
+    _modelsChanged = false;
+  }
+
+  if (_materialsChanged) {
+    prefillMaterialBuffer();
+    _materialsChanged = false;
+  }
+
+  if (_renderablesChanged) {
+    prefillModelBuffer();
+    prefillRendMatIdxBuffer();
+    prefillRenderableBuffer();
+    _renderablesChanged = false;
+  }
+
+  if (_lightsChanged) {
+    prefillLightBuffer();
+    _lightsChanged = false;
+  }
+}
+
+void NullRenderContext::clearRecorded()
+{
+  _uploads.clear();
+  _commands.clear();
+}
+
+std::size_t NullRenderContext::uploadedBytes() const
+{
+  std::size_t bytes = 0;
+  for (auto& upload : _uploads) {
+    bytes += upload._bytes;
+  }
+  return bytes;
+}
+
+void NullRenderContext::record(RecordedUpload::Type type, std::size_t bytes, util::Uuid id)
+{
+  RecordedUpload upload{};
+  upload._type = type;
+  upload._id = id;
+  upload._bytes = bytes;
+  _uploads.emplace_back(std::move(upload));
+
+  _stagingBuffer.advance(bytes);
+}
+
+internal::SceneAssets NullRenderContext::sceneAssets()
+{
+  return internal::SceneAssets{
+    _currentModels, _currentMeshes, _currentMaterials, _currentTextures,
+    _modelIdMap, _meshIdMap, _materialIdMap, _textureIdMap };
+}
+
+internal::SceneNodes NullRenderContext::sceneNodes()
+{
+  return internal::SceneNodes{
+    _currentRenderables, _pendingFirstUploadRenderables, _renderableIdMap,
+    _lights, _shadowCasters,
+    _skeletonMemIf, _skeletonOffsets,
+    MAX_NUM_RENDERABLES };
+}
+
+void NullRenderContext::assetUpdate(AssetUpdate&& update)
+{
+  // Uploads are immediate, and since nothing is in flight memory is given back immediately as well.
+  auto assets = sceneAssets();
+
+  bool textureIdMapUpdate = !update._removedTextures.empty();
+
+  // Removed models
+  internal::removeModels(assets, update._removedModels, [this](internal::InternalMesh& mesh) {
+    _vtxMemIf.removeData(mesh._vertexHandle);
+    if (mesh._indexHandle) {
+      _idxMemIf.removeData(mesh._indexHandle);
+    }
+  });
+
+  // Added models
+  for (auto& model : update._addedModels) {
+    if (!internal::addModel(assets, model, MAX_NUM_MESHES)) {
+      continue;
+    }
+
+    for (const auto& mesh : model._meshes) {
+      if (!mesh._id) {
+        continue;
+      }
+
+      // Same layout as the upload queue writes into the giga buffers
+      std::size_t vertSize = mesh._vertices.size() * sizeof(Vertex);
+      std::size_t indSize = mesh._indices.size() * sizeof(uint32_t);
+
+      auto vertexHandle = _vtxMemIf.addData(vertSize);
+      if (!vertexHandle) {
+        printf("Cannot upload mesh %s, giga vertex buffer full!\n", mesh._id.str().c_str());
+        continue;
+      }
+
+      internal::BufferMemoryInterface::Handle indexHandle{};
+      if (indSize > 0) {
+        indexHandle = _idxMemIf.addData(indSize);
+        if (!indexHandle) {
+          printf("Cannot upload mesh %s, giga index buffer full!\n", mesh._id.str().c_str());
+          _vtxMemIf.removeData(vertexHandle);
+          continue;
+        }
+      }
+
+      internal::InternalMesh internalMesh{};
+      internalMesh._id = mesh._id;
+      internalMesh._numIndices = static_cast<uint32_t>(mesh._indices.size());
+      internalMesh._numVertices = static_cast<uint32_t>(mesh._vertices.size());
+      internalMesh._minPos = mesh._minPos;
+      internalMesh._maxPos = mesh._maxPos;
+      internalMesh._vertexHandle = vertexHandle;
+      internalMesh._indexHandle = indexHandle;
+      internalMesh._vertexOffset = static_cast<uint32_t>(vertexHandle._offset / sizeof(Vertex));
+      internalMesh._indexOffset = indexHandle._offset == -1 ? -1 : static_cast<int64_t>(indexHandle._offset / sizeof(uint32_t));
+
+      _meshIdMap[mesh._id] = _currentMeshes.size();
+      _currentMeshes.emplace_back(std::move(internalMesh));
+
+      record(RecordedUpload::Mesh, vertSize + indSize, mesh._id);
+    }
+  }
+
+  // Removed textures
+  internal::removeTextures(assets, update._removedTextures, [this](internal::InternalTexture& tex) {
+    _bindlessTextureMemIf.removeData(tex._bindlessInfo._bindlessIndexHandle);
+  });
+
+  // Updated textures, i.e. new mips streamed in. Swapped in under a new bindless index like VulkanRenderer does.
+  for (auto& tex : update._updatedTextures) {
+    auto it = _textureIdMap.find(tex._id);
+    if (it == _textureIdMap.end()) {
+      printf("Cannot update unknown texture\n");
+      continue;
+    }
+
+    auto& internalTex = _currentTextures[it->second];
+    _bindlessTextureMemIf.removeData(internalTex._bindlessInfo._bindlessIndexHandle);
+    internalTex._bindlessInfo._bindlessIndexHandle = _bindlessTextureMemIf.addData(1);
+    internalTex._firstMip = tex._firstMip;
+
+    std::size_t bytes = 0;
+    for (auto& dat : tex._data) {
+      bytes += dat.size();
+    }
+    record(RecordedUpload::Texture, bytes, tex._id);
+
+    textureIdMapUpdate = true;
+  }
+
+  // Added textures
+  for (auto& tex : update._addedTextures) {
+    if (!tex._id) {
+      printf("Cannot add texture with invalid id!\n");
+      continue;
+    }
+
+    if (!tex) {
+      printf("Cannot add texture without data!\n");
+      continue;
+    }
+
+    auto handle = _bindlessTextureMemIf.addData(1);
+    if (!handle) {
+      printf("Cannot add texture %s, bindless resources full!\n", tex._id.str().c_str());
+      continue;
+    }
+
+    internal::InternalTexture internalTex{};
+    internalTex._id = tex._id;
+    internalTex._firstMip = tex._firstMip;
+    internalTex._bindlessInfo._bindlessIndexHandle = handle;
+
+    _textureIdMap[tex._id] = _currentTextures.size();
+    _currentTextures.emplace_back(std::move(internalTex));
+
+    std::size_t bytes = 0;
+    for (auto& dat : tex._data) {
+      bytes += dat.size();
+    }
+    record(RecordedUpload::Texture, bytes, tex._id);
+
+    textureIdMapUpdate = true;
+  }
+
+  // Materials
+  internal::removeMaterials(assets, update._removedMaterials);
+
+  for (auto& mat : update._addedMaterials) {
+    internal::addMaterial(assets, mat, MAX_NUM_MATERIALS);
+  }
+
+  internal::updateMaterials(assets, update._updatedMaterials);
+
+  // Book-keeping, textures change bindless indices which both materials and renderables depend on
+  bool modelChange = !update._addedModels.empty() || !update._removedModels.empty();
+  bool materialChange = !update._addedMaterials.empty() || !update._removedMaterials.empty() || !update._updatedMaterials.empty();
+
+  _modelsChanged |= modelChange;
+  _materialsChanged |= materialChange || textureIdMapUpdate;
+  _renderablesChanged |= modelChange || materialChange || textureIdMapUpdate;
+}
+
+void NullRenderContext::prefillMaterialBuffer()
+{
+  _materialBuffer.resize(_currentMaterials.size());
+  internal::fillMaterialBuffer(sceneAssets(), _materialBuffer.data());
+
+  record(RecordedUpload::MaterialBuffer, _materialBuffer.size() * sizeof(gpu::GPUMaterialInfo));
+}
+
+void NullRenderContext::prefillMeshBuffer()
+{
+  _meshBuffer.resize(_currentMeshes.size());
+  internal::fillMeshBuffer(_currentMeshes, _meshBuffer.data());
+
+  record(RecordedUpload::MeshBuffer, _meshBuffer.size() * sizeof(gpu::GPUMeshInfo));
+}
+
+void NullRenderContext::prefillModelBuffer()
+{
+  internal::fillModelBuffer(sceneAssets(), sceneNodes(), false, _modelBuffer);
+
+  record(RecordedUpload::ModelBuffer, (_modelBuffer.size() + 1) * sizeof(uint32_t));
+}
+
+void NullRenderContext::prefillRendMatIdxBuffer()
+{
+  internal::fillRendMatIdxBuffer(sceneAssets(), sceneNodes(), _rendMatIdxBuffer);
+
+  record(RecordedUpload::RendMatIdxBuffer, (_rendMatIdxBuffer.size() + 1) * sizeof(uint32_t));
+}
+
+void NullRenderContext::prefillRenderableBuffer()
+{
+  auto assets = sceneAssets();
+  auto nodes = sceneNodes();
+
+  internal::promotePendingRenderables(assets, nodes);
+
+  _renderableBuffer.resize(_currentRenderables.size());
+  internal::fillRenderableBuffer(assets, nodes, {}, _currentMeshUsage, _renderableBuffer.data());
+
+  record(RecordedUpload::RenderableBuffer, _renderableBuffer.size() * sizeof(gpu::GPURenderable));
+}
+
+void NullRenderContext::prefillSkeletonBuffer()
+{
+  std::size_t numMatrices = _skeletonMemIf.usedSpace();
+
+  if (numMatrices == 0) {
+    return;
+  }
+
+  _skeletonBuffer.assign(_cachedSkeletons.begin(), _cachedSkeletons.begin() + numMatrices);
+
+  record(RecordedUpload::SkeletonBuffer, numMatrices * sizeof(glm::mat4));
+}
+
+void NullRenderContext::prefillLightBuffer()
+{
+  _lightBuffer.resize(MAX_NUM_LIGHTS);
+  internal::fillLightBuffer(_lights, _lightBuffer);
+
+  record(RecordedUpload::LightBuffer, MAX_NUM_LIGHTS * sizeof(gpu::GPULight));
+}
+
+void NullRenderContext::generateMipMaps(asset::Texture& tex)
+{
+  util::TextureHelpers::generateMipMaps(tex);
+}
+
+void NullRenderContext::drawGigaBufferIndirect(VkCommandBuffer*, VkBuffer, uint32_t drawCount)
+{
+  RecordedCommand cmd{};
+  cmd._type = RecordedCommand::DrawIndirect;
+  cmd._count = drawCount;
+  _commands.emplace_back(std::move(cmd));
+}
+
+void NullRenderContext::drawGigaBufferIndirectCount(VkCommandBuffer*, VkBuffer, VkBuffer, uint32_t maxDrawCount)
+{
+  RecordedCommand cmd{};
+  cmd._type = RecordedCommand::DrawIndirectCount;
+  cmd._count = maxDrawCount;
+  _commands.emplace_back(std::move(cmd));
+}
+
+void NullRenderContext::drawNonIndexIndirect(VkCommandBuffer*, VkBuffer, uint32_t drawCount, uint32_t)
+{
+  RecordedCommand cmd{};
+  cmd._type = RecordedCommand::DrawNonIndexIndirect;
+  cmd._count = drawCount;
+  _commands.emplace_back(std::move(cmd));
+}
+
+void NullRenderContext::drawMeshId(VkCommandBuffer*, util::Uuid meshId, uint32_t instanceCount)
+{
+  RecordedCommand cmd{};
+  cmd._type = RecordedCommand::DrawMesh;
+  cmd._count = instanceCount;
+  cmd._meshId = meshId;
+  _commands.emplace_back(std::move(cmd));
+}
+
+VkCommandBuffer NullRenderContext::beginSingleTimeCommands()
+{
+  RecordedCommand cmd{};
+  cmd._type = RecordedCommand::BeginSingleTime;
+  _commands.emplace_back(std::move(cmd));
+
+  return VK_NULL_HANDLE;
+}
+
+void NullRenderContext::endSingleTimeCommands(VkCommandBuffer)
+{
+  RecordedCommand cmd{};
+  cmd._type = RecordedCommand::EndSingleTime;
+  _commands.emplace_back(std::move(cmd));
+}
+
+void NullRenderContext::startTimer(const std::string& name, VkCommandBuffer)
+{
+  RecordedCommand cmd{};
+  cmd._type = RecordedCommand::StartTimer;
+  cmd._timer = name;
+  _commands.emplace_back(std::move(cmd));
+}
+
+void NullRenderContext::stopTimer(const std::string& name, VkCommandBuffer)
+{
+  RecordedCommand cmd{};
+  cmd._type = RecordedCommand::StopTimer;
+  cmd._timer = name;
+  _commands.emplace_back(std::move(cmd));
+}
+
+std::vector<int> NullRenderContext::getShadowCasterLightIndices()
+{
+  return internal::shadowCasterLightIndices(_lights, _shadowCasters);
+}
+
+bool NullRenderContext::getRenderableById(util::Uuid id, internal::InternalRenderable** out)
+{
+  auto it = _renderableIdMap.find(id);
+  if (it == _renderableIdMap.end()) {
+    printf("Warning! Cannot get renderable with id %s, doesn't exist!\n", id.str().c_str());
+    return false;
+  }
+
+  *out = &_currentRenderables[it->second];
+  return true;
+}
+
+bool NullRenderContext::getMeshById(util::Uuid id, internal::InternalMesh** out)
+{
+  auto it = _meshIdMap.find(id);
+  if (it == _meshIdMap.end()) {
+    printf("Warning! Cannot get mesh with id %s, doesn't exist!\n", id.str().c_str());
+    return false;
+  }
+
+  *out = &_currentMeshes[it->second];
+  return true;
+}
+
+gpu::GPUCullPushConstants NullRenderContext::getCullParams()
+{
+  gpu::GPUCullPushConstants cullPushConstants{};
+  cullPushConstants._drawCount = (uint32_t)_currentRenderables.size();
+
+  auto inds = getShadowCasterLightIndices();
+
+  cullPushConstants._frustumPlanes[0] = _latestCamera.getFrustum().getPlane(Frustum::Left);
+  cullPushConstants._frustumPlanes[1] = _latestCamera.getFrustum().getPlane(Frustum::Right);
+  cullPushConstants._frustumPlanes[2] = _latestCamera.getFrustum().getPlane(Frustum::Top);
+  cullPushConstants._frustumPlanes[3] = _latestCamera.getFrustum().getPlane(Frustum::Bottom);
+  cullPushConstants._view = _latestCamera.getCamMatrix();
+  cullPushConstants._farDist = _latestCamera.getFar();
+  cullPushConstants._nearDist = _latestCamera.getNear();
+  cullPushConstants._pointLightShadowInds = glm::ivec4(inds[0], inds[1], inds[2], inds[3]);
+
+  return cullPushConstants;
+}
+
+void NullRenderContext::debugDrawLine(debug::Line line)
+{
+  _currentDebugLines.emplace_back(std::move(line));
+}
+
+void NullRenderContext::debugDrawTriangle(debug::Triangle triangle)
+{
+  _currentDebugTriangles.emplace_back(std::move(triangle));
+}
+
+void NullRenderContext::debugDrawGeometry(debug::Geometry geometry)
+{
+  if (geometry._wireframe) {
+    _currentDebugGeometriesWireframe.emplace_back(std::move(geometry));
+  }
+  else {
+    _currentDebugGeometries.emplace_back(std::move(geometry));
+  }
+}
+
+bool NullRenderContext::blackboardValueBool(const std::string& key)
+{
+  auto it = _blackboard.find(key);
+  return it != _blackboard.end() ? std::any_cast<bool>(it->second) : false;
+}
+
+int NullRenderContext::blackboardValueInt(const std::string& key)
+{
+  auto it = _blackboard.find(key);
+  return it != _blackboard.end() ? std::any_cast<int>(it->second) : -1;
+}
+
+void NullRenderContext::setBlackboardValueBool(const std::string& key, bool val)
+{
+  _blackboard[key] = val;
+}
+
+void NullRenderContext::setBlackboardValueInt(const std::string& key, int val)
+{
+  _blackboard[key] = val;
+}
+
+}
@@ -0,0 +1,307 @@
+#pragma once
+
+#include "RenderContext.h"
+#include "Camera.h"
+#include "internal/InternalMesh.h"
+#include "internal/InternalModel.h"
+#include "internal/InternalMaterial.h"
+#include "internal/InternalRenderable.h"
+#include "internal/InternalLight.h"
+#include "internal/InternalTexture.h"
+#include "internal/BufferMemoryInterface.h"
+#include "internal/StagingBuffer.h"
+#include "internal/SceneBookkeeping.h"
+#include "../component/Registry.h"
+
+#include <any>
+#include <array>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace render {
+
+/*
+* A RenderContext that needs no window, device or GPU.
+* Everything that VulkanRenderer would copy to GPU buffers or record into command buffers
+* is instead kept in CPU-side vectors that can be inspected after each update().
+* The node/asset bookkeeping is the same as VulkanRenderer's, minus ray tracing, terrain and asset fetching,
+* so that the CPU cost of the renderer can be tested and benchmarked on any machine.
+* Both go through internal/SceneBookkeeping.h for it, which also fills the buffers that would be uploaded.
+* All Vulkan handles returned are VK_NULL_HANDLE.
+*/
+class NullRenderContext : public RenderContext
+{
+public:
+  static const std::size_t MAX_NUM_RENDERABLES = std::size_t(1e5);
+  static const std::size_t MAX_NUM_MESHES = 2500;
+  static const std::size_t MAX_NUM_MATERIALS = 500;
+  static const std::size_t MAX_NUM_LIGHTS = 1024;
+  static const std::size_t MAX_BINDLESS_RESOURCES = 16536;
+  static const std::size_t MAX_NUM_JOINTS = 50;
+  static const std::size_t MAX_NUM_SKINNED_MODELS = 1000;
+  static const std::size_t MAX_NUM_POINT_LIGHT_SHADOWS = 4;
+
+  // Something that would have been copied to the GPU, either an asset or a whole prefilled buffer.
+  struct RecordedUpload
+  {
+    enum Type
+    {
+      Mesh,
+      Texture,
+      MaterialBuffer,
+      MeshBuffer,
+      ModelBuffer,
+      RendMatIdxBuffer,
+      RenderableBuffer,
+      SkeletonBuffer,
+      LightBuffer
+    } _type;
+
+    util::Uuid _id; // Only set for assets
+    std::size_t _bytes = 0;
+  };
+
+  // Something that would have been recorded into a command buffer.
+  struct RecordedCommand
+  {
+    enum Type
+    {
+      DrawIndirect,
+      DrawIndirectCount,
+      DrawNonIndexIndirect,
+      DrawMesh,
+      BeginSingleTime,
+      EndSingleTime,
+      StartTimer,
+      StopTimer
+    } _type;
+
+    std::uint32_t _count = 0; // Draw count, max draw count or instance count
+    util::Uuid _meshId;
+    std::string _timer;
+  };
+
+  NullRenderContext(VkExtent2D extent = { 1920, 1080 }, std::size_t gigaBufferSizeMB = 512);
+  ~NullRenderContext();
+
+  NullRenderContext(const NullRenderContext&) = delete;
+  NullRenderContext(NullRenderContext&&) = delete;
+  NullRenderContext& operator=(const NullRenderContext&) = delete;
+  NullRenderContext& operator=(NullRenderContext&&) = delete;
+
+  // Update which registry to use for observing components.
+  void setRegistry(component::Registry* registry);
+
+  // The CPU side of VulkanRenderer::update() and drawFrame(): observes nodes, updates skeletons
+  // and prefills every buffer that changed, recording an upload for each.
+  void update(const Camera& camera, double delta);
+
+  // Inspection
+  const std::vector<RecordedUpload>& uploads() const { return _uploads; }
+  const std::vector<RecordedCommand>& commands() const { return _commands; }
+  void clearRecorded();
+
+  // Sum of the bytes of all recorded uploads, i.e. what would have gone through the staging buffer.
+  std::size_t uploadedBytes() const;
+
+  const std::vector<gpu::GPURenderable>& renderableBuffer() const { return _renderableBuffer; }
+  const std::vector<std::uint32_t>& rendMatIdxBuffer() const { return _rendMatIdxBuffer; }
+  const std::vector<std::uint32_t>& modelBuffer() const { return _modelBuffer; }
+  const std::vector<gpu::GPUMeshInfo>& meshBuffer() const { return _meshBuffer; }
+  const std::vector<gpu::GPUMaterialInfo>& materialBuffer() const { return _materialBuffer; }
+  const std::vector<gpu::GPULight>& lightBuffer() const { return _lightBuffer; }
+  const std::vector<glm::mat4>& skeletonBuffer() const { return _skeletonBuffer; }
+
+  std::size_t numPendingRenderables() const { return _pendingFirstUploadRenderables.size(); }
+  const internal::BufferMemoryInterface& vtxMemInterface() const { return _vtxMemIf; }
+  const internal::BufferMemoryInterface& idxMemInterface() const { return _idxMemIf; }
+
+  // Render Context interface
+  bool isBaking() override final { return false; }
+
+  void generateMipMaps(asset::Texture& tex) override final;
+
+  VkDevice& device() override final { return _device; }
+  VkDescriptorPool& descriptorPool() override final { return _descriptorPool; }
+  VmaAllocator vmaAllocator() override final { return nullptr; }
+  internal::StagingBuffer& getStagingBuffer() override final { return _stagingBuffer; }
+
+  VkPipelineLayout& bindlessPipelineLayout() override final { return _bindlessPipelineLayout; }
+  VkDescriptorSetLayout& bindlessDescriptorSetLayout() override final { return _bindlessDescriptorSetLayout; }
+  VkExtent2D swapChainExtent() override final { return _extent; }
+
+  std::size_t getGigaBufferSizeMB() override final { return _gigaBufferSizeMB; }
+
+  VkDeviceAddress getGigaVtxBufferAddr() override final { return 0; }
+  VkDeviceAddress getGigaIdxBufferAddr() override final { return 0; }
+
+  void drawGigaBufferIndirect(VkCommandBuffer*, VkBuffer drawCalls, uint32_t drawCount) override final;
+  void drawGigaBufferIndirectCount(VkCommandBuffer*, VkBuffer drawCalls, VkBuffer count, uint32_t maxDrawCount) override final;
+  void drawNonIndexIndirect(VkCommandBuffer*, VkBuffer drawCalls, uint32_t drawCount, uint32_t stride) override final;
+  void drawMeshId(VkCommandBuffer*, util::Uuid, uint32_t instanceCount) override final;
+
+  VkImage& getCurrentSwapImage() override final { return _swapImage; }
+  int getCurrentMultiBufferIdx() override final { return 0; }
+  int getMultiBufferSize() override final { return 1; }
+
+  void assetUpdate(AssetUpdate&& update) override final;
+
+  size_t getMaxNumMeshes() override final { return MAX_NUM_MESHES; }
+  size_t getMaxNumRenderables() override final { return MAX_NUM_RENDERABLES; }
+  size_t getMaxBindlessResources() override final { return MAX_BINDLESS_RESOURCES; }
+  size_t getMaxNumPointLightShadows() override final { return MAX_NUM_POINT_LIGHT_SHADOWS; }
+
+  const std::vector<internal::InternalLight>& getLights() override final { return _lights; }
+  std::vector<int> getShadowCasterLightIndices() override final;
+
+  std::vector<std::size_t> getTerrainIndices() override final { return {}; }
+
+  std::vector<internal::InternalMesh>& getCurrentMeshes() override final { return _currentMeshes; }
+  std::vector<internal::InternalRenderable>& getCurrentRenderables() override final { return _currentRenderables; }
+  bool getRenderableById(util::Uuid id, internal::InternalRenderable** out) override final;
+  bool getMeshById(util::Uuid id, internal::InternalMesh** out) override final;
+  std::unordered_map<util::Uuid, std::size_t>& getCurrentMeshUsage() override final { return _currentMeshUsage; }
+  size_t getCurrentNumRenderables() override final { return _currentRenderables.size(); }
+
+  std::unordered_map<util::Uuid, std::vector<AccelerationStructure>>& getDynamicBlases() override final { return _dynamicBlases; }
+
+  gpu::GPUCullPushConstants getCullParams() override final;
+
+  RenderDebugOptions& getDebugOptions() override final { return _debugOptions; }
+  RenderOptions& getRenderOptions() override final { return _renderOptions; }
+
+  void setDebugName(VkObjectType, uint64_t, const char*) override final {}
+
+  glm::vec2 getWindDir() override final { return { 0.0f, 0.0f }; }
+
+  VkCommandBuffer beginSingleTimeCommands() override final;
+  void endSingleTimeCommands(VkCommandBuffer buffer) override final;
+
+  VkPhysicalDeviceRayTracingPipelinePropertiesKHR getRtPipeProps() override final { return {}; }
+  PipelineCache* getPipelineCache() override final { return nullptr; }
+
+  void registerPerFrameTimer(const std::string&, const std::string&) override final {}
+  void startTimer(const std::string& name, VkCommandBuffer cmdBuffer) override final;
+  void stopTimer(const std::string& name, VkCommandBuffer cmdBuffer) override final;
+
+  internal::InternalMesh& getSphereMesh() override final { return _sphereMesh; }
+
+  size_t getNumIrradianceProbesXZ() override final { return 0; }
+  size_t getNumIrradianceProbesY() override final { return 0; }
+
+  double getElapsedTime() override final { return _elapsedTime; }
+
+  const Camera& getCamera() override final { return _latestCamera; }
+
+  AccelerationStructure& getTLAS() override final { return _tlas; }
+
+  VkFormat getHDRFormat() override final { return VK_FORMAT_R16G16B16A16_SFLOAT; }
+
+  void debugDrawLine(debug::Line line) override final;
+  void debugDrawTriangle(debug::Triangle triangle) override final;
+  void debugDrawGeometry(debug::Geometry geometry) override final;
+
+  std::vector<debug::Line> takeCurrentDebugLines() override final { return std::move(_currentDebugLines); }
+  std::vector<debug::Triangle> takeCurrentDebugTriangles() override final { return std::move(_currentDebugTriangles); }
+  std::vector<debug::Geometry> takeCurrentDebugGeometry() override final { return std::move(_currentDebugGeometries); }
+  std::vector<debug::Geometry> takeCurrentDebugGeometryWireframe() override final { return std::move(_currentDebugGeometriesWireframe); }
+
+  ParticleEmitterPool& getParticleEmitters() override final { return _particleEmitters; }
+
+  bool blackboardValueBool(const std::string& key) override final;
+  int blackboardValueInt(const std::string& key) override final;
+  void setBlackboardValueBool(const std::string& key, bool val) override final;
+  void setBlackboardValueInt(const std::string& key, int val) override final;
+
+private:
+  internal::SceneAssets sceneAssets();
+  internal::SceneNodes sceneNodes();
+
+  void prefillMaterialBuffer();
+  void prefillMeshBuffer();
+  void prefillModelBuffer();
+  void prefillRendMatIdxBuffer();
+  void prefillRenderableBuffer();
+  void prefillSkeletonBuffer();
+  void prefillLightBuffer();
+
+  void record(RecordedUpload::Type type, std::size_t bytes, util::Uuid id = util::Uuid());
+
+  component::Registry* _registry = nullptr;
+  entt::observer _nodeObserver;
+
+  VkExtent2D _extent;
+  std::size_t _gigaBufferSizeMB;
+  double _elapsedTime = 0.0;
+  Camera _latestCamera;
+
+  RenderOptions _renderOptions;
+  RenderDebugOptions _debugOptions;
+
+  // Null handles, only here so that the interface can return references
+  VkDevice _device = VK_NULL_HANDLE;
+  VkDescriptorPool _descriptorPool = VK_NULL_HANDLE;
+  VkPipelineLayout _bindlessPipelineLayout = VK_NULL_HANDLE;
+  VkDescriptorSetLayout _bindlessDescriptorSetLayout = VK_NULL_HANDLE;
+  VkImage _swapImage = VK_NULL_HANDLE;
+  internal::StagingBuffer _stagingBuffer;
+  AccelerationStructure _tlas;
+  std::unordered_map<util::Uuid, std::vector<AccelerationStructure>> _dynamicBlases;
+  internal::InternalMesh _sphereMesh;
+
+  std::vector<RecordedUpload> _uploads;
+  std::vector<RecordedCommand> _commands;
+
+  // What would have been on the GPU
+  std::vector<gpu::GPURenderable> _renderableBuffer;
+  std::vector<std::uint32_t> _rendMatIdxBuffer;
+  std::vector<std::uint32_t> _modelBuffer;
+  std::vector<gpu::GPUMeshInfo> _meshBuffer;
+  std::vector<gpu::GPUMaterialInfo> _materialBuffer;
+  std::vector<gpu::GPULight> _lightBuffer;
+  std::vector<glm::mat4> _skeletonBuffer;
+
+  internal::BufferMemoryInterface _vtxMemIf;
+  internal::BufferMemoryInterface _idxMemIf;
+  internal::BufferMemoryInterface _bindlessTextureMemIf;
+  internal::BufferMemoryInterface _skeletonMemIf;
+  std::unordered_map<util::Uuid, internal::BufferMemoryInterface::Handle> _skeletonOffsets;
+
+  // CPU mirror of the skeleton buffer, MAX_NUM_SKINNED_MODELS * MAX_NUM_JOINTS matrices.
+  std::vector<glm::mat4> _cachedSkeletons;
+
+  std::vector<internal::InternalModel> _currentModels;
+  std::vector<internal::InternalMesh> _currentMeshes;
+  std::vector<internal::InternalMaterial> _currentMaterials;
+  std::vector<internal::InternalTexture> _currentTextures;
+  std::vector<internal::InternalRenderable> _currentRenderables;
+  std::vector<internal::InternalRenderable> _pendingFirstUploadRenderables;
+
+  std::unordered_map<util::Uuid, std::size_t> _modelIdMap;
+  std::unordered_map<util::Uuid, std::size_t> _meshIdMap;
+  std::unordered_map<util::Uuid, std::size_t> _renderableIdMap;
+  std::unordered_map<util::Uuid, std::size_t> _materialIdMap;
+  std::unordered_map<util::Uuid, std::size_t> _textureIdMap;
+
+  std::unordered_map<util::Uuid, std::size_t> _currentMeshUsage;
+
+  // No frames in flight, so a single flag per buffer
+  bool _modelsChanged = false;
+  bool _renderablesChanged = false;
+  bool _lightsChanged = true;
+  bool _materialsChanged = false;
+
+  std::vector<internal::InternalLight> _lights;
+  std::array<util::Uuid, MAX_NUM_POINT_LIGHT_SHADOWS> _shadowCasters;
+
+  std::vector<debug::Line> _currentDebugLines;
+  std::vector<debug::Triangle> _currentDebugTriangles;
+  std::vector<debug::Geometry> _currentDebugGeometriesWireframe;
+  std::vector<debug::Geometry> _currentDebugGeometries;
+
+  ParticleEmitterPool _particleEmitters;
+  std::unordered_map<std::string, std::any> _blackboard;
+};
+
+}
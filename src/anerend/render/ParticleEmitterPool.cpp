@@ -0,0 +1,210 @@
+#include "ParticleEmitterPool.h"
+
+#include "ParticleSimulation.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace render {
+
+namespace {
+
+// Uploads that a removed emitter's slot stays empty. The first one kills its particles on the GPU.
+constexpr std::uint32_t g_UploadsUntilFree = 2;
+
+}
+
+ParticleEmitterPool::ParticleEmitterPool()
+{
+  _freeRanges.emplace_back(Range{ 0, MAX_PARTICLES });
+}
+
+bool ParticleEmitterPool::set(const util::Uuid& node, const component::ParticleEmitter& emitter, const glm::mat4& transform)
+{
+  // Emitters without particles are treated as removed
+  if (emitter._maxParticles == 0) {
+    return true;
+  }
+
+  auto it = _slotIndices.find(node);
+  if (it != _slotIndices.end()) {
+    auto& slot = _slots[it->second];
+
+    // Resized, starts over in a new range
+    if (slot._range._size != emitter._maxParticles) {
+      remove(it->second);
+    }
+    else {
+      slot._emitter = emitter;
+      slot._position = glm::vec3(transform[3]);
+      slot._set = true;
+      return true;
+    }
+  }
+
+  if (_freeSlots.empty() && _slots.size() >= MAX_EMITTERS) {
+    if (_warned.insert(node).second) {
+      printf("Particle emitter %s does not fit, there are already %u emitters\n", node.str().c_str(), MAX_EMITTERS);
+    }
+    return false;
+  }
+
+  Range range{};
+  if (!allocateRange(emitter._maxParticles, range)) {
+    if (_warned.insert(node).second) {
+      printf("Particle emitter %s does not fit, %u of %u particles are reserved\n", node.str().c_str(), _numReserved, MAX_PARTICLES);
+    }
+    return false;
+  }
+
+  std::uint32_t slotIdx = 0;
+  if (!_freeSlots.empty()) {
+    slotIdx = _freeSlots.back();
+    _freeSlots.pop_back();
+  }
+  else {
+    slotIdx = (std::uint32_t)_slots.size();
+    _slots.emplace_back();
+  }
+
+  auto& slot = _slots[slotIdx];
+  slot = Slot{};
+  slot._state = SlotState::Active;
+  slot._node = node;
+  slot._emitter = emitter;
+  slot._position = glm::vec3(transform[3]);
+  slot._range = range;
+  slot._set = true;
+  slot._reset = true;
+
+  _slotIndices[node] = slotIdx;
+  _warned.erase(node);
+  return true;
+}
+
+void ParticleEmitterPool::update(double delta)
+{
+  _frame++;
+  _gpuEmitters.resize(_slots.size());
+
+  for (std::uint32_t i = 0; i < (std::uint32_t)_slots.size(); ++i) {
+    auto& slot = _slots[i];
+    if (slot._state == SlotState::Active && !slot._set) {
+      remove(i);
+    }
+    slot._set = false;
+
+    fillGpuEmitter(i, delta);
+  }
+}
+
+void ParticleEmitterPool::uploaded()
+{
+  for (std::uint32_t i = 0; i < (std::uint32_t)_slots.size(); ++i) {
+    auto& slot = _slots[i];
+    slot._reset = false;
+
+    if (slot._state == SlotState::Removed && --slot._uploadsUntilFree == 0) {
+      freeRange(slot._range);
+      slot = Slot{};
+      _freeSlots.emplace_back(i);
+    }
+  }
+}
+
+void ParticleEmitterPool::resetGpuState()
+{
+  for (auto& slot : _slots) {
+    if (slot._state == SlotState::Active) {
+      slot._reset = true;
+      slot._spawnAccumulator = 0.0;
+    }
+  }
+}
+
+bool ParticleEmitterPool::allocateRange(std::uint32_t size, Range& rangeOut)
+{
+  auto it = std::find_if(_freeRanges.begin(), _freeRanges.end(), [size](const Range& r) { return r._size >= size; });
+  if (it == _freeRanges.end()) {
+    return false;
+  }
+
+  rangeOut = Range{ it->_start, size };
+  it->_start += size;
+  it->_size -= size;
+  if (it->_size == 0) {
+    _freeRanges.erase(it);
+  }
+
+  _numReserved += size;
+  return true;
+}
+
+void ParticleEmitterPool::freeRange(Range range)
+{
+  auto it = std::lower_bound(_freeRanges.begin(), _freeRanges.end(), range, [](const Range& a, const Range& b) { return a._start < b._start; });
+  it = _freeRanges.insert(it, range);
+  _numReserved -= range._size;
+
+  // Merge with the next, then the previous
+  auto next = it + 1;
+  if (next != _freeRanges.end() && it->_start + it->_size == next->_start) {
+    it->_size += next->_size;
+    _freeRanges.erase(next);
+  }
+
+  if (it != _freeRanges.begin()) {
+    auto prev = it - 1;
+    if (prev->_start + prev->_size == it->_start) {
+      prev->_size += it->_size;
+      _freeRanges.erase(it);
+    }
+  }
+}
+
+void ParticleEmitterPool::remove(std::uint32_t slotIdx)
+{
+  auto& slot = _slots[slotIdx];
+  _slotIndices.erase(slot._node);
+  slot._state = SlotState::Removed;
+  slot._uploadsUntilFree = g_UploadsUntilFree;
+  slot._set = false;
+}
+
+void ParticleEmitterPool::fillGpuEmitter(std::uint32_t slotIdx, double delta)
+{
+  auto& slot = _slots[slotIdx];
+  auto& gpuEmitter = _gpuEmitters[slotIdx];
+  gpuEmitter = gpu::GPUParticleEmitter{};
+
+  if (slot._state != SlotState::Active) {
+    return;
+  }
+
+  auto& e = slot._emitter;
+
+  std::uint32_t spawnCount = 0;
+  if (e._enabled) {
+    slot._spawnAccumulator += std::max(e._spawnRate, 0.0f) * delta;
+    double whole = std::floor(slot._spawnAccumulator);
+    slot._spawnAccumulator -= whole;
+    spawnCount = (std::uint32_t)std::min(whole, (double)slot._range._size);
+  }
+  else {
+    slot._spawnAccumulator = 0.0;
+  }
+
+  gpuEmitter.position = glm::vec4(slot._position, e._spawnRadius);
+  gpuEmitter.minVelocity = glm::vec4(e._minVelocity, e._lifetime);
+  gpuEmitter.maxVelocity = glm::vec4(e._maxVelocity, e._bounce ? e._restitution : -1.0f);
+  gpuEmitter.gravity = glm::vec4(e._gravity, slot._position.y + e._groundOffset);
+  gpuEmitter.scale = glm::vec4(e._minScale, e._maxScale, 0.0f, 0.0f);
+  gpuEmitter.rangeStart = slot._range._start;
+  gpuEmitter.rangeSize = slot._range._size;
+  gpuEmitter.spawnCount = spawnCount;
+  gpuEmitter.seed = particleHash(slotIdx ^ particleHash(_frame));
+  gpuEmitter.flags = slot._reset ? gpu::PARTICLE_EMITTER_RESET_FLAG : 0;
+}
+
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "GpuBuffers.h"
+#include "../component/Components.h"
+#include "../util/Uuid.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace render {
+
+/*
+* CPU side of the particle system. Every ParticleEmitter gets a slot in the GPU emitter table and its own range
+* of the particle pool, as big as its _maxParticles, which is all it can ever have alive.
+* Ranges come from a first-fit free list over the pool. When an emitter goes away its slot is kept with a range
+* size of 0 for a couple of frames, so that the GPU kills its particles before slot and range are reused.
+* Spawn rates are turned into whole particles per frame, the remainder carries over.
+*/
+class ParticleEmitterPool
+{
+public:
+  static constexpr std::uint32_t MAX_EMITTERS = 1024;
+  static constexpr std::uint32_t MAX_PARTICLES = 1 << 18;
+
+  ParticleEmitterPool();
+  ~ParticleEmitterPool() = default;
+
+  // Every frame for every emitter node, before update(). transform is the node's global transform.
+  // False if the pool is out of slots or particles, the emitter is then tried again next frame.
+  bool set(const util::Uuid& node, const component::ParticleEmitter& emitter, const glm::mat4& transform);
+
+  // Removes emitters that weren't set since the last update, and works out how many particles each one spawns
+  void update(double delta);
+
+  // Once a frame's gpuEmitters() has been recorded. Clears reset flags and frees what was removed a while ago.
+  void uploaded();
+
+  // The GPU buffers were recreated, every emitter starts over with an empty range
+  void resetGpuState();
+
+  // One per slot, what the GPU emits and simulates from
+  const std::vector<gpu::GPUParticleEmitter>& gpuEmitters() const { return _gpuEmitters; }
+
+  std::size_t numEmitters() const { return _slotIndices.size(); }
+  std::uint32_t numReservedParticles() const { return _numReserved; }
+
+private:
+  struct Range
+  {
+    std::uint32_t _start = 0;
+    std::uint32_t _size = 0;
+  };
+
+  enum class SlotState
+  {
+    Free,
+    Active,
+    Removed // Waiting for the GPU to kill its particles
+  };
+
+  struct Slot
+  {
+    SlotState _state = SlotState::Free;
+    util::Uuid _node;
+    component::ParticleEmitter _emitter;
+    glm::vec3 _position = glm::vec3(0.0f);
+    Range _range;
+    double _spawnAccumulator = 0.0;
+    std::uint32_t _uploadsUntilFree = 0;
+    bool _set = false; // Since the last update
+    bool _reset = false;
+  };
+
+  bool allocateRange(std::uint32_t size, Range& rangeOut);
+  void freeRange(Range range);
+  void remove(std::uint32_t slotIdx);
+  void fillGpuEmitter(std::uint32_t slotIdx, double delta);
+
+  std::vector<Slot> _slots;
+  std::vector<std::uint32_t> _freeSlots;
+  std::unordered_map<util::Uuid, std::uint32_t> _slotIndices;
+
+  // Sorted on start, neighbours are merged
+  std::vector<Range> _freeRanges;
+  std::uint32_t _numReserved = 0;
+
+  // Only warn once per emitter that doesn't fit
+  std::unordered_set<util::Uuid> _warned;
+
+  std::vector<gpu::GPUParticleEmitter> _gpuEmitters;
+  std::uint32_t _frame = 0;
+};
+
+}
@@ -0,0 +1,128 @@
+#include "ParticleSimulation.h"
+
+#include <algorithm>
+
+namespace render {
+
+namespace {
+
+gpu::GPUParticle spawnParticle(const gpu::GPUParticleEmitter& emitter, std::uint32_t emitterIdx, std::uint32_t k)
+{
+  std::uint32_t rng = particleHash(emitter.seed ^ particleHash(k));
+
+  glm::vec3 t;
+  t.x = particleRandom(rng);
+  t.y = particleRandom(rng);
+  t.z = particleRandom(rng);
+
+  glm::vec3 offset;
+  offset.x = particleRandom(rng) * 2.0f - 1.0f;
+  offset.y = particleRandom(rng) * 2.0f - 1.0f;
+  offset.z = particleRandom(rng) * 2.0f - 1.0f;
+
+  float s = particleRandom(rng);
+
+  gpu::GPUParticle p{};
+  p.position = glm::vec4(glm::vec3(emitter.position) + offset * emitter.position.w, 0.0f);
+  p.velocity = glm::vec4(glm::mix(glm::vec3(emitter.minVelocity), glm::vec3(emitter.maxVelocity), t), emitter.minVelocity.w);
+  p.scale = glm::mix(emitter.scale.x, emitter.scale.y, s);
+  p.emitter = emitterIdx;
+  return p;
+}
+
+}
+
+ParticleSimulation::ParticleSimulation(std::uint32_t maxParticles, std::uint32_t maxEmitters)
+  : _maxParticles(maxParticles)
+  , _particles(maxParticles)
+  , _deadList(maxParticles)
+  , _aliveList(2 * (std::size_t)maxParticles)
+  , _deadCounts(maxEmitters)
+{}
+
+void ParticleSimulation::step(const std::vector<gpu::GPUParticleEmitter>& emitters, float delta)
+{
+  emit(emitters);
+
+  // particle_kickoff.comp
+  _aliveCounts[1 - _current] = 0;
+
+  simulate(emitters, delta);
+  _current = 1 - _current;
+}
+
+void ParticleSimulation::emit(const std::vector<gpu::GPUParticleEmitter>& emitters)
+{
+  // particle_emit.comp, one workgroup per emitter
+  for (std::uint32_t e = 0; e < (std::uint32_t)emitters.size(); ++e) {
+    auto& emitter = emitters[e];
+    if (emitter.rangeSize == 0) {
+      continue;
+    }
+
+    if ((emitter.flags & gpu::PARTICLE_EMITTER_RESET_FLAG) != 0) {
+      for (std::uint32_t i = 0; i < emitter.rangeSize; ++i) {
+        _deadList[emitter.rangeStart + i] = emitter.rangeStart + i;
+      }
+      _deadCounts[e] = emitter.rangeSize;
+    }
+
+    // Popped off the top of the dead list
+    std::uint32_t dead = _deadCounts[e];
+    std::uint32_t count = std::min(emitter.spawnCount, dead);
+    _deadCounts[e] = dead - count;
+
+    std::uint32_t aliveBase = _aliveCounts[_current];
+    _aliveCounts[_current] += count;
+
+    for (std::uint32_t k = 0; k < count; ++k) {
+      std::uint32_t idx = _deadList[emitter.rangeStart + dead - 1 - k];
+      _particles[idx] = spawnParticle(emitter, e, k);
+      _aliveList[_current * _maxParticles + aliveBase + k] = idx;
+    }
+  }
+}
+
+void ParticleSimulation::simulate(const std::vector<gpu::GPUParticleEmitter>& emitters, float delta)
+{
+  // particle_simulate.comp, one invocation per alive particle
+  const std::uint32_t next = 1 - _current;
+
+  for (std::uint32_t i = 0; i < _aliveCounts[_current]; ++i) {
+    std::uint32_t idx = _aliveList[_current * _maxParticles + i];
+    auto p = _particles[idx];
+    auto& emitter = emitters[p.emitter];
+
+    // The emitter is gone, its range is filled from scratch when it is reused
+    if (emitter.rangeSize == 0) {
+      continue;
+    }
+
+    p.position.w += delta;
+    if (p.position.w >= p.velocity.w) {
+      std::uint32_t slot = _deadCounts[p.emitter]++;
+      _deadList[emitter.rangeStart + slot] = idx;
+      continue;
+    }
+
+    glm::vec3 velocity = glm::vec3(p.velocity) + glm::vec3(emitter.gravity) * delta;
+    glm::vec3 position = glm::vec3(p.position) + velocity * delta;
+
+    const float restitution = emitter.maxVelocity.w;
+    const float groundHeight = emitter.gravity.w;
+    if (restitution >= 0.0f && position.y <= groundHeight && velocity.y < 0.0f) {
+      velocity.y = -velocity.y * restitution;
+      velocity.x *= restitution;
+      velocity.z *= restitution;
+      position.y = groundHeight;
+    }
+
+    p.position = glm::vec4(position, p.position.w);
+    p.velocity = glm::vec4(velocity, p.velocity.w);
+    _particles[idx] = p;
+
+    _aliveList[next * _maxParticles + _aliveCounts[next]++] = idx;
+  }
+}
+
+}
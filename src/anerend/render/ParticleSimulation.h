@@ -0,0 +1,60 @@
+#pragma once
+
+#include "GpuBuffers.h"
+#include "ParticleEmitterPool.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace render {
+
+// Same as pcgHash() and randomFloat() in particle_helpers.glsl
+inline std::uint32_t particleHash(std::uint32_t v)
+{
+  std::uint32_t state = v * 747796405u + 2891336453u;
+  std::uint32_t word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+  return (word >> 22u) ^ word;
+}
+
+// [0, 1), advances state
+inline float particleRandom(std::uint32_t& state)
+{
+  state = particleHash(state);
+  return float(state >> 8u) * (1.0f / 16777216.0f);
+}
+
+/*
+* CPU reference of the GPU particle update in particle_emit.comp, particle_kickoff.comp and particle_simulate.comp.
+* Works on buffers laid out like the GPU ones and does the same math, so any change to the shaders goes here too.
+* The GPU appends to the alive lists with atomics, so its lists have the same particles in another order.
+*/
+class ParticleSimulation
+{
+public:
+  ParticleSimulation(std::uint32_t maxParticles = ParticleEmitterPool::MAX_PARTICLES, std::uint32_t maxEmitters = ParticleEmitterPool::MAX_EMITTERS);
+  ~ParticleSimulation() = default;
+
+  // One frame: emit, then simulate the alive list into the other one, which is current afterwards
+  void step(const std::vector<gpu::GPUParticleEmitter>& emitters, float delta);
+
+  std::uint32_t numAlive() const { return _aliveCounts[_current]; }
+  // Indices into particles(), numAlive() of them
+  const std::uint32_t* aliveList() const { return _aliveList.data() + _current * _maxParticles; }
+  const std::vector<gpu::GPUParticle>& particles() const { return _particles; }
+  std::uint32_t numDead(std::uint32_t emitter) const { return _deadCounts[emitter]; }
+
+private:
+  void emit(const std::vector<gpu::GPUParticleEmitter>& emitters);
+  void simulate(const std::vector<gpu::GPUParticleEmitter>& emitters, float delta);
+
+  std::uint32_t _maxParticles;
+
+  std::vector<gpu::GPUParticle> _particles;
+  std::vector<std::uint32_t> _deadList; // Each emitter's dead particles at the start of its range
+  std::vector<std::uint32_t> _aliveList; // Two lists of _maxParticles
+  std::vector<std::uint32_t> _deadCounts;
+  std::uint32_t _aliveCounts[2] = { 0, 0 };
+  std::uint32_t _current = 0;
+};
+
+}
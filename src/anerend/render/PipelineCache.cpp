@@ -0,0 +1,132 @@
+#include "PipelineCache.h"
+
+#include "../../common/util/Utils.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace render {
+
+PipelineCache::PipelineCache()
+{}
+
+PipelineCache::~PipelineCache()
+{}
+
+bool PipelineCache::init(VkDevice device, VkPhysicalDevice physicalDevice, const std::string& path)
+{
+  _device = device;
+  _path = path;
+  vkGetPhysicalDeviceProperties(physicalDevice, &_props);
+
+  std::vector<char> data;
+  if (std::filesystem::exists(_path)) {
+    data = util::readFile(_path);
+
+    if (!validateHeader(data, _props)) {
+      printf("Pipeline cache on disk is invalid or from another device/driver, ignoring it\n");
+      data.clear();
+    }
+  }
+
+  VkPipelineCacheCreateInfo createInfo{};
+  createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+  createInfo.initialDataSize = data.size();
+  createInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+  if (vkCreatePipelineCache(_device, &createInfo, nullptr, &_cache) != VK_SUCCESS) {
+    printf("Could not create pipeline cache!\n");
+    _cache = VK_NULL_HANDLE;
+    return false;
+  }
+
+  return true;
+}
+
+void PipelineCache::save()
+{
+  if (_cache == VK_NULL_HANDLE) {
+    return;
+  }
+
+  std::size_t size = 0;
+  if (vkGetPipelineCacheData(_device, _cache, &size, nullptr) != VK_SUCCESS || size == 0) {
+    return;
+  }
+
+  std::vector<char> data(size);
+  if (vkGetPipelineCacheData(_device, _cache, &size, data.data()) != VK_SUCCESS) {
+    printf("Could not get pipeline cache data!\n");
+    return;
+  }
+
+  // Write to a temporary file first, so that a crash mid-write doesn't leave a broken cache
+  std::string tmpPath = _path + ".tmp";
+  {
+    std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+      printf("Could not open %s for writing pipeline cache!\n", tmpPath.c_str());
+      return;
+    }
+    file.write(data.data(), size);
+  }
+
+  std::error_code ec;
+  std::filesystem::rename(tmpPath, _path, ec);
+  if (ec) {
+    printf("Could not write pipeline cache: %s\n", ec.message().c_str());
+  }
+}
+
+void PipelineCache::cleanup()
+{
+  save();
+
+  if (_cache != VK_NULL_HANDLE) {
+    vkDestroyPipelineCache(_device, _cache, nullptr);
+    _cache = VK_NULL_HANDLE;
+  }
+
+  std::lock_guard<std::mutex> lock(_spirvMutex);
+  _spirv.clear();
+}
+
+const std::vector<char>& PipelineCache::getSpirv(const std::string& path)
+{
+  std::lock_guard<std::mutex> lock(_spirvMutex);
+
+  auto it = _spirv.find(path);
+  if (it != _spirv.end()) {
+    return it->second;
+  }
+
+  // References to unordered_map values stay valid on insert
+  return _spirv[path] = util::readFile(std::string(ASSET_PATH) + path);
+}
+
+bool PipelineCache::validateHeader(const std::vector<char>& data, const VkPhysicalDeviceProperties& props)
+{
+  VkPipelineCacheHeaderVersionOne header{};
+  if (data.size() < sizeof(header)) {
+    return false;
+  }
+
+  std::memcpy(&header, data.data(), sizeof(header));
+
+  if (header.headerSize < sizeof(header) || header.headerSize > data.size()) {
+    return false;
+  }
+
+  if (header.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE) {
+    return false;
+  }
+
+  if (header.vendorID != props.vendorID || header.deviceID != props.deviceID) {
+    return false;
+  }
+
+  return std::memcmp(header.pipelineCacheUUID, props.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+}
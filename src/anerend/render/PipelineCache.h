@@ -0,0 +1,54 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace render {
+
+/*
+  Owns the VkPipelineCache used for all pipeline creation, and persists it to disk between runs.
+  The data on disk is only used if the header matches the current device and driver.
+  Also keeps SPIR-V code in memory, so that each .spv file is only read from disk once.
+  All functions used during pipeline creation are thread-safe.
+*/
+class PipelineCache
+{
+public:
+  PipelineCache();
+  ~PipelineCache();
+
+  PipelineCache(const PipelineCache&) = delete;
+  PipelineCache(PipelineCache&&) = delete;
+  PipelineCache& operator=(const PipelineCache&) = delete;
+  PipelineCache& operator=(PipelineCache&&) = delete;
+
+  bool init(VkDevice device, VkPhysicalDevice physicalDevice, const std::string& path);
+
+  // Writes the current cache contents to disk
+  void save();
+
+  // Saves and destroys
+  void cleanup();
+
+  VkPipelineCache handle() const { return _cache; }
+
+  // Path is relative to ASSET_PATH, the same as in pipeline create params.
+  const std::vector<char>& getSpirv(const std::string& path);
+
+  static bool validateHeader(const std::vector<char>& data, const VkPhysicalDeviceProperties& props);
+
+private:
+  VkDevice _device = VK_NULL_HANDLE;
+  VkPhysicalDeviceProperties _props{};
+  VkPipelineCache _cache = VK_NULL_HANDLE;
+  std::string _path;
+
+  std::mutex _spirvMutex;
+  std::unordered_map<std::string, std::vector<char>> _spirv;
+};
+
+}
@@ -6,6 +6,7 @@
 #include "AllocatedBuffer.h"
 #include "BufferHelpers.h"
 #include "VulkanExtensions.h"
+#include "PipelineCache.h"
 
 #include <array>
 #include <cstddef>
@@ -35,6 +36,21 @@ std::optional<VkShaderModule> createShaderModule(const std::vector<char>& code,
   return shaderModule;
 }
 
+// Uses in-memory SPIR-V if there is a cache, otherwise reads from disk
+std::optional<VkShaderModule> createShaderModule(const std::string& path, VkDevice device, render::PipelineCache* cache)
+{
+  if (cache) {
+    return createShaderModule(cache->getSpirv(path), device);
+  }
+
+  return createShaderModule(util::readFile(std::string(ASSET_PATH) + path), device);
+}
+
+VkPipelineCache cacheHandle(render::PipelineCache* cache)
+{
+  return cache ? cache->handle() : VK_NULL_HANDLE;
+}
+
 }
 
 namespace render
@@ -299,8 +315,7 @@ bool buildGraphicsPipeline(GraphicsPipelineCreateParams param, VkPipelineLayout&
   VkShaderModule vertShaderModule;
   VkShaderModule fragShaderModule;
   if (!param.vertShader.empty()) {
-    auto vertShaderCode = util::readFile(std::string(ASSET_PATH) + param.vertShader);
-    auto opt = createShaderModule(vertShaderCode, param.device);
+    auto opt = createShaderModule(param.vertShader, param.device, param.cache);
     if (!opt) {
       printf("Could not create vertex shader!\n");
       return false;
@@ -309,8 +324,7 @@ bool buildGraphicsPipeline(GraphicsPipelineCreateParams param, VkPipelineLayout&
   }
 
   if (!param.fragShader.empty()) {
-    auto fragShaderCode = util::readFile(std::string(ASSET_PATH) + param.fragShader);
-    auto opt = createShaderModule(fragShaderCode, param.device);
+    auto opt = createShaderModule(param.fragShader, param.device, param.cache);
     if (!opt) {
       printf("Could not create frag shader!\n");
       return false;
@@ -552,7 +566,7 @@ bool buildGraphicsPipeline(GraphicsPipelineCreateParams param, VkPipelineLayout&
   pipelineInfo.subpass = 0;
   pipelineInfo.pDepthStencilState = &depthStencil;
 
-  if (vkCreateGraphicsPipelines(param.device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &outPipeline) != VK_SUCCESS) {
+  if (vkCreateGraphicsPipelines(param.device, cacheHandle(param.cache), 1, &pipelineInfo, nullptr, &outPipeline) != VK_SUCCESS) {
     printf("failed to create graphics pipeline!\n");
     return false;
   }
@@ -567,24 +581,21 @@ bool buildRayTracingPipeline(RayTracingPipelineCreateParams param, VkPipelineLay
   VkShaderModule chitModule{};
 
   // Shaders
-  auto raygenShaderCode = util::readFile(std::string(ASSET_PATH) + param.raygenShader);
-  auto optRay = createShaderModule(raygenShaderCode, param.device);
+  auto optRay = createShaderModule(param.raygenShader, param.device, param.cache);
   if (!optRay) {
     printf("Could not create raygen shader!\n");
     return false;
   }
   raygenModule = optRay.value();
 
-  auto missShaderCode = util::readFile(std::string(ASSET_PATH) + param.missShader);
-  auto optMiss = createShaderModule(missShaderCode, param.device);
+  auto optMiss = createShaderModule(param.missShader, param.device, param.cache);
   if (!optMiss) {
     printf("Could not create miss shader!\n");
     return false;
   }
   missModule = optMiss.value();
 
-  auto chitShaderCode = util::readFile(std::string(ASSET_PATH) + param.closestHitShader);
-  auto optChit = createShaderModule(chitShaderCode, param.device);
+  auto optChit = createShaderModule(param.closestHitShader, param.device, param.cache);
   if (!optChit) {
     printf("Could not create closest hit shader!\n");
     return false;
@@ -652,7 +663,7 @@ bool buildRayTracingPipeline(RayTracingPipelineCreateParams param, VkPipelineLay
   if (vkext::vkCreateRayTracingPipelinesKHR(
     param.device, // The VkDevice
     VK_NULL_HANDLE, // Don't request deferral
-    VK_NULL_HANDLE,
+    cacheHandle(param.cache),
     1, &rtpci, // Array of structures
     nullptr, // Default host allocator
     &outPipeline) != VK_SUCCESS) {
@@ -730,18 +741,12 @@ bool buildRayTracingPipeline(RayTracingPipelineCreateParams param, VkPipelineLay
 bool buildComputePipeline(ComputePipelineCreateParams params, VkPipelineLayout& pipelineLayout, VkPipeline& outPipeline)
 {
   // Shaders
-  VkShaderModule compShaderModule;
-  auto compShaderCode = util::readFile(std::string(ASSET_PATH) + params.shader);
-
-  VkShaderModuleCreateInfo createInfo{};
-  createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-  createInfo.codeSize = compShaderCode.size();
-  createInfo.pCode = reinterpret_cast<const uint32_t*>(compShaderCode.data());
-
-  if (vkCreateShaderModule(params.device, &createInfo, nullptr, &compShaderModule) != VK_SUCCESS) {
-    printf("Could not create shader module!\n");
+  auto opt = createShaderModule(params.shader, params.device, params.cache);
+  if (!opt) {
+    printf("Could not create compute shader!\n");
     return false;
   }
+  VkShaderModule compShaderModule = opt.value();
 
   DEFER([&]() {
     vkDestroyShaderModule(params.device, compShaderModule, nullptr);
@@ -759,7 +764,7 @@ bool buildComputePipeline(ComputePipelineCreateParams params, VkPipelineLayout&
   pipelineInfo.stage = compShaderStageInfo;
   pipelineInfo.layout = pipelineLayout;
 
-  if (vkCreateComputePipelines(params.device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &outPipeline) != VK_SUCCESS) {
+  if (vkCreateComputePipelines(params.device, cacheHandle(params.cache), 1, &pipelineInfo, nullptr, &outPipeline) != VK_SUCCESS) {
     printf("Could not create compute pipeline!\n");
     return false;
   }
@@ -10,6 +10,7 @@
 namespace render {
 
 class RenderContext;
+class PipelineCache;
 
 struct GraphicsPipelineCreateParams
 {
@@ -37,12 +38,14 @@ struct GraphicsPipelineCreateParams
   VkPolygonMode polygonMode = VK_POLYGON_MODE_FILL;
   uint32_t viewMask = 0;
   uint32_t vertexBinding = 0; // Giga vtx buffer
+  PipelineCache* cache = nullptr; // Optional, filled in by frame graph builder
 };
 
 struct ComputePipelineCreateParams
 {
   VkDevice device = nullptr;
   std::string shader;
+  PipelineCache* cache = nullptr; // Optional, filled in by frame graph builder
 };
 
 struct RayTracingPipelineCreateParams
@@ -53,6 +56,7 @@ struct RayTracingPipelineCreateParams
   std::string missShader;
   std::string closestHitShader;
   uint32_t maxRecursionDepth = 1;
+  PipelineCache* cache = nullptr; // Optional, filled in by frame graph builder
 };
 
 struct DescriptorBindInfo
@@ -20,7 +20,7 @@
 #include "RenderDebugOptions.h"
 #include "RenderOptions.h"
 #include "Camera.h"
-#include "Particle.h"
+#include "ParticleEmitterPool.h"
 #include "AccelerationStructure.h"
 #include "debug/Line.h"
 #include "debug/Triangle.h"
@@ -30,6 +30,8 @@
 
 namespace render {
 
+class PipelineCache;
+
 struct AssetUpdate
 {
   explicit operator bool() const {
@@ -150,6 +152,9 @@ public:
 
   virtual VkPhysicalDeviceRayTracingPipelinePropertiesKHR getRtPipeProps() = 0;
 
+  // Can be nullptr, in which case pipelines are created without a cache.
+  virtual PipelineCache* getPipelineCache() = 0;
+
   virtual void registerPerFrameTimer(const std::string& name, const std::string& group) = 0;
   virtual void startTimer(const std::string& name, VkCommandBuffer cmdBuffer) = 0;
   virtual void stopTimer(const std::string& name, VkCommandBuffer cmdBuffer) = 0;
@@ -177,8 +182,7 @@ public:
   virtual std::vector<debug::Geometry> takeCurrentDebugGeometryWireframe() = 0;
   virtual std::vector<debug::Geometry> takeCurrentDebugGeometry() = 0;
 
-  // Hack for testing
-  virtual std::vector<Particle>& getParticles() = 0;
+  virtual ParticleEmitterPool& getParticleEmitters() = 0;
 
   // TODO: A proper blackboard
   virtual bool blackboardValueBool(const std::string& key) = 0;
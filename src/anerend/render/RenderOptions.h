@@ -19,6 +19,10 @@ struct RenderOptions
   bool screenspaceProbes = false;
   bool probesDebug = false;
   bool hack = false;
+  bool transferQueueUploads = false;
+  float uploadBandwidthMBps = 256.0f;
+  bool textureStreaming = false;
+  float textureStreamingBudgetMB = 512.0f;
   float sunIntensity = 5.0;
   float skyIntensity = 1.0;
   float exposure = 1.0;
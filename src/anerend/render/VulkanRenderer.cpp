@@ -45,10 +45,13 @@
 #include "passes/GrassGenPass.h"
 #include "passes/DebugDrawRenderPass.h"
 #include "internal/MipMapGenerator.h"
+#include "internal/GigaBufferCompactor.h"
+#include "internal/SceneBookkeeping.h"
 #include "../component/Components.h"
 
 #include "../../common/util/Utils.h"
 #include  "../util/GraphicsUtils.h"
+#include "../util/Profiler.h"
 #include "../LodePng/lodepng.h"
 #include "../imgui/imgui.h"
 #include "../imgui/imgui_impl_glfw.h"
@@ -204,6 +207,8 @@ VulkanRenderer::~VulkanRenderer()
   // Let deletion queue flush
   _delQ.flush();
 
+  _transferUploader.cleanup();
+
   vmaDestroyBuffer(_vmaAllocator, _gigaVtxBuffer._buffer._buffer, _gigaVtxBuffer._buffer._allocation);
   vmaDestroyBuffer(_vmaAllocator, _gigaIdxBuffer._buffer._buffer, _gigaIdxBuffer._buffer._allocation);
   
@@ -281,6 +286,8 @@ VulkanRenderer::~VulkanRenderer()
 
   vkDestroyCommandPool(_device, _commandPool, nullptr);
 
+  _pipelineCache.cleanup();
+
   vmaDestroyAllocator(_vmaAllocator);
 
   vkDestroyDevice(_device, nullptr);
@@ -338,6 +345,12 @@ bool VulkanRenderer::init()
   if (!res) return false;
   printf("Done!\n");
 
+  printf("Creating pipeline cache...");
+  if (!_pipelineCache.init(_device, _physicalDevice, "pipeline_cache.bin")) {
+    printf("Continuing without pipeline cache...");
+  }
+  printf("Done!\n");
+
   printf("Creating VmaAllocator...");
   res &= createVmaAllocator();
   if (!res) return false;
@@ -401,8 +414,6 @@ bool VulkanRenderer::init()
   vkext::vulkanExtensionInit(_device);
   _renderOptions.raytracingEnabled = _enableRayTracing;
 
-  //createParticles();
-
   printf("Init frame graph builder...");
   res &= initFrameGraphBuilder();
   if (!res) return false;
@@ -451,6 +462,10 @@ bool VulkanRenderer::init()
   assetUpdate(std::move(upd));
 
   _delQ = internal::DeletionQueue(MAX_FRAMES_IN_FLIGHT, _vmaAllocator, _device);
+  _uploadQ.setFrameBudget(UPLOAD_BYTES_PER_FRAME);
+
+  // Not fatal, texture uploads will just stay on the graphics queue
+  _transferUploader.init(_device, _vmaAllocator, _transferQ, _queueIndices.transferFamily.value(), _queueIndices.graphicsFamily.value());
 
   // Buffer for world pos requests, where depth value will be copied into
   bufferutil::createBuffer(
@@ -534,9 +549,8 @@ void VulkanRenderer::assetUpdate(AssetUpdate&& update)
   std::size_t textureBytes = 0;
   std::size_t numMeshes = 0;
 
-  bool rendIdMapUpdate = !update._removedRenderables.empty();
-  bool modelIdMapUpdate = !update._removedModels.empty();
-  bool materialIdMapUpdate = !update._removedMaterials.empty();
+  auto assets = sceneAssets();
+
   bool textureIdMapUpdate = !update._removedTextures.empty() || !update._updatedTextures.empty();
   bool forceModelChange = false;
 
@@ -573,133 +587,59 @@ void VulkanRenderer::assetUpdate(AssetUpdate&& update)
   }
 
   // Removed models (forces id map to update, could be expensive)
-  for (auto& removedModel : update._removedModels) {
-    // Find internal model and use memory interface to "free" memory
-    auto it = _modelIdMap.find(removedModel);
-    if (it == _modelIdMap.end()) {
-      printf("Cannot remove model %s, it doesn't exist!\n", removedModel.str().c_str());
-      continue;
-    }
-
-    auto& internalModel = _currentModels[it->second];
-    for (auto& mesh : internalModel._meshes) {
-      for (auto meshIt = _currentMeshes.begin(); meshIt != _currentMeshes.end();) {
-        if (meshIt->_id == mesh) {
-          // Put blas on del q
-          if (_enableRayTracing) {
-            auto& blas = _blases[mesh];
-            _delQ.add(blas);
-
-            _blases.erase(mesh);
-          }
-
-          _gigaVtxBuffer._memInterface.removeData(meshIt->_vertexHandle);
-          _gigaIdxBuffer._memInterface.removeData(meshIt->_indexHandle);
-          meshIt = _currentMeshes.erase(meshIt);
-          break;
-        }
-        else {
-          ++meshIt;
-        }
-      }
-    }
+  internal::removeModels(assets, update._removedModels, [this](internal::InternalMesh& mesh) {
+    // Put blas on del q
+    if (_enableRayTracing) {
+      auto& blas = _blases[mesh._id];
+      _delQ.add(blas);
 
-    // Do a sanity check that no renderable uses this model
-#if 0
-    for (auto it = _currentRenderables.begin(); it != _currentRenderables.end(); ++it) {
-      if (it->_renderable._model == removedModel) {
-        //_currentRenderables.erase(it);
-        update._removedRenderables.emplace_back(it->_renderable._id);
-        rendIdMapUpdate = true;
-        printf("Warning! Removing renderable that still uses removed model!\n");
-      }
+      _blases.erase(mesh._id);
     }
-#endif
 
-    _currentModels.erase(_currentModels.begin() + it->second);
-  }
-
-  // Model/mesh id map update
-  if (modelIdMapUpdate) {
-    _modelIdMap.clear();
-    _meshIdMap.clear();
-
-    for (std::size_t i = 0; i < _currentModels.size(); ++i) {
-      _modelIdMap[_currentModels[i]._id] = i;
-    }
-    for (std::size_t i = 0; i < _currentMeshes.size(); ++i) {
-      _meshIdMap[_currentMeshes[i]._id] = i;
-    }
-
-    modelIdMapUpdate = false;
-  }
+    // Give back the memory once no frame in flight can be reading it
+    _delQ.add(&_gigaVtxBuffer._memInterface, mesh._vertexHandle);
+    _delQ.add(&_gigaIdxBuffer._memInterface, mesh._indexHandle);
+  });
 
   // Added models
   for (auto& model : update._addedModels) {
-    if (!model._id) {
-      printf("Asset update fail: cannot add model with invalid id\n");
+    // Internal meshes will be set once uploaded.
+    if (!internal::addModel(assets, model, MAX_NUM_MESHES)) {
       continue;
     }
 
-    if (_currentMeshes.size() == MAX_NUM_MESHES) {
-      printf("Cannot add model, max num meshes reached!\n");
-      continue;
-    }
-
-    // Note: Moving vertex and index data
-    internal::InternalModel internalModel{};
-    internalModel._id = model._id;
-
     for (const auto& mesh : model._meshes) {
       if (!mesh._id) {
-        printf("Asset update fail: cannot add mesh with invalid id\n");
         continue;
       }
 
       modelBytes += mesh._vertices.size() * sizeof(Vertex);
       modelBytes += mesh._indices.size() * sizeof(uint32_t);
       numMeshes++;
-
-      internalModel._meshes.push_back(mesh._id);
-
-      // internal mesh will be set once uploaded.
     }
 
-    _currentModels.push_back(std::move(internalModel));
-    auto internalId = _currentModels.size() - 1;
-    _modelIdMap[model._id] = internalId;
-
+    // Note: Moving vertex and index data
     _uploadQ.add(std::move(model));
   }
 
   // Removed textures
-  for (auto& tex : update._removedTextures) {
-    for (auto it = _currentTextures.begin(); it != _currentTextures.end();) {
-      if (it->_id == tex) {
-        // TODO: Add to deletion q
-        _bindlessTextureMemIf.removeData(it->_bindlessInfo._bindlessIndexHandle);
+  internal::removeTextures(assets, update._removedTextures, [this](internal::InternalTexture& tex) {
+    // TODO: Add to deletion q
+    _bindlessTextureMemIf.removeData(tex._bindlessInfo._bindlessIndexHandle);
 
-        vkDestroySampler(_device, it->_bindlessInfo._sampler, nullptr);
-        vmaDestroyImage(_vmaAllocator, it->_bindlessInfo._image._image, it->_bindlessInfo._image._allocation);
-        vkDestroyImageView(_device, it->_bindlessInfo._view, nullptr);
+    vkDestroySampler(_device, tex._bindlessInfo._sampler, nullptr);
+    vmaDestroyImage(_vmaAllocator, tex._bindlessInfo._image._image, tex._bindlessInfo._image._allocation);
+    vkDestroyImageView(_device, tex._bindlessInfo._view, nullptr);
 
-        it = _currentTextures.erase(it);
-        break;
-      }
-      else {
-        ++it;
-      }
+    auto imguiIt = _imguiTexIds.find(tex._id);
+    if (imguiIt != _imguiTexIds.end()) {
+      _delQ.add([desc = imguiIt->second]() { ImGui_ImplVulkan_RemoveTexture((VkDescriptorSet)desc); });
+      _imguiTexIds.erase(imguiIt);
     }
-  }
 
-  // Tex id map update
-  if (textureIdMapUpdate) {
-    _textureIdMap.clear();
-
-    for (std::size_t i = 0; i < _currentTextures.size(); ++i) {
-      _textureIdMap[_currentTextures[i]._id] = i;
-    }
-  }
+    // Mips still being streamed in for it are dropped when they arrive, see updateAssetFetches() and textureUploadedCB()
+    _textureResidency.removeTexture(tex._id);
+  });
 
   // Updated textures
   for (auto& tex : update._updatedTextures) {
@@ -731,112 +671,48 @@ void VulkanRenderer::assetUpdate(AssetUpdate&& update)
     for (auto& dat : tex._data) {
       textureBytes += dat.size();
     }
-    _uploadQ.add(std::move(tex));
-  }
 
-  // Removed materials
-  for (auto& mat : update._removedMaterials) {
-    for (auto it = _currentMaterials.begin(); it != _currentMaterials.end();) {
-      if (it->_id == mat) {
-        it = _currentMaterials.erase(it);
-        break;
-      } 
-      else {
-        ++it;
+    // Streamed textures come in with only their tail, keep track of them so that the rest can be streamed in.
+    if (tex._firstMip > 0 && !_textureResidency.contains(tex._id)) {
+      std::vector<std::size_t> mipBytes;
+      for (std::uint32_t i = 0; i < tex._firstMip + tex._numMips; ++i) {
+        if (i < tex._firstMip) {
+          // Not read, so estimate from the first mip that was
+          auto shift = tex._firstMip - i;
+          mipBytes.emplace_back(imageutil::texSize(tex._width << shift, tex._height << shift, tex._format));
+        }
+        else {
+          mipBytes.emplace_back(tex._data[i - tex._firstMip].size());
+        }
       }
-    }
-  }
-
-  // Mat id map update
-  if (materialIdMapUpdate) {
-    _materialIdMap.clear();
 
-    for (std::size_t i = 0; i < _currentMaterials.size(); ++i) {
-      _materialIdMap[_currentMaterials[i]._id] = i;
+      auto size = std::max(tex._width, tex._height) << tex._firstMip;
+      _textureResidency.addTexture(tex._id, size, std::move(mipBytes), tex._firstMip);
     }
 
-    materialIdMapUpdate = false;
+    // Textures too big for the transfer queue's staging buffers fall back to the graphics queue
+    bool transferQueued = _renderOptions.transferQueueUploads && _transferUploader && _transferUploader.add(std::move(tex));
+    if (!transferQueued) {
+      _uploadQ.add(std::move(tex));
+    }
   }
 
+  // Removed materials
+  internal::removeMaterials(assets, update._removedMaterials);
+
   // Added materials
   for (auto& mat : update._addedMaterials) {
-    if (!mat._id) {
-      printf("Material has invalid id, not adding!\n");
-      continue;
-    }
-
-    if (_currentMaterials.size() == MAX_NUM_MATERIALS) {
-      printf("Cannot add material, max size reached!\n");
+    if (!internal::addMaterial(assets, mat, MAX_NUM_MATERIALS)) {
       continue;
     }
 
-    internal::InternalMaterial internalMat{};
-    internalMat._emissive = mat._emissive;
-    internalMat._baseColFactor = mat._baseColFactor;
-    internalMat._id = mat._id;
-    internalMat._albedoTex = mat._albedoTex;
-    internalMat._metRoughTex = mat._metallicRoughnessTex;
-    internalMat._normalTex = mat._normalTex;
-    internalMat._emissiveTex = mat._emissiveTex;
-    internalMat._roughnessFactor = mat._roughnessFactor;
-    internalMat._metallicFactor = mat._metallicFactor;
-
     materialBytes += 4 * 4 + 3 * 4; // basecol and emissive
 
-    _currentMaterials.push_back(internalMat);
-    auto internalId = _currentMaterials.size() - 1;
-    _materialIdMap[mat._id] = internalId;
-
     _materialsToUpload.emplace_back(std::move(mat));
   }
 
   // Updated materials
-  for (auto& mat : update._updatedMaterials){
-    if (!mat._id) {
-      printf("Asset update fail: cannot update material with invalid id\n");
-      continue;
-    }
-
-    auto it = _materialIdMap.find(mat._id);
-
-    if (it == _materialIdMap.end()) {
-      printf("Could not update material %s, doesn't exist!\n", mat._id.str().c_str());
-      break;
-    }
-
-    _currentMaterials[it->second]._baseColFactor = mat._baseColFactor;
-    _currentMaterials[it->second]._emissive = mat._emissive;
-    _currentMaterials[it->second]._metallicFactor = mat._metallicFactor;
-    _currentMaterials[it->second]._roughnessFactor = mat._roughnessFactor;
-    _currentMaterials[it->second]._albedoTex = mat._albedoTex;
-    _currentMaterials[it->second]._emissiveTex = mat._emissiveTex;
-    _currentMaterials[it->second]._normalTex = mat._normalTex;
-    _currentMaterials[it->second]._metRoughTex = mat._metallicRoughnessTex;
-
-  }
-
-  // Mat id map update
-  if (materialIdMapUpdate) {
-    _materialIdMap.clear();
-
-    for (std::size_t i = 0; i < _currentMaterials.size(); ++i) {
-      _materialIdMap[_currentMaterials[i]._id] = i;
-    }
-  }
-
-  // Model/mesh id map update
-  if (modelIdMapUpdate) {
-    _modelIdMap.clear();
-    _meshIdMap.clear();
-
-    for (std::size_t i = 0; i < _currentModels.size(); ++i) {
-      _modelIdMap[_currentModels[i]._id] = i;
-    }
-    for (std::size_t i = 0; i < _currentMeshes.size(); ++i) {
-      _meshIdMap[_currentMeshes[i]._id] = i;
-    }
-  }
-
+  internal::updateMaterials(assets, update._updatedMaterials);
 
   // Book-keeping
   bool modelChange = forceModelChange || !update._addedModels.empty() || !update._removedModels.empty();
@@ -909,28 +785,7 @@ void VulkanRenderer::uploadPendingMaterials(VkCommandBuffer cmdBuffer)
   // Offset according to current staging buffer usage
   data = data + sb._currentOffset;
 
-  gpu::GPUMaterialInfo* mappedData = reinterpret_cast<gpu::GPUMaterialInfo*>(data);
-
-  for (std::size_t i = 0; i < _currentMaterials.size(); ++i) {
-    auto& mat = _currentMaterials[i];
-
-    if (!arePrerequisitesUploaded(mat)) {
-      continue;
-    }
-
-    mappedData[i]._baseColFac = glm::vec4(mat._baseColFactor.x, mat._baseColFactor.y, mat._baseColFactor.z, 0.0f);
-    mappedData[i]._emissive = mat._emissive;
-    mappedData[i]._metRough = glm::vec4(mat._metallicFactor, mat._roughnessFactor, 0.0f, 0.0f);
-    mappedData[i]._bindlessIndices = glm::ivec4(-1, -1, -1, -1);
-
-    if (mat._metRoughTex) mappedData[i]._bindlessIndices.x = (int32_t)_currentTextures[_textureIdMap[mat._metRoughTex]]._bindlessInfo._bindlessIndexHandle._offset;
-    if (mat._albedoTex) mappedData[i]._bindlessIndices.y = (int32_t)_currentTextures[_textureIdMap[mat._albedoTex]]._bindlessInfo._bindlessIndexHandle._offset;
-    if (mat._normalTex) mappedData[i]._bindlessIndices.z = (int32_t)_currentTextures[_textureIdMap[mat._normalTex]]._bindlessInfo._bindlessIndexHandle._offset;
-    if (mat._emissiveTex) mappedData[i]._bindlessIndices.w = (int32_t)_currentTextures[_textureIdMap[mat._emissiveTex]]._bindlessInfo._bindlessIndexHandle._offset;
-
-    //mappedData[i]._metallicFactor = mat._metallicFactor;
-    //mappedData[i]._roughnessFactor = mat._roughnessFactor;
-  }
+  internal::fillMaterialBuffer(sceneAssets(), reinterpret_cast<gpu::GPUMaterialInfo*>(data));
 
   VkBufferCopy copyRegion{};
   copyRegion.dstOffset = 0;
@@ -985,7 +840,7 @@ void VulkanRenderer::copyDynamicModels(VkCommandBuffer cmdBuffer)
     // Copy all meshes and BLASes
     auto& model = _currentModels[_modelIdMap[internalRend._renderable._model]];
 
-    if (!arePrerequisitesUploaded(model)) {
+    if (!internal::arePrerequisitesUploaded(sceneAssets(), model)) {
       ++it;
       continue;
     }
@@ -1142,6 +997,115 @@ void VulkanRenderer::copyDynamicModels(VkCommandBuffer cmdBuffer)
     0, nullptr);
 }
 
+bool VulkanRenderer::compactGigaBuffers(VkCommandBuffer cmdBuffer)
+{
+  const double fragmentationThreshold = 0.25;
+
+  bool compactVtx = _gigaVtxBuffer._memInterface.fragmentation() > fragmentationThreshold;
+  bool compactIdx = _gigaIdxBuffer._memInterface.fragmentation() > fragmentationThreshold;
+
+  if (!compactVtx && !compactIdx) {
+    return false;
+  }
+
+  std::vector<internal::GigaBufferCompactor::Allocation> vtxAllocs;
+  std::vector<internal::GigaBufferCompactor::Allocation> idxAllocs;
+  for (std::size_t i = 0; i < _currentMeshes.size(); ++i) {
+    auto& mesh = _currentMeshes[i];
+    if (compactVtx && mesh._vertexHandle) {
+      vtxAllocs.push_back({ i, mesh._vertexHandle });
+    }
+    if (compactIdx && mesh._indexHandle) {
+      idxAllocs.push_back({ i, mesh._indexHandle });
+    }
+  }
+
+  auto vtxMoves = internal::GigaBufferCompactor::planMoves(_gigaVtxBuffer._memInterface, std::move(vtxAllocs), GIGA_COMPACTION_BYTES_PER_FRAME);
+  auto idxMoves = internal::GigaBufferCompactor::planMoves(_gigaIdxBuffer._memInterface, std::move(idxAllocs), GIGA_COMPACTION_BYTES_PER_FRAME);
+
+  if (vtxMoves.empty() && idxMoves.empty()) {
+    return false;
+  }
+
+  // Make sure previous writes (uploads, copies, skinning) are done before we read
+  {
+    VkMemoryBarrier memBarr{};
+    memBarr.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    memBarr.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    memBarr.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+
+    vkCmdPipelineBarrier(
+      cmdBuffer,
+      VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+      VK_PIPELINE_STAGE_TRANSFER_BIT,
+      0, 1, &memBarr,
+      0, nullptr,
+      0, nullptr);
+  }
+
+  std::vector<VkBufferMemoryBarrier> barrs;
+  auto recordMoves = [&](internal::GigaBuffer& gigaBuffer, const std::vector<internal::GigaBufferCompactor::Move>& moves) {
+    if (moves.empty()) return;
+
+    std::vector<VkBufferCopy> regions;
+    regions.reserve(moves.size());
+    for (auto& move : moves) {
+      VkBufferCopy copyRegion{};
+      copyRegion.srcOffset = move._src._offset;
+      copyRegion.dstOffset = move._dst._offset;
+      copyRegion.size = move._src._size;
+      regions.emplace_back(std::move(copyRegion));
+
+      VkBufferMemoryBarrier memBarr{};
+      memBarr.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+      memBarr.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+      memBarr.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+      memBarr.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+      memBarr.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+      memBarr.buffer = gigaBuffer._buffer._buffer;
+      memBarr.offset = move._dst._offset;
+      memBarr.size = move._dst._size;
+      barrs.emplace_back(std::move(memBarr));
+
+      // Frames in flight may still read the old location
+      _delQ.add(&gigaBuffer._memInterface, move._src);
+    }
+
+    vkCmdCopyBuffer(cmdBuffer, gigaBuffer._buffer._buffer, gigaBuffer._buffer._buffer, (uint32_t)regions.size(), regions.data());
+  };
+
+  recordMoves(_gigaVtxBuffer, vtxMoves);
+  recordMoves(_gigaIdxBuffer, idxMoves);
+
+  VkPipelineStageFlags dstStages = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+  if (_enableRayTracing) {
+    dstStages |= VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR;
+  }
+
+  vkCmdPipelineBarrier(
+    cmdBuffer,
+    VK_PIPELINE_STAGE_TRANSFER_BIT,
+    dstStages,
+    0, 0, nullptr,
+    (uint32_t)barrs.size(), barrs.data(),
+    0, nullptr);
+
+  // Patch the meshes. Static BLASes own their geometry so they stay valid,
+  // dynamic BLASes are refit from the new vertex offset next time they update.
+  for (auto& move : vtxMoves) {
+    auto& mesh = _currentMeshes[move._userIndex];
+    mesh._vertexHandle = move._dst;
+    mesh._vertexOffset = static_cast<uint32_t>(move._dst._offset / sizeof(Vertex));
+  }
+  for (auto& move : idxMoves) {
+    auto& mesh = _currentMeshes[move._userIndex];
+    mesh._indexHandle = move._dst;
+    mesh._indexOffset = static_cast<int64_t>(move._dst._offset / sizeof(uint32_t));
+  }
+
+  return true;
+}
+
 void VulkanRenderer::update(
   Camera& camera,
   const Camera& shadowCamera,
@@ -1153,6 +1117,8 @@ void VulkanRenderer::update(
   RenderDebugOptions debugOptions)
   //logic::WindMap windMap)
 {
+  ANEREND_PROFILE_SCOPE("VulkanRenderer::update");
+
   // TODO: Fix
   vkWaitForFences(_device, 1, &_inFlightFences[_currentFrame], VK_TRUE, UINT64_MAX);
 
@@ -1259,9 +1225,16 @@ void VulkanRenderer::update(
     _bakeInfo._bakingIndex = scene::TileIndex();
   }
 
+  _assetFetcher.setTextureStreaming(_renderOptions.textureStreaming ? TEXTURE_STREAMING_TAIL_SIZE : 0);
+
   updateNodes();
-  updateSkeletons();
+  internal::updateSkeletons(*_registry, sceneNodes(), *_cachedSkeletons);
+  updateParticleEmitters(delta);
   updateAssetFetches();
+
+  if (_renderOptions.textureStreaming) {
+    updateTextureResidency(camera);
+  }
 }
 
 AccelerationStructure VulkanRenderer::registerBottomLevelAS(
@@ -1873,6 +1846,7 @@ bool VulkanRenderer::createLogicalDevice()
   vulkan12Features.hostQueryReset = VK_TRUE;
   vulkan12Features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
   vulkan12Features.drawIndirectCount = VK_TRUE;
+  vulkan12Features.timelineSemaphore = VK_TRUE;
 
   atomicFloatFeature.pNext = &vulkan12Features;
 
@@ -2089,401 +2063,204 @@ VkPhysicalDeviceRayTracingPipelinePropertiesKHR VulkanRenderer::getRtPipeProps()
 
 void VulkanRenderer::updateNodes()
 {
-  bool modelIdMapUpdate = false;
   bool modelChange = false;
-  bool rendIdMapUpdate = false;
-  bool terrainIdMapUpdate = false;
-  bool renderablesChanged = false;
-  bool lightsChanged = false;
   bool terrainChanged = false;
 
-  for (const auto entity : _nodeObserver) {
-    auto internalId = _registry->reverseLookup(entity);
-    bool paged = _registry->getComponent<component::PageStatus>(internalId)._paged;
-
-    // If there is no transform, something weird is going on and we don't particularly care
-    if (!_registry->hasComponent<component::Transform>(internalId)) {
-      return;
-    }
+  internal::NodeHooks hooks{};
 
-    auto& transComp = _registry->getComponent<component::Transform>(internalId);
+  hooks._added = [this, &terrainChanged](internal::InternalRenderable& internalRend) {
+    auto& internalId = internalRend._id;
+    auto& rend = internalRend._renderable;
 
-    // renderables
-    if (_registry->hasComponent<component::Renderable>(internalId)) {
-      auto& rend = _registry->getComponent<component::Renderable>(internalId);
-      renderablesChanged = true;
-      // Added renderables
-      if (paged) {
-        // Check that we're not currently adding this renderable
-        auto it = std::find_if(_pendingFirstUploadRenderables.begin(), _pendingFirstUploadRenderables.end(),
-          [internalId](internal::InternalRenderable& a) {return a._id == internalId; });
+    // If ray tracing is enabled, we need to write individual BLAS:es for each renderable that is animated.
+    // Checked before anything is fetched, so that a dropped renderable holds no refs.
+    bool dynamicBlas = _enableRayTracing && _registry->hasComponent<component::Skeleton>(internalId);
+    if (dynamicBlas && _currentMeshes.size() == MAX_NUM_MESHES) {
+      printf("Cannot add dynamic BLAS for renderable, max num meshes reached!\n");
+      return false;
+    }
 
-        if (it != _pendingFirstUploadRenderables.end()) {
-          continue;
-        }
+    // Do we need to fetch any assets?
+    if (!_modelIdMap.contains(rend._model)) {
+      _assetFetcher.startFetchModel(rend._model);
+    }
+    _assetFetcher.ref(rend._model);
 
-        if (_renderableIdMap.find(internalId) == _renderableIdMap.end()) {
-          if (!internalId) {
-            printf("Asset update fail: cannot add renderable with invalid id\n");
-            continue;
-          }
+    for (auto& mat : rend._materials) {
+      if (!_materialIdMap.contains(mat)) {
+        // Will also start fetching textures.
+        _assetFetcher.startFetchMaterial(mat);
+      }
+      // Always ref
+      _assetFetcher.ref(mat);
+    }
 
-          if (!rend._model) {
-            printf("Asset update fail: cannot add renderable with invalid model id\n");
-            continue;
-          }
+    if (dynamicBlas) {
+      // TODO: Don't do this if we already have this skeleton + model combination copied
+      //       In that case, just point to the dynamic model already present
+      DynamicModelCopyInfo copyInfo{};
+      copyInfo._renderableId = internalRend._id;
+      _dynamicModelsToCopy.emplace_back(std::move(copyInfo));
 
-          if (_currentRenderables.size() == MAX_NUM_RENDERABLES) {
-            printf("Cannot add renderable, max size reached!\n");
-            continue;
-          }
+      for (std::size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+        _modelsChanged[i] = true;
+      }
+    }
 
-          internal::InternalRenderable internalRend{};
-          internalRend._id = internalId;
-          internalRend._renderable = rend;
-          internalRend._globalTransform = transComp._globalTransform;
-          internalRend._invGlobalTransform = glm::inverse(transComp._globalTransform);
+    // Terrain
+    if (_registry->hasComponent<component::Terrain>(internalId)) {
+
+      auto& terrainComp = _registry->getComponent<component::Terrain>(internalId);
+      internal::InternalTerrain internalTerrain{};
+
+      internalTerrain._id = internalId;
+      internalTerrain._baseMaterials = terrainComp._baseMaterials;
+      internalTerrain._blendMask = terrainComp._blendMap;
+      internalTerrain._heightmap = terrainComp._heightMap;
+      internalTerrain._vegMap = terrainComp._vegetationMap;
+      internalTerrain._tileIdx = terrainComp._tileIndex;
+      internalTerrain._mpp = terrainComp._mpp;
+      internalTerrain._heightScale = terrainComp._heightScale;
+      internalTerrain._uvScale = terrainComp._uvScale;
+
+      // Any assets to fetch?
+      if (terrainComp._baseMaterials[0]) {
+        if (!_materialIdMap.contains(terrainComp._baseMaterials[0])) {
+          _assetFetcher.startFetchMaterial(terrainComp._baseMaterials[0]);
+        }
+        _assetFetcher.ref(terrainComp._baseMaterials[0]);
+      }
+      if (terrainComp._baseMaterials[1]) {
+        if (!_materialIdMap.contains(terrainComp._baseMaterials[1])) {
+          _assetFetcher.startFetchMaterial(terrainComp._baseMaterials[1]);
+        }
+        _assetFetcher.ref(terrainComp._baseMaterials[1]);
+      }
+      if (terrainComp._baseMaterials[2]) {
+        if (!_materialIdMap.contains(terrainComp._baseMaterials[2])) {
+          _assetFetcher.startFetchMaterial(terrainComp._baseMaterials[2]);
+        }
+        _assetFetcher.ref(terrainComp._baseMaterials[2]);
+      }
+      if (terrainComp._baseMaterials[3]) {
+        if (!_materialIdMap.contains(terrainComp._baseMaterials[3])) {
+          _assetFetcher.startFetchMaterial(terrainComp._baseMaterials[3]);
+        }
+        _assetFetcher.ref(terrainComp._baseMaterials[3]);
+      }
 
-          // Do we need to fetch any assets?
-          if (!_modelIdMap.contains(rend._model)) {
-            _assetFetcher.startFetchModel(rend._model);
-          }
-          _assetFetcher.ref(rend._model);
+      if (!_textureIdMap.contains(terrainComp._heightMap)) {
+        _assetFetcher.startFetchTexture(terrainComp._heightMap, false);
+      }
+      if (!_textureIdMap.contains(terrainComp._blendMap)) {
+        _assetFetcher.startFetchTexture(terrainComp._blendMap, false);
+      }
+      if (!_textureIdMap.contains(terrainComp._vegetationMap)) {
+        _assetFetcher.startFetchTexture(terrainComp._vegetationMap, false);
+      }
 
-          for (auto& mat : rend._materials) {
-            if (!_materialIdMap.contains(mat)) {
-              // Will also start fetching textures.
-              _assetFetcher.startFetchMaterial(mat);
-            }
-            // Always ref
-            _assetFetcher.ref(mat);
-          }
+      _assetFetcher.ref(terrainComp._heightMap);
+      _assetFetcher.ref(terrainComp._blendMap);
+      _assetFetcher.ref(terrainComp._vegetationMap);
 
-          // Skeleton
-          if (_registry->hasComponent<component::Skeleton>(internalId)) {
-            auto& skeleComp = _registry->getComponent<component::Skeleton>(internalId);
-            internalRend._skeletonOffset = getOrCreateSkeleOffset(internalId, skeleComp._jointRefs.size());
+      _currentTerrains.emplace_back(std::move(internalTerrain));
+      auto idx = _currentTerrains.size() - 1;
+      _terrainIdMap[internalId] = idx;
 
-            // If ray tracing is enabled, we need to write individual BLAS:es for each renderable that is animated.
-            if (_enableRayTracing) {
-              if (_currentMeshes.size() == MAX_NUM_MESHES) {
-                printf("Cannot add dynamic BLAS for renderable, max num meshes reached!\n");
-                continue;
-              }
+      internalRend._isTerrain = true;
 
-              // TODO: Don't do this if we already have this skeleton + model combination copied
-              //       In that case, just point to the dynamic model already present
-              DynamicModelCopyInfo copyInfo{};
-              copyInfo._renderableId = internalRend._id;
-              _dynamicModelsToCopy.emplace_back(std::move(copyInfo));
+      terrainChanged = true;
+    }
 
-              for (std::size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
-                _modelsChanged[i] = true;
-              }
-            }
-          }
+    return true;
+  };
 
-          // Terrain
-          if (_registry->hasComponent<component::Terrain>(internalId)) {
-
-            auto& terrainComp = _registry->getComponent<component::Terrain>(internalId);
-            internal::InternalTerrain internalTerrain{};
-
-            internalTerrain._id = internalId;
-            internalTerrain._baseMaterials = terrainComp._baseMaterials;
-            internalTerrain._blendMask = terrainComp._blendMap;
-            internalTerrain._heightmap = terrainComp._heightMap;
-            internalTerrain._vegMap = terrainComp._vegetationMap;
-            internalTerrain._tileIdx = terrainComp._tileIndex;
-            internalTerrain._mpp = terrainComp._mpp;
-            internalTerrain._heightScale = terrainComp._heightScale;
-            internalTerrain._uvScale = terrainComp._uvScale;
-
-            // Any assets to fetch?
-            if (terrainComp._baseMaterials[0]) {
-              if (!_materialIdMap.contains(terrainComp._baseMaterials[0])) {
-                _assetFetcher.startFetchMaterial(terrainComp._baseMaterials[0]);
-              }
-              _assetFetcher.ref(terrainComp._baseMaterials[0]);
-            }
-            if (terrainComp._baseMaterials[1]) {
-              if (!_materialIdMap.contains(terrainComp._baseMaterials[1])) {
-                _assetFetcher.startFetchMaterial(terrainComp._baseMaterials[1]);
-              }
-              _assetFetcher.ref(terrainComp._baseMaterials[1]);
-            }
-            if (terrainComp._baseMaterials[2]) {
-              if (!_materialIdMap.contains(terrainComp._baseMaterials[2])) {
-                _assetFetcher.startFetchMaterial(terrainComp._baseMaterials[2]);
-              }
-              _assetFetcher.ref(terrainComp._baseMaterials[2]);
-            }
-            if (terrainComp._baseMaterials[3]) {
-              if (!_materialIdMap.contains(terrainComp._baseMaterials[3])) {
-                _assetFetcher.startFetchMaterial(terrainComp._baseMaterials[3]);
-              }
-              _assetFetcher.ref(terrainComp._baseMaterials[3]);
-            }
+  hooks._removed = [this, &modelChange, &terrainChanged](internal::InternalRenderable& rend) {
+    auto remId = rend._id;
 
-            if (!_textureIdMap.contains(terrainComp._heightMap)) {
-              _assetFetcher.startFetchTexture(terrainComp._heightMap, false);
-            }
-            if (!_textureIdMap.contains(terrainComp._blendMap)) {
-              _assetFetcher.startFetchTexture(terrainComp._blendMap, false);
+    if (_enableRayTracing && !rend._dynamicMeshes.empty()) {
+      modelChange = true;
+
+      if (_dynamicBlases.count(remId) > 0) {
+        auto& dynamicBlas = _dynamicBlases[remId];
+
+        auto& meshes = _currentModels[_modelIdMap[rend._renderable._model]]._meshes;
+        for (std::size_t i = 0; i < meshes.size(); ++i) {
+          auto& mesh = rend._dynamicMeshes[i];
+
+          for (auto meshIt = _currentMeshes.begin(); meshIt != _currentMeshes.end();) {
+            if (meshIt->_id == mesh) {
+              // Put blas on deletion q
+              auto& blas = dynamicBlas[i];
+              _delQ.add(blas); // copy
+
+              // Remove meshes so that nothing uses the blas anymore
+              _delQ.add(&_gigaVtxBuffer._memInterface, meshIt->_vertexHandle);
+              _delQ.add(&_gigaIdxBuffer._memInterface, meshIt->_indexHandle);
+              meshIt = _currentMeshes.erase(meshIt);
+              break;
             }
-            if (!_textureIdMap.contains(terrainComp._vegetationMap)) {
-              _assetFetcher.startFetchTexture(terrainComp._vegetationMap, false);
+            else {
+              ++meshIt;
             }
-
-            _assetFetcher.ref(terrainComp._heightMap);
-            _assetFetcher.ref(terrainComp._blendMap);
-            _assetFetcher.ref(terrainComp._vegetationMap);
-
-            _currentTerrains.emplace_back(std::move(internalTerrain));
-            auto idx = _currentTerrains.size() - 1;
-            _terrainIdMap[internalId] = idx;
-
-            internalRend._isTerrain = true;
-
-            terrainChanged = true;
           }
-
-          _pendingFirstUploadRenderables.emplace_back(std::move(internalRend));
         }
-        else {
-          // Updated renderable
-          if (!internalId) {
-            printf("Asset update fail: cannot update renderable with invalid id\n");
-            continue;
-          }
-
-          if (!rend._model) {
-            printf("Asset update fail: cannot update renderable with invalid model id\n");
-            continue;
-          }
-
-          auto it = _renderableIdMap.find(internalId);
-
-          if (it == _renderableIdMap.end()) {
-            printf("Could not update renderable %s, doesn't exist!\n", internalId.str().c_str());
-            break;
-          }
-
-          // Terrain update is handled by its own observer
 
-          _currentRenderables[it->second]._renderable = rend;
-          _currentRenderables[it->second]._globalTransform = transComp._globalTransform;
-          _currentRenderables[it->second]._invGlobalTransform = glm::inverse(transComp._globalTransform);
-        }
+        _dynamicBlases.erase(remId);
+        printf("erased id %s from dynamic blases\n", remId.str().c_str());
       }
-      else {
-        // not paged, removed
-        rendIdMapUpdate = true;
-        auto remId = internalId;
-        for (auto it = _currentRenderables.begin(); it != _currentRenderables.end(); ++it) {
-          if (it->_id == remId) {
-            if (_enableRayTracing && !it->_dynamicMeshes.empty()) {
-
-              modelIdMapUpdate = true;
-              modelChange = true;
-
-              if (_dynamicBlases.count(remId) > 0) {
-                auto& dynamicBlas = _dynamicBlases[remId];
-
-                auto& meshes = _currentModels[_modelIdMap[it->_renderable._model]]._meshes;
-                for (std::size_t i = 0; i < meshes.size(); ++i) {
-                  auto& mesh = it->_dynamicMeshes[i];
-
-                  for (auto meshIt = _currentMeshes.begin(); meshIt != _currentMeshes.end();) {
-                    if (meshIt->_id == mesh) {
-                      // Put blas on deletion q
-                      auto& blas = dynamicBlas[i];
-                      _delQ.add(blas); // copy
-
-                      // Remove meshes so that nothing uses the blas anymore
-                      _gigaVtxBuffer._memInterface.removeData(meshIt->_vertexHandle);
-                      _gigaIdxBuffer._memInterface.removeData(meshIt->_indexHandle);
-                      meshIt = _currentMeshes.erase(meshIt);
-                      break;
-                    }
-                    else {
-                      ++meshIt;
-                    }
-                  }
-                }
-
-                _dynamicBlases.erase(remId);
-                printf("erased id %s from dynamic blases\n", remId.str().c_str());
-              }
-            }
-            else if (_enableRayTracing) {
-              // If we're still in the process of adding this dynamic rend, remove it from the processing list
-              for (auto it = _dynamicModelsToCopy.begin(); it != _dynamicModelsToCopy.end(); ++it) {
-                if (it->_renderableId == remId) {
-
-                  // Add any potentially added blases to delQ
-                  for (auto& blas : it->_currentBlases) {
-                    _delQ.add(blas);
-                  }
-
-                  // Also give back potential meshes that have already been added
-                  for (std::size_t i = 0; i < it->_currentBlases.size(); ++i) {
-                    auto& meshId = it->_generatedDynamicIds[i];
-                    for (auto meshIt = _currentMeshes.begin(); meshIt != _currentMeshes.end();) {
-                      if (meshIt->_id == meshId) {
-
-                        // Remove meshes so that nothing uses the blas anymore
-                        _gigaVtxBuffer._memInterface.removeData(meshIt->_vertexHandle);
-                        _gigaIdxBuffer._memInterface.removeData(meshIt->_indexHandle);
-                        meshIt = _currentMeshes.erase(meshIt);
-                        break;
-                      }
-                      else {
-                        ++meshIt;
-                      }
-                    }
-                  }
-
-                  _dynamicModelsToCopy.erase(it);
-                  break;
-                }
-              }
-            }
-            
-            // Remove terrain if present
-            auto terrainIt = _terrainIdMap.find(remId);
-            if (terrainIt != _terrainIdMap.end()) {
-              _currentTerrains.erase(_currentTerrains.begin() + terrainIt->second);
-
-              terrainIdMapUpdate = true;
-              terrainChanged = true;
-            }
 
-            // Remove assets if not used by anyone else.
-            derefAssets(*it);
-
-            _currentRenderables.erase(it);
-            break;
-          }
-        }
-      } 
+      internal::rebuildIdMap(_currentModels, _modelIdMap);
+      internal::rebuildIdMap(_currentMeshes, _meshIdMap);
     }
-    
-    // lights
-    if (_registry->hasComponent<component::Light>(internalId)) {
-      auto& l = _registry->getComponent<component::Light>(internalId);
-      glm::vec3 lightPos = transComp._globalTransform[3];
-      lightsChanged = true;
-
-      // Removed lights
-      if (!paged) {
-        for (auto it = _lights.begin(); it != _lights.end(); ++it) {
-          if (it->_id == internalId) {
-
-            if (it->_lightComp._shadowCaster) {
-              // Remove from caster list (if there)
-
-              for (auto& id : _shadowCasters) {
-                if (id == internalId) {
-                  id = util::Uuid();
-                  break;
-                }
-              }
-            }
+    else if (_enableRayTracing) {
+      // If we're still in the process of adding this dynamic rend, remove it from the processing list
+      for (auto it = _dynamicModelsToCopy.begin(); it != _dynamicModelsToCopy.end(); ++it) {
+        if (it->_renderableId == remId) {
 
-            _lights.erase(it);
-            break;
-          }
-        }
-      }
-      else {
-        bool found = false;
-        // Updated light
-        for (auto& oldLight : _lights) {
-          if (oldLight._id == internalId) {
-            found = true;
-
-            // Did shadow caster status change?
-            if (oldLight._lightComp._shadowCaster && !l._shadowCaster) {
-              // it was shadow caster but not anymore, remove from list
-              for (auto& id : _shadowCasters) {
-                if (id == oldLight._id) {
-                  id = util::Uuid();
-                  break;
-                }
-              }
-            }
-            else if (!oldLight._lightComp._shadowCaster && l._shadowCaster) {
-              // wasn't shadow caster but now is, add to list if possible
-              for (auto& id : _shadowCasters) {
-                if (!id) {
-                  id = internalId;
-                  break;
-                }
-              }
-            }
-
-            l.updateViewMatrices(lightPos);
-            oldLight._pos = lightPos;
-            oldLight._lightComp = l;
-            break;
+          // Add any potentially added blases to delQ
+          for (auto& blas : it->_currentBlases) {
+            _delQ.add(blas);
           }
-        }
 
-        // Added lights
-        if (!found) {
+          // Also give back potential meshes that have already been added
+          for (std::size_t i = 0; i < it->_currentBlases.size(); ++i) {
+            auto& meshId = it->_generatedDynamicIds[i];
+            for (auto meshIt = _currentMeshes.begin(); meshIt != _currentMeshes.end();) {
+              if (meshIt->_id == meshId) {
 
-          // add to shadow caster index list (if possible)
-          if (l._shadowCaster) {
-            for (auto& id : _shadowCasters) {
-              if (!id) {
-                id = internalId;
+                // Remove meshes so that nothing uses the blas anymore
+                _delQ.add(&_gigaVtxBuffer._memInterface, meshIt->_vertexHandle);
+                _delQ.add(&_gigaIdxBuffer._memInterface, meshIt->_indexHandle);
+                meshIt = _currentMeshes.erase(meshIt);
                 break;
               }
+              else {
+                ++meshIt;
+              }
             }
           }
 
-          l.updateViewMatrices(lightPos);
-          internal::InternalLight internalLight{};
-          internalLight._id = internalId;
-          internalLight._lightComp = l;
-          internalLight._pos = std::move(lightPos);
-          _lights.emplace_back(std::move(internalLight));
+          _dynamicModelsToCopy.erase(it);
+          break;
         }
       }
     }
 
-    // Model/mesh id map update
-    if (modelIdMapUpdate) {
-      _modelIdMap.clear();
-      _meshIdMap.clear();
+    // Remove terrain if present
+    auto terrainIt = _terrainIdMap.find(remId);
+    if (terrainIt != _terrainIdMap.end()) {
+      _currentTerrains.erase(_currentTerrains.begin() + terrainIt->second);
+      internal::rebuildIdMap(_currentTerrains, _terrainIdMap);
 
-      for (std::size_t i = 0; i < _currentModels.size(); ++i) {
-        _modelIdMap[_currentModels[i]._id] = i;
-      }
-      for (std::size_t i = 0; i < _currentMeshes.size(); ++i) {
-        _meshIdMap[_currentMeshes[i]._id] = i;
-      }
+      terrainChanged = true;
     }
 
-    // Rend id map update
-    if (rendIdMapUpdate) {
-      _renderableIdMap.clear();
-
-      for (std::size_t i = 0; i < _currentRenderables.size(); ++i) {
-        _renderableIdMap[_currentRenderables[i]._id] = i;
-      }
-    }
+    // Remove assets if not used by anyone else.
+    derefAssets(rend);
+  };
 
-    // Terrain id map
-    if (terrainIdMapUpdate) {
-      _terrainIdMap.clear();
-
-      for (std::size_t i = 0; i < _currentTerrains.size(); ++i) {
-        _terrainIdMap[_currentTerrains[i]._id] = i;
-      }
-    }
-  }
+  auto changes = internal::updateObservedNodes(*_registry, _nodeObserver, sceneNodes(), hooks);
 
   for (const auto entity : _terrainObserver) {
     auto internalId = _registry->reverseLookup(entity);
@@ -2507,7 +2284,7 @@ void VulkanRenderer::updateNodes()
   }
 
   // Did we update any renderables
-  if (renderablesChanged) {
+  if (changes._renderables) {
     for (std::size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
       _renderablesChanged[i] = true;
     }
@@ -2519,7 +2296,7 @@ void VulkanRenderer::updateNodes()
     }
   }
 
-  if (lightsChanged) {
+  if (changes._lights) {
     for (std::size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
       _lightsChanged[i] = true;
     }
@@ -2532,32 +2309,26 @@ void VulkanRenderer::updateNodes()
     }
   }
 
-  _nodeObserver.clear();
   _terrainObserver.clear();
 }
 
-void VulkanRenderer::updateSkeletons()
+void VulkanRenderer::updateParticleEmitters(double delta)
 {
-  glm::mat4 invModelMtx = glm::mat4(1.0f);
-
-  auto view = _registry->getEnttRegistry().view<component::Skeleton>();
+  auto& reg = _registry->getEnttRegistry();
+  auto view = reg.view<component::ParticleEmitter, component::Transform>();
   for (auto entity : view) {
-    auto nodeId = _registry->reverseLookup(entity);
-    auto& skeleComp = _registry->getComponent<component::Skeleton>(nodeId);
-
-    // Write all joints into correct offset, and with correct index
-    auto skeleOffset = getOrCreateSkeleOffset(nodeId, skeleComp._jointRefs.size());
-
-    if (_renderableIdMap.find(nodeId) != _renderableIdMap.end()) {
-      invModelMtx = _currentRenderables[_renderableIdMap[nodeId]]._invGlobalTransform;
+    // Paged out emitters are removed, and start over when they come back
+    auto* pageStatus = reg.try_get<component::PageStatus>(entity);
+    if (pageStatus && !pageStatus->_paged) {
+      continue;
     }
 
-    for (std::size_t i = 0; i < skeleComp._jointRefs.size(); ++i) {
-      auto& jr = skeleComp._jointRefs[i];
-      auto& transComp = _registry->getComponent<component::Transform>(jr._node);
-      (*_cachedSkeletons)[skeleOffset + i] = invModelMtx * transComp._globalTransform * jr._inverseBindMatrix;
-    }
+    auto& emitter = view.get<component::ParticleEmitter>(entity);
+    auto& transform = view.get<component::Transform>(entity);
+    _particleEmitters.set(_registry->reverseLookup(entity), emitter, transform._globalTransform);
   }
+
+  _particleEmitters.update(delta);
 }
 
 void VulkanRenderer::updateAssetFetches()
@@ -2565,84 +2336,63 @@ void VulkanRenderer::updateAssetFetches()
   // Go through any pending assets.
   auto models = _assetFetcher.takeModels();
   auto textures = _assetFetcher.takeTextures();
+  auto textureMips = _assetFetcher.takeTextureMips();
   auto mats = _assetFetcher.takeMaterials();
 
   AssetUpdate upd{};
   upd._addedModels.insert(upd._addedModels.end(), models.begin(), models.end());
   upd._addedTextures.insert(upd._addedTextures.end(), textures.begin(), textures.end());
-  upd._addedMaterials.insert(upd._addedMaterials.end(), mats.begin(), mats.end());
-
-  assetUpdate(std::move(upd));
-}
-
-bool VulkanRenderer::arePrerequisitesUploaded(internal::InternalModel& model)
-{
-  // Check that model is uploaded (by checking that it has an internal id)
-  if (_modelIdMap.find(model._id) == _modelIdMap.end()) {
-    return false;
-  }
 
-  // Check that all meshes of the model are uploaded
-  for (auto& mesh : model._meshes) {
-    if (_meshIdMap.find(mesh) == _meshIdMap.end()) {
-      return false;
+  // Streamed mips of textures that were removed while fetching have nothing to go to
+  for (auto& tex : textureMips) {
+    if (_textureResidency.contains(tex._id)) {
+      upd._addedTextures.emplace_back(std::move(tex));
     }
   }
+  upd._addedMaterials.insert(upd._addedMaterials.end(), mats.begin(), mats.end());
 
-  return true;
+  assetUpdate(std::move(upd));
 }
 
-bool VulkanRenderer::arePrerequisitesUploaded(internal::InternalRenderable& rend)
+void VulkanRenderer::updateTextureResidency(const Camera& camera)
 {
-  // Check that model is uploaded (by checking that it has an internal id)
-  if (_modelIdMap.find(rend._renderable._model) == _modelIdMap.end()) {
-    return false;
-  }
+  _textureResidency.setBudget((std::size_t)(_renderOptions.textureStreamingBudgetMB * 1024.0 * 1024.0));
 
-  // Check that all meshes of the model are uploaded
-  if (!arePrerequisitesUploaded(_currentModels[_modelIdMap[rend._renderable._model]])) {
-    return false;
-  }
+  // Estimate how many pixels each renderable covers. Textures are assumed to be stretched once over the bounding sphere,
+  // and the sphere is placed like the GPU culling does it. Renderables outside the frustum count too,
+  // so that turning around doesn't show blurry textures.
+  const float projScale = camera.getProjection()[1][1];
+  const float screenHeight = (float)swapChainExtent().height;
+  const glm::vec3 camPos = camera.getPosition();
 
-  // Material
-  for (auto& mat : rend._renderable._materials) {
-    if (_materialIdMap.find(mat) == _materialIdMap.end()) {
-      return false;
+  for (auto& rend : _currentRenderables) {
+    if (!rend._renderable._visible) {
+      continue;
     }
 
-    auto& material = _currentMaterials[_materialIdMap[mat]];
+    const auto& sphere = rend._renderable._boundingSphere;
+    glm::vec3 center = glm::vec3(rend._globalTransform[3]) + glm::vec3(sphere);
+    float distance = glm::max(glm::distance(camPos, center) - sphere.w, camera.getNear());
+    float pixels = internal::TextureResidency::projectedPixels(2.0f * sphere.w, distance, projScale, screenHeight);
 
-    if (!arePrerequisitesUploaded(material)) {
-      return false;
-    }
-  }
-
-  return true;
-}
+    for (auto& matId : rend._renderable._materials) {
+      auto it = _materialIdMap.find(matId);
+      if (it == _materialIdMap.end()) {
+        continue;
+      }
 
-bool VulkanRenderer::arePrerequisitesUploaded(internal::InternalMaterial& mat)
-{
-  if (_materialIdMap.find(mat._id) == _materialIdMap.end()) {
-    return false;
+      auto& mat = _currentMaterials[it->second];
+      for (auto& texId : { mat._albedoTex, mat._metRoughTex, mat._normalTex, mat._emissiveTex }) {
+        if (texId) {
+          _textureResidency.requestPixels(texId, pixels);
+        }
+      }
+    }
   }
 
-  auto& material = _currentMaterials[_materialIdMap[mat._id]];
-  // Check that all textures are uploaded
-
-  if (material._albedoTex && _textureIdMap.find(material._albedoTex) == _textureIdMap.end()) {
-    return false;
-  }
-  if (material._metRoughTex && _textureIdMap.find(material._metRoughTex) == _textureIdMap.end()) {
-    return false;
+  for (auto& req : _textureResidency.update()) {
+    _assetFetcher.startFetchTextureMips(req._id, req._firstMip);
   }
-  if (material._normalTex && _textureIdMap.find(material._normalTex) == _textureIdMap.end()) {
-    return false;
-  }
-  if (material._emissiveTex && _textureIdMap.find(material._emissiveTex) == _textureIdMap.end()) {
-    return false;
-  }
-
-  return true;
 }
 
 bool VulkanRenderer::arePrerequisitesUploaded(internal::InternalTerrain& terrain)
@@ -2658,6 +2408,22 @@ bool VulkanRenderer::arePrerequisitesUploaded(internal::InternalTerrain& terrain
   return true;
 }
 
+internal::SceneAssets VulkanRenderer::sceneAssets()
+{
+  return internal::SceneAssets{
+    _currentModels, _currentMeshes, _currentMaterials, _currentTextures,
+    _modelIdMap, _meshIdMap, _materialIdMap, _textureIdMap };
+}
+
+internal::SceneNodes VulkanRenderer::sceneNodes()
+{
+  return internal::SceneNodes{
+    _currentRenderables, _pendingFirstUploadRenderables, _renderableIdMap,
+    _lights, _shadowCasters,
+    _skeletonMemIf, _skeletonOffsets,
+    MAX_NUM_RENDERABLES };
+}
+
 void VulkanRenderer::derefAssets(internal::InternalRenderable& rend)
 {
   AssetUpdate upd{};
@@ -2908,6 +2674,9 @@ void VulkanRenderer::computePerFrameQueries()
 
   VkQueryResultFlags queryResFlags = VK_QUERY_RESULT_64_BIT;
 
+  // Raw start and stop ticks of the timers that had results, for the profiler timeline
+  std::vector<std::array<uint64_t, 3>> profiled;
+
   for (int idx = 0; idx < _perFrameTimers.size(); ++idx) {
     // The "stop" query index
     uint32_t queryIdx = idx * 2 + 1;
@@ -2950,28 +2719,31 @@ void VulkanRenderer::computePerFrameQueries()
 
       pfTimer._buf.emplace_back(static_cast<float>(pfTimer._durationMs));
       pfTimer._buf.erase(pfTimer._buf.begin());
+
+      profiled.push_back({ (uint64_t)idx, buffer[0], buffer[1] });
     }
   }
-}
 
-uint32_t VulkanRenderer::getOrCreateSkeleOffset(util::Uuid& node, std::size_t numMatrices)
-{
-  if (_skeletonOffsets.find(node) == _skeletonOffsets.end()) {
-    auto handle = _skeletonMemIf.addData(numMatrices);
-    if (!handle) {
-      printf("Cannot add skeleton with id %s, can't fit into mem interface!\n", node.str().c_str());
-      return 0;
+  // GPU and CPU clocks aren't calibrated against each other, so the earliest timestamp is placed at the submit that recorded it.
+  // The passes are shown at their true relative offsets, but the whole frame may in reality have started later than that.
+  if (!profiled.empty() && _submitTimeNs[frame] > 0 && util::Profiler::enabled()) {
+    uint64_t firstTick = profiled[0][1];
+    for (auto& p : profiled) {
+      firstTick = std::min(firstTick, p[1]);
     }
 
-    _skeletonOffsets[node] = std::move(handle);
+    for (auto& p : profiled) {
+      auto startNs = _submitTimeNs[frame] + (std::int64_t)((p[1] - firstTick) * (double)_timestampPeriod);
+      auto stopNs = _submitTimeNs[frame] + (std::int64_t)((p[2] - firstTick) * (double)_timestampPeriod);
+      util::Profiler::gpuZone(_perFrameTimers[p[0]]._profileName, startNs, stopNs);
+    }
   }
-
-  return (uint32_t)_skeletonOffsets[node]._offset;
 }
 
 void VulkanRenderer::registerPerFrameTimer(const std::string& name, const std::string& group)
 {
   PerFrameTimer timer{ name, group };
+  timer._profileName = util::Profiler::intern(name);
   timer._buf.resize(1000);
   _perFrameTimers.emplace_back(std::move(timer));
 }
@@ -3032,6 +2804,34 @@ std::vector<PerFrameTimer> VulkanRenderer::getPerFrameTimers()
   return _perFrameTimers;
 }
 
+RenderUsageStats VulkanRenderer::getUsageStats()
+{
+  RenderUsageStats stats{};
+
+  auto& vtxIf = _gigaVtxBuffer._memInterface;
+  auto& idxIf = _gigaIdxBuffer._memInterface;
+  stats._gigaVtxUsedBytes = vtxIf.size() - vtxIf.freeSpace();
+  stats._gigaIdxUsedBytes = idxIf.size() - idxIf.freeSpace();
+  stats._gigaBufferBytes = GIGA_MESH_BUFFER_SIZE_MB * 1024 * 1024;
+
+  stats._stagingUsedBytes = _lastStagingUsage;
+  stats._stagingBytes = STAGING_BUFFER_SIZE_MB * 1024 * 1024;
+
+  stats._bindlessUsed = _bindlessTextureMemIf.size() - _bindlessTextureMemIf.freeSpace();
+  stats._maxBindless = MAX_BINDLESS_RESOURCES;
+
+  stats._renderables = _currentRenderables.size();
+  stats._maxRenderables = MAX_NUM_RENDERABLES;
+  stats._meshes = _currentMeshes.size();
+  stats._maxMeshes = MAX_NUM_MESHES;
+  stats._materials = _currentMaterials.size();
+  stats._maxMaterials = MAX_NUM_MATERIALS;
+  stats._lights = _lights.size();
+  stats._maxLights = MAX_NUM_LIGHTS;
+
+  return stats;
+}
+
 const Camera& VulkanRenderer::getCamera()
 {
   return _latestCamera;
@@ -3067,11 +2867,6 @@ void VulkanRenderer::debugDrawGeometry(debug::Geometry geometry)
   }  
 }
 
-std::vector<Particle>& VulkanRenderer::getParticles()
-{
-  return _particles;
-}
-
 bool VulkanRenderer::blackboardValueBool(const std::string& key)
 {
   auto exist = _blackboard.find(key) != _blackboard.end();
@@ -3166,56 +2961,21 @@ bool VulkanRenderer::prefillGPURendMatIdxBuffer(VkCommandBuffer& commandBuffer)
 
   auto& sb = getStagingBuffer();
 
-  uint8_t* data;
-  vmaMapMemory(_vmaAllocator, sb._buf._allocation, (void**)&data);
-
-  // Offset according to current staging buffer usage
-  data = data + sb._currentOffset;
-  uint32_t* mappedData = reinterpret_cast<uint32_t*>(data);
-
-  uint32_t currentIndex = 0;
-  // Do the pending ones first
-  for (std::size_t i = 0; i < _pendingFirstUploadRenderables.size(); ++i) {
-    auto& renderable = _pendingFirstUploadRenderables[i];
-
-    if (!arePrerequisitesUploaded(renderable)) {
-      continue;
-    }
-
-    renderable._materialIndexBufferIndex = currentIndex;
-
-    for (auto& mat : renderable._renderable._materials) {
-      auto idx = _materialIdMap[mat];
-      mappedData[currentIndex] = static_cast<uint32_t>(idx);
-
-      currentIndex++;
-    }
-  }
-
-  for (std::size_t i = 0; i < _currentRenderables.size(); ++i) {
-    auto& renderable = _currentRenderables[i];
-
-    if (!arePrerequisitesUploaded(renderable)) {
-      continue;
-    }
-
-    renderable._materialIndexBufferIndex = currentIndex;
-
-    for (auto& mat : renderable._renderable._materials) {
-      auto idx = _materialIdMap[mat];
-      mappedData[currentIndex] = static_cast<uint32_t>(idx);
+  internal::fillRendMatIdxBuffer(sceneAssets(), sceneNodes(), _indexBufferScratch);
 
-      currentIndex++;
-    }
-  }
-
-  std::size_t dataSize = (currentIndex + 1) * sizeof(uint32_t);
+  std::size_t dataSize = (_indexBufferScratch.size() + 1) * sizeof(uint32_t);
 
   if (!sb.canFit(dataSize, true)) {
-    vmaUnmapMemory(_vmaAllocator, sb._buf._allocation);
     return false;
   }
 
+  uint8_t* data;
+  vmaMapMemory(_vmaAllocator, sb._buf._allocation, (void**)&data);
+
+  // Offset according to current staging buffer usage
+  data = data + sb._currentOffset;
+  std::memcpy(data, _indexBufferScratch.data(), _indexBufferScratch.size() * sizeof(uint32_t));
+
   VkBufferCopy copyRegion{};
   copyRegion.dstOffset = 0;
   copyRegion.srcOffset = sb._currentOffset;
@@ -3255,78 +3015,21 @@ bool VulkanRenderer::prefillGPUModelBuffer(VkCommandBuffer& commandBuffer)
 
   auto& sb = getStagingBuffer();
 
-  uint8_t* data;
-  vmaMapMemory(_vmaAllocator, sb._buf._allocation, (void**)&data);
-
-  // Offset according to current staging buffer usage
-  data = data + sb._currentOffset;
-
-  std::uint32_t* mappedData = reinterpret_cast<std::uint32_t*>(data);
-
-  uint32_t currIdx = 0;
+  internal::fillModelBuffer(sceneAssets(), sceneNodes(), _enableRayTracing, _indexBufferScratch);
 
-  // Do the pending ones first
-  for (std::size_t i = 0; i < _pendingFirstUploadRenderables.size(); ++i) {
-    auto& rend = _pendingFirstUploadRenderables[i];
-
-    if (!arePrerequisitesUploaded(rend)) {
-      continue;
-    }
-
-    rend._modelBufferOffset = currIdx;
-
-    auto& meshes = _currentModels[_modelIdMap[rend._renderable._model]]._meshes;
-    for (auto& mesh : meshes) {
-      auto idx = _meshIdMap[mesh];
-      mappedData[currIdx] = (uint32_t)idx;
-      currIdx++;
-    }
-
-    if (_enableRayTracing && !rend._dynamicMeshes.empty()) {
-      rend._dynamicModelBufferOffset = currIdx;
-
-      for (auto& mesh : rend._dynamicMeshes) {
-        auto idx = _meshIdMap[mesh];
-        mappedData[currIdx] = (uint32_t)idx;
-        currIdx++;
-      }
-    }
-  }
-
-  for (std::size_t i = 0; i < _currentRenderables.size(); ++i) {
-    auto& rend = _currentRenderables[i];
-
-    if (!arePrerequisitesUploaded(rend)) {
-      continue;
-    }
-
-    rend._modelBufferOffset = currIdx;
-
-    auto& meshes = _currentModels[_modelIdMap[rend._renderable._model]]._meshes;
-    for (auto& mesh: meshes) {
-      auto idx = _meshIdMap[mesh];
-      mappedData[currIdx] = (uint32_t)idx;
-      currIdx++;
-    }
-
-    if (_enableRayTracing && !rend._dynamicMeshes.empty()) {
-      rend._dynamicModelBufferOffset = currIdx;
-
-      for (auto& mesh : rend._dynamicMeshes) {
-        auto idx = _meshIdMap[mesh];
-        mappedData[currIdx] = (uint32_t)idx;
-        currIdx++;
-      }
-    }
-  }
-
-  std::size_t dataSize = (currIdx + 1) * sizeof(uint32_t);
+  std::size_t dataSize = (_indexBufferScratch.size() + 1) * sizeof(uint32_t);
 
   if (!sb.canFit(dataSize, true)) {
-    vmaUnmapMemory(_vmaAllocator, sb._buf._allocation);
     return false;
   }
 
+  uint8_t* data;
+  vmaMapMemory(_vmaAllocator, sb._buf._allocation, (void**)&data);
+
+  // Offset according to current staging buffer usage
+  data = data + sb._currentOffset;
+  std::memcpy(data, _indexBufferScratch.data(), _indexBufferScratch.size() * sizeof(uint32_t));
+
   VkBufferCopy copyRegion{};
   copyRegion.dstOffset = 0;
   copyRegion.srcOffset = sb._currentOffset;
@@ -3373,21 +3076,9 @@ bool VulkanRenderer::prefillGPURenderableBuffer(VkCommandBuffer& commandBuffer)
   }
 
   // If we can fit all data, we will also put all pending rends in current rends
-  if (!_pendingFirstUploadRenderables.empty()) {
-    for (auto it = _pendingFirstUploadRenderables.begin(); it != _pendingFirstUploadRenderables.end();) {
-
-      if (arePrerequisitesUploaded(*it)) {
-        _currentRenderables.emplace_back(*it);
-        auto internalId = _currentRenderables.size() - 1;
-        _renderableIdMap[it->_id] = internalId;
-
-        it = _pendingFirstUploadRenderables.erase(it);
-      }
-      else {
-        ++it;
-      }
-    }
-  }
+  auto assets = sceneAssets();
+  auto nodes = sceneNodes();
+  internal::promotePendingRenderables(assets, nodes);
 
   uint8_t* data;
   vmaMapMemory(_vmaAllocator, sb._buf._allocation, (void**)&data);
@@ -3395,41 +3086,8 @@ bool VulkanRenderer::prefillGPURenderableBuffer(VkCommandBuffer& commandBuffer)
   // Offset according to current staging buffer usage
   data = data + sb._currentOffset;
 
-  gpu::GPURenderable* mappedData = reinterpret_cast<gpu::GPURenderable*>(data);
-
   // Also fill mesh usage buffer while we're looping through renderables anyway
-  _currentMeshUsage.clear();
-
-  for (std::size_t i = 0; i < _currentRenderables.size(); ++i) {
-    auto& renderable = _currentRenderables[i]._renderable;
-
-    if (!arePrerequisitesUploaded(_currentRenderables[i])) {
-      continue;
-    }
-
-    auto internalModelIdx = _modelIdMap[renderable._model];
-    auto& model = _currentModels[internalModelIdx];
-
-    for (uint32_t i = 0; i < model._meshes.size(); ++i) {
-      _currentMeshUsage[model._meshes[i]]++;
-    }
-
-    int32_t terrainOffset = -1;    
-    if (_currentRenderables[i]._isTerrain) {
-      terrainOffset = (int32_t)_terrainIdMap[_currentRenderables[i]._id];
-    }
-
-    mappedData[i]._transform = _currentRenderables[i]._globalTransform;
-    mappedData[i]._tint = glm::vec4(renderable._tint, 1.0f);
-    mappedData[i]._modelOffset = _currentRenderables[i]._modelBufferOffset;
-    mappedData[i]._numMeshes = (uint32_t)model._meshes.size();
-    mappedData[i]._skeletonOffset = _currentRenderables[i]._skeletonOffset;
-    mappedData[i]._bounds = renderable._boundingSphere;
-    mappedData[i]._visible = renderable._visible ? 1 : 0;
-    mappedData[i]._firstMaterialIndex = _currentRenderables[i]._materialIndexBufferIndex;
-    mappedData[i]._dynamicModelOffset = _currentRenderables[i]._dynamicModelBufferOffset;
-    mappedData[i]._terrainOffset = terrainOffset;
-  }
+  internal::fillRenderableBuffer(assets, nodes, _terrainIdMap, _currentMeshUsage, reinterpret_cast<gpu::GPURenderable*>(data));
 
   VkBufferCopy copyRegion{};
   copyRegion.dstOffset = 0;
@@ -3480,17 +3138,7 @@ bool VulkanRenderer::prefillGPUMeshBuffer(VkCommandBuffer& commandBuffer)
   // Offset according to current staging buffer usage
   data = data + sb._currentOffset;
 
-  gpu::GPUMeshInfo* mappedData = reinterpret_cast<gpu::GPUMeshInfo*>(data);
-
-  for (std::size_t i = 0; i < _currentMeshes.size(); ++i) {
-    auto& mesh = _currentMeshes[i];
-
-    mappedData[i]._vertexOffset = mesh._vertexOffset;
-    mappedData[i]._indexOffset = (uint32_t)mesh._indexOffset;
-    mappedData[i]._minPos = glm::vec4(mesh._minPos, 0.0f);
-    mappedData[i]._maxPos = glm::vec4(mesh._maxPos, 0.0f);
-    mappedData[i]._blasRef = mesh._blasRef;
-  }
+  internal::fillMeshBuffer(_currentMeshes, reinterpret_cast<gpu::GPUMeshInfo*>(data));
 
   VkBufferCopy copyRegion{};
   copyRegion.dstOffset = 0;
@@ -3585,17 +3233,7 @@ void VulkanRenderer::prefillGPULightBuffer(VkCommandBuffer& commandBuffer)
   // Offset according to current staging buffer usage
   data = data + sb._currentOffset;
 
-  gpu::GPULight* mappedData = reinterpret_cast<gpu::GPULight*>(data);
-
-  for (std::size_t i = 0; i < MAX_NUM_LIGHTS; ++i) {
-    mappedData[i]._color = glm::vec4(0.0);
-    if (_lights.size() > i) {
-      auto& light = _lights[i];
-
-      mappedData[i]._worldPos = glm::vec4(light._pos, light._lightComp._range);
-      mappedData[i]._color = glm::vec4(light._lightComp._color, light._lightComp._enabled ? 1.0 : 0.0);
-    }
-  }
+  internal::fillLightBuffer(_lights, std::span(reinterpret_cast<gpu::GPULight*>(data), MAX_NUM_LIGHTS));
 
   VkBufferCopy copyRegion{};
   copyRegion.dstOffset = 0;
@@ -4453,6 +4091,9 @@ bool VulkanRenderer::initFrameGraphBuilder()
   auto res = _fgb.build(this, &_vault);
   _fgb.printBuiltGraphDebug();
 
+  // Persist right away, so that a crash later on doesn't lose the compiled pipelines
+  _pipelineCache.save();
+
   return res;
 }
 
@@ -4549,8 +4190,13 @@ bool VulkanRenderer::initGpuBuffers()
       _vmaAllocator,
       _gpuStagingBuffer[i]._size,
       VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-      VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT,
+      VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT,
       _gpuStagingBuffer[i]._buf);
+
+    // Keep it mapped for the lifetime of the buffer, the per-frame buffers act as a ring
+    VmaAllocationInfo stagingAllocInfo{};
+    vmaGetAllocationInfo(_vmaAllocator, _gpuStagingBuffer[i]._buf._allocation, &stagingAllocInfo);
+    _gpuStagingBuffer[i]._mappedData = (uint8_t*)stagingAllocInfo.pMappedData;
     std::string name = "gpuStagingBuffer_" + std::to_string(i);
     setDebugName(VK_OBJECT_TYPE_BUFFER, (uint64_t)_gpuStagingBuffer[i]._buf._buffer, name.c_str());
 
@@ -4821,8 +4467,13 @@ void VulkanRenderer::prepare()
 
 void VulkanRenderer::drawFrame()
 {
+  ANEREND_PROFILE_SCOPE("VulkanRenderer::drawFrame");
+
   // At the start of the frame, we want to wait until the previous frame has finished, so that the command buffer and semaphores are available to use.
-  vkWaitForFences(_device, 1, &_inFlightFences[_currentFrame], VK_TRUE, UINT64_MAX);
+  {
+    ANEREND_PROFILE_SCOPE("Wait for frame fence");
+    vkWaitForFences(_device, 1, &_inFlightFences[_currentFrame], VK_TRUE, UINT64_MAX);
+  }
 
   // Check world pos requests
   checkWorldPosCallback();
@@ -4831,11 +4482,16 @@ void VulkanRenderer::drawFrame()
 
   // Acquire an image from the swap chain
   uint32_t imageIndex;
-  VkResult result = vkAcquireNextImageKHR(_device, _swapChain._swapChain, UINT64_MAX, _imageAvailableSemaphores[_currentFrame], VK_NULL_HANDLE, &imageIndex);
+  VkResult result;
+  {
+    ANEREND_PROFILE_SCOPE("Acquire swapchain image");
+    result = vkAcquireNextImageKHR(_device, _swapChain._swapChain, UINT64_MAX, _imageAvailableSemaphores[_currentFrame], VK_NULL_HANDLE, &imageIndex);
+  }
 
   _currentSwapChainIndex = imageIndex;
 
   // Reset staging buffer usage
+  _lastStagingUsage = getStagingBuffer()._currentOffset;
   getStagingBuffer().reset();
 
   // Window has resized for instance
@@ -4857,16 +4513,26 @@ void VulkanRenderer::drawFrame()
   // Execute deletion queue
   _delQ.execute();
 
-  executeFrameGraph(_commandBuffers[_currentFrame], imageIndex);
+  // Kick off background uploads, these overlap with the frame on the transfer queue
+  if (_transferUploader) {
+    _transferUploader.setBandwidth(_renderOptions.uploadBandwidthMBps * 1024.0 * 1024.0);
+    _transferUploader.submit(this);
+  }
+
+  {
+    ANEREND_PROFILE_SCOPE("Record frame graph");
+    executeFrameGraph(_commandBuffers[_currentFrame], imageIndex);
+  }
 
   // Submit the command buffer
   VkSubmitInfo submitInfo{};
   submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-  // This semaphore is what we're waiting for TO BE SIGNALED before executing the command buffer
-  VkSemaphore waitSemaphores[] = {_imageAvailableSemaphores[_currentFrame]};
-  VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-  submitInfo.waitSemaphoreCount = 1;
+  // This semaphore is what we're waiting for TO BE SIGNALED before executing the command buffer.
+  // If textures were acquired from the transfer queue this frame, also wait for their timeline value.
+  VkSemaphore waitSemaphores[] = {_imageAvailableSemaphores[_currentFrame], _transferUploader.timelineSemaphore()};
+  VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT};
+  submitInfo.waitSemaphoreCount = _transferWaitValue > 0 ? 2 : 1;
   submitInfo.pWaitSemaphores = waitSemaphores;
   submitInfo.pWaitDstStageMask = waitStages;
   submitInfo.commandBufferCount = 1;
@@ -4877,6 +4543,22 @@ void VulkanRenderer::drawFrame()
   submitInfo.signalSemaphoreCount = 1;
   submitInfo.pSignalSemaphores = signalSemaphores;
 
+  // Values for binary semaphores are ignored
+  std::uint64_t waitValues[] = {0, _transferWaitValue};
+  std::uint64_t signalValues[] = {0};
+  VkTimelineSemaphoreSubmitInfo timelineInfo{};
+  timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+  timelineInfo.waitSemaphoreValueCount = submitInfo.waitSemaphoreCount;
+  timelineInfo.pWaitSemaphoreValues = waitValues;
+  timelineInfo.signalSemaphoreValueCount = 1;
+  timelineInfo.pSignalSemaphoreValues = signalValues;
+
+  if (_transferWaitValue > 0) {
+    submitInfo.pNext = &timelineInfo;
+  }
+
+  // Only stored after computePerFrameQueries, which reads the results of the previous submit of this frame
+  auto submitTimeNs = util::Profiler::nowNs();
   auto ret = vkQueueSubmit(_graphicsQ, 1, &submitInfo, _inFlightFences[_currentFrame]);
   if (ret != VK_SUCCESS) {
     printf("failed to submit draw command buffer (%d)!\n", ret);
@@ -4897,7 +4579,10 @@ void VulkanRenderer::drawFrame()
   presentInfo.pSwapchains = swapChains;
   presentInfo.pImageIndices = &imageIndex;
 
-  result = vkQueuePresentKHR(_presentQ, &presentInfo);
+  {
+    ANEREND_PROFILE_SCOPE("Present");
+    result = vkQueuePresentKHR(_presentQ, &presentInfo);
+  }
 
   if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || _framebufferResized) {
     _framebufferResized = false;
@@ -4908,6 +4593,7 @@ void VulkanRenderer::drawFrame()
   }
   
   computePerFrameQueries();
+  _submitTimeNs[_currentFrame] = submitTimeNs;
 
   // Advance frame
   _currentFrame = (_currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
@@ -4974,6 +4660,19 @@ void VulkanRenderer::executeFrameGraph(VkCommandBuffer commandBuffer, int imageI
     }
   }
 
+  // Only compact when all frames have seen the result of the previous compaction,
+  // otherwise a stale mesh buffer could outlive the deferred free of the old data.
+  bool meshInfoPending = false;
+  for (std::size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+    meshInfoPending |= _modelsChanged[i];
+  }
+
+  if (!meshInfoPending && compactGigaBuffers(commandBuffer)) {
+    for (std::size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+      _modelsChanged[i] = true;
+    }
+  }
+
   // Skeletons, get copies from animation thread. No-op if the list is empty
   prefillGPUSkeletonBuffer(commandBuffer);
 
@@ -4982,6 +4681,9 @@ void VulkanRenderer::executeFrameGraph(VkCommandBuffer commandBuffer, int imageI
     // Upload q deals with texture and model uploads
     _uploadQ.execute(this, commandBuffer);
 
+    // Take ownership of textures that finished uploading on the transfer queue
+    _transferWaitValue = _transferUploader.acquire(this, commandBuffer);
+
     // If textures changed, we need to re-do everything that depends on the texture indices
     if (_texturesChanged[_currentFrame]) {
       // Materials depend on texture indices
@@ -5090,48 +4792,6 @@ void VulkanRenderer::executeFrameGraph(VkCommandBuffer commandBuffer, int imageI
   }
 }
 
-void VulkanRenderer::createParticles()
-{
-  std::vector<Vertex> vert;
-  std::vector<std::uint32_t> inds;
-  util::createUnitCube(&vert, &inds, true);
-
-  asset::Mesh cubeMesh{};
-  asset::Model cubeModel{};
-  cubeMesh._vertices = std::move(vert);
-  cubeMesh._indices = std::move(inds);
-
-  cubeModel._meshes.emplace_back(std::move(cubeMesh));
-
-  //auto modelId = registerModel(std::move(cubeModel), true);
-
-  std::random_device dev;
-  std::mt19937 rng(dev());
-  std::uniform_real_distribution<float> vel(-8.0f, 8.0f);
-  std::uniform_real_distribution<float> velY(2.0f, 12.0f);
-  std::uniform_real_distribution<float> scale(0.05f, .5f);
-  std::uniform_real_distribution<float> delay(0.0f, 10.0f);
-
-  for (int i = 0; i < 1000; ++i) {
-    Particle particle{};
-    particle._initialPosition = glm::vec3(-7.0f, 7.0f, -12.0f);
-    particle._initialVelocity = glm::vec3(vel(rng), velY(rng), vel(rng));
-    particle._lifetime = 5.0f;
-    particle._scale = scale(rng);
-    particle._spawnDelay = delay(rng);
-
-    /*particle._renderableId = registerRenderable(
-      modelId,
-      glm::translate(glm::mat4(1.0f), particle._initialPosition) * glm::scale(glm::mat4(1.0f), glm::vec3(particle._scale)),
-      glm::vec3(0.0f),
-      1.5f);
-
-    setRenderableVisible(particle._renderableId, false);*/
-
-    _particles.emplace_back(std::move(particle));
-  }
-}
-
 void VulkanRenderer::notifyFramebufferResized()
 {
   _framebufferResized = true;
@@ -5244,6 +4904,41 @@ RenderContext* VulkanRenderer::getRC()
 
 void VulkanRenderer::textureUploadedCB(internal::InternalTexture tex)
 {
+  // A streamed texture with new mips. Swap it in under a new bindless index, frames in flight may still use the old one.
+  if (_textureIdMap.contains(tex._id)) {
+    auto& old = _currentTextures[_textureIdMap[tex._id]];
+    _delQ.add(&_bindlessTextureMemIf, old._bindlessInfo._bindlessIndexHandle);
+    _delQ.add(old._bindlessInfo._image, old._bindlessInfo._view, old._bindlessInfo._sampler);
+
+    tex._bindlessInfo._bindlessIndexHandle = addTextureToBindless(
+      VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+      tex._bindlessInfo._view,
+      tex._bindlessInfo._sampler);
+
+    auto desc = ImGui_ImplVulkan_AddTexture(tex._bindlessInfo._sampler, tex._bindlessInfo._view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    auto& imguiId = _imguiTexIds[tex._id];
+    if (imguiId) {
+      _delQ.add([oldDesc = imguiId]() { ImGui_ImplVulkan_RemoveTexture((VkDescriptorSet)oldDesc); });
+    }
+    imguiId = (void*)desc;
+
+    _textureResidency.setResident(tex._id, tex._firstMip);
+    old = std::move(tex);
+
+    for (std::size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+      _materialsChanged[i] = true;
+      _renderablesChanged[i] = true;
+      _texturesChanged[i] = true;
+    }
+    return;
+  }
+
+  // Streamed mips, or a streamed tail, of a texture that was removed during the upload
+  if (tex._firstMip > 0 && !_textureResidency.contains(tex._id)) {
+    _delQ.add(tex._bindlessInfo._image, tex._bindlessInfo._view, tex._bindlessInfo._sampler);
+    return;
+  }
+
   tex._bindlessInfo._bindlessIndexHandle = addTextureToBindless(
     VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
     tex._bindlessInfo._view,
@@ -5424,22 +5119,7 @@ const std::vector<internal::InternalLight>& VulkanRenderer::getLights()
 
 std::vector<int> VulkanRenderer::getShadowCasterLightIndices()
 {
-  std::vector<int> out;
-  out.reserve(MAX_NUM_POINT_LIGHT_SHADOWS);
-  for (auto& id : _shadowCasters) {
-    if (id) {
-      for (int i = 0; i < _lights.size(); ++i) {
-        if (_lights[i]._id == id) {
-          out.emplace_back(i);
-          break;
-        }
-      }
-    }
-    else {
-      out.emplace_back(-1);
-    }
-  }
-  return out;
+  return internal::shadowCasterLightIndices(_lights, _shadowCasters);
 }
 
 std::vector<std::size_t> VulkanRenderer::getTerrainIndices()
@@ -22,7 +22,8 @@
 #include "passes/RenderPass.h"
 #include "RenderResourceVault.h"
 #include "FrameGraphBuilder.h"
-#include "Particle.h"
+#include "PipelineCache.h"
+#include "ParticleEmitterPool.h"
 #include "internal/InternalMesh.h"
 #include "internal/InternalModel.h"
 #include "internal/InternalMaterial.h"
@@ -35,7 +36,10 @@
 #include "internal/InternalTexture.h"
 #include "internal/UploadContext.h"
 #include "internal/UploadQueue.h"
+#include "internal/TransferUploader.h"
+#include "internal/TextureResidency.h"
 #include "internal/StagingBuffer.h"
+#include "internal/SceneBookkeeping.h"
 #include "AccelerationStructure.h"
 #include "scene/TileIndex.h"
 #include "../component/Registry.h"
@@ -58,6 +62,7 @@ struct PerFrameTimer
 {
   std::string _name;
   std::string _group;
+  const char* _profileName = nullptr; // Interned _name for the profiler timeline
 
   double _durationMs = 0.0f;
   double _avg10 = 0.0f;
@@ -72,6 +77,26 @@ struct PerFrameTimer
   std::vector<float> _buf;
 };
 
+// Usage of the fixed size resources of the renderer against their capacity, for telemetry
+struct RenderUsageStats
+{
+  std::size_t _gigaVtxUsedBytes = 0;
+  std::size_t _gigaIdxUsedBytes = 0;
+  std::size_t _gigaBufferBytes = 0; // Per giga buffer
+  std::size_t _stagingUsedBytes = 0; // High water mark of the last frame
+  std::size_t _stagingBytes = 0;
+  std::size_t _bindlessUsed = 0;
+  std::size_t _maxBindless = 0;
+  std::size_t _renderables = 0;
+  std::size_t _maxRenderables = 0;
+  std::size_t _meshes = 0;
+  std::size_t _maxMeshes = 0;
+  std::size_t _materials = 0;
+  std::size_t _maxMaterials = 0;
+  std::size_t _lights = 0;
+  std::size_t _maxLights = 0;
+};
+
 class VulkanRenderer : public RenderContext, public internal::UploadContext
 {
 public:
@@ -143,6 +168,7 @@ public:
   internal::GigaBuffer& getVtxBuffer() override final;
   internal::GigaBuffer& getIdxBuffer() override final;
   RenderContext* getRC() override final;
+  bool rayTracingEnabled() override final { return _enableRayTracing; }
 
   void textureUploadedCB(internal::InternalTexture tex) override final;
   void modelMeshUploadedCB(internal::InternalMesh mesh, VkCommandBuffer cmdBuf) override final;
@@ -206,6 +232,7 @@ public:
   void endSingleTimeCommands(VkCommandBuffer buffer) override final;
 
   VkPhysicalDeviceRayTracingPipelinePropertiesKHR getRtPipeProps() override final;
+  PipelineCache* getPipelineCache() override final { return &_pipelineCache; }
 
   void registerPerFrameTimer(const std::string& name, const std::string& group) override final;
   void startTimer(const std::string& name, VkCommandBuffer cmdBuffer) override final;
@@ -220,6 +247,7 @@ public:
   double getElapsedTime() override final;
 
   std::vector<PerFrameTimer> getPerFrameTimers();
+  RenderUsageStats getUsageStats();
 
   const Camera& getCamera() override final;
 
@@ -237,8 +265,7 @@ public:
   std::vector<debug::Geometry> takeCurrentDebugGeometry() override final { return std::move(_currentDebugGeometries); }
   std::vector<debug::Geometry> takeCurrentDebugGeometryWireframe() override final { return std::move(_currentDebugGeometriesWireframe); }
 
-  // Hack for testing
-  std::vector<Particle>& getParticles() override final;
+  ParticleEmitterPool& getParticleEmitters() override final { return _particleEmitters; }
 
   bool blackboardValueBool(const std::string& key) override final;
   int blackboardValueInt(const std::string& key) override final;
@@ -250,6 +277,8 @@ private:
   static const std::size_t MAX_PUSH_CONSTANT_SIZE = 128;
   static const std::size_t GIGA_MESH_BUFFER_SIZE_MB = 512;
   static const std::size_t STAGING_BUFFER_SIZE_MB = 128;
+  static const std::size_t GIGA_COMPACTION_BYTES_PER_FRAME = 1024 * 1024 * 4;
+  static const std::size_t UPLOAD_BYTES_PER_FRAME = 1024 * 1024 * 32;
   static const std::size_t MAX_NUM_RENDERABLES = std::size_t(1e5);
   static const std::size_t MAX_NUM_MESHES = std::size_t(2500);
   static const std::size_t MAX_NUM_MATERIALS = 500;
@@ -265,6 +294,7 @@ private:
   static const std::size_t MAX_NUM_SKINNED_MODELS = 1000;
   static const std::size_t MAX_NUM_POINT_LIGHT_SHADOWS = 4;
   static const std::size_t MAX_PAGE_TILE_RADIUS = 2;
+  static const std::uint32_t TEXTURE_STREAMING_TAIL_SIZE = 128;
 
   asset::AssetFetcher _assetFetcher;
 
@@ -273,14 +303,16 @@ private:
   entt::observer _terrainObserver;
 
   void updateNodes();
-  void updateSkeletons();
+  void updateParticleEmitters(double delta);
   void updateAssetFetches();
+  void updateTextureResidency(const Camera& camera);
 
-  bool arePrerequisitesUploaded(internal::InternalModel& model);
-  bool arePrerequisitesUploaded(internal::InternalRenderable& rend);
-  bool arePrerequisitesUploaded(internal::InternalMaterial& mat);
+  // Models, renderables and materials are checked through internal/SceneBookkeeping.h
   bool arePrerequisitesUploaded(internal::InternalTerrain& terrain);
 
+  internal::SceneAssets sceneAssets();
+  internal::SceneNodes sceneNodes();
+
   void derefAssets(internal::InternalRenderable& rend);
 
   std::unordered_map<std::string, std::any> _blackboard;
@@ -323,6 +355,12 @@ private:
   // How to interpret timestamp results
   float _timestampPeriod;
 
+  // Staging bytes used by the frame before the last reset
+  std::size_t _lastStagingUsage = 0;
+
+  // CPU time of the last submit per frame, where the GPU timers are placed on the profiler timeline
+  std::array<std::int64_t, MAX_FRAMES_IN_FLIGHT> _submitTimeNs{};
+
   // Timers that run per frame and then get reset
   std::vector<PerFrameTimer> _perFrameTimers;
 
@@ -343,8 +381,6 @@ private:
   // NOTE: The offset given by each Handle is in terms of _NUMBER OF_ matrices, not bytes!
   std::unordered_map<util::Uuid, internal::BufferMemoryInterface::Handle> _skeletonOffsets;
 
-  uint32_t getOrCreateSkeleOffset(util::Uuid& node, std::size_t numMatrices);
-
   // This is a mirror of the GPU buffer, for simplicity re-created on CPU here.
   std::array<glm::mat4, MAX_NUM_SKINNED_MODELS * MAX_NUM_JOINTS>* _cachedSkeletons = new std::array<glm::mat4, MAX_NUM_SKINNED_MODELS* MAX_NUM_JOINTS>;
 
@@ -371,6 +407,9 @@ private:
   // This is needed for generating draw calls, it records how many renderables use each mesh.
   std::unordered_map<util::Uuid, std::size_t> _currentMeshUsage;
 
+  // The model and material index buffers are filled here first, their size isn't known up front.
+  std::vector<std::uint32_t> _indexBufferScratch;
+
   std::vector<bool> _modelsChanged;
   std::vector<bool> _renderablesChanged;
   std::vector<bool> _lightsChanged;
@@ -403,6 +442,10 @@ private:
 
   void copyDynamicModels(VkCommandBuffer cmdBuffer);
 
+  // Moves a budgeted amount of mesh data down in the giga buffers to reduce fragmentation.
+  // Returns true if any mesh was moved.
+  bool compactGigaBuffers(VkCommandBuffer cmdBuffer);
+
   // Static BLAS for each mesh
   std::unordered_map<util::Uuid, AccelerationStructure> _blases;
 
@@ -447,9 +490,7 @@ private:
 
   void executeFrameGraph(VkCommandBuffer commandBuffer, int imageIndex);
 
-  // Testing
-  void createParticles();
-  std::vector<Particle> _particles;
+  ParticleEmitterPool _particleEmitters;
 
   // These buffers contain vertex and index data for all current meshes
   internal::GigaBuffer _gigaVtxBuffer;
@@ -614,6 +655,7 @@ private:
 
   std::vector<VkCommandBuffer> _commandBuffers;
   VkCommandPool _commandPool;
+  PipelineCache _pipelineCache;
 
   std::vector<VkSemaphore> _imageAvailableSemaphores;
   std::vector<VkSemaphore> _renderFinishedSemaphores;
@@ -642,6 +684,15 @@ private:
   internal::DeletionQueue _delQ;
   internal::UploadQueue _uploadQ;
 
+  // Optional background texture uploads on the transfer queue.
+  // The frame's graphics submission waits on _transferWaitValue if anything was acquired.
+  internal::TransferUploader _transferUploader;
+  std::uint64_t _transferWaitValue = 0;
+
+  // Mip streaming of material textures, decides which mips to stream in and out.
+  // Streamed textures are replaced as a whole once the new mips are uploaded.
+  internal::TextureResidency _textureResidency;
+
   std::vector<debug::Line> _currentDebugLines;
   std::vector<debug::Triangle> _currentDebugTriangles;
   std::vector<debug::Geometry> _currentDebugGeometriesWireframe;
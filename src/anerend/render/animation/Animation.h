@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../../util/Uuid.h"
+#include "../../util/Interpolation.h"
 
 #include <glm/glm.hpp>
 #include <utility>
@@ -45,6 +46,9 @@ struct Animation
 
   // pair.first is timestamp when the interpolated keyframe is active
   std::vector<std::pair<double, InterpolatedKeyframe>> _keyframes;
+
+  // The timestamps of _keyframes, for looking them up
+  util::interp::KeyframeTrack<double> _keyframeTimes;
 };
 
 }
\ No newline at end of file
@@ -3,6 +3,8 @@
 #include "../scene/Scene.h"
 #include "../asset/AssetCollection.h"
 
+#include <chrono>
+
 namespace render::anim
 {
 
@@ -13,6 +15,8 @@ AnimationUpdater::AnimationUpdater(render::scene::Scene* scene, render::asset::A
 
 void AnimationUpdater::update(double delta)
 {
+  auto start = std::chrono::steady_clock::now();
+
   // TODO: Abstract?
   auto view = _scene->registry().getEnttRegistry().view<component::Animator>();
   for (auto entity : view) {
@@ -59,7 +63,17 @@ void AnimationUpdater::update(double delta)
       animator.precalculateAnimationFrames(_scene, animation, skeleComp);
     }
 
-    animator.update(_scene, animation, skeleComp, delta);
+    // Far away or hidden animators skip frames, and catch up with the accumulated delta
+    double animDelta = delta;
+    if (_significance && !_significance->due(entity, _throttles[nodeId], animDelta)) {
+      continue;
+    }
+
+    animator.update(_scene, animation, skeleComp, animDelta);
+  }
+
+  if (_significance) {
+    _significance->addCost(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
   }
 }
 
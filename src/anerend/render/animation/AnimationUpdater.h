@@ -1,6 +1,7 @@
 #pragma once
 
 #include "internal/Animator.h"
+#include "../scene/SignificanceManager.h"
 
 #include <unordered_map>
 
@@ -26,13 +27,18 @@ public:
   void setScene(render::scene::Scene* scene) { _scene = scene; }
   void setAssetCollection(render::asset::AssetCollection* assColl) { _assColl = assColl; }
 
+  // Without one every animator updates every frame
+  void setSignificanceManager(render::scene::SignificanceManager* significance) { _significance = significance; }
+
   void update(double delta);
 
 private:
   render::scene::Scene* _scene = nullptr;
   render::asset::AssetCollection* _assColl = nullptr;
+  render::scene::SignificanceManager* _significance = nullptr;
 
   std::unordered_map<util::Uuid, internal::Animator> _animators;
+  std::unordered_map<util::Uuid, render::scene::ThrottleState> _throttles;
   std::unordered_map<util::Uuid, render::anim::Animation> _cachedAnimations;
 };
 
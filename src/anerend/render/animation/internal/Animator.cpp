@@ -48,22 +48,9 @@ void lerpPath(render::anim::ChannelPath path, glm::mat4* inputMat, const glm::ve
   *inputMat = transMat * rotMat * scaleMat;
 }
 
-std::size_t findIndexForTime(double time, const render::anim::Channel& channel)
+util::interp::KeyframeSpan findSpanForTime(double time, const render::anim::Channel& channel, util::interp::KeyframeCursor& cursor)
 {
-  if (channel._inputTimes.size() == 1) {
-    // Save us some trouble
-    return 0;
-  }
-
-  for (std::size_t i = 0; i < channel._inputTimes.size(); ++i) {
-    float inputTime = channel._inputTimes[i];
-    if (inputTime > time) {
-      return i - 1;
-    }
-  }
-
-  printf("Could not find animation index for time %lf!\n", time);
-  return 0;
+  return util::interp::findKeyframes(channel._inputTimes.data(), channel._inputTimes.size(), time, cursor);
 }
 
 }
@@ -83,6 +70,8 @@ void Animator::init(const render::anim::Animation& anim, component::Skeleton& sk
   }
 
   _initedAnimation = anim._id;
+  _channelCursors.assign(anim._channels.size(), util::interp::KeyframeCursor{});
+  _precalcCursor = util::interp::KeyframeCursor{};
 }
 
 void Animator::precalculateAnimationFrames(render::scene::Scene* scene, render::anim::Animation& anim, component::Skeleton& skele, unsigned framerate)
@@ -107,6 +96,11 @@ void Animator::precalculateAnimationFrames(render::scene::Scene* scene, render::
     tempAnim.updateNoPreCalc(scene, anim, skele, timeStep);
     double animTime = tempAnim._animationTime;
 
+    // Wrapped around to the start, keep the frames sorted on time
+    if (!anim._keyframes.empty() && animTime < anim._keyframes.back().first) {
+      break;
+    }
+
     // Now all joints in skele should be udpated
     for (auto& jr : skele._jointRefs) {
       auto& transComp = scene->registry().getComponent<component::Transform>(jr._node);
@@ -118,6 +112,8 @@ void Animator::precalculateAnimationFrames(render::scene::Scene* scene, render::
     time += timeStep;
   }
 
+  anim._keyframeTimes.assign(anim._keyframes, [](const auto& kf) { return kf.first; });
+
   printf("Done calculating animation frames!\n");
 }
 
@@ -136,23 +132,20 @@ void Animator::updateNoPreCalc(render::scene::Scene* scene, render::anim::Animat
     _animationTime = 0.0;
   }
 
-  // Update each channel one after the other
-  for (auto& channel : anim._channels) {
-    // Find the indices that encompass the current time
-    auto idx = findIndexForTime(_animationTime, channel);
+  if (_channelCursors.size() != anim._channels.size()) {
+    _channelCursors.resize(anim._channels.size());
+  }
 
-    double factor = 0.0;
-    glm::vec4& vec0 = channel._outputs[idx];
-    glm::vec4 vec1{ 0.0 };
+  // Update each channel one after the other
+  for (std::size_t c = 0; c < anim._channels.size(); ++c) {
+    auto& channel = anim._channels[c];
 
-    if (channel._outputs.size() == 1) {
-      vec1 = vec0;
-    }
-    else {
-      vec1 = channel._outputs[idx + 1];
+    // Find the indices that encompass the current time
+    auto span = findSpanForTime(_animationTime, channel, _channelCursors[c]);
 
-      factor = (_animationTime - channel._inputTimes[idx]) / (channel._inputTimes[idx + 1] - channel._inputTimes[idx]);
-    }
+    glm::vec4& vec0 = channel._outputs[span._index0];
+    glm::vec4& vec1 = channel._outputs[span._index1];
+    double factor = span._factor;
 
     // Find the joint
     for (auto& j : skele._jointRefs) {
@@ -203,14 +196,13 @@ void Animator::update(render::scene::Scene* scene, render::anim::Animation& anim
 
 std::size_t Animator::findClosestPrecalcTime(render::anim::Animation& anim, double time)
 {
-  for (std::size_t i = 0; i < anim._keyframes.size(); ++i) {
-    if (anim._keyframes[i].first >= time) {
-      return i;
-    }
+  if (anim._keyframeTimes.size() != anim._keyframes.size()) {
+    anim._keyframeTimes.assign(anim._keyframes, [](const auto& kf) { return kf.first; });
   }
 
-  //printf("Could not find precalc index!\n");
-  return 0;
+  // First frame at or after time
+  auto span = anim._keyframeTimes.find(time, _precalcCursor);
+  return span._factor > 0.0 ? span._index1 : span._index0;
 }
 
 }
\ No newline at end of file
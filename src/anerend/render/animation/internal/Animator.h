@@ -2,6 +2,9 @@
 
 #include "../../../component/Components.h"
 #include "../Animation.h"
+#include "../../../util/Interpolation.h"
+
+#include <vector>
 
 namespace render::scene { class Scene; }
 
@@ -38,6 +41,9 @@ public:
   // This doesn't use the precalculated frames, but lerps joints on the fly.
   void updateNoPreCalc(render::scene::Scene* scene, render::anim::Animation& anim, component::Skeleton& skeleton, double delta);
 
+  // Index of the first pre-calculated frame at or after time, or the last one if there is none
+  std::size_t findClosestPrecalcTime(render::anim::Animation& anim, double time);
+
 private:
   component::Animator::State _state = component::Animator::State::Stopped;
 
@@ -47,7 +53,9 @@ private:
 
   util::Uuid _initedAnimation;
 
-  std::size_t findClosestPrecalcTime(render::anim::Animation& anim, double time);
+  // Where the last lookup was in each channel and in the pre-calculated frames
+  std::vector<util::interp::KeyframeCursor> _channelCursors;
+  util::interp::KeyframeCursor _precalcCursor;
 };
 
 }
\ No newline at end of file
@@ -1,9 +1,12 @@
 #include "AssetCollection.h"
 
 #include "../serialisation/Serialisation.h"
+#include "../../util/Profiler.h"
 
+#include <algorithm>
 #include <fstream>
 #include <future>
+#include <numeric>
 
 namespace {
 
@@ -16,6 +19,7 @@ struct SerialisedAssetInfo
   util::Uuid _id;
   std::string _name;
   render::asset::AssetMetaInfo::Type _type;
+  std::vector<std::uint32_t> _mipSizes; // Textures only, see AssetMetaInfo
 };
 
 }
@@ -30,6 +34,9 @@ void serialize(S& s, SerialisedAssetInfo& p)
   s.object(p._id);
   s.text1b(p._name, 255);
   s.value1b(p._type);
+  if (g_LocalDeserialisedVersion >= 6) {
+    s.container4b(p._mipSizes, 32);
+  }
 }
 
 template <typename S>
@@ -40,6 +47,73 @@ void serialize(S& s, std::vector<SerialisedAssetInfo>& p)
 
 }
 
+namespace {
+
+// Finest mip to read, from either an explicit first mip or a max dimension.
+std::uint32_t firstMipToRead(unsigned width, unsigned height, std::uint32_t numMips, std::uint32_t firstMip, std::uint32_t maxDimension)
+{
+  if (maxDimension > 0) {
+    firstMip = 0;
+    while (firstMip + 1 < numMips && std::max(std::max(width >> firstMip, 1u), std::max(height >> firstMip, 1u)) > maxDimension) {
+      firstMip++;
+    }
+  }
+
+  return std::min(firstMip, numMips - 1);
+}
+
+void dropMips(render::asset::Texture& tex, std::uint32_t numToDrop)
+{
+  if (numToDrop == 0) {
+    return;
+  }
+
+  tex._data.erase(tex._data.begin(), tex._data.begin() + numToDrop);
+  tex._width = std::max(tex._width >> numToDrop, 1u);
+  tex._height = std::max(tex._height >> numToDrop, 1u);
+  tex._numMips -= numToDrop;
+  tex._firstMip += numToDrop;
+}
+
+// Everything of a texture with addressable mips that comes before the mip data.
+std::size_t textureHeaderSize(const render::asset::AssetMetaInfo& meta)
+{
+  return meta._sizeOnDisk - std::accumulate(meta._mipSizes.begin(), meta._mipSizes.end(), std::size_t(0));
+}
+
+template <typename T>
+std::optional<T> deserialiseAsset(const render::asset::AssetMetaInfo& meta, const std::vector<std::uint8_t>& data)
+{
+  return serialisation::deserializeVector<T>(data);
+}
+
+template <>
+std::optional<render::asset::Texture> deserialiseAsset<render::asset::Texture>(const render::asset::AssetMetaInfo& meta, const std::vector<std::uint8_t>& data)
+{
+  if (meta._mipSizes.empty()) {
+    return serialisation::deserializeVector<render::asset::Texture>(data);
+  }
+
+  // Header is serialised without mips, they follow it raw.
+  std::size_t offset = textureHeaderSize(meta);
+  std::vector<std::uint8_t> header(data.begin(), data.begin() + offset);
+
+  auto tex = serialisation::deserializeVector<render::asset::Texture>(header);
+  if (!tex) {
+    return {};
+  }
+
+  tex->_numMips = (unsigned)meta._mipSizes.size();
+  for (auto size : meta._mipSizes) {
+    tex->_data.emplace_back(data.begin() + offset, data.begin() + offset + size);
+    offset += size;
+  }
+
+  return tex;
+}
+
+}
+
 namespace render::asset {
 
 AssetCollection::AssetCollection()
@@ -115,17 +189,22 @@ bool AssetCollection::readIndexAsync(const util::Uuid& id, std::function<void(T)
 
   auto metaInfo = _fileIndex._map[id];
   std::async(std::launch::async, [this, id, &cache, cb, meta = std::move(metaInfo)]() {
-
-    std::ifstream ifs(_p, std::ios::binary);
+    ANEREND_PROFILE_THREAD("Asset I/O");
+    ANEREND_PROFILE_SCOPE("AssetCollection::readIndexAsync");
 
     std::vector<std::uint8_t> data;
-    data.resize(meta._sizeOnDisk);
+    {
+      ANEREND_PROFILE_SCOPE("Read from disk");
+      std::ifstream ifs(_p, std::ios::binary);
 
-    ifs.seekg(meta._offset + _indicesFileSize);
-    ifs.read((char*)data.data(), meta._sizeOnDisk);
-    ifs.close();
+      data.resize(meta._sizeOnDisk);
+
+      ifs.seekg(meta._offset + _indicesFileSize);
+      ifs.read((char*)data.data(), meta._sizeOnDisk);
+      ifs.close();
+    }
 
-    auto m = serialisation::deserializeVector<T>(data);
+    auto m = deserialiseAsset<T>(meta, data);
 
     if (m) {
       {
@@ -159,7 +238,7 @@ T AssetCollection::readIndexBlocking(const util::Uuid& id, std::vector<T>& cache
   ifs.read((char*)data.data(), metaInfo._sizeOnDisk);
   ifs.close();
 
-  auto m = serialisation::deserializeVector<T>(data);
+  auto m = deserialiseAsset<T>(metaInfo, data);
 
   if (m) {
     {
@@ -365,6 +444,115 @@ anim::Animation AssetCollection::getAnimationBlocking(const util::Uuid& id)
   return getAssetBlocking(id, _cachedAnimations);
 }
 
+void AssetCollection::getTextureMips(const util::Uuid& id, std::uint32_t firstMip, TextureRetrievedCallback cb)
+{
+  std::async(std::launch::async, [this, id, firstMip, cb]() {
+    ANEREND_PROFILE_THREAD("Asset I/O");
+    auto tex = readTextureMipsBlocking(id, firstMip, 0);
+    if (tex) {
+      cb(std::move(tex));
+    }
+  });
+}
+
+Texture AssetCollection::getTextureMipsBlocking(const util::Uuid& id, std::uint32_t firstMip)
+{
+  return readTextureMipsBlocking(id, firstMip, 0);
+}
+
+void AssetCollection::getTextureTail(const util::Uuid& id, std::uint32_t maxDimension, TextureRetrievedCallback cb)
+{
+  std::async(std::launch::async, [this, id, maxDimension, cb]() {
+    ANEREND_PROFILE_THREAD("Asset I/O");
+    auto tex = readTextureMipsBlocking(id, 0, maxDimension);
+    if (tex) {
+      cb(std::move(tex));
+    }
+  });
+}
+
+Texture AssetCollection::getTextureTailBlocking(const util::Uuid& id, std::uint32_t maxDimension)
+{
+  return readTextureMipsBlocking(id, 0, maxDimension);
+}
+
+Texture AssetCollection::readTextureMipsBlocking(const util::Uuid& id, std::uint32_t firstMip, std::uint32_t maxDimension)
+{
+  ANEREND_PROFILE_SCOPE("AssetCollection::readTextureMipsBlocking");
+
+  // Cached textures are always complete, just drop what isn't wanted.
+  {
+    std::lock_guard<std::mutex> lock(_cacheMtx);
+    if (_cachePtr.contains(id)) {
+      Texture tex = _cachedTextures[_cachePtr[id]];
+      dropMips(tex, firstMipToRead(tex._width, tex._height, tex._numMips, firstMip, maxDimension));
+      return tex;
+    }
+  }
+
+  auto it = _fileIndex._map.find(id);
+  if (it == _fileIndex._map.end()) {
+    printf("AssetCollection cannot get texture %s, it doesn't exist in cache or on disk!\n", id.str().c_str());
+    return Texture{};
+  }
+
+  const auto& meta = it->second;
+  std::size_t start = meta._offset + _indicesFileSize;
+
+  std::ifstream ifs(_p, std::ios::binary);
+
+  // Written before mips were addressable, so it has to be read in full.
+  if (meta._mipSizes.empty()) {
+    std::vector<std::uint8_t> data;
+    data.resize(meta._sizeOnDisk);
+
+    ifs.seekg(start);
+    ifs.read((char*)data.data(), meta._sizeOnDisk);
+
+    auto tex = serialisation::deserializeVector<Texture>(data);
+    if (!tex) {
+      printf("Failed to deserialize asset %s!\n", id.str().c_str());
+      return Texture{};
+    }
+
+    dropMips(tex.value(), firstMipToRead(tex->_width, tex->_height, tex->_numMips, firstMip, maxDimension));
+    return std::move(tex.value());
+  }
+
+  std::size_t headerSize = textureHeaderSize(meta);
+  std::vector<std::uint8_t> header;
+  header.resize(headerSize);
+
+  ifs.seekg(start);
+  ifs.read((char*)header.data(), headerSize);
+
+  auto tex = serialisation::deserializeVector<Texture>(header);
+  if (!tex) {
+    printf("Failed to deserialize asset %s!\n", id.str().c_str());
+    return Texture{};
+  }
+
+  std::uint32_t numMips = (std::uint32_t)meta._mipSizes.size();
+  std::uint32_t first = firstMipToRead(tex->_width, tex->_height, numMips, firstMip, maxDimension);
+
+  // Mips are contiguous, so skip the finer ones and read the rest in one go.
+  std::size_t skip = std::accumulate(meta._mipSizes.begin(), meta._mipSizes.begin() + first, std::size_t(0));
+  ifs.seekg(start + headerSize + skip);
+
+  for (std::uint32_t i = first; i < numMips; ++i) {
+    auto& mip = tex->_data.emplace_back();
+    mip.resize(meta._mipSizes[i]);
+    ifs.read((char*)mip.data(), mip.size());
+  }
+
+  tex->_width = std::max(tex->_width >> first, 1u);
+  tex->_height = std::max(tex->_height >> first, 1u);
+  tex->_numMips = numMips - first;
+  tex->_firstMip = first;
+
+  return std::move(tex.value());
+}
+
 void AssetCollection::add(Cinematic a)
 {
   addAsset<Cinematic>(std::move(a), _cachedCinematics, AssetMetaInfo::Cinematic);
@@ -375,6 +563,12 @@ void AssetCollection::add(anim::Animation a)
   addAsset<anim::Animation>(std::move(a), _cachedAnimations, AssetMetaInfo::Animation);
 }
 
+void AssetCollection::updateModel(Model a)
+{
+  addEvent(AssetEventType::ModelUpdated, a._id);
+  updateAsset<Model>(std::move(a), _cachedModels, AssetMetaInfo::Type::Model);
+}
+
 void AssetCollection::removeModel(const util::Uuid& id)
 {
   removeAsset<Model>(id, _cachedModels);
@@ -446,6 +640,35 @@ struct InternalSerialiser
     }
   }
 
+  // Textures are written as a header without mips, followed by the raw mips, so that mips can be read one by one.
+  void add(const std::vector<render::asset::Texture>& vec, render::asset::AssetMetaInfo::Type type)
+  {
+    for (auto& t : vec) {
+      render::asset::Texture header{};
+      header._id = t._id;
+      header._name = t._name;
+      header._format = t._format;
+      header._width = t._width;
+      header._height = t._height;
+      header._numMips = 0;
+      header._clampToEdge = t._clampToEdge;
+
+      auto data = serialisation::serializeToVector(header);
+
+      SerialisedAssetInfo info{ _currOffset, 0, t._id, t._name, type };
+      for (auto& mip : t._data) {
+        info._mipSizes.emplace_back((std::uint32_t)mip.size());
+        data.insert(data.end(), mip.begin(), mip.end());
+      }
+      info._size = (std::uint32_t)data.size();
+
+      _indices.emplace_back(std::move(info));
+      _assetData.insert(_assetData.end(), data.begin(), data.end());
+
+      _currOffset += (std::uint32_t)data.size();
+    }
+  }
+
   // Offset includes version and indices size
   std::uint32_t _currOffset = sizeof(g_LocalDeserialisedVersion) + sizeof(std::uint32_t);
   std::vector<SerialisedAssetInfo> _indices;
@@ -569,7 +792,7 @@ void AssetCollection::readIndices()
   _fileIndex._map.clear();
 
   for (auto& info : opt.value()) {
-    AssetMetaInfo meta{ info._type, info._id, info._name, info._offset, info._size };
+    AssetMetaInfo meta{ info._type, info._id, info._name, info._offset, info._size, std::move(info._mipSizes) };
 
     _metaInfos[meta._type].emplace_back(meta);
     _fileIndex._map[info._id] = std::move(meta);
@@ -581,6 +804,32 @@ void AssetCollection::printDebugInfo()
   // TODO, maybe return string instead? so can print wherever like GUI
 }
 
+std::size_t AssetCollection::numCachedAssets() const
+{
+  std::lock_guard<std::mutex> lock(_cacheMtx);
+  return _cachePtr.size();
+}
+
+std::size_t AssetCollection::cachedBytes() const
+{
+  std::lock_guard<std::mutex> lock(_cacheMtx);
+
+  std::size_t bytes = 0;
+  for (auto& model : _cachedModels) {
+    for (auto& mesh : model._meshes) {
+      bytes += mesh._vertices.size() * sizeof(render::Vertex) + mesh._indices.size() * sizeof(std::uint32_t);
+    }
+  }
+
+  for (auto& tex : _cachedTextures) {
+    for (auto& mip : tex._data) {
+      bytes += mip.size();
+    }
+  }
+
+  return bytes;
+}
+
 void AssetCollection::addEvent(AssetEventType type, const util::Uuid& id)
 {
   AssetEvent event{};
@@ -39,6 +39,10 @@ struct AssetMetaInfo
   std::string _name;
   std::size_t _offset;
   std::size_t _sizeOnDisk;
+
+  // Only for textures written with addressable mips (version 6 and up), the size of each mip.
+  // The mips are stored raw after the texture header, most hi-res first.
+  std::vector<std::uint32_t> _mipSizes;
 };
 
 enum class AssetEventType
@@ -46,7 +50,8 @@ enum class AssetEventType
   MaterialUpdated,
   PrefabUpdated,
   TextureUpdated,
-  CinematicUpdated
+  CinematicUpdated,
+  ModelUpdated
 };
 
 struct AssetEvent
@@ -93,6 +98,7 @@ public:
 
   // Will update only what is in cache.
   // TODO: Some of these need to be picked up by things like the renderer.
+  void updateModel(Model a);
   void updateMaterial(Material a);
   void updatePrefab(Prefab a);
   void updateTexture(Texture a);
@@ -123,6 +129,16 @@ public:
   Cinematic getCinematicBlocking(const util::Uuid& id);
   anim::Animation getAnimationBlocking(const util::Uuid& id);
 
+  // Partial texture reads, only the requested mips are read from disk. These never add to cache.
+  // The returned texture is self-contained, i.e. _width, _height and _data start at the first read mip,
+  // and _firstMip tells which mip of the full chain that is.
+  void getTextureMips(const util::Uuid& id, std::uint32_t firstMip, TextureRetrievedCallback cb);
+  Texture getTextureMipsBlocking(const util::Uuid& id, std::uint32_t firstMip);
+
+  // Reads the smallest mips, starting with the first one that is no larger than maxDimension in either direction.
+  void getTextureTail(const util::Uuid& id, std::uint32_t maxDimension, TextureRetrievedCallback cb);
+  Texture getTextureTailBlocking(const util::Uuid& id, std::uint32_t maxDimension);
+
   // Will take whatever is cached (+ on disk) and serialise it down to the provided path.
   // Typically used when creating the AssetCollection, not during gameplay.
   void serialiseToPath(std::filesystem::path p = {});
@@ -130,6 +146,10 @@ public:
   // Prints to stdout.
   void printDebugInfo();
 
+  // Number of cached assets, and the size of their mesh and texture data (the bulk of the cache).
+  std::size_t numCachedAssets() const;
+  std::size_t cachedBytes() const;
+
 private:
   AssetEventLog _log;
   void addEvent(AssetEventType type, const util::Uuid& id);
@@ -163,6 +183,9 @@ private:
   template <typename T>
   void updateAsset(T asset, std::vector<T>& cache, AssetMetaInfo::Type type);
 
+  // A maxDimension of 0 means firstMip is used as is.
+  Texture readTextureMipsBlocking(const util::Uuid& id, std::uint32_t firstMip, std::uint32_t maxDimension);
+
   template <typename T>
   std::vector<util::Uuid> buildCacheId(const std::vector<T>& cache) const;
 
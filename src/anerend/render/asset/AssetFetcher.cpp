@@ -44,7 +44,7 @@ int AssetFetcher::deref(const util::Uuid& id)
   return ref;
 }
 
-void AssetFetcher::startFetchTexture(const util::Uuid& id, bool doRef)
+void AssetFetcher::startFetchTexture(const util::Uuid& id, bool doRef, bool streamed)
 {
   if (checkRef(id) > 0) {
     if (doRef) {
@@ -57,9 +57,24 @@ void AssetFetcher::startFetchTexture(const util::Uuid& id, bool doRef)
     ref(id);
   }
 
-  _assColl->getTexture(id, [this](Texture tex) {
+  auto cb = [this](Texture tex) {
     std::lock_guard<std::mutex> lock(_mtx);
     _fetchedTextures.emplace_back(std::move(tex));
+  };
+
+  if (streamed && _streamingTailSize > 0) {
+    _assColl->getTextureTail(id, _streamingTailSize, cb);
+  }
+  else {
+    _assColl->getTexture(id, cb);
+  }
+}
+
+void AssetFetcher::startFetchTextureMips(const util::Uuid& id, std::uint32_t firstMip)
+{
+  _assColl->getTextureMips(id, firstMip, [this](Texture tex) {
+    std::lock_guard<std::mutex> lock(_mtx);
+    _fetchedTextureMips.emplace_back(std::move(tex));
   });
 }
 
@@ -70,16 +85,16 @@ void AssetFetcher::startFetchMaterial(const util::Uuid& id, bool autoRefTextures
   _assColl->getMaterial(id, [this, autoRef = autoRefTextures](Material mat) {
     // Start loading the associated textures.
     if (mat._albedoTex) {
-      startFetchTexture(mat._albedoTex, autoRef);
+      startFetchTexture(mat._albedoTex, autoRef, true);
     }
     if (mat._metallicRoughnessTex) {
-      startFetchTexture(mat._metallicRoughnessTex, autoRef);
+      startFetchTexture(mat._metallicRoughnessTex, autoRef, true);
     }
     if (mat._normalTex) {
-      startFetchTexture(mat._normalTex, autoRef);
+      startFetchTexture(mat._normalTex, autoRef, true);
     }
     if (mat._emissiveTex) {
-      startFetchTexture(mat._emissiveTex, autoRef);
+      startFetchTexture(mat._emissiveTex, autoRef, true);
     }
 
     std::lock_guard<std::mutex> lock(_mtx);
@@ -103,6 +118,12 @@ std::vector<Texture> AssetFetcher::takeTextures()
   return std::move(_fetchedTextures);
 }
 
+std::vector<Texture> AssetFetcher::takeTextureMips()
+{
+  std::lock_guard<std::mutex> lock(_mtx);
+  return std::move(_fetchedTextureMips);
+}
+
 std::vector<Model> AssetFetcher::takeModels()
 {
   std::lock_guard<std::mutex> lock(_mtx);
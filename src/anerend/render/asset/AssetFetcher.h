@@ -2,6 +2,7 @@
 
 #include "../../util/Uuid.h"
 
+#include <cstdint>
 #include <mutex>
 #include <unordered_map>
 #include <vector>
@@ -28,21 +29,31 @@ public:
 
   void setAssetCollection(AssetCollection* assColl) { _assColl = assColl; }
 
+  // If non-zero, material textures are fetched with only the mips no larger than tailSize,
+  // the rest has to be streamed in with startFetchTextureMips().
+  void setTextureStreaming(std::uint32_t tailSize) { _streamingTailSize = tailSize; }
+
   int ref(const util::Uuid& id);
   int checkRef(const util::Uuid& id);
   int deref(const util::Uuid& id);
 
   // If already refed, these will not start fetching.
-  void startFetchTexture(const util::Uuid& id, bool doRef = true);
+  void startFetchTexture(const util::Uuid& id, bool doRef = true, bool streamed = false);
   void startFetchMaterial(const util::Uuid& id, bool autoRefTextures = true);
   void startFetchModel(const util::Uuid& id);
 
+  // Fetches mips firstMip and up of an already fetched texture, does not touch refs.
+  // The result is taken with takeTextureMips().
+  void startFetchTextureMips(const util::Uuid& id, std::uint32_t firstMip);
+
   std::vector<Texture> takeTextures();
+  std::vector<Texture> takeTextureMips();
   std::vector<Model> takeModels();
   std::vector<Material> takeMaterials();
 
 private:
   AssetCollection* _assColl = nullptr;
+  std::uint32_t _streamingTailSize = 0;
 
   std::mutex _mtx;
   std::mutex _refMtx;
@@ -50,6 +61,7 @@ private:
   std::unordered_map<util::Uuid, int> _ref;
 
   std::vector<Texture> _fetchedTextures;
+  std::vector<Texture> _fetchedTextureMips;
   std::vector<Model> _fetchedModels;
   std::vector<Material> _fetchedMaterials;
 };
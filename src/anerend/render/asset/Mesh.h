@@ -4,6 +4,7 @@
 #include "../../util/Uuid.h"
 
 #include <glm/glm.hpp>
+#include <cstdint>
 #include <vector>
 
 namespace render::asset {
@@ -17,6 +18,9 @@ struct Mesh
   // These are in model space, i.e. need to be multiplied by a model transform
   glm::vec3 _minPos;
   glm::vec3 _maxPos;
+
+  // Optional Jolt shape baked offline (see physics::PhysicsSystem::bakeCollisionShape), empty if not baked
+  std::vector<std::uint8_t> _bakedCollisionShape;
 };
 
 }
\ No newline at end of file
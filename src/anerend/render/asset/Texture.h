@@ -29,7 +29,12 @@ struct Texture
     RGBA_UNORM_BC7,
     RG_UNORM_BC5,
     R8_UNORM,
-    R16_UNORM
+    R16_UNORM,
+    RGBA_UNORM_BC1,
+    RGBA_SRGB_BC1,
+    RGBA_UNORM_BC3,
+    RGBA_SRGB_BC3,
+    R_UNORM_BC4
   } _format;
 
   unsigned _numMips = 1; // Needed so we know how to deserialise
@@ -38,6 +43,9 @@ struct Texture
   unsigned _height;
 
   bool _clampToEdge = false; // TODO: This is a sampling thing, not a texture attribute...
+
+  // Not serialised. Set by partial mip reads, the mip of the full chain that _data[0] (and _width/_height) is.
+  std::uint32_t _firstMip = 0;
 };
 
 }
\ No newline at end of file
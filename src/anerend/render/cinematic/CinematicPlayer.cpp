@@ -11,44 +11,39 @@ namespace render::cinematic {
 namespace {
 
 template <typename T>
-std::tuple<const T*, const T*, double> findClosestKfs(const std::vector<T>& vec, double time)
+std::tuple<const T*, const T*, double> findClosestKfs(
+  const std::vector<T>& vec,
+  const util::interp::KeyframeTrack<>& track,
+  util::interp::KeyframeCursor& cursor,
+  double time)
 {
   auto sz = vec.size();
 
-  if (sz == 0) {
+  if (sz == 0 || track.size() != sz) {
     return { nullptr, nullptr, 0.0 };
   }
 
-  const T* kf0 = nullptr;
-  const T* kf1 = nullptr;
-
   if (sz == 1) {
-    kf0 = &vec[0];
-
-    return { kf0, kf1, 0.0 };
-  }
-
-  bool found = false;
-  for (std::size_t i = 0; i < sz; ++i) {
-    if (vec[i]._time > time) {
-      kf0 = &vec[i - 1];
-      kf1 = &vec[i];
-      found = true;
-      break;
-    }
+    return { &vec[0], nullptr, 0.0 };
   }
-  
-  if (!found) {
-    // If we couldn't find a keyframe past the time, just snap it to the last one.
-    kf0 = &vec[sz - 2];
-    kf1 = &vec.back();
 
-    return { kf0, kf1, 1.0 };
-  }
+  // Clamps to the first and last keyframe
+  auto span = track.find(time, cursor);
+  return { &vec[span._index0], &vec[span._index1], span._factor };
+}
 
-  double factor = (time - kf0->_time) / (kf1->_time - kf0->_time);
+template <typename T>
+void buildKeyframeTracks(
+  const std::vector<std::vector<T>>& vecs,
+  std::vector<util::interp::KeyframeTrack<>>& tracksOut,
+  std::vector<util::interp::KeyframeCursor>& cursorsOut)
+{
+  tracksOut.resize(vecs.size());
+  cursorsOut.assign(vecs.size(), util::interp::KeyframeCursor{});
 
-  return { kf0, kf1, factor };
+  for (std::size_t i = 0; i < vecs.size(); ++i) {
+    tracksOut[i].assign(vecs[i], [](const T& kf) { return kf._time; });
+  }
 }
 
 render::asset::CameraKeyframe lerp(const render::asset::CameraKeyframe& kf0, const render::asset::CameraKeyframe& kf1, double factor)
@@ -124,11 +119,19 @@ CinematicPlayer::CinematicPlayer(asset::Cinematic cinematic, asset::AssetCollect
   , _scene(scene)
   , _assColl(assColl)
   , _camera(camera)
-{}
+{
+  buildTracks();
+}
 
 CinematicPlayer::CinematicPlayer(CinematicPlayer&& rhs)
 {
   std::swap(_cinematic, rhs._cinematic);
+  std::swap(_camTrack, rhs._camTrack);
+  std::swap(_nodeTracks, rhs._nodeTracks);
+  std::swap(_materialTracks, rhs._materialTracks);
+  std::swap(_camCursor, rhs._camCursor);
+  std::swap(_nodeCursors, rhs._nodeCursors);
+  std::swap(_materialCursors, rhs._materialCursors);
   std::swap(_scene, rhs._scene);
   std::swap(_assColl, rhs._assColl);
   std::swap(_camera, rhs._camera);
@@ -141,6 +144,12 @@ CinematicPlayer& CinematicPlayer::operator=(CinematicPlayer&& rhs)
 {
   if (this != &rhs) {
     std::swap(_cinematic, rhs._cinematic);
+    std::swap(_camTrack, rhs._camTrack);
+    std::swap(_nodeTracks, rhs._nodeTracks);
+    std::swap(_materialTracks, rhs._materialTracks);
+    std::swap(_camCursor, rhs._camCursor);
+    std::swap(_nodeCursors, rhs._nodeCursors);
+    std::swap(_materialCursors, rhs._materialCursors);
     std::swap(_scene, rhs._scene);
     std::swap(_assColl, rhs._assColl);
     std::swap(_camera, rhs._camera);
@@ -166,7 +175,7 @@ void CinematicPlayer::update(double delta)
   // Go through keyframes and find closest one to current time
   {
     // Camera
-    auto [kf0, kf1, factor] = findClosestKfs<asset::CameraKeyframe>(_cinematic._camKeyframes, _currentTime);
+    auto [kf0, kf1, factor] = findClosestKfs(_cinematic._camKeyframes, _camTrack, _camCursor, _currentTime);
 
     if (!kf0 || !kf1) {
       return;
@@ -184,8 +193,8 @@ void CinematicPlayer::update(double delta)
 
   {
     // nodes
-    for (auto& v : _cinematic._nodeKeyframes) {
-      auto [kf0, kf1, factor] = findClosestKfs<asset::NodeKeyframe>(v, _currentTime);
+    for (std::size_t i = 0; i < _cinematic._nodeKeyframes.size(); ++i) {
+      auto [kf0, kf1, factor] = findClosestKfs(_cinematic._nodeKeyframes[i], _nodeTracks[i], _nodeCursors[i], _currentTime);
 
       if (!kf0 || !kf1) {
         return;
@@ -218,8 +227,8 @@ void CinematicPlayer::update(double delta)
 
   {
     // materials
-    for (auto& v : _cinematic._materialKeyframes) {
-      auto [kf0, kf1, factor] = findClosestKfs<asset::MaterialKeyframe>(v, _currentTime);
+    for (std::size_t i = 0; i < _cinematic._materialKeyframes.size(); ++i) {
+      auto [kf0, kf1, factor] = findClosestKfs(_cinematic._materialKeyframes[i], _materialTracks[i], _materialCursors[i], _currentTime);
 
       if (!kf0 || !kf1) {
         return;
@@ -270,6 +279,16 @@ void CinematicPlayer::update(double delta)
 void CinematicPlayer::updateCinematic(asset::Cinematic cinematic)
 {
   _cinematic = std::move(cinematic);
+  buildTracks();
+}
+
+void CinematicPlayer::buildTracks()
+{
+  _camTrack.assign(_cinematic._camKeyframes, [](const asset::CameraKeyframe& kf) { return kf._time; });
+  _camCursor = util::interp::KeyframeCursor{};
+
+  buildKeyframeTracks(_cinematic._nodeKeyframes, _nodeTracks, _nodeCursors);
+  buildKeyframeTracks(_cinematic._materialKeyframes, _materialTracks, _materialCursors);
 }
 
 void CinematicPlayer::play()
@@ -1,6 +1,9 @@
 #pragma once
 
 #include "../asset/Cinematic.h"
+#include "../../util/Interpolation.h"
+
+#include <vector>
 
 namespace render::scene { class Scene; }
 namespace render::asset { class AssetCollection; }
@@ -34,6 +37,9 @@ public:
   bool finished() const;
 
 private:
+  // Keyframe times of _cinematic, rebuilt whenever it changes
+  void buildTracks();
+
   enum class State {
     Playing,
     Paused,
@@ -41,6 +47,13 @@ private:
   } _state = State::Stopped;
 
   asset::Cinematic _cinematic;
+  util::interp::KeyframeTrack<> _camTrack;
+  std::vector<util::interp::KeyframeTrack<>> _nodeTracks;
+  std::vector<util::interp::KeyframeTrack<>> _materialTracks;
+  util::interp::KeyframeCursor _camCursor;
+  std::vector<util::interp::KeyframeCursor> _nodeCursors;
+  std::vector<util::interp::KeyframeCursor> _materialCursors;
+
   scene::Scene* _scene = nullptr;
   asset::AssetCollection* _assColl = nullptr;
   Camera* _camera = nullptr;
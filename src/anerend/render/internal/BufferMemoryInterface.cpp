@@ -27,25 +27,34 @@ BufferMemoryInterface::operator bool() const
 
 BufferMemoryInterface::Handle BufferMemoryInterface::addData(std::size_t dataSize)
 {
-  // Check if there is a free block big enough
+  return addDataBelow(dataSize, (std::int64_t)_size);
+}
+
+BufferMemoryInterface::Handle BufferMemoryInterface::addDataBelow(std::size_t dataSize, std::int64_t maxEndOffset)
+{
+  if (dataSize == 0) {
+    return Handle();
+  }
+
+  // Blocks are sorted on offset, so first fit also means lowest offset.
   for (auto it = _freeBlocks.begin(); it != _freeBlocks.end(); ++it) {
     auto size = it->_size;
     auto offset = it->_offset;
 
-    if (size >= dataSize) {
-      Handle handle{ (int64_t)offset, dataSize };
+    if (offset + (std::int64_t)dataSize > maxEndOffset) {
+      break;
+    }
 
-      // Erase free block since it is now used.
-      _freeBlocks.erase(it);
+    if (size >= dataSize) {
+      Handle handle{ offset, dataSize };
 
-      // Do some de-fragmentation efforts. Create a new block with the remaining size.
+      // Shrink the free block, or erase it if it is now fully used.
       if (size > dataSize) {
-        FreeBlock splitBlock{ offset + (int64_t)dataSize, size - dataSize };
-
-        // Also check if we can merge this new block with an adjacent block.
-        // TODO
-
-        _freeBlocks.emplace_back(std::move(splitBlock));
+        it->_offset = offset + (std::int64_t)dataSize;
+        it->_size = size - dataSize;
+      }
+      else {
+        _freeBlocks.erase(it);
       }
 
       //printf("Adding data at offset %zu and size %zu\n", handle._offset, handle._size);
@@ -60,20 +69,85 @@ BufferMemoryInterface::Handle BufferMemoryInterface::addData(std::size_t dataSiz
 
 void BufferMemoryInterface::removeData(BufferMemoryInterface::Handle handle)
 {
-  FreeBlock freeBlock{ handle._offset, handle._size };
+  if (!handle) {
+    return;
+  }
+
   //printf("Removing data at offset %zu and size %zu\n", handle._offset, handle._size);
-  _freeBlocks.emplace_back(std::move(freeBlock));
+
+  // Find insertion point so that the list stays sorted.
+  auto it = _freeBlocks.begin();
+  while (it != _freeBlocks.end() && it->_offset < handle._offset) {
+    ++it;
+  }
+
+  it = _freeBlocks.insert(it, FreeBlock{ handle._offset, handle._size });
+
+  // Merge with next block
+  auto next = it + 1;
+  if (next != _freeBlocks.end() && it->_offset + (std::int64_t)it->_size == next->_offset) {
+    it->_size += next->_size;
+    _freeBlocks.erase(next);
+  }
+
+  // Merge with previous block
+  if (it != _freeBlocks.begin()) {
+    auto prev = it - 1;
+    if (prev->_offset + (std::int64_t)prev->_size == it->_offset) {
+      prev->_size += it->_size;
+      _freeBlocks.erase(it);
+    }
+  }
 
   recalculateFirstFreeOffset();
 }
 
-void BufferMemoryInterface::recalculateFirstFreeOffset()
+std::size_t BufferMemoryInterface::freeSpace() const
 {
+  std::size_t total = 0;
   for (auto& fb : _freeBlocks) {
-    if (fb._offset > (int64_t)_firstFreeOffset) {
-      _firstFreeOffset = fb._offset;
+    total += fb._size;
+  }
+  return total;
+}
+
+std::size_t BufferMemoryInterface::largestFreeBlock() const
+{
+  std::size_t largest = 0;
+  for (auto& fb : _freeBlocks) {
+    if (fb._size > largest) {
+      largest = fb._size;
     }
   }
+  return largest;
+}
+
+double BufferMemoryInterface::fragmentation() const
+{
+  auto free = freeSpace();
+  if (free == 0) {
+    return 0.0;
+  }
+
+  return 1.0 - (double)largestFreeBlock() / (double)free;
+}
+
+void BufferMemoryInterface::recalculateFirstFreeOffset()
+{
+  // Everything below the last free block is potentially used, unless the last block
+  // doesn't reach the end, in which case the whole buffer is (potentially) used.
+  if (_freeBlocks.empty()) {
+    _firstFreeOffset = _size;
+    return;
+  }
+
+  auto& last = _freeBlocks.back();
+  if (last._offset + (std::int64_t)last._size == (std::int64_t)_size) {
+    _firstFreeOffset = (std::size_t)last._offset;
+  }
+  else {
+    _firstFreeOffset = _size;
+  }
 }
 
 }
\ No newline at end of file
@@ -34,12 +34,23 @@ public:
   Handle addData(std::size_t dataSize);
   void removeData(Handle handle);
 
+  // Like addData, but only considers free space that ends at or before maxEndOffset.
+  // Used when compacting, to find a lower spot to move existing data to.
+  Handle addDataBelow(std::size_t dataSize, std::int64_t maxEndOffset);
+
   // This is the total size supplied to this interface.
   std::size_t size() const { return _size; }
 
   // This is how much space is currently used, i.e. the "highest" 
   std::size_t usedSpace() const { return _firstFreeOffset; }
 
+  // Total free space, and the biggest contiguous free block.
+  std::size_t freeSpace() const;
+  std::size_t largestFreeBlock() const;
+
+  // 0 means all free space is contiguous, approaching 1 means very fragmented.
+  double fragmentation() const;
+
 private:
   struct FreeBlock
   {
@@ -49,6 +60,7 @@ private:
 
   void recalculateFirstFreeOffset();
 
+  // Kept sorted on offset, adjacent blocks are merged on removal.
   std::vector<FreeBlock> _freeBlocks;
   std::size_t _size;
   std::size_t _firstFreeOffset; // Used to be able to answer how much space has been used.
@@ -61,6 +61,30 @@ void DeletionQueue::add(AccelerationStructure asToDelete)
   _items.emplace_back(std::move(item), 0);
 }
 
+void DeletionQueue::add(AllocatedImage imageToDelete, VkImageView view, VkSampler sampler)
+{
+  DeletionItem item{};
+  item._imageToDelete = imageToDelete;
+  item._viewToDelete = view;
+  item._samplerToDelete = sampler;
+  _items.emplace_back(std::move(item), 0);
+}
+
+void DeletionQueue::add(BufferMemoryInterface* memIf, BufferMemoryInterface::Handle handle)
+{
+  DeletionItem item{};
+  item._memIf = memIf;
+  item._memHandle = handle;
+  _items.emplace_back(std::move(item), 0);
+}
+
+void DeletionQueue::add(std::function<void()> f)
+{
+  DeletionItem item{};
+  item._func = std::move(f);
+  _items.emplace_back(std::move(item), 0);
+}
+
 void DeletionQueue::deleteItem(DeletionItem& item)
 {
   if (item._asToDelete) {
@@ -71,6 +95,21 @@ void DeletionQueue::deleteItem(DeletionItem& item)
   if (item._bufferToDelete) {
     vmaDestroyBuffer(_vmaAllocator, item._bufferToDelete._buffer, item._bufferToDelete._allocation);
   }
+  if (item._samplerToDelete) {
+    vkDestroySampler(_device, item._samplerToDelete, nullptr);
+  }
+  if (item._viewToDelete) {
+    vkDestroyImageView(_device, item._viewToDelete, nullptr);
+  }
+  if (item._imageToDelete._image) {
+    vmaDestroyImage(_vmaAllocator, item._imageToDelete._image, item._imageToDelete._allocation);
+  }
+  if (item._memIf && item._memHandle) {
+    item._memIf->removeData(item._memHandle);
+  }
+  if (item._func) {
+    item._func();
+  }
 }
 
 }
\ No newline at end of file
@@ -1,7 +1,10 @@
 #pragma once
 
 #include "../AccelerationStructure.h"
+#include "../AllocatedImage.h"
+#include "BufferMemoryInterface.h"
 
+#include <functional>
 #include <utility>
 #include <vector>
 
@@ -23,12 +26,25 @@ public:
 
   void add(AllocatedBuffer bufferToDelete);
   void add(AccelerationStructure asToDelete);
+  void add(AllocatedImage imageToDelete, VkImageView view, VkSampler sampler);
+
+  // Returns the handle to the memory interface once no frame in flight can be using it anymore.
+  void add(BufferMemoryInterface* memIf, BufferMemoryInterface::Handle handle);
+
+  // For anything else that frames in flight may still be using, f does the actual deleting.
+  void add(std::function<void()> f);
 
 private:
   struct DeletionItem
   {
     AllocatedBuffer _bufferToDelete;
     AccelerationStructure _asToDelete;
+    AllocatedImage _imageToDelete{};
+    VkImageView _viewToDelete = VK_NULL_HANDLE;
+    VkSampler _samplerToDelete = VK_NULL_HANDLE;
+    BufferMemoryInterface* _memIf = nullptr;
+    BufferMemoryInterface::Handle _memHandle;
+    std::function<void()> _func;
   };
 
   void deleteItem(DeletionItem& item);
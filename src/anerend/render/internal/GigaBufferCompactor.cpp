@@ -0,0 +1,45 @@
+#include "GigaBufferCompactor.h"
+
+#include <algorithm>
+
+namespace render::internal {
+
+std::vector<GigaBufferCompactor::Move> GigaBufferCompactor::planMoves(
+  BufferMemoryInterface& memIf,
+  std::vector<Allocation> allocations,
+  std::size_t byteBudget)
+{
+  std::vector<Move> moves;
+
+  // Highest offset first, those are the ones that keep the used space from shrinking.
+  std::sort(allocations.begin(), allocations.end(), [](const Allocation& a, const Allocation& b) {
+    return a._handle._offset > b._handle._offset;
+  });
+
+  std::size_t bytesLeft = byteBudget;
+  for (auto& alloc : allocations) {
+    if (!alloc._handle) {
+      continue;
+    }
+
+    if (alloc._handle._size > bytesLeft && !moves.empty()) {
+      continue;
+    }
+
+    auto dst = memIf.addDataBelow(alloc._handle._size, alloc._handle._offset);
+    if (!dst) {
+      continue;
+    }
+
+    moves.emplace_back(Move{ alloc._userIndex, alloc._handle, dst });
+    bytesLeft = alloc._handle._size > bytesLeft ? 0 : bytesLeft - alloc._handle._size;
+
+    if (bytesLeft == 0) {
+      break;
+    }
+  }
+
+  return moves;
+}
+
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "BufferMemoryInterface.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace render::internal {
+
+/*
+  Plans incremental compaction of a giga buffer. Allocations are moved, highest offset first,
+  into the lowest free space below them that fits. Destinations are reserved in the memory interface,
+  but sources are _not_ given back, since frames in flight may still read them. It is up to the caller
+  to free the sources when it is safe, and to record the actual copies.
+  Since a destination is always previously free space, it never overlaps any source.
+*/
+struct GigaBufferCompactor
+{
+  struct Allocation
+  {
+    // Caller-defined, e.g. an index into a mesh list.
+    std::size_t _userIndex = 0;
+    BufferMemoryInterface::Handle _handle;
+  };
+
+  struct Move
+  {
+    std::size_t _userIndex = 0;
+    BufferMemoryInterface::Handle _src;
+    BufferMemoryInterface::Handle _dst;
+  };
+
+  // At most byteBudget bytes are moved, except that at least one move is always allowed
+  // so that allocations larger than the budget don't stall compaction forever.
+  static std::vector<Move> planMoves(
+    BufferMemoryInterface& memIf,
+    std::vector<Allocation> allocations,
+    std::size_t byteBudget);
+};
+
+}
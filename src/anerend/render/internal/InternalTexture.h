@@ -22,6 +22,9 @@ struct InternalTexture
   } _bindlessInfo;
 
   util::Uuid _id;
+
+  // Mip of the full chain that the image starts at, non-zero when streamed
+  std::uint32_t _firstMip = 0;
 };
 
 }
\ No newline at end of file
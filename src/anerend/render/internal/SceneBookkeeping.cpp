@@ -0,0 +1,691 @@
+#include "SceneBookkeeping.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace render::internal {
+
+namespace {
+
+void releaseShadowCaster(std::span<util::Uuid> shadowCasters, const util::Uuid& id)
+{
+  for (auto& caster : shadowCasters) {
+    if (caster == id) {
+      caster = util::Uuid();
+      break;
+    }
+  }
+}
+
+void claimShadowCaster(std::span<util::Uuid> shadowCasters, const util::Uuid& id)
+{
+  for (auto& caster : shadowCasters) {
+    if (!caster) {
+      caster = id;
+      break;
+    }
+  }
+}
+
+void releaseSkeleton(const SceneNodes& nodes, const util::Uuid& id)
+{
+  auto it = nodes._skeletonOffsets.find(id);
+  if (it != nodes._skeletonOffsets.end()) {
+    nodes._skeletonMemIf.removeData(it->second);
+    nodes._skeletonOffsets.erase(it);
+  }
+}
+
+void setMaterial(InternalMaterial& internalMat, const asset::Material& mat)
+{
+  internalMat._baseColFactor = mat._baseColFactor;
+  internalMat._emissive = mat._emissive;
+  internalMat._metallicFactor = mat._metallicFactor;
+  internalMat._roughnessFactor = mat._roughnessFactor;
+  internalMat._albedoTex = mat._albedoTex;
+  internalMat._metRoughTex = mat._metallicRoughnessTex;
+  internalMat._normalTex = mat._normalTex;
+  internalMat._emissiveTex = mat._emissiveTex;
+}
+
+int32_t bindlessIndex(const SceneAssets& assets, const util::Uuid& tex)
+{
+  if (!tex) {
+    return -1;
+  }
+
+  return (int32_t)assets._textures[assets._textureIdMap[tex]]._bindlessInfo._bindlessIndexHandle._offset;
+}
+
+}
+
+bool eraseRenderable(
+  std::vector<InternalRenderable>& renderables,
+  std::unordered_map<util::Uuid, std::size_t>& idMap,
+  const util::Uuid& id)
+{
+  auto it = idMap.find(id);
+  if (it == idMap.end()) {
+    return false;
+  }
+
+  std::size_t idx = it->second;
+  idMap.erase(it);
+  renderables.erase(renderables.begin() + idx);
+
+  // Everything after it moved down one step
+  for (std::size_t i = idx; i < renderables.size(); ++i) {
+    idMap[renderables[i]._id] = i;
+  }
+
+  return true;
+}
+
+InternalRenderable* findPendingRenderable(std::vector<InternalRenderable>& pending, const util::Uuid& id)
+{
+  auto it = std::find_if(pending.begin(), pending.end(),
+    [&id](InternalRenderable& a) { return a._id == id; });
+
+  return it != pending.end() ? &(*it) : nullptr;
+}
+
+void setRenderableNode(InternalRenderable& rend, const component::Renderable& comp, const glm::mat4& globalTransform)
+{
+  rend._renderable = comp;
+  rend._globalTransform = globalTransform;
+  rend._invGlobalTransform = glm::inverse(globalTransform);
+}
+
+void updateLight(
+  std::vector<InternalLight>& lights,
+  std::span<util::Uuid> shadowCasters,
+  const util::Uuid& id,
+  component::Light& light,
+  const glm::vec3& pos,
+  bool paged)
+{
+  auto it = std::find_if(lights.begin(), lights.end(),
+    [&id](InternalLight& a) { return a._id == id; });
+
+  // Removed light
+  if (!paged) {
+    if (it != lights.end()) {
+      releaseShadowCaster(shadowCasters, id);
+      lights.erase(it);
+    }
+    return;
+  }
+
+  bool wasCaster = it != lights.end() && it->_lightComp._shadowCaster;
+
+  if (wasCaster && !light._shadowCaster) {
+    releaseShadowCaster(shadowCasters, id);
+  }
+  else if (!wasCaster && light._shadowCaster) {
+    claimShadowCaster(shadowCasters, id);
+  }
+
+  light.updateViewMatrices(pos);
+
+  if (it != lights.end()) {
+    // Updated light
+    it->_pos = pos;
+    it->_lightComp = light;
+  }
+  else {
+    // Added light
+    InternalLight internalLight{};
+    internalLight._id = id;
+    internalLight._lightComp = light;
+    internalLight._pos = pos;
+    lights.emplace_back(std::move(internalLight));
+  }
+}
+
+std::vector<int> shadowCasterLightIndices(const std::vector<InternalLight>& lights, std::span<const util::Uuid> shadowCasters)
+{
+  std::vector<int> out;
+  out.reserve(shadowCasters.size());
+
+  for (auto& id : shadowCasters) {
+    int idx = -1;
+    if (id) {
+      for (int i = 0; i < (int)lights.size(); ++i) {
+        if (lights[i]._id == id) {
+          idx = i;
+          break;
+        }
+      }
+    }
+    out.emplace_back(idx);
+  }
+
+  return out;
+}
+
+
+NodeChanges updateObservedNodes(
+  component::Registry& registry,
+  entt::observer& observer,
+  const SceneNodes& nodes,
+  const NodeHooks& hooks)
+{
+  NodeChanges changes{};
+
+  for (const auto entity : observer) {
+    auto id = registry.reverseLookup(entity);
+    bool paged = registry.getComponent<component::PageStatus>(id)._paged;
+
+    // If there is no transform, something weird is going on and we don't particularly care
+    if (!registry.hasComponent<component::Transform>(id)) {
+      continue;
+    }
+
+    auto& transComp = registry.getComponent<component::Transform>(id);
+
+    // renderables
+    if (registry.hasComponent<component::Renderable>(id)) {
+      auto& rend = registry.getComponent<component::Renderable>(id);
+      changes._renderables = true;
+
+      if (paged) {
+        if (auto* pending = findPendingRenderable(nodes._pending, id)) {
+          // Not yet uploaded, but keep what will be uploaded current
+          setRenderableNode(*pending, rend, transComp._globalTransform);
+          continue;
+        }
+
+        auto it = nodes._renderableIdMap.find(id);
+        if (it == nodes._renderableIdMap.end()) {
+          // Added renderable
+          if (!id) {
+            printf("Asset update fail: cannot add renderable with invalid id\n");
+            continue;
+          }
+
+          if (!rend._model) {
+            printf("Asset update fail: cannot add renderable with invalid model id\n");
+            continue;
+          }
+
+          if (nodes._renderables.size() + nodes._pending.size() >= nodes._maxRenderables) {
+            printf("Cannot add renderable, max size reached!\n");
+            continue;
+          }
+
+          InternalRenderable internalRend{};
+          internalRend._id = id;
+          setRenderableNode(internalRend, rend, transComp._globalTransform);
+
+          if (hooks._added && !hooks._added(internalRend)) {
+            continue;
+          }
+
+          if (registry.hasComponent<component::Skeleton>(id)) {
+            auto& skeleComp = registry.getComponent<component::Skeleton>(id);
+            internalRend._skeletonOffset = getOrCreateSkeletonOffset(nodes, id, skeleComp._jointRefs.size());
+          }
+
+          nodes._pending.emplace_back(std::move(internalRend));
+        }
+        else {
+          // Updated renderable
+          if (!rend._model) {
+            printf("Asset update fail: cannot update renderable with invalid model id\n");
+            continue;
+          }
+
+          setRenderableNode(nodes._renderables[it->second], rend, transComp._globalTransform);
+        }
+      }
+      else {
+        // Not paged, removed
+        auto pendingIt = std::find_if(nodes._pending.begin(), nodes._pending.end(),
+          [&id](InternalRenderable& a) { return a._id == id; });
+        if (pendingIt != nodes._pending.end()) {
+          if (hooks._removed) {
+            hooks._removed(*pendingIt);
+          }
+          nodes._pending.erase(pendingIt);
+        }
+
+        auto it = nodes._renderableIdMap.find(id);
+        if (it != nodes._renderableIdMap.end()) {
+          if (hooks._removed) {
+            hooks._removed(nodes._renderables[it->second]);
+          }
+          eraseRenderable(nodes._renderables, nodes._renderableIdMap, id);
+        }
+
+        releaseSkeleton(nodes, id);
+      }
+    }
+
+    // lights
+    if (registry.hasComponent<component::Light>(id)) {
+      auto& l = registry.getComponent<component::Light>(id);
+      glm::vec3 lightPos = transComp._globalTransform[3];
+      changes._lights = true;
+
+      updateLight(nodes._lights, nodes._shadowCasters, id, l, lightPos, paged);
+    }
+  }
+
+  observer.clear();
+
+  return changes;
+}
+
+std::uint32_t getOrCreateSkeletonOffset(const SceneNodes& nodes, const util::Uuid& node, std::size_t numJoints)
+{
+  auto it = nodes._skeletonOffsets.find(node);
+  if (it != nodes._skeletonOffsets.end()) {
+    return (std::uint32_t)it->second._offset;
+  }
+
+  auto handle = nodes._skeletonMemIf.addData(numJoints);
+  if (!handle) {
+    printf("Cannot add skeleton with id %s, can't fit into mem interface!\n", node.str().c_str());
+    return 0;
+  }
+
+  nodes._skeletonOffsets[node] = handle;
+  return (std::uint32_t)handle._offset;
+}
+
+void updateSkeletons(component::Registry& registry, const SceneNodes& nodes, std::span<glm::mat4> skeletons)
+{
+  auto& reg = registry.getEnttRegistry();
+  auto view = reg.view<component::Skeleton>();
+  for (auto entity : view) {
+    // Paged out nodes have given back their slot
+    auto* pageStatus = reg.try_get<component::PageStatus>(entity);
+    if (pageStatus && !pageStatus->_paged) {
+      continue;
+    }
+
+    auto nodeId = registry.reverseLookup(entity);
+    auto& skeleComp = registry.getComponent<component::Skeleton>(nodeId);
+
+    // Write all joints into correct offset, and with correct index
+    auto skeleOffset = getOrCreateSkeletonOffset(nodes, nodeId, skeleComp._jointRefs.size());
+
+    glm::mat4 invModelMtx = glm::mat4(1.0f);
+    auto it = nodes._renderableIdMap.find(nodeId);
+    if (it != nodes._renderableIdMap.end()) {
+      invModelMtx = nodes._renderables[it->second]._invGlobalTransform;
+    }
+
+    for (std::size_t i = 0; i < skeleComp._jointRefs.size() && skeleOffset + i < skeletons.size(); ++i) {
+      auto& jr = skeleComp._jointRefs[i];
+      auto& transComp = registry.getComponent<component::Transform>(jr._node);
+      skeletons[skeleOffset + i] = invModelMtx * transComp._globalTransform * jr._inverseBindMatrix;
+    }
+  }
+}
+
+bool arePrerequisitesUploaded(const SceneAssets& assets, const InternalModel& model)
+{
+  // Check that model is uploaded (by checking that it has an internal id)
+  if (!assets._modelIdMap.contains(model._id)) {
+    return false;
+  }
+
+  // Check that all meshes of the model are uploaded
+  for (auto& mesh : model._meshes) {
+    if (!assets._meshIdMap.contains(mesh)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool arePrerequisitesUploaded(const SceneAssets& assets, const InternalRenderable& rend)
+{
+  auto modelIt = assets._modelIdMap.find(rend._renderable._model);
+  if (modelIt == assets._modelIdMap.end()) {
+    return false;
+  }
+
+  if (!arePrerequisitesUploaded(assets, assets._models[modelIt->second])) {
+    return false;
+  }
+
+  for (auto& mat : rend._renderable._materials) {
+    auto matIt = assets._materialIdMap.find(mat);
+    if (matIt == assets._materialIdMap.end()) {
+      return false;
+    }
+
+    if (!arePrerequisitesUploaded(assets, assets._materials[matIt->second])) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool arePrerequisitesUploaded(const SceneAssets& assets, const InternalMaterial& mat)
+{
+  if (!assets._materialIdMap.contains(mat._id)) {
+    return false;
+  }
+
+  // Check that all textures are uploaded
+  for (auto& tex : { mat._albedoTex, mat._metRoughTex, mat._normalTex, mat._emissiveTex }) {
+    if (tex && !assets._textureIdMap.contains(tex)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void promotePendingRenderables(const SceneAssets& assets, const SceneNodes& nodes)
+{
+  for (auto it = nodes._pending.begin(); it != nodes._pending.end();) {
+    if (arePrerequisitesUploaded(assets, *it)) {
+      nodes._renderableIdMap[it->_id] = nodes._renderables.size();
+      nodes._renderables.emplace_back(std::move(*it));
+      it = nodes._pending.erase(it);
+    }
+    else {
+      ++it;
+    }
+  }
+}
+
+void fillModelBuffer(const SceneAssets& assets, const SceneNodes& nodes, bool dynamicMeshes, std::vector<std::uint32_t>& out)
+{
+  out.clear();
+
+  auto fill = [&](InternalRenderable& rend) {
+    if (!arePrerequisitesUploaded(assets, rend)) {
+      return;
+    }
+
+    rend._modelBufferOffset = (std::uint32_t)out.size();
+
+    for (auto& mesh : assets._models[assets._modelIdMap[rend._renderable._model]]._meshes) {
+      out.emplace_back((std::uint32_t)assets._meshIdMap[mesh]);
+    }
+
+    if (dynamicMeshes && !rend._dynamicMeshes.empty()) {
+      rend._dynamicModelBufferOffset = (std::uint32_t)out.size();
+
+      for (auto& mesh : rend._dynamicMeshes) {
+        out.emplace_back((std::uint32_t)assets._meshIdMap[mesh]);
+      }
+    }
+  };
+
+  // Do the pending ones first
+  for (auto& rend : nodes._pending) {
+    fill(rend);
+  }
+  for (auto& rend : nodes._renderables) {
+    fill(rend);
+  }
+}
+
+void fillRendMatIdxBuffer(const SceneAssets& assets, const SceneNodes& nodes, std::vector<std::uint32_t>& out)
+{
+  out.clear();
+
+  auto fill = [&](InternalRenderable& rend) {
+    if (!arePrerequisitesUploaded(assets, rend)) {
+      return;
+    }
+
+    rend._materialIndexBufferIndex = (std::uint32_t)out.size();
+
+    for (auto& mat : rend._renderable._materials) {
+      out.emplace_back((std::uint32_t)assets._materialIdMap[mat]);
+    }
+  };
+
+  for (auto& rend : nodes._pending) {
+    fill(rend);
+  }
+  for (auto& rend : nodes._renderables) {
+    fill(rend);
+  }
+}
+
+void fillRenderableBuffer(
+  const SceneAssets& assets,
+  const SceneNodes& nodes,
+  const std::unordered_map<util::Uuid, std::size_t>& terrainIdMap,
+  std::unordered_map<util::Uuid, std::size_t>& meshUsage,
+  gpu::GPURenderable* out)
+{
+  meshUsage.clear();
+
+  for (std::size_t i = 0; i < nodes._renderables.size(); ++i) {
+    auto& internalRend = nodes._renderables[i];
+    auto& renderable = internalRend._renderable;
+
+    if (!arePrerequisitesUploaded(assets, internalRend)) {
+      continue;
+    }
+
+    auto& model = assets._models[assets._modelIdMap[renderable._model]];
+
+    for (auto& mesh : model._meshes) {
+      meshUsage[mesh]++;
+    }
+
+    int32_t terrainOffset = -1;
+    if (internalRend._isTerrain) {
+      auto terrainIt = terrainIdMap.find(internalRend._id);
+      if (terrainIt != terrainIdMap.end()) {
+        terrainOffset = (int32_t)terrainIt->second;
+      }
+    }
+
+    out[i]._transform = internalRend._globalTransform;
+    out[i]._tint = glm::vec4(renderable._tint, 1.0f);
+    out[i]._modelOffset = internalRend._modelBufferOffset;
+    out[i]._numMeshes = (uint32_t)model._meshes.size();
+    out[i]._skeletonOffset = internalRend._skeletonOffset;
+    out[i]._bounds = renderable._boundingSphere;
+    out[i]._visible = renderable._visible ? 1 : 0;
+    out[i]._firstMaterialIndex = internalRend._materialIndexBufferIndex;
+    out[i]._dynamicModelOffset = internalRend._dynamicModelBufferOffset;
+    out[i]._terrainOffset = terrainOffset;
+  }
+}
+
+void fillMeshBuffer(const std::vector<InternalMesh>& meshes, gpu::GPUMeshInfo* out)
+{
+  for (std::size_t i = 0; i < meshes.size(); ++i) {
+    auto& mesh = meshes[i];
+
+    out[i]._vertexOffset = mesh._vertexOffset;
+    out[i]._indexOffset = (uint32_t)mesh._indexOffset;
+    out[i]._minPos = glm::vec4(mesh._minPos, 0.0f);
+    out[i]._maxPos = glm::vec4(mesh._maxPos, 0.0f);
+    out[i]._blasRef = mesh._blasRef;
+  }
+}
+
+void fillMaterialBuffer(const SceneAssets& assets, gpu::GPUMaterialInfo* out)
+{
+  for (std::size_t i = 0; i < assets._materials.size(); ++i) {
+    auto& mat = assets._materials[i];
+
+    if (!arePrerequisitesUploaded(assets, mat)) {
+      continue;
+    }
+
+    out[i]._baseColFac = glm::vec4(mat._baseColFactor, 0.0f);
+    out[i]._emissive = mat._emissive;
+    out[i]._metRough = glm::vec4(mat._metallicFactor, mat._roughnessFactor, 0.0f, 0.0f);
+    out[i]._bindlessIndices = glm::ivec4(
+      bindlessIndex(assets, mat._metRoughTex),
+      bindlessIndex(assets, mat._albedoTex),
+      bindlessIndex(assets, mat._normalTex),
+      bindlessIndex(assets, mat._emissiveTex));
+  }
+}
+
+void fillLightBuffer(const std::vector<InternalLight>& lights, std::span<gpu::GPULight> out)
+{
+  for (std::size_t i = 0; i < out.size(); ++i) {
+    out[i]._color = glm::vec4(0.0);
+    if (lights.size() > i) {
+      auto& light = lights[i];
+
+      out[i]._worldPos = glm::vec4(light._pos, light._lightComp._range);
+      out[i]._color = glm::vec4(light._lightComp._color, light._lightComp._enabled ? 1.0 : 0.0);
+    }
+  }
+}
+
+bool addModel(const SceneAssets& assets, const asset::Model& model, std::size_t maxMeshes)
+{
+  if (!model._id) {
+    printf("Asset update fail: cannot add model with invalid id\n");
+    return false;
+  }
+
+  if (assets._meshes.size() + model._meshes.size() > maxMeshes) {
+    printf("Cannot add model, max num meshes reached!\n");
+    return false;
+  }
+
+  InternalModel internalModel{};
+  internalModel._id = model._id;
+
+  for (const auto& mesh : model._meshes) {
+    if (!mesh._id) {
+      printf("Asset update fail: cannot add mesh with invalid id\n");
+      continue;
+    }
+
+    internalModel._meshes.push_back(mesh._id);
+  }
+
+  assets._modelIdMap[model._id] = assets._models.size();
+  assets._models.emplace_back(std::move(internalModel));
+
+  return true;
+}
+
+void removeModels(
+  const SceneAssets& assets,
+  const std::vector<util::Uuid>& ids,
+  const std::function<void(InternalMesh&)>& releaseMesh)
+{
+  if (ids.empty()) {
+    return;
+  }
+
+  // Indices go stale as models are erased, so look them up by id and rebuild the maps once at the end
+  for (auto& id : ids) {
+    auto it = std::find_if(assets._models.begin(), assets._models.end(),
+      [&id](InternalModel& m) { return m._id == id; });
+    if (it == assets._models.end()) {
+      printf("Cannot remove model %s, it doesn't exist!\n", id.str().c_str());
+      continue;
+    }
+
+    for (auto& mesh : it->_meshes) {
+      auto meshIt = std::find_if(assets._meshes.begin(), assets._meshes.end(),
+        [&mesh](InternalMesh& m) { return m._id == mesh; });
+
+      if (meshIt != assets._meshes.end()) {
+        releaseMesh(*meshIt);
+        assets._meshes.erase(meshIt);
+      }
+    }
+
+    assets._models.erase(it);
+  }
+
+  rebuildIdMap(assets._models, assets._modelIdMap);
+  rebuildIdMap(assets._meshes, assets._meshIdMap);
+}
+
+void removeTextures(
+  const SceneAssets& assets,
+  const std::vector<util::Uuid>& ids,
+  const std::function<void(InternalTexture&)>& releaseTexture)
+{
+  if (ids.empty()) {
+    return;
+  }
+
+  for (auto& id : ids) {
+    auto it = std::find_if(assets._textures.begin(), assets._textures.end(),
+      [&id](InternalTexture& t) { return t._id == id; });
+
+    if (it != assets._textures.end()) {
+      releaseTexture(*it);
+      assets._textures.erase(it);
+    }
+  }
+
+  rebuildIdMap(assets._textures, assets._textureIdMap);
+}
+
+bool addMaterial(const SceneAssets& assets, const asset::Material& mat, std::size_t maxMaterials)
+{
+  if (!mat._id) {
+    printf("Material has invalid id, not adding!\n");
+    return false;
+  }
+
+  if (assets._materials.size() >= maxMaterials) {
+    printf("Cannot add material, max size reached!\n");
+    return false;
+  }
+
+  InternalMaterial internalMat{};
+  internalMat._id = mat._id;
+  setMaterial(internalMat, mat);
+
+  assets._materialIdMap[mat._id] = assets._materials.size();
+  assets._materials.emplace_back(std::move(internalMat));
+
+  return true;
+}
+
+void updateMaterials(const SceneAssets& assets, const std::vector<asset::Material>& mats)
+{
+  for (auto& mat : mats) {
+    if (!mat._id) {
+      printf("Asset update fail: cannot update material with invalid id\n");
+      continue;
+    }
+
+    auto it = assets._materialIdMap.find(mat._id);
+    if (it == assets._materialIdMap.end()) {
+      printf("Could not update material %s, doesn't exist!\n", mat._id.str().c_str());
+      continue;
+    }
+
+    setMaterial(assets._materials[it->second], mat);
+  }
+}
+
+void removeMaterials(const SceneAssets& assets, const std::vector<util::Uuid>& ids)
+{
+  if (ids.empty()) {
+    return;
+  }
+
+  for (auto& id : ids) {
+    auto it = std::find_if(assets._materials.begin(), assets._materials.end(),
+      [&id](InternalMaterial& m) { return m._id == id; });
+
+    if (it != assets._materials.end()) {
+      assets._materials.erase(it);
+    }
+  }
+
+  rebuildIdMap(assets._materials, assets._materialIdMap);
+}
+
+}
@@ -0,0 +1,184 @@
+#pragma once
+
+#include "BufferMemoryInterface.h"
+#include "InternalLight.h"
+#include "InternalMaterial.h"
+#include "InternalMesh.h"
+#include "InternalModel.h"
+#include "InternalRenderable.h"
+#include "InternalTexture.h"
+#include "../GpuBuffers.h"
+#include "../asset/Material.h"
+#include "../asset/Model.h"
+#include "../../component/Components.h"
+#include "../../component/Registry.h"
+#include "../../util/Uuid.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace render::internal {
+
+/*
+* CPU-side management of the assets, renderables, lights and skeletons that renderers keep.
+* Shared by VulkanRenderer and NullRenderContext, so that both keep their vectors and id maps the same way
+* and fill their GPU buffers with the same contents. Makes no Vulkan calls, what ends up on the GPU
+* (and when memory can be given back) is up to the renderer.
+*/
+
+// The asset vectors and id maps of a renderer. Only holds references, like a span a const one still allows changes.
+struct SceneAssets
+{
+  std::vector<InternalModel>& _models;
+  std::vector<InternalMesh>& _meshes;
+  std::vector<InternalMaterial>& _materials;
+  std::vector<InternalTexture>& _textures;
+
+  std::unordered_map<util::Uuid, std::size_t>& _modelIdMap;
+  std::unordered_map<util::Uuid, std::size_t>& _meshIdMap;
+  std::unordered_map<util::Uuid, std::size_t>& _materialIdMap;
+  std::unordered_map<util::Uuid, std::size_t>& _textureIdMap;
+};
+
+// The renderables, lights and skeleton slots a renderer keeps for scene nodes. Only holds references, like SceneAssets.
+struct SceneNodes
+{
+  std::vector<InternalRenderable>& _renderables;
+  std::vector<InternalRenderable>& _pending; // Added, but not uploaded until their assets are
+  std::unordered_map<util::Uuid, std::size_t>& _renderableIdMap;
+
+  std::vector<InternalLight>& _lights;
+  std::span<util::Uuid> _shadowCasters;
+
+  BufferMemoryInterface& _skeletonMemIf; // In matrices, not bytes
+  std::unordered_map<util::Uuid, BufferMemoryInterface::Handle>& _skeletonOffsets;
+
+  std::size_t _maxRenderables;
+};
+
+// Renderer specific work for renderables that come and go with their nodes
+struct NodeHooks
+{
+  // Called before a new renderable goes pending, returning false drops it
+  std::function<bool(InternalRenderable&)> _added;
+
+  // Called before a paged out renderable is erased, whether it was current or still pending
+  std::function<void(InternalRenderable&)> _removed;
+};
+
+struct NodeChanges
+{
+  bool _renderables = false;
+  bool _lights = false;
+};
+
+// id -> index for a vector of things with an _id
+template <typename T>
+void rebuildIdMap(const std::vector<T>& vec, std::unordered_map<util::Uuid, std::size_t>& idMap)
+{
+  idMap.clear();
+
+  for (std::size_t i = 0; i < vec.size(); ++i) {
+    idMap[vec[i]._id] = i;
+  }
+}
+
+// Keeps the order of the others, and their indices in idMap valid. False if id isn't in idMap.
+bool eraseRenderable(
+  std::vector<InternalRenderable>& renderables,
+  std::unordered_map<util::Uuid, std::size_t>& idMap,
+  const util::Uuid& id);
+
+// nullptr if id isn't pending
+InternalRenderable* findPendingRenderable(std::vector<InternalRenderable>& pending, const util::Uuid& id);
+
+void setRenderableNode(InternalRenderable& rend, const component::Renderable& comp, const glm::mat4& globalTransform);
+
+// Adds, updates or, if the node isn't paged, removes the light of node id.
+// Shadow casters take the first free slot in shadowCasters and give it back when they stop casting.
+void updateLight(
+  std::vector<InternalLight>& lights,
+  std::span<util::Uuid> shadowCasters,
+  const util::Uuid& id,
+  component::Light& light,
+  const glm::vec3& pos,
+  bool paged);
+
+// Index into lights of every shadow caster slot, -1 if the slot is empty
+std::vector<int> shadowCasterLightIndices(const std::vector<InternalLight>& lights, std::span<const util::Uuid> shadowCasters);
+
+// Adds, updates and removes the renderables and lights of every node the observer saw, then clears it.
+// Paged out nodes give back their skeleton slot.
+NodeChanges updateObservedNodes(
+  component::Registry& registry,
+  entt::observer& observer,
+  const SceneNodes& nodes,
+  const NodeHooks& hooks = NodeHooks());
+
+// Offset in matrices of the joints of node, the slot is made on first use. 0 if it doesn't fit.
+std::uint32_t getOrCreateSkeletonOffset(const SceneNodes& nodes, const util::Uuid& node, std::size_t numJoints);
+
+// Writes the joint matrices of every paged skeleton into its slot of skeletons, relative to its renderable.
+void updateSkeletons(component::Registry& registry, const SceneNodes& nodes, std::span<glm::mat4> skeletons);
+
+// Whether everything needed to draw it is in the id maps
+bool arePrerequisitesUploaded(const SceneAssets& assets, const InternalModel& model);
+bool arePrerequisitesUploaded(const SceneAssets& assets, const InternalRenderable& rend);
+bool arePrerequisitesUploaded(const SceneAssets& assets, const InternalMaterial& mat);
+
+// Pending renderables with all prerequisites uploaded become current
+void promotePendingRenderables(const SceneAssets& assets, const SceneNodes& nodes);
+
+// Mesh indices of the model of every uploaded renderable, pending ones first. Sets their _modelBufferOffset.
+// With dynamicMeshes the ray tracing copies of animated meshes follow, at _dynamicModelBufferOffset.
+void fillModelBuffer(const SceneAssets& assets, const SceneNodes& nodes, bool dynamicMeshes, std::vector<std::uint32_t>& out);
+
+// Material indices of every uploaded renderable, pending ones first. Sets their _materialIndexBufferIndex.
+void fillRendMatIdxBuffer(const SceneAssets& assets, const SceneNodes& nodes, std::vector<std::uint32_t>& out);
+
+// One entry per current renderable, those missing prerequisites are left as they are.
+// Also counts the uploaded renderables using each mesh into meshUsage.
+void fillRenderableBuffer(
+  const SceneAssets& assets,
+  const SceneNodes& nodes,
+  const std::unordered_map<util::Uuid, std::size_t>& terrainIdMap,
+  std::unordered_map<util::Uuid, std::size_t>& meshUsage,
+  gpu::GPURenderable* out);
+
+// One entry per mesh
+void fillMeshBuffer(const std::vector<InternalMesh>& meshes, gpu::GPUMeshInfo* out);
+
+// One entry per material, those missing textures are left as they are
+void fillMaterialBuffer(const SceneAssets& assets, gpu::GPUMaterialInfo* out);
+
+// Lights past the last one are disabled
+void fillLightBuffer(const std::vector<InternalLight>& lights, std::span<gpu::GPULight> out);
+
+// Adds the model with the ids of its meshes, which count as uploaded once they are in the mesh id map.
+// False if the model can't be added.
+bool addModel(const SceneAssets& assets, const asset::Model& model, std::size_t maxMeshes);
+
+// Removes the models and their meshes, releaseMesh gives back whatever the renderer holds for a mesh
+void removeModels(
+  const SceneAssets& assets,
+  const std::vector<util::Uuid>& ids,
+  const std::function<void(InternalMesh&)>& releaseMesh);
+
+// releaseTexture gives back whatever the renderer holds for a texture
+void removeTextures(
+  const SceneAssets& assets,
+  const std::vector<util::Uuid>& ids,
+  const std::function<void(InternalTexture&)>& releaseTexture);
+
+// False if the material can't be added
+bool addMaterial(const SceneAssets& assets, const asset::Material& mat, std::size_t maxMaterials);
+void updateMaterials(const SceneAssets& assets, const std::vector<asset::Material>& mats);
+void removeMaterials(const SceneAssets& assets, const std::vector<util::Uuid>& ids);
+
+}
@@ -2,12 +2,17 @@
 
 #include "../AllocatedBuffer.h"
 
+#include <cstdint>
+
 namespace render::internal {
 
 struct StagingBuffer
 {
   AllocatedBuffer _buf;
 
+  // Persistently mapped
+  std::uint8_t* _mappedData = nullptr;
+
   std::size_t _size = 0;
   std::size_t _currentOffset = 0;
   std::size_t _emergencyReserve = 0;
@@ -0,0 +1,237 @@
+#include "TextureResidency.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+
+namespace render::internal {
+
+TextureResidency::TextureResidency(std::size_t budgetBytes, std::uint32_t maxRequestsPerUpdate, std::uint32_t evictDelayFrames)
+  : _budget(budgetBytes)
+  , _maxRequests(maxRequestsPerUpdate)
+  , _evictDelay(evictDelayFrames)
+{}
+
+void TextureResidency::addTexture(const util::Uuid& id, std::uint32_t size, std::vector<std::size_t> mipBytes, std::uint32_t tailMip)
+{
+  if (mipBytes.empty()) {
+    printf("TextureResidency cannot add texture %s without mips!\n", id.str().c_str());
+    return;
+  }
+
+  Entry entry{};
+  entry._id = id;
+  entry._size = size;
+  entry._tailMip = std::min(tailMip, (std::uint32_t)mipBytes.size() - 1);
+  entry._residentMip = entry._tailMip;
+  entry._pendingMip = entry._tailMip;
+  entry._wantedMip = entry._tailMip;
+  entry._lastNeededFrame = _frame;
+
+  // Suffix sums, so that the resident size of any first mip is a lookup
+  entry._chainBytes.resize(mipBytes.size());
+  std::size_t sum = 0;
+  for (std::size_t i = mipBytes.size(); i-- > 0;) {
+    sum += mipBytes[i];
+    entry._chainBytes[i] = sum;
+  }
+
+  if (_idMap.contains(id)) {
+    _entries[_idMap[id]] = std::move(entry);
+    return;
+  }
+
+  _idMap[id] = _entries.size();
+  _entries.emplace_back(std::move(entry));
+}
+
+void TextureResidency::removeTexture(const util::Uuid& id)
+{
+  auto it = _idMap.find(id);
+  if (it == _idMap.end()) {
+    return;
+  }
+
+  std::size_t idx = it->second;
+  _idMap.erase(it);
+
+  if (idx != _entries.size() - 1) {
+    _entries[idx] = std::move(_entries.back());
+    _idMap[_entries[idx]._id] = idx;
+  }
+  _entries.pop_back();
+}
+
+bool TextureResidency::contains(const util::Uuid& id) const
+{
+  return _idMap.contains(id);
+}
+
+void TextureResidency::setResident(const util::Uuid& id, std::uint32_t firstMip)
+{
+  auto it = _idMap.find(id);
+  if (it == _idMap.end()) {
+    return;
+  }
+
+  auto& e = _entries[it->second];
+  e._residentMip = std::min(firstMip, e._tailMip);
+  e._pendingMip = e._residentMip;
+  e._lastNeededFrame = _frame;
+}
+
+void TextureResidency::requestMip(const util::Uuid& id, float mip)
+{
+  auto it = _idMap.find(id);
+  if (it == _idMap.end()) {
+    return;
+  }
+
+  auto& e = _entries[it->second];
+  std::uint32_t m = mip <= 0.0f ? 0 : (std::uint32_t)std::min(std::floor(mip), (float)e._tailMip);
+  e._wantedMip = std::min(e._wantedMip, m);
+}
+
+void TextureResidency::requestPixels(const util::Uuid& id, float pixels)
+{
+  auto it = _idMap.find(id);
+  if (it == _idMap.end()) {
+    return;
+  }
+
+  if (pixels <= 0.0f) {
+    // Nothing visible, the tail will do
+    return;
+  }
+
+  requestMip(id, std::log2((float)_entries[it->second]._size / pixels));
+}
+
+std::vector<TextureResidency::Request> TextureResidency::update()
+{
+  std::vector<Request> out;
+  _frame++;
+
+  // While a request is in flight, count the finer of the two
+  std::size_t committed = 0;
+  std::vector<Entry*> upgrades;
+  std::vector<Entry*> droppable;
+
+  for (auto& e : _entries) {
+    committed += bytes(e, std::min(e._residentMip, e._pendingMip));
+
+    if (e._wantedMip <= e._residentMip) {
+      e._lastNeededFrame = _frame;
+    }
+
+    if (e._pendingMip != e._residentMip) {
+      continue;
+    }
+
+    if (e._wantedMip < e._residentMip) {
+      upgrades.emplace_back(&e);
+    }
+    else if (e._wantedMip > e._residentMip) {
+      droppable.emplace_back(&e);
+    }
+  }
+
+  // Biggest improvement first, then cheapest
+  std::sort(upgrades.begin(), upgrades.end(), [this](const Entry* a, const Entry* b) {
+    auto da = a->_residentMip - a->_wantedMip;
+    auto db = b->_residentMip - b->_wantedMip;
+    if (da != db) return da > db;
+    return bytes(*a, a->_wantedMip) - bytes(*a, a->_residentMip) < bytes(*b, b->_wantedMip) - bytes(*b, b->_residentMip);
+  });
+
+  // Least recently needed first
+  std::sort(droppable.begin(), droppable.end(), [](const Entry* a, const Entry* b) {
+    return a->_lastNeededFrame < b->_lastNeededFrame;
+  });
+
+  auto fits = [&](std::size_t extra) {
+    return _budget == 0 || committed + extra <= _budget;
+  };
+
+  auto drop = [&](Entry& e) {
+    committed -= bytes(e, e._residentMip) - bytes(e, e._wantedMip);
+    e._pendingMip = e._wantedMip;
+    out.emplace_back(Request{ e._id, e._wantedMip });
+  };
+
+  std::size_t nextDrop = 0;
+
+  for (auto* e : upgrades) {
+    if (out.size() >= _maxRequests) {
+      break;
+    }
+
+    // Make room by dropping detail that isn't needed this frame. Needed detail is never evicted,
+    // so the budget only limits how far textures are streamed up.
+    while (!fits(bytes(*e, e->_wantedMip) - bytes(*e, e->_residentMip)) &&
+           nextDrop < droppable.size() &&
+           out.size() + 1 < _maxRequests) {
+      drop(*droppable[nextDrop++]);
+    }
+
+    // Settle for a coarser mip if the wanted one still doesn't fit
+    std::uint32_t target = e->_wantedMip;
+    while (target < e->_residentMip && !fits(bytes(*e, target) - bytes(*e, e->_residentMip))) {
+      target++;
+    }
+
+    if (target == e->_residentMip) {
+      continue;
+    }
+
+    committed += bytes(*e, target) - bytes(*e, e->_residentMip);
+    e->_pendingMip = target;
+    out.emplace_back(Request{ e->_id, target });
+  }
+
+  // Drop detail that hasn't been needed for a while, even if there is budget for it
+  for (; nextDrop < droppable.size() && out.size() < _maxRequests; ++nextDrop) {
+    auto* e = droppable[nextDrop];
+    if (_frame - e->_lastNeededFrame < _evictDelay) {
+      break;
+    }
+    drop(*e);
+  }
+
+  // New frame, nothing reported yet
+  for (auto& e : _entries) {
+    e._wantedMip = e._tailMip;
+  }
+
+  return out;
+}
+
+std::uint32_t TextureResidency::residentMip(const util::Uuid& id) const
+{
+  auto it = _idMap.find(id);
+  if (it == _idMap.end()) {
+    return 0;
+  }
+  return _entries[it->second]._residentMip;
+}
+
+std::size_t TextureResidency::residentBytes() const
+{
+  std::size_t sum = 0;
+  for (auto& e : _entries) {
+    sum += bytes(e, e._residentMip);
+  }
+  return sum;
+}
+
+float TextureResidency::projectedPixels(float worldSize, float distance, float projScale, float screenHeight)
+{
+  if (distance <= 0.0f) {
+    return std::numeric_limits<float>::max();
+  }
+
+  return worldSize * projScale * screenHeight / (2.0f * distance);
+}
+
+}
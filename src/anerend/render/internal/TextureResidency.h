@@ -0,0 +1,84 @@
+#pragma once
+
+#include "../../util/Uuid.h"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace render::internal {
+
+/*
+  Residency policy for mip streaming. Textures start out with only their tail (smallest mips) resident.
+  Each frame the renderer reports which mip every texture in use needs, and update() decides which textures
+  to stream up to finer mips and which to drop back to coarser ones, keeping the resident bytes within a budget.
+  Residency is expressed as the finest resident mip, everything coarser than it is always resident too.
+  Has no Vulkan dependencies.
+*/
+class TextureResidency
+{
+public:
+  struct Request
+  {
+    util::Uuid _id;
+    std::uint32_t _firstMip = 0; // Finest mip that should be resident
+  };
+
+  // A budget of 0 means unlimited.
+  // Textures are dropped back evictDelayFrames after their finest resident mip was last needed,
+  // or earlier if the budget requires it.
+  TextureResidency(std::size_t budgetBytes = 0, std::uint32_t maxRequestsPerUpdate = 4, std::uint32_t evictDelayFrames = 120);
+
+  void setBudget(std::size_t budgetBytes) { _budget = budgetBytes; }
+  std::size_t budget() const { return _budget; }
+
+  // size is the largest dimension of mip 0, mipBytes holds the size of every mip of the full chain.
+  // tailMip is the mip that is resident now, and also the coarsest the texture will ever be dropped back to.
+  void addTexture(const util::Uuid& id, std::uint32_t size, std::vector<std::size_t> mipBytes, std::uint32_t tailMip);
+  void removeTexture(const util::Uuid& id);
+  bool contains(const util::Uuid& id) const;
+
+  // Call when a requested mip range has been uploaded and is in use.
+  void setResident(const util::Uuid& id, std::uint32_t firstMip);
+
+  // Reports that a texture needs the given (fractional) mip this frame. The finest report of a frame is used.
+  void requestMip(const util::Uuid& id, float mip);
+
+  // Reports that a texture covers about this many pixels along its largest dimension, i.e. wants one texel per pixel.
+  void requestPixels(const util::Uuid& id, float pixels);
+
+  // Decides on loads and evictions and returns them, and starts a new frame.
+  // A texture with a request in flight gets no new request until setResident() is called for it.
+  std::vector<Request> update();
+
+  std::uint32_t residentMip(const util::Uuid& id) const;
+  std::size_t residentBytes() const;
+
+  // Pixels covered by worldSize units at the given distance. projScale is proj[1][1] of the camera (1 / tan(fovy / 2)).
+  static float projectedPixels(float worldSize, float distance, float projScale, float screenHeight);
+
+private:
+  struct Entry
+  {
+    util::Uuid _id;
+    std::uint32_t _size = 0;
+    std::vector<std::size_t> _chainBytes; // _chainBytes[m] is the size of mips m to the end of the chain
+    std::uint32_t _tailMip = 0;
+    std::uint32_t _residentMip = 0;
+    std::uint32_t _pendingMip = 0; // Equal to _residentMip if nothing is in flight
+    std::uint32_t _wantedMip = 0;  // Finest mip reported this frame
+    std::uint64_t _lastNeededFrame = 0;
+  };
+
+  std::size_t bytes(const Entry& e, std::uint32_t mip) const { return e._chainBytes[mip]; }
+
+  std::vector<Entry> _entries;
+  std::unordered_map<util::Uuid, std::size_t> _idMap;
+
+  std::size_t _budget;
+  std::uint32_t _maxRequests;
+  std::uint32_t _evictDelay;
+  std::uint64_t _frame = 0;
+};
+
+}
@@ -0,0 +1,366 @@
+#include "TransferUploader.h"
+
+#include "../BufferHelpers.h"
+#include "UploadContext.h"
+#include "UploadPlanner.h"
+#include "UploadQueue.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+namespace render::internal {
+
+TransferUploader::TransferUploader()
+{}
+
+TransferUploader::~TransferUploader()
+{}
+
+bool TransferUploader::init(
+  VkDevice device,
+  VmaAllocator vmaAllocator,
+  VkQueue transferQueue,
+  std::uint32_t transferFamily,
+  std::uint32_t graphicsFamily)
+{
+  if (transferFamily == graphicsFamily) {
+    printf("Transfer queue family is the same as graphics, not using transfer uploads\n");
+    return false;
+  }
+
+  VkCommandPoolCreateInfo poolInfo{};
+  poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+  poolInfo.queueFamilyIndex = transferFamily;
+
+  if (vkCreateCommandPool(device, &poolInfo, nullptr, &_commandPool) != VK_SUCCESS) {
+    printf("Could not create transfer command pool!\n");
+    return false;
+  }
+
+  VkSemaphoreTypeCreateInfo typeInfo{};
+  typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+  typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+  typeInfo.initialValue = 0;
+
+  VkSemaphoreCreateInfo semInfo{};
+  semInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+  semInfo.pNext = &typeInfo;
+
+  if (vkCreateSemaphore(device, &semInfo, nullptr, &_timelineSemaphore) != VK_SUCCESS) {
+    printf("Could not create transfer timeline semaphore!\n");
+    vkDestroyCommandPool(device, _commandPool, nullptr);
+    _commandPool = VK_NULL_HANDLE;
+    return false;
+  }
+
+  _device = device;
+  _vmaAllocator = vmaAllocator;
+  _transferQ = transferQueue;
+  _transferFamily = transferFamily;
+  _graphicsFamily = graphicsFamily;
+
+  _batches.resize(NUM_BATCHES);
+  for (auto& batch : _batches) {
+    bufferutil::createBuffer(
+      _vmaAllocator,
+      STAGING_SIZE_MB * 1024 * 1024,
+      VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+      VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT,
+      batch._stagingBuffer);
+
+    VmaAllocationInfo allocInfo{};
+    vmaGetAllocationInfo(_vmaAllocator, batch._stagingBuffer._allocation, &allocInfo);
+    batch._mappedData = (std::uint8_t*)allocInfo.pMappedData;
+
+    VkCommandBufferAllocateInfo cmdAllocInfo{};
+    cmdAllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    cmdAllocInfo.commandPool = _commandPool;
+    cmdAllocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    cmdAllocInfo.commandBufferCount = 1;
+    vkAllocateCommandBuffers(_device, &cmdAllocInfo, &batch._cmdBuf);
+  }
+
+  _lastRefill = std::chrono::steady_clock::now();
+
+  return true;
+}
+
+void TransferUploader::cleanup()
+{
+  if (!_device) {
+    return;
+  }
+
+  vkQueueWaitIdle(_transferQ);
+
+  for (auto& batch : _batches) {
+    // Textures that never made it to the graphics side
+    for (auto& tex : batch._textures) {
+      vkDestroyImageView(_device, tex._bindlessInfo._view, nullptr);
+      vkDestroySampler(_device, tex._bindlessInfo._sampler, nullptr);
+      vmaDestroyImage(_vmaAllocator, tex._bindlessInfo._image._image, tex._bindlessInfo._image._allocation);
+    }
+
+    vmaDestroyBuffer(_vmaAllocator, batch._stagingBuffer._buffer, batch._stagingBuffer._allocation);
+  }
+  _batches.clear();
+  _texturesToUpload.clear();
+
+  vkDestroyCommandPool(_device, _commandPool, nullptr);
+  vkDestroySemaphore(_device, _timelineSemaphore, nullptr);
+
+  _commandPool = VK_NULL_HANDLE;
+  _timelineSemaphore = VK_NULL_HANDLE;
+  _device = VK_NULL_HANDLE;
+}
+
+std::size_t TransferUploader::maxUploadSize() const
+{
+  return STAGING_SIZE_MB * 1024 * 1024;
+}
+
+bool TransferUploader::add(asset::Texture&& textureToUpload)
+{
+  if (UploadQueue::textureStagingSize(textureToUpload) > maxUploadSize()) {
+    return false;
+  }
+
+  _texturesToUpload.emplace_back(std::move(textureToUpload));
+  return true;
+}
+
+void TransferUploader::submit(UploadContext* uc)
+{
+  if (!_device || _texturesToUpload.empty()) {
+    return;
+  }
+
+  // Refill the budget, allowing at most one staging buffer worth of burst
+  auto now = std::chrono::steady_clock::now();
+  double elapsed = std::chrono::duration<double>(now - _lastRefill).count();
+  _lastRefill = now;
+  _availableBytes = std::min(_availableBytes + elapsed * _bytesPerSecond, (double)maxUploadSize());
+
+  if (_availableBytes <= 0.0) {
+    return;
+  }
+
+  auto batchIt = std::find_if(_batches.begin(), _batches.end(), [](const Batch& b) { return !b._inFlight; });
+  if (batchIt == _batches.end()) {
+    return;
+  }
+
+  auto& batch = *batchIt;
+  const auto alignment = UploadQueue::stagingAlignment();
+  UploadPlanner planner(0, maxUploadSize(), (std::size_t)_availableBytes);
+
+  struct ImageCopy
+  {
+    VkImage _image;
+    std::vector<VkBufferImageCopy> _copies;
+  };
+
+  std::vector<ImageCopy> imageCopies;
+  std::vector<VkImageMemoryBarrier> preCopyBarriers;
+  std::vector<VkImageMemoryBarrier> releaseBarriers;
+
+  while (!_texturesToUpload.empty()) {
+    auto& tex = _texturesToUpload.front();
+
+    // add() only takes textures that fit a staging buffer
+    auto stagingSize = UploadQueue::textureStagingSize(tex);
+    assert(stagingSize <= maxUploadSize() && "Texture too big for transfer uploads");
+
+    if (!planner.fits(stagingSize, alignment)) {
+      break;
+    }
+
+    InternalTexture internalTex{};
+    internalTex._id = tex._id;
+    internalTex._firstMip = tex._firstMip;
+    UploadQueue::createTexture(
+      uc->getRC(),
+      tex,
+      internalTex._bindlessInfo._sampler,
+      internalTex._bindlessInfo._image,
+      internalTex._bindlessInfo._view);
+
+    ImageCopy imageCopy{};
+    imageCopy._image = internalTex._bindlessInfo._image._image;
+
+    auto rollingOffset = (std::size_t)planner.reserve(stagingSize, alignment);
+    uint32_t mipWidth = tex._width;
+    uint32_t mipHeight = tex._height;
+    for (unsigned i = 0; i < tex._numMips; ++i) {
+      std::memcpy(batch._mappedData + rollingOffset, tex._data[i].data(), tex._data[i].size());
+
+      VkBufferImageCopy imCopy{};
+      imCopy.bufferOffset = rollingOffset;
+      imCopy.imageExtent = VkExtent3D{ mipWidth, mipHeight, 1 };
+      imCopy.imageOffset = VkOffset3D{};
+      imCopy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+      imCopy.imageSubresource.layerCount = 1;
+      imCopy.imageSubresource.mipLevel = i;
+      imageCopy._copies.emplace_back(std::move(imCopy));
+
+      rollingOffset += UploadPlanner::alignUp(tex._data[i].size(), alignment);
+      if (mipWidth > 1) mipWidth /= 2;
+      if (mipHeight > 1) mipHeight /= 2;
+    }
+
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.image = imageCopy._image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = tex._numMips;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    preCopyBarriers.emplace_back(barrier);
+
+    // Release and acquire have to match exactly, apart from the access masks.
+    // The layout transition happens once, as part of the ownership transfer.
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcQueueFamilyIndex = _transferFamily;
+    barrier.dstQueueFamilyIndex = _graphicsFamily;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = 0;
+    releaseBarriers.emplace_back(barrier);
+
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    batch._acquireBarriers.emplace_back(barrier);
+
+    batch._textures.emplace_back(std::move(internalTex));
+    imageCopies.emplace_back(std::move(imageCopy));
+    _texturesToUpload.pop_front();
+  }
+
+  if (imageCopies.empty()) {
+    return;
+  }
+
+  vkResetCommandBuffer(batch._cmdBuf, 0);
+
+  VkCommandBufferBeginInfo beginInfo{};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  vkBeginCommandBuffer(batch._cmdBuf, &beginInfo);
+
+  vkCmdPipelineBarrier(
+    batch._cmdBuf,
+    VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+    VK_PIPELINE_STAGE_TRANSFER_BIT,
+    0, 0, nullptr,
+    0, nullptr,
+    (uint32_t)preCopyBarriers.size(), preCopyBarriers.data());
+
+  for (auto& imageCopy : imageCopies) {
+    vkCmdCopyBufferToImage(
+      batch._cmdBuf,
+      batch._stagingBuffer._buffer,
+      imageCopy._image,
+      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+      (uint32_t)imageCopy._copies.size(),
+      imageCopy._copies.data());
+  }
+
+  vkCmdPipelineBarrier(
+    batch._cmdBuf,
+    VK_PIPELINE_STAGE_TRANSFER_BIT,
+    VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+    0, 0, nullptr,
+    0, nullptr,
+    (uint32_t)releaseBarriers.size(), releaseBarriers.data());
+
+  vkEndCommandBuffer(batch._cmdBuf);
+
+  batch._timelineValue = ++_lastSignalledValue;
+
+  VkTimelineSemaphoreSubmitInfo timelineInfo{};
+  timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+  timelineInfo.signalSemaphoreValueCount = 1;
+  timelineInfo.pSignalSemaphoreValues = &batch._timelineValue;
+
+  VkSubmitInfo submitInfo{};
+  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submitInfo.pNext = &timelineInfo;
+  submitInfo.commandBufferCount = 1;
+  submitInfo.pCommandBuffers = &batch._cmdBuf;
+  submitInfo.signalSemaphoreCount = 1;
+  submitInfo.pSignalSemaphores = &_timelineSemaphore;
+
+  if (vkQueueSubmit(_transferQ, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+    printf("Could not submit transfer uploads!\n");
+  }
+
+  batch._inFlight = true;
+  _availableBytes -= (double)planner.bytesPlanned();
+}
+
+std::uint64_t TransferUploader::acquire(UploadContext* uc, VkCommandBuffer cmdBuf)
+{
+  if (!_device) {
+    return 0;
+  }
+
+  std::uint64_t completedValue = 0;
+  vkGetSemaphoreCounterValue(_device, _timelineSemaphore, &completedValue);
+
+  std::uint64_t waitValue = 0;
+  std::vector<VkImageMemoryBarrier> acquireBarriers;
+  std::vector<InternalTexture> textures;
+
+  for (auto& batch : _batches) {
+    if (!batch._inFlight || batch._timelineValue > completedValue) {
+      continue;
+    }
+
+    acquireBarriers.insert(acquireBarriers.end(), batch._acquireBarriers.begin(), batch._acquireBarriers.end());
+    for (auto& tex : batch._textures) {
+      textures.emplace_back(std::move(tex));
+    }
+
+    waitValue = std::max(waitValue, batch._timelineValue);
+
+    // The staging buffer is free to use again
+    batch._acquireBarriers.clear();
+    batch._textures.clear();
+    batch._inFlight = false;
+  }
+
+  if (acquireBarriers.empty()) {
+    return 0;
+  }
+
+  VkPipelineStageFlags dstStages = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+  if (uc->rayTracingEnabled()) {
+    dstStages |= VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR;
+  }
+
+  vkCmdPipelineBarrier(
+    cmdBuf,
+    VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+    dstStages,
+    0, 0, nullptr,
+    0, nullptr,
+    (uint32_t)acquireBarriers.size(), acquireBarriers.data());
+
+  for (auto& tex : textures) {
+    uc->textureUploadedCB(std::move(tex));
+  }
+
+  return waitValue;
+}
+
+}
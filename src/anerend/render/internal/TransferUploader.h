@@ -0,0 +1,102 @@
+#pragma once
+
+#include "../asset/Texture.h"
+
+#include "../AllocatedBuffer.h"
+#include "InternalTexture.h"
+
+#include <vulkan/vulkan.h>
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+namespace render::internal {
+
+class UploadContext;
+
+/*
+  Uploads textures in the background on a dedicated transfer queue.
+  Each batch is recorded on the transfer queue with a queue family ownership release, and signals
+  a timeline semaphore when done. Once the graphics side sees that a batch has completed it records the
+  matching acquire barriers, and waits for the timeline value when submitting the frame.
+  Uploads are limited by a bandwidth budget so that streaming doesn't starve rendering of memory bandwidth.
+*/
+class TransferUploader
+{
+public:
+  TransferUploader();
+  ~TransferUploader();
+
+  TransferUploader(const TransferUploader&) = delete;
+  TransferUploader(TransferUploader&&) = delete;
+  TransferUploader& operator=(const TransferUploader&) = delete;
+  TransferUploader& operator=(TransferUploader&&) = delete;
+
+  explicit operator bool() const { return _device != VK_NULL_HANDLE; }
+
+  bool init(
+    VkDevice device,
+    VmaAllocator vmaAllocator,
+    VkQueue transferQueue,
+    std::uint32_t transferFamily,
+    std::uint32_t graphicsFamily);
+  void cleanup();
+
+  void setBandwidth(double bytesPerSecond) { _bytesPerSecond = bytesPerSecond; }
+
+  // Textures bigger than this have to go through the regular upload queue.
+  std::size_t maxUploadSize() const;
+
+  // False if the texture is bigger than maxUploadSize(), it is then left untouched for the caller to upload some other way.
+  bool add(asset::Texture&& textureToUpload);
+
+  // Records and submits a batch on the transfer queue, if a batch is free and there is budget left.
+  void submit(UploadContext* uc);
+
+  // Records the acquire barriers for all batches that have finished, and hands the textures to the upload context.
+  // Returns the timeline value that the graphics submission must wait for, or 0 if nothing was acquired.
+  std::uint64_t acquire(UploadContext* uc, VkCommandBuffer cmdBuf);
+
+  VkSemaphore timelineSemaphore() const { return _timelineSemaphore; }
+
+private:
+  static const std::size_t NUM_BATCHES = 3;
+  static const std::size_t STAGING_SIZE_MB = 32;
+
+  struct Batch
+  {
+    AllocatedBuffer _stagingBuffer;
+    std::uint8_t* _mappedData = nullptr;
+
+    VkCommandBuffer _cmdBuf = VK_NULL_HANDLE;
+
+    // Submitted but not yet acquired on the graphics side
+    bool _inFlight = false;
+    std::uint64_t _timelineValue = 0;
+
+    std::vector<InternalTexture> _textures;
+    std::vector<VkImageMemoryBarrier> _acquireBarriers;
+  };
+
+  std::vector<Batch> _batches;
+  std::deque<asset::Texture> _texturesToUpload;
+
+  VkDevice _device = VK_NULL_HANDLE;
+  VmaAllocator _vmaAllocator = nullptr;
+  VkQueue _transferQ = VK_NULL_HANDLE;
+  std::uint32_t _transferFamily = 0;
+  std::uint32_t _graphicsFamily = 0;
+
+  VkCommandPool _commandPool = VK_NULL_HANDLE;
+  VkSemaphore _timelineSemaphore = VK_NULL_HANDLE;
+  std::uint64_t _lastSignalledValue = 0;
+
+  // Token bucket for the bandwidth budget
+  double _bytesPerSecond = 256.0 * 1024.0 * 1024.0;
+  double _availableBytes = 0.0;
+  std::chrono::steady_clock::time_point _lastRefill;
+};
+
+}
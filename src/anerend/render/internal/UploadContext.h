@@ -20,6 +20,7 @@ public:
   virtual GigaBuffer& getVtxBuffer() = 0;
   virtual GigaBuffer& getIdxBuffer() = 0;
   virtual RenderContext* getRC() = 0;
+  virtual bool rayTracingEnabled() = 0;
 
   virtual void textureUploadedCB(InternalTexture tex) = 0;
   virtual void modelMeshUploadedCB(InternalMesh mesh, VkCommandBuffer cmdBuf) = 0;
@@ -0,0 +1,76 @@
+#include "UploadPlanner.h"
+
+#include <algorithm>
+
+namespace render::internal {
+
+UploadPlanner::UploadPlanner(std::size_t stagingOffset, std::size_t stagingEnd, std::size_t byteBudget)
+  : _offset(stagingOffset)
+  , _end(stagingEnd)
+  , _budget(byteBudget)
+{}
+
+bool UploadPlanner::fits(std::size_t size, std::size_t alignment, std::size_t stagedBytes) const
+{
+  if (alignUp(_offset, alignment) + size > _end) {
+    return false;
+  }
+
+  bool first = _bytesPlanned == 0 && stagedBytes == 0;
+  if (!first && _bytesPlanned + size > _budget) {
+    return false;
+  }
+
+  return true;
+}
+
+std::int64_t UploadPlanner::reserve(std::size_t size, std::size_t alignment)
+{
+  if (!fits(size, alignment)) {
+    return -1;
+  }
+
+  auto offset = alignUp(_offset, alignment);
+  _offset = offset + size;
+  _bytesPlanned += size;
+
+  return (std::int64_t)offset;
+}
+
+void UploadPlanner::coalesce(std::vector<CopyRegion>& regions)
+{
+  if (regions.size() < 2) {
+    return;
+  }
+
+  std::sort(regions.begin(), regions.end(), [](const CopyRegion& a, const CopyRegion& b) {
+    return a._dstOffset < b._dstOffset;
+  });
+
+  std::size_t out = 0;
+  for (std::size_t i = 1; i < regions.size(); ++i) {
+    auto& last = regions[out];
+    auto& curr = regions[i];
+
+    if (last._srcOffset + last._size == curr._srcOffset &&
+        last._dstOffset + last._size == curr._dstOffset) {
+      last._size += curr._size;
+    }
+    else {
+      regions[++out] = curr;
+    }
+  }
+
+  regions.resize(out + 1);
+}
+
+std::size_t UploadPlanner::alignUp(std::size_t offset, std::size_t alignment)
+{
+  if (alignment <= 1) {
+    return offset;
+  }
+
+  return (offset + alignment - 1) / alignment * alignment;
+}
+
+}
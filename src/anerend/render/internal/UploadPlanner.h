@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace render::internal {
+
+/*
+  Plans where upload data goes in the staging buffer for one frame.
+  Keeps track of the staging space and a per-frame byte budget, so that a big
+  batch of uploads is spread over several frames instead of causing a spike.
+  Has no Vulkan dependencies.
+*/
+class UploadPlanner
+{
+public:
+  struct CopyRegion
+  {
+    std::size_t _srcOffset = 0;
+    std::size_t _dstOffset = 0;
+    std::size_t _size = 0;
+  };
+
+  UploadPlanner(std::size_t stagingOffset, std::size_t stagingEnd, std::size_t byteBudget);
+
+  // The first reservation of a frame is allowed to go over budget (but not over the staging space),
+  // otherwise anything bigger than the budget would never be uploaded.
+  // When a batch of items is reserved at once, size is the whole batch so far and stagedBytes is the part of it
+  // that was already accepted. Only the first item of the batch then gets to go over budget.
+  bool fits(std::size_t size, std::size_t alignment = 1, std::size_t stagedBytes = 0) const;
+
+  // Returns the staging offset of the reserved space, or -1 if it doesn't fit.
+  std::int64_t reserve(std::size_t size, std::size_t alignment = 1);
+
+  // Where the next reservation would start, i.e. how far the staging buffer has been used.
+  std::size_t stagingOffset() const { return _offset; }
+  std::size_t bytesPlanned() const { return _bytesPlanned; }
+
+  // Sorts on destination and merges regions that are contiguous in both source and destination.
+  static void coalesce(std::vector<CopyRegion>& regions);
+
+  static std::size_t alignUp(std::size_t offset, std::size_t alignment);
+
+private:
+  std::size_t _offset;
+  std::size_t _end;
+  std::size_t _budget;
+  std::size_t _bytesPlanned = 0;
+};
+
+}
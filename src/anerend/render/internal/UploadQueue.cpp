@@ -4,84 +4,14 @@
 #include "../PipelineUtil.h"
 #include "UploadContext.h"
 
+#include <cstring>
+
 namespace render::internal {
 
 namespace {
 
-void uploadTextureData(
-  render::AllocatedImage image, 
-  VkFormat format, 
-  render::asset::Texture& tex,
-  UploadContext* uc,
-  render::internal::StagingBuffer& sb, 
-  VkCommandBuffer cmdBuffer)
-{
-  // Transition image to transfer dst
-  imageutil::transitionImageLayout(
-    cmdBuffer,
-    image._image,
-    format,
-    VK_IMAGE_LAYOUT_UNDEFINED,
-    VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-    0,
-    tex._numMips);
-
-  void* data;
-  glm::uint8_t* mappedData = nullptr;
-  vmaMapMemory(uc->getRC()->vmaAllocator(), sb._buf._allocation, &data);
-  mappedData = (glm::uint8_t*)data;
-  mappedData = mappedData + sb._currentOffset;
-
-  // Copy each mip to staging buffer and then to image
-  uint32_t mipWidth = tex._width;
-  uint32_t mipHeight = tex._height;
-  std::size_t rollingOffset = 0;
-  for (unsigned i = 0; i < tex._numMips; ++i) {
-    auto* data = mappedData + rollingOffset;
-
-    std::memcpy(data, tex._data[i].data(), tex._data[i].size());
-
-    VkExtent3D extent{};
-    extent.depth = 1;
-    extent.height = mipHeight;
-    extent.width = mipWidth;
-
-    VkOffset3D offset{};
-
-    VkBufferImageCopy imCopy{};
-    imCopy.bufferOffset = sb._currentOffset + rollingOffset;
-    imCopy.imageExtent = extent;
-    imCopy.imageOffset = offset;
-    imCopy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    imCopy.imageSubresource.layerCount = 1;
-    imCopy.imageSubresource.mipLevel = i;
-
-    vkCmdCopyBufferToImage(
-      cmdBuffer,
-      sb._buf._buffer,
-      image._image,
-      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-      1,
-      &imCopy);
-
-    rollingOffset += tex._data[i].size();
-    if (mipWidth > 1) mipWidth /= 2;
-    if (mipHeight > 1) mipHeight /= 2;
-  }
-
-  // Transition image to shader
-  imageutil::transitionImageLayout(
-    cmdBuffer,
-    image._image,
-    format,
-    VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-    VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-    0,
-    tex._numMips);
-
-  vmaUnmapMemory(uc->getRC()->vmaAllocator(), sb._buf._allocation);
-  //sb.advance(dataSize);
-}
+// Offsets into the staging buffer for image copies need to be a multiple of the texel block size.
+const std::size_t STAGING_ALIGNMENT = UploadQueue::stagingAlignment();
 
 }
 
@@ -113,176 +43,118 @@ void UploadQueue::update(asset::Texture textureToUpdate, internal::InternalTextu
 
 void UploadQueue::execute(UploadContext* uc, VkCommandBuffer cmdBuf)
 {
-  uploadModels(uc, cmdBuf);
-  updateTextures(uc, cmdBuf);
-  uploadTextures(uc, cmdBuf);
+  if (_modelsToUpload.empty() && _texturesToUpdate.empty() && _texturesToUpload.empty()) {
+    return;
+  }
+
+  auto& sb = uc->getStagingBuffer();
+  UploadPlanner planner(sb._currentOffset, sb._size - sb._emergencyReserve, _frameBudget);
+
+  uploadModels(uc, planner);
+  updateTextures(uc, planner);
+  uploadTextures(uc, planner);
+
+  sb._currentOffset = planner.stagingOffset();
+
+  recordCopies(uc, cmdBuf);
 }
 
-void UploadQueue::uploadTextures(UploadContext* uc, VkCommandBuffer cmdBuf)
+void UploadQueue::uploadTextures(UploadContext* uc, UploadPlanner& planner)
 {
-  for (auto it = _texturesToUpload.begin(); it != _texturesToUpload.end();) {
+  while (!_texturesToUpload.empty()) {
+    auto& tex = _texturesToUpload.front();
+
+    // Stop, because staging buffer is full or the budget is used up
+    if (!planner.fits(textureStagingSize(tex), STAGING_ALIGNMENT)) {
+      break;
+    }
 
     internal::InternalTexture internalTex{};
-    internalTex._id = it->_id;
+    internalTex._id = tex._id;
+    internalTex._firstMip = tex._firstMip;
 
-    auto res = createTexture(
-      cmdBuf,
-      uc,
-      *it,
+    createTexture(
+      uc->getRC(),
+      tex,
       internalTex._bindlessInfo._sampler,
       internalTex._bindlessInfo._image,
       internalTex._bindlessInfo._view);
 
-    // Stop, because staging buffer is full (or something went very wrong?)
-    if (!res) {
-      break;
-    }
-
-    it = _texturesToUpload.erase(it);
+    stageTextureData(uc, planner, tex, internalTex._bindlessInfo._image._image);
+    _uploadedTextures.emplace_back(std::move(internalTex));
 
-    uc->textureUploadedCB(std::move(internalTex));
+    _texturesToUpload.pop_front();
   }
 }
 
-void UploadQueue::updateTextures(UploadContext* uc, VkCommandBuffer cmdBuf)
+void UploadQueue::updateTextures(UploadContext* uc, UploadPlanner& planner)
 {
-  auto& sb = uc->getStagingBuffer();
-
-  for (auto it = _texturesToUpdate.begin(); it != _texturesToUpdate.end();) {
-    auto& internalTex = it->_internalTex;
-    auto& tex = it->_tex;
-    auto format = imageutil::texFormatToVk(tex._format);
-
-    // Make sure that we're at a multiple of 16
-    auto mod = sb._currentOffset % 16;
-    auto padding = 16 - mod;
-
-    std::size_t dataSize = padding;
-    for (auto& dat : tex._data) {
-      dataSize += dat.size();
-    }
+  while (!_texturesToUpdate.empty()) {
+    auto& info = _texturesToUpdate.front();
 
-    if (!sb.canFit(dataSize)) {
+    if (!planner.fits(textureStagingSize(info._tex), STAGING_ALIGNMENT)) {
       break;
     }
 
-    sb.advance(padding);
-
-    uploadTextureData(internalTex._bindlessInfo._image, format, tex, uc, sb, cmdBuf);
-
-    sb.advance(dataSize);
+    stageTextureData(uc, planner, info._tex, info._internalTex._bindlessInfo._image._image);
 
-    it = _texturesToUpdate.erase(it);
+    _texturesToUpdate.pop_front();
   }
 }
 
-void UploadQueue::uploadModels(UploadContext* uc, VkCommandBuffer cmdBuf)
+void UploadQueue::uploadModels(UploadContext* uc, UploadPlanner& planner)
 {
-  auto& sb = uc->getStagingBuffer();
+  struct StagedMesh
+  {
+    asset::Mesh* _mesh = nullptr;
+    internal::InternalMesh _internalMesh;
+  };
+
+  std::vector<StagedMesh> staged;
+  std::size_t vtxBytes = 0;
+  std::size_t idxBytes = 0;
   bool full = false;
 
-  for (auto it = _modelsToUpload.begin(); it != _modelsToUpload.end();) {
-
-    auto& model = it->_model;
+  // First find out which meshes fit this frame, and where they go in the giga buffers.
+  for (auto& info : _modelsToUpload) {
+    auto& model = info._model;
 
-    for (auto meshIt = model._meshes.begin() + it->_currentMeshIndex; meshIt != model._meshes.end(); ++meshIt) {
-      auto& mesh = *meshIt;
+    for (; info._currentMeshIndex < model._meshes.size(); ++info._currentMeshIndex) {
+      auto& mesh = model._meshes[info._currentMeshIndex];
 
       std::size_t vertSize = mesh._vertices.size() * sizeof(Vertex);
       std::size_t indSize = mesh._indices.size() * sizeof(std::uint32_t);
-      std::size_t stagingBufSize = vertSize + indSize;
 
-      if (!sb.canFit(stagingBufSize)) {
+      // Vertices are laid out first in staging, then indices, so that copies can be coalesced.
+      // The budget applies to the whole batch, only the first mesh may go over it.
+      std::size_t stagingSize = UploadPlanner::alignUp(vtxBytes + vertSize, STAGING_ALIGNMENT) + idxBytes + indSize;
+      if (!planner.fits(stagingSize, STAGING_ALIGNMENT, vtxBytes + idxBytes)) {
         full = true;
         break;
       }
 
-      uint8_t* data = nullptr;
-      vmaMapMemory(uc->getRC()->vmaAllocator(), sb._buf._allocation, (void**)&data);
-
-      // Offset according to current staging buffer usage
-      data = data + sb._currentOffset;
-
-      internal::BufferMemoryInterface::Handle vertexHandle;
-      internal::BufferMemoryInterface::Handle indexHandle;
-
-      // Vertices first
-      {
-        // Find where to copy data in the fat buffer
-        vertexHandle = uc->getVtxBuffer()._memInterface.addData(vertSize);
-
-        if (!vertexHandle) {
-          printf("Could not add %zu bytes of vertex data! Make buffer bigger! Things won't work now!\n", vertSize);
-          continue;
-        }
-
-        memcpy(data, mesh._vertices.data(), vertSize);
-
-        VkBufferCopy copyRegion{};
-        copyRegion.srcOffset = sb._currentOffset;
-        copyRegion.dstOffset = vertexHandle._offset;
-        copyRegion.size = vertSize;
-        vkCmdCopyBuffer(cmdBuf, sb._buf._buffer, uc->getVtxBuffer()._buffer._buffer, 1, &copyRegion);
-
-        VkBufferMemoryBarrier memBarr{};
-        memBarr.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
-        memBarr.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-        memBarr.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
-        memBarr.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        memBarr.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        memBarr.buffer = uc->getVtxBuffer()._buffer._buffer;
-        memBarr.offset = vertexHandle._offset;
-        memBarr.size = vertSize;
-
-        vkCmdPipelineBarrier(
-          cmdBuf,
-          VK_PIPELINE_STAGE_TRANSFER_BIT,
-          VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-          0, 0, nullptr,
-          1, &memBarr,
-          0, nullptr);
+      // Find where to copy data in the fat buffers
+      auto vertexHandle = uc->getVtxBuffer()._memInterface.addData(vertSize);
+      if (!vertexHandle) {
+        printf("Could not add %zu bytes of vertex data! Make buffer bigger! Things won't work now!\n", vertSize);
+        continue;
       }
 
-      // Now indices
+      internal::BufferMemoryInterface::Handle indexHandle;
       if (indSize > 0) {
-        // Find where to copy data in the fat buffer
         indexHandle = uc->getIdxBuffer()._memInterface.addData(indSize);
 
         if (!indexHandle) {
           printf("Could not add %zu bytes of index data! Make buffer bigger! Things won't work now!\n", indSize);
+          uc->getVtxBuffer()._memInterface.removeData(vertexHandle);
           continue;
         }
-
-        memcpy(data + vertSize, mesh._indices.data(), indSize);
-
-        VkBufferCopy copyRegion{};
-        copyRegion.srcOffset = sb._currentOffset + vertSize;
-        copyRegion.dstOffset = indexHandle._offset;
-        copyRegion.size = indSize;
-        vkCmdCopyBuffer(cmdBuf, sb._buf._buffer, uc->getIdxBuffer()._buffer._buffer, 1, &copyRegion);
-
-        VkBufferMemoryBarrier memBarr{};
-        memBarr.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
-        memBarr.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-        memBarr.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_INDEX_READ_BIT;
-        memBarr.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        memBarr.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        memBarr.buffer = uc->getIdxBuffer()._buffer._buffer;
-        memBarr.offset = indexHandle._offset;
-        memBarr.size = indSize;
-
-        vkCmdPipelineBarrier(
-          cmdBuf,
-          VK_PIPELINE_STAGE_TRANSFER_BIT,
-          VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-          0, 0, nullptr,
-          1, &memBarr,
-          0, nullptr);
       }
 
-      it->_currentMeshIndex = meshIt - model._meshes.begin() + 1;
+      StagedMesh stagedMesh{};
+      stagedMesh._mesh = &mesh;
 
-      internal::InternalMesh internalMesh{};
+      auto& internalMesh = stagedMesh._internalMesh;
       internalMesh._id = mesh._id;
       internalMesh._numIndices = static_cast<uint32_t>(mesh._indices.size());
       internalMesh._numVertices = static_cast<uint32_t>(mesh._vertices.size());
@@ -293,83 +165,252 @@ void UploadQueue::uploadModels(UploadContext* uc, VkCommandBuffer cmdBuf)
       internalMesh._vertexOffset = static_cast<uint32_t>(vertexHandle._offset / sizeof(Vertex));
       internalMesh._indexOffset = indexHandle._offset == -1 ? -1 : static_cast<int64_t>(indexHandle._offset / sizeof(uint32_t));
 
-      sb.advance(stagingBufSize);
-      vmaUnmapMemory(uc->getRC()->vmaAllocator(), sb._buf._allocation);
-
-      uc->modelMeshUploadedCB(std::move(internalMesh), cmdBuf);
+      staged.emplace_back(std::move(stagedMesh));
+      vtxBytes += vertSize;
+      idxBytes += indSize;
     }
 
     if (full) {
       break;
     }
+  }
+
+  if (!staged.empty()) {
+    auto& sb = uc->getStagingBuffer();
+
+    std::size_t idxStart = UploadPlanner::alignUp(vtxBytes, STAGING_ALIGNMENT);
+    auto base = planner.reserve(idxStart + idxBytes, STAGING_ALIGNMENT);
+
+    std::size_t vtxCursor = (std::size_t)base;
+    std::size_t idxCursor = (std::size_t)base + idxStart;
 
-    it = _modelsToUpload.erase(it);
+    for (auto& stagedMesh : staged) {
+      auto& mesh = *stagedMesh._mesh;
+      auto& internalMesh = stagedMesh._internalMesh;
+
+      std::size_t vertSize = internalMesh._vertexHandle._size;
+      std::memcpy(sb._mappedData + vtxCursor, mesh._vertices.data(), vertSize);
+      _vtxRegions.push_back({ vtxCursor, (std::size_t)internalMesh._vertexHandle._offset, vertSize });
+      vtxCursor += vertSize;
+
+      if (internalMesh._indexHandle) {
+        std::size_t indSize = internalMesh._indexHandle._size;
+        std::memcpy(sb._mappedData + idxCursor, mesh._indices.data(), indSize);
+        _idxRegions.push_back({ idxCursor, (std::size_t)internalMesh._indexHandle._offset, indSize });
+        idxCursor += indSize;
+      }
+
+      _uploadedMeshes.emplace_back(std::move(internalMesh));
+    }
+  }
+
+  // Pointers in staged are now no longer needed, so finished models can be dropped.
+  while (!_modelsToUpload.empty() && _modelsToUpload.front()._currentMeshIndex >= _modelsToUpload.front()._model._meshes.size()) {
+    _modelsToUpload.pop_front();
   }
 }
 
-bool UploadQueue::createTexture(
-  VkCommandBuffer cmdBuffer,
+void UploadQueue::stageTextureData(
   UploadContext* uc,
+  UploadPlanner& planner,
   render::asset::Texture& tex,
-  VkSampler& samplerOut,
-  AllocatedImage& imageOut,
-  VkImageView& viewOut)
+  VkImage image)
 {
   auto& sb = uc->getStagingBuffer();
-  auto format = imageutil::texFormatToVk(tex._format);
+  auto base = planner.reserve(textureStagingSize(tex), STAGING_ALIGNMENT);
 
-  // Make sure that we're at a multiple of 16
-  auto mod = sb._currentOffset % 16;
-  auto padding = 16 - mod;
+  ImageCopy imageCopy{};
+  imageCopy._image = image;
 
-  std::size_t dataSize = padding;
-  for (auto& dat : tex._data) {
-    dataSize += dat.size();
+  // Copy each mip to staging buffer
+  uint32_t mipWidth = tex._width;
+  uint32_t mipHeight = tex._height;
+  std::size_t rollingOffset = (std::size_t)base;
+  for (unsigned i = 0; i < tex._numMips; ++i) {
+    std::memcpy(sb._mappedData + rollingOffset, tex._data[i].data(), tex._data[i].size());
+
+    VkExtent3D extent{};
+    extent.depth = 1;
+    extent.height = mipHeight;
+    extent.width = mipWidth;
+
+    VkOffset3D offset{};
+
+    VkBufferImageCopy imCopy{};
+    imCopy.bufferOffset = rollingOffset;
+    imCopy.imageExtent = extent;
+    imCopy.imageOffset = offset;
+    imCopy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    imCopy.imageSubresource.layerCount = 1;
+    imCopy.imageSubresource.mipLevel = i;
+    imageCopy._copies.emplace_back(std::move(imCopy));
+
+    rollingOffset += UploadPlanner::alignUp(tex._data[i].size(), STAGING_ALIGNMENT);
+    if (mipWidth > 1) mipWidth /= 2;
+    if (mipHeight > 1) mipHeight /= 2;
+  }
+
+  VkImageMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image = image;
+  barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  barrier.subresourceRange.baseMipLevel = 0;
+  barrier.subresourceRange.levelCount = tex._numMips;
+  barrier.subresourceRange.baseArrayLayer = 0;
+  barrier.subresourceRange.layerCount = 1;
+
+  // Transition image to transfer dst
+  barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  barrier.srcAccessMask = 0;
+  barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  _preCopyBarriers.emplace_back(barrier);
+
+  // And then to shader read after the copy
+  barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+  _postCopyBarriers.emplace_back(barrier);
+
+  _imageCopies.emplace_back(std::move(imageCopy));
+}
+
+void UploadQueue::recordCopies(UploadContext* uc, VkCommandBuffer cmdBuf)
+{
+  auto& sb = uc->getStagingBuffer();
+
+  if (!_preCopyBarriers.empty()) {
+    vkCmdPipelineBarrier(
+      cmdBuf,
+      VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+      VK_PIPELINE_STAGE_TRANSFER_BIT,
+      0, 0, nullptr,
+      0, nullptr,
+      (uint32_t)_preCopyBarriers.size(), _preCopyBarriers.data());
+  }
+
+  std::vector<VkBufferMemoryBarrier> bufferBarriers;
+  auto recordBufferCopies = [&](std::vector<UploadPlanner::CopyRegion>& regions, VkBuffer dst, VkAccessFlags dstAccess) {
+    if (regions.empty()) return;
+
+    UploadPlanner::coalesce(regions);
+
+    std::vector<VkBufferCopy> copies;
+    copies.reserve(regions.size());
+    for (auto& region : regions) {
+      VkBufferCopy copyRegion{};
+      copyRegion.srcOffset = region._srcOffset;
+      copyRegion.dstOffset = region._dstOffset;
+      copyRegion.size = region._size;
+      copies.emplace_back(std::move(copyRegion));
+
+      VkBufferMemoryBarrier memBarr{};
+      memBarr.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+      memBarr.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+      memBarr.dstAccessMask = dstAccess;
+      memBarr.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+      memBarr.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+      memBarr.buffer = dst;
+      memBarr.offset = region._dstOffset;
+      memBarr.size = region._size;
+      bufferBarriers.emplace_back(std::move(memBarr));
+    }
+
+    vkCmdCopyBuffer(cmdBuf, sb._buf._buffer, dst, (uint32_t)copies.size(), copies.data());
+    regions.clear();
+  };
+
+  recordBufferCopies(_vtxRegions, uc->getVtxBuffer()._buffer._buffer, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
+  recordBufferCopies(_idxRegions, uc->getIdxBuffer()._buffer._buffer, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_INDEX_READ_BIT);
+
+  for (auto& imageCopy : _imageCopies) {
+    vkCmdCopyBufferToImage(
+      cmdBuf,
+      sb._buf._buffer,
+      imageCopy._image,
+      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+      (uint32_t)imageCopy._copies.size(),
+      imageCopy._copies.data());
   }
 
-  if (!sb.canFit(dataSize)) {
-    return false;
+  // One barrier for everything uploaded this frame
+  VkPipelineStageFlags dstStages = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+  if (uc->rayTracingEnabled()) {
+    dstStages |= VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR | VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR;
   }
 
-  AllocatedImage image;
-  sb.advance(padding);
+  if (!bufferBarriers.empty() || !_postCopyBarriers.empty()) {
+    vkCmdPipelineBarrier(
+      cmdBuf,
+      VK_PIPELINE_STAGE_TRANSFER_BIT,
+      dstStages,
+      0, 0, nullptr,
+      (uint32_t)bufferBarriers.size(), bufferBarriers.data(),
+      (uint32_t)_postCopyBarriers.size(), _postCopyBarriers.data());
+  }
+
+  _imageCopies.clear();
+  _preCopyBarriers.clear();
+  _postCopyBarriers.clear();
+
+  // Now the data is visible, so it's safe to hand back (i.e. build BLASes etc.)
+  for (auto& mesh : _uploadedMeshes) {
+    uc->modelMeshUploadedCB(std::move(mesh), cmdBuf);
+  }
+  for (auto& tex : _uploadedTextures) {
+    uc->textureUploadedCB(std::move(tex));
+  }
+
+  _uploadedMeshes.clear();
+  _uploadedTextures.clear();
+}
+
+std::size_t UploadQueue::textureStagingSize(const render::asset::Texture& tex)
+{
+  std::size_t size = 0;
+  for (auto& dat : tex._data) {
+    size += UploadPlanner::alignUp(dat.size(), STAGING_ALIGNMENT);
+  }
+  return size;
+}
+
+void UploadQueue::createTexture(
+  RenderContext* rc,
+  render::asset::Texture& tex,
+  VkSampler& samplerOut,
+  AllocatedImage& imageOut,
+  VkImageView& viewOut)
+{
+  auto format = imageutil::texFormatToVk(tex._format);
 
+  AllocatedImage image;
   imageutil::createImage(
     tex._width, tex._height,
     format,
     VK_IMAGE_TILING_OPTIMAL,
-    uc->getRC()->vmaAllocator(),
+    rc->vmaAllocator(),
     VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
     image,
     tex._numMips);
 
   auto view = imageutil::createImageView(
-    uc->getRC()->device(),
+    rc->device(),
     image._image,
     format,
     VK_IMAGE_ASPECT_COLOR_BIT,
     0,
     tex._numMips);
 
-  uploadTextureData(
-    image,
-    format,
-    tex,
-    uc,
-    sb,
-    cmdBuffer);
-
-  sb.advance(dataSize);
-
   SamplerCreateParams params{};
   params.addressMode = tex._clampToEdge ? VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE : VK_SAMPLER_ADDRESS_MODE_REPEAT;
-  params.renderContext = uc->getRC();
+  params.renderContext = rc;
 
   imageOut = image;
   viewOut = view;
   samplerOut = createSampler(params);
-
-  return true;
 }
 
-}
\ No newline at end of file
+}
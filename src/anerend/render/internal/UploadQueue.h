@@ -4,14 +4,28 @@
 #include "../asset/Texture.h"
 
 #include "../AllocatedImage.h"
+#include "../internal/InternalMesh.h"
 #include "../internal/InternalTexture.h"
+#include "UploadPlanner.h"
 
 #include <vulkan/vulkan.h>
 
+#include <deque>
+#include <vector>
+
+namespace render {
+  class RenderContext;
+}
+
 namespace render::internal {
 
 class UploadContext;
 
+/*
+  Uploads models and textures via the (persistently mapped) staging buffer.
+  All copies of a frame are gathered and recorded at once: one vkCmdCopyBuffer per destination buffer
+  and one batched barrier after all copies. Uploads are spread over frames according to a byte budget.
+*/
 class UploadQueue
 {
 public:
@@ -27,8 +41,23 @@ public:
   void add(asset::Texture textureToUpload);
   void update(asset::Texture textureToUpdate, internal::InternalTexture internal);
 
+  // Max number of bytes to upload per frame. A single item bigger than this is still uploaded (alone).
+  void setFrameBudget(std::size_t bytes) { _frameBudget = bytes; }
+
   void execute(UploadContext* uc, VkCommandBuffer cmdBuf);
 
+  // Creates image, view and sampler for the texture, but doesn't upload any data.
+  static void createTexture(
+    RenderContext* rc,
+    render::asset::Texture& tex,
+    VkSampler& samplerOut,
+    AllocatedImage& imageOut,
+    VkImageView& viewOut);
+
+  // Size needed in a staging buffer to hold all mips, with each mip aligned to stagingAlignment().
+  static std::size_t textureStagingSize(const render::asset::Texture& tex);
+  static std::size_t stagingAlignment() { return 16; }
+
 private:
   struct ModelUploadInfo
   {
@@ -42,21 +71,41 @@ private:
     internal::InternalTexture _internalTex;
   };
 
-  std::vector<ModelUploadInfo> _modelsToUpload;
-  std::vector<asset::Texture> _texturesToUpload;
-  std::vector<TextureUpdateInfo> _texturesToUpdate;
+  struct ImageCopy
+  {
+    VkImage _image = VK_NULL_HANDLE;
+    std::vector<VkBufferImageCopy> _copies;
+  };
+
+  std::deque<ModelUploadInfo> _modelsToUpload;
+  std::deque<asset::Texture> _texturesToUpload;
+  std::deque<TextureUpdateInfo> _texturesToUpdate;
+
+  std::size_t _frameBudget = 32 * 1024 * 1024;
+
+  // Gathered during a frame, recorded and cleared in recordCopies().
+  std::vector<UploadPlanner::CopyRegion> _vtxRegions;
+  std::vector<UploadPlanner::CopyRegion> _idxRegions;
+  std::vector<ImageCopy> _imageCopies;
+  std::vector<VkImageMemoryBarrier> _preCopyBarriers;
+  std::vector<VkImageMemoryBarrier> _postCopyBarriers;
+
+  // These are handed back to the upload context once the copies are visible.
+  std::vector<InternalMesh> _uploadedMeshes;
+  std::vector<InternalTexture> _uploadedTextures;
 
-  void uploadTextures(UploadContext* uc, VkCommandBuffer cmdBuf);
-  void updateTextures(UploadContext* uc, VkCommandBuffer cmdBuf);
-  void uploadModels(UploadContext* uc, VkCommandBuffer cmdBuf);
+  void uploadTextures(UploadContext* uc, UploadPlanner& planner);
+  void updateTextures(UploadContext* uc, UploadPlanner& planner);
+  void uploadModels(UploadContext* uc, UploadPlanner& planner);
 
-  bool createTexture(
-    VkCommandBuffer cmdBuffer,
+  void recordCopies(UploadContext* uc, VkCommandBuffer cmdBuf);
+
+  void stageTextureData(
     UploadContext* uc,
+    UploadPlanner& planner,
     render::asset::Texture& tex,
-    VkSampler& samplerOut,
-    AllocatedImage& imageOut,
-    VkImageView& viewOut);
+    VkImage image);
+
 };
 
-}
\ No newline at end of file
+}
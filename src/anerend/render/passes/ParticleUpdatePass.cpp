@@ -2,72 +2,60 @@
 
 #include "../FrameGraphBuilder.h"
 #include "../RenderContext.h"
+#include "../RenderResource.h"
 #include "../GpuBuffers.h"
 #include "../BufferHelpers.h"
+#include "../ParticleEmitterPool.h"
+
+#include <cstring>
 
 namespace render {
 
 namespace {
 
-void prefillParticleBuffer(RenderContext* rc, AllocatedBuffer& buffer)
+ResourceUsage particleBufferUsage(const std::string& name, bool read, bool write)
 {
-  auto particles = rc->getParticles();
-  if (particles.empty()) return;
-
-  // Create a staging buffer on CPU side first
-  auto allocator = rc->vmaAllocator();
-  AllocatedBuffer stagingBuffer;
-  std::size_t dataSize = particles.size() * sizeof(gpu::GPUParticle);
-
-  bufferutil::createBuffer(allocator, dataSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT, stagingBuffer);
-
-  void* data;
-  gpu::GPUParticle* mappedData;
-  vmaMapMemory(allocator, stagingBuffer._allocation, &data);
-  mappedData = (gpu::GPUParticle*)data;
-
-  for (std::size_t i = 0; i < particles.size(); ++i) {
-    auto& cpuParticle = particles[i];
-    gpu::GPUParticle* gpuParticle = &mappedData[i];
-    
-    gpuParticle->initialPosition = glm::vec4(cpuParticle._initialPosition, cpuParticle._lifetime);
-    gpuParticle->initialVelocity = glm::vec4(cpuParticle._initialVelocity, cpuParticle._scale);
-    gpuParticle->currentPosition = glm::vec4(0.0f, 0.0f, 0.0f, cpuParticle._spawnDelay);
-    gpuParticle->currentVelocity = glm::vec4(0.0f);
-    // TODO: CHANGE THIS TO INDEX! USE ID MAP!
-    //gpuParticle->renderableId = static_cast<uint32_t>(cpuParticle._renderableId);
-    gpuParticle->alive = 0;
-  }
+  ResourceUsage usage{};
+  usage._resourceName = name;
+  if (read) usage._access.set((std::size_t)Access::Read);
+  if (write) usage._access.set((std::size_t)Access::Write);
+  usage._stage.set((std::size_t)Stage::Compute);
+  usage._type = Type::SSBO;
+  return usage;
+}
+
+ResourceUsage particleBufferUsage(const std::string& name, bool read, bool write, std::size_t size)
+{
+  auto usage = particleBufferUsage(name, read, write);
+  BufferInitialCreateInfo createInfo{};
+  createInfo._initialSize = size;
+  usage._bufferCreateInfo = createInfo;
+  return usage;
+}
+
+void bindAndPush(RenderExeParams& exeParams, std::uint32_t current)
+{
+  vkCmdBindPipeline(*exeParams.cmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, *exeParams.pipeline);
 
-  vmaUnmapMemory(allocator, stagingBuffer._allocation);
-
-  auto cmdBuffer = rc->beginSingleTimeCommands();
-
-  VkBufferCopy copyRegion{};
-  copyRegion.size = dataSize;
-  vkCmdCopyBuffer(cmdBuffer, stagingBuffer._buffer, buffer._buffer, 1, &copyRegion);
-
-  // Barrier after filling
-  VkBufferMemoryBarrier memBarr{};
-  memBarr.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
-  memBarr.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-  memBarr.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
-  memBarr.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-  memBarr.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-  memBarr.buffer = buffer._buffer;
-  memBarr.offset = 0;
-  memBarr.size = VK_WHOLE_SIZE;
-
-  vkCmdPipelineBarrier(
-    cmdBuffer,
-    VK_PIPELINE_STAGE_TRANSFER_BIT,
-    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-    0, 0, nullptr,
-    1, &memBarr,
+  vkCmdBindDescriptorSets(
+    *exeParams.cmdBuffer,
+    VK_PIPELINE_BIND_POINT_COMPUTE,
+    *exeParams.pipelineLayout,
+    1, 1, &(*exeParams.descriptorSets)[0],
     0, nullptr);
 
-  rc->endSingleTimeCommands(cmdBuffer);
-  vmaDestroyBuffer(allocator, stagingBuffer._buffer, stagingBuffer._allocation);
+  gpu::GPUParticlePushConstants pushConstants{};
+  pushConstants.current = current;
+  pushConstants.maxParticles = ParticleEmitterPool::MAX_PARTICLES;
+  pushConstants.numEmitters = (std::uint32_t)exeParams.rc->getParticleEmitters().gpuEmitters().size();
+
+  vkCmdPushConstants(
+    *exeParams.cmdBuffer,
+    *exeParams.pipelineLayout,
+    VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_RAYGEN_BIT_KHR,
+    0,
+    sizeof(gpu::GPUParticlePushConstants),
+    &pushConstants);
 }
 
 }
@@ -79,64 +67,182 @@ ParticleUpdatePass::ParticleUpdatePass()
 ParticleUpdatePass::~ParticleUpdatePass()
 {}
 
+void ParticleUpdatePass::cleanup(RenderContext* renderContext, RenderResourceVault*)
+{
+  for (auto& buf : _gpuStagingBuffers) {
+    vmaDestroyBuffer(renderContext->vmaAllocator(), buf._buffer, buf._allocation);
+  }
+  _gpuStagingBuffers.clear();
+}
+
 void ParticleUpdatePass::registerToGraph(FrameGraphBuilder& fgb, RenderContext* rc)
 {
-  RenderPassRegisterInfo info{};
-  info._name = "ParticleUpdate";
+  // The buffers may be new, so everything starts over
+  _current = 0;
+  _countersCleared = false;
+  rc->getParticleEmitters().resetGpuState();
+
+  _gpuStagingBuffers.resize(rc->getMultiBufferSize());
+  for (int i = 0; i < rc->getMultiBufferSize(); ++i) {
+    bufferutil::createBuffer(
+      rc->vmaAllocator(),
+      ParticleEmitterPool::MAX_EMITTERS * sizeof(gpu::GPUParticleEmitter),
+      VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+      VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT,
+      _gpuStagingBuffers[i]);
+  }
 
+  // Copy this frame's emitter table
   {
-    ResourceUsage usage{};
-    usage._resourceName = "RenderableBuffer";
-    usage._access.set((std::size_t)Access::Write);
-    usage._stage.set((std::size_t)Stage::Compute);
-    usage._type = Type::SSBO;
-    usage._multiBuffered = true;
-    usage._ownedByEngine = true;
-    info._resourceUsages.emplace_back(std::move(usage));
+    ResourceUsage initUsage{};
+    initUsage._type = Type::SSBO;
+    initUsage._access.set((std::size_t)Access::Write);
+    initUsage._stage.set((std::size_t)Stage::Transfer);
+
+    fgb.registerResourceInitExe("ParticleEmitterBuffer", std::move(initUsage),
+      [this](IRenderResource* resource, VkCommandBuffer& cmdBuffer, RenderContext* renderContext) {
+        auto buf = (BufferRenderResource*)resource;
+        auto& pool = renderContext->getParticleEmitters();
+        auto& emitters = pool.gpuEmitters();
+
+        if (!emitters.empty()) {
+          auto& staging = _gpuStagingBuffers[renderContext->getCurrentMultiBufferIdx()];
+          std::size_t dataSize = emitters.size() * sizeof(gpu::GPUParticleEmitter);
+
+          void* data;
+          vmaMapMemory(renderContext->vmaAllocator(), staging._allocation, &data);
+          std::memcpy(data, emitters.data(), dataSize);
+          vmaUnmapMemory(renderContext->vmaAllocator(), staging._allocation);
+
+          VkBufferCopy copyRegion{};
+          copyRegion.size = dataSize;
+          vkCmdCopyBuffer(cmdBuffer, staging._buffer, buf->_buffer._buffer, 1, &copyRegion);
+        }
+
+        pool.uploaded();
+      });
   }
+
+  // Nothing is alive to begin with. Dead counts are set when an emitter's range is reset.
   {
-    ResourceUsage usage{};
-    usage._resourceName = "ParticleBuffer";
-    usage._access.set((std::size_t)Access::Write);
-    usage._stage.set((std::size_t)Stage::Compute);
-    usage._stage.set((std::size_t)Stage::Transfer);
-    usage._type = Type::SSBO;
-    BufferInitialCreateInfo createInfo{};
-    createInfo._initialSize = 50000 * sizeof(gpu::GPUParticle); // Hack
-    createInfo._initialDataCb = prefillParticleBuffer;
-    usage._bufferCreateInfo = createInfo;
-    info._resourceUsages.emplace_back(std::move(usage));
+    ResourceUsage initUsage{};
+    initUsage._type = Type::SSBO;
+    initUsage._access.set((std::size_t)Access::Write);
+    initUsage._stage.set((std::size_t)Stage::Transfer);
+
+    fgb.registerResourceInitExe("ParticleCounterBuffer", std::move(initUsage),
+      [this](IRenderResource* resource, VkCommandBuffer& cmdBuffer, RenderContext* renderContext) {
+        if (_countersCleared) {
+          return;
+        }
+
+        auto buf = (BufferRenderResource*)resource;
+        vkCmdFillBuffer(cmdBuffer, buf->_buffer._buffer, 0, VK_WHOLE_SIZE, 0);
+        _countersCleared = true;
+      });
   }
 
+  emitPass(fgb, rc);
+  kickoffPass(fgb, rc);
+  simulatePass(fgb, rc);
+}
+
+void ParticleUpdatePass::emitPass(FrameGraphBuilder& fgb, RenderContext* rc)
+{
+  RenderPassRegisterInfo info{};
+  info._name = "ParticleEmit";
+  info._group = "Particles";
+
+  const std::size_t maxParticles = ParticleEmitterPool::MAX_PARTICLES;
+  const std::size_t maxEmitters = ParticleEmitterPool::MAX_EMITTERS;
+
+  info._resourceUsages.emplace_back(particleBufferUsage("ParticleEmitterBuffer", true, false, maxEmitters * sizeof(gpu::GPUParticleEmitter)));
+  info._resourceUsages.emplace_back(particleBufferUsage("ParticleBuffer", false, true, maxParticles * sizeof(gpu::GPUParticle)));
+  info._resourceUsages.emplace_back(particleBufferUsage("ParticleDeadListBuffer", true, true, maxParticles * sizeof(std::uint32_t)));
+  info._resourceUsages.emplace_back(particleBufferUsage("ParticleAliveListBuffer", false, true, 2 * maxParticles * sizeof(std::uint32_t)));
+  info._resourceUsages.emplace_back(particleBufferUsage("ParticleCounterBuffer", true, true, sizeof(gpu::GPUParticleCounters) + maxEmitters * sizeof(std::uint32_t)));
+
   ComputePipelineCreateParams pipeParam{};
   pipeParam.device = rc->device();
-  pipeParam.shader = "particle_update_comp.spv";
+  pipeParam.shader = "particle_emit_comp.spv";
+  info._computeParams = pipeParam;
+
+  fgb.registerRenderPass(std::move(info));
+
+  fgb.registerRenderPassExe("ParticleEmit",
+    [this](RenderExeParams exeParams) {
+      auto numEmitters = (std::uint32_t)exeParams.rc->getParticleEmitters().gpuEmitters().size();
+      if (numEmitters == 0) return;
+
+      bindAndPush(exeParams, _current);
 
+      // One workgroup per emitter
+      vkCmdDispatch(*exeParams.cmdBuffer, numEmitters, 1, 1);
+    });
+}
+
+void ParticleUpdatePass::kickoffPass(FrameGraphBuilder& fgb, RenderContext* rc)
+{
+  RenderPassRegisterInfo info{};
+  info._name = "ParticleKickoff";
+  info._group = "Particles";
+
+  info._resourceUsages.emplace_back(particleBufferUsage("ParticleCounterBuffer", true, true));
+  // VkDispatchIndirectCommand
+  info._resourceUsages.emplace_back(particleBufferUsage("ParticleDispatchBuffer", false, true, 4 * sizeof(std::uint32_t)));
+
+  ComputePipelineCreateParams pipeParam{};
+  pipeParam.device = rc->device();
+  pipeParam.shader = "particle_kickoff_comp.spv";
   info._computeParams = pipeParam;
 
   fgb.registerRenderPass(std::move(info));
 
-  fgb.registerRenderPassExe("ParticleUpdate",
+  fgb.registerRenderPassExe("ParticleKickoff",
     [this](RenderExeParams exeParams) {
-      return;
+      bindAndPush(exeParams, _current);
+      vkCmdDispatch(*exeParams.cmdBuffer, 1, 1, 1);
+    });
+}
 
-      auto particleSize = exeParams.rc->getParticles().size();
-      if (particleSize == 0) return;
+void ParticleUpdatePass::simulatePass(FrameGraphBuilder& fgb, RenderContext* rc)
+{
+  RenderPassRegisterInfo info{};
+  info._name = "ParticleSimulate";
+  info._group = "Particles";
 
-      // Bind pipeline
-      vkCmdBindPipeline(*exeParams.cmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, *exeParams.pipeline);
+  // Not a descriptor, it is buffers[0]
+  {
+    ResourceUsage usage{};
+    usage._resourceName = "ParticleDispatchBuffer";
+    usage._access.set((std::size_t)Access::Read);
+    usage._stage.set((std::size_t)Stage::IndirectDraw);
+    usage._type = Type::SSBO;
+    info._resourceUsages.emplace_back(std::move(usage));
+  }
+  info._resourceUsages.emplace_back(particleBufferUsage("ParticleEmitterBuffer", true, false));
+  info._resourceUsages.emplace_back(particleBufferUsage("ParticleBuffer", true, true));
+  info._resourceUsages.emplace_back(particleBufferUsage("ParticleDeadListBuffer", true, true));
+  info._resourceUsages.emplace_back(particleBufferUsage("ParticleAliveListBuffer", true, true));
+  info._resourceUsages.emplace_back(particleBufferUsage("ParticleCounterBuffer", true, true));
 
-      vkCmdBindDescriptorSets(
-        *exeParams.cmdBuffer,
-        VK_PIPELINE_BIND_POINT_COMPUTE,
-        *exeParams.pipelineLayout,
-        1, 1, &(*exeParams.descriptorSets)[0],
-        0, nullptr);
+  ComputePipelineCreateParams pipeParam{};
+  pipeParam.device = rc->device();
+  pipeParam.shader = "particle_simulate_comp.spv";
+  info._computeParams = pipeParam;
 
-      uint32_t numX = static_cast<uint32_t>(particleSize) / 8;
+  fgb.registerRenderPass(std::move(info));
 
-      vkCmdDispatch(*exeParams.cmdBuffer, numX + 1, 1, 1);
+  fgb.registerRenderPassExe("ParticleSimulate",
+    [this](RenderExeParams exeParams) {
+      bindAndPush(exeParams, _current);
+
+      // One invocation per alive particle, sized by the kickoff pass
+      vkCmdDispatchIndirect(*exeParams.cmdBuffer, exeParams.buffers[0], 0);
+
+      // The survivors are simulated next frame
+      _current = 1 - _current;
     });
 }
 
-}
\ No newline at end of file
+}
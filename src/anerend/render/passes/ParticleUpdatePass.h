@@ -1,17 +1,41 @@
 #pragma once
 
 #include "RenderPass.h"
+#include "../AllocatedBuffer.h"
+
+#include <cstdint>
+#include <vector>
 
 namespace render {
 
+/*
+* Emits and simulates the particles of all ParticleEmitters, see ParticleEmitterPool.
+* Every emitter owns a range of the particle buffer with a dead list of the same size. Emitting pops dead particles
+* onto the current alive list, one workgroup per emitter. Simulating is dispatched indirectly over the alive list,
+* sized on the GPU, and appends the survivors to the other alive list and pushes the rest back onto their
+* emitter's dead list. The alive lists swap every frame.
+*/
 class ParticleUpdatePass : public RenderPass
 {
 public:
   ParticleUpdatePass();
   ~ParticleUpdatePass();
 
+  void cleanup(RenderContext* renderContext, RenderResourceVault*) override final;
+
   // Register how the render pass will actually render
   void registerToGraph(FrameGraphBuilder&, RenderContext* rc) override final;
+
+private:
+  void emitPass(FrameGraphBuilder& fgb, RenderContext* rc);
+  void kickoffPass(FrameGraphBuilder& fgb, RenderContext* rc);
+  void simulatePass(FrameGraphBuilder& fgb, RenderContext* rc);
+
+  // Emitter table for the frame
+  std::vector<AllocatedBuffer> _gpuStagingBuffers;
+
+  std::uint32_t _current = 0;
+  bool _countersCleared = false;
 };
 
-}
\ No newline at end of file
+}
@@ -6,6 +6,7 @@
 
 #include <algorithm>
 #include <execution>
+#include <unordered_set>
 
 namespace render::scene {
 
@@ -173,18 +174,22 @@ void Scene::update()
     // but we have to do it in order to have independent updates for each root tree to run 
     // across multiple threads.
     std::vector<util::Uuid> rootsToUpdate;
+    std::unordered_set<util::Uuid> seenRoots;
     for (const auto entity : _transformObserver) {
       auto id = _registry.reverseLookup(entity);
       auto& node = _nodeVec[_nodes[id]];
-      rootsToUpdate.emplace_back(findRoot(node));
-    }
 
-    // Uniqueify
-    rootsToUpdate.erase(std::unique(rootsToUpdate.begin(), rootsToUpdate.end()), rootsToUpdate.end());
+      // Uniqueify, a tree that is updated twice would also be patched twice
+      auto root = findRoot(node);
+      if (seenRoots.insert(root).second) {
+        rootsToUpdate.emplace_back(root);
+      }
+    }
 
     // Let the implementation decide how to parallise the udpate.
-    if (_nodesToBePatched.size() < 1024) {
-      _nodesToBePatched.resize(1024);
+    // Every node can be patched at most once per update, so this is an upper bound.
+    if (_nodesToBePatched.size() < std::max(_nodeVec.size(), std::size_t(1024))) {
+      _nodesToBePatched.resize(std::max(_nodeVec.size(), std::size_t(1024)));
     }
 
     std::for_each(
@@ -0,0 +1,206 @@
+#include "SignificanceManager.h"
+
+#include "Scene.h"
+#include "../Camera.h"
+
+#include <algorithm>
+
+namespace render::scene {
+
+void SignificanceManager::setScene(Scene* scene)
+{
+  _scene = scene;
+  _nodeStates.clear();
+}
+
+void SignificanceManager::update(const render::Camera& camera, double delta)
+{
+  update(camera.getPosition(), camera.getProjection() * camera.getCamMatrix(), delta);
+}
+
+void SignificanceManager::update(const glm::vec3& viewPos, const glm::mat4& viewProj, double delta)
+{
+  _frame++;
+  _delta = delta;
+
+  _stats._numDue = _numDue;
+  _stats._numSkipped = _numSkipped;
+  _numDue = 0;
+  _numSkipped = 0;
+  updateBudgetScale();
+
+  _entities.clear();
+  _spheres.clear();
+
+  if (!_scene) {
+    return;
+  }
+
+  auto& reg = _scene->registry().getEnttRegistry();
+
+  // Nodes without a renderable are points
+  auto addNode = [this, &reg](entt::entity entity) {
+    auto& transform = reg.get<component::Transform>(entity);
+    glm::vec3 center = glm::vec3(transform._globalTransform[3]);
+    float radius = 0.0f;
+
+    if (auto* rend = reg.try_get<component::Renderable>(entity)) {
+      center += glm::vec3(rend->_boundingSphere);
+      radius = rend->_boundingSphere.w;
+    }
+
+    _entities.emplace_back(entity);
+    _spheres.add(center, radius);
+  };
+
+  auto behaviourView = reg.view<component::Transform, component::Behaviour>();
+  for (auto entity : behaviourView) {
+    addNode(entity);
+  }
+
+  auto animatorView = reg.view<component::Transform, component::Animator>();
+  for (auto entity : animatorView) {
+    if (!reg.all_of<component::Behaviour>(entity)) {
+      addNode(entity);
+    }
+  }
+
+  _planes.clear();
+  _planes.addView(viewProj);
+  _masks.resize(_entities.size());
+  FrustumCulling::cullSpheres(_planes, _spheres, _masks.data());
+
+  const auto& s = _settings;
+  const float farRange = std::max(s._farDistance - s._fullRateDistance, 0.001f);
+  const float maxInterval = (float)std::max(s._maxInterval, 1u);
+
+  _stats._numTracked = _entities.size();
+  _stats._numVisible = 0;
+
+  for (std::size_t i = 0; i < _entities.size(); ++i) {
+    auto& node = nodeState(_entities[i]);
+    bool visible = _masks[i] != 0;
+
+    glm::vec3 center(_spheres._x[i], _spheres._y[i], _spheres._z[i]);
+    float distance = std::max(glm::distance(viewPos, center) - _spheres._r[i], 0.0f);
+    float t = std::clamp((distance - s._fullRateDistance) / farRange, 0.0f, 1.0f);
+
+    float interval = 1.0f + t * (s._farInterval - 1.0f);
+    if (!visible) {
+      interval *= s._invisibleMultiplier;
+    }
+
+    // Over budget only nodes that are already throttled wait longer, the ones closest to the camera stay at full rate
+    interval = 1.0f + (interval - 1.0f) * _budgetScale;
+    interval /= std::max(node._importance, 0.001f);
+
+    node._interval = (std::uint32_t)(std::clamp(interval, 1.0f, maxInterval) + 0.5f);
+    node._frame = _frame;
+
+    if (visible) {
+      _stats._numVisible++;
+    }
+  }
+}
+
+void SignificanceManager::setImportance(const util::Uuid& node, float importance)
+{
+  if (!_scene) {
+    return;
+  }
+
+  auto entity = _scene->registry().lookup(node);
+  if (entity == entt::null) {
+    return;
+  }
+
+  nodeState(entity)._importance = importance;
+}
+
+bool SignificanceManager::due(entt::entity entity, ThrottleState& state, double& delta)
+{
+  auto current = interval(entity);
+  state._accumulatedDelta += _delta;
+
+  bool isDue = false;
+  if (!state._started) {
+    // Nodes that show up at the same time are spread over the frames of their interval
+    state._started = true;
+    state._lastFrame = _frame - (entt::to_entity(entity) % current);
+    isDue = true;
+  }
+  else if (_frame - state._lastFrame >= current) {
+    state._lastFrame = _frame;
+    isDue = true;
+  }
+
+  if (!isDue) {
+    _numSkipped++;
+    return false;
+  }
+
+  delta = state._accumulatedDelta;
+  state._accumulatedDelta = 0.0;
+  _numDue++;
+  return true;
+}
+
+std::uint32_t SignificanceManager::interval(entt::entity entity) const
+{
+  auto* node = currentNodeState(entity);
+  return node ? node->_interval : 1;
+}
+
+SignificanceManager::NodeState& SignificanceManager::nodeState(entt::entity entity)
+{
+  auto index = (std::size_t)entt::to_entity(entity);
+  if (index >= _nodeStates.size()) {
+    _nodeStates.resize(index + 1);
+  }
+
+  // Entity indices are reused, a different version is a different node
+  auto& node = _nodeStates[index];
+  if (node._entity != entity) {
+    node = NodeState{};
+    node._entity = entity;
+  }
+
+  return node;
+}
+
+const SignificanceManager::NodeState* SignificanceManager::currentNodeState(entt::entity entity) const
+{
+  auto index = (std::size_t)entt::to_entity(entity);
+  if (index >= _nodeStates.size()) {
+    return nullptr;
+  }
+
+  auto& node = _nodeStates[index];
+  if (node._entity != entity || node._frame != _frame) {
+    return nullptr;
+  }
+
+  return &node;
+}
+
+void SignificanceManager::updateBudgetScale()
+{
+  const double budget = _settings._budgetMs;
+  _stats._costMs = _costMs;
+
+  if (budget <= 0.0) {
+    _budgetScale = 1.0f;
+  }
+  else if (_costMs > budget) {
+    _budgetScale = std::min(_budgetScale * (float)std::min(_costMs / budget, 2.0), (float)_settings._maxInterval);
+  }
+  else if (_costMs < 0.75 * budget) {
+    // Back off slowly, so that it doesn't oscillate
+    _budgetScale = std::max(_budgetScale * 0.95f, 1.0f);
+  }
+
+  _stats._budgetScale = _budgetScale;
+  _costMs = 0.0;
+}
+
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include "../FrustumCulling.h"
+#include "../../util/Uuid.h"
+
+#include <entt/entt.hpp>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace render { class Camera; }
+
+namespace render::scene {
+
+class Scene;
+
+struct SignificanceSettings
+{
+  float _fullRateDistance = 20.0f; // Meters, closer nodes update every frame
+  float _farDistance = 200.0f; // Meters, from here on nodes update every _farInterval frames
+  float _farInterval = 8.0f;
+  float _invisibleMultiplier = 2.0f; // Nodes outside the camera frustum wait this many times longer
+  std::uint32_t _maxInterval = 32; // Frames, never less often than this regardless of the budget
+
+  // Total time per frame that throttled updates may take, 0 for no budget.
+  // Above it, everything that doesn't update every frame waits longer until the cost is back under.
+  double _budgetMs = 0.0;
+};
+
+struct SignificanceStats
+{
+  std::size_t _numTracked = 0;
+  std::size_t _numVisible = 0;
+  std::size_t _numDue = 0; // Last frame, summed over all clients
+  std::size_t _numSkipped = 0;
+  double _costMs = 0.0; // Last frame, as reported by the clients
+  float _budgetScale = 1.0f;
+};
+
+// Kept by a client per node, e.g. per animator
+struct ThrottleState
+{
+  double _accumulatedDelta = 0.0;
+  std::uint64_t _lastFrame = 0;
+  bool _started = false;
+};
+
+/*
+* Decides how often nodes with behaviours or animators update, from their distance to the camera,
+* whether they are inside its frustum and an importance hint.
+* Nodes that don't update every frame are spread round-robin over the frames of their interval,
+* and get the delta accumulated since their last update when they do.
+* Clients (BehaviourSystem, AnimationUpdater) ask due() per node and report the time their updates took.
+*/
+class SignificanceManager
+{
+public:
+  SignificanceManager() = default;
+  ~SignificanceManager() = default;
+
+  // No copy or move
+  SignificanceManager(const SignificanceManager&) = delete;
+  SignificanceManager(SignificanceManager&&) = delete;
+  SignificanceManager& operator=(const SignificanceManager&) = delete;
+  SignificanceManager& operator=(SignificanceManager&&) = delete;
+
+  void setScene(Scene* scene);
+
+  SignificanceSettings& settings() { return _settings; }
+
+  // Once per frame, before any client updates
+  void update(const render::Camera& camera, double delta);
+  void update(const glm::vec3& viewPos, const glm::mat4& viewProj, double delta);
+
+  // Higher is more often, 2 halves the interval. Runtime only, reset when the node goes away.
+  void setImportance(const util::Uuid& node, float importance);
+
+  // Accumulates this frame's delta into state. True if the node should update this frame, delta is then all that was accumulated.
+  // Nodes that weren't there at the last update() are always due.
+  bool due(entt::entity entity, ThrottleState& state, double& delta);
+
+  // Time the client spent on the nodes that were due, counted against the budget
+  void addCost(double ms) { _costMs += ms; }
+
+  // Frames between updates of entity, as of the last update()
+  std::uint32_t interval(entt::entity entity) const;
+
+  const SignificanceStats& stats() const { return _stats; }
+
+private:
+  struct NodeState
+  {
+    entt::entity _entity = entt::null;
+    std::uint64_t _frame = 0; // Of the update() that set _interval
+    std::uint32_t _interval = 1;
+    float _importance = 1.0f;
+  };
+
+  // Indexed by entity index, so clients can look up nodes without touching the registry
+  NodeState& nodeState(entt::entity entity);
+  const NodeState* currentNodeState(entt::entity entity) const;
+
+  void updateBudgetScale();
+
+  Scene* _scene = nullptr;
+  SignificanceSettings _settings;
+  SignificanceStats _stats;
+
+  std::vector<NodeState> _nodeStates;
+  std::uint64_t _frame = 0;
+  double _delta = 0.0;
+  double _costMs = 0.0;
+  float _budgetScale = 1.0f;
+  std::size_t _numDue = 0;
+  std::size_t _numSkipped = 0;
+
+  // Reused every update
+  std::vector<entt::entity> _entities;
+  SphereBatch _spheres;
+  std::vector<std::uint32_t> _masks;
+  FrustumPlanes _planes;
+};
+
+}
@@ -21,7 +21,7 @@
 namespace {
 
 // The current version if serialising
-constexpr std::uint16_t g_CurrVersion = 5;
+constexpr std::uint16_t g_CurrVersion = 10;
 
 std::uint16_t g_DeserialisedVersion = 0;
 
@@ -206,6 +206,13 @@ namespace bitsery {
     s.value4b(p._radius);
   }
 
+  template <typename S>
+  void serialize(S& s, component::HeightfieldCollider& p)
+  {
+    s.value1b(p._blockSize);
+    s.value1b(p._bitsPerSample);
+  }
+
   template <typename S>
   void serialize(S& s, component::CharacterController& p)
   {
@@ -215,6 +222,10 @@ namespace bitsery {
     if (g_DeserialisedVersion >= 2) {
       s.value4b(p._mass);
     }
+    if (g_DeserialisedVersion >= 9) {
+      s.value4b(p._maxStepHeight);
+      s.value4b(p._groundSnapDistance);
+    }
   }
 
   template <typename S>
@@ -229,6 +240,24 @@ namespace bitsery {
     s.text1b(p._name, 255);
   }
 
+  template <typename S>
+  void serialize(S& s, component::ParticleEmitter& p)
+  {
+    s.value4b(p._maxParticles);
+    s.value4b(p._spawnRate);
+    s.value4b(p._lifetime);
+    s.value4b(p._spawnRadius);
+    s.object(p._minVelocity);
+    s.object(p._maxVelocity);
+    s.value4b(p._minScale);
+    s.value4b(p._maxScale);
+    s.object(p._gravity);
+    s.value1b(p._bounce);
+    s.value4b(p._groundOffset);
+    s.value4b(p._restitution);
+    s.value1b(p._enabled);
+  }
+
   template <typename S>
   void serialize(S& s, component::PotentialComponents& p)
   {
@@ -250,6 +279,12 @@ namespace bitsery {
     if (g_DeserialisedVersion >= 5) {
       s.ext(p._behaviour, bitsery::ext::StdOptional{});
     }
+    if (g_DeserialisedVersion >= 8) {
+      s.ext(p._heightfieldColl, bitsery::ext::StdOptional{});
+    }
+    if (g_DeserialisedVersion >= 10) {
+      s.ext(p._particleEmitter, bitsery::ext::StdOptional{});
+    }
   }
 
   template <typename S>
@@ -277,6 +312,9 @@ namespace bitsery {
     s.container4b(m._indices, 2000000);
     s.object(m._minPos);
     s.object(m._maxPos);
+    if (g_DeserialisedVersion >= 7) {
+      s.container1b(m._bakedCollisionShape, 100'000'000);
+    }
   }
 
   template <typename S>
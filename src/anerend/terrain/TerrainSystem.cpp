@@ -138,6 +138,47 @@ inline glm::vec3 calcAvgNormal(
 
 }
 
+bool TerrainSystem::generateHeights(
+  const component::Terrain& terrainComp,
+  const render::asset::Texture& heightMap,
+  std::vector<float>& heightsOut,
+  unsigned& sampleCountOut,
+  float& sampleStepOut)
+{
+  if (heightMap._format != render::asset::Texture::Format::R16_UNORM) {
+    printf("Unsupported height map format!\n");
+    return false;
+  }
+
+  if (heightMap._width != heightMap._height || heightMap._data.empty()) {
+    printf("Only support square heightmaps!\n");
+    return false;
+  }
+
+  unsigned gridWidthMeters = render::scene::Tile::_tileSize;
+  glm::ivec2 tileIdx = terrainComp._tileIndex;
+
+  float ppm = 1.0f / terrainComp._mpp;
+  int startX = (int)(tileIdx.x * gridWidthMeters * ppm);
+  int startY = (int)(tileIdx.y * gridWidthMeters * ppm);
+  unsigned w = (unsigned)(gridWidthMeters * ppm);
+  float vertStepMeters = (float)gridWidthMeters / (float)w;
+  auto* p = reinterpret_cast<const std::uint16_t*>(heightMap._data[0].data());
+
+  sampleCountOut = w + 1;
+  sampleStepOut = vertStepMeters;
+  heightsOut.resize(sampleCountOut * sampleCountOut);
+
+  for (int y = startY; y <= (int)w + startY; ++y) {
+    for (int x = startX; x <= (int)w + startX; ++x) {
+      auto pos = posFromPixel(p, vertStepMeters, startX, startY, heightMap._width, heightMap._height, x, y);
+      heightsOut[(y - startY) * sampleCountOut + (x - startX)] = pos.y;
+    }
+  }
+
+  return true;
+}
+
 void TerrainSystem::generateModel(util::Uuid& node)
 {
   auto& terrainComp = _scene->registry().getComponent<component::Terrain>(node);
@@ -2,6 +2,8 @@
 
 #include <entt/entt.hpp>
 
+#include <vector>
+
 namespace util {
   class Uuid;
 }
@@ -12,6 +14,11 @@ namespace render::scene {
 
 namespace render::asset {
   class AssetCollection;
+  struct Texture;
+}
+
+namespace component {
+  struct Terrain;
 }
 
 namespace terrain {
@@ -33,6 +40,15 @@ public:
 
   void update();
 
+  // Heights of the tile as (sampleCount x sampleCount) samples, rows along z, sampleStep meters apart.
+  // Same heights as the vertices of the generated model, so that colliders match what is rendered.
+  static bool generateHeights(
+    const component::Terrain& terrainComp,
+    const render::asset::Texture& heightMap,
+    std::vector<float>& heightsOut,
+    unsigned& sampleCountOut,
+    float& sampleStepOut);
+
 private:
   void generateModel(util::Uuid& node);
 
@@ -0,0 +1,1164 @@
+#include "BlockCompressor.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <thread>
+
+namespace util {
+
+namespace {
+
+typedef std::array<glm::ivec4, 16> Texels;
+
+const int g_weights2[] = { 0, 21, 43, 64 };
+const int g_weights3[] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+const int g_weights4[] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+// BC7 two subset partitions, bit i set means texel i belongs to subset 1
+const std::uint16_t g_partitions2[64] = {
+  0xCCCC, 0x8888, 0xEEEE, 0xECC8, 0xC880, 0xFEEC, 0xFEC8, 0xEC80,
+  0xC800, 0xFFEC, 0xFE80, 0xE800, 0xFFE8, 0xFF00, 0xFFF0, 0xF000,
+  0xF710, 0x008E, 0x7100, 0x08CE, 0x008C, 0x7310, 0x3100, 0x8CCE,
+  0x088C, 0x3110, 0x6666, 0x366C, 0x17E8, 0x0FF0, 0x718E, 0x399C,
+  0xAAAA, 0xF0F0, 0x5A5A, 0x33CC, 0x3C3C, 0x55AA, 0x9696, 0xA55A,
+  0x73CE, 0x13C8, 0x324C, 0x3BDC, 0x6996, 0xC33C, 0x9966, 0x0660,
+  0x0272, 0x04E4, 0x4E40, 0x2720, 0xC936, 0x936C, 0x39C6, 0x639C,
+  0x9336, 0x9CC6, 0x817E, 0xE718, 0xCCF0, 0x0FCC, 0x7744, 0xEE22
+};
+
+// Anchor texel of subset 1 for each two subset partition (subset 0 is always anchored at texel 0)
+const std::uint8_t g_anchors2[64] = {
+  15, 15, 15, 15, 15, 15, 15, 15,
+  15, 15, 15, 15, 15, 15, 15, 15,
+  15,  2,  8,  2,  2,  8,  8, 15,
+   2,  8,  2,  2,  8,  8,  2,  2,
+  15, 15,  6,  8,  2,  8, 15, 15,
+   2,  8,  2,  2,  2, 15, 15,  6,
+   6,  2,  6,  8, 15, 15,  2,  2,
+  15, 15, 15, 15, 15,  2,  2, 15
+};
+
+// Writes up to 128 bits LSB first
+class BitWriter
+{
+public:
+  explicit BitWriter(std::uint8_t* out)
+    : _out(out)
+  {
+    std::memset(_out, 0, 16);
+  }
+
+  void write(std::uint32_t value, unsigned numBits)
+  {
+    for (unsigned i = 0; i < numBits; ++i, ++_pos) {
+      if (value & (1u << i)) {
+        _out[_pos >> 3] |= std::uint8_t(1u << (_pos & 7));
+      }
+    }
+  }
+
+private:
+  std::uint8_t* _out;
+  unsigned _pos = 0;
+};
+
+int texelError(const glm::ivec4& a, const glm::ivec4& b, unsigned chanBegin, unsigned chanEnd)
+{
+  int err = 0;
+  for (unsigned c = chanBegin; c < chanEnd; ++c) {
+    int d = a[c] - b[c];
+    err += d * d;
+  }
+  return err;
+}
+
+// Picks the closest palette entry for every listed texel, returns the summed squared error
+int assignIndices(
+  const Texels& texels, const std::uint8_t* subset, unsigned count,
+  const glm::ivec4* palette, unsigned paletteSize,
+  unsigned chanBegin, unsigned chanEnd,
+  std::uint8_t* indices)
+{
+  int total = 0;
+  for (unsigned i = 0; i < count; ++i) {
+    unsigned t = subset[i];
+    int bestErr = std::numeric_limits<int>::max();
+    for (unsigned p = 0; p < paletteSize; ++p) {
+      int err = texelError(texels[t], palette[p], chanBegin, chanEnd);
+      if (err < bestErr) {
+        bestErr = err;
+        indices[t] = std::uint8_t(p);
+      }
+    }
+    total += bestErr;
+  }
+  return total;
+}
+
+// Mean and principal axis (power iteration on the covariance) of the listed texels.
+// Channels outside [chanBegin, chanEnd) are ignored.
+void principalAxis(
+  const Texels& texels, const std::uint8_t* subset, unsigned count,
+  unsigned chanBegin, unsigned chanEnd,
+  glm::vec4& mean, glm::vec4& axis)
+{
+  glm::vec4 mask(0.0f);
+  for (unsigned c = chanBegin; c < chanEnd; ++c) mask[c] = 1.0f;
+
+  mean = glm::vec4(0.0f);
+  glm::vec4 lo(255.0f), hi(0.0f);
+  for (unsigned i = 0; i < count; ++i) {
+    glm::vec4 p = glm::vec4(texels[subset[i]]) * mask;
+    mean += p;
+    lo = glm::min(lo, p);
+    hi = glm::max(hi, p);
+  }
+  mean /= float(count);
+
+  glm::mat4 cov(0.0f);
+  for (unsigned i = 0; i < count; ++i) {
+    glm::vec4 d = glm::vec4(texels[subset[i]]) * mask - mean;
+    cov += glm::outerProduct(d, d);
+  }
+
+  axis = (hi - lo) * mask;
+  if (glm::dot(axis, axis) < 1e-6f) {
+    axis = glm::vec4(0.0f);
+    return;
+  }
+  axis = glm::normalize(axis);
+
+  for (int i = 0; i < 8; ++i) {
+    glm::vec4 next = cov * axis;
+    float len = glm::length(next);
+    if (len < 1e-6f) break;
+    axis = next / len;
+  }
+}
+
+// Endpoints at the extremes of the projection onto the principal axis
+void axisEndpoints(
+  const Texels& texels, const std::uint8_t* subset, unsigned count,
+  unsigned chanBegin, unsigned chanEnd,
+  glm::vec4& e0, glm::vec4& e1)
+{
+  glm::vec4 mean, axis;
+  principalAxis(texels, subset, count, chanBegin, chanEnd, mean, axis);
+
+  float tMin = 0.0f, tMax = 0.0f;
+  for (unsigned i = 0; i < count; ++i) {
+    float t = glm::dot(glm::vec4(texels[subset[i]]) - mean, axis);
+    tMin = std::min(tMin, t);
+    tMax = std::max(tMax, t);
+  }
+
+  e0 = glm::clamp(mean + axis * tMin, 0.0f, 255.0f);
+  e1 = glm::clamp(mean + axis * tMax, 0.0f, 255.0f);
+}
+
+// Least squares fit of texel ~ (1 - t) * e0 + t * e1 for fixed per texel interpolation factors t.
+// Returns false if the system is degenerate (all texels on one endpoint).
+bool leastSquaresEndpoints(
+  const Texels& texels, const std::uint8_t* subset, unsigned count, const float* t,
+  glm::vec4& e0, glm::vec4& e1)
+{
+  float a = 0.0f, b = 0.0f, c = 0.0f;
+  glm::vec4 x0(0.0f), x1(0.0f);
+
+  for (unsigned i = 0; i < count; ++i) {
+    float w1 = t[i];
+    float w0 = 1.0f - w1;
+    glm::vec4 p(texels[subset[i]]);
+    a += w0 * w0;
+    b += w0 * w1;
+    c += w1 * w1;
+    x0 += w0 * p;
+    x1 += w1 * p;
+  }
+
+  float det = a * c - b * b;
+  if (std::abs(det) < 1e-6f) {
+    return false;
+  }
+
+  e0 = glm::clamp((c * x0 - b * x1) / det, 0.0f, 255.0f);
+  e1 = glm::clamp((a * x1 - b * x0) / det, 0.0f, 255.0f);
+  return true;
+}
+
+unsigned iterationsFor(BCQuality quality)
+{
+  switch (quality) {
+  case BCQuality::Fast: return 0;
+  case BCQuality::Normal: return 1;
+  default: return 4;
+  }
+}
+
+// ---------- BC4 ----------
+
+void bc4Palette(int e0, int e1, int* palette)
+{
+  palette[0] = e0;
+  palette[1] = e1;
+  if (e0 > e1) {
+    for (int i = 2; i < 8; ++i) {
+      palette[i] = ((8 - i) * e0 + (i - 1) * e1 + 3) / 7;
+    }
+  }
+  else {
+    for (int i = 2; i < 6; ++i) {
+      palette[i] = ((6 - i) * e0 + (i - 1) * e1 + 2) / 5;
+    }
+    palette[6] = 0;
+    palette[7] = 255;
+  }
+}
+
+int bc4Evaluate(const int* values, int e0, int e1, std::uint8_t* indices)
+{
+  int palette[8];
+  bc4Palette(e0, e1, palette);
+
+  int total = 0;
+  for (unsigned i = 0; i < 16; ++i) {
+    int bestErr = std::numeric_limits<int>::max();
+    for (unsigned p = 0; p < 8; ++p) {
+      int d = values[i] - palette[p];
+      if (d * d < bestErr) {
+        bestErr = d * d;
+        indices[i] = std::uint8_t(p);
+      }
+    }
+    total += bestErr;
+  }
+  return total;
+}
+
+// values are 16 texels of a single channel, writes 8 bytes and the decoded values
+void encodeBC4(const int* values, BCQuality quality, std::uint8_t* out, int* decoded)
+{
+  int lo = 255, hi = 0;
+  int innerLo = 255, innerHi = 0;
+  for (unsigned i = 0; i < 16; ++i) {
+    lo = std::min(lo, values[i]);
+    hi = std::max(hi, values[i]);
+    if (values[i] != 0 && values[i] != 255) {
+      innerLo = std::min(innerLo, values[i]);
+      innerHi = std::max(innerHi, values[i]);
+    }
+  }
+
+  int bestE0 = hi, bestE1 = lo;
+  std::uint8_t bestIndices[16];
+  int bestErr = bc4Evaluate(values, bestE0, bestE1, bestIndices);
+
+  auto tryEndpoints = [&](int e0, int e1) {
+    std::uint8_t indices[16];
+    int err = bc4Evaluate(values, e0, e1, indices);
+    if (err < bestErr) {
+      bestErr = err;
+      bestE0 = e0;
+      bestE1 = e1;
+      std::memcpy(bestIndices, indices, 16);
+    }
+  };
+
+  if (quality != BCQuality::Fast && bestErr > 0) {
+    // 6 value mode, 0 and 255 come for free
+    if (innerLo <= innerHi) {
+      tryEndpoints(innerLo, innerHi);
+    }
+
+    // Refine the 8 value mode
+    for (unsigned it = 0; it < iterationsFor(quality) && bestE0 > bestE1; ++it) {
+      float a = 0.0f, b = 0.0f, c = 0.0f, x0 = 0.0f, x1 = 0.0f;
+      for (unsigned i = 0; i < 16; ++i) {
+        unsigned idx = bestIndices[i];
+        float w1 = idx == 0 ? 0.0f : (idx == 1 ? 1.0f : float(idx - 1) / 7.0f);
+        float w0 = 1.0f - w1;
+        a += w0 * w0;
+        b += w0 * w1;
+        c += w1 * w1;
+        x0 += w0 * values[i];
+        x1 += w1 * values[i];
+      }
+      float det = a * c - b * b;
+      if (std::abs(det) < 1e-6f) break;
+
+      int e0 = std::clamp(int(std::lround((c * x0 - b * x1) / det)), 0, 255);
+      int e1 = std::clamp(int(std::lround((a * x1 - b * x0) / det)), 0, 255);
+      if (e0 <= e1) break;
+
+      int prevErr = bestErr;
+      tryEndpoints(e0, e1);
+      if (bestErr >= prevErr) break;
+    }
+
+    if (quality == BCQuality::High) {
+      int baseE0 = bestE0, baseE1 = bestE1;
+      for (int d0 = -2; d0 <= 2; ++d0) {
+        for (int d1 = -2; d1 <= 2; ++d1) {
+          tryEndpoints(std::clamp(baseE0 + d0, 0, 255), std::clamp(baseE1 + d1, 0, 255));
+        }
+      }
+    }
+  }
+
+  out[0] = std::uint8_t(bestE0);
+  out[1] = std::uint8_t(bestE1);
+
+  std::uint64_t bits = 0;
+  for (unsigned i = 0; i < 16; ++i) {
+    bits |= std::uint64_t(bestIndices[i]) << (3 * i);
+  }
+  for (unsigned i = 0; i < 6; ++i) {
+    out[2 + i] = std::uint8_t(bits >> (8 * i));
+  }
+
+  int palette[8];
+  bc4Palette(bestE0, bestE1, palette);
+  for (unsigned i = 0; i < 16; ++i) {
+    decoded[i] = palette[bestIndices[i]];
+  }
+}
+
+// ---------- BC1 ----------
+
+std::uint16_t packColor565(const glm::ivec3& c)
+{
+  return std::uint16_t((c.r << 11) | (c.g << 5) | c.b);
+}
+
+glm::ivec4 unpackColor565(std::uint16_t c)
+{
+  int r = (c >> 11) & 31;
+  int g = (c >> 5) & 63;
+  int b = c & 31;
+  return glm::ivec4((r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2), 255);
+}
+
+glm::ivec3 unpackQuantized565(std::uint16_t c)
+{
+  return glm::ivec3((c >> 11) & 31, (c >> 5) & 63, c & 31);
+}
+
+glm::ivec3 quantize565(const glm::vec4& c)
+{
+  return glm::ivec3(
+    std::clamp(int(std::lround(c.r * 31.0f / 255.0f)), 0, 31),
+    std::clamp(int(std::lround(c.g * 63.0f / 255.0f)), 0, 63),
+    std::clamp(int(std::lround(c.b * 31.0f / 255.0f)), 0, 31));
+}
+
+struct BC1Candidate
+{
+  std::uint16_t _c0 = 0;
+  std::uint16_t _c1 = 0;
+  std::uint8_t _indices[16] = {};
+  int _err = std::numeric_limits<int>::max();
+};
+
+// Three color mode (c0 <= c1) is only used when texels need the transparent index,
+// or for BC1 when it happens to fit better. BC3 always decodes four colors.
+void bc1Palette(std::uint16_t c0, std::uint16_t c1, bool fourColor, glm::ivec4* palette)
+{
+  palette[0] = unpackColor565(c0);
+  palette[1] = unpackColor565(c1);
+  if (fourColor) {
+    palette[2] = (2 * palette[0] + palette[1]) / 3;
+    palette[3] = (palette[0] + 2 * palette[1]) / 3;
+  }
+  else {
+    palette[2] = (palette[0] + palette[1]) / 2;
+    palette[3] = glm::ivec4(0);
+  }
+}
+
+void bc1Evaluate(
+  const Texels& texels, const std::uint8_t* opaque, unsigned numOpaque,
+  glm::ivec3 q0, glm::ivec3 q1, bool threeColor, bool bc3, BC1Candidate& cand)
+{
+  std::uint16_t c0 = packColor565(q0);
+  std::uint16_t c1 = packColor565(q1);
+
+  if (threeColor) {
+    if (c0 > c1) std::swap(c0, c1);
+  }
+  else if (c0 < c1) {
+    std::swap(c0, c1);
+  }
+
+  // c0 == c1 decodes as three color in BC1, only the first three entries are usable then
+  bool fourColor = bc3 || c0 > c1;
+
+  glm::ivec4 palette[4];
+  bc1Palette(c0, c1, fourColor, palette);
+
+  cand._c0 = c0;
+  cand._c1 = c1;
+  std::memset(cand._indices, 3, 16); // Transparent in three color mode
+  cand._err = assignIndices(texels, opaque, numOpaque, palette, fourColor ? 4 : 3, 0, 3, cand._indices);
+}
+
+// Interpolation factor towards c1 of each palette index
+float bc1Weight(unsigned index, bool threeColor)
+{
+  if (index == 0) return 0.0f;
+  if (index == 1) return 1.0f;
+  if (threeColor) return 0.5f;
+  return index == 2 ? 1.0f / 3.0f : 2.0f / 3.0f;
+}
+
+BC1Candidate fitBC1(
+  const Texels& texels, const std::uint8_t* opaque, unsigned numOpaque,
+  bool threeColor, bool bc3, BCQuality quality)
+{
+  BC1Candidate best;
+
+  glm::vec4 e0, e1;
+  axisEndpoints(texels, opaque, numOpaque, 0, 3, e0, e1);
+  glm::ivec3 q0 = quantize565(e0);
+  glm::ivec3 q1 = quantize565(e1);
+  bc1Evaluate(texels, opaque, numOpaque, q0, q1, threeColor, bc3, best);
+
+  for (unsigned it = 0; it < iterationsFor(quality) && best._err > 0; ++it) {
+    bool bestFourColor = bc3 || best._c0 > best._c1;
+    float t[16];
+    for (unsigned i = 0; i < numOpaque; ++i) {
+      t[i] = bc1Weight(best._indices[opaque[i]], !bestFourColor);
+    }
+    if (!leastSquaresEndpoints(texels, opaque, numOpaque, t, e0, e1)) break;
+
+    BC1Candidate cand;
+    bc1Evaluate(texels, opaque, numOpaque, quantize565(e0), quantize565(e1), threeColor, bc3, cand);
+    if (cand._err >= best._err) break;
+    best = cand;
+  }
+
+  if (quality == BCQuality::High && best._err > 0) {
+    const glm::ivec3 maxQ(31, 63, 31);
+    bool improved = true;
+    for (int pass = 0; pass < 2 && improved; ++pass) {
+      improved = false;
+      glm::ivec3 base[2] = { unpackQuantized565(best._c0), unpackQuantized565(best._c1) };
+
+      for (int e = 0; e < 2; ++e) {
+        for (int c = 0; c < 3; ++c) {
+          for (int d = -1; d <= 1; d += 2) {
+            glm::ivec3 q[2] = { base[0], base[1] };
+            q[e][c] = std::clamp(q[e][c] + d, 0, maxQ[c]);
+
+            BC1Candidate cand;
+            bc1Evaluate(texels, opaque, numOpaque, q[0], q[1], threeColor, bc3, cand);
+            if (cand._err < best._err) {
+              best = cand;
+              improved = true;
+            }
+          }
+        }
+      }
+    }
+  }
+
+  return best;
+}
+
+// Color part of BC1 and BC3. For BC1, texels with alpha < 128 use the transparent index.
+void encodeBC1(const Texels& texels, BCQuality quality, bool bc3, std::uint8_t* out, Texels& decoded)
+{
+  std::uint8_t opaque[16];
+  unsigned numOpaque = 0;
+  for (std::uint8_t i = 0; i < 16; ++i) {
+    if (bc3 || texels[i].a >= 128) {
+      opaque[numOpaque++] = i;
+    }
+  }
+  bool needsTransparent = numOpaque < 16;
+
+  BC1Candidate best;
+  if (numOpaque == 0) {
+    std::memset(best._indices, 3, 16);
+  }
+  else {
+    best = fitBC1(texels, opaque, numOpaque, needsTransparent, bc3, quality);
+    if (!bc3 && !needsTransparent && quality == BCQuality::High) {
+      auto cand = fitBC1(texels, opaque, numOpaque, true, bc3, quality);
+      if (cand._err < best._err) best = cand;
+    }
+  }
+
+  out[0] = std::uint8_t(best._c0);
+  out[1] = std::uint8_t(best._c0 >> 8);
+  out[2] = std::uint8_t(best._c1);
+  out[3] = std::uint8_t(best._c1 >> 8);
+
+  std::uint32_t bits = 0;
+  for (unsigned i = 0; i < 16; ++i) {
+    bits |= std::uint32_t(best._indices[i]) << (2 * i);
+  }
+  std::memcpy(out + 4, &bits, 4);
+
+  glm::ivec4 palette[4];
+  bc1Palette(best._c0, best._c1, bc3 || best._c0 > best._c1, palette);
+  for (unsigned i = 0; i < 16; ++i) {
+    decoded[i] = palette[best._indices[i]];
+  }
+}
+
+// ---------- BC7 ----------
+
+// Expands a quantized endpoint channel (with optional p-bit) to 8 bits
+int bc7Unquantize(int q, int p, unsigned bits, bool pbit)
+{
+  int v = pbit ? (q << 1) | p : q;
+  unsigned n = bits + (pbit ? 1 : 0);
+  if (n >= 8) return v;
+  return (v << (8 - n)) | (v >> (2 * n - 8));
+}
+
+int bc7Quantize(float v, int p, unsigned bits, bool pbit)
+{
+  int maxQ = (1 << bits) - 1;
+  int guess = int(std::lround(v / 255.0f * float(maxQ)));
+
+  int best = 0;
+  float bestDiff = std::numeric_limits<float>::max();
+  for (int q = std::max(0, guess - 1); q <= std::min(maxQ, guess + 1); ++q) {
+    float diff = std::abs(float(bc7Unquantize(q, p, bits, pbit)) - v);
+    if (diff < bestDiff) {
+      bestDiff = diff;
+      best = q;
+    }
+  }
+  return best;
+}
+
+enum class PBits
+{
+  None,
+  Shared, // One p-bit per subset
+  Unique  // One p-bit per endpoint
+};
+
+// Endpoint precision and index precision of one BC7 subset fit
+struct SubsetDesc
+{
+  unsigned _chanBegin;
+  unsigned _chanEnd;
+  unsigned _bits;
+  PBits _pbits;
+  unsigned _indexBits;
+};
+
+struct SubsetFit
+{
+  glm::ivec4 _q[2] = {};
+  int _p[2] = {};
+  glm::ivec4 _e[2] = {}; // Unquantized
+  std::uint8_t _indices[16] = {};
+  int _err = std::numeric_limits<int>::max();
+};
+
+const int* bc7Weights(unsigned indexBits)
+{
+  return indexBits == 2 ? g_weights2 : (indexBits == 3 ? g_weights3 : g_weights4);
+}
+
+void bc7Palette(const glm::ivec4& e0, const glm::ivec4& e1, unsigned indexBits, glm::ivec4* palette)
+{
+  const int* w = bc7Weights(indexBits);
+  for (unsigned i = 0; i < (1u << indexBits); ++i) {
+    palette[i] = ((64 - w[i]) * e0 + w[i] * e1 + 32) >> 6;
+  }
+}
+
+void bc7EvaluateQuantized(
+  const Texels& texels, const std::uint8_t* subset, unsigned count,
+  const SubsetDesc& desc, const glm::ivec4* q, const int* p, SubsetFit& fit)
+{
+  bool pbit = desc._pbits != PBits::None;
+  for (unsigned e = 0; e < 2; ++e) {
+    fit._q[e] = q[e];
+    fit._p[e] = p[e];
+    fit._e[e] = glm::ivec4(255);
+    for (unsigned c = desc._chanBegin; c < desc._chanEnd; ++c) {
+      fit._e[e][c] = bc7Unquantize(q[e][c], p[e], desc._bits, pbit);
+    }
+  }
+
+  glm::ivec4 palette[16];
+  bc7Palette(fit._e[0], fit._e[1], desc._indexBits, palette);
+  fit._err = assignIndices(texels, subset, count, palette, 1u << desc._indexBits, desc._chanBegin, desc._chanEnd, fit._indices);
+}
+
+// Quantizes float endpoints, trying every allowed p-bit combination
+void bc7EvaluateFloat(
+  const Texels& texels, const std::uint8_t* subset, unsigned count,
+  const SubsetDesc& desc, const glm::vec4& e0, const glm::vec4& e1, SubsetFit& best)
+{
+  unsigned numCombos = desc._pbits == PBits::None ? 1 : (desc._pbits == PBits::Shared ? 2 : 4);
+  bool pbit = desc._pbits != PBits::None;
+
+  for (unsigned combo = 0; combo < numCombos; ++combo) {
+    int p[2];
+    if (desc._pbits == PBits::Shared) {
+      p[0] = p[1] = int(combo);
+    }
+    else {
+      p[0] = int(combo & 1);
+      p[1] = int(combo >> 1);
+    }
+
+    glm::ivec4 q[2] = { glm::ivec4(0), glm::ivec4(0) };
+    for (unsigned c = desc._chanBegin; c < desc._chanEnd; ++c) {
+      q[0][c] = bc7Quantize(e0[c], p[0], desc._bits, pbit);
+      q[1][c] = bc7Quantize(e1[c], p[1], desc._bits, pbit);
+    }
+
+    SubsetFit fit;
+    bc7EvaluateQuantized(texels, subset, count, desc, q, p, fit);
+    if (fit._err < best._err) {
+      best = fit;
+    }
+  }
+}
+
+SubsetFit fitSubset(
+  const Texels& texels, const std::uint8_t* subset, unsigned count,
+  const SubsetDesc& desc, BCQuality quality)
+{
+  SubsetFit best;
+
+  glm::vec4 e0, e1;
+  axisEndpoints(texels, subset, count, desc._chanBegin, desc._chanEnd, e0, e1);
+  bc7EvaluateFloat(texels, subset, count, desc, e0, e1, best);
+
+  const int* w = bc7Weights(desc._indexBits);
+  for (unsigned it = 0; it < iterationsFor(quality) && best._err > 0; ++it) {
+    float t[16];
+    for (unsigned i = 0; i < count; ++i) {
+      t[i] = float(w[best._indices[subset[i]]]) / 64.0f;
+    }
+    if (!leastSquaresEndpoints(texels, subset, count, t, e0, e1)) break;
+
+    int prevErr = best._err;
+    bc7EvaluateFloat(texels, subset, count, desc, e0, e1, best);
+    if (best._err >= prevErr) break;
+  }
+
+  if (quality == BCQuality::High && best._err > 0) {
+    int maxQ = (1 << desc._bits) - 1;
+    bool improved = true;
+    for (int pass = 0; pass < 2 && improved; ++pass) {
+      improved = false;
+      for (unsigned e = 0; e < 2; ++e) {
+        for (unsigned c = desc._chanBegin; c < desc._chanEnd; ++c) {
+          for (int d = -1; d <= 1; d += 2) {
+            glm::ivec4 q[2] = { best._q[0], best._q[1] };
+            q[e][c] = std::clamp(q[e][c] + d, 0, maxQ);
+
+            SubsetFit fit;
+            bc7EvaluateQuantized(texels, subset, count, desc, q, best._p, fit);
+            if (fit._err < best._err) {
+              best = fit;
+              improved = true;
+            }
+          }
+        }
+      }
+    }
+  }
+
+  return best;
+}
+
+// The anchor texel of every subset must have the index MSB clear, swap endpoints otherwise
+void fixAnchor(SubsetFit& fit, const std::uint8_t* subset, unsigned count, unsigned anchor, unsigned indexBits, bool swapPBits)
+{
+  unsigned maxIndex = (1u << indexBits) - 1;
+  if (fit._indices[anchor] <= maxIndex / 2) return;
+
+  std::swap(fit._q[0], fit._q[1]);
+  std::swap(fit._e[0], fit._e[1]);
+  if (swapPBits) std::swap(fit._p[0], fit._p[1]);
+
+  for (unsigned i = 0; i < count; ++i) {
+    fit._indices[subset[i]] = std::uint8_t(maxIndex - fit._indices[subset[i]]);
+  }
+}
+
+void writeIndices(BitWriter& writer, const std::uint8_t* indices, unsigned indexBits, unsigned anchor0, unsigned anchor1)
+{
+  for (unsigned i = 0; i < 16; ++i) {
+    bool anchor = i == anchor0 || i == anchor1;
+    writer.write(indices[i], anchor ? indexBits - 1 : indexBits);
+  }
+}
+
+struct BC7Result
+{
+  std::uint8_t _bits[16];
+  Texels _decoded;
+  int _err = std::numeric_limits<int>::max();
+};
+
+// Mode 6: single subset RGBA, 7 bit endpoints + unique p-bits, 4 bit indices
+void encodeBC7Mode6(const Texels& texels, BCQuality quality, BC7Result& out)
+{
+  const std::uint8_t all[16] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 };
+  const SubsetDesc desc{ 0, 4, 7, PBits::Unique, 4 };
+
+  auto fit = fitSubset(texels, all, 16, desc, quality);
+  fixAnchor(fit, all, 16, 0, 4, true);
+
+  BitWriter writer(out._bits);
+  writer.write(1u << 6, 7);
+  for (unsigned c = 0; c < 4; ++c) {
+    writer.write(fit._q[0][c], 7);
+    writer.write(fit._q[1][c], 7);
+  }
+  writer.write(fit._p[0], 1);
+  writer.write(fit._p[1], 1);
+  writeIndices(writer, fit._indices, 4, 0, 16);
+
+  glm::ivec4 palette[16];
+  bc7Palette(fit._e[0], fit._e[1], 4, palette);
+  for (unsigned i = 0; i < 16; ++i) {
+    out._decoded[i] = palette[fit._indices[i]];
+  }
+  out._err = fit._err;
+}
+
+// Mode 5: single subset with separately interpolated alpha, 7 bit color / 8 bit alpha endpoints, 2 bit indices
+void encodeBC7Mode5(const Texels& texels, BCQuality quality, BC7Result& out)
+{
+  const std::uint8_t all[16] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 };
+  const SubsetDesc colorDesc{ 0, 3, 7, PBits::None, 2 };
+  const SubsetDesc alphaDesc{ 3, 4, 8, PBits::None, 2 };
+
+  auto color = fitSubset(texels, all, 16, colorDesc, quality);
+  auto alpha = fitSubset(texels, all, 16, alphaDesc, quality);
+  fixAnchor(color, all, 16, 0, 2, false);
+  fixAnchor(alpha, all, 16, 0, 2, false);
+
+  BitWriter writer(out._bits);
+  writer.write(1u << 5, 6);
+  writer.write(0, 2); // No channel rotation
+  for (unsigned c = 0; c < 3; ++c) {
+    writer.write(color._q[0][c], 7);
+    writer.write(color._q[1][c], 7);
+  }
+  writer.write(alpha._q[0][3], 8);
+  writer.write(alpha._q[1][3], 8);
+  writeIndices(writer, color._indices, 2, 0, 16);
+  writeIndices(writer, alpha._indices, 2, 0, 16);
+
+  glm::ivec4 colorPalette[4], alphaPalette[4];
+  bc7Palette(color._e[0], color._e[1], 2, colorPalette);
+  bc7Palette(alpha._e[0], alpha._e[1], 2, alphaPalette);
+  for (unsigned i = 0; i < 16; ++i) {
+    out._decoded[i] = colorPalette[color._indices[i]];
+    out._decoded[i].a = alphaPalette[alpha._indices[i]].a;
+  }
+  out._err = color._err + alpha._err;
+}
+
+void partitionSubsets(unsigned partition, std::uint8_t subsets[2][16], unsigned counts[2])
+{
+  counts[0] = counts[1] = 0;
+  for (std::uint8_t i = 0; i < 16; ++i) {
+    unsigned s = (g_partitions2[partition] >> i) & 1;
+    subsets[s][counts[s]++] = i;
+  }
+}
+
+// Mode 1: two subsets RGB, 6 bit endpoints + shared p-bits, 3 bit indices. Opaque blocks only.
+void encodeBC7Mode1(const Texels& texels, unsigned partition, BCQuality quality, BC7Result& out)
+{
+  const SubsetDesc desc{ 0, 3, 6, PBits::Shared, 3 };
+
+  std::uint8_t subsets[2][16];
+  unsigned counts[2];
+  partitionSubsets(partition, subsets, counts);
+
+  SubsetFit fits[2];
+  std::uint8_t indices[16];
+  const unsigned anchors[2] = { 0, g_anchors2[partition] };
+  for (unsigned s = 0; s < 2; ++s) {
+    fits[s] = fitSubset(texels, subsets[s], counts[s], desc, quality);
+    fixAnchor(fits[s], subsets[s], counts[s], anchors[s], 3, false);
+    for (unsigned i = 0; i < counts[s]; ++i) {
+      indices[subsets[s][i]] = fits[s]._indices[subsets[s][i]];
+    }
+  }
+
+  BitWriter writer(out._bits);
+  writer.write(1u << 1, 2);
+  writer.write(partition, 6);
+  for (unsigned c = 0; c < 3; ++c) {
+    for (unsigned s = 0; s < 2; ++s) {
+      writer.write(fits[s]._q[0][c], 6);
+      writer.write(fits[s]._q[1][c], 6);
+    }
+  }
+  writer.write(fits[0]._p[0], 1);
+  writer.write(fits[1]._p[0], 1);
+  writeIndices(writer, indices, 3, anchors[0], anchors[1]);
+
+  for (unsigned s = 0; s < 2; ++s) {
+    glm::ivec4 palette[8];
+    bc7Palette(fits[s]._e[0], fits[s]._e[1], 3, palette);
+    for (unsigned i = 0; i < counts[s]; ++i) {
+      out._decoded[subsets[s][i]] = palette[indices[subsets[s][i]]];
+    }
+  }
+  out._err = fits[0]._err + fits[1]._err;
+}
+
+// Ranks a partition by the squared distance of each subset's texels to its principal axis.
+// Ignores quantization, but is cheap enough to run for all 64 partitions.
+float estimatePartition(const Texels& texels, unsigned partition)
+{
+  float err = 0.0f;
+  for (unsigned s = 0; s < 2; ++s) {
+    glm::vec3 sum(0.0f);
+    glm::mat3 sumSq(0.0f);
+    unsigned count = 0;
+    for (unsigned i = 0; i < 16; ++i) {
+      if (((g_partitions2[partition] >> i) & 1) != s) continue;
+      glm::vec3 p(texels[i]);
+      sum += p;
+      sumSq += glm::outerProduct(p, p);
+      count++;
+    }
+
+    glm::vec3 mean = sum / float(count);
+    glm::mat3 cov = sumSq - float(count) * glm::outerProduct(mean, mean);
+
+    glm::vec3 axis(1.0f);
+    for (int i = 0; i < 4; ++i) {
+      glm::vec3 next = cov * axis;
+      float len = glm::length(next);
+      if (len < 1e-6f) break;
+      axis = next / len;
+    }
+
+    float variance = cov[0][0] + cov[1][1] + cov[2][2];
+    err += variance - glm::dot(axis, cov * axis) / glm::dot(axis, axis);
+  }
+  return err;
+}
+
+void encodeBC7(const Texels& texels, BCQuality quality, std::uint8_t* out, Texels& decoded)
+{
+  BC7Result best;
+  encodeBC7Mode6(texels, quality, best);
+
+  bool opaque = true;
+  for (auto& t : texels) {
+    opaque = opaque && t.a == 255;
+  }
+
+  if (quality != BCQuality::Fast && best._err > 0) {
+    if (!opaque) {
+      BC7Result cand;
+      encodeBC7Mode5(texels, quality, cand);
+      if (cand._err < best._err) best = cand;
+    }
+    else {
+      std::array<std::pair<float, unsigned>, 64> ranked;
+      for (unsigned p = 0; p < 64; ++p) {
+        ranked[p] = { estimatePartition(texels, p), p };
+      }
+
+      unsigned numCandidates = quality == BCQuality::High ? 8 : 2;
+      std::partial_sort(ranked.begin(), ranked.begin() + numCandidates, ranked.end());
+
+      for (unsigned i = 0; i < numCandidates; ++i) {
+        BC7Result cand;
+        encodeBC7Mode1(texels, ranked[i].second, quality, cand);
+        if (cand._err < best._err) best = cand;
+      }
+    }
+  }
+
+  std::memcpy(out, best._bits, 16);
+  decoded = best._decoded;
+}
+
+// ---------- Images ----------
+
+// One mip (or image) being compressed
+struct LevelJob
+{
+  const std::uint8_t* _src = nullptr;
+  unsigned _width = 0;
+  unsigned _height = 0;
+  unsigned _channels = 0;
+  std::uint8_t* _dst = nullptr;
+};
+
+unsigned blocksX(const LevelJob& level)
+{
+  return (level._width + 3) / 4;
+}
+
+unsigned blocksY(const LevelJob& level)
+{
+  return (level._height + 3) / 4;
+}
+
+// Reads a block, replicating edge texels for sizes that aren't a multiple of 4
+void readBlock(const LevelJob& level, unsigned bx, unsigned by, Texels& texels)
+{
+  for (unsigned y = 0; y < 4; ++y) {
+    unsigned sy = std::min(by * 4 + y, level._height - 1);
+    for (unsigned x = 0; x < 4; ++x) {
+      unsigned sx = std::min(bx * 4 + x, level._width - 1);
+      const std::uint8_t* src = level._src + (std::size_t(sy) * level._width + sx) * level._channels;
+
+      glm::ivec4& t = texels[y * 4 + x];
+      t = glm::ivec4(0, 0, 0, 255);
+      for (unsigned c = 0; c < std::min(level._channels, 4u); ++c) {
+        t[c] = src[c];
+      }
+    }
+  }
+}
+
+unsigned errorChannels(BCFormat format)
+{
+  switch (format) {
+  case BCFormat::BC4: return 1;
+  case BCFormat::BC5: return 2;
+  default: return 4;
+  }
+}
+
+void encodeBlock(const Texels& texels, BCFormat format, BCQuality quality, std::uint8_t* out, Texels& decoded)
+{
+  int values[16];
+  int decodedValues[16];
+
+  switch (format) {
+  case BCFormat::BC1:
+    encodeBC1(texels, quality, false, out, decoded);
+    break;
+  case BCFormat::BC3:
+    for (unsigned i = 0; i < 16; ++i) values[i] = texels[i].a;
+    encodeBC4(values, quality, out, decodedValues);
+    encodeBC1(texels, quality, true, out + 8, decoded);
+    for (unsigned i = 0; i < 16; ++i) decoded[i].a = decodedValues[i];
+    break;
+  case BCFormat::BC4:
+    for (unsigned i = 0; i < 16; ++i) values[i] = texels[i].r;
+    encodeBC4(values, quality, out, decodedValues);
+    for (unsigned i = 0; i < 16; ++i) decoded[i] = glm::ivec4(decodedValues[i], 0, 0, 255);
+    break;
+  case BCFormat::BC5:
+    for (unsigned i = 0; i < 16; ++i) values[i] = texels[i].r;
+    encodeBC4(values, quality, out, decodedValues);
+    for (unsigned i = 0; i < 16; ++i) decoded[i] = glm::ivec4(decodedValues[i], 0, 0, 255);
+    for (unsigned i = 0; i < 16; ++i) values[i] = texels[i].g;
+    encodeBC4(values, quality, out + 8, decodedValues);
+    for (unsigned i = 0; i < 16; ++i) decoded[i].g = decodedValues[i];
+    break;
+  case BCFormat::BC7:
+    encodeBC7(texels, quality, out, decoded);
+    break;
+  }
+}
+
+// Compresses all levels, one job per row of blocks. Returns the PSNR in dB (infinity if lossless).
+double compressLevels(const std::vector<LevelJob>& levels, BCFormat format, const BCOptions& options)
+{
+  struct RowJob
+  {
+    unsigned _level;
+    unsigned _row;
+  };
+
+  std::vector<RowJob> jobs;
+  for (unsigned l = 0; l < levels.size(); ++l) {
+    for (unsigned row = 0; row < blocksY(levels[l]); ++row) {
+      jobs.push_back({ l, row });
+    }
+  }
+
+  unsigned numThreads = options._numThreads;
+  if (numThreads == 0) {
+    numThreads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  numThreads = std::max(1u, std::min(numThreads, (unsigned)jobs.size()));
+
+  std::size_t blockBytes = BlockCompressor::blockSize(format);
+  unsigned numErrChannels = errorChannels(format);
+
+  std::atomic<std::size_t> nextJob = 0;
+  std::vector<double> sqErrors(numThreads, 0.0);
+  std::vector<std::uint64_t> numSamples(numThreads, 0);
+
+  auto worker = [&](unsigned threadIdx) {
+    Texels texels, decoded;
+
+    for (std::size_t j = nextJob++; j < jobs.size(); j = nextJob++) {
+      const auto& level = levels[jobs[j]._level];
+      unsigned by = jobs[j]._row;
+
+      for (unsigned bx = 0; bx < blocksX(level); ++bx) {
+        readBlock(level, bx, by, texels);
+
+        std::uint8_t* out = level._dst + (std::size_t(by) * blocksX(level) + bx) * blockBytes;
+        encodeBlock(texels, format, options._quality, out, decoded);
+
+        // Only texels inside the image count
+        for (unsigned y = 0; y < 4 && by * 4 + y < level._height; ++y) {
+          for (unsigned x = 0; x < 4 && bx * 4 + x < level._width; ++x) {
+            glm::ivec4 reference = texels[y * 4 + x];
+            if (format == BCFormat::BC1) {
+              reference = reference.a < 128 ? glm::ivec4(0) : glm::ivec4(glm::ivec3(reference), 255);
+            }
+            sqErrors[threadIdx] += texelError(reference, decoded[y * 4 + x], 0, numErrChannels);
+            numSamples[threadIdx] += numErrChannels;
+          }
+        }
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (unsigned i = 1; i < numThreads; ++i) {
+    threads.emplace_back(worker, i);
+  }
+  worker(0);
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  double sqErr = 0.0;
+  std::uint64_t samples = 0;
+  for (unsigned i = 0; i < numThreads; ++i) {
+    sqErr += sqErrors[i];
+    samples += numSamples[i];
+  }
+
+  if (samples == 0 || sqErr == 0.0) {
+    return std::numeric_limits<double>::infinity();
+  }
+  double mse = sqErr / double(samples);
+  return 10.0 * std::log10(255.0 * 255.0 / mse);
+}
+
+}
+
+std::size_t BlockCompressor::blockSize(BCFormat format)
+{
+  return (format == BCFormat::BC1 || format == BCFormat::BC4) ? 8 : 16;
+}
+
+std::vector<std::uint8_t> BlockCompressor::compressImage(
+  const std::uint8_t* data,
+  unsigned w,
+  unsigned h,
+  unsigned channels,
+  BCFormat format,
+  const BCOptions& options,
+  double* psnrOut)
+{
+  std::vector<std::uint8_t> out;
+  if (w == 0 || h == 0 || channels == 0) {
+    return out;
+  }
+
+  LevelJob level{ data, w, h, channels, nullptr };
+  out.resize(std::size_t(blocksX(level)) * blocksY(level) * blockSize(format));
+  level._dst = out.data();
+
+  double psnr = compressLevels({ level }, format, options);
+  if (psnrOut) *psnrOut = psnr;
+
+  return out;
+}
+
+bool BlockCompressor::compressTexture(
+  render::asset::Texture& tex,
+  BCFormat format,
+  const BCOptions& options,
+  double* psnrOut)
+{
+  using Format = render::asset::Texture::Format;
+
+  unsigned channels = 0;
+  bool srgb = false;
+  switch (tex._format) {
+  case Format::RGBA8_SRGB:  channels = 4; srgb = true; break;
+  case Format::RGBA8_UNORM: channels = 4; break;
+  case Format::RGB8_SRGB:   channels = 3; srgb = true; break;
+  case Format::RGB8_UNORM:  channels = 3; break;
+  case Format::RG8_UNORM:   channels = 2; break;
+  case Format::R8_UNORM:    channels = 1; break;
+  default:
+    printf("Cannot block compress texture %s, source must be 8 bits per channel!\n", tex._name.c_str());
+    return false;
+  }
+
+  if (srgb && (format == BCFormat::BC4 || format == BCFormat::BC5)) {
+    printf("Cannot compress sRGB texture %s to BC4/BC5!\n", tex._name.c_str());
+    return false;
+  }
+
+  std::vector<std::vector<std::uint8_t>> compressed(tex._data.size());
+  std::vector<LevelJob> levels;
+
+  unsigned mipWidth = tex._width;
+  unsigned mipHeight = tex._height;
+  for (std::size_t i = 0; i < tex._data.size(); ++i) {
+    if (tex._data[i].size() < std::size_t(mipWidth) * mipHeight * channels) {
+      printf("Mip %zu of texture %s is too small!\n", i, tex._name.c_str());
+      return false;
+    }
+
+    LevelJob level{ tex._data[i].data(), mipWidth, mipHeight, channels, nullptr };
+    compressed[i].resize(std::size_t(blocksX(level)) * blocksY(level) * blockSize(format));
+    level._dst = compressed[i].data();
+    levels.emplace_back(level);
+
+    if (mipWidth > 1) mipWidth /= 2;
+    if (mipHeight > 1) mipHeight /= 2;
+  }
+
+  double psnr = compressLevels(levels, format, options);
+  if (psnrOut) *psnrOut = psnr;
+
+  tex._data = std::move(compressed);
+
+  switch (format) {
+  case BCFormat::BC1:
+    tex._format = srgb ? Format::RGBA_SRGB_BC1 : Format::RGBA_UNORM_BC1;
+    break;
+  case BCFormat::BC3:
+    tex._format = srgb ? Format::RGBA_SRGB_BC3 : Format::RGBA_UNORM_BC3;
+    break;
+  case BCFormat::BC4:
+    tex._format = Format::R_UNORM_BC4;
+    break;
+  case BCFormat::BC5:
+    tex._format = Format::RG_UNORM_BC5;
+    break;
+  case BCFormat::BC7:
+    tex._format = srgb ? Format::RGBA_SRGB_BC7 : Format::RGBA_UNORM_BC7;
+    break;
+  }
+
+  return true;
+}
+
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "../render/asset/Texture.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace util {
+
+enum class BCFormat
+{
+  BC1, // RGB + 1 bit alpha, 8 bytes per block
+  BC3, // RGBA, BC1 color + BC4 alpha, 16 bytes per block
+  BC4, // R, 8 bytes per block
+  BC5, // RG, two BC4 blocks, 16 bytes per block
+  BC7  // RGBA, 16 bytes per block
+};
+
+enum class BCQuality
+{
+  Fast,   // Endpoints straight from the principal axis, BC7 mode 6 only
+  Normal, // Least squares endpoint refinement, BC7 modes 1, 5 and 6
+  High    // Iterated refinement plus endpoint neighbourhood search, more BC7 partitions
+};
+
+struct BCOptions
+{
+  BCQuality _quality = BCQuality::Normal;
+  unsigned _numThreads = 0; // 0 means std::thread::hardware_concurrency()
+};
+
+/*
+* Direct block compression to the BCn formats, no intermediate (Basis) format.
+* Work is split into rows of blocks, which are spread over worker threads across all mips at once.
+* Optionally reports PSNR (dB) over the channels the format stores, measured in the encoded (not linearised) space.
+* BC1 is measured against the source with alpha thresholded to 1 bit.
+*/
+struct BlockCompressor
+{
+  // Compresses a w x h image with 'channels' bytes per texel. Missing channels read as 0, missing alpha as 255.
+  // Returns blocks in row major order.
+  static std::vector<std::uint8_t> compressImage(
+    const std::uint8_t* data,
+    unsigned w,
+    unsigned h,
+    unsigned channels,
+    BCFormat format,
+    const BCOptions& options = BCOptions(),
+    double* psnrOut = nullptr);
+
+  // Compresses every mip of an 8 bit per channel texture in place and sets the matching BC format.
+  // BC4 and BC5 have no sRGB variants, so sRGB input is refused for those.
+  static bool compressTexture(
+    render::asset::Texture& tex,
+    BCFormat format,
+    const BCOptions& options = BCOptions(),
+    double* psnrOut = nullptr);
+
+  static std::size_t blockSize(BCFormat format);
+};
+
+}
@@ -5,8 +5,12 @@
 #include <glm/gtx/quaternion.hpp>
 #include <glm/glm.hpp>
 
+#include <algorithm>
+#include <cassert>
 #include <cmath>
+#include <cstddef>
 #include <numbers>
+#include <vector>
 
 namespace util::interp {
 
@@ -164,4 +168,102 @@ static glm::mat4 lerpTransforms(const glm::mat4& m0, const glm::mat4& m1, double
   return out;
 }
 
+// Where a time falls on a track: between keyframes _index0 and _index1, _factor of the way from the first.
+// Clamped to the first and last segment, with a single keyframe both indices are 0.
+struct KeyframeSpan
+{
+  std::size_t _index0 = 0;
+  std::size_t _index1 = 0;
+  double _factor = 0.0;
+};
+
+// Remembers the segment of the last lookup, one per player of a track.
+// Playback moves forward by at most a key or two per frame, so lookups are constant time. Anything else
+// (scrubbing, looping, playing backwards) falls back to a binary search.
+struct KeyframeCursor
+{
+  std::size_t _segment = 0;
+};
+
+// times has to be sorted
+template <typename Time>
+KeyframeSpan findKeyframes(const Time* times, std::size_t count, double time, KeyframeCursor& cursor)
+{
+  if (count == 0) {
+    return KeyframeSpan{};
+  }
+  if (count == 1) {
+    return KeyframeSpan{ 0, 0, 0.0 };
+  }
+
+  const std::size_t lastSegment = count - 2;
+  std::size_t seg = std::min(cursor._segment, lastSegment);
+
+  if (time < times[0]) {
+    seg = 0;
+  }
+  else if (time >= times[count - 1]) {
+    seg = lastSegment;
+  }
+  else if (times[seg] <= time && time < times[seg + 1]) {
+    // Still in the same segment
+  }
+  else if (seg + 1 <= lastSegment && times[seg + 1] <= time && time < times[seg + 2]) {
+    seg = seg + 1;
+  }
+  else {
+    // Last key at or before time
+    auto it = std::upper_bound(times, times + count, time, [](double t, Time key) { return t < key; });
+    seg = std::min((std::size_t)(it - times) - 1, lastSegment);
+  }
+
+  cursor._segment = seg;
+
+  double t0 = times[seg];
+  double t1 = times[seg + 1];
+  double factor = t1 > t0 ? (time - t0) / (t1 - t0) : (time >= t1 ? 1.0 : 0.0);
+
+  return KeyframeSpan{ seg, seg + 1, std::clamp(factor, 0.0, 1.0) };
+}
+
+/*
+* The times of a track of keyframes, kept on their own so that lookups only touch times.
+* The keyframe values stay wherever they are, indexed by the returned KeyframeSpan.
+* Time is whatever the keyframes store their time as, so that lookups see exactly the same times.
+*/
+template <typename Time = float>
+class KeyframeTrack
+{
+public:
+  KeyframeTrack() = default;
+  explicit KeyframeTrack(std::vector<Time> times) : _times(std::move(times))
+  {
+    assert(std::is_sorted(_times.begin(), _times.end()) && "Keyframe times are not sorted!");
+  }
+
+  // timeFcn gives the time of a keyframe, keyframes have to be sorted on it
+  template <typename T, typename F>
+  void assign(const std::vector<T>& keyframes, F timeFcn)
+  {
+    _times.resize(keyframes.size());
+    for (std::size_t i = 0; i < keyframes.size(); ++i) {
+      _times[i] = (Time)timeFcn(keyframes[i]);
+    }
+
+    assert(std::is_sorted(_times.begin(), _times.end()) && "Keyframe times are not sorted!");
+  }
+
+  KeyframeSpan find(double time, KeyframeCursor& cursor) const
+  {
+    return findKeyframes(_times.data(), _times.size(), time, cursor);
+  }
+
+  const std::vector<Time>& times() const { return _times; }
+  std::size_t size() const { return _times.size(); }
+  bool empty() const { return _times.empty(); }
+
+private:
+  std::vector<Time> _times;
+};
+
 }
\ No newline at end of file
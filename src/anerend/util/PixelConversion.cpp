@@ -0,0 +1,730 @@
+#include "PixelConversion.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define ANEREND_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#elif defined(_M_ARM64) || defined(__aarch64__)
+#define ANEREND_NEON 1
+#include <arm_neon.h>
+#endif
+
+// MSVC lets any function use any intrinsic, gcc/clang need the target spelled out
+#if defined(ANEREND_X86) && (defined(__GNUC__) || defined(__clang__))
+#define ANEREND_TARGET_SSSE3 __attribute__((target("ssse3")))
+#define ANEREND_TARGET_AVX2 __attribute__((target("avx2,f16c")))
+#else
+#define ANEREND_TARGET_SSSE3
+#define ANEREND_TARGET_AVX2
+#endif
+
+namespace util {
+
+namespace {
+
+typedef ConversionPath Path;
+
+struct CpuFeatures
+{
+  bool _ssse3 = false;
+  bool _avx2 = false; // Also implies F16C
+};
+
+CpuFeatures detectCpu()
+{
+  CpuFeatures features;
+
+#if defined(ANEREND_X86)
+  unsigned info[4] = {};
+  unsigned maxLeaf = 0;
+
+#if defined(_MSC_VER)
+  int regs[4];
+  __cpuid(regs, 0);
+  maxLeaf = unsigned(regs[0]);
+  __cpuid(regs, 1);
+  std::memcpy(info, regs, sizeof(info));
+#else
+  __get_cpuid(0, &maxLeaf, &info[1], &info[2], &info[3]);
+  __get_cpuid(1, &info[0], &info[1], &info[2], &info[3]);
+#endif
+
+  features._ssse3 = (info[2] & (1u << 9)) != 0;
+  bool f16c = (info[2] & (1u << 29)) != 0;
+  bool osxsave = (info[2] & (1u << 27)) != 0;
+  bool avx = (info[2] & (1u << 28)) != 0;
+
+  // The OS also has to save the ymm registers
+  bool ymmEnabled = false;
+  if (osxsave && avx) {
+#if defined(_MSC_VER)
+    ymmEnabled = (_xgetbv(0) & 6) == 6;
+#else
+    unsigned eax, edx;
+    __asm__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    ymmEnabled = (eax & 6) == 6;
+#endif
+  }
+
+  if (maxLeaf >= 7 && ymmEnabled && f16c) {
+#if defined(_MSC_VER)
+    __cpuidex(regs, 7, 0);
+    features._avx2 = (regs[1] & (1 << 5)) != 0;
+#else
+    unsigned a = 0, b = 0, c = 0, d = 0;
+    features._avx2 = __get_cpuid_count(7, 0, &a, &b, &c, &d) && (b & (1u << 5)) != 0;
+#endif
+  }
+#endif
+
+  return features;
+}
+
+const CpuFeatures& cpu()
+{
+  static const CpuFeatures features = detectCpu();
+  return features;
+}
+
+bool pathSupported(Path path)
+{
+  switch (path) {
+  case Path::Scalar: return true;
+  case Path::SSSE3: return cpu()._ssse3;
+  case Path::AVX2: return cpu()._avx2;
+#if defined(ANEREND_NEON)
+  case Path::NEON: return true;
+#endif
+  default: return false;
+  }
+}
+
+// Forced paths that the CPU can't run fall back to scalar
+Path resolvePath(Path path)
+{
+  if (path == Path::Auto) return PixelConversion::bestPath();
+  return pathSupported(path) ? path : Path::Scalar;
+}
+
+// Chunks of an in-place conversion that shrinks texels would overlap each other
+bool canSplit(const void* src, std::size_t srcBytes, const void* dst, std::size_t dstBytes)
+{
+  auto s = reinterpret_cast<std::uintptr_t>(src);
+  auto d = reinterpret_cast<std::uintptr_t>(dst);
+  bool overlap = s < d + dstBytes && d < s + srcBytes;
+  return !overlap || (s == d && srcBytes == dstBytes);
+}
+
+void parallelFor(std::size_t count, unsigned numThreads, bool split, const std::function<void(std::size_t, std::size_t)>& func)
+{
+  const std::size_t minPerThread = 1 << 16;
+
+  if (numThreads == 0) {
+    numThreads = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  std::size_t numWorkers = split ? std::min<std::size_t>(numThreads, count / minPerThread) : 1;
+  if (numWorkers <= 1) {
+    func(0, count);
+    return;
+  }
+
+  std::size_t perWorker = (count + numWorkers - 1) / numWorkers;
+  std::vector<std::thread> threads;
+  for (std::size_t i = 1; i < numWorkers; ++i) {
+    std::size_t begin = i * perWorker;
+    std::size_t end = std::min(count, begin + perWorker);
+    if (begin >= end) break;
+    threads.emplace_back(func, begin, end);
+  }
+
+  func(0, std::min(count, perWorker));
+
+  for (auto& t : threads) {
+    t.join();
+  }
+}
+
+const std::array<float, 256>& srgbTable()
+{
+  static const std::array<float, 256> table = []() {
+    std::array<float, 256> t{};
+    for (unsigned i = 0; i < 256; ++i) {
+      double c = double(i) / 255.0;
+      t[i] = float(c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4));
+    }
+    return t;
+  }();
+  return table;
+}
+
+// Linear value half way between sRGB code k and k + 1, encoding is a search through these
+const std::array<float, 255>& srgbThresholds()
+{
+  static const std::array<float, 255> table = []() {
+    std::array<float, 255> t{};
+    for (unsigned i = 0; i < 255; ++i) {
+      double c = (double(i) + 0.5) / 255.0;
+      t[i] = float(c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4));
+    }
+    return t;
+  }();
+  return table;
+}
+
+// ---------- Scalar ----------
+
+void extractScalar(const std::uint8_t* src, std::uint8_t* dst, std::size_t count, unsigned n, const unsigned* map)
+{
+  for (std::size_t i = 0; i < count; ++i) {
+    // Copy first, dst may alias the texel being read
+    std::uint8_t texel[4];
+    std::memcpy(texel, src + i * 4, 4);
+    for (unsigned c = 0; c < n; ++c) {
+      dst[i * n + c] = texel[map[c]];
+    }
+  }
+}
+
+void widenScalar(const std::uint8_t* src, std::uint16_t* dst, std::size_t count)
+{
+  for (std::size_t i = 0; i < count; ++i) {
+    dst[i] = std::uint16_t(src[i] * 257);
+  }
+}
+
+void narrowScalar(const std::uint16_t* src, std::uint8_t* dst, std::size_t count)
+{
+  for (std::size_t i = 0; i < count; ++i) {
+    dst[i] = std::uint8_t((unsigned(src[i]) + 128) / 257);
+  }
+}
+
+void floatToHalfScalar(const float* src, std::uint16_t* dst, std::size_t count)
+{
+  for (std::size_t i = 0; i < count; ++i) {
+    dst[i] = PixelConversion::floatToHalf(src[i]);
+  }
+}
+
+void halfToFloatScalar(const std::uint16_t* src, float* dst, std::size_t count)
+{
+  for (std::size_t i = 0; i < count; ++i) {
+    dst[i] = PixelConversion::halfToFloat(src[i]);
+  }
+}
+
+void srgbToLinearScalar(const std::uint8_t* src, float* dst, std::size_t count)
+{
+  const auto& table = srgbTable();
+  for (std::size_t i = 0; i < count; ++i) {
+    dst[i] = table[src[i]];
+  }
+}
+
+void linearToSrgbScalar(const float* src, std::uint8_t* dst, std::size_t count)
+{
+  for (std::size_t i = 0; i < count; ++i) {
+    dst[i] = PixelConversion::linearToSrgb(src[i]);
+  }
+}
+
+// ---------- x86 ----------
+// Each kernel returns how many elements it converted, the caller finishes the tail with the scalar version.
+// Stores may run past the current texels as long as they stay inside dst and behind the src read position,
+// which keeps in-place conversion safe.
+
+#if defined(ANEREND_X86)
+
+ANEREND_TARGET_SSSE3 std::size_t extractSSSE3(const std::uint8_t* src, std::uint8_t* dst, std::size_t count, unsigned n, const unsigned* map)
+{
+  alignas(16) std::uint8_t mask[16];
+  for (unsigned j = 0; j < 16; ++j) {
+    unsigned texel = j / n;
+    mask[j] = texel < 4 ? std::uint8_t(texel * 4 + map[j % n]) : 0x80;
+  }
+  __m128i shuffle = _mm_load_si128(reinterpret_cast<const __m128i*>(mask));
+
+  std::size_t i = 0;
+  for (; i + 4 <= count && i * n + 16 <= count * n; i += 4) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * n), _mm_shuffle_epi8(v, shuffle));
+  }
+  return i;
+}
+
+ANEREND_TARGET_AVX2 std::size_t extractAVX2(const std::uint8_t* src, std::uint8_t* dst, std::size_t count, unsigned n, const unsigned* map)
+{
+  // pshufb works per 128 bit lane, so both lanes use the same mask and are then packed together
+  alignas(32) std::uint8_t mask[32];
+  for (unsigned j = 0; j < 16; ++j) {
+    unsigned texel = j / n;
+    mask[j] = mask[j + 16] = texel < 4 ? std::uint8_t(texel * 4 + map[j % n]) : 0x80;
+  }
+  __m256i shuffle = _mm256_load_si256(reinterpret_cast<const __m256i*>(mask));
+
+  __m256i pack;
+  switch (n) {
+  case 1: pack = _mm256_setr_epi32(0, 4, 1, 2, 3, 5, 6, 7); break;
+  case 2: pack = _mm256_setr_epi32(0, 1, 4, 5, 2, 3, 6, 7); break;
+  case 3: pack = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7); break;
+  default: pack = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7); break;
+  }
+
+  std::size_t i = 0;
+  for (; i + 8 <= count && i * n + 32 <= count * n; i += 8) {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i * 4));
+    v = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(v, shuffle), pack);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i * n), v);
+  }
+  return i;
+}
+
+ANEREND_TARGET_SSSE3 std::size_t widenSSSE3(const std::uint8_t* src, std::uint16_t* dst, std::size_t count)
+{
+  std::size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    // Interleaving a byte with itself is v * 257
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_unpacklo_epi8(v, v));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 8), _mm_unpackhi_epi8(v, v));
+  }
+  return i;
+}
+
+ANEREND_TARGET_AVX2 std::size_t widenAVX2(const std::uint8_t* src, std::uint16_t* dst, std::size_t count)
+{
+  std::size_t i = 0;
+  for (; i + 32 <= count; i += 32) {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+    v = _mm256_permute4x64_epi64(v, 0xD8); // Qwords 0 2 1 3, so the per lane unpacks come out in order
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_unpacklo_epi8(v, v));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i + 16), _mm256_unpackhi_epi8(v, v));
+  }
+  return i;
+}
+
+// round(v / 257) == (mulhi(v, 0xFF01) + 128) >> 8 for every 16 bit v
+ANEREND_TARGET_SSSE3 std::size_t narrowSSSE3(const std::uint16_t* src, std::uint8_t* dst, std::size_t count)
+{
+  const __m128i mul = _mm_set1_epi16(std::int16_t(0xFF01));
+  const __m128i bias = _mm_set1_epi16(128);
+
+  std::size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 8));
+    a = _mm_srli_epi16(_mm_add_epi16(_mm_mulhi_epu16(a, mul), bias), 8);
+    b = _mm_srli_epi16(_mm_add_epi16(_mm_mulhi_epu16(b, mul), bias), 8);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(a, b));
+  }
+  return i;
+}
+
+ANEREND_TARGET_AVX2 std::size_t narrowAVX2(const std::uint16_t* src, std::uint8_t* dst, std::size_t count)
+{
+  const __m256i mul = _mm256_set1_epi16(std::int16_t(0xFF01));
+  const __m256i bias = _mm256_set1_epi16(128);
+
+  std::size_t i = 0;
+  for (; i + 32 <= count; i += 32) {
+    __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+    __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i + 16));
+    a = _mm256_srli_epi16(_mm256_add_epi16(_mm256_mulhi_epu16(a, mul), bias), 8);
+    b = _mm256_srli_epi16(_mm256_add_epi16(_mm256_mulhi_epu16(b, mul), bias), 8);
+    __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), packed);
+  }
+  return i;
+}
+
+ANEREND_TARGET_AVX2 std::size_t floatToHalfAVX2(const float* src, std::uint16_t* dst, std::size_t count)
+{
+  std::size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), h);
+  }
+  return i;
+}
+
+ANEREND_TARGET_AVX2 std::size_t halfToFloatAVX2(const std::uint16_t* src, float* dst, std::size_t count)
+{
+  std::size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(h));
+  }
+  return i;
+}
+
+ANEREND_TARGET_AVX2 std::size_t srgbToLinearAVX2(const std::uint8_t* src, float* dst, std::size_t count)
+{
+  const float* table = srgbTable().data();
+
+  std::size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256i idx = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i)));
+    _mm256_storeu_ps(dst + i, _mm256_i32gather_ps(table, idx, 4));
+  }
+  return i;
+}
+
+// Branchless version of the scalar threshold search, 8 gathers per 8 values
+ANEREND_TARGET_AVX2 std::size_t linearToSrgbAVX2(const float* src, std::uint8_t* dst, std::size_t count)
+{
+  const float* thresholds = srgbThresholds().data();
+
+  std::size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256 v = _mm256_loadu_ps(src + i);
+    __m256i idx = _mm256_setzero_si256();
+
+    for (int step = 128; step > 0; step >>= 1) {
+      __m256i probe = _mm256_add_epi32(idx, _mm256_set1_epi32(step - 1));
+      __m256 t = _mm256_i32gather_ps(thresholds, probe, 4);
+      __m256i ge = _mm256_castps_si256(_mm256_cmp_ps(v, t, _CMP_GE_OQ));
+      idx = _mm256_add_epi32(idx, _mm256_and_si256(ge, _mm256_set1_epi32(step)));
+    }
+
+    __m128i words = _mm_packus_epi32(_mm256_castsi256_si128(idx), _mm256_extracti128_si256(idx, 1));
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(words, words));
+  }
+  return i;
+}
+
+#endif
+
+// ---------- NEON ----------
+
+#if defined(ANEREND_NEON)
+
+std::size_t extractNEON(const std::uint8_t* src, std::uint8_t* dst, std::size_t count, unsigned n, const unsigned* map)
+{
+  std::size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    uint8x16x4_t v = vld4q_u8(src + i * 4);
+
+    if (n == 1) {
+      vst1q_u8(dst + i, v.val[map[0]]);
+    }
+    else if (n == 2) {
+      uint8x16x2_t out = { { v.val[map[0]], v.val[map[1]] } };
+      vst2q_u8(dst + i * 2, out);
+    }
+    else if (n == 3) {
+      uint8x16x3_t out = { { v.val[map[0]], v.val[map[1]], v.val[map[2]] } };
+      vst3q_u8(dst + i * 3, out);
+    }
+    else {
+      uint8x16x4_t out = { { v.val[map[0]], v.val[map[1]], v.val[map[2]], v.val[map[3]] } };
+      vst4q_u8(dst + i * 4, out);
+    }
+  }
+  return i;
+}
+
+std::size_t widenNEON(const std::uint8_t* src, std::uint16_t* dst, std::size_t count)
+{
+  std::size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    uint8x16_t v = vld1q_u8(src + i);
+    vst1q_u8(reinterpret_cast<std::uint8_t*>(dst + i), vzip1q_u8(v, v));
+    vst1q_u8(reinterpret_cast<std::uint8_t*>(dst + i + 8), vzip2q_u8(v, v));
+  }
+  return i;
+}
+
+std::size_t narrowNEON(const std::uint16_t* src, std::uint8_t* dst, std::size_t count)
+{
+  const uint16x8_t mul = vdupq_n_u16(0xFF01);
+
+  std::size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    uint16x8_t v = vld1q_u16(src + i);
+    uint16x8_t hi = vcombine_u16(
+      vshrn_n_u32(vmull_u16(vget_low_u16(v), vget_low_u16(mul)), 16),
+      vshrn_n_u32(vmull_high_u16(v, mul), 16));
+    vst1_u8(dst + i, vrshrn_n_u16(hi, 8));
+  }
+  return i;
+}
+
+std::size_t floatToHalfNEON(const float* src, std::uint16_t* dst, std::size_t count)
+{
+  std::size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    float16x4_t h = vcvt_f16_f32(vld1q_f32(src + i));
+    vst1_u16(dst + i, vreinterpret_u16_f16(h));
+  }
+  return i;
+}
+
+std::size_t halfToFloatNEON(const std::uint16_t* src, float* dst, std::size_t count)
+{
+  std::size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    float16x4_t h = vreinterpret_f16_u16(vld1_u16(src + i));
+    vst1q_f32(dst + i, vcvt_f32_f16(h));
+  }
+  return i;
+}
+
+#endif
+
+}
+
+ConversionPath PixelConversion::bestPath()
+{
+#if defined(ANEREND_NEON)
+  return Path::NEON;
+#else
+  if (cpu()._avx2) return Path::AVX2;
+  if (cpu()._ssse3) return Path::SSSE3;
+  return Path::Scalar;
+#endif
+}
+
+const char* PixelConversion::pathName(Path path)
+{
+  switch (path) {
+  case Path::Auto: return "Auto";
+  case Path::Scalar: return "Scalar";
+  case Path::SSSE3: return "SSSE3";
+  case Path::AVX2: return "AVX2";
+  case Path::NEON: return "NEON";
+  }
+  return "Unknown";
+}
+
+void PixelConversion::extractChannels(
+  const std::uint8_t* src, std::uint8_t* dst, std::size_t numTexels,
+  unsigned dstChannels, const unsigned* channelMap, const ConversionOptions& options)
+{
+  if (dstChannels == 0 || dstChannels > 4) {
+    printf("Cannot extract %u channels!\n", dstChannels);
+    return;
+  }
+  for (unsigned c = 0; c < dstChannels; ++c) {
+    if (channelMap[c] > 3) {
+      printf("Channel map refers to channel %u of a 4 channel texel!\n", channelMap[c]);
+      return;
+    }
+  }
+
+  Path path = resolvePath(options._path);
+  bool split = canSplit(src, numTexels * 4, dst, numTexels * dstChannels);
+
+  parallelFor(numTexels, options._numThreads, split, [&](std::size_t begin, std::size_t end) {
+    const std::uint8_t* s = src + begin * 4;
+    std::uint8_t* d = dst + begin * dstChannels;
+    std::size_t count = end - begin;
+    std::size_t done = 0;
+
+#if defined(ANEREND_X86)
+    if (path == Path::AVX2) done = extractAVX2(s, d, count, dstChannels, channelMap);
+    else if (path == Path::SSSE3) done = extractSSSE3(s, d, count, dstChannels, channelMap);
+#elif defined(ANEREND_NEON)
+    if (path == Path::NEON) done = extractNEON(s, d, count, dstChannels, channelMap);
+#endif
+
+    extractScalar(s + done * 4, d + done * dstChannels, count - done, dstChannels, channelMap);
+  });
+}
+
+void PixelConversion::unorm8ToUnorm16(const std::uint8_t* src, std::uint16_t* dst, std::size_t count, const ConversionOptions& options)
+{
+  Path path = resolvePath(options._path);
+  bool split = canSplit(src, count, dst, count * 2);
+
+  parallelFor(count, options._numThreads, split, [&](std::size_t begin, std::size_t end) {
+    std::size_t done = 0;
+
+#if defined(ANEREND_X86)
+    if (path == Path::AVX2) done = widenAVX2(src + begin, dst + begin, end - begin);
+    else if (path == Path::SSSE3) done = widenSSSE3(src + begin, dst + begin, end - begin);
+#elif defined(ANEREND_NEON)
+    if (path == Path::NEON) done = widenNEON(src + begin, dst + begin, end - begin);
+#endif
+
+    widenScalar(src + begin + done, dst + begin + done, end - begin - done);
+  });
+}
+
+void PixelConversion::unorm16ToUnorm8(const std::uint16_t* src, std::uint8_t* dst, std::size_t count, const ConversionOptions& options)
+{
+  Path path = resolvePath(options._path);
+  bool split = canSplit(src, count * 2, dst, count);
+
+  parallelFor(count, options._numThreads, split, [&](std::size_t begin, std::size_t end) {
+    std::size_t done = 0;
+
+#if defined(ANEREND_X86)
+    if (path == Path::AVX2) done = narrowAVX2(src + begin, dst + begin, end - begin);
+    else if (path == Path::SSSE3) done = narrowSSSE3(src + begin, dst + begin, end - begin);
+#elif defined(ANEREND_NEON)
+    if (path == Path::NEON) done = narrowNEON(src + begin, dst + begin, end - begin);
+#endif
+
+    narrowScalar(src + begin + done, dst + begin + done, end - begin - done);
+  });
+}
+
+void PixelConversion::floatToHalf(const float* src, std::uint16_t* dst, std::size_t count, const ConversionOptions& options)
+{
+  Path path = resolvePath(options._path);
+  bool split = canSplit(src, count * 4, dst, count * 2);
+
+  parallelFor(count, options._numThreads, split, [&](std::size_t begin, std::size_t end) {
+    std::size_t done = 0;
+
+#if defined(ANEREND_X86)
+    if (path == Path::AVX2) done = floatToHalfAVX2(src + begin, dst + begin, end - begin);
+#elif defined(ANEREND_NEON)
+    if (path == Path::NEON) done = floatToHalfNEON(src + begin, dst + begin, end - begin);
+#endif
+
+    floatToHalfScalar(src + begin + done, dst + begin + done, end - begin - done);
+  });
+}
+
+void PixelConversion::halfToFloat(const std::uint16_t* src, float* dst, std::size_t count, const ConversionOptions& options)
+{
+  Path path = resolvePath(options._path);
+  bool split = canSplit(src, count * 2, dst, count * 4);
+
+  parallelFor(count, options._numThreads, split, [&](std::size_t begin, std::size_t end) {
+    std::size_t done = 0;
+
+#if defined(ANEREND_X86)
+    if (path == Path::AVX2) done = halfToFloatAVX2(src + begin, dst + begin, end - begin);
+#elif defined(ANEREND_NEON)
+    if (path == Path::NEON) done = halfToFloatNEON(src + begin, dst + begin, end - begin);
+#endif
+
+    halfToFloatScalar(src + begin + done, dst + begin + done, end - begin - done);
+  });
+}
+
+void PixelConversion::srgbToLinear(const std::uint8_t* src, float* dst, std::size_t count, const ConversionOptions& options)
+{
+  Path path = resolvePath(options._path);
+  bool split = canSplit(src, count, dst, count * 4);
+
+  parallelFor(count, options._numThreads, split, [&](std::size_t begin, std::size_t end) {
+    std::size_t done = 0;
+
+#if defined(ANEREND_X86)
+    if (path == Path::AVX2) done = srgbToLinearAVX2(src + begin, dst + begin, end - begin);
+#endif
+
+    srgbToLinearScalar(src + begin + done, dst + begin + done, end - begin - done);
+  });
+}
+
+void PixelConversion::linearToSrgb(const float* src, std::uint8_t* dst, std::size_t count, const ConversionOptions& options)
+{
+  Path path = resolvePath(options._path);
+  bool split = canSplit(src, count * 4, dst, count);
+
+  parallelFor(count, options._numThreads, split, [&](std::size_t begin, std::size_t end) {
+    std::size_t done = 0;
+
+#if defined(ANEREND_X86)
+    if (path == Path::AVX2) done = linearToSrgbAVX2(src + begin, dst + begin, end - begin);
+#endif
+
+    linearToSrgbScalar(src + begin + done, dst + begin + done, end - begin - done);
+  });
+}
+
+std::uint16_t PixelConversion::floatToHalf(float v)
+{
+  std::uint32_t bits;
+  std::memcpy(&bits, &v, 4);
+
+  std::uint32_t sign = (bits >> 16) & 0x8000;
+  std::uint32_t abs = bits & 0x7FFFFFFF;
+
+  // NaN keeps the top of its payload and becomes quiet, same as F16C and NEON
+  if (abs > 0x7F800000) {
+    return std::uint16_t(sign | 0x7E00 | ((abs >> 13) & 0x3FF));
+  }
+
+  // Anything from 65520 up rounds to infinity
+  if (abs >= 0x477FF000) {
+    return std::uint16_t(sign | 0x7C00);
+  }
+
+  // Subnormal half or zero: let the FPU round by adding 0.5, whose ulp is the smallest half subnormal
+  if (abs < 0x38800000) {
+    float f;
+    std::memcpy(&f, &abs, 4);
+    f += 0.5f;
+    std::uint32_t r;
+    std::memcpy(&r, &f, 4);
+    return std::uint16_t(sign | (r - 0x3F000000));
+  }
+
+  // Rebias the exponent and round to nearest even
+  std::uint32_t mantOdd = (abs >> 13) & 1;
+  abs += 0xC8000FFF + mantOdd;
+  return std::uint16_t(sign | (abs >> 13));
+}
+
+float PixelConversion::halfToFloat(std::uint16_t v)
+{
+  std::uint32_t sign = std::uint32_t(v & 0x8000) << 16;
+  std::uint32_t exp = (v >> 10) & 0x1F;
+  std::uint32_t mant = v & 0x3FF;
+  std::uint32_t bits;
+
+  if (exp == 0) {
+    float f = float(mant) * 5.9604644775390625e-8f; // 2^-24
+    std::memcpy(&bits, &f, 4);
+    bits |= sign;
+  }
+  else if (exp == 31) {
+    bits = sign | 0x7F800000 | (mant ? 0x400000 | (mant << 13) : 0);
+  }
+  else {
+    bits = sign | ((exp + 112) << 23) | (mant << 13);
+  }
+
+  float out;
+  std::memcpy(&out, &bits, 4);
+  return out;
+}
+
+float PixelConversion::srgbToLinear(std::uint8_t v)
+{
+  return srgbTable()[v];
+}
+
+std::uint8_t PixelConversion::linearToSrgb(float v)
+{
+  const auto& thresholds = srgbThresholds();
+
+  unsigned idx = 0;
+  for (unsigned step = 128; step > 0; step >>= 1) {
+    if (v >= thresholds[idx + step - 1]) {
+      idx += step;
+    }
+  }
+  return std::uint8_t(idx);
+}
+
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace util {
+
+enum class ConversionPath
+{
+  Auto,
+  Scalar,
+  SSSE3,
+  AVX2,
+  NEON
+};
+
+struct ConversionOptions
+{
+  ConversionPath _path = ConversionPath::Auto;
+  unsigned _numThreads = 0; // 0 means std::thread::hardware_concurrency()
+};
+
+/*
+* Bulk pixel format conversion kernels.
+* Every kernel has a scalar reference and SSSE3, AVX2 (+F16C) and NEON paths where they pay off,
+* the fastest one supported by the running CPU is picked unless a path is forced.
+* Large inputs are split over worker threads. Kernels documented as in-place safe may be called with dst == src
+* (these run single threaded when the texel size shrinks, since chunks would overlap).
+*/
+struct PixelConversion
+{
+  // Fastest path supported by this CPU
+  static ConversionPath bestPath();
+  static const char* pathName(ConversionPath path);
+
+  // 4 channel 8 bit texels to dstChannels (1-4) channels, dst channel i is src channel channelMap[i].
+  // Covers RGBA->RGB, RGBA->RG, single channel extraction and swizzles. In-place safe.
+  static void extractChannels(
+    const std::uint8_t* src, std::uint8_t* dst, std::size_t numTexels,
+    unsigned dstChannels, const unsigned* channelMap, const ConversionOptions& options = ConversionOptions());
+
+  // Unorm 8 bit to unorm 16 bit (v * 257), exact
+  static void unorm8ToUnorm16(const std::uint8_t* src, std::uint16_t* dst, std::size_t count, const ConversionOptions& options = ConversionOptions());
+
+  // Unorm 16 bit to unorm 8 bit, rounded to nearest. In-place safe.
+  static void unorm16ToUnorm8(const std::uint16_t* src, std::uint8_t* dst, std::size_t count, const ConversionOptions& options = ConversionOptions());
+
+  // IEEE half, round to nearest even. In-place safe.
+  static void floatToHalf(const float* src, std::uint16_t* dst, std::size_t count, const ConversionOptions& options = ConversionOptions());
+  static void halfToFloat(const std::uint16_t* src, float* dst, std::size_t count, const ConversionOptions& options = ConversionOptions());
+
+  // Single channel transfer functions, apply to color channels only (never alpha).
+  static void srgbToLinear(const std::uint8_t* src, float* dst, std::size_t count, const ConversionOptions& options = ConversionOptions());
+  static void linearToSrgb(const float* src, std::uint8_t* dst, std::size_t count, const ConversionOptions& options = ConversionOptions()); // In-place safe
+
+  // Scalar references, also used for the tails of the SIMD loops
+  static std::uint16_t floatToHalf(float v);
+  static float halfToFloat(std::uint16_t v);
+  static float srgbToLinear(std::uint8_t v);
+  static std::uint8_t linearToSrgb(float v);
+};
+
+}
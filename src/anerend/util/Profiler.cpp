@@ -0,0 +1,381 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+
+namespace util {
+
+namespace {
+
+static_assert((Profiler::EVENTS_PER_THREAD & (Profiler::EVENTS_PER_THREAD - 1)) == 0, "Ring size must be a power of two");
+
+// Single producer ring, only the owning thread writes.
+// _write counts all events ever written, slot i holds event i & mask until it is overwritten CAPACITY events later.
+struct EventRing
+{
+  std::unique_ptr<ProfileEvent[]> _events = std::make_unique<ProfileEvent[]>(Profiler::EVENTS_PER_THREAD);
+  std::atomic<std::uint64_t> _write = 0;
+  std::uint32_t _threadId = 0; // Goes with the ring to the next thread, so ids and names don't pile up
+
+  void push(const ProfileEvent& event)
+  {
+    auto idx = _write.load(std::memory_order_relaxed);
+    _events[idx & (Profiler::EVENTS_PER_THREAD - 1)] = event;
+    _write.store(idx + 1, std::memory_order_release);
+  }
+
+  void read(std::vector<ProfileEvent>& out, std::int64_t sinceNs) const
+  {
+    const std::uint64_t cap = Profiler::EVENTS_PER_THREAD;
+
+    auto end = _write.load(std::memory_order_acquire);
+    auto begin = end > cap ? end - cap : 0;
+
+    std::vector<ProfileEvent> copy;
+    copy.reserve(end - begin);
+    for (auto i = begin; i < end; ++i) {
+      copy.emplace_back(_events[i & (cap - 1)]);
+    }
+
+    // Anything the writer lapped while we copied is garbage, and so is the slot of event endAfter,
+    // which the writer may be in the middle of overwriting
+    std::atomic_thread_fence(std::memory_order_acquire);
+    auto endAfter = _write.load(std::memory_order_relaxed);
+    auto firstValid = endAfter + 1 > cap ? endAfter + 1 - cap : 0;
+
+    for (auto i = std::max(begin, firstValid); i < end; ++i) {
+      const auto& event = copy[i - begin];
+      if (event._startNs >= sinceNs) {
+        out.emplace_back(event);
+      }
+    }
+  }
+};
+
+struct ProfilerState
+{
+  std::mutex _mtx;
+  std::vector<std::unique_ptr<EventRing>> _rings;
+  std::vector<EventRing*> _freeRings;
+  std::map<std::uint32_t, std::string> _threadNames;
+  std::unordered_set<std::string> _interned;
+
+  std::atomic<bool> _enabled = true;
+  std::atomic<std::uint32_t> _nextThreadId = Profiler::GPU_THREAD_ID + 1;
+  std::atomic<std::uint64_t> _frameIndex = 0;
+  std::atomic<std::int64_t> _clearNs = 0;
+};
+
+ProfilerState& state()
+{
+  // Leaked on purpose, threads may still record during static destruction
+  static ProfilerState* s = new ProfilerState();
+  return *s;
+}
+
+// Hands a ring to the thread on first use and gives it back to the pool when the thread exits
+struct ThreadContext
+{
+  EventRing* _ring = nullptr;
+  std::string _name; // Last one given to setThreadName
+
+  EventRing& ring()
+  {
+    if (!_ring) {
+      auto& s = state();
+      std::lock_guard<std::mutex> lock(s._mtx);
+      if (!s._freeRings.empty()) {
+        _ring = s._freeRings.back();
+        s._freeRings.pop_back();
+      }
+      else {
+        s._rings.emplace_back(std::make_unique<EventRing>());
+        _ring = s._rings.back().get();
+        _ring->_threadId = s._nextThreadId.fetch_add(1);
+      }
+    }
+    return *_ring;
+  }
+
+  ~ThreadContext()
+  {
+    if (_ring) {
+      auto& s = state();
+      std::lock_guard<std::mutex> lock(s._mtx);
+      s._freeRings.emplace_back(_ring);
+    }
+  }
+};
+
+ThreadContext& threadContext()
+{
+  thread_local ThreadContext ctx;
+  return ctx;
+}
+
+void push(ProfileEvent& event)
+{
+  auto& ring = threadContext().ring();
+  event._threadId = ring._threadId;
+  ring.push(event);
+}
+
+void appendEscaped(std::string& out, const char* str)
+{
+  for (const char* c = str; c && *c; ++c) {
+    switch (*c) {
+    case '"': out += "\\\""; break;
+    case '\\': out += "\\\\"; break;
+    case '\n': out += "\\n"; break;
+    case '\t': out += "\\t"; break;
+    default:
+      if ((unsigned char)*c < 0x20) {
+        char buf[8];
+        snprintf(buf, sizeof(buf), "\\u%04x", (unsigned)*c);
+        out += buf;
+      }
+      else {
+        out += *c;
+      }
+    }
+  }
+}
+
+}
+
+std::int64_t Profiler::nowNs()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Profiler::setEnabled(bool enabled)
+{
+  state()._enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool Profiler::enabled()
+{
+  return state()._enabled.load(std::memory_order_relaxed);
+}
+
+std::uint32_t Profiler::threadId()
+{
+  return threadContext().ring()._threadId;
+}
+
+void Profiler::setThreadName(const char* name)
+{
+  // Pooled threads name themselves at the start of every task, only the first time has to register
+  auto& ctx = threadContext();
+  if (ctx._ring && ctx._name == name) {
+    return;
+  }
+
+  ctx._name = name;
+  auto id = ctx.ring()._threadId;
+  auto& s = state();
+  std::lock_guard<std::mutex> lock(s._mtx);
+  s._threadNames[id] = name;
+}
+
+void Profiler::zone(const char* name, std::int64_t startNs, std::int64_t endNs)
+{
+  if (!enabled()) {
+    return;
+  }
+
+  ProfileEvent event;
+  event._type = ProfileEventType::Zone;
+  event._name = name;
+  event._startNs = startNs;
+  event._durationNs = endNs - startNs;
+  push(event);
+}
+
+void Profiler::counter(const char* name, double value)
+{
+  if (!enabled()) {
+    return;
+  }
+
+  ProfileEvent event;
+  event._type = ProfileEventType::Counter;
+  event._name = name;
+  event._startNs = nowNs();
+  event._value = value;
+  push(event);
+}
+
+void Profiler::frame()
+{
+  state()._frameIndex.fetch_add(1, std::memory_order_relaxed);
+
+  if (!enabled()) {
+    return;
+  }
+
+  ProfileEvent event;
+  event._type = ProfileEventType::Frame;
+  event._name = "Frame";
+  event._startNs = nowNs();
+  push(event);
+}
+
+void Profiler::gpuZone(const char* name, std::int64_t startNs, std::int64_t endNs)
+{
+  if (!enabled()) {
+    return;
+  }
+
+  // Lives in the ring of the calling thread, but is attributed to the GPU pseudo thread
+  ProfileEvent event;
+  event._type = ProfileEventType::Zone;
+  event._name = name;
+  event._startNs = startNs;
+  event._durationNs = endNs - startNs;
+  event._threadId = GPU_THREAD_ID;
+  threadContext().ring().push(event);
+}
+
+const char* Profiler::intern(const std::string& name)
+{
+  auto& s = state();
+  std::lock_guard<std::mutex> lock(s._mtx);
+  return s._interned.emplace(name).first->c_str();
+}
+
+std::vector<ProfileEvent> Profiler::snapshot(std::int64_t sinceNs)
+{
+  auto& s = state();
+  sinceNs = std::max(sinceNs, s._clearNs.load(std::memory_order_relaxed));
+
+  std::vector<ProfileEvent> out;
+  {
+    std::lock_guard<std::mutex> lock(s._mtx);
+    for (auto& ring : s._rings) {
+      ring->read(out, sinceNs);
+    }
+  }
+
+  std::stable_sort(out.begin(), out.end(), [](const ProfileEvent& a, const ProfileEvent& b) { return a._startNs < b._startNs; });
+  return out;
+}
+
+std::vector<ProfileThread> Profiler::threads()
+{
+  auto& s = state();
+  std::vector<ProfileThread> out;
+  out.emplace_back(ProfileThread{ GPU_THREAD_ID, "GPU" });
+
+  std::lock_guard<std::mutex> lock(s._mtx);
+  for (auto& [id, name] : s._threadNames) {
+    out.emplace_back(ProfileThread{ id, name });
+  }
+  return out;
+}
+
+std::uint64_t Profiler::frameIndex()
+{
+  return state()._frameIndex.load(std::memory_order_relaxed);
+}
+
+void Profiler::clear()
+{
+  state()._clearNs.store(nowNs(), std::memory_order_relaxed);
+}
+
+std::string Profiler::chromeTrace(const std::vector<ProfileEvent>& events)
+{
+  std::int64_t base = events.empty() ? 0 : events.front()._startNs;
+  for (auto& event : events) {
+    base = std::min(base, event._startNs);
+  }
+
+  std::string out;
+  out.reserve(events.size() * 96 + 1024);
+  out += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+  // Name the threads that appear (and the GPU row first)
+  auto names = threads();
+  std::vector<std::uint32_t> seen;
+  for (auto& event : events) {
+    if (std::find(seen.begin(), seen.end(), event._threadId) == seen.end()) {
+      seen.emplace_back(event._threadId);
+    }
+  }
+
+  bool first = true;
+  char buf[160];
+  for (auto id : seen) {
+    std::string name = "Thread " + std::to_string(id);
+    for (auto& t : names) {
+      if (t._id == id) {
+        name = t._name;
+      }
+    }
+
+    out += first ? "" : ",\n";
+    first = false;
+    snprintf(buf, sizeof(buf), "{\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"name\":\"thread_name\",\"args\":{\"name\":\"", id);
+    out += buf;
+    appendEscaped(out, name.c_str());
+    out += "\"}}";
+    snprintf(buf, sizeof(buf), ",\n{\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"name\":\"thread_sort_index\",\"args\":{\"sort_index\":%u}}", id, id);
+    out += buf;
+  }
+
+  for (auto& event : events) {
+    double ts = (event._startNs - base) / 1000.0;
+
+    out += first ? "{\"name\":\"" : ",\n{\"name\":\"";
+    first = false;
+    appendEscaped(out, event._name);
+
+    switch (event._type) {
+    case ProfileEventType::Zone:
+      snprintf(buf, sizeof(buf), "\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+        event._threadId == GPU_THREAD_ID ? "gpu" : "cpu", event._threadId, ts, event._durationNs / 1000.0);
+      break;
+    case ProfileEventType::Counter:
+      snprintf(buf, sizeof(buf), "\",\"ph\":\"C\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"args\":{\"value\":%.17g}}",
+        event._threadId, ts, event._value);
+      break;
+    case ProfileEventType::Frame:
+      snprintf(buf, sizeof(buf), "\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":%u,\"ts\":%.3f}", event._threadId, ts);
+      break;
+    }
+    out += buf;
+  }
+
+  out += "\n]}\n";
+  return out;
+}
+
+bool Profiler::writeChromeTrace(const std::filesystem::path& path, std::int64_t sinceNs)
+{
+  std::ofstream ofs(path, std::ios::binary);
+  if (!ofs) {
+    printf("Could not open %s for writing the profiler trace!\n", path.string().c_str());
+    return false;
+  }
+
+  auto trace = chromeTrace(snapshot(sinceNs));
+  ofs.write(trace.data(), trace.size());
+
+  if (!ofs) {
+    printf("Could not write profiler trace to %s!\n", path.string().c_str());
+    return false;
+  }
+
+  return true;
+}
+
+}
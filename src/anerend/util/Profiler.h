@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// Define ANEREND_PROFILING=0 to compile all profiling macros away
+#ifndef ANEREND_PROFILING
+#define ANEREND_PROFILING 1
+#endif
+
+namespace util {
+
+enum class ProfileEventType : std::uint8_t
+{
+  Zone,    // _startNs and _durationNs
+  Counter, // _value at _startNs
+  Frame    // Frame boundary at _startNs
+};
+
+struct ProfileEvent
+{
+  std::int64_t _startNs = 0;
+  union {
+    std::int64_t _durationNs;
+    double _value;
+  };
+  const char* _name = nullptr; // Must outlive the profiler, i.e. a literal or from Profiler::intern
+  std::uint32_t _threadId = 0;
+  ProfileEventType _type = ProfileEventType::Zone;
+
+  ProfileEvent() : _durationNs(0) {}
+};
+
+struct ProfileThread
+{
+  std::uint32_t _id;
+  std::string _name;
+};
+
+/*
+* Low overhead instrumentation for CPU zones, counters and frame markers.
+* Every thread writes to its own fixed size ring buffer without locking, old events are overwritten.
+* Buffers are pooled, so short lived threads (like std::async tasks) reuse them instead of allocating new ones.
+* Readers take a snapshot of all buffers, which is what the ImGui panel and the Chrome trace export (chrome://tracing, Perfetto) use.
+* GPU timings are injected on the GPU_THREAD_ID pseudo thread, in CPU time.
+*/
+struct Profiler
+{
+  static const std::uint32_t GPU_THREAD_ID = 0;
+  static const std::size_t EVENTS_PER_THREAD = 1 << 15;
+
+  // Monotonic clock in ns, the time base of all events
+  static std::int64_t nowNs();
+
+  // A disabled profiler records nothing, used to pause captures
+  static void setEnabled(bool enabled);
+  static bool enabled();
+
+  // Threads that exit hand their id to the next new thread
+  static std::uint32_t threadId();
+  // Cheap when the thread already has that name
+  static void setThreadName(const char* name);
+
+  static void zone(const char* name, std::int64_t startNs, std::int64_t endNs);
+  static void counter(const char* name, double value);
+  static void frame();
+  static void gpuZone(const char* name, std::int64_t startNs, std::int64_t endNs);
+
+  // Stable copy of a non-literal name
+  static const char* intern(const std::string& name);
+
+  // Events of all threads newer than sinceNs (and the last clear()), sorted by start time
+  static std::vector<ProfileEvent> snapshot(std::int64_t sinceNs = 0);
+  static std::vector<ProfileThread> threads();
+  static std::uint64_t frameIndex();
+
+  // Hides everything recorded so far from snapshots
+  static void clear();
+
+  static bool writeChromeTrace(const std::filesystem::path& path, std::int64_t sinceNs = 0);
+  static std::string chromeTrace(const std::vector<ProfileEvent>& events);
+};
+
+// Records a zone from construction to destruction
+class ProfileScope
+{
+public:
+  explicit ProfileScope(const char* name)
+    : _name(name)
+    , _startNs(Profiler::enabled() ? Profiler::nowNs() : -1)
+  {}
+
+  ~ProfileScope()
+  {
+    if (_startNs >= 0) {
+      Profiler::zone(_name, _startNs, Profiler::nowNs());
+    }
+  }
+
+  ProfileScope(const ProfileScope&) = delete;
+  ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+  const char* _name;
+  std::int64_t _startNs;
+};
+
+}
+
+#if ANEREND_PROFILING
+#define ANEREND_PROFILE_CONCAT_IMPL(a, b) a##b
+#define ANEREND_PROFILE_CONCAT(a, b) ANEREND_PROFILE_CONCAT_IMPL(a, b)
+#define ANEREND_PROFILE_SCOPE(name) util::ProfileScope ANEREND_PROFILE_CONCAT(_profileScope, __LINE__)(name)
+#define ANEREND_PROFILE_FUNCTION() ANEREND_PROFILE_SCOPE(__func__)
+#define ANEREND_PROFILE_COUNTER(name, value) util::Profiler::counter(name, static_cast<double>(value))
+#define ANEREND_PROFILE_FRAME() util::Profiler::frame()
+#define ANEREND_PROFILE_THREAD(name) util::Profiler::setThreadName(name)
+#else
+#define ANEREND_PROFILE_SCOPE(name)
+#define ANEREND_PROFILE_FUNCTION()
+#define ANEREND_PROFILE_COUNTER(name, value)
+#define ANEREND_PROFILE_FRAME()
+#define ANEREND_PROFILE_THREAD(name)
+#endif
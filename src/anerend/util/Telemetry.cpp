@@ -0,0 +1,214 @@
+#include "Telemetry.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+
+namespace util {
+
+namespace {
+
+// Nearest rank percentile of sorted values
+double percentile(const std::vector<double>& sorted, double p)
+{
+  if (sorted.empty()) {
+    return 0.0;
+  }
+
+  auto rank = (std::size_t)std::ceil(p / 100.0 * sorted.size());
+  return sorted[std::clamp(rank, (std::size_t)1, sorted.size()) - 1];
+}
+
+}
+
+Telemetry::Telemetry(std::size_t windowSize)
+  : _windowSize(std::max(windowSize, (std::size_t)1))
+{
+  _budgetCallback = [](const std::string& gauge, double value, double budget) {
+    printf("Telemetry: %s is over budget (%.2f > %.2f)!\n", gauge.c_str(), value, budget);
+  };
+}
+
+void Telemetry::setBudgetCallback(BudgetCallback callback)
+{
+  _budgetCallback = std::move(callback);
+}
+
+void Telemetry::setBudget(const std::string& name, double budget)
+{
+  auto& g = gauge(name);
+  g._budget = budget;
+  g._overBudget = false;
+}
+
+void Telemetry::record(const std::string& name, double value)
+{
+  auto& g = gauge(name);
+  g._samples[_frame % _windowSize] = value;
+  g._current = value;
+
+  bool over = g._budget > 0.0 && value > g._budget;
+  if (over && !g._overBudget) {
+    g._numExceeded++;
+    if (_budgetCallback) {
+      _budgetCallback(g._name, value, g._budget);
+    }
+  }
+  g._overBudget = over;
+}
+
+void Telemetry::record(const std::string& name, double value, double capacity, double budgetFraction)
+{
+  auto& g = gauge(name);
+  if (g._budget == 0.0) {
+    g._budget = capacity * budgetFraction;
+  }
+
+  record(name, value);
+}
+
+void Telemetry::endFrame()
+{
+  _frame++;
+
+  auto slot = _frame % _windowSize;
+  for (auto& g : _gauges) {
+    g._samples[slot] = std::numeric_limits<double>::quiet_NaN();
+  }
+}
+
+std::vector<std::string> Telemetry::gauges() const
+{
+  std::vector<std::string> out;
+  for (auto& g : _gauges) {
+    out.emplace_back(g._name);
+  }
+  return out;
+}
+
+GaugeStats Telemetry::stats(const std::string& name) const
+{
+  auto it = _gaugeIndices.find(name);
+  if (it == _gaugeIndices.end()) {
+    GaugeStats out{};
+    out._name = name;
+    return out;
+  }
+
+  return stats(_gauges[it->second]);
+}
+
+std::vector<GaugeStats> Telemetry::allStats() const
+{
+  std::vector<GaugeStats> out;
+  out.reserve(_gauges.size());
+  for (auto& g : _gauges) {
+    out.emplace_back(stats(g));
+  }
+  return out;
+}
+
+bool Telemetry::writeSummaryCsv(const std::filesystem::path& path) const
+{
+  std::ofstream ofs(path);
+  if (!ofs) {
+    printf("Could not open %s for writing telemetry!\n", path.string().c_str());
+    return false;
+  }
+
+  ofs << "gauge,current,min,max,mean,p50,p95,p99,budget,samples,exceeded\n";
+  for (auto& s : allStats()) {
+    ofs << s._name << ',' << s._current << ',' << s._min << ',' << s._max << ',' << s._mean << ','
+      << s._p50 << ',' << s._p95 << ',' << s._p99 << ',' << s._budget << ',' << s._numSamples << ',' << s._numExceeded << '\n';
+  }
+
+  return (bool)ofs;
+}
+
+bool Telemetry::writeHistoryCsv(const std::filesystem::path& path) const
+{
+  std::ofstream ofs(path);
+  if (!ofs) {
+    printf("Could not open %s for writing telemetry!\n", path.string().c_str());
+    return false;
+  }
+
+  ofs << "frame";
+  for (auto& g : _gauges) {
+    ofs << ',' << g._name;
+  }
+  ofs << '\n';
+
+  // The window ends with the frame currently being recorded
+  std::uint64_t first = _frame + 1 > _windowSize ? _frame + 1 - _windowSize : 0;
+  for (auto frame = first; frame <= _frame; ++frame) {
+    ofs << frame;
+    for (auto& g : _gauges) {
+      ofs << ',';
+      double v = g._samples[frame % _windowSize];
+      if (!std::isnan(v)) {
+        ofs << v;
+      }
+    }
+    ofs << '\n';
+  }
+
+  return (bool)ofs;
+}
+
+Telemetry::Gauge& Telemetry::gauge(const std::string& name)
+{
+  auto it = _gaugeIndices.find(name);
+  if (it != _gaugeIndices.end()) {
+    return _gauges[it->second];
+  }
+
+  Gauge g{};
+  g._name = name;
+  g._samples.resize(_windowSize, std::numeric_limits<double>::quiet_NaN());
+
+  _gaugeIndices[name] = _gauges.size();
+  _gauges.emplace_back(std::move(g));
+  return _gauges.back();
+}
+
+GaugeStats Telemetry::stats(const Gauge& g) const
+{
+  GaugeStats out{};
+  out._name = g._name;
+  out._current = g._current;
+  out._budget = g._budget;
+  out._numExceeded = g._numExceeded;
+
+  std::vector<double> sorted;
+  sorted.reserve(g._samples.size());
+  for (double v : g._samples) {
+    if (!std::isnan(v)) {
+      sorted.emplace_back(v);
+    }
+  }
+
+  if (sorted.empty()) {
+    return out;
+  }
+
+  std::sort(sorted.begin(), sorted.end());
+
+  double sum = 0.0;
+  for (double v : sorted) {
+    sum += v;
+  }
+
+  out._numSamples = sorted.size();
+  out._min = sorted.front();
+  out._max = sorted.back();
+  out._mean = sum / sorted.size();
+  out._p50 = percentile(sorted, 50.0);
+  out._p95 = percentile(sorted, 95.0);
+  out._p99 = percentile(sorted, 99.0);
+  return out;
+}
+
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace util {
+
+struct GaugeStats
+{
+  std::string _name;
+  double _current = 0.0;
+  double _min = 0.0;
+  double _max = 0.0;
+  double _mean = 0.0;
+  double _p50 = 0.0;
+  double _p95 = 0.0;
+  double _p99 = 0.0;
+  double _budget = 0.0; // 0 means no budget
+  std::size_t _numSamples = 0;
+  std::size_t _numExceeded = 0; // Times the gauge went over its budget
+};
+
+/*
+* Per-frame gauges (frame time, buffer occupancy, cache sizes...) with a rolling window of history.
+* Statistics and percentiles are computed over the window on request.
+* A gauge can have a budget, the budget callback fires when a sample goes over it (once per excursion, not every frame it stays over).
+* The history and the statistics can be dumped to CSV.
+* Not thread safe, meant to be fed from the main loop.
+*/
+class Telemetry
+{
+public:
+  typedef std::function<void(const std::string& gauge, double value, double budget)> BudgetCallback;
+
+  explicit Telemetry(std::size_t windowSize = 600);
+
+  // Called for every gauge that goes over its budget. The default prints a warning.
+  void setBudgetCallback(BudgetCallback callback);
+  // 0 removes the budget
+  void setBudget(const std::string& gauge, double budget);
+
+  void record(const std::string& gauge, double value);
+  // Convenience for occupancy gauges, sets the budget to a fraction of capacity the first time.
+  void record(const std::string& gauge, double value, double capacity, double budgetFraction);
+
+  // Closes the current frame. Gauges that weren't recorded this frame have no sample for it.
+  void endFrame();
+
+  std::uint64_t frameIndex() const { return _frame; }
+  std::size_t windowSize() const { return _windowSize; }
+
+  std::vector<std::string> gauges() const;
+  GaugeStats stats(const std::string& gauge) const;
+  std::vector<GaugeStats> allStats() const;
+
+  // One row per gauge with the statistics
+  bool writeSummaryCsv(const std::filesystem::path& path) const;
+  // One row per frame in the window, one column per gauge
+  bool writeHistoryCsv(const std::filesystem::path& path) const;
+
+private:
+  struct Gauge
+  {
+    std::string _name;
+    std::vector<double> _samples; // Ring indexed by frame, NaN where nothing was recorded
+    double _current = 0.0;
+    double _budget = 0.0;
+    bool _overBudget = false;
+    std::size_t _numExceeded = 0;
+  };
+
+  Gauge& gauge(const std::string& name);
+  GaugeStats stats(const Gauge& gauge) const;
+
+  std::size_t _windowSize;
+  std::uint64_t _frame = 0;
+
+  std::vector<Gauge> _gauges;
+  std::unordered_map<std::string, std::size_t> _gaugeIndices;
+
+  BudgetCallback _budgetCallback;
+};
+
+}
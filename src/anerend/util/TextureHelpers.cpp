@@ -1,25 +1,349 @@
 #include "TextureHelpers.h"
+#include "PixelConversion.h"
 
-#include "../render/ImageHelpers.h"
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/packing.hpp>
 
-#include <ktx.h>
-#include <vulkan/vulkan.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <thread>
 
 namespace util {
 
 namespace {
 
-KTX_error_code fillMipsOfTex(
-  int miplevel, int face,
-  int width, int height, int depth,
-  ktx_uint64_t faceLodSize,
-  void* pixels, void* userdata)
+// Channel layout of the uncompressed formats that the CPU mip generator can filter
+struct PixelLayout
 {
-  auto* tex = (render::asset::Texture*)userdata;
-  tex->_data[miplevel].resize(faceLodSize);
-  std::memcpy(tex->_data[miplevel].data(), pixels, faceLodSize);
+  unsigned _channels = 0;
+  unsigned _bytesPerChannel = 1;
+  bool _srgb = false;
+  bool _half = false;
+};
 
-  return KTX_SUCCESS;
+bool pixelLayout(render::asset::Texture::Format format, PixelLayout& out)
+{
+  using Format = render::asset::Texture::Format;
+
+  switch (format) {
+  case Format::RGBA8_UNORM:    out = { 4, 1, false, false }; return true;
+  case Format::RGBA8_SRGB:     out = { 4, 1, true, false }; return true;
+  case Format::RGB8_SRGB:      out = { 3, 1, true, false }; return true;
+  case Format::RGB8_UNORM:     out = { 3, 1, false, false }; return true;
+  case Format::RG8_UNORM:      out = { 2, 1, false, false }; return true;
+  case Format::RGBA16F_SFLOAT: out = { 4, 2, false, true }; return true;
+  case Format::R8_UNORM:       out = { 1, 1, false, false }; return true;
+  case Format::R16_UNORM:      out = { 1, 2, false, false }; return true;
+  default:
+    return false;
+  }
+}
+
+float srgbToLinear(float c)
+{
+  return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+}
+
+float linearToSrgb(float c)
+{
+  return c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+}
+
+// Only 256 possible inputs, so decode through a table
+const std::array<float, 256>& srgbDecodeTable()
+{
+  static const std::array<float, 256> table = []() {
+    std::array<float, 256> t{};
+    for (unsigned i = 0; i < 256; ++i) {
+      t[i] = srgbToLinear(float(i) / 255.0f);
+    }
+    return t;
+  }();
+  return table;
+}
+
+// Alpha is never sRGB encoded
+bool isColorChannel(const PixelLayout& layout, unsigned channel)
+{
+  return layout._srgb && (layout._channels < 4 || channel < 3);
+}
+
+// Splits [0, numRows) into contiguous chunks, one per worker. The calling thread takes the first chunk.
+void parallelRows(unsigned numRows, unsigned numThreads, const std::function<void(unsigned, unsigned)>& func)
+{
+  const unsigned minRowsPerThread = 16;
+  unsigned numWorkers = std::max(1u, std::min(numThreads, numRows / minRowsPerThread));
+
+  if (numWorkers == 1) {
+    func(0, numRows);
+    return;
+  }
+
+  std::vector<std::thread> threads;
+  threads.reserve(numWorkers - 1);
+
+  unsigned rowsPerWorker = (numRows + numWorkers - 1) / numWorkers;
+  for (unsigned i = 1; i < numWorkers; ++i) {
+    unsigned start = i * rowsPerWorker;
+    unsigned end = std::min(numRows, start + rowsPerWorker);
+    if (start >= end) break;
+    threads.emplace_back(func, start, end);
+  }
+
+  func(0, std::min(numRows, rowsPerWorker));
+
+  for (auto& t : threads) {
+    t.join();
+  }
+}
+
+void decodeLevel(const std::vector<std::uint8_t>& data, const PixelLayout& layout, std::size_t numTexels, std::vector<float>& out, unsigned numThreads)
+{
+  out.resize(numTexels * layout._channels);
+  const auto& srgbTable = srgbDecodeTable();
+
+  parallelRows((unsigned)numTexels, numThreads, [&](unsigned start, unsigned end) {
+    for (std::size_t i = std::size_t(start) * layout._channels; i < std::size_t(end) * layout._channels; ++i) {
+      unsigned channel = unsigned(i % layout._channels);
+
+      if (layout._half) {
+        std::uint16_t v;
+        std::memcpy(&v, &data[i * 2], 2);
+        out[i] = glm::unpackHalf1x16(v);
+      }
+      else if (layout._bytesPerChannel == 2) {
+        std::uint16_t v;
+        std::memcpy(&v, &data[i * 2], 2);
+        out[i] = float(v) / 65535.0f;
+      }
+      else if (isColorChannel(layout, channel)) {
+        out[i] = srgbTable[data[i]];
+      }
+      else {
+        out[i] = float(data[i]) / 255.0f;
+      }
+    }
+  });
+}
+
+void encodeLevel(const std::vector<float>& in, const PixelLayout& layout, float alphaScale, std::vector<std::uint8_t>& out, unsigned numThreads)
+{
+  std::size_t numTexels = in.size() / layout._channels;
+  out.resize(in.size() * layout._bytesPerChannel);
+
+  parallelRows((unsigned)numTexels, numThreads, [&](unsigned start, unsigned end) {
+    for (std::size_t i = std::size_t(start) * layout._channels; i < std::size_t(end) * layout._channels; ++i) {
+      unsigned channel = unsigned(i % layout._channels);
+      float v = in[i];
+
+      if (layout._channels == 4 && channel == 3) {
+        v *= alphaScale;
+      }
+
+      if (layout._half) {
+        std::uint16_t h = glm::packHalf1x16(v);
+        std::memcpy(&out[i * 2], &h, 2);
+        continue;
+      }
+
+      // Sharpening filters ring, so unorm output needs clamping
+      v = std::clamp(v, 0.0f, 1.0f);
+
+      if (layout._bytesPerChannel == 2) {
+        std::uint16_t u = std::uint16_t(v * 65535.0f + 0.5f);
+        std::memcpy(&out[i * 2], &u, 2);
+      }
+      else {
+        if (isColorChannel(layout, channel)) {
+          v = linearToSrgb(v);
+        }
+        out[i] = std::uint8_t(v * 255.0f + 0.5f);
+      }
+    }
+  });
+}
+
+// Zeroth order modified Bessel function of the first kind, used by the Kaiser window
+float besselI0(float x)
+{
+  float sum = 1.0f;
+  float term = 1.0f;
+  float halfX = x * 0.5f;
+  for (int k = 1; k < 32; ++k) {
+    term *= (halfX / k) * (halfX / k);
+    sum += term;
+    if (term < sum * 1e-8f) break;
+  }
+  return sum;
+}
+
+float sinc(float x)
+{
+  if (std::abs(x) < 1e-6f) return 1.0f;
+  float px = glm::pi<float>() * x;
+  return std::sin(px) / px;
+}
+
+// Windowed sinc, x in destination texels
+float kaiser(float x)
+{
+  const float width = 3.0f;
+  const float alpha = 4.0f;
+
+  float t = x / width;
+  if (std::abs(t) >= 1.0f) return 0.0f;
+  return sinc(x) * besselI0(alpha * std::sqrt(1.0f - t * t)) / besselI0(alpha);
+}
+
+// Filter taps for every destination texel along one axis.
+// Taps of texel i are _indices/_weights in [_offsets[i], _offsets[i + 1]).
+struct FilterTaps
+{
+  std::vector<unsigned> _offsets;
+  std::vector<unsigned> _indices;
+  std::vector<float> _weights;
+};
+
+FilterTaps buildTaps(unsigned srcSize, unsigned dstSize, util::MipFilter filter, bool wrap)
+{
+  FilterTaps taps;
+  taps._offsets.reserve(dstSize + 1);
+
+  float scale = float(srcSize) / float(dstSize);
+  float radius = filter == util::MipFilter::Box ? scale * 0.5f : scale * 3.0f;
+
+  for (unsigned i = 0; i < dstSize; ++i) {
+    taps._offsets.push_back((unsigned)taps._indices.size());
+
+    float center = (float(i) + 0.5f) * scale;
+    int first = int(std::floor(center - radius));
+    int last = int(std::ceil(center + radius));
+
+    float sum = 0.0f;
+    std::size_t firstTap = taps._weights.size();
+
+    for (int j = first; j < last; ++j) {
+      float w = 0.0f;
+      if (filter == util::MipFilter::Box) {
+        // Area of source texel j covered by the destination texel
+        float lo = std::max(float(j), center - radius);
+        float hi = std::min(float(j + 1), center + radius);
+        w = std::max(0.0f, hi - lo);
+      }
+      else {
+        w = kaiser((float(j) + 0.5f - center) / scale);
+      }
+
+      if (w == 0.0f) continue;
+
+      int idx = j;
+      if (wrap) {
+        idx = ((j % int(srcSize)) + int(srcSize)) % int(srcSize);
+      }
+      else {
+        idx = std::clamp(j, 0, int(srcSize) - 1);
+      }
+
+      taps._indices.push_back((unsigned)idx);
+      taps._weights.push_back(w);
+      sum += w;
+    }
+
+    if (sum != 0.0f) {
+      for (std::size_t k = firstTap; k < taps._weights.size(); ++k) {
+        taps._weights[k] /= sum;
+      }
+    }
+  }
+
+  taps._offsets.push_back((unsigned)taps._indices.size());
+  return taps;
+}
+
+// Separable downsample, horizontal pass into tmp followed by a vertical pass into dst
+void downsample(
+  const std::vector<float>& src, unsigned srcW, unsigned srcH,
+  std::vector<float>& dst, unsigned dstW, unsigned dstH,
+  unsigned channels, util::MipFilter filter, bool wrap, unsigned numThreads)
+{
+  FilterTaps xTaps = buildTaps(srcW, dstW, filter, wrap);
+  FilterTaps yTaps = buildTaps(srcH, dstH, filter, wrap);
+
+  std::vector<float> tmp(std::size_t(dstW) * srcH * channels, 0.0f);
+  dst.assign(std::size_t(dstW) * dstH * channels, 0.0f);
+
+  parallelRows(srcH, numThreads, [&](unsigned start, unsigned end) {
+    for (unsigned y = start; y < end; ++y) {
+      const float* srcRow = &src[std::size_t(y) * srcW * channels];
+      float* tmpRow = &tmp[std::size_t(y) * dstW * channels];
+
+      for (unsigned x = 0; x < dstW; ++x) {
+        for (unsigned t = xTaps._offsets[x]; t < xTaps._offsets[x + 1]; ++t) {
+          const float* s = srcRow + std::size_t(xTaps._indices[t]) * channels;
+          float w = xTaps._weights[t];
+          for (unsigned c = 0; c < channels; ++c) {
+            tmpRow[x * channels + c] += w * s[c];
+          }
+        }
+      }
+    }
+  });
+
+  parallelRows(dstH, numThreads, [&](unsigned start, unsigned end) {
+    for (unsigned y = start; y < end; ++y) {
+      float* dstRow = &dst[std::size_t(y) * dstW * channels];
+
+      for (unsigned t = yTaps._offsets[y]; t < yTaps._offsets[y + 1]; ++t) {
+        const float* tmpRow = &tmp[std::size_t(yTaps._indices[t]) * dstW * channels];
+        float w = yTaps._weights[t];
+        for (std::size_t i = 0; i < std::size_t(dstW) * channels; ++i) {
+          dstRow[i] += w * tmpRow[i];
+        }
+      }
+    }
+  });
+}
+
+float alphaCoverage(const std::vector<float>& texels, float alphaScale, float cutoff)
+{
+  std::size_t numTexels = texels.size() / 4;
+  if (numTexels == 0) return 0.0f;
+
+  std::size_t covered = 0;
+  for (std::size_t i = 0; i < numTexels; ++i) {
+    if (texels[i * 4 + 3] * alphaScale > cutoff) {
+      covered++;
+    }
+  }
+  return float(covered) / float(numTexels);
+}
+
+// Binary search for the alpha scale that gives the level the wanted coverage
+float findAlphaScale(const std::vector<float>& texels, float targetCoverage, float cutoff)
+{
+  float lo = 0.0f;
+  float hi = 4.0f;
+  float best = 1.0f;
+  float bestDiff = std::abs(alphaCoverage(texels, 1.0f, cutoff) - targetCoverage);
+
+  for (int i = 0; i < 16; ++i) {
+    float mid = (lo + hi) * 0.5f;
+    float coverage = alphaCoverage(texels, mid, cutoff);
+    float diff = std::abs(coverage - targetCoverage);
+
+    if (diff < bestDiff) {
+      best = mid;
+      bestDiff = diff;
+    }
+
+    if (coverage < targetCoverage) lo = mid;
+    else hi = mid;
+  }
+
+  return best;
 }
 
 }
@@ -32,16 +356,12 @@ render::asset::Texture TextureHelpers::createTextureRGBA8(unsigned w, unsigned h
   tex._height = h;
   tex._format = render::asset::Texture::Format::RGBA8_UNORM;
   tex._data.emplace_back();
-  tex._data.back().resize(w * h * 4);
+  tex._data.back().resize(std::size_t(w) * h * 4);
 
+  // Texels are written in memory order
   auto& data = tex._data.back();
-  for (unsigned x = 0; x < w; x++) {
-    for (unsigned y = 0; y < h; y++) {
-      data[4 * (w * y + x) + 0] = val[0];
-      data[4 * (w * y + x) + 1] = val[1];
-      data[4 * (w * y + x) + 2] = val[2];
-      data[4 * (w * y + x) + 3] = val[3];
-    }
+  for (std::size_t i = 0; i < data.size(); i += 4) {
+    std::memcpy(&data[i], &val[0], 4);
   }
 
   return tex;
@@ -54,210 +374,102 @@ render::asset::Texture TextureHelpers::createTextureR8(unsigned w, unsigned h, s
   tex._width = w;
   tex._height = h;
   tex._format = render::asset::Texture::Format::R8_UNORM;
-  tex._data.emplace_back();
-  tex._data.back().resize(w * h);
-
-  auto& data = tex._data.back();
-  for (unsigned x = 0; x < w; x++) {
-    for (unsigned y = 0; y < h; y++) {
-      data[w * y + x] = val;
-    }
-  }
+  tex._data.emplace_back(std::size_t(w) * h, val);
 
   return tex;
 }
 
-std::vector<std::uint8_t> TextureHelpers::convertRGBA8ToRGB8(std::vector<std::uint8_t> in)
+std::vector<std::uint8_t> TextureHelpers::convertRGBA8ToRGB8(const std::vector<std::uint8_t>& in)
 {
+  const unsigned channels[] = { 0, 1, 2 };
+
   std::vector<std::uint8_t> out;
   out.resize(in.size() / 4 * 3);
-
-  for (std::size_t i = 0; i < in.size() / 4; ++i) {
-    out[i * 3 + 0] = in[i * 4 + 0];
-    out[i * 3 + 1] = in[i * 4 + 1];
-    out[i * 3 + 2] = in[i * 4 + 2];
-  }
+  PixelConversion::extractChannels(in.data(), out.data(), in.size() / 4, 3, channels);
 
   return out;
 }
 
-std::vector<std::uint8_t> TextureHelpers::convertRGBA8ToRG8(std::vector<std::uint8_t> in, std::vector<unsigned> channels)
+std::vector<std::uint8_t> TextureHelpers::convertRGBA8ToRG8(const std::vector<std::uint8_t>& in, std::vector<unsigned> channels)
 {
   std::vector<std::uint8_t> out;
   out.resize(in.size() / 4 * 2);
-
-  for (std::size_t i = 0; i < in.size() / 4; ++i) {
-    out[i * 2 + 0] = in[i * 4 + channels[0]];
-    out[i * 2 + 1] = in[i * 4 + channels[1]];
-  }
+  PixelConversion::extractChannels(in.data(), out.data(), in.size() / 4, 2, channels.data());
 
   return out;
 }
 
-void TextureHelpers::convertRGBA8ToBC7(render::asset::Texture& tex)
+void TextureHelpers::convertRGBA8ToBC7(render::asset::Texture& tex, BCQuality quality)
 {
-  ktxTexture2* texture;
-  ktxTextureCreateInfo createInfo;
-  KTX_error_code result;
-  ktx_uint32_t level, layer, faceSlice;
-  ktx_size_t srcSize;
-  ktxBasisParams params = { 0 };
-  params.structSize = sizeof(params);
-
-  createInfo.glInternalformat = 0;  //Ignored as we'll create a KTX2 texture.
-  createInfo.vkFormat = render::imageutil::texFormatToVk(tex._format);
-  createInfo.baseWidth = tex._width;
-  createInfo.baseHeight = tex._height;
-  createInfo.baseDepth = 1;
-  createInfo.numDimensions = std::min(render::imageutil::numDimensions(tex._format), 3u);
-  createInfo.numLevels = tex._numMips;
-  createInfo.numLayers = 1;
-  createInfo.numFaces = 1;
-  createInfo.isArray = KTX_FALSE;
-  createInfo.generateMipmaps = KTX_FALSE;
-
-  result = ktxTexture2_Create(&createInfo,
-    KTX_TEXTURE_CREATE_ALLOC_STORAGE,
-    &texture);
-
-  if (result != KTX_SUCCESS) {
-    printf("Could not create ktx image!\n");
-    return;
-  }
-
-  layer = 0;
-  faceSlice = 0;
-  for (unsigned i = 0; i < tex._numMips; ++i) {
-    srcSize = tex._data[i].size();
-    level = i;
+  BCOptions options;
+  options._quality = quality;
+  BlockCompressor::compressTexture(tex, BCFormat::BC7, options);
+}
 
-    result = ktxTexture_SetImageFromMemory(ktxTexture(texture), level, layer, faceSlice, tex._data[i].data(), srcSize);
+void TextureHelpers::convertRG8ToBC5(render::asset::Texture& tex, BCQuality quality)
+{
+  BCOptions options;
+  options._quality = quality;
+  BlockCompressor::compressTexture(tex, BCFormat::BC5, options);
+}
 
-    if (result != KTX_SUCCESS) {
-      printf("Could not create ktx image!\n");
-      return;
-    }
+bool TextureHelpers::generateMipMaps(render::asset::Texture& tex, const MipOptions& options)
+{
+  PixelLayout layout;
+  if (!pixelLayout(tex._format, layout)) {
+    printf("Cannot generate mips on the CPU for compressed texture %s!\n", tex._name.c_str());
+    return false;
   }
 
-  // Compress I guess...
-  // For BasisLZ/ETC1S
-  params.compressionLevel = KTX_ETC1S_DEFAULT_COMPRESSION_LEVEL;
-  params.threadCount = 8;
-  // For UASTC
-  params.uastc = KTX_TRUE;
-  // Set other BasisLZ/ETC1S or UASTC params to change default quality settings.
-  result = ktxTexture2_CompressBasisEx(texture, &params);
-
-  if (result != KTX_SUCCESS) {
-    printf("Could not compress ktx!\n");
-    return;
+  if (tex._data.empty() || tex._width == 0 || tex._height == 0) {
+    printf("Cannot generate mips for empty texture %s!\n", tex._name.c_str());
+    return false;
   }
-  
-  ktx_transcode_fmt_e targetFormat = KTX_TTF_BC7_RGBA;
 
-  // Transcode
-  if (ktxTexture2_NeedsTranscoding(texture)) {
-    result = ktxTexture2_TranscodeBasis(texture, targetFormat, 0);
+  unsigned numThreads = options._numThreads;
+  if (numThreads == 0) {
+    numThreads = std::max(1u, std::thread::hardware_concurrency());
   }
 
-  if (result != VK_SUCCESS) {
-    printf("Could not transcode to bc7!\n");
-    return;
-  }
+  // Same chain length and sizes as the GPU path (MipMapGenerator)
+  unsigned numMips = static_cast<unsigned>(std::floor(std::log2(std::max(tex._width, tex._height)))) + 1;
+  bool wrap = !tex._clampToEdge;
+  bool keepCoverage = options._preserveAlphaCoverage && layout._channels == 4;
 
-  // Copy data to output
-  ktxTexture_IterateLevels(ktxTexture(texture), fillMipsOfTex, &tex);
-  auto vkFormat = (VkFormat)texture->vkFormat;
-  switch (vkFormat) {
-  case VK_FORMAT_BC7_SRGB_BLOCK:
-    tex._format = render::asset::Texture::Format::RGBA_SRGB_BC7;
-    break;
-  case VK_FORMAT_BC7_UNORM_BLOCK:
-    tex._format = render::asset::Texture::Format::RGBA_UNORM_BC7;
-    break;
-  default:
-    tex._format = render::asset::Texture::Format::RGBA_UNORM_BC7;
-  }
-}
+  tex._data.resize(1);
+  tex._numMips = 1;
 
-void TextureHelpers::convertRG8ToBC5(render::asset::Texture& tex)
-{
-  ktxTexture2* texture;
-  ktxTextureCreateInfo createInfo;
-  KTX_error_code result;
-  ktx_uint32_t level, layer, faceSlice;
-  ktx_size_t srcSize;
-  ktxBasisParams params = { 0 };
-  params.structSize = sizeof(params);
-
-  createInfo.glInternalformat = 0;  //Ignored as we'll create a KTX2 texture.
-  createInfo.vkFormat = render::imageutil::texFormatToVk(tex._format);
-  createInfo.baseWidth = tex._width;
-  createInfo.baseHeight = tex._height;
-  createInfo.baseDepth = 1;
-  createInfo.numDimensions = std::min(render::imageutil::numDimensions(tex._format), 3u);
-  createInfo.numLevels = tex._numMips;
-  createInfo.numLayers = 1;
-  createInfo.numFaces = 1;
-  createInfo.isArray = KTX_FALSE;
-  createInfo.generateMipmaps = KTX_FALSE;
-
-  result = ktxTexture2_Create(&createInfo,
-    KTX_TEXTURE_CREATE_ALLOC_STORAGE,
-    &texture);
-
-  if (result != KTX_SUCCESS) {
-    printf("Could not create ktx image!\n");
-    return;
-  }
+  // Every level is filtered from the previous float level, so precision is only lost once on encode.
+  // Coverage scaling is only applied to the encoded output, not to the chain.
+  std::vector<float> curr;
+  decodeLevel(tex._data[0], layout, std::size_t(tex._width) * tex._height, curr, numThreads);
 
-  layer = 0;
-  faceSlice = 0;
-  for (unsigned i = 0; i < tex._numMips; ++i) {
-    srcSize = tex._data[i].size();
-    level = i;
+  float targetCoverage = keepCoverage ? alphaCoverage(curr, 1.0f, options._alphaCutoff) : 0.0f;
 
-    result = ktxTexture_SetImageFromMemory(ktxTexture(texture), level, layer, faceSlice, tex._data[i].data(), srcSize);
+  unsigned mipWidth = tex._width;
+  unsigned mipHeight = tex._height;
+  std::vector<float> next;
 
-    if (result != KTX_SUCCESS) {
-      printf("Could not create ktx image!\n");
-      return;
-    }
-  }
+  for (unsigned i = 1; i < numMips; ++i) {
+    unsigned nextWidth = mipWidth > 1 ? mipWidth / 2 : 1;
+    unsigned nextHeight = mipHeight > 1 ? mipHeight / 2 : 1;
 
-  // Compress I guess...
-  // For BasisLZ/ETC1S
-  params.compressionLevel = KTX_ETC1S_DEFAULT_COMPRESSION_LEVEL;
-  params.threadCount = 8;
-  // For UASTC
-  params.uastc = KTX_TRUE;
-  params.inputSwizzle[0] = 'r';
-  params.inputSwizzle[1] = 'r';
-  params.inputSwizzle[2] = 'r';
-  params.inputSwizzle[3] = 'g';
-  // Set other BasisLZ/ETC1S or UASTC params to change default quality settings.
-  result = ktxTexture2_CompressBasisEx(texture, &params);
-
-  if (result != KTX_SUCCESS) {
-    printf("Could not compress ktx!\n");
-    return;
-  }
+    downsample(curr, mipWidth, mipHeight, next, nextWidth, nextHeight, layout._channels, options._filter, wrap, numThreads);
 
-  ktx_transcode_fmt_e targetFormat = KTX_TTF_BC5_RG;
+    float alphaScale = 1.0f;
+    if (keepCoverage) {
+      alphaScale = findAlphaScale(next, targetCoverage, options._alphaCutoff);
+    }
 
-  // Transcode
-  if (ktxTexture2_NeedsTranscoding(texture)) {
-    result = ktxTexture2_TranscodeBasis(texture, targetFormat, 0);
-  }
+    encodeLevel(next, layout, alphaScale, tex._data.emplace_back(), numThreads);
+    tex._numMips++;
 
-  if (result != VK_SUCCESS) {
-    printf("Could not transcode to bc7!\n");
-    return;
+    std::swap(curr, next);
+    mipWidth = nextWidth;
+    mipHeight = nextHeight;
   }
 
-  // Copy data to output
-  ktxTexture_IterateLevels(ktxTexture(texture), fillMipsOfTex, &tex);
-  tex._format = render::asset::Texture::Format::RG_UNORM_BC5;
+  return true;
 }
 
 }
\ No newline at end of file
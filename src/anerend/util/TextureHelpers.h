@@ -1,5 +1,6 @@
 #pragma once
 
+#include "BlockCompressor.h"
 #include "../render/asset/Texture.h"
 
 #include <glm/glm.hpp>
@@ -9,6 +10,24 @@
 
 namespace util {
 
+enum class MipFilter
+{
+  Box,
+  Kaiser
+};
+
+struct MipOptions
+{
+  MipFilter _filter = MipFilter::Box;
+
+  // Scales alpha of each mip so that the fraction of texels above _alphaCutoff matches mip 0.
+  // Keeps alpha tested foliage etc from thinning out in the distance.
+  bool _preserveAlphaCoverage = false;
+  float _alphaCutoff = 0.5f;
+
+  unsigned _numThreads = 0; // 0 means std::thread::hardware_concurrency()
+};
+
 struct TextureHelpers
 {
 
@@ -17,16 +36,21 @@ struct TextureHelpers
   static render::asset::Texture createTextureR8(unsigned w, unsigned h, std::uint8_t val);
 
   // 1 byte per channel
-  static std::vector<std::uint8_t> convertRGBA8ToRGB8(std::vector<std::uint8_t> in);
+  static std::vector<std::uint8_t> convertRGBA8ToRGB8(const std::vector<std::uint8_t>& in);
 
   // 1 byte per channel, channels {1, 2} means GB to RG
-  static std::vector<std::uint8_t> convertRGBA8ToRG8(std::vector<std::uint8_t> in, std::vector<unsigned> channels = { 1, 2 });
+  static std::vector<std::uint8_t> convertRGBA8ToRG8(const std::vector<std::uint8_t>& in, std::vector<unsigned> channels = { 1, 2 });
 
-  // Output will also be 4 component
-  static void convertRGBA8ToBC7(render::asset::Texture& tex);
+  // Output will also be 4 component. Compresses all mips, see BlockCompressor.
+  static void convertRGBA8ToBC7(render::asset::Texture& tex, BCQuality quality = BCQuality::Normal);
 
   // Output will be 2 component
-  static void convertRG8ToBC5(render::asset::Texture& tex);
+  static void convertRG8ToBC5(render::asset::Texture& tex, BCQuality quality = BCQuality::Normal);
+
+  // CPU version of RenderContext::generateMipMaps, needs no GPU.
+  // Keeps _data[0] and replaces the rest with a full mip chain, filtered in linear space for sRGB formats.
+  // Block compressed formats can't be filtered and return false, generate mips before compressing.
+  static bool generateMipMaps(render::asset::Texture& tex, const MipOptions& options = MipOptions());
 
 };
 
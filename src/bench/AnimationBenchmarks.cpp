@@ -0,0 +1,260 @@
+#include "Benchmarks.h"
+#include "Bench.h"
+#include "SyntheticData.h"
+
+#include <render/animation/internal/Animator.h>
+#include <render/scene/Scene.h>
+#include <util/Interpolation.h>
+
+#include <cstdio>
+#include <memory>
+#include <random>
+
+namespace bench {
+
+namespace {
+
+struct AnimationState
+{
+  std::unique_ptr<render::scene::Scene> _scene;
+  render::anim::Animation _anim;
+  component::Skeleton _skeleton;
+  render::anim::internal::Animator _animator;
+};
+
+// A chain of numJoints joint nodes, each animated by a rotation and a translation channel.
+void buildSkeleton(AnimationState& state, unsigned numJoints, unsigned numKeys)
+{
+  state._scene = std::make_unique<render::scene::Scene>();
+  state._anim = SyntheticData::animation(numJoints, numKeys, 4.0f, 20);
+  state._skeleton = component::Skeleton{};
+
+  auto& scene = *state._scene;
+  util::Uuid parent;
+
+  for (unsigned j = 0; j < numJoints; ++j) {
+    auto id = scene.addNode(render::scene::Node{});
+    scene.registry().addComponent<component::Transform>(id, glm::mat4(1.0f), glm::mat4(1.0f));
+
+    if (parent) {
+      scene.addNodeChild(parent, id);
+    }
+    parent = id;
+
+    component::Skeleton::JointRef ref{};
+    ref._internalId = (int)j;
+    ref._node = id;
+    state._skeleton._jointRefs.emplace_back(std::move(ref));
+  }
+
+  state._animator = render::anim::internal::Animator{};
+  state._animator.init(state._anim, state._skeleton);
+  state._animator.play();
+}
+
+// Index of the first pre-calculated frame at or after time, or the last one. The linear scan Animator used to do.
+std::size_t findPrecalcFrameLinear(const render::anim::Animation& anim, double time)
+{
+  for (std::size_t i = 0; i < anim._keyframes.size(); ++i) {
+    if (anim._keyframes[i].first >= time) {
+      return i;
+    }
+  }
+
+  return anim._keyframes.empty() ? 0 : anim._keyframes.size() - 1;
+}
+
+// The animator's frame lookups have to agree with the linear scan, both playing forward and jumping around
+bool checkPrecalcFrames(AnimationState& state)
+{
+  auto& anim = state._anim;
+  if (anim._keyframes.empty()) {
+    printf("No pre-calculated frames!\n");
+    return false;
+  }
+
+  for (std::size_t i = 1; i < anim._keyframes.size(); ++i) {
+    if (anim._keyframes[i].first < anim._keyframes[i - 1].first) {
+      printf("Pre-calculated frames are not sorted at %zu!\n", i);
+      return false;
+    }
+  }
+
+  std::mt19937 rng(7);
+  double maxTime = anim._keyframes.back().first + 0.1;
+  std::uniform_real_distribution<double> any(0.0, maxTime);
+
+  for (unsigned i = 0; i < 2000; ++i) {
+    double time = i < 1000 ? maxTime * i / 1000.0 : any(rng);
+    auto idx = state._animator.findClosestPrecalcTime(anim, time);
+    auto expected = findPrecalcFrameLinear(anim, time);
+
+    if (idx != expected) {
+      printf("Pre-calculated frame for time %lf is %zu, expected %zu!\n", time, idx, expected);
+      return false;
+    }
+  }
+
+  return true;
+}
+
+struct KeyframeState
+{
+  util::interp::KeyframeTrack<> _track;
+  std::vector<double> _times;
+};
+
+// numKeys unevenly spaced keys, and numLookups times to look up, either playing forward or random.
+void buildKeyframes(KeyframeState& state, unsigned numKeys, unsigned numLookups, bool scrub)
+{
+  std::mt19937 rng(1337);
+  std::uniform_real_distribution<float> step(0.01f, 0.05f);
+
+  std::vector<float> times(numKeys);
+  float t = 0.0f;
+  for (auto& time : times) {
+    time = t;
+    t += step(rng);
+  }
+
+  std::uniform_real_distribution<double> any(0.0, (double)t);
+  state._times.resize(numLookups);
+  for (unsigned i = 0; i < numLookups; ++i) {
+    state._times[i] = scrub ? any(rng) : (double)t * i / numLookups;
+  }
+
+  state._track = util::interp::KeyframeTrack<>(std::move(times));
+}
+
+}
+
+void registerAnimationBenchmarks(Runner& runner)
+{
+  {
+    // Pure sampling, 1000 frames of a 64 joint skeleton
+    constexpr unsigned numJoints = 64;
+    constexpr unsigned numFrames = 1000;
+    auto state = std::make_shared<AnimationState>();
+
+    Benchmark b{};
+    b._group = "animation";
+    b._name = "sample_64_joints_120_keys";
+    b._items = numFrames * numJoints * 2;
+    b._setup = [state]() {
+      if (!state->_scene) {
+        buildSkeleton(*state, numJoints, 120);
+      }
+    };
+    b._run = [state]() {
+      for (unsigned f = 0; f < numFrames; ++f) {
+        state->_animator.updateNoPreCalc(state->_scene.get(), state->_anim, state->_skeleton, 1.0 / 60.0);
+      }
+    };
+    runner.add(std::move(b));
+  }
+
+  {
+    // Sampling followed by the scene propagating the joint transforms, per frame
+    constexpr unsigned numJoints = 64;
+    constexpr unsigned numFrames = 100;
+    auto state = std::make_shared<AnimationState>();
+
+    Benchmark b{};
+    b._group = "animation";
+    b._name = "frames_with_scene_update_64_joints";
+    b._items = numFrames;
+    b._setup = [state]() {
+      if (!state->_scene) {
+        buildSkeleton(*state, numJoints, 120);
+      }
+    };
+    b._run = [state]() {
+      for (unsigned f = 0; f < numFrames; ++f) {
+        state->_animator.updateNoPreCalc(state->_scene.get(), state->_anim, state->_skeleton, 1.0 / 60.0);
+        state->_scene->update();
+      }
+    };
+    runner.add(std::move(b));
+  }
+
+  {
+    // Playback from pre-calculated frames, which only looks up the closest frame and copies its joints
+    constexpr unsigned numJoints = 64;
+    constexpr unsigned numFrames = 1000;
+    auto state = std::make_shared<AnimationState>();
+
+    Benchmark b{};
+    b._group = "animation";
+    b._name = "precalc_64_joints_120_keys";
+    b._items = numFrames * numJoints;
+    b._setup = [state]() {
+      if (!state->_scene) {
+        buildSkeleton(*state, numJoints, 120);
+        state->_animator.precalculateAnimationFrames(state->_scene.get(), state->_anim, state->_skeleton, 30);
+      }
+    };
+    b._check = [state]() {
+      return checkPrecalcFrames(*state);
+    };
+    b._run = [state]() {
+      for (unsigned f = 0; f < numFrames; ++f) {
+        state->_animator.update(state->_scene.get(), state->_anim, state->_skeleton, 1.0 / 60.0);
+      }
+    };
+    runner.add(std::move(b));
+  }
+
+  {
+    // Keyframe lookups while playing, a few lookups per key so that the cursor stays put or moves one key
+    constexpr unsigned numKeys = 10000;
+    constexpr unsigned numLookups = 4 * numKeys;
+    auto state = std::make_shared<KeyframeState>();
+
+    Benchmark b{};
+    b._group = "animation";
+    b._name = "keyframes_playback_10000";
+    b._items = numLookups;
+    b._setup = [state]() {
+      if (state->_times.empty()) {
+        buildKeyframes(*state, numKeys, numLookups, false);
+      }
+    };
+    b._run = [state]() {
+      util::interp::KeyframeCursor cursor;
+      double sum = 0.0;
+      for (double time : state->_times) {
+        sum += state->_track.find(time, cursor)._factor;
+      }
+      doNotOptimize(sum);
+    };
+    runner.add(std::move(b));
+  }
+
+  {
+    // Keyframe lookups at random times, every one of them falls back to a binary search
+    constexpr unsigned numKeys = 10000;
+    constexpr unsigned numLookups = 4 * numKeys;
+    auto state = std::make_shared<KeyframeState>();
+
+    Benchmark b{};
+    b._group = "animation";
+    b._name = "keyframes_scrub_10000";
+    b._items = numLookups;
+    b._setup = [state]() {
+      if (state->_times.empty()) {
+        buildKeyframes(*state, numKeys, numLookups, true);
+      }
+    };
+    b._run = [state]() {
+      util::interp::KeyframeCursor cursor;
+      double sum = 0.0;
+      for (double time : state->_times) {
+        sum += state->_track.find(time, cursor)._factor;
+      }
+      doNotOptimize(sum);
+    };
+    runner.add(std::move(b));
+  }
+}
+
+}
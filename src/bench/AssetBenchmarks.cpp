@@ -0,0 +1,216 @@
+#include "Benchmarks.h"
+#include "Bench.h"
+#include "SyntheticData.h"
+
+#include <render/asset/AssetCollection.h>
+#include <render/serialisation/Serialisation.h>
+#include <util/GLTFLoader.h>
+#include <util/TextureHelpers.h>
+
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace bench {
+
+namespace {
+
+template <typename T>
+void registerRoundTrip(Runner& runner, const std::string& name, std::size_t items, std::function<T()> generator)
+{
+  auto asset = std::make_shared<std::optional<T>>();
+
+  Benchmark b{};
+  b._group = "serialisation";
+  b._name = name;
+  b._items = items;
+  b._setup = [asset, generator]() {
+    if (!*asset) {
+      *asset = generator();
+    }
+  };
+  b._run = [asset]() {
+    auto data = serialisation::serializeToVector(**asset);
+    auto out = serialisation::deserializeVector<T>(data);
+    doNotOptimize(out);
+  };
+  runner.add(std::move(b));
+}
+
+constexpr unsigned g_NumCollectionTextures = 16;
+constexpr unsigned g_CollectionTextureSize = 512;
+constexpr unsigned g_NumCollectionModels = 16;
+
+struct CollectionState
+{
+  std::filesystem::path _path;
+  std::vector<util::Uuid> _textures;
+  std::vector<util::Uuid> _models;
+
+  std::unique_ptr<render::asset::AssetCollection> _coll;
+};
+
+// Writes the collection once per process, every benchmark then reads it with a fresh AssetCollection
+// so that nothing is served from its cache.
+void ensureCollection(CollectionState& state)
+{
+  if (!state._path.empty()) {
+    return;
+  }
+
+  state._path = SyntheticData::scratchPath("bench_assets.dat");
+
+  render::asset::AssetCollection coll;
+
+  for (unsigned i = 0; i < g_NumCollectionTextures; ++i) {
+    auto tex = SyntheticData::textureRGBA8(g_CollectionTextureSize, g_CollectionTextureSize, true, 100 + i);
+    util::TextureHelpers::generateMipMaps(tex);
+    state._textures.emplace_back(tex._id);
+    coll.add(std::move(tex));
+  }
+
+  for (unsigned i = 0; i < g_NumCollectionModels; ++i) {
+    auto model = SyntheticData::model(4, 32, 200 + i);
+    state._models.emplace_back(model._id);
+    coll.add(std::move(model));
+
+    coll.add(SyntheticData::material(300 + i));
+  }
+
+  coll.add(SyntheticData::animation(32, 120, 4.0f, 400));
+
+  coll.serialiseToPath(state._path);
+}
+
+void openCollection(CollectionState& state, bool readIndices)
+{
+  ensureCollection(state);
+
+  state._coll = std::make_unique<render::asset::AssetCollection>(state._path);
+  if (readIndices) {
+    state._coll->readIndices();
+  }
+}
+
+}
+
+void registerAssetBenchmarks(Runner& runner)
+{
+  serialisation::setDeserialisedVersion(g_CurrVersion);
+
+  registerRoundTrip<render::asset::Model>(runner, "model_roundtrip_8x64", 8 * 65 * 65, []() {
+    return SyntheticData::model(8, 64, 1);
+  });
+
+  registerRoundTrip<render::asset::Texture>(runner, "texture_roundtrip_1024", 1024 * 1024, []() {
+    auto tex = SyntheticData::textureRGBA8(1024, 1024, true, 2);
+    util::TextureHelpers::generateMipMaps(tex);
+    return tex;
+  });
+
+  registerRoundTrip<render::anim::Animation>(runner, "animation_roundtrip_50x200", 50 * 2 * 200, []() {
+    return SyntheticData::animation(50, 200, 8.0f, 3);
+  });
+
+  auto collState = std::make_shared<CollectionState>();
+
+  {
+    Benchmark b{};
+    b._group = "assets";
+    b._name = "read_indices";
+    b._setup = [collState]() { openCollection(*collState, false); };
+    b._run = [collState]() { collState->_coll->readIndices(); };
+    runner.add(std::move(b));
+  }
+
+  {
+    Benchmark b{};
+    b._group = "assets";
+    b._name = "get_textures_full";
+    b._items = g_NumCollectionTextures;
+    b._setup = [collState]() { openCollection(*collState, true); };
+    b._run = [collState]() {
+      for (auto& id : collState->_textures) {
+        auto tex = collState->_coll->getTextureBlocking(id);
+        doNotOptimize(tex._data.size());
+      }
+    };
+    runner.add(std::move(b));
+  }
+
+  {
+    // What texture streaming reads when a texture first comes into use
+    Benchmark b{};
+    b._group = "assets";
+    b._name = "get_textures_tail_128";
+    b._items = g_NumCollectionTextures;
+    b._setup = [collState]() { openCollection(*collState, true); };
+    b._run = [collState]() {
+      for (auto& id : collState->_textures) {
+        auto tex = collState->_coll->getTextureTailBlocking(id, 128);
+        doNotOptimize(tex._data.size());
+      }
+    };
+    runner.add(std::move(b));
+  }
+
+  {
+    Benchmark b{};
+    b._group = "assets";
+    b._name = "get_textures_mips_from_1";
+    b._items = g_NumCollectionTextures;
+    b._setup = [collState]() { openCollection(*collState, true); };
+    b._run = [collState]() {
+      for (auto& id : collState->_textures) {
+        auto tex = collState->_coll->getTextureMipsBlocking(id, 1);
+        doNotOptimize(tex._data.size());
+      }
+    };
+    runner.add(std::move(b));
+  }
+
+  {
+    Benchmark b{};
+    b._group = "assets";
+    b._name = "get_models";
+    b._items = g_NumCollectionModels;
+    b._setup = [collState]() { openCollection(*collState, true); };
+    b._run = [collState]() {
+      for (auto& id : collState->_models) {
+        auto model = collState->_coll->getModelBlocking(id);
+        doNotOptimize(model._meshes.size());
+      }
+    };
+    runner.add(std::move(b));
+  }
+
+  {
+    constexpr unsigned numNodes = 64;
+    auto path = std::make_shared<std::filesystem::path>();
+
+    Benchmark b{};
+    b._group = "gltf";
+    b._name = "import_64_meshes";
+    b._items = numNodes;
+    b._samples = 5;
+    b._setup = [path]() {
+      if (path->empty()) {
+        *path = SyntheticData::scratchPath("bench_scene.gltf");
+        SyntheticData::writeGltf(*path, numNodes, 32, 5);
+      }
+    };
+    b._run = [path]() {
+      std::vector<render::asset::Prefab> prefabs;
+      std::vector<render::asset::Model> models;
+      std::vector<render::asset::Texture> textures;
+      std::vector<render::asset::Material> materials;
+      std::vector<render::anim::Animation> animations;
+
+      util::GLTFLoader::loadFromFile(path->string(), prefabs, models, textures, materials, animations);
+      doNotOptimize(models.size());
+    };
+    runner.add(std::move(b));
+  }
+}
+
+}
@@ -0,0 +1,157 @@
+#include "Benchmarks.h"
+#include "Bench.h"
+
+#include <behaviour/BehaviourSystem.h>
+#include <behaviour/BehaviourAccess.h>
+#include <behaviour/BehaviourCommands.h>
+#include <render/scene/Scene.h>
+#include <render/scene/SignificanceManager.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <memory>
+
+namespace bench {
+
+namespace {
+
+constexpr std::size_t g_NumBehaviours = 50000;
+constexpr double g_Delta = 1.0 / 60.0;
+
+// Turns its own node, the typical behaviour that only touches itself
+class SpinBehaviour : public behaviour::IBehaviour
+{
+public:
+  void start() override {}
+
+  void update(double delta) override
+  {
+    auto& transform = _scene->registry().getEnttRegistry().get<component::Transform>(_entity);
+    transform._localTransform = glm::rotate(transform._localTransform, (float)delta, glm::vec3(0.0f, 1.0f, 0.0f));
+    _commands->patch<component::Transform>(_me);
+  }
+
+  bool declareAccess(behaviour::BehaviourAccess& access) const override
+  {
+    access.write<component::Transform>();
+    return true;
+  }
+};
+
+// The system goes after the scene, so that it is destroyed first
+struct BehaviourState
+{
+  std::unique_ptr<render::scene::Scene> _scene;
+  std::unique_ptr<render::scene::SignificanceManager> _significance;
+  std::unique_ptr<behaviour::BehaviourSystem> _system;
+};
+
+// Looking down the grid from its corner
+const glm::vec3 g_ViewPos = glm::vec3(-10.0f, 10.0f, -10.0f);
+
+glm::mat4 viewProj()
+{
+  auto proj = glm::perspective(glm::radians(55.0f), 16.0f / 9.0f, 0.1f, 1000.0f);
+  return proj * glm::lookAt(g_ViewPos, glm::vec3(256.0f, 0.0f, 256.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+}
+
+void buildScene(BehaviourState& state)
+{
+  state._system.reset();
+  state._scene = std::make_unique<render::scene::Scene>();
+
+  auto& scene = *state._scene;
+  for (std::size_t i = 0; i < g_NumBehaviours; ++i) {
+    auto transform = glm::translate(glm::mat4(1.0f), glm::vec3(2.0f * (i % 256), 0.0f, 2.0f * (i / 256)));
+    auto id = scene.addNode(render::scene::Node{});
+    scene.registry().addComponent<component::Transform>(id, transform, transform);
+
+    component::Behaviour beh{};
+    beh._name = "Spin";
+    scene.registry().addComponent<component::Behaviour>(id, std::move(beh));
+  }
+}
+
+// Picks up all behaviour components of the scene on the first update
+void createSystem(BehaviourState& state)
+{
+  state._system = std::make_unique<behaviour::BehaviourSystem>();
+  state._system->registerBehaviour("Spin", []() { return new SpinBehaviour(); });
+  state._system->setScene(state._scene.get());
+  state._system->setRegistry(&state._scene->registry());
+}
+
+}
+
+void registerBehaviourBenchmarks(Runner& runner)
+{
+  {
+    // Loading a scene full of behaviours
+    auto state = std::make_shared<BehaviourState>();
+
+    Benchmark b{};
+    b._group = "behaviour";
+    b._name = "create_50000";
+    b._items = g_NumBehaviours;
+    b._samples = 5;
+    b._setup = [state]() {
+      buildScene(*state);
+      createSystem(*state);
+    };
+    b._run = [state]() {
+      state->_system->update(g_Delta);
+    };
+    runner.add(std::move(b));
+  }
+
+  {
+    auto state = std::make_shared<BehaviourState>();
+
+    Benchmark b{};
+    b._group = "behaviour";
+    b._name = "update_50000";
+    b._items = g_NumBehaviours;
+    b._setup = [state]() {
+      if (!state->_system) {
+        buildScene(*state);
+        createSystem(*state);
+        state->_system->update(g_Delta);
+      }
+      // Clears the patches of the last sample
+      state->_scene->update();
+    };
+    b._run = [state]() {
+      state->_system->update(g_Delta);
+    };
+    runner.add(std::move(b));
+  }
+
+  {
+    // Same grid, 512 x 400 m, seen from a corner so that most of it is far away or outside the frustum
+    auto state = std::make_shared<BehaviourState>();
+
+    Benchmark b{};
+    b._group = "behaviour";
+    b._name = "update_50000_throttled";
+    b._items = g_NumBehaviours;
+    b._setup = [state]() {
+      if (!state->_system) {
+        buildScene(*state);
+        state->_significance = std::make_unique<render::scene::SignificanceManager>();
+        state->_significance->setScene(state->_scene.get());
+        createSystem(*state);
+        state->_system->setSignificanceManager(state->_significance.get());
+        state->_significance->update(g_ViewPos, viewProj(), g_Delta);
+        state->_system->update(g_Delta);
+      }
+      state->_scene->update();
+    };
+    b._run = [state]() {
+      state->_significance->update(g_ViewPos, viewProj(), g_Delta);
+      state->_system->update(g_Delta);
+    };
+    runner.add(std::move(b));
+  }
+}
+
+}
@@ -0,0 +1,254 @@
+#include "Bench.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+
+namespace bench {
+
+namespace {
+
+volatile const void* g_Sink = nullptr;
+
+std::string escape(const std::string& s)
+{
+  std::string out;
+  for (char c : s) {
+    if (c == '"' || c == '\\') out += '\\';
+    out += c;
+  }
+  return out;
+}
+
+std::string formatNs(double ns)
+{
+  char buf[64];
+  if (ns >= 1e9) snprintf(buf, sizeof(buf), "%.3f s", ns / 1e9);
+  else if (ns >= 1e6) snprintf(buf, sizeof(buf), "%.3f ms", ns / 1e6);
+  else if (ns >= 1e3) snprintf(buf, sizeof(buf), "%.3f us", ns / 1e3);
+  else snprintf(buf, sizeof(buf), "%.0f ns", ns);
+  return buf;
+}
+
+// Reads the "name" and "median_ns" pairs of a file written by Runner::writeJson.
+std::unordered_map<std::string, double> readMedians(const std::string& path)
+{
+  std::unordered_map<std::string, double> out;
+
+  std::ifstream ifs(path);
+  if (!ifs.is_open()) {
+    return out;
+  }
+
+  std::stringstream ss;
+  ss << ifs.rdbuf();
+  std::string text = ss.str();
+
+  const std::string nameKey = "\"name\": \"";
+  const std::string medianKey = "\"median_ns\": ";
+
+  std::size_t pos = 0;
+  while ((pos = text.find(nameKey, pos)) != std::string::npos) {
+    pos += nameKey.size();
+    std::size_t end = text.find('"', pos);
+    if (end == std::string::npos) break;
+
+    std::string name = text.substr(pos, end - pos);
+
+    std::size_t medianPos = text.find(medianKey, end);
+    if (medianPos == std::string::npos) break;
+
+    out[name] = std::strtod(text.c_str() + medianPos + medianKey.size(), nullptr);
+    pos = medianPos;
+  }
+
+  return out;
+}
+
+}
+
+void doNotOptimize(const void* p)
+{
+  g_Sink = p;
+}
+
+void Runner::add(Benchmark benchmark)
+{
+  _benchmarks.emplace_back(std::move(benchmark));
+}
+
+void Runner::list() const
+{
+  for (auto& b : _benchmarks) {
+    printf("%s/%s\n", b._group.c_str(), b._name.c_str());
+  }
+}
+
+std::vector<Result> Runner::run(const RunOptions& options)
+{
+  std::vector<Result> results;
+  _failedChecks.clear();
+
+  for (auto& b : _benchmarks) {
+    std::string fullName = b._group + "/" + b._name;
+    if (!options._filter.empty() && fullName.find(options._filter) == std::string::npos) {
+      continue;
+    }
+
+    std::size_t samples = options._samples > 0 ? options._samples : b._samples;
+    std::size_t warmup = b._warmup;
+    if (options._quick) {
+      samples = 1;
+      warmup = 0;
+    }
+
+    if (b._check) {
+      if (b._setup) {
+        b._setup();
+      }
+
+      if (!b._check()) {
+        printf("%-48s CHECK FAILED\n", fullName.c_str());
+        fflush(stdout);
+        _failedChecks.emplace_back(std::move(fullName));
+        continue;
+      }
+    }
+
+    std::vector<double> times;
+    times.reserve(samples);
+
+    for (std::size_t i = 0; i < warmup + samples; ++i) {
+      if (b._setup) {
+        b._setup();
+      }
+
+      auto start = std::chrono::steady_clock::now();
+      b._run();
+      auto stop = std::chrono::steady_clock::now();
+
+      if (i >= warmup) {
+        times.emplace_back((double)std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count());
+      }
+    }
+
+    std::sort(times.begin(), times.end());
+
+    Result r{};
+    r._name = fullName;
+    r._samples = samples;
+    r._items = b._items;
+    r._minNs = times.front();
+    r._maxNs = times.back();
+    r._medianNs = times.size() % 2 ? times[times.size() / 2] : 0.5 * (times[times.size() / 2 - 1] + times[times.size() / 2]);
+
+    double sum = 0.0;
+    for (double t : times) sum += t;
+    r._meanNs = sum / times.size();
+
+    double var = 0.0;
+    for (double t : times) var += (t - r._meanNs) * (t - r._meanNs);
+    r._stdDevNs = std::sqrt(var / times.size());
+
+    printf("%-48s median %12s  min %12s  stddev %5.1f%%  %14.0f items/s\n",
+      fullName.c_str(),
+      formatNs(r._medianNs).c_str(),
+      formatNs(r._minNs).c_str(),
+      r._meanNs > 0.0 ? 100.0 * r._stdDevNs / r._meanNs : 0.0,
+      r.itemsPerSecond());
+    fflush(stdout);
+
+    results.emplace_back(std::move(r));
+  }
+
+  return results;
+}
+
+bool Runner::writeJson(const std::string& path, const std::vector<Result>& results)
+{
+  std::ofstream ofs(path);
+  if (!ofs.is_open()) {
+    printf("Could not open %s for writing!\n", path.c_str());
+    return false;
+  }
+
+  char timeBuf[64];
+  std::time_t now = std::time(nullptr);
+  std::strftime(timeBuf, sizeof(timeBuf), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+#ifdef NDEBUG
+  const char* buildType = "release";
+#else
+  const char* buildType = "debug";
+#endif
+
+  ofs << "{\n";
+  ofs << "  \"version\": 1,\n";
+  ofs << "  \"timestamp\": \"" << timeBuf << "\",\n";
+  ofs << "  \"build\": \"" << buildType << "\",\n";
+  ofs << "  \"hardware_threads\": " << std::thread::hardware_concurrency() << ",\n";
+  ofs << "  \"benchmarks\": [\n";
+
+  char numBuf[64];
+  auto num = [&numBuf](double v) {
+    snprintf(numBuf, sizeof(numBuf), "%.1f", v);
+    return std::string(numBuf);
+  };
+
+  for (std::size_t i = 0; i < results.size(); ++i) {
+    auto& r = results[i];
+    ofs << "    {\n";
+    ofs << "      \"name\": \"" << escape(r._name) << "\",\n";
+    ofs << "      \"samples\": " << r._samples << ",\n";
+    ofs << "      \"items\": " << r._items << ",\n";
+    ofs << "      \"min_ns\": " << num(r._minNs) << ",\n";
+    ofs << "      \"median_ns\": " << num(r._medianNs) << ",\n";
+    ofs << "      \"mean_ns\": " << num(r._meanNs) << ",\n";
+    ofs << "      \"max_ns\": " << num(r._maxNs) << ",\n";
+    ofs << "      \"stddev_ns\": " << num(r._stdDevNs) << ",\n";
+    ofs << "      \"items_per_second\": " << num(r.itemsPerSecond()) << "\n";
+    ofs << "    }" << (i + 1 < results.size() ? "," : "") << "\n";
+  }
+
+  ofs << "  ]\n";
+  ofs << "}\n";
+
+  printf("Wrote %zu results to %s\n", results.size(), path.c_str());
+  return true;
+}
+
+bool Runner::compare(const std::string& baselinePath, const std::vector<Result>& results, double thresholdPercent)
+{
+  auto baseline = readMedians(baselinePath);
+  if (baseline.empty()) {
+    printf("Could not read any results from baseline %s!\n", baselinePath.c_str());
+    return false;
+  }
+
+  bool ok = true;
+  printf("\nCompared to %s:\n", baselinePath.c_str());
+
+  for (auto& r : results) {
+    auto it = baseline.find(r._name);
+    if (it == baseline.end() || it->second <= 0.0) {
+      printf("%-48s (new)\n", r._name.c_str());
+      continue;
+    }
+
+    double change = 100.0 * (r._medianNs - it->second) / it->second;
+    bool regressed = change > thresholdPercent;
+    ok = ok && !regressed;
+
+    printf("%-48s %+7.1f%%%s\n", r._name.c_str(), change, regressed ? "  REGRESSION" : "");
+  }
+
+  return ok;
+}
+
+}
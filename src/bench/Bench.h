@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+/*
+* A single benchmark. _setup runs before every sample and is not timed, _run is timed.
+* State shared between the two is typically captured via a shared_ptr.
+* _items is the number of work items one _run processes, used for throughput (e.g. nodes, texels, bytes).
+* _check, if set, runs once after a _setup before any sample. If it returns false the benchmark is reported as failed and not timed.
+*/
+struct Benchmark
+{
+  std::string _group;
+  std::string _name;
+  std::size_t _items = 1;
+  std::size_t _samples = 10;
+  std::size_t _warmup = 1;
+
+  std::function<void()> _setup = nullptr;
+  std::function<void()> _run = nullptr;
+  std::function<bool()> _check = nullptr;
+};
+
+struct Result
+{
+  std::string _name; // group/name
+  std::size_t _samples = 0;
+  std::size_t _items = 0;
+
+  double _minNs = 0.0;
+  double _medianNs = 0.0;
+  double _meanNs = 0.0;
+  double _maxNs = 0.0;
+  double _stdDevNs = 0.0;
+
+  double itemsPerSecond() const { return _medianNs > 0.0 ? (double)_items * 1e9 / _medianNs : 0.0; }
+};
+
+struct RunOptions
+{
+  std::string _filter; // Substring of group/name, empty runs everything
+  std::size_t _samples = 0; // Overrides each benchmark's sample count if non-zero
+  bool _quick = false; // One sample, no warmup. For smoke testing the suite.
+};
+
+class Runner
+{
+public:
+  void add(Benchmark benchmark);
+
+  void list() const;
+  std::vector<Result> run(const RunOptions& options);
+
+  // False if any benchmark failed its _check in the last run()
+  bool checksPassed() const { return _failedChecks.empty(); }
+
+  static bool writeJson(const std::string& path, const std::vector<Result>& results);
+
+  // Prints the change in median against a json file written by writeJson.
+  // Returns false if any benchmark got slower than thresholdPercent.
+  static bool compare(const std::string& baselinePath, const std::vector<Result>& results, double thresholdPercent);
+
+private:
+  std::vector<Benchmark> _benchmarks;
+  std::vector<std::string> _failedChecks;
+};
+
+// Keeps the optimizer from removing a computation whose result is otherwise unused.
+void doNotOptimize(const void* p);
+
+template <typename T>
+void doNotOptimize(const T& value)
+{
+  doNotOptimize((const void*)&value);
+}
+
+}
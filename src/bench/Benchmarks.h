@@ -0,0 +1,21 @@
+#pragma once
+
+namespace bench {
+
+class Runner;
+
+// Each engine area registers its benchmarks here, see the respective .cpp.
+void registerSceneBenchmarks(Runner& runner);
+void registerAssetBenchmarks(Runner& runner);
+void registerTextureBenchmarks(Runner& runner);
+void registerAnimationBenchmarks(Runner& runner);
+void registerFrameGraphBenchmarks(Runner& runner);
+void registerPhysicsBenchmarks(Runner& runner);
+void registerRendererBenchmarks(Runner& runner);
+void registerCullingBenchmarks(Runner& runner);
+void registerProfilerBenchmarks(Runner& runner);
+void registerBehaviourBenchmarks(Runner& runner);
+void registerParticleBenchmarks(Runner& runner);
+void registerUploadBenchmarks(Runner& runner);
+
+}
@@ -0,0 +1,100 @@
+#include "Benchmarks.h"
+#include "Bench.h"
+
+#include <render/FrustumCulling.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+namespace {
+
+constexpr std::size_t g_NumObjects = 100000;
+
+struct CullingState
+{
+  render::FrustumPlanes _planes;
+  render::SphereBatch _spheres;
+  render::AabbBatch _boxes;
+  std::vector<std::uint32_t> _masks;
+};
+
+// A main camera, 4 shadow cascades and one point light's 6 faces, with objects scattered around them.
+void ensureState(CullingState& state)
+{
+  if (!state._masks.empty()) {
+    return;
+  }
+
+  glm::vec3 eye(0.0f, 2.0f, 0.0f);
+  glm::mat4 view = glm::lookAt(eye, glm::vec3(10.0f, 0.0f, -10.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+  state._planes.addView(glm::perspective(glm::radians(55.0f), 16.0f / 9.0f, 0.1f, 200.0f) * view);
+
+  for (int i = 0; i < 4; ++i) {
+    float extent = 20.0f * float(1 << i);
+    glm::mat4 lightView = glm::lookAt(eye + glm::vec3(50.0f, 100.0f, 50.0f), eye, glm::vec3(0.0f, 1.0f, 0.0f));
+    state._planes.addView(glm::ortho(-extent, extent, -extent, extent, 0.1f, 300.0f) * lightView);
+  }
+
+  std::vector<glm::mat4> faces;
+  glm::vec3 lightPos(5.0f, 3.0f, -5.0f);
+  for (auto dir : { glm::vec3(1, 0, 0), glm::vec3(-1, 0, 0), glm::vec3(0, 1, 0), glm::vec3(0, -1, 0), glm::vec3(0, 0, 1), glm::vec3(0, 0, -1) }) {
+    glm::vec3 up = dir.y != 0.0f ? glm::vec3(0, 0, 1) : glm::vec3(0, 1, 0);
+    faces.emplace_back(glm::lookAt(lightPos, lightPos + dir, up));
+  }
+  state._planes.addViews(glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 15.0f), faces);
+
+  std::mt19937 rng(7);
+  std::uniform_real_distribution<float> pos(-250.0f, 250.0f);
+  std::uniform_real_distribution<float> size(0.1f, 4.0f);
+
+  state._spheres.reserve(g_NumObjects);
+  state._boxes.reserve(g_NumObjects);
+  for (std::size_t i = 0; i < g_NumObjects; ++i) {
+    glm::vec3 center(pos(rng), pos(rng) * 0.1f, pos(rng));
+    glm::vec3 extent(size(rng), size(rng), size(rng));
+    state._spheres.add(center, glm::length(extent));
+    state._boxes.add(center - extent, center + extent);
+  }
+
+  state._masks.resize(g_NumObjects);
+}
+
+void registerCull(Runner& runner, std::shared_ptr<CullingState> state, bool boxes, render::CullPath path)
+{
+  Benchmark b{};
+  b._group = "culling";
+  b._name = std::string(boxes ? "aabbs" : "spheres") + "_100k_11_views_" + render::FrustumCulling::pathName(path);
+  b._items = g_NumObjects;
+  b._setup = [state]() { ensureState(*state); };
+  b._run = [state, boxes, path]() {
+    if (boxes) {
+      render::FrustumCulling::cullAabbs(state->_planes, state->_boxes, state->_masks.data(), path);
+    }
+    else {
+      render::FrustumCulling::cullSpheres(state->_planes, state->_spheres, state->_masks.data(), path);
+    }
+    doNotOptimize(state->_masks.data());
+  };
+  runner.add(std::move(b));
+}
+
+}
+
+void registerCullingBenchmarks(Runner& runner)
+{
+  auto state = std::make_shared<CullingState>();
+
+  for (bool boxes : { false, true }) {
+    registerCull(runner, state, boxes, render::CullPath::Scalar);
+    registerCull(runner, state, boxes, render::CullPath::SSE2);
+    registerCull(runner, state, boxes, render::CullPath::AVX);
+  }
+}
+
+}
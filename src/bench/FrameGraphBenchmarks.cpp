@@ -0,0 +1,91 @@
+#include "Benchmarks.h"
+#include "Bench.h"
+
+#include <render/FrameGraphBuilder.h>
+
+#include <memory>
+#include <string>
+
+namespace bench {
+
+namespace {
+
+render::ResourceUsage makeUsage(const std::string& name, render::Access access, render::Stage stage, render::Type type)
+{
+  render::ResourceUsage usage{};
+  usage._resourceName = name;
+  usage._access.set((std::size_t)access);
+  usage._stage.set((std::size_t)stage);
+  usage._type = type;
+  usage._imageBaseLayer = 0;
+  usage._ownedByEngine = true;
+  return usage;
+}
+
+// A chain of passes that each render a target, sample the two previous targets and read/write one of a few shared buffers.
+// Every 8th pass is a compute pass writing storage images, and the last pass presents. Roughly the shape of the real graph.
+std::unique_ptr<render::FrameGraphBuilder> buildSyntheticGraph(unsigned numPasses)
+{
+  using namespace render;
+
+  auto fgb = std::make_unique<FrameGraphBuilder>();
+
+  for (unsigned i = 0; i < numPasses; ++i) {
+    RenderPassRegisterInfo info{};
+    info._name = "Pass" + std::to_string(i);
+    info._group = "Group" + std::to_string(i / 8);
+
+    bool compute = i % 8 == 7;
+    auto stage = compute ? Stage::Compute : Stage::Fragment;
+    auto outType = compute ? Type::ImageStorage : Type::ColorAttachment;
+
+    info._resourceUsages.emplace_back(makeUsage("Target" + std::to_string(i), Access::Write, stage, outType));
+
+    if (i > 0) {
+      info._resourceUsages.emplace_back(makeUsage("Target" + std::to_string(i - 1), Access::Read, stage, Type::SampledTexture));
+    }
+    if (i > 1) {
+      info._resourceUsages.emplace_back(makeUsage("Target" + std::to_string(i - 2), Access::Read, stage, Type::SampledTexture));
+    }
+
+    auto buf = "Buffer" + std::to_string(i % 4);
+    info._resourceUsages.emplace_back(makeUsage(buf, i % 2 ? Access::Write : Access::Read, stage, Type::SSBO));
+
+    if (i + 1 == numPasses) {
+      info._present = true;
+      info._resourceUsages.emplace_back(makeUsage("Present", Access::Write, Stage::Transfer, Type::Present));
+    }
+
+    fgb->registerRenderPass(std::move(info));
+  }
+
+  return fgb;
+}
+
+void registerBuild(Runner& runner, unsigned numPasses)
+{
+  auto fgb = std::make_shared<std::unique_ptr<render::FrameGraphBuilder>>();
+
+  Benchmark b{};
+  b._group = "framegraph";
+  b._name = "build_" + std::to_string(numPasses) + "_passes";
+  b._items = numPasses;
+  b._setup = [fgb, numPasses]() {
+    *fgb = buildSyntheticGraph(numPasses);
+  };
+  b._run = [fgb]() {
+    (*fgb)->buildGraphOnly();
+    doNotOptimize((*fgb)->builtGraphSize());
+  };
+  runner.add(std::move(b));
+}
+
+}
+
+void registerFrameGraphBenchmarks(Runner& runner)
+{
+  registerBuild(runner, 64);
+  registerBuild(runner, 256);
+}
+
+}
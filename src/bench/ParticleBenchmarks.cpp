@@ -0,0 +1,157 @@
+#include "Benchmarks.h"
+#include "Bench.h"
+
+#include <render/ParticleEmitterPool.h>
+#include <render/ParticleSimulation.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+namespace bench {
+
+namespace {
+
+// 64 emitters spawning 1600 a second that live a second, about 100k alive
+constexpr std::size_t g_NumEmitters = 64;
+constexpr std::size_t g_NumAlive = 102400;
+constexpr double g_Delta = 1.0 / 60.0;
+
+struct ParticleState
+{
+  render::ParticleEmitterPool _pool;
+  std::unique_ptr<render::ParticleSimulation> _sim;
+  std::vector<util::Uuid> _nodes;
+  component::ParticleEmitter _emitter;
+};
+
+void frame(ParticleState& state)
+{
+  for (std::size_t i = 0; i < state._nodes.size(); ++i) {
+    auto transform = glm::translate(glm::mat4(1.0f), glm::vec3(4.0f * (i % 8), 2.0f, 4.0f * (i / 8)));
+    state._pool.set(state._nodes[i], state._emitter, transform);
+  }
+
+  state._pool.update(g_Delta);
+  state._sim->step(state._pool.gpuEmitters(), (float)g_Delta);
+  state._pool.uploaded();
+}
+
+// Runs until the alive count has settled
+void ensureState(ParticleState& state)
+{
+  if (state._sim) {
+    return;
+  }
+
+  state._sim = std::make_unique<render::ParticleSimulation>();
+  state._emitter._maxParticles = 2048;
+  state._emitter._spawnRate = 1600.0f;
+  state._emitter._lifetime = 1.0f;
+  state._emitter._spawnRadius = 0.5f;
+
+  for (std::size_t i = 0; i < g_NumEmitters; ++i) {
+    state._nodes.emplace_back(util::Uuid::generate());
+  }
+
+  for (int i = 0; i < 90; ++i) {
+    frame(state);
+  }
+}
+
+render::gpu::GPUParticleEmitter makeGpuEmitter(std::uint32_t rangeStart, std::uint32_t rangeSize, std::uint32_t spawnCount)
+{
+  render::gpu::GPUParticleEmitter e{};
+  e.minVelocity = glm::vec4(-1.0f, 1.0f, -1.0f, 1.0f);
+  e.maxVelocity = glm::vec4(1.0f, 2.0f, 1.0f, -1.0f);
+  e.scale = glm::vec4(0.1f, 0.2f, 0.0f, 0.0f);
+  e.rangeStart = rangeStart;
+  e.rangeSize = rangeSize;
+  e.spawnCount = spawnCount;
+  e.seed = rangeStart + 1;
+  e.flags = render::gpu::PARTICLE_EMITTER_RESET_FLAG;
+  return e;
+}
+
+// Counts of a hand-made emitter table. With a lifetime of 1 and steps of 0.25 the ages are exact,
+// so particles live for 3 steps and die in the 4th.
+bool checkKnownEmitters()
+{
+  std::vector<render::gpu::GPUParticleEmitter> emitters;
+  emitters.emplace_back(makeGpuEmitter(0, 64, 8)); // Steady at 3 batches of 8 alive
+  emitters.emplace_back(makeGpuEmitter(64, 32, 16)); // Runs out of dead particles every other batch
+  emitters.emplace_back(makeGpuEmitter(96, 0, 16)); // Unused slot, never spawns
+
+  render::ParticleSimulation sim(128, 3);
+  for (int i = 0; i < 8; ++i) {
+    sim.step(emitters, 0.25f);
+    for (auto& e : emitters) {
+      e.flags = 0;
+    }
+  }
+
+  const std::uint32_t expectedAlive = 24 + 16;
+  const std::uint32_t expectedDead[] = { 40, 16, 0 };
+
+  if (sim.numAlive() != expectedAlive) {
+    printf("Particle simulation has %u alive, expected %u!\n", sim.numAlive(), expectedAlive);
+    return false;
+  }
+
+  for (std::uint32_t e = 0; e < 3; ++e) {
+    if (sim.numDead(e) != expectedDead[e]) {
+      printf("Particle emitter %u has %u dead, expected %u!\n", e, sim.numDead(e), expectedDead[e]);
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// Every particle of an emitter's range is either alive or on its dead list
+bool checkCounts(const ParticleState& state)
+{
+  auto& emitters = state._pool.gpuEmitters();
+  std::vector<std::uint32_t> alive(emitters.size(), 0);
+  for (std::uint32_t i = 0; i < state._sim->numAlive(); ++i) {
+    alive[state._sim->particles()[state._sim->aliveList()[i]].emitter]++;
+  }
+
+  for (std::uint32_t e = 0; e < (std::uint32_t)emitters.size(); ++e) {
+    if (emitters[e].rangeSize > 0 && alive[e] + state._sim->numDead(e) != emitters[e].rangeSize) {
+      printf("Particle emitter %u has %u alive and %u dead, its range is %u!\n", e, alive[e], state._sim->numDead(e), emitters[e].rangeSize);
+      return false;
+    }
+  }
+
+  return true;
+}
+
+}
+
+void registerParticleBenchmarks(Runner& runner)
+{
+  {
+    // The CPU reference of the GPU update, emitting and simulating one frame
+    auto state = std::make_shared<ParticleState>();
+
+    Benchmark b{};
+    b._group = "particles";
+    b._name = "simulate_cpu_100000";
+    b._items = g_NumAlive;
+    b._setup = [state]() {
+      ensureState(*state);
+    };
+    b._check = [state]() {
+      return checkKnownEmitters() && checkCounts(*state);
+    };
+    b._run = [state]() {
+      frame(*state);
+    };
+    runner.add(std::move(b));
+  }
+}
+
+}
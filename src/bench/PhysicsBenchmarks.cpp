@@ -0,0 +1,419 @@
+#include "Benchmarks.h"
+#include "Bench.h"
+
+#include <physics/PhysicsSystem.h>
+#include <render/scene/Scene.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <unordered_set>
+#include <vector>
+
+namespace bench {
+
+namespace {
+
+constexpr std::size_t g_NumBodies = 10000;
+constexpr double g_Delta = 1.0 / 60.0;
+constexpr std::size_t g_NumPaged = 2000; // Roughly a tile
+constexpr std::size_t g_NumQueries = 10000;
+constexpr std::size_t g_NumCharacters = 1000;
+
+/*
+* One world shared by all physics benchmarks, since Jolt's statics can only be set up once per process.
+* Runs without a RenderContext or AssetCollection, so only primitive colliders and no debug drawing.
+*/
+struct PhysicsWorld
+{
+  render::scene::Scene _scene;
+  std::unique_ptr<physics::PhysicsSystem> _physics;
+  util::Uuid _ground; // Static box with its top at y 0, covering everything
+  std::vector<util::Uuid> _bodies;
+  std::vector<util::Uuid> _characters; // Created by the first character benchmark
+};
+
+util::Uuid addBody(render::scene::Scene& scene, const glm::mat4& transform, component::RigidBody::MotionType motionType, bool sphere)
+{
+  auto id = scene.addNode(render::scene::Node{});
+  scene.registry().addComponent<component::Transform>(id, transform, transform);
+
+  if (sphere) {
+    scene.registry().addComponent<component::SphereCollider>(id);
+  }
+  else {
+    component::BoxCollider box{};
+    box._halfExtent = glm::vec3(200.0f, 0.5f, 200.0f);
+    scene.registry().addComponent<component::BoxCollider>(id, std::move(box));
+  }
+
+  component::RigidBody rigid{};
+  rigid._motionType = motionType;
+  scene.registry().addComponent<component::RigidBody>(id, std::move(rigid));
+  scene.registry().addComponent<component::PageStatus>(id);
+
+  return id;
+}
+
+// Spheres in a loose grid above a static ground box, so that the first hundreds of steps are falling and colliding.
+PhysicsWorld& world()
+{
+  static std::unique_ptr<PhysicsWorld> w;
+  if (w) {
+    return *w;
+  }
+
+  w = std::make_unique<PhysicsWorld>();
+  auto& scene = w->_scene;
+
+  w->_ground = addBody(scene, glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -0.5f, 0.0f)), component::RigidBody::Static, false);
+
+  for (std::size_t i = 0; i < g_NumBodies; ++i) {
+    glm::vec3 pos(1.5f * (i % 20) - 15.0f, 2.0f + 1.5f * (i / 400), 1.5f * ((i / 20) % 20) - 15.0f);
+    w->_bodies.emplace_back(addBody(scene, glm::translate(glm::mat4(1.0f), pos), component::RigidBody::Dynamic, true));
+  }
+
+  w->_physics = std::make_unique<physics::PhysicsSystem>(&scene.registry(), &scene, nullptr, nullptr);
+  w->_physics->init();
+  w->_physics->setRegistry(&scene.registry());
+
+  // Creates all bodies
+  w->_physics->update(g_Delta, false);
+  scene.update();
+
+  return *w;
+}
+
+void setPaged(PhysicsWorld& w, bool paged)
+{
+  for (std::size_t i = 0; i < g_NumPaged; ++i) {
+    w._scene.registry().getComponent<component::PageStatus>(w._bodies[i])._paged = paged;
+    w._scene.registry().patchComponent<component::PageStatus>(w._bodies[i]);
+  }
+}
+
+// A crowd in a 40x25 grid next to the spheres, 1 m apart
+void addCharacters(PhysicsWorld& w)
+{
+  if (!w._characters.empty()) {
+    return;
+  }
+
+  auto& scene = w._scene;
+  for (std::size_t i = 0; i < g_NumCharacters; ++i) {
+    glm::vec3 pos(20.0f + (float)(i % 40), 1.4f, (float)(i / 40) - 12.0f);
+    auto transform = glm::translate(glm::mat4(1.0f), pos);
+
+    auto id = scene.addNode(render::scene::Node{});
+    scene.registry().addComponent<component::Transform>(id, transform, transform);
+    scene.registry().addComponent<component::CapsuleCollider>(id);
+    scene.registry().addComponent<component::CharacterController>(id);
+    scene.registry().addComponent<component::PageStatus>(id);
+    w._characters.emplace_back(id);
+  }
+
+  // Creates the characters
+  w._physics->simulationRunning() = false;
+  w._physics->update(g_Delta, false);
+  scene.update();
+}
+
+// Grid of points covering the spheres and some ground around them, at the given height
+glm::vec3 queryPoint(std::size_t i, float height)
+{
+  return glm::vec3(0.4f * (i % 100) - 20.0f, height, 0.4f * (i / 100) - 20.0f);
+}
+
+// The spheres move around, but the ground doesn't. Rays that only see static bodies all hit its top,
+// and moving bodies can only be hit before it.
+bool checkRays(PhysicsWorld& w, const std::vector<physics::RayQuery>& queries)
+{
+  std::vector<physics::RayQuery> staticQueries = queries;
+  for (auto& q : staticQueries) {
+    q._layerMask = physics::QueryLayerStatic;
+  }
+
+  std::vector<physics::QueryHit> staticResults;
+  std::vector<physics::QueryHit> results;
+  w._physics->castRays(staticQueries, staticResults);
+  w._physics->castRays(queries, results);
+
+  std::unordered_set<util::Uuid> bodies(w._bodies.begin(), w._bodies.end());
+
+  for (std::size_t i = 0; i < queries.size(); ++i) {
+    auto& q = queries[i];
+    auto& hit = staticResults[i];
+    float expectedFraction = q._origin.y / -q._direction.y;
+
+    if (!hit._hit || hit._node != w._ground) {
+      printf("Ray %zu doesn't hit the ground!\n", i);
+      return false;
+    }
+    if (std::abs(hit._fraction - expectedFraction) > 1e-4f || hit._normal.y < 0.999f) {
+      printf("Ray %zu hits the ground at fraction %f with normal y %f, expected %f and 1!\n", i, hit._fraction, hit._normal.y, expectedFraction);
+      return false;
+    }
+
+    auto& anyHit = results[i];
+    bool sphere = bodies.contains(anyHit._node);
+    if (!anyHit._hit || (anyHit._node != w._ground && !sphere) || (sphere && anyHit._fraction > expectedFraction + 1e-4f)) {
+      printf("Ray %zu hits an unexpected body, or a sphere below the ground!\n", i);
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// Only the ground is static. A query sunk halfway into it reports it once, one lifted off it reports nothing static.
+bool checkOverlaps(PhysicsWorld& w, const std::vector<physics::OverlapQuery>& queries)
+{
+  std::vector<physics::OverlapQuery> staticQueries;
+  for (auto& q : queries) {
+    auto sunk = q;
+    sunk._layerMask = physics::QueryLayerStatic;
+    sunk._position.y = 0.5f * q._shape._radius;
+    staticQueries.emplace_back(sunk);
+
+    auto above = sunk;
+    above._position.y = 2.0f * q._shape._radius;
+    staticQueries.emplace_back(above);
+  }
+
+  std::vector<physics::OverlapResult> results;
+  std::vector<physics::QueryHit> hits;
+  w._physics->overlap(staticQueries, results, hits);
+
+  for (std::size_t i = 0; i < staticQueries.size(); ++i) {
+    std::uint32_t expected = i % 2 == 0 ? 1 : 0;
+    if (results[i]._numHits != expected || (expected == 1 && hits[results[i]._firstHit]._node != w._ground)) {
+      printf("Static overlap %zu has %u hits, expected %u on the ground!\n", i, results[i]._numHits, expected);
+      return false;
+    }
+  }
+
+  // Every body at most once per query
+  w._physics->overlap(queries, results, hits);
+  for (std::size_t i = 0; i < queries.size(); ++i) {
+    std::unordered_set<util::Uuid> seen;
+    for (std::uint32_t h = 0; h < results[i]._numHits; ++h) {
+      if (!seen.insert(hits[results[i]._firstHit + h]._node).second) {
+        printf("Overlap %zu reports a body twice!\n", i);
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+}
+
+void registerPhysicsBenchmarks(Runner& runner)
+{
+  {
+    // Every body moved by the hierarchy while the simulation is paused, as when editing
+    Benchmark b{};
+    b._group = "physics";
+    b._name = "downstream_sync_10000";
+    b._items = g_NumBodies;
+    b._setup = []() {
+      auto& w = world();
+      w._physics->simulationRunning() = false;
+      for (auto& id : w._bodies) {
+        w._scene.registry().patchComponent<component::Transform>(id);
+      }
+    };
+    b._run = []() {
+      world()._physics->downstreamTransformSync();
+    };
+    runner.add(std::move(b));
+  }
+
+  {
+    Benchmark b{};
+    b._group = "physics";
+    b._name = "step_10000";
+    b._items = g_NumBodies;
+    b._setup = []() {
+      world()._physics->simulationRunning() = true;
+    };
+    b._run = []() {
+      world()._physics->update(g_Delta, false);
+    };
+    runner.add(std::move(b));
+  }
+
+  {
+    Benchmark b{};
+    b._group = "physics";
+    b._name = "upstream_sync_10000";
+    b._items = g_NumBodies;
+    b._setup = []() {
+      auto& w = world();
+      w._physics->simulationRunning() = true;
+      w._physics->update(g_Delta, false);
+    };
+    b._run = []() {
+      world()._physics->upstreamTransformSync();
+    };
+    runner.add(std::move(b));
+  }
+
+  {
+    // A whole frame as the application runs it, including the scene propagating the new transforms
+    Benchmark b{};
+    b._group = "physics";
+    b._name = "frame_10000";
+    b._items = g_NumBodies;
+    b._setup = []() {
+      world()._physics->simulationRunning() = true;
+    };
+    b._run = []() {
+      auto& w = world();
+      w._physics->downstreamTransformSync();
+      w._physics->update(g_Delta, false);
+      w._physics->upstreamTransformSync();
+      w._scene.update();
+    };
+    runner.add(std::move(b));
+  }
+
+  {
+    // A tile worth of bodies streaming in, with the simulation paused so that only creation is measured
+    Benchmark b{};
+    b._group = "physics";
+    b._name = "page_in_2000";
+    b._items = g_NumPaged;
+    b._setup = []() {
+      auto& w = world();
+      w._physics->simulationRunning() = false;
+      setPaged(w, false);
+      w._physics->update(g_Delta, false);
+      setPaged(w, true);
+    };
+    b._run = []() {
+      world()._physics->update(g_Delta, false);
+    };
+    runner.add(std::move(b));
+  }
+
+  {
+    Benchmark b{};
+    b._group = "physics";
+    b._name = "page_out_2000";
+    b._items = g_NumPaged;
+    b._setup = []() {
+      auto& w = world();
+      w._physics->simulationRunning() = false;
+      setPaged(w, true);
+      w._physics->update(g_Delta, false);
+      setPaged(w, false);
+    };
+    b._run = []() {
+      world()._physics->update(g_Delta, false);
+    };
+    runner.add(std::move(b));
+  }
+
+  {
+    // Rays straight down, as for AI ground checks
+    struct RayState
+    {
+      std::vector<physics::RayQuery> _queries;
+      std::vector<physics::QueryHit> _results;
+    };
+    auto state = std::make_shared<RayState>();
+
+    Benchmark b{};
+    b._group = "physics";
+    b._name = "raycast_10000";
+    b._items = g_NumQueries;
+    b._setup = [state]() {
+      auto& w = world();
+      w._physics->simulationRunning() = true;
+      w._physics->update(g_Delta, false);
+
+      state->_queries.resize(g_NumQueries);
+      for (std::size_t i = 0; i < g_NumQueries; ++i) {
+        state->_queries[i]._origin = queryPoint(i, 50.0f);
+        state->_queries[i]._direction = glm::vec3(0.0f, -60.0f, 0.0f);
+      }
+    };
+    b._check = [state]() {
+      return checkRays(world(), state->_queries);
+    };
+    b._run = [state]() {
+      world()._physics->castRays(state->_queries, state->_results);
+      doNotOptimize(state->_results);
+    };
+    runner.add(std::move(b));
+  }
+
+  {
+    struct OverlapState
+    {
+      std::vector<physics::OverlapQuery> _queries;
+      std::vector<physics::OverlapResult> _results;
+      std::vector<physics::QueryHit> _hits;
+    };
+    auto state = std::make_shared<OverlapState>();
+
+    Benchmark b{};
+    b._group = "physics";
+    b._name = "overlap_10000";
+    b._items = g_NumQueries;
+    b._setup = [state]() {
+      auto& w = world();
+      w._physics->simulationRunning() = true;
+      w._physics->update(g_Delta, false);
+
+      state->_queries.resize(g_NumQueries);
+      for (std::size_t i = 0; i < g_NumQueries; ++i) {
+        state->_queries[i]._shape._radius = 1.0f;
+        state->_queries[i]._position = queryPoint(i, 1.0f);
+      }
+    };
+    b._check = [state]() {
+      return checkOverlaps(world(), state->_queries);
+    };
+    b._run = [state]() {
+      world()._physics->overlap(state->_queries, state->_results, state->_hits);
+      doNotOptimize(state->_hits);
+    };
+    runner.add(std::move(b));
+  }
+
+  {
+    // Registered last, the characters stay in the world once created
+    Benchmark b{};
+    b._group = "physics";
+    b._name = "characters_1000";
+    b._items = g_NumCharacters;
+    b._setup = []() {
+      auto& w = world();
+      addCharacters(w);
+      w._physics->simulationRunning() = true;
+      w._physics->upstreamTransformSync();
+      w._scene.update();
+
+      // Everyone walks towards the middle of the crowd, so they push into each other
+      glm::vec3 centre(39.5f, 1.4f, 0.0f);
+      for (auto& id : w._characters) {
+        auto& transform = w._scene.registry().getComponent<component::Transform>(id);
+        auto& charComp = w._scene.registry().getComponent<component::CharacterController>(id);
+        glm::vec3 toCentre = centre - glm::vec3(transform._globalTransform[3]);
+        toCentre.y = 0.0f;
+        charComp._desiredLinearVelocity = glm::length(toCentre) > 0.01f ? glm::normalize(toCentre) * 2.0f : glm::vec3(0.0f);
+      }
+    };
+    b._run = []() {
+      world()._physics->update(g_Delta, false);
+    };
+    runner.add(std::move(b));
+  }
+}
+
+}
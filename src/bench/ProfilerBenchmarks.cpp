@@ -0,0 +1,66 @@
+#include "Benchmarks.h"
+#include "Bench.h"
+
+#include <util/Profiler.h>
+
+namespace bench {
+
+namespace {
+
+constexpr std::size_t g_NumZones = 100000;
+
+}
+
+void registerProfilerBenchmarks(Runner& runner)
+{
+  {
+    // Cost of an instrumented scope, mostly the two clock reads
+    Benchmark b{};
+    b._group = "profiler";
+    b._name = "scope_zones_100k";
+    b._items = g_NumZones;
+    b._setup = []() { util::Profiler::setEnabled(true); };
+    b._run = []() {
+      for (std::size_t i = 0; i < g_NumZones; ++i) {
+        ANEREND_PROFILE_SCOPE("bench zone");
+      }
+    };
+    runner.add(std::move(b));
+  }
+
+  {
+    // What instrumentation costs while recording is paused
+    Benchmark b{};
+    b._group = "profiler";
+    b._name = "scope_zones_100k_disabled";
+    b._items = g_NumZones;
+    b._setup = []() { util::Profiler::setEnabled(false); };
+    b._run = []() {
+      for (std::size_t i = 0; i < g_NumZones; ++i) {
+        ANEREND_PROFILE_SCOPE("bench zone");
+      }
+    };
+    runner.add(std::move(b));
+  }
+
+  {
+    // Reading back a full ring, as the ImGui panel does every frame
+    Benchmark b{};
+    b._group = "profiler";
+    b._name = "snapshot_full_ring";
+    b._items = util::Profiler::EVENTS_PER_THREAD;
+    b._setup = []() {
+      util::Profiler::setEnabled(true);
+      for (std::size_t i = 0; i < util::Profiler::EVENTS_PER_THREAD; ++i) {
+        ANEREND_PROFILE_SCOPE("bench zone");
+      }
+    };
+    b._run = []() {
+      auto events = util::Profiler::snapshot();
+      doNotOptimize(events.data());
+    };
+    runner.add(std::move(b));
+  }
+}
+
+}
@@ -0,0 +1,159 @@
+#include "Benchmarks.h"
+#include "Bench.h"
+#include "SyntheticData.h"
+
+#include <render/NullRenderContext.h>
+#include <render/scene/Scene.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <memory>
+#include <vector>
+
+namespace bench {
+
+namespace {
+
+constexpr std::size_t g_NumModels = 16;
+constexpr std::size_t g_NumRenderables = 10000;
+
+/*
+* The renderer's CPU side driven through the headless NullRenderContext, so it runs without a GPU.
+* 16 models of 4 meshes each, instanced by 10k renderables in a grid.
+*/
+struct RendererState
+{
+  std::unique_ptr<render::scene::Scene> _scene;
+  std::unique_ptr<render::NullRenderContext> _rc;
+  std::vector<util::Uuid> _nodes;
+  render::Camera _camera;
+};
+
+render::AssetUpdate makeAssets(std::vector<util::Uuid>& modelIds, std::vector<util::Uuid>& matIds)
+{
+  render::AssetUpdate upd{};
+
+  for (std::size_t i = 0; i < g_NumModels; ++i) {
+    upd._addedModels.emplace_back(SyntheticData::model(4, 8, 100 + (std::uint32_t)i));
+    upd._addedMaterials.emplace_back(SyntheticData::material(200 + (std::uint32_t)i));
+
+    modelIds.emplace_back(upd._addedModels.back()._id);
+    matIds.emplace_back(upd._addedMaterials.back()._id);
+  }
+
+  return upd;
+}
+
+// Scene and context with all assets uploaded, but no renderables seen by the context yet.
+void buildState(RendererState& state)
+{
+  // Context first, it observes the scene's registry
+  state._rc.reset();
+  state._scene = std::make_unique<render::scene::Scene>();
+  state._rc = std::make_unique<render::NullRenderContext>();
+  state._nodes.clear();
+
+  std::vector<util::Uuid> modelIds;
+  std::vector<util::Uuid> matIds;
+  state._rc->assetUpdate(makeAssets(modelIds, matIds));
+  state._rc->setRegistry(&state._scene->registry());
+
+  auto& registry = state._scene->registry();
+
+  for (std::size_t i = 0; i < g_NumRenderables; ++i) {
+    auto transform = glm::translate(glm::mat4(1.0f), glm::vec3(2.0f * (i % 100), 0.0f, 2.0f * (i / 100)));
+
+    auto id = state._scene->addNode(render::scene::Node{});
+    registry.addComponent<component::Transform>(id, transform, transform);
+
+    component::Renderable rend{};
+    rend._model = modelIds[i % g_NumModels];
+    rend._materials = std::vector<util::Uuid>(4, matIds[i % g_NumModels]);
+    rend._tint = glm::vec3(1.0f);
+    rend._boundingSphere = glm::vec4(0.0f, 0.0f, 0.0f, 1.5f);
+    registry.addComponent<component::Renderable>(id, std::move(rend));
+    registry.addComponent<component::PageStatus>(id, true);
+
+    state._nodes.emplace_back(id);
+  }
+}
+
+}
+
+void registerRendererBenchmarks(Runner& runner)
+{
+  {
+    // Every renderable seen for the first time: pending list, prefills and mesh usage
+    auto state = std::make_shared<RendererState>();
+
+    Benchmark b{};
+    b._group = "renderer";
+    b._name = "add_renderables_10k";
+    b._items = g_NumRenderables;
+    b._setup = [state]() {
+      buildState(*state);
+
+      // Emplacing isn't observed
+      for (auto& id : state->_nodes) {
+        state->_scene->registry().patchComponent<component::PageStatus>(id);
+      }
+    };
+    b._run = [state]() {
+      state->_rc->update(state->_camera, 1.0 / 60.0);
+      doNotOptimize(state->_rc->renderableBuffer().data());
+    };
+    runner.add(std::move(b));
+  }
+
+  {
+    // Every renderable moved, as when a big hierarchy is dragged in the editor
+    auto state = std::make_shared<RendererState>();
+
+    Benchmark b{};
+    b._group = "renderer";
+    b._name = "update_transforms_10k";
+    b._items = g_NumRenderables;
+    b._setup = [state]() {
+      if (!state->_rc) {
+        buildState(*state);
+        for (auto& id : state->_nodes) {
+          state->_scene->registry().patchComponent<component::PageStatus>(id);
+        }
+        state->_rc->update(state->_camera, 1.0 / 60.0);
+      }
+
+      for (auto& id : state->_nodes) {
+        state->_scene->registry().patchComponent<component::Transform>(id);
+      }
+    };
+    b._run = [state]() {
+      state->_rc->update(state->_camera, 1.0 / 60.0);
+      doNotOptimize(state->_rc->renderableBuffer().data());
+    };
+    runner.add(std::move(b));
+  }
+
+  {
+    // Assets arriving from the asset fetcher: giga buffer allocation and id maps
+    auto rc = std::make_shared<std::unique_ptr<render::NullRenderContext>>();
+    auto upd = std::make_shared<render::AssetUpdate>();
+
+    Benchmark b{};
+    b._group = "renderer";
+    b._name = "asset_update_16_models";
+    b._items = g_NumModels;
+    b._setup = [rc, upd]() {
+      std::vector<util::Uuid> modelIds;
+      std::vector<util::Uuid> matIds;
+      *upd = makeAssets(modelIds, matIds);
+      *rc = std::make_unique<render::NullRenderContext>();
+    };
+    b._run = [rc, upd]() {
+      (*rc)->assetUpdate(std::move(*upd));
+      doNotOptimize((*rc)->getCurrentMeshes().data());
+    };
+    runner.add(std::move(b));
+  }
+}
+
+}
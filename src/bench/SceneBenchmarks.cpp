@@ -0,0 +1,154 @@
+#include "Benchmarks.h"
+#include "Bench.h"
+
+#include <render/scene/Scene.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <memory>
+#include <vector>
+
+namespace bench {
+
+namespace {
+
+struct SceneState
+{
+  std::unique_ptr<render::scene::Scene> _scene;
+  std::vector<util::Uuid> _roots;
+  std::vector<util::Uuid> _all;
+  float _time = 0.0f;
+};
+
+// Renderables are what the scene patches and sorts into tiles, so give every node one.
+util::Uuid addRenderableNode(render::scene::Scene& scene, const glm::mat4& local)
+{
+  render::scene::Node node{};
+  auto id = scene.addNode(std::move(node));
+
+  scene.registry().addComponent<component::Transform>(id, local, local);
+
+  component::Renderable rend{};
+  rend._boundingSphere = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+  rend._tint = glm::vec3(1.0f);
+  scene.registry().addComponent<component::Renderable>(id, std::move(rend));
+
+  return id;
+}
+
+glm::mat4 gridTransform(std::size_t i, std::size_t perRow, float spacing)
+{
+  return glm::translate(glm::mat4(1.0f), glm::vec3(spacing * (i % perRow), 0.0f, spacing * (i / perRow)));
+}
+
+// numRoots roots with numChildren direct children each, updated once so that everything is in tiles.
+void buildHierarchy(SceneState& state, std::size_t numRoots, std::size_t numChildren)
+{
+  state._scene = std::make_unique<render::scene::Scene>();
+  state._roots.clear();
+  state._all.clear();
+
+  auto& scene = *state._scene;
+
+  for (std::size_t r = 0; r < numRoots; ++r) {
+    auto root = addRenderableNode(scene, gridTransform(r, 32, 8.0f));
+    state._roots.emplace_back(root);
+    state._all.emplace_back(root);
+
+    for (std::size_t c = 0; c < numChildren; ++c) {
+      auto child = addRenderableNode(scene, glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 1.0f + c, 0.0f)));
+      scene.addNodeChild(root, child);
+      state._all.emplace_back(child);
+    }
+  }
+
+  for (auto& id : state._roots) {
+    scene.registry().patchComponent<component::Transform>(id);
+  }
+  scene.update();
+}
+
+}
+
+void registerSceneBenchmarks(Runner& runner)
+{
+  {
+    constexpr std::size_t numNodes = 10000;
+    auto state = std::make_shared<SceneState>();
+
+    Benchmark b{};
+    b._group = "scene";
+    b._name = "add_nodes_10k";
+    b._items = numNodes;
+    b._setup = [state]() {
+      state->_scene = std::make_unique<render::scene::Scene>();
+    };
+    b._run = [state]() {
+      auto& scene = *state->_scene;
+      for (std::size_t i = 0; i < numNodes; ++i) {
+        auto id = addRenderableNode(scene, gridTransform(i, 100, 4.0f));
+        scene.registry().patchComponent<component::Transform>(id);
+      }
+      scene.update();
+    };
+    runner.add(std::move(b));
+  }
+
+  {
+    // Moving every root means every tree is re-evaluated and every node patched.
+    constexpr std::size_t numRoots = 1000;
+    constexpr std::size_t numChildren = 10;
+    auto state = std::make_shared<SceneState>();
+
+    Benchmark b{};
+    b._group = "scene";
+    b._name = "update_transforms_1000x10";
+    b._items = numRoots * (numChildren + 1);
+    b._setup = [state]() {
+      if (!state->_scene) {
+        buildHierarchy(*state, numRoots, numChildren);
+      }
+    };
+    b._run = [state]() {
+      auto& scene = *state->_scene;
+      state->_time += 0.1f;
+
+      for (std::size_t i = 0; i < state->_roots.size(); ++i) {
+        auto& id = state->_roots[i];
+        auto& trans = scene.registry().getComponent<component::Transform>(id);
+        trans._localTransform = glm::rotate(gridTransform(i, 32, 8.0f), state->_time, glm::vec3(0.0f, 1.0f, 0.0f));
+        scene.registry().patchComponent<component::Transform>(id);
+      }
+      scene.update();
+    };
+    runner.add(std::move(b));
+  }
+
+  {
+    // Removal takes effect after two updates, both are timed.
+    constexpr std::size_t numRoots = 200;
+    constexpr std::size_t numChildren = 9;
+    auto state = std::make_shared<SceneState>();
+
+    Benchmark b{};
+    b._group = "scene";
+    b._name = "remove_nodes_2k";
+    b._items = numRoots * (numChildren + 1);
+    b._samples = 5;
+    b._setup = [state]() {
+      buildHierarchy(*state, numRoots, numChildren);
+    };
+    b._run = [state]() {
+      auto& scene = *state->_scene;
+      for (auto& id : state->_roots) {
+        scene.removeNode(id);
+      }
+      scene.update();
+      scene.update();
+      doNotOptimize(scene.getNodes().size());
+    };
+    runner.add(std::move(b));
+  }
+}
+
+}
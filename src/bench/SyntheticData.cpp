@@ -0,0 +1,332 @@
+#include "SyntheticData.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <vector>
+
+namespace bench {
+
+namespace {
+
+// Bilinearly interpolated lattice noise, in [0, 1]
+struct ValueNoise
+{
+  ValueNoise(unsigned cells, std::uint32_t seed)
+    : _cells(cells)
+  {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+    _lattice.resize(cells * cells);
+    for (auto& v : _lattice) v = dist(rng);
+  }
+
+  float sample(float u, float v) const
+  {
+    float x = u * _cells;
+    float y = v * _cells;
+    unsigned x0 = (unsigned)x % _cells;
+    unsigned y0 = (unsigned)y % _cells;
+    unsigned x1 = (x0 + 1) % _cells;
+    unsigned y1 = (y0 + 1) % _cells;
+    float fx = x - std::floor(x);
+    float fy = y - std::floor(y);
+
+    float a = _lattice[y0 * _cells + x0] * (1.0f - fx) + _lattice[y0 * _cells + x1] * fx;
+    float b = _lattice[y1 * _cells + x0] * (1.0f - fx) + _lattice[y1 * _cells + x1] * fx;
+    return a * (1.0f - fy) + b * fy;
+  }
+
+  unsigned _cells;
+  std::vector<float> _lattice;
+};
+
+std::string base64(const std::vector<std::uint8_t>& data)
+{
+  static const char* table = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+  std::string out;
+  out.reserve((data.size() + 2) / 3 * 4);
+
+  for (std::size_t i = 0; i < data.size(); i += 3) {
+    std::uint32_t n = (std::uint32_t)data[i] << 16;
+    if (i + 1 < data.size()) n |= (std::uint32_t)data[i + 1] << 8;
+    if (i + 2 < data.size()) n |= data[i + 2];
+
+    out += table[(n >> 18) & 63];
+    out += table[(n >> 12) & 63];
+    out += i + 1 < data.size() ? table[(n >> 6) & 63] : '=';
+    out += i + 2 < data.size() ? table[n & 63] : '=';
+  }
+
+  return out;
+}
+
+template <typename T>
+void append(std::vector<std::uint8_t>& buf, const T& value)
+{
+  auto* p = reinterpret_cast<const std::uint8_t*>(&value);
+  buf.insert(buf.end(), p, p + sizeof(T));
+}
+
+}
+
+render::asset::Mesh SyntheticData::gridMesh(unsigned quadsPerSide, std::uint32_t seed)
+{
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<float> phase(0.0f, 6.2831853f);
+  float p0 = phase(rng);
+  float p1 = phase(rng);
+
+  render::asset::Mesh mesh{};
+
+  unsigned side = quadsPerSide + 1;
+  mesh._vertices.reserve(side * side);
+
+  auto height = [p0, p1](float x, float z) {
+    return 0.1f * std::sin(6.0f * x + p0) * std::cos(4.0f * z + p1);
+  };
+
+  for (unsigned z = 0; z < side; ++z) {
+    for (unsigned x = 0; x < side; ++x) {
+      float fx = (float)x / quadsPerSide;
+      float fz = (float)z / quadsPerSide;
+
+      render::Vertex v{};
+      v.pos = glm::vec3(fx - 0.5f, height(fx, fz), fz - 0.5f);
+      v.color = glm::vec3(1.0f);
+      v.uv = glm::vec2(fx, fz);
+
+      // Central differences for the normal
+      const float e = 1e-3f;
+      float dx = (height(fx + e, fz) - height(fx - e, fz)) / (2.0f * e);
+      float dz = (height(fx, fz + e) - height(fx, fz - e)) / (2.0f * e);
+      v.normal = glm::normalize(glm::vec3(-dx, 1.0f, -dz));
+      v.tangent = glm::vec4(1.0f, dx, 0.0f, 1.0f);
+      v.jointWeights = glm::vec4(0.0f);
+      v.jointIds = glm::i16vec4(0);
+
+      mesh._vertices.emplace_back(v);
+    }
+  }
+
+  mesh._indices.reserve(quadsPerSide * quadsPerSide * 6);
+  for (unsigned z = 0; z < quadsPerSide; ++z) {
+    for (unsigned x = 0; x < quadsPerSide; ++x) {
+      std::uint32_t i0 = z * side + x;
+      std::uint32_t i1 = i0 + 1;
+      std::uint32_t i2 = i0 + side;
+      std::uint32_t i3 = i2 + 1;
+
+      mesh._indices.insert(mesh._indices.end(), { i0, i2, i1, i1, i2, i3 });
+    }
+  }
+
+  mesh._minPos = glm::vec3(std::numeric_limits<float>::max());
+  mesh._maxPos = glm::vec3(std::numeric_limits<float>::lowest());
+  for (auto& v : mesh._vertices) {
+    mesh._minPos = glm::min(mesh._minPos, v.pos);
+    mesh._maxPos = glm::max(mesh._maxPos, v.pos);
+  }
+
+  return mesh;
+}
+
+render::asset::Model SyntheticData::model(unsigned numMeshes, unsigned quadsPerSide, std::uint32_t seed)
+{
+  render::asset::Model model{};
+  model._name = "SyntheticModel_" + std::to_string(seed);
+
+  for (unsigned i = 0; i < numMeshes; ++i) {
+    model._meshes.emplace_back(gridMesh(quadsPerSide, seed * 7919u + i));
+  }
+
+  return model;
+}
+
+render::asset::Material SyntheticData::material(std::uint32_t seed)
+{
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+
+  render::asset::Material mat{};
+  mat._name = "SyntheticMaterial_" + std::to_string(seed);
+  mat._baseColFactor = glm::vec3(dist(rng), dist(rng), dist(rng));
+  mat._metallicFactor = dist(rng);
+  mat._roughnessFactor = dist(rng);
+
+  return mat;
+}
+
+render::asset::Texture SyntheticData::textureRGBA8(unsigned w, unsigned h, bool srgb, std::uint32_t seed)
+{
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<int> grain(-6, 6);
+
+  ValueNoise coarse(8, seed * 31u + 1u);
+  ValueNoise medium(32, seed * 31u + 2u);
+  ValueNoise fine(128, seed * 31u + 3u);
+
+  render::asset::Texture tex{};
+  tex._name = "SyntheticTexture_" + std::to_string(seed);
+  tex._format = srgb ? render::asset::Texture::Format::RGBA8_SRGB : render::asset::Texture::Format::RGBA8_UNORM;
+  tex._width = w;
+  tex._height = h;
+  tex._numMips = 1;
+  tex._data.emplace_back();
+
+  auto& data = tex._data[0];
+  data.resize((std::size_t)w * h * 4);
+
+  for (unsigned y = 0; y < h; ++y) {
+    for (unsigned x = 0; x < w; ++x) {
+      float u = (float)x / w;
+      float v = (float)y / h;
+
+      float n = 0.6f * coarse.sample(u, v) + 0.3f * medium.sample(u, v) + 0.1f * fine.sample(u, v);
+      float m = medium.sample(v, u);
+
+      auto px = &data[((std::size_t)y * w + x) * 4];
+      px[0] = (std::uint8_t)std::clamp((int)(255.0f * n) + grain(rng), 0, 255);
+      px[1] = (std::uint8_t)std::clamp((int)(255.0f * (0.5f * n + 0.5f * m)) + grain(rng), 0, 255);
+      px[2] = (std::uint8_t)std::clamp((int)(255.0f * m) + grain(rng), 0, 255);
+      px[3] = (std::uint8_t)(n > 0.3f ? 255 : 0);
+    }
+  }
+
+  return tex;
+}
+
+render::anim::Animation SyntheticData::animation(unsigned numJoints, unsigned numKeys, float duration, std::uint32_t seed)
+{
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+
+  render::anim::Animation anim{};
+  anim._name = "SyntheticAnimation_" + std::to_string(seed);
+
+  for (unsigned j = 0; j < numJoints; ++j) {
+    render::anim::Channel rot{};
+    rot._internalId = (int)j;
+    rot._path = render::anim::ChannelPath::Rotation;
+
+    render::anim::Channel trans{};
+    trans._internalId = (int)j;
+    trans._path = render::anim::ChannelPath::Translation;
+
+    for (unsigned k = 0; k < numKeys; ++k) {
+      float t = numKeys > 1 ? duration * k / (numKeys - 1) : 0.0f;
+
+      glm::vec4 q(dist(rng), dist(rng), dist(rng), 1.0f + std::abs(dist(rng)));
+      q = glm::normalize(q);
+
+      rot._inputTimes.emplace_back(t);
+      rot._outputs.emplace_back(q);
+
+      trans._inputTimes.emplace_back(t);
+      trans._outputs.emplace_back(glm::vec4(0.1f * dist(rng), 0.1f * dist(rng) + 0.25f, 0.1f * dist(rng), 0.0f));
+    }
+
+    anim._channels.emplace_back(std::move(rot));
+    anim._channels.emplace_back(std::move(trans));
+  }
+
+  return anim;
+}
+
+bool SyntheticData::writeGltf(const std::filesystem::path& path, unsigned numNodes, unsigned quadsPerSide, std::uint32_t seed)
+{
+  std::vector<std::uint8_t> buffer;
+
+  std::stringstream nodes;
+  std::stringstream meshes;
+  std::stringstream views;
+  std::stringstream accessors;
+
+  unsigned viewIdx = 0;
+
+  auto addView = [&](std::size_t offset, std::size_t length, int target) {
+    if (viewIdx > 0) views << ",";
+    views << "{\"buffer\":0,\"byteOffset\":" << offset << ",\"byteLength\":" << length << ",\"target\":" << target << "}";
+    return viewIdx++;
+  };
+
+  auto addAccessor = [&](unsigned view, int componentType, std::size_t count, const char* type, const std::string& extra) {
+    if (view > 0) accessors << ",";
+    accessors << "{\"bufferView\":" << view << ",\"componentType\":" << componentType << ",\"count\":" << count
+              << ",\"type\":\"" << type << "\"" << extra << "}";
+    return view;
+  };
+
+  for (unsigned n = 0; n < numNodes; ++n) {
+    auto mesh = gridMesh(quadsPerSide, seed * 104729u + n);
+    std::size_t numVerts = mesh._vertices.size();
+
+    std::size_t posOffset = buffer.size();
+    for (auto& v : mesh._vertices) append(buffer, v.pos);
+    std::size_t normOffset = buffer.size();
+    for (auto& v : mesh._vertices) append(buffer, v.normal);
+    std::size_t uvOffset = buffer.size();
+    for (auto& v : mesh._vertices) append(buffer, v.uv);
+    std::size_t idxOffset = buffer.size();
+    for (auto i : mesh._indices) append(buffer, i);
+
+    constexpr int arrayBuffer = 34962;
+    constexpr int elementArrayBuffer = 34963;
+    constexpr int floatType = 5126;
+    constexpr int uintType = 5125;
+
+    std::stringstream minMax;
+    minMax << ",\"min\":[" << mesh._minPos.x << "," << mesh._minPos.y << "," << mesh._minPos.z << "]"
+           << ",\"max\":[" << mesh._maxPos.x << "," << mesh._maxPos.y << "," << mesh._maxPos.z << "]";
+
+    auto pos = addAccessor(addView(posOffset, normOffset - posOffset, arrayBuffer), floatType, numVerts, "VEC3", minMax.str());
+    auto norm = addAccessor(addView(normOffset, uvOffset - normOffset, arrayBuffer), floatType, numVerts, "VEC3", "");
+    auto uv = addAccessor(addView(uvOffset, idxOffset - uvOffset, arrayBuffer), floatType, numVerts, "VEC2", "");
+    auto idx = addAccessor(addView(idxOffset, buffer.size() - idxOffset, elementArrayBuffer), uintType, mesh._indices.size(), "SCALAR", "");
+
+    if (n > 0) {
+      meshes << ",";
+      nodes << ",";
+    }
+
+    meshes << "{\"primitives\":[{\"attributes\":{\"POSITION\":" << pos << ",\"NORMAL\":" << norm << ",\"TEXCOORD_0\":" << uv
+           << "},\"indices\":" << idx << ",\"material\":0}]}";
+
+    nodes << "{\"name\":\"node_" << n << "\",\"mesh\":" << n << ",\"translation\":[" << (float)(n % 32) << ",0," << (float)(n / 32) << "]}";
+  }
+
+  std::ofstream ofs(path);
+  if (!ofs.is_open()) {
+    printf("Could not write synthetic glTF to %s!\n", path.string().c_str());
+    return false;
+  }
+
+  ofs << "{\"asset\":{\"version\":\"2.0\",\"generator\":\"anerend_bench\"},";
+  ofs << "\"scene\":0,\"scenes\":[{\"nodes\":[";
+  for (unsigned n = 0; n < numNodes; ++n) {
+    ofs << (n > 0 ? "," : "") << n;
+  }
+  ofs << "]}],";
+  ofs << "\"nodes\":[" << nodes.str() << "],";
+  ofs << "\"meshes\":[" << meshes.str() << "],";
+  ofs << "\"materials\":[{\"name\":\"synthetic\",\"pbrMetallicRoughness\":{\"baseColorFactor\":[0.8,0.6,0.4,1.0],\"metallicFactor\":0.0,\"roughnessFactor\":0.6}}],";
+  ofs << "\"buffers\":[{\"byteLength\":" << buffer.size() << ",\"uri\":\"data:application/octet-stream;base64," << base64(buffer) << "\"}],";
+  ofs << "\"bufferViews\":[" << views.str() << "],";
+  ofs << "\"accessors\":[" << accessors.str() << "]}";
+
+  return true;
+}
+
+std::filesystem::path SyntheticData::scratchPath(const std::string& fileName)
+{
+  auto dir = std::filesystem::temp_directory_path() / "anerend_bench";
+  std::filesystem::create_directories(dir);
+  return dir / fileName;
+}
+
+}
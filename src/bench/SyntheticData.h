@@ -0,0 +1,40 @@
+#pragma once
+
+#include <render/asset/Model.h>
+#include <render/asset/Material.h>
+#include <render/asset/Texture.h>
+#include <render/animation/Animation.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+namespace bench {
+
+/*
+* Deterministic generators for benchmark inputs. The same seed always gives the same data,
+* so that results are comparable between runs and machines.
+*/
+struct SyntheticData
+{
+  // A wavy grid of quadsPerSide^2 quads, with positions, normals and uvs.
+  static render::asset::Mesh gridMesh(unsigned quadsPerSide, std::uint32_t seed);
+  static render::asset::Model model(unsigned numMeshes, unsigned quadsPerSide, std::uint32_t seed);
+
+  static render::asset::Material material(std::uint32_t seed);
+
+  // Smooth noise with some fine detail on top, roughly like photographic content.
+  // Always 8 bit RGBA, single mip.
+  static render::asset::Texture textureRGBA8(unsigned w, unsigned h, bool srgb, std::uint32_t seed);
+
+  // numJoints joints, each with a rotation and translation channel of numKeys keys over duration seconds.
+  static render::anim::Animation animation(unsigned numJoints, unsigned numKeys, float duration, std::uint32_t seed);
+
+  // Writes a .gltf with an embedded (base64) buffer. Every node has its own grid mesh, all sharing one material.
+  static bool writeGltf(const std::filesystem::path& path, unsigned numNodes, unsigned quadsPerSide, std::uint32_t seed);
+
+  // A scratch directory for files the benchmarks need, created if needed.
+  static std::filesystem::path scratchPath(const std::string& fileName);
+};
+
+}
@@ -0,0 +1,380 @@
+#include "Benchmarks.h"
+#include "Bench.h"
+#include "SyntheticData.h"
+
+#include <util/BlockCompressor.h>
+#include <util/PixelConversion.h>
+#include <util/TextureHelpers.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+namespace bench {
+
+namespace {
+
+struct TextureState
+{
+  render::asset::Texture _source;
+  render::asset::Texture _work;
+};
+
+std::shared_ptr<TextureState> makeState()
+{
+  return std::make_shared<TextureState>();
+}
+
+void ensureSource(TextureState& state, unsigned size)
+{
+  if (state._source._data.empty()) {
+    state._source = SyntheticData::textureRGBA8(size, size, true, 10 + size);
+  }
+}
+
+void registerMips(Runner& runner, const std::string& name, unsigned size, util::MipFilter filter)
+{
+  auto state = makeState();
+
+  Benchmark b{};
+  b._group = "texture";
+  b._name = name;
+  b._items = (std::size_t)size * size;
+  b._setup = [state, size]() {
+    ensureSource(*state, size);
+    state->_work = state->_source;
+  };
+  b._run = [state, filter]() {
+    util::MipOptions options{};
+    options._filter = filter;
+    util::TextureHelpers::generateMipMaps(state->_work, options);
+    doNotOptimize(state->_work._data.size());
+  };
+  runner.add(std::move(b));
+}
+
+void registerCompress(Runner& runner, const std::string& name, unsigned size, util::BCFormat format, util::BCQuality quality)
+{
+  auto state = makeState();
+
+  Benchmark b{};
+  b._group = "texture";
+  b._name = name;
+  b._items = (std::size_t)size * size;
+  b._samples = quality == util::BCQuality::Fast ? 5 : 3;
+  b._setup = [state, size]() { ensureSource(*state, size); };
+  b._run = [state, size, format, quality]() {
+    util::BCOptions options{};
+    options._quality = quality;
+    auto blocks = util::BlockCompressor::compressImage(state->_source._data[0].data(), size, size, 4, format, options);
+    doNotOptimize(blocks.data());
+  };
+  runner.add(std::move(b));
+}
+
+// SIMD paths this CPU runs, forcing any other path would silently run scalar
+std::vector<util::ConversionPath> simdPaths()
+{
+  auto best = util::PixelConversion::bestPath();
+  std::vector<util::ConversionPath> paths;
+  if (best == util::ConversionPath::AVX2) {
+    paths.emplace_back(util::ConversionPath::SSSE3);
+  }
+  if (best != util::ConversionPath::Scalar) {
+    paths.emplace_back(best);
+  }
+  return paths;
+}
+
+// Runs convert on the whole of src, and on every length up to 67 from an aligned and a misaligned start,
+// with each SIMD path and with the scalar path. The outputs, including untouched guard elements after them, have to be bitwise equal.
+template <typename Src, typename Dst, typename Func>
+bool compareWithScalar(const char* name, const std::vector<Src>& src, std::size_t srcPerItem, std::size_t dstPerItem, Func convert)
+{
+  const std::size_t guard = 8;
+  std::size_t numItems = src.size() / srcPerItem;
+
+  auto run = [&](util::ConversionPath path, std::size_t first, std::size_t count) {
+    std::vector<Dst> dst(count * dstPerItem + guard);
+    std::memset(dst.data(), 0xCD, dst.size() * sizeof(Dst));
+
+    util::ConversionOptions options{};
+    options._path = path;
+    convert(src.data() + first * srcPerItem, dst.data(), count, options);
+    return dst;
+  };
+
+  for (auto path : simdPaths()) {
+    auto check = [&](std::size_t first, std::size_t count) {
+      auto expected = run(util::ConversionPath::Scalar, first, count);
+      auto actual = run(path, first, count);
+      if (std::memcmp(expected.data(), actual.data(), expected.size() * sizeof(Dst)) != 0) {
+        printf("%s with %s differs from scalar for %zu items at %zu!\n", name, util::PixelConversion::pathName(path), count, first);
+        return false;
+      }
+      return true;
+    };
+
+    if (!check(0, numItems)) {
+      return false;
+    }
+
+    for (std::size_t count = 1; count <= 67; ++count) {
+      if (!check(0, count) || !check(1, count)) {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+// Every 8 bit value in every channel, in a different order per channel
+std::vector<std::uint8_t> allBytesRGBA()
+{
+  std::vector<std::uint8_t> src(256 * 4 * 4);
+  for (std::size_t i = 0; i < src.size() / 4; ++i) {
+    src[i * 4 + 0] = std::uint8_t(i);
+    src[i * 4 + 1] = std::uint8_t(255 - i);
+    src[i * 4 + 2] = std::uint8_t(i * 7);
+    src[i * 4 + 3] = std::uint8_t(i * 13 + 5);
+  }
+  return src;
+}
+
+bool checkExtractChannels()
+{
+  auto src = allBytesRGBA();
+
+  const unsigned maps[][4] = {
+    { 0, 1, 2, 3 },
+    { 0, 1, 2, 0 },
+    { 2, 1, 0, 3 },
+    { 3, 3, 1, 0 },
+    { 1, 0, 3, 2 },
+  };
+
+  for (unsigned dstChannels = 1; dstChannels <= 4; ++dstChannels) {
+    for (auto& map : maps) {
+      bool ok = compareWithScalar<std::uint8_t, std::uint8_t>("extractChannels", src, 4, dstChannels,
+        [dstChannels, &map](const std::uint8_t* s, std::uint8_t* d, std::size_t count, const util::ConversionOptions& options) {
+          util::PixelConversion::extractChannels(s, d, count, dstChannels, map, options);
+        });
+      if (!ok) {
+        printf("Channel map %u %u %u %u, %u channels!\n", map[0], map[1], map[2], map[3], dstChannels);
+        return false;
+      }
+    }
+  }
+
+  // The scalar reference itself, against a plain copy
+  const unsigned rgb[] = { 0, 1, 2 };
+  std::vector<std::uint8_t> dst(src.size() / 4 * 3);
+  util::ConversionOptions scalar{};
+  scalar._path = util::ConversionPath::Scalar;
+  util::PixelConversion::extractChannels(src.data(), dst.data(), src.size() / 4, 3, rgb, scalar);
+  for (std::size_t i = 0; i < src.size() / 4; ++i) {
+    if (std::memcmp(&src[i * 4], &dst[i * 3], 3) != 0) {
+      printf("Scalar RGBA to RGB is wrong at texel %zu!\n", i);
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool checkSrgb()
+{
+  std::vector<std::uint8_t> bytes(256 * 4);
+  for (std::size_t i = 0; i < bytes.size(); ++i) {
+    bytes[i] = std::uint8_t(i);
+  }
+
+  bool ok = compareWithScalar<std::uint8_t, float>("srgbToLinear", bytes, 1, 1,
+    [](const std::uint8_t* s, float* d, std::size_t count, const util::ConversionOptions& options) {
+      util::PixelConversion::srgbToLinear(s, d, count, options);
+    });
+  if (!ok) {
+    return false;
+  }
+
+  // Every value that rounds back to each byte, its neighbours across the rounding thresholds and out of range values
+  std::vector<float> linear;
+  for (int i = 0; i < 256; ++i) {
+    float v = util::PixelConversion::srgbToLinear(std::uint8_t(i));
+    linear.emplace_back(v);
+    linear.emplace_back(std::nextafter(v, -1.0f));
+    linear.emplace_back(std::nextafter(v, 2.0f));
+  }
+  for (int i = 0; i <= 4096; ++i) {
+    linear.emplace_back(-0.25f + 1.5f * float(i) / 4096.0f);
+  }
+
+  return compareWithScalar<float, std::uint8_t>("linearToSrgb", linear, 1, 1,
+    [](const float* s, std::uint8_t* d, std::size_t count, const util::ConversionOptions& options) {
+      util::PixelConversion::linearToSrgb(s, d, count, options);
+    });
+}
+
+bool checkUnormAndHalf()
+{
+  std::vector<std::uint8_t> bytes(256 * 4);
+  for (std::size_t i = 0; i < bytes.size(); ++i) {
+    bytes[i] = std::uint8_t(i);
+  }
+
+  bool ok = compareWithScalar<std::uint8_t, std::uint16_t>("unorm8ToUnorm16", bytes, 1, 1,
+    [](const std::uint8_t* s, std::uint16_t* d, std::size_t count, const util::ConversionOptions& options) {
+      util::PixelConversion::unorm8ToUnorm16(s, d, count, options);
+    });
+  if (!ok) {
+    return false;
+  }
+
+  // Every 16 bit pattern, as unorm and as half
+  std::vector<std::uint16_t> shorts(65536);
+  for (std::size_t i = 0; i < shorts.size(); ++i) {
+    shorts[i] = std::uint16_t(i);
+  }
+
+  ok = compareWithScalar<std::uint16_t, std::uint8_t>("unorm16ToUnorm8", shorts, 1, 1,
+    [](const std::uint16_t* s, std::uint8_t* d, std::size_t count, const util::ConversionOptions& options) {
+      util::PixelConversion::unorm16ToUnorm8(s, d, count, options);
+    });
+  ok = ok && compareWithScalar<std::uint16_t, float>("halfToFloat", shorts, 1, 1,
+    [](const std::uint16_t* s, float* d, std::size_t count, const util::ConversionOptions& options) {
+      util::PixelConversion::halfToFloat(s, d, count, options);
+    });
+  if (!ok) {
+    return false;
+  }
+
+  // Every half as a float, the ties halfway to the next half and the floats right around the ties
+  std::vector<float> floats;
+  floats.reserve(65536 * 4);
+  for (std::size_t i = 0; i < 65536; ++i) {
+    std::uint16_t h = std::uint16_t(i);
+    float v = util::PixelConversion::halfToFloat(h);
+    floats.emplace_back(v);
+
+    if ((h & 0x7FFF) >= 0x7C00) {
+      continue; // Inf and NaN have no next half
+    }
+
+    // The next half away from zero, 0x7BFF to 0x7C00 gives the rounding threshold to infinity
+    float next = util::PixelConversion::halfToFloat(std::uint16_t(h + 1));
+    float tie = v + (next - v) * 0.5f;
+    floats.emplace_back(tie);
+    floats.emplace_back(std::nextafter(tie, 0.0f));
+    floats.emplace_back(std::nextafter(tie, tie * 2.0f));
+  }
+
+  ok = compareWithScalar<float, std::uint16_t>("floatToHalf", floats, 1, 1,
+    [](const float* s, std::uint16_t* d, std::size_t count, const util::ConversionOptions& options) {
+      util::PixelConversion::floatToHalf(s, d, count, options);
+    });
+  if (!ok) {
+    return false;
+  }
+
+  // Every half that isn't NaN survives a round trip through float
+  for (std::size_t i = 0; i < 65536; ++i) {
+    std::uint16_t h = std::uint16_t(i);
+    if ((h & 0x7FFF) > 0x7C00) {
+      continue;
+    }
+
+    auto back = util::PixelConversion::floatToHalf(util::PixelConversion::halfToFloat(h));
+    if (back != h) {
+      printf("Half 0x%04x came back as 0x%04x!\n", (unsigned)h, (unsigned)back);
+      return false;
+    }
+  }
+
+  return true;
+}
+
+}
+
+void registerTextureBenchmarks(Runner& runner)
+{
+  registerMips(runner, "mips_box_2048", 2048, util::MipFilter::Box);
+  registerMips(runner, "mips_kaiser_2048", 2048, util::MipFilter::Kaiser);
+
+  registerCompress(runner, "bc1_fast_2048", 2048, util::BCFormat::BC1, util::BCQuality::Fast);
+  registerCompress(runner, "bc7_fast_1024", 1024, util::BCFormat::BC7, util::BCQuality::Fast);
+  registerCompress(runner, "bc7_normal_1024", 1024, util::BCFormat::BC7, util::BCQuality::Normal);
+
+  {
+    constexpr unsigned size = 2048;
+    auto state = makeState();
+    auto dst = std::make_shared<std::vector<std::uint8_t>>();
+
+    Benchmark b{};
+    b._group = "texture";
+    b._name = "rgba_to_rgb_2048";
+    b._items = size * size;
+    b._check = []() { return checkExtractChannels(); };
+    b._setup = [state, dst]() {
+      ensureSource(*state, size);
+      dst->resize(size * size * 3);
+    };
+    b._run = [state, dst]() {
+      const unsigned channelMap[] = { 0, 1, 2 };
+      util::PixelConversion::extractChannels(state->_source._data[0].data(), dst->data(), size * size, 3, channelMap);
+      doNotOptimize(dst->data());
+    };
+    runner.add(std::move(b));
+  }
+
+  {
+    constexpr unsigned size = 2048;
+    auto state = makeState();
+    auto dst = std::make_shared<std::vector<float>>();
+
+    Benchmark b{};
+    b._group = "texture";
+    b._name = "srgb_to_linear_2048";
+    b._items = size * size * 4;
+    b._check = []() { return checkSrgb(); };
+    b._setup = [state, dst]() {
+      ensureSource(*state, size);
+      dst->resize(size * size * 4);
+    };
+    b._run = [state, dst]() {
+      util::PixelConversion::srgbToLinear(state->_source._data[0].data(), dst->data(), size * size * 4);
+      doNotOptimize(dst->data());
+    };
+    runner.add(std::move(b));
+  }
+
+  {
+    constexpr unsigned size = 2048;
+    auto src = std::make_shared<std::vector<float>>();
+    auto dst = std::make_shared<std::vector<std::uint16_t>>();
+
+    Benchmark b{};
+    b._group = "texture";
+    b._name = "float_to_half_2048";
+    b._items = size * size * 4;
+    b._check = []() { return checkUnormAndHalf(); };
+    b._setup = [src, dst]() {
+      if (src->empty()) {
+        src->resize(size * size * 4);
+        for (std::size_t i = 0; i < src->size(); ++i) {
+          (*src)[i] = float(i % 8191) * 0.37f - 1000.0f;
+        }
+      }
+      dst->resize(size * size * 4);
+    };
+    b._run = [src, dst]() {
+      util::PixelConversion::floatToHalf(src->data(), dst->data(), src->size());
+      doNotOptimize(dst->data());
+    };
+    runner.add(std::move(b));
+  }
+}
+
+}
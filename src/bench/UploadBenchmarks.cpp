@@ -0,0 +1,644 @@
+#include "Benchmarks.h"
+#include "Bench.h"
+
+#include <render/internal/GigaBufferCompactor.h>
+#include <render/internal/TextureResidency.h>
+#include <render/internal/UploadPlanner.h>
+#include <util/Uuid.h>
+
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace bench {
+
+namespace {
+
+using render::internal::BufferMemoryInterface;
+using render::internal::GigaBufferCompactor;
+using render::internal::TextureResidency;
+using render::internal::UploadPlanner;
+
+constexpr std::size_t g_NumUploads = 10000;
+constexpr std::size_t g_StagingSize = 64 * 1024 * 1024;
+constexpr std::size_t g_FrameBudget = 8 * 1024 * 1024;
+constexpr std::size_t g_Alignment = 16;
+constexpr std::size_t g_NumAllocations = 4096;
+constexpr std::size_t g_CompactBudget = 4 * 1024 * 1024;
+constexpr std::size_t g_NumTextures = 4096;
+
+// Sizes of a mix of small buffer updates and the odd big texture
+std::vector<std::size_t> makeUploadSizes(std::size_t count)
+{
+  std::mt19937 rng(1234);
+  std::uniform_int_distribution<std::size_t> small(16, 64 * 1024);
+  std::uniform_int_distribution<std::size_t> big(1024 * 1024, 12 * 1024 * 1024);
+
+  std::vector<std::size_t> sizes(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    sizes[i] = i % 500 == 0 ? big(rng) : small(rng);
+  }
+  return sizes;
+}
+
+struct PlannedUpload
+{
+  std::size_t _index;
+  std::size_t _frame;
+  std::size_t _offset;
+};
+
+// Drains the sizes through one planner per frame, like UploadQueue does with the frame's staging buffer.
+// The staging buffer is reset when its frame comes around again, so every frame starts over at stagingStart.
+std::vector<PlannedUpload> planFrames(const std::vector<std::size_t>& sizes, std::size_t stagingStart, std::size_t& numFrames)
+{
+  std::vector<PlannedUpload> out;
+  out.reserve(sizes.size());
+
+  std::size_t next = 0;
+  numFrames = 0;
+  while (next < sizes.size()) {
+    UploadPlanner planner(stagingStart, g_StagingSize, g_FrameBudget);
+    while (next < sizes.size() && planner.fits(sizes[next], g_Alignment)) {
+      auto offset = planner.reserve(sizes[next], g_Alignment);
+      out.emplace_back(PlannedUpload{ next, numFrames, (std::size_t)offset });
+      next++;
+    }
+
+    numFrames++;
+    if (numFrames > sizes.size()) {
+      break; // Something doesn't fit at all, don't spin forever
+    }
+  }
+
+  return out;
+}
+
+bool checkCoalesce()
+{
+  // Shuffled, with runs that are contiguous in both, only in the destination and only in the source
+  std::vector<UploadPlanner::CopyRegion> regions = {
+    { 300, 1300, 100 },
+    { 0, 1000, 100 },
+    { 200, 1200, 100 },
+    { 100, 1100, 100 }, // 0..400 -> 1000..1400 is one region
+    { 900, 1400, 50 }, // Follows in dst but not in src
+    { 950, 2000, 50 }, // Follows in src but not in dst
+    { 5000, 3000, 0 },
+  };
+  UploadPlanner::coalesce(regions);
+
+  std::vector<UploadPlanner::CopyRegion> expected = {
+    { 0, 1000, 400 },
+    { 900, 1400, 50 },
+    { 950, 2000, 50 },
+    { 5000, 3000, 0 },
+  };
+
+  if (regions.size() != expected.size()) {
+    printf("Coalesced into %zu regions, expected %zu!\n", regions.size(), expected.size());
+    return false;
+  }
+
+  for (std::size_t i = 0; i < regions.size(); ++i) {
+    if (regions[i]._srcOffset != expected[i]._srcOffset ||
+        regions[i]._dstOffset != expected[i]._dstOffset ||
+        regions[i]._size != expected[i]._size) {
+      printf("Coalesced region %zu is %zu -> %zu (%zu bytes), expected %zu -> %zu (%zu bytes)!\n", i,
+        regions[i]._srcOffset, regions[i]._dstOffset, regions[i]._size,
+        expected[i]._srcOffset, expected[i]._dstOffset, expected[i]._size);
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool checkBudget()
+{
+  UploadPlanner planner(0, 4096, 1000);
+  if (planner.reserve(400) != 0 || planner.reserve(400) != 400) {
+    printf("Reservations under the budget were refused!\n");
+    return false;
+  }
+  if (planner.reserve(300) != -1) {
+    printf("Reservation over the budget was accepted!\n");
+    return false;
+  }
+  if (planner.reserve(200) != 800 || planner.bytesPlanned() != 1000) {
+    printf("Reservation up to the budget was refused!\n");
+    return false;
+  }
+
+  // Only the first item of a frame may go over budget, also when it is part of a batch
+  UploadPlanner fresh(0, 4096, 1000);
+  if (!fresh.fits(1500) || fresh.fits(1500, 1, 500)) {
+    printf("Over budget batch handled wrong, first item must fit and later items must not!\n");
+    return false;
+  }
+  if (fresh.reserve(1500) != 0 || fresh.fits(1)) {
+    printf("First reservation of the frame over budget handled wrong!\n");
+    return false;
+  }
+
+  // The staging space is a hard limit, also for the first item
+  UploadPlanner tooBig(0, 4096, 1000);
+  if (tooBig.fits(4097)) {
+    printf("Reservation past the staging end was accepted!\n");
+    return false;
+  }
+
+  return true;
+}
+
+bool checkStagingEnd()
+{
+  UploadPlanner planner(10, 100, 1000);
+  if (planner.reserve(5, 16) != 16) {
+    printf("Reservation was not aligned!\n");
+    return false;
+  }
+  if (planner.reserve(80) != -1) {
+    printf("Reservation past the staging end was accepted!\n");
+    return false;
+  }
+  if (planner.reserve(79) != 21 || planner.stagingOffset() != 100) {
+    printf("Reservation ending at the staging end was refused!\n");
+    return false;
+  }
+  if (planner.fits(1) || planner.fits(0, 16)) {
+    printf("Full staging buffer still fits data!\n");
+    return false;
+  }
+
+  return true;
+}
+
+bool checkFrames()
+{
+  auto sizes = makeUploadSizes(g_NumUploads);
+  const std::size_t stagingStart = 1024; // As if something else was staged first this frame
+
+  std::size_t numFrames = 0;
+  auto planned = planFrames(sizes, stagingStart, numFrames);
+  if (planned.size() != sizes.size()) {
+    printf("Planned %zu of %zu uploads!\n", planned.size(), sizes.size());
+    return false;
+  }
+
+  std::size_t total = 0;
+  for (auto s : sizes) {
+    total += s;
+  }
+
+  // Frames should be close to full, otherwise the budget goes unused
+  std::size_t minFrames = (total + g_FrameBudget - 1) / g_FrameBudget;
+  if (numFrames < minFrames || numFrames > 2 * minFrames) {
+    printf("Uploads took %zu frames, expected between %zu and %zu!\n", numFrames, minFrames, 2 * minFrames);
+    return false;
+  }
+
+  std::size_t frameStart = 0;
+  std::size_t frameBytes = 0;
+  for (std::size_t i = 0; i < planned.size(); ++i) {
+    auto& p = planned[i];
+    if (p._index != i) {
+      printf("Upload %zu was planned out of order!\n", i);
+      return false;
+    }
+
+    if (i == 0 || planned[i - 1]._frame != p._frame) {
+      frameStart = i;
+      frameBytes = 0;
+      if (p._offset != UploadPlanner::alignUp(stagingStart, g_Alignment)) {
+        printf("Frame %zu did not start over at the beginning of the staging buffer!\n", p._frame);
+        return false;
+      }
+    }
+    else {
+      auto& prev = planned[i - 1];
+      if (p._offset < prev._offset + sizes[prev._index] || p._offset % g_Alignment != 0) {
+        printf("Upload %zu overlaps the previous one or is not aligned!\n", i);
+        return false;
+      }
+    }
+
+    if (p._offset + sizes[i] > g_StagingSize) {
+      printf("Upload %zu goes past the staging end!\n", i);
+      return false;
+    }
+
+    // Over budget only when alone in the frame
+    frameBytes += sizes[i];
+    if (frameBytes > g_FrameBudget && i != frameStart) {
+      printf("Frame %zu planned %zu bytes, budget is %zu!\n", p._frame, frameBytes, g_FrameBudget);
+      return false;
+    }
+  }
+
+  return true;
+}
+
+struct Fragmented
+{
+  BufferMemoryInterface _memIf;
+  std::vector<GigaBufferCompactor::Allocation> _allocations;
+};
+
+// Fills a buffer with allocations and frees every third one, like meshes unloading over time.
+// Random sizes unless fixedSize is given.
+Fragmented makeFragmented(std::size_t count, std::size_t fixedSize)
+{
+  std::mt19937 rng(4321);
+  std::uniform_int_distribution<std::size_t> sizeDist(256, 64 * 1024);
+
+  Fragmented out{ BufferMemoryInterface(count * 64 * 1024), {} };
+  for (std::size_t i = 0; i < count; ++i) {
+    out._allocations.emplace_back(GigaBufferCompactor::Allocation{ i, out._memIf.addData(fixedSize > 0 ? fixedSize : sizeDist(rng)) });
+  }
+
+  // Freed after everything is added, addData would refill the holes otherwise
+  std::erase_if(out._allocations, [&out](const GigaBufferCompactor::Allocation& alloc) {
+    if (alloc._userIndex % 3 == 1) {
+      out._memIf.removeData(alloc._handle);
+      return true;
+    }
+    return false;
+  });
+  return out;
+}
+
+bool overlaps(const BufferMemoryInterface::Handle& a, const BufferMemoryInterface::Handle& b)
+{
+  return a._offset < b._offset + (std::int64_t)b._size && b._offset < a._offset + (std::int64_t)a._size;
+}
+
+// Plans and applies moves until there are none left, checking every round.
+// Sources are freed right after planning, as the renderer does once the frames reading them are done.
+bool compactFully(Fragmented& frag, std::size_t byteBudget, std::size_t& numRounds)
+{
+  numRounds = 0;
+  while (true) {
+    auto moves = GigaBufferCompactor::planMoves(frag._memIf, frag._allocations, byteBudget);
+    if (moves.empty()) {
+      return true;
+    }
+
+    if (++numRounds > frag._allocations.size()) {
+      printf("Compaction did not finish after %zu rounds!\n", numRounds);
+      return false;
+    }
+
+    std::size_t movedBytes = 0;
+    for (std::size_t i = 0; i < moves.size(); ++i) {
+      auto& m = moves[i];
+      movedBytes += m._src._size;
+
+      if (m._dst._size != m._src._size || m._dst._offset + (std::int64_t)m._dst._size > m._src._offset) {
+        printf("Move of allocation %zu from %lld to %lld does not go below it!\n",
+          m._userIndex, (long long)m._src._offset, (long long)m._dst._offset);
+        return false;
+      }
+
+      for (std::size_t j = i + 1; j < moves.size(); ++j) {
+        if (overlaps(m._dst, moves[j]._dst)) {
+          printf("Moves of allocations %zu and %zu overlap!\n", m._userIndex, moves[j]._userIndex);
+          return false;
+        }
+      }
+
+      // Live allocations include all sources, which frames in flight may still read
+      for (auto& alloc : frag._allocations) {
+        if (overlaps(m._dst, alloc._handle)) {
+          printf("Move of allocation %zu overlaps live allocation %zu!\n", m._userIndex, alloc._userIndex);
+          return false;
+        }
+      }
+    }
+
+    if (movedBytes > byteBudget && moves.size() > 1) {
+      printf("Moved %zu bytes, budget is %zu!\n", movedBytes, byteBudget);
+      return false;
+    }
+
+    for (auto& m : moves) {
+      frag._memIf.removeData(m._src);
+      for (auto& alloc : frag._allocations) {
+        if (alloc._userIndex == m._userIndex) {
+          alloc._handle = m._dst;
+        }
+      }
+    }
+  }
+}
+
+bool checkCompaction()
+{
+  std::size_t numRounds = 0;
+
+  // Equally sized allocations always fit the holes, so they have to end up fully packed
+  {
+    const std::size_t size = 16 * 1024;
+    auto frag = makeFragmented(g_NumAllocations, size);
+    if (!compactFully(frag, g_CompactBudget, numRounds)) {
+      return false;
+    }
+
+    std::size_t liveBytes = frag._allocations.size() * size;
+    if (frag._memIf.usedSpace() != liveBytes || frag._memIf.fragmentation() != 0.0) {
+      printf("Used space is %zu after compaction, expected %zu!\n", frag._memIf.usedSpace(), liveBytes);
+      return false;
+    }
+  }
+
+  // Mixed sizes can leave holes that nothing above fits in, but no allocation may be left that could still move down
+  {
+    auto frag = makeFragmented(g_NumAllocations, 0);
+    if (!compactFully(frag, g_CompactBudget, numRounds)) {
+      return false;
+    }
+
+    for (auto& alloc : frag._allocations) {
+      auto probe = frag._memIf;
+      if (probe.addDataBelow(alloc._handle._size, alloc._handle._offset)) {
+        printf("Allocation %zu still fits below itself after compaction!\n", alloc._userIndex);
+        return false;
+      }
+    }
+
+    // Every source was given back and every destination is still held
+    std::size_t liveBytes = 0;
+    for (auto& alloc : frag._allocations) {
+      liveBytes += alloc._handle._size;
+    }
+    if (frag._memIf.freeSpace() != frag._memIf.size() - liveBytes) {
+      printf("Free space is %zu after compaction, expected %zu!\n", frag._memIf.freeSpace(), frag._memIf.size() - liveBytes);
+      return false;
+    }
+  }
+
+  // A budget smaller than any allocation still moves one per round
+  {
+    auto frag = makeFragmented(64, 16 * 1024);
+    auto moves = GigaBufferCompactor::planMoves(frag._memIf, frag._allocations, 1024);
+    if (moves.size() != 1) {
+      printf("Planned %zu moves with a budget below the allocation size, expected 1!\n", moves.size());
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// Mip sizes of a square RGBA8 texture
+std::vector<std::size_t> rgbaMipBytes(std::uint32_t size)
+{
+  std::vector<std::size_t> out;
+  for (std::uint32_t s = size; s > 0; s /= 2) {
+    out.emplace_back((std::size_t)s * s * 4);
+  }
+  return out;
+}
+
+std::size_t chainBytes(const std::vector<std::size_t>& mipBytes, std::uint32_t firstMip)
+{
+  std::size_t sum = 0;
+  for (std::size_t i = firstMip; i < mipBytes.size(); ++i) {
+    sum += mipBytes[i];
+  }
+  return sum;
+}
+
+bool expectRequests(const char* what, const std::vector<TextureResidency::Request>& requests, const std::vector<TextureResidency::Request>& expected)
+{
+  bool ok = requests.size() == expected.size();
+  for (std::size_t i = 0; ok && i < requests.size(); ++i) {
+    // Order of the requests is not part of the contract
+    bool found = false;
+    for (auto& e : expected) {
+      found |= requests[i]._id == e._id && requests[i]._firstMip == e._firstMip;
+    }
+    ok = found;
+  }
+
+  if (!ok) {
+    printf("%s: got %zu requests", what, requests.size());
+    for (auto& r : requests) {
+      printf(" (mip %u)", r._firstMip);
+    }
+    printf(", expected %zu!\n", expected.size());
+  }
+  return ok;
+}
+
+bool checkTexelDensity()
+{
+  const std::uint32_t size = 1024;
+  const std::uint32_t tailMip = 6;
+  const std::uint32_t evictDelay = 8;
+  auto id = util::Uuid::generate();
+
+  TextureResidency residency(0, 4, evictDelay);
+  residency.addTexture(id, size, rgbaMipBytes(size), tailMip);
+  if (residency.residentMip(id) != tailMip) {
+    printf("New texture is resident at mip %u, expected the tail %u!\n", residency.residentMip(id), tailMip);
+    return false;
+  }
+
+  // 2 units seen from 10 units away with a 60 degree fov covers about 187 pixels of a 1080 high screen, so mip 2 (256 texels)
+  float projScale = 1.0f / std::tan(0.5f * 1.0471976f);
+  float pixels = TextureResidency::projectedPixels(2.0f, 10.0f, projScale, 1080.0f);
+  residency.requestPixels(id, pixels);
+  if (!expectRequests("Far away", residency.update(), { { id, 2 } })) {
+    return false;
+  }
+
+  // Nothing new while the upload is in flight
+  residency.requestPixels(id, pixels);
+  if (!expectRequests("In flight", residency.update(), {})) {
+    return false;
+  }
+
+  residency.setResident(id, 2);
+  if (residency.residentMip(id) != 2 || residency.residentBytes() != chainBytes(rgbaMipBytes(size), 2)) {
+    printf("Texture is resident at mip %u with %zu bytes after setResident(2)!\n", residency.residentMip(id), residency.residentBytes());
+    return false;
+  }
+
+  // Up close it wants full detail, a covered pixel count above the texture size doesn't go below mip 0
+  residency.requestPixels(id, TextureResidency::projectedPixels(2.0f, 1.0f, projScale, 1080.0f));
+  residency.requestMip(id, 1.7f); // Finest report of the frame wins
+  if (!expectRequests("Up close", residency.update(), { { id, 0 } })) {
+    return false;
+  }
+  residency.setResident(id, 0);
+
+  // Out of sight, detail is only dropped once it hasn't been needed for evictDelay frames
+  for (std::uint32_t i = 1; i < evictDelay; ++i) {
+    if (!expectRequests("Recently needed", residency.update(), {})) {
+      return false;
+    }
+  }
+  if (!expectRequests("Not needed for a while", residency.update(), { { id, tailMip } })) {
+    return false;
+  }
+
+  return true;
+}
+
+bool checkBudgetEviction()
+{
+  const std::uint32_t size = 1024;
+  const std::uint32_t tailMip = 6;
+  auto mipBytes = rgbaMipBytes(size);
+  auto a = util::Uuid::generate();
+  auto b = util::Uuid::generate();
+
+  // Room for one full texture and the tail of the other
+  const std::size_t budget = 6 * 1024 * 1024;
+  TextureResidency residency(budget, 4, 1000);
+  residency.addTexture(a, size, mipBytes, tailMip);
+  residency.addTexture(b, size, mipBytes, tailMip);
+
+  residency.requestMip(a, 0.0f);
+  if (!expectRequests("First texture", residency.update(), { { a, 0 } })) {
+    return false;
+  }
+  residency.setResident(a, 0);
+
+  // Both needed in full: the one that is resident keeps its detail, the other one settles for what fits
+  residency.requestMip(a, 0.0f);
+  residency.requestMip(b, 0.0f);
+  auto requests = residency.update();
+  if (!expectRequests("Both needed", requests, { { b, 2 } })) {
+    return false;
+  }
+  if (chainBytes(mipBytes, 0) + chainBytes(mipBytes, 2) > budget) {
+    printf("Both needed: the coarser mip does not fit the budget!\n");
+    return false;
+  }
+  residency.setResident(b, 2);
+
+  // Only the second one needed: the first is evicted long before its delay to make room
+  residency.requestMip(b, 0.0f);
+  if (!expectRequests("Second needed", residency.update(), { { a, tailMip }, { b, 0 } })) {
+    return false;
+  }
+  residency.setResident(a, tailMip);
+  residency.setResident(b, 0);
+
+  if (residency.residentMip(a) != tailMip || residency.residentMip(b) != 0 || residency.residentBytes() > budget) {
+    printf("After eviction mips are %u and %u with %zu bytes resident, budget is %zu!\n",
+      residency.residentMip(a), residency.residentMip(b), residency.residentBytes(), budget);
+    return false;
+  }
+
+  return true;
+}
+
+}
+
+void registerUploadBenchmarks(Runner& runner)
+{
+  {
+    // Planning a big batch of uploads over as many frames as the budget requires, then merging the copies
+    struct State
+    {
+      std::vector<std::size_t> _sizes;
+      std::vector<UploadPlanner::CopyRegion> _regions;
+    };
+    auto state = std::make_shared<State>();
+    state->_sizes = makeUploadSizes(g_NumUploads);
+
+    Benchmark b{};
+    b._group = "upload";
+    b._name = "plan_uploads_10000";
+    b._items = g_NumUploads;
+    b._check = []() { return checkCoalesce() && checkBudget() && checkStagingEnd() && checkFrames(); };
+    b._run = [state]() {
+      std::size_t numFrames = 0;
+      auto planned = planFrames(state->_sizes, 0, numFrames);
+
+      // Copies of consecutive uploads go to consecutive destinations, as for the meshes of a model
+      state->_regions.clear();
+      std::size_t dst = 0;
+      for (auto& p : planned) {
+        state->_regions.emplace_back(UploadPlanner::CopyRegion{ p._offset, dst, state->_sizes[p._index] });
+        dst += state->_sizes[p._index];
+      }
+      UploadPlanner::coalesce(state->_regions);
+      doNotOptimize(state->_regions.data());
+    };
+    runner.add(std::move(b));
+  }
+
+  {
+    // One round of compaction planning over a fragmented buffer, as done once per frame
+    auto frag = std::make_shared<Fragmented>(makeFragmented(g_NumAllocations, 0));
+    auto work = std::make_shared<BufferMemoryInterface>();
+
+    Benchmark b{};
+    b._group = "upload";
+    b._name = "compact_plan_4096";
+    b._items = g_NumAllocations;
+    b._check = []() { return checkCompaction(); };
+    b._setup = [frag, work]() { *work = frag->_memIf; };
+    b._run = [frag, work]() {
+      auto moves = GigaBufferCompactor::planMoves(*work, frag->_allocations, g_CompactBudget);
+      doNotOptimize(moves.data());
+    };
+    runner.add(std::move(b));
+  }
+
+  {
+    // A frame of distance based requests for many streamed textures, with a budget too small for all of them
+    struct State
+    {
+      TextureResidency _residency;
+      std::vector<util::Uuid> _ids;
+      std::vector<float> _distances;
+    };
+    auto state = std::make_shared<State>();
+
+    Benchmark b{};
+    b._group = "upload";
+    b._name = "residency_update_4096";
+    b._items = g_NumTextures;
+    b._check = []() { return checkTexelDensity() && checkBudgetEviction(); };
+    b._setup = [state]() {
+      if (!state->_ids.empty()) {
+        return;
+      }
+
+      std::mt19937 rng(99);
+      std::uniform_real_distribution<float> distance(1.0f, 200.0f);
+      std::uniform_int_distribution<std::uint32_t> sizeExp(8, 12);
+
+      state->_residency.setBudget(256 * 1024 * 1024);
+      for (std::size_t i = 0; i < g_NumTextures; ++i) {
+        auto id = util::Uuid::generate();
+        auto size = 1u << sizeExp(rng);
+        state->_residency.addTexture(id, size, rgbaMipBytes(size), 6);
+        state->_ids.emplace_back(id);
+        state->_distances.emplace_back(distance(rng));
+      }
+    };
+    b._run = [state]() {
+      float projScale = 1.0f / std::tan(0.5f * 1.0471976f);
+      for (std::size_t i = 0; i < state->_ids.size(); ++i) {
+        state->_residency.requestPixels(state->_ids[i], TextureResidency::projectedPixels(2.0f, state->_distances[i], projScale, 1080.0f));
+      }
+
+      auto requests = state->_residency.update();
+      for (auto& r : requests) {
+        state->_residency.setResident(r._id, r._firstMip);
+      }
+      doNotOptimize(requests.data());
+    };
+    runner.add(std::move(b));
+  }
+}
+
+}
@@ -0,0 +1,132 @@
+#include "Bench.h"
+#include "Benchmarks.h"
+
+#include <physics/PhysicsReplay.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace {
+
+void printUsage()
+{
+  printf("Usage: anerend_bench [options]\n");
+  printf("  --list             List all benchmarks and exit\n");
+  printf("  --filter <str>     Only run benchmarks whose group/name contains str\n");
+  printf("  --samples <n>      Override the number of samples of every benchmark\n");
+  printf("  --quick            One sample and no warmup per benchmark, for smoke testing\n");
+  printf("  --out <file>       Write results as json\n");
+  printf("  --baseline <file>  Compare medians against a json written by --out\n");
+  printf("  --threshold <pct>  Slowdown counted as a regression when comparing, default 10\n");
+  printf("  --replay <file>    Re-simulate a physics recording instead, and report timings and divergence\n");
+  printf("  --replay-csv <file> Write the per tick timings of the replay as csv\n");
+  printf("Exits with 1 if any benchmark failed its check or regressed against the baseline.\n");
+}
+
+int runReplay(const std::string& path, const std::string& csvPath)
+{
+  physics::PhysicsReplay replay;
+  if (!replay.load(path)) {
+    return 2;
+  }
+
+  auto report = replay.run();
+  report.print();
+
+  if (!csvPath.empty() && !replay.writeTimingsCsv(csvPath)) {
+    return 2;
+  }
+
+  return 0;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+  bench::RunOptions options{};
+  std::string outPath;
+  std::string baselinePath;
+  std::string replayPath;
+  std::string replayCsvPath;
+  double threshold = 10.0;
+  bool list = false;
+
+  for (int i = 1; i < argc; ++i) {
+    bool hasValue = i + 1 < argc;
+
+    if (std::strcmp(argv[i], "--list") == 0) {
+      list = true;
+    }
+    else if (std::strcmp(argv[i], "--quick") == 0) {
+      options._quick = true;
+    }
+    else if (std::strcmp(argv[i], "--filter") == 0 && hasValue) {
+      options._filter = argv[++i];
+    }
+    else if (std::strcmp(argv[i], "--samples") == 0 && hasValue) {
+      options._samples = std::strtoul(argv[++i], nullptr, 10);
+    }
+    else if (std::strcmp(argv[i], "--out") == 0 && hasValue) {
+      outPath = argv[++i];
+    }
+    else if (std::strcmp(argv[i], "--baseline") == 0 && hasValue) {
+      baselinePath = argv[++i];
+    }
+    else if (std::strcmp(argv[i], "--threshold") == 0 && hasValue) {
+      threshold = std::strtod(argv[++i], nullptr);
+    }
+    else if (std::strcmp(argv[i], "--replay") == 0 && hasValue) {
+      replayPath = argv[++i];
+    }
+    else if (std::strcmp(argv[i], "--replay-csv") == 0 && hasValue) {
+      replayCsvPath = argv[++i];
+    }
+    else {
+      printUsage();
+      return std::strcmp(argv[i], "--help") == 0 ? 0 : 2;
+    }
+  }
+
+  // A replay is its own run, without the benchmarks
+  if (!replayPath.empty()) {
+    return runReplay(replayPath, replayCsvPath);
+  }
+
+  bench::Runner runner;
+  bench::registerSceneBenchmarks(runner);
+  bench::registerAssetBenchmarks(runner);
+  bench::registerTextureBenchmarks(runner);
+  bench::registerAnimationBenchmarks(runner);
+  bench::registerFrameGraphBenchmarks(runner);
+  bench::registerPhysicsBenchmarks(runner);
+  bench::registerRendererBenchmarks(runner);
+  bench::registerCullingBenchmarks(runner);
+  bench::registerProfilerBenchmarks(runner);
+  bench::registerBehaviourBenchmarks(runner);
+  bench::registerParticleBenchmarks(runner);
+  bench::registerUploadBenchmarks(runner);
+
+  if (list) {
+    runner.list();
+    return 0;
+  }
+
+  auto results = runner.run(options);
+
+  if (!outPath.empty() && !bench::Runner::writeJson(outPath, results)) {
+    return 2;
+  }
+
+  if (!baselinePath.empty() && !bench::Runner::compare(baselinePath, results, threshold)) {
+    return 1;
+  }
+
+  if (!runner.checksPassed()) {
+    return 1;
+  }
+
+  return 0;
+}